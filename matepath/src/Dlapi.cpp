@@ -31,6 +31,72 @@ struct IUnknown;
 
 //==== DirList ================================================================
 
+//==== DLSNAPSHOT Structure ===================================================
+// Snapshot of the enumerated directory: cloned item ids plus case-folded
+// display names, so a changed filter can be re-applied with plain string
+// matching instead of enumerating the folder again
+struct DLSNAPSHOTENTRY {
+	LPITEMIDLIST pidl;			// owned clone of the enumerated item id
+	DWORD dwAttributes;			// SFGAO_FILESYSTEM | SFGAO_FOLDER
+	LPWSTR pszName;				// lowercase file name matched by the filter
+};
+
+struct DLSNAPSHOT {
+	DLSNAPSHOTENTRY *entries;
+	UINT count;
+	UINT capacity;
+	void Clear() noexcept;
+	void Add(LPCITEMIDLIST pidl, DWORD dwAttributes, LPCWSTR lpszFileName) noexcept;
+	void Remove(LPCWSTR lpszFileName) noexcept;
+};
+
+void DLSNAPSHOT::Clear() noexcept {
+	if (entries) {
+		for (UINT i = 0; i < count; i++) {
+			CoTaskMemFree(entries[i].pidl);
+			if (entries[i].pszName) {
+				LocalFree(entries[i].pszName);
+			}
+		}
+		NP2HeapFree(entries);
+		entries = nullptr;
+	}
+	count = 0;
+	capacity = 0;
+}
+
+void DLSNAPSHOT::Add(LPCITEMIDLIST pidl, DWORD dwAttributes, LPCWSTR lpszFileName) noexcept {
+	if (count == capacity) {
+		capacity = (capacity == 0) ? 512 : capacity*2;
+		DLSNAPSHOTENTRY *ptr = static_cast<DLSNAPSHOTENTRY *>(NP2HeapAlloc(capacity * sizeof(DLSNAPSHOTENTRY)));
+		if (entries) {
+			memcpy(ptr, entries, count * sizeof(DLSNAPSHOTENTRY));
+			NP2HeapFree(entries);
+		}
+		entries = ptr;
+	}
+
+	DLSNAPSHOTENTRY &entry = entries[count++];
+	entry.pidl = IL_Create(nullptr, 0, pidl, 0);
+	entry.dwAttributes = dwAttributes;
+	entry.pszName = StrDup(lpszFileName);
+	if (entry.pszName) {
+		CharLower(entry.pszName);
+	}
+}
+
+void DLSNAPSHOT::Remove(LPCWSTR lpszFileName) noexcept {
+	for (UINT i = 0; i < count; i++) {
+		if (entries[i].pszName && StrCaseEqual(entries[i].pszName, lpszFileName)) {
+			CoTaskMemFree(entries[i].pidl);
+			LocalFree(entries[i].pszName);
+			// entry order is irrelevant, DirList_ReFilter() sorts the control
+			entries[i] = entries[--count];
+			return;
+		}
+	}
+}
+
 //==== DLDATA Structure =======================================================
 struct DLDATA {
 	BackgroundWorker worker;	// where HWND is ListView Control
@@ -44,8 +110,19 @@ struct DLDATA {
 	HANDLE hExitThread;			// Flag is set when Icon Thread should terminate
 	HANDLE hTerminatedThread;	// Flag is set when Icon Thread has terminated
 	HANDLE hIconThread;
+	LPENUMIDLIST lpe;			// Pending enumeration, continued by Fill Thread
+	int iSortFlags;				// Sort order to restore after streamed fill
+	bool fSortRev;
+	DirListFilter dlf;			// Filter matched on the Fill Thread
+	DLSNAPSHOT dls;				// Snapshot refiltered by DirList_ReFilter()
+	HANDLE hDirChange;			// Directory handle for ReadDirectoryChangesW()
+	HANDLE hChangeFallback;		// Change notification when the handle can't be opened
+	OVERLAPPED ovlChange;		// Pending change read, hEvent signals arrived records
+	BYTE changeBuf[8192];		// FILE_NOTIFY_INFORMATION records
 };
 
+static DWORD WINAPI DirList_FillThread(LPVOID lpParam);
+
 //==== Property Name ==========================================================
 static const WCHAR *pDirListProp = L"DirListData";
 // same as ILNext()
@@ -100,6 +177,8 @@ void DirList_Destroy(HWND hwnd) {
 	DLDATA * const lpdl = static_cast<DLDATA *>(GetProp(hwnd, pDirListProp));
 
 	lpdl->worker.Destroy();
+	DirList_StopWatch(hwnd);
+	lpdl->dls.Clear();
 
 	if (lpdl->pidl) {
 		CoTaskMemFree(lpdl->pidl);
@@ -123,6 +202,12 @@ void DirList_Destroy(HWND hwnd) {
 void DirList_StartIconThread(HWND hwnd) noexcept {
 	DLDATA * const lpdl = static_cast<DLDATA *>(GetProp(hwnd, pDirListProp));
 
+	if (lpdl->lpe != nullptr) {
+		// DirList_FillThread() is still streaming items into the control
+		// and chains into the icon extraction pass itself
+		return;
+	}
+
 	lpdl->worker.Cancel();
 	lpdl->worker.workerThread = CreateThread(nullptr, 0, DirList_IconThread, lpdl, 0, nullptr);
 }
@@ -153,14 +238,16 @@ int DirList_Fill(HWND hwnd, LPCWSTR lpszDir, DWORD grfFlags, LPCWSTR lpszFileSpe
 	}
 
 	lstrcpy(lpdl->szPath, lpszDir);
+	lpdl->iSortFlags = iSortFlags;
+	lpdl->fSortRev = fSortRev;
 
 	// Init ListView
 	SendMessage(hwnd, WM_SETREDRAW, 0, 0);
 	ListView_DeleteAllItems(hwnd);
 
 	// Init Filter
-	DirListFilter dlf;
-	dlf.Create(lpszFileSpec, bExcludeFilter);
+	lpdl->dlf.Create(lpszFileSpec, bExcludeFilter);
+	lpdl->dls.Clear();
 
 	// Init lvi
 	LV_ITEM lvi;
@@ -178,6 +265,7 @@ int DirList_Fill(HWND hwnd, LPCWSTR lpszDir, DWORD grfFlags, LPCWSTR lpszFileSpe
 	LPSHELLFOLDER lpsfDesktop = nullptr;
 	PIDLIST_RELATIVE pidl = nullptr;
 	LPSHELLFOLDER lpsf = nullptr;
+	LPENUMIDLIST lpe = nullptr;
 	if (S_OK == SHGetDesktopFolder(&lpsfDesktop)) {
 		// Convert wszDir into a pidl
 		ULONG chParsed = 0;
@@ -186,9 +274,13 @@ int DirList_Fill(HWND hwnd, LPCWSTR lpszDir, DWORD grfFlags, LPCWSTR lpszFileSpe
 			// Bind pidl to IShellFolder
 			if (S_OK == lpsfDesktop->BindToObject(pidl, nullptr, IID_IShellFolder, AsPPVArgs(&lpsf))) {
 				// Create an Enumeration object for lpsf
-				LPENUMIDLIST lpe = nullptr;
 				if (S_OK == lpsf->EnumObjects(hwnd, grfFlags, &lpe)) {
-					// Enumerate the contents of lpsf
+					// Enumerate the contents of lpsf until the time slice
+					// expires, then hand the enumeration over to a worker
+					// thread so huge or slow folders don't freeze the window
+					const DWORD tickEnd = GetTickCount() + 50;
+					UINT scanned = 0;
+					bool pending = false;
 					PITEMID_CHILD pidlEntry = nullptr;
 					while (S_OK == lpe->Next(1, &pidlEntry, nullptr)) {
 						// Add found item to the List
@@ -197,8 +289,11 @@ int DirList_Fill(HWND hwnd, LPCWSTR lpszDir, DWORD grfFlags, LPCWSTR lpszFileSpe
 						lpsf->GetAttributesOf(1, reinterpret_cast<PCUITEMID_CHILD_ARRAY>(&pidlEntry), &dwAttributes);
 
 						if (dwAttributes & SFGAO_FILESYSTEM) {
+							WIN32_FIND_DATA fd;
+							SHGetDataFromIDList(lpsf, reinterpret_cast<PCUITEMID_CHILD>(pidlEntry), SHGDFIL_FINDDATA, &fd, sizeof(WIN32_FIND_DATA));
+							lpdl->dls.Add(pidlEntry, dwAttributes, fd.cFileName);
 							// Check if item matches specified filter
-							if (dlf.Match(lpsf, pidlEntry)) {
+							if (lpdl->dlf.MatchName(fd.dwFileAttributes, fd.cFileName)) {
 								LV_ITEMDATA *lplvid = static_cast<LV_ITEMDATA *>(CoTaskMemAlloc(sizeof(LV_ITEMDATA)));
 								lplvid->pidl = pidlEntry;
 								lplvid->lpsf = lpsf;
@@ -210,9 +305,17 @@ int DirList_Fill(HWND hwnd, LPCWSTR lpszDir, DWORD grfFlags, LPCWSTR lpszFileSpe
 								lvi.iItem++;
 							}
 						}
+						if ((++scanned & 63) == 0 && GetTickCount() >= tickEnd) {
+							// continued in DirList_FillThread()
+							pending = true;
+							break;
+						}
 					} // IEnumIDList::Next()
 
-					lpe->Release();
+					if (!pending) {
+						lpe->Release();
+						lpe = nullptr;
+					}
 
 				} // IShellFolder::EnumObjects()
 
@@ -235,6 +338,7 @@ int DirList_Fill(HWND hwnd, LPCWSTR lpszDir, DWORD grfFlags, LPCWSTR lpszFileSpe
 	lpdl->cbidl = IL_GetSize(pidl);
 	lpdl->pidl = pidl;
 	lpdl->lpsf = lpsf;
+	lpdl->lpe = lpe;
 	lpdl->bNoFadeHidden = bNoFadeHidden;
 
 	// Set column width to fit window
@@ -246,16 +350,160 @@ int DirList_Fill(HWND hwnd, LPCWSTR lpszDir, DWORD grfFlags, LPCWSTR lpszFileSpe
 	// Redraw Listview
 	SendMessage(hwnd, WM_SETREDRAW, 1, 0);
 
+	if (lpe != nullptr) {
+		// Stream the remaining items in on the worker thread
+		lpdl->worker.workerThread = CreateThread(nullptr, 0, DirList_FillThread, lpdl, 0, nullptr);
+	}
+
+	// Return number of items in the control
+	return ListView_GetItemCount(hwnd);
+}
+
+//=============================================================================
+//
+//  DirList_ReFilter()
+//
+//  Applies a changed filter against the directory snapshot taken by
+//  DirList_Fill(), matching the prebuilt lowercase names instead of
+//  enumerating the folder again.  Returns -1 when no snapshot is available
+//  (the caller falls back to a full DirList_Fill())
+//
+int DirList_ReFilter(HWND hwnd, LPCWSTR lpszFileSpec, bool bExcludeFilter) {
+	DLDATA * const lpdl = static_cast<DLDATA *>(GetProp(hwnd, pDirListProp));
+	if (lpdl == nullptr || lpdl->lpsf == nullptr || lpdl->lpe != nullptr) {
+		// no snapshot yet, or DirList_FillThread() is still streaming into it
+		return -1;
+	}
+
+	lpdl->worker.Cancel();
+	lpdl->dlf.Create(lpszFileSpec, bExcludeFilter);
+
+	SendMessage(hwnd, WM_SETREDRAW, 0, 0);
+	ListView_DeleteAllItems(hwnd);
+
+	// Init lvi
+	LV_ITEM lvi;
+	lvi.mask = LVIF_TEXT | LVIF_IMAGE | LVIF_PARAM;
+	lvi.iItem = 0;
+	lvi.iSubItem = 0;
+	lvi.pszText = LPSTR_TEXTCALLBACK;
+	lvi.cchTextMax = MAX_PATH;
+
+	LPSHELLFOLDER lpsf = lpdl->lpsf;
+	const DLSNAPSHOT &dls = lpdl->dls;
+	for (UINT i = 0; i < dls.count; i++) {
+		const DLSNAPSHOTENTRY &entry = dls.entries[i];
+		const DWORD dwFileAttributes = (entry.dwAttributes & SFGAO_FOLDER) ? FILE_ATTRIBUTE_DIRECTORY : 0;
+		if (lpdl->dlf.MatchName(dwFileAttributes, entry.pszName)) {
+			LV_ITEMDATA *lplvid = static_cast<LV_ITEMDATA *>(CoTaskMemAlloc(sizeof(LV_ITEMDATA)));
+			lplvid->pidl = IL_Create(nullptr, 0, entry.pidl, 0);
+			lplvid->lpsf = lpsf;
+			lpsf->AddRef();
+			lvi.lParam = AsInteger<LPARAM>(lplvid);
+			// Setup default Icon - Folder or File
+			lvi.iImage = (entry.dwAttributes & SFGAO_FOLDER) ? lpdl->iDefIconFolder : lpdl->iDefIconFile;
+			ListView_InsertItem(hwnd, &lvi);
+			lvi.iItem++;
+		}
+	}
+
+	// Set column width to fit window
+	ListView_SetColumnWidth(hwnd, 0, LVSCW_AUTOSIZE_USEHEADER);
+
+	// Sort before display is updated
+	DirList_Sort(hwnd, lpdl->iSortFlags, lpdl->fSortRev);
+
+	// Redraw Listview
+	SendMessage(hwnd, WM_SETREDRAW, 1, 0);
+
 	// Return number of items in the control
 	return ListView_GetItemCount(hwnd);
 }
 
+//=============================================================================
+//
+//  DirList_FillThread()
+//
+//  Thread to stream the remaining directory items into the listview, then
+//  chain into the icon extraction pass
+//
+static DWORD WINAPI DirList_FillThread(LPVOID lpParam) {
+	DLDATA * const lpdl = static_cast<DLDATA *>(lpParam);
+	const BackgroundWorker &worker = lpdl->worker;
+
+	HWND hwnd = worker.hwnd;
+	LPENUMIDLIST lpe = lpdl->lpe;
+	LPSHELLFOLDER lpsf = lpdl->lpsf;
+
+	// Init lvi
+	LV_ITEM lvi;
+	lvi.mask = LVIF_TEXT | LVIF_IMAGE | LVIF_PARAM;
+	lvi.iItem = ListView_GetItemCount(hwnd);
+	lvi.iSubItem = 0;
+	lvi.pszText = LPSTR_TEXTCALLBACK;
+	lvi.cchTextMax = MAX_PATH;
+
+	PITEMID_CHILD pidlEntry = nullptr;
+	while (worker.Continue() && S_OK == lpe->Next(1, &pidlEntry, nullptr)) {
+		// Check if it's part of the Filesystem
+		DWORD dwAttributes = SFGAO_FILESYSTEM | SFGAO_FOLDER;
+		lpsf->GetAttributesOf(1, reinterpret_cast<PCUITEMID_CHILD_ARRAY>(&pidlEntry), &dwAttributes);
+
+		if (dwAttributes & SFGAO_FILESYSTEM) {
+			WIN32_FIND_DATA fd;
+			SHGetDataFromIDList(lpsf, reinterpret_cast<PCUITEMID_CHILD>(pidlEntry), SHGDFIL_FINDDATA, &fd, sizeof(WIN32_FIND_DATA));
+			lpdl->dls.Add(pidlEntry, dwAttributes, fd.cFileName);
+			// Check if item matches specified filter, off the UI thread
+			if (lpdl->dlf.MatchName(fd.dwFileAttributes, fd.cFileName)) {
+				LV_ITEMDATA *lplvid = static_cast<LV_ITEMDATA *>(CoTaskMemAlloc(sizeof(LV_ITEMDATA)));
+				lplvid->pidl = pidlEntry;
+				lplvid->lpsf = lpsf;
+				lpsf->AddRef();
+				lvi.lParam = AsInteger<LPARAM>(lplvid);
+				// Setup default Icon - Folder or File
+				lvi.iImage = (dwAttributes & SFGAO_FOLDER) ? lpdl->iDefIconFolder : lpdl->iDefIconFile;
+				ListView_InsertItem(hwnd, &lvi);
+				lvi.iItem++;
+			}
+		}
+	} // IEnumIDList::Next()
+
+	lpe->Release();
+	lpdl->lpe = nullptr;
+
+	if (!worker.Continue()) {
+		return 0;
+	}
+
+	// Restore the sort order and let the parent update the item count
+	DirList_Sort(hwnd, lpdl->iSortFlags, lpdl->fSortRev);
+	PostMessage(GetParent(hwnd), DLN_ITEMSFILLED, ListView_GetItemCount(hwnd), 0);
+
+	return DirList_IconThread(lpdl);
+}
+
 //=============================================================================
 //
 //  DirList_IconThread()
 //
 //  Thread to extract file icons in the background
 //
+#define DL_ICON_CACHE_SIZE	64
+
+struct FileIconCacheEntry {
+	int iIcon;
+	WCHAR szExt[32];
+};
+
+// Files whose icon comes from the file itself rather than the file type
+// can't share a cached icon index
+static bool DirList_IsCacheableExt(LPCWSTR pszExt) noexcept {
+	return StrNotEmpty(pszExt)
+		&& !StrCaseEqual(pszExt, L".exe") && !StrCaseEqual(pszExt, L".lnk")
+		&& !StrCaseEqual(pszExt, L".ico") && !StrCaseEqual(pszExt, L".cur")
+		&& !StrCaseEqual(pszExt, L".ani") && !StrCaseEqual(pszExt, L".url");
+}
+
 DWORD WINAPI DirList_IconThread(LPVOID lpParam) {
 	DLDATA * const lpdl = static_cast<DLDATA *>(lpParam);
 	const BackgroundWorker &worker = lpdl->worker;
@@ -272,6 +520,10 @@ DWORD WINAPI DirList_IconThread(LPVOID lpParam) {
 	IShellIcon *lpshi;
 	lpdl->lpsf->QueryInterface(IID_IShellIcon, AsPPVArgs(&lpshi));
 
+	// Extension to icon index cache, valid for this pass only
+	FileIconCacheEntry iconCache[DL_ICON_CACHE_SIZE];
+	UINT cCachedIcons = 0;
+
 	int iItem = 0;
 	while (iItem < iMaxItem && worker.Continue()) {
 		LV_ITEM lvi;
@@ -281,43 +533,66 @@ DWORD WINAPI DirList_IconThread(LPVOID lpParam) {
 			LV_ITEMDATA *lplvid = AsPointer<LV_ITEMDATA *>(lvi.lParam);
 			lvi.mask = LVIF_IMAGE;
 
-			if (!lpshi || S_OK != lpshi->GetIconOf(reinterpret_cast<PCUITEMID_CHILD>(lplvid->pidl), GIL_FORSHELL, &lvi.iImage)) {
-				SHFILEINFO shfi;
-				LPITEMIDLIST pidl = IL_Create(lpdl->pidl, lpdl->cbidl, lplvid->pidl, 0);
-				SHGetFileInfo(reinterpret_cast<LPCWSTR>(pidl), 0, &shfi, sizeof(SHFILEINFO), SHGFI_PIDL | SHGFI_SYSICONINDEX | SHGFI_SMALLICON);
-				CoTaskMemFree(pidl);
-				lvi.iImage = shfi.iIcon;
+			WIN32_FIND_DATA fd;
+			const bool haveData = S_OK == SHGetDataFromIDList(lplvid->lpsf, reinterpret_cast<PCUITEMID_CHILD>(lplvid->pidl), SHGDFIL_FINDDATA, &fd, sizeof(WIN32_FIND_DATA));
+			const bool bFolder = haveData && (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY);
+			LPCWSTR pszExt = (haveData && !bFolder) ? PathFindExtension(fd.cFileName) : L"";
+			const bool bCacheable = DirList_IsCacheableExt(pszExt);
+
+			lvi.iImage = -1;
+			if (bCacheable) {
+				for (UINT i = 0; i < cCachedIcons; i++) {
+					if (StrCaseEqual(iconCache[i].szExt, pszExt)) {
+						lvi.iImage = iconCache[i].iIcon;
+						break;
+					}
+				}
+			}
+
+			if (lvi.iImage < 0) {
+				if (!lpshi || S_OK != lpshi->GetIconOf(reinterpret_cast<PCUITEMID_CHILD>(lplvid->pidl), GIL_FORSHELL, &lvi.iImage)) {
+					SHFILEINFO shfi;
+					LPITEMIDLIST pidl = IL_Create(lpdl->pidl, lpdl->cbidl, lplvid->pidl, 0);
+					SHGetFileInfo(reinterpret_cast<LPCWSTR>(pidl), 0, &shfi, sizeof(SHFILEINFO), SHGFI_PIDL | SHGFI_SYSICONINDEX | SHGFI_SMALLICON);
+					CoTaskMemFree(pidl);
+					lvi.iImage = shfi.iIcon;
+				}
+				if (bCacheable && cCachedIcons < DL_ICON_CACHE_SIZE && lstrlen(pszExt) < static_cast<int>(COUNTOF(iconCache->szExt))) {
+					iconCache[cCachedIcons].iIcon = lvi.iImage;
+					lstrcpy(iconCache[cCachedIcons].szExt, pszExt);
+					cCachedIcons++;
+				}
 			}
 
 			// It proved necessary to reset the state bits...
 			lvi.stateMask = 0;
 			lvi.state = 0;
 
-			DWORD dwAttributes = SFGAO_LINK | SFGAO_SHARE;
-			// Link and Share Overlay
-			lplvid->lpsf->GetAttributesOf(1, reinterpret_cast<PCUITEMID_CHILD_ARRAY>(&lplvid->pidl), &dwAttributes);
+			// Link and Share Overlay; shares are folders and links carry a
+			// link extension, so skip the shell query for plain files
+			if (!haveData || bFolder || StrCaseEqual(pszExt, L".lnk") || StrCaseEqual(pszExt, L".url")) {
+				DWORD dwAttributes = SFGAO_LINK | SFGAO_SHARE;
+				lplvid->lpsf->GetAttributesOf(1, reinterpret_cast<PCUITEMID_CHILD_ARRAY>(&lplvid->pidl), &dwAttributes);
 
-			if (dwAttributes & SFGAO_LINK) {
-				lvi.mask |= LVIF_STATE;
-				lvi.stateMask |= LVIS_OVERLAYMASK;
-				lvi.state |= INDEXTOOVERLAYMASK(2);
-			}
+				if (dwAttributes & SFGAO_LINK) {
+					lvi.mask |= LVIF_STATE;
+					lvi.stateMask |= LVIS_OVERLAYMASK;
+					lvi.state |= INDEXTOOVERLAYMASK(2);
+				}
 
-			if (dwAttributes & SFGAO_SHARE) {
-				lvi.mask |= LVIF_STATE;
-				lvi.stateMask |= LVIS_OVERLAYMASK;
-				lvi.state |= INDEXTOOVERLAYMASK(1);
+				if (dwAttributes & SFGAO_SHARE) {
+					lvi.mask |= LVIF_STATE;
+					lvi.stateMask |= LVIS_OVERLAYMASK;
+					lvi.state |= INDEXTOOVERLAYMASK(1);
+				}
 			}
 
 			// Fade hidden/system files
-			if (!lpdl->bNoFadeHidden) {
-				WIN32_FIND_DATA fd;
-				if (S_OK == SHGetDataFromIDList(lplvid->lpsf, reinterpret_cast<PCUITEMID_CHILD>(lplvid->pidl), SHGDFIL_FINDDATA, &fd, sizeof(WIN32_FIND_DATA))) {
-					if ((fd.dwFileAttributes & FILE_ATTRIBUTE_HIDDEN) || (fd.dwFileAttributes & FILE_ATTRIBUTE_SYSTEM)) {
-						lvi.mask |= LVIF_STATE;
-						lvi.stateMask |= LVIS_CUT;
-						lvi.state |= LVIS_CUT;
-					}
+			if (!lpdl->bNoFadeHidden && haveData) {
+				if ((fd.dwFileAttributes & FILE_ATTRIBUTE_HIDDEN) || (fd.dwFileAttributes & FILE_ATTRIBUTE_SYSTEM)) {
+					lvi.mask |= LVIF_STATE;
+					lvi.stateMask |= LVIS_CUT;
+					lvi.state |= LVIS_CUT;
 				}
 			}
 			lvi.iSubItem = 0;
@@ -438,6 +713,233 @@ BOOL DirList_Sort(HWND hwnd, int lFlags, bool fRev) noexcept {
 	return ListView_SortItems(hwnd, (fRev? DirList_CompareProcRw : DirList_CompareProcFw), lFlags);
 }
 
+//=============================================================================
+//
+//  DirList_StartWatch()
+//
+//  Watches the displayed directory with ReadDirectoryChangesW() so changes
+//  can be applied to the listview one item at a time instead of rebuilding
+//  the whole listing
+//
+#define DL_CHANGE_NOTIFY_FLAGS	(FILE_NOTIFY_CHANGE_FILE_NAME  | \
+								 FILE_NOTIFY_CHANGE_DIR_NAME   | \
+								 FILE_NOTIFY_CHANGE_ATTRIBUTES | \
+								 FILE_NOTIFY_CHANGE_SIZE | \
+								 FILE_NOTIFY_CHANGE_LAST_WRITE)
+
+static bool DirList_IssueChangeRead(DLDATA *lpdl) noexcept {
+	ResetEvent(lpdl->ovlChange.hEvent);
+	return ReadDirectoryChangesW(lpdl->hDirChange, lpdl->changeBuf, sizeof(lpdl->changeBuf), FALSE,
+								 DL_CHANGE_NOTIFY_FLAGS, nullptr, &lpdl->ovlChange, nullptr);
+}
+
+static void DirList_StopWatchData(DLDATA *lpdl) noexcept {
+	if (lpdl->hDirChange) {
+		CancelIo(lpdl->hDirChange);
+		CloseHandle(lpdl->hDirChange);
+		lpdl->hDirChange = nullptr;
+	}
+	if (lpdl->ovlChange.hEvent) {
+		CloseHandle(lpdl->ovlChange.hEvent);
+		lpdl->ovlChange.hEvent = nullptr;
+	}
+	if (lpdl->hChangeFallback && lpdl->hChangeFallback != INVALID_HANDLE_VALUE) {
+		FindCloseChangeNotification(lpdl->hChangeFallback);
+	}
+	lpdl->hChangeFallback = nullptr;
+}
+
+void DirList_StopWatch(HWND hwnd) noexcept {
+	DLDATA * const lpdl = static_cast<DLDATA *>(GetProp(hwnd, pDirListProp));
+	DirList_StopWatchData(lpdl);
+}
+
+bool DirList_StartWatch(HWND hwnd, LPCWSTR lpszDir) noexcept {
+	DLDATA * const lpdl = static_cast<DLDATA *>(GetProp(hwnd, pDirListProp));
+	DirList_StopWatchData(lpdl);
+
+	HANDLE hDir = CreateFile(lpszDir, FILE_LIST_DIRECTORY,
+							 FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+							 OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+	if (hDir != INVALID_HANDLE_VALUE) {
+		lpdl->hDirChange = hDir;
+		lpdl->ovlChange.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+		if (lpdl->ovlChange.hEvent != nullptr && DirList_IssueChangeRead(lpdl)) {
+			return true;
+		}
+		DirList_StopWatchData(lpdl);
+	}
+
+	// watch the old way and rebuild the whole listing on any change
+	lpdl->hChangeFallback = FindFirstChangeNotification(lpszDir, FALSE, DL_CHANGE_NOTIFY_FLAGS);
+	return false;
+}
+
+//=============================================================================
+//
+//  Removes the named item from the listview, returns true when it was listed
+//
+static bool DirList_RemoveChangedItem(HWND hwnd, LPCWSTR lpszFileName) noexcept {
+	const int count = ListView_GetItemCount(hwnd);
+	WIN32_FIND_DATA fd;
+	for (int i = 0; i < count; i++) {
+		if (DirList_GetItemEx(hwnd, i, &fd) >= 0 && StrCaseEqual(fd.cFileName, lpszFileName)) {
+			ListView_DeleteItem(hwnd, i);
+			return true;
+		}
+	}
+	return false;
+}
+
+//=============================================================================
+//
+//  Inserts the named item at the position keeping the current sort order,
+//  returns true when it passed the filter and was added to the listview
+//
+static bool DirList_InsertChangedItem(HWND hwnd, DLDATA *lpdl, LPCWSTR lpszFileName) {
+	WCHAR wszName[MAX_PATH];
+	lstrcpyn(wszName, lpszFileName, COUNTOF(wszName));
+
+	LPSHELLFOLDER lpsf = lpdl->lpsf;
+	PIDLIST_RELATIVE pidl = nullptr;
+	ULONG chParsed = 0;
+	ULONG dwAttributes = SFGAO_FILESYSTEM | SFGAO_FOLDER;
+	if (S_OK != lpsf->ParseDisplayName(hwnd, nullptr, wszName, &chParsed, &pidl, &dwAttributes)) {
+		return false;
+	}
+	if (!(dwAttributes & SFGAO_FILESYSTEM)) {
+		CoTaskMemFree(pidl);
+		return false;
+	}
+
+	lpdl->dls.Add(pidl, dwAttributes, lpszFileName);
+	// Check if item matches specified filter
+	if (!lpdl->dlf.MatchName((dwAttributes & SFGAO_FOLDER) ? FILE_ATTRIBUTE_DIRECTORY : 0, lpszFileName)) {
+		CoTaskMemFree(pidl);
+		return false;
+	}
+
+	LV_ITEMDATA *lplvid = static_cast<LV_ITEMDATA *>(CoTaskMemAlloc(sizeof(LV_ITEMDATA)));
+	lplvid->pidl = pidl;
+	lplvid->lpsf = lpsf;
+	lpsf->AddRef();
+
+	// Binary search for the position keeping the current sort order
+	const PFNLVCOMPARE pfnCompare = lpdl->fSortRev ? DirList_CompareProcRw : DirList_CompareProcFw;
+	int lo = 0;
+	int hi = ListView_GetItemCount(hwnd);
+	LV_ITEM lvi;
+	lvi.iSubItem = 0;
+	while (lo < hi) {
+		const int mid = lo + (hi - lo)/2;
+		lvi.mask = LVIF_PARAM;
+		lvi.iItem = mid;
+		ListView_GetItem(hwnd, &lvi);
+		if (pfnCompare(lvi.lParam, AsInteger<LPARAM>(lplvid), lpdl->iSortFlags) < 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	lvi.mask = LVIF_TEXT | LVIF_IMAGE | LVIF_PARAM;
+	lvi.iItem = lo;
+	lvi.pszText = LPSTR_TEXTCALLBACK;
+	lvi.cchTextMax = MAX_PATH;
+	// Setup default Icon - Folder or File
+	lvi.iImage = (dwAttributes & SFGAO_FOLDER) ? lpdl->iDefIconFolder : lpdl->iDefIconFile;
+	lvi.lParam = AsInteger<LPARAM>(lplvid);
+	ListView_InsertItem(hwnd, &lvi);
+	return true;
+}
+
+//=============================================================================
+//
+//  DirList_ProcessChanges()
+//
+//  Applies the changes recorded by the directory watcher to the listview.
+//  Returns the number of items added or removed, or -1 when the caller has
+//  to rebuild the whole listing
+//
+int DirList_ProcessChanges(HWND hwnd) {
+	DLDATA * const lpdl = static_cast<DLDATA *>(GetProp(hwnd, pDirListProp));
+	if (lpdl == nullptr || lpdl->lpsf == nullptr || lpdl->lpe != nullptr) {
+		// no directory yet, or DirList_FillThread() is still streaming:
+		// leave the records pending until the listing has settled
+		return 0;
+	}
+
+	if (lpdl->hDirChange == nullptr) {
+		if (lpdl->hChangeFallback != nullptr && lpdl->hChangeFallback != INVALID_HANDLE_VALUE
+			&& WAIT_OBJECT_0 == WaitForSingleObject(lpdl->hChangeFallback, 0)) {
+			FindNextChangeNotification(lpdl->hChangeFallback);
+			return -1;
+		}
+		return 0;
+	}
+
+	if (WAIT_OBJECT_0 != WaitForSingleObject(lpdl->ovlChange.hEvent, 0)) {
+		return 0;
+	}
+
+	DWORD cbRead = 0;
+	if (!GetOverlappedResult(lpdl->hDirChange, &lpdl->ovlChange, &cbRead, FALSE)) {
+		DirList_StopWatchData(lpdl);
+		return -1;
+	}
+
+	// zero bytes: the burst overflowed the buffer and changes were lost
+	int applied = (cbRead == 0) ? -1 : 0;
+	const BYTE *pRecord = lpdl->changeBuf;
+	while (applied >= 0) {
+		const FILE_NOTIFY_INFORMATION * const pfni = reinterpret_cast<const FILE_NOTIFY_INFORMATION *>(pRecord);
+		WCHAR wszName[MAX_PATH];
+		const DWORD cchName = pfni->FileNameLength / sizeof(WCHAR);
+		if (cchName >= COUNTOF(wszName)) {
+			applied = -1;
+			break;
+		}
+		memcpy(wszName, pfni->FileName, pfni->FileNameLength);
+		wszName[cchName] = L'\0';
+
+		switch (pfni->Action) {
+		case FILE_ACTION_ADDED:
+		case FILE_ACTION_RENAMED_NEW_NAME:
+			// drop a stale entry first: the item may have been picked up
+			// by an enumeration that ran after the change was recorded
+			DirList_RemoveChangedItem(hwnd, wszName);
+			lpdl->dls.Remove(wszName);
+			if (DirList_InsertChangedItem(hwnd, lpdl, wszName)) {
+				applied++;
+			}
+			break;
+
+		case FILE_ACTION_REMOVED:
+		case FILE_ACTION_RENAMED_OLD_NAME:
+			lpdl->dls.Remove(wszName);
+			if (DirList_RemoveChangedItem(hwnd, wszName)) {
+				applied++;
+			}
+			break;
+
+		default:
+			// FILE_ACTION_MODIFIED: neither size nor time is displayed
+			break;
+		}
+
+		if (pfni->NextEntryOffset == 0) {
+			break;
+		}
+		pRecord += pfni->NextEntryOffset;
+	}
+
+	if (!DirList_IssueChangeRead(lpdl)) {
+		DirList_StopWatchData(lpdl);
+		return -1;
+	}
+	return applied;
+}
+
 //=============================================================================
 //
 //  DirList_GetItem()
@@ -716,9 +1218,21 @@ bool DirListFilter::Match(LPSHELLFOLDER lpsf, LPCITEMIDLIST pidl) const noexcept
 
 	WIN32_FIND_DATA fd;
 	SHGetDataFromIDList(lpsf, reinterpret_cast<PCUITEMID_CHILD>(pidl), SHGDFIL_FINDDATA, &fd, sizeof(WIN32_FIND_DATA));
+	return MatchName(fd.dwFileAttributes, fd.cFileName);
+}
+
+//=============================================================================
+//
+//  Check if a file name matches a given filter; split out of Match() so the
+//  name cached in the directory snapshot can be matched without the shell
+//
+bool DirListFilter::MatchName(DWORD dwFileAttributes, LPCWSTR lpszFileName) const noexcept {
+	if (nCount == 0 && !bExcludeFilter) {
+		return true;
+	}
 
 	// All the directories are added
-	if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+	if (dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
 		return true;
 	}
 
@@ -729,7 +1243,7 @@ bool DirListFilter::Match(LPSHELLFOLDER lpsf, LPCITEMIDLIST pidl) const noexcept
 
 	for (int i = 0; i < nCount; i++) {
 		if (*pFilter[i]) { // Filters like L"\0" are ignored
-			const BOOL bMatchSpec = PathMatchSpec(fd.cFileName, pFilter[i]);
+			const BOOL bMatchSpec = PathMatchSpec(lpszFileName, pFilter[i]);
 			if (bMatchSpec) {
 				return !bExcludeFilter;
 			}
@@ -749,8 +1263,20 @@ bool DirListFilter::Match(LPSHELLFOLDER lpsf, LPCITEMIDLIST pidl) const noexcept
 struct DC_ITEMDATA {
 	LPITEMIDLIST pidl;
 	LPSHELLFOLDER lpsf;
+	int iIcon;					// System image list index, resolved on the Fill Thread
+	WCHAR szName[64];			// Display name, resolved on the Fill Thread
+	WCHAR szRoot[MAX_PATH];		// Parsing path, resolved on the Fill Thread
 };
 
+// Stamps the fill in flight, a worker stuck on a dead network drive keeps
+// running detached but its remaining items are discarded
+static struct {
+	HWND hwnd;
+	volatile LONG generation;
+} driveBoxFill;
+
+static DWORD WINAPI DriveBox_FillThread(LPVOID lpParam);
+
 //=============================================================================
 //
 //  DriveBox_Init()
@@ -770,11 +1296,31 @@ bool DriveBox_Init(HWND hwnd) noexcept {
 //
 //  DriveBox_Fill
 //
-int DriveBox_Fill(HWND hwnd) {
-	// Init ComboBox
-	SendMessage(hwnd, WM_SETREDRAW, 0, 0);
+//  Enumerating [My Computer] resolves every mapped network drive and can
+//  block for the full SMB timeout when a server is gone, so the shell
+//  enumeration runs on a worker thread that streams each drive into the
+//  combo box as it resolves.  DVN_DRIVESFILLED is posted to the parent
+//  window once the enumeration has finished.
+//
+void DriveBox_Fill(HWND hwnd) noexcept {
 	ComboBox_ResetContent(hwnd);
 
+	driveBoxFill.hwnd = hwnd;
+	const LONG generation = InterlockedIncrement(&driveBoxFill.generation);
+	HANDLE thread = CreateThread(nullptr, 0, DriveBox_FillThread, AsPointer<LPVOID>(static_cast<LONG_PTR>(generation)), 0, nullptr);
+	if (thread) {
+		CloseHandle(thread);
+	}
+}
+
+//=============================================================================
+//
+//  DriveBox_InsertItem()
+//
+//  Inserts a fully resolved drive at its sorted position, called from the
+//  Fill Thread so the SendMessage() calls marshal to the UI thread
+//
+static bool DriveBox_InsertItem(HWND hwnd, DC_ITEMDATA *lpdcid) noexcept {
 	COMBOBOXEXITEM cbei;
 	memset(&cbei, 0, sizeof(COMBOBOXEXITEM));
 	cbei.mask = CBEIF_TEXT | CBEIF_IMAGE | CBEIF_SELECTEDIMAGE | CBEIF_LPARAM;
@@ -783,6 +1329,40 @@ int DriveBox_Fill(HWND hwnd) {
 	cbei.iImage = I_IMAGECALLBACK;
 	cbei.iSelectedImage = I_IMAGECALLBACK;
 
+	// Insert sorted ...
+	COMBOBOXEXITEM cbei2;
+	cbei2.mask = CBEIF_LPARAM;
+	cbei2.iItem = 0;
+
+	while ((SendMessage(hwnd, CBEM_GETITEM, 0, AsInteger<LPARAM>(&cbei2)))) {
+		const DC_ITEMDATA * const lpdcid2 = AsPointer<const DC_ITEMDATA *>(cbei2.lParam);
+		const HRESULT hr = lpdcid->lpsf->CompareIDs(0, reinterpret_cast<PCUIDLIST_RELATIVE>(lpdcid->pidl), reinterpret_cast<PCUIDLIST_RELATIVE>(lpdcid2->pidl));
+
+		if (static_cast<short>(HRESULT_CODE(hr)) < 0) {
+			break;
+		}
+		cbei2.iItem++;
+	}
+
+	cbei.iItem = cbei2.iItem;
+	cbei.lParam = AsInteger<LPARAM>(lpdcid);
+	return SendMessage(hwnd, CBEM_INSERTITEM, 0, AsInteger<LPARAM>(&cbei)) >= 0;
+}
+
+//=============================================================================
+//
+//  DriveBox_FillThread()
+//
+//  Thread to enumerate the contents of [My Computer] and stream the drives
+//  into the combo box.  Display name, parsing path and icon are resolved
+//  here and cached in the itemdata so no UI thread path ever touches the
+//  network again.
+//
+static DWORD WINAPI DriveBox_FillThread(LPVOID lpParam) {
+	const LONG generation = static_cast<LONG>(AsInteger<LONG_PTR>(lpParam));
+	HWND hwnd = driveBoxFill.hwnd;
+	int cDrives = 0;
+
 	// Get pidl to [My Computer]
 	PIDLIST_ABSOLUTE pidl;
 #if _WIN32_WINNT >= _WIN32_WINNT_VISTA
@@ -800,10 +1380,11 @@ int DriveBox_Fill(HWND hwnd) {
 				// Create an Enumeration object for lpsf
 				constexpr DWORD grfFlags = SHCONTF_FOLDERS;
 				LPENUMIDLIST lpe;
-				if (S_OK == lpsf->EnumObjects(hwnd, grfFlags, &lpe)) {
+				if (S_OK == lpsf->EnumObjects(nullptr, grfFlags, &lpe)) {
 					// Enumerate the contents of [My Computer]
 					PITEMID_CHILD pidlEntry;
 					while (S_OK == lpe->Next(1, &pidlEntry, nullptr)) {
+						bool keep = false;
 						// Add item to the List if it is part of the
 						// Filesystem
 						ULONG dwAttributes = SFGAO_FILESYSTEM;
@@ -812,7 +1393,7 @@ int DriveBox_Fill(HWND hwnd) {
 						if (dwAttributes & SFGAO_FILESYSTEM) {
 							// Windows XP: check if pidlEntry is a drive
 							SHDESCRIPTIONID di;
-							HRESULT hr = SHGetDataFromIDList(lpsf, pidlEntry, SHGDFIL_DESCRIPTIONID, &di, sizeof(SHDESCRIPTIONID));
+							const HRESULT hr = SHGetDataFromIDList(lpsf, pidlEntry, SHGDFIL_DESCRIPTIONID, &di, sizeof(SHDESCRIPTIONID));
 							if (hr != S_OK || (di.dwDescriptionId >= SHDID_COMPUTER_DRIVE35 && di.dwDescriptionId <= SHDID_COMPUTER_OTHER)) {
 								DC_ITEMDATA * const lpdcid = static_cast<DC_ITEMDATA *>(CoTaskMemAlloc(sizeof(DC_ITEMDATA)));
 								//lpdcid->pidl = IL_Copy(pidlEntry);
@@ -820,28 +1401,28 @@ int DriveBox_Fill(HWND hwnd) {
 								lpdcid->lpsf = lpsf;
 								lpsf->AddRef();
 
-								// Insert sorted ...
-								{
-									COMBOBOXEXITEM cbei2;
-									cbei2.mask = CBEIF_LPARAM;
-									cbei2.iItem = 0;
-
-									while ((SendMessage(hwnd, CBEM_GETITEM, 0, AsInteger<LPARAM>(&cbei2)))) {
-										const LV_ITEMDATA * const lpdcid2 = AsPointer<const LV_ITEMDATA *>(cbei2.lParam);
-										hr = lpdcid->lpsf->CompareIDs(0, reinterpret_cast<PCUIDLIST_RELATIVE>(lpdcid->pidl), reinterpret_cast<PCUIDLIST_RELATIVE>(lpdcid2->pidl));
-
-										if (static_cast<short>(HRESULT_CODE(hr)) < 0) {
-											break;
-										}
-										cbei2.iItem++;
-									}
-
-									cbei.iItem = cbei2.iItem;
-									cbei.lParam = AsInteger<LPARAM>(lpdcid);
-									SendMessage(hwnd, CBEM_INSERTITEM, 0, AsInteger<LPARAM>(&cbei));
+								// Resolving the label and icon of a dead
+								// network drive is what blocks, do it here
+								IL_GetDisplayName(lpsf, pidlEntry, SHGDN_NORMAL, lpdcid->szName, COUNTOF(lpdcid->szName));
+								IL_GetDisplayName(lpsf, pidlEntry, SHGDN_FORPARSING, lpdcid->szRoot, COUNTOF(lpdcid->szRoot));
+								SHFILEINFO shfi;
+								shfi.iIcon = 0;
+								SHGetFileInfo(lpdcid->szRoot, 0, &shfi, sizeof(SHFILEINFO), SHGFI_SYSICONINDEX | SHGFI_SMALLICON);
+								lpdcid->iIcon = shfi.iIcon;
+
+								keep = generation == driveBoxFill.generation && DriveBox_InsertItem(hwnd, lpdcid);
+								if (keep) {
+									cDrives++;
+								} else {
+									// superseded by a newer fill, or the combo box is gone
+									lpdcid->lpsf->Release();
+									CoTaskMemFree(lpdcid);
 								}
 							}
 						}
+						if (!keep) {
+							CoTaskMemFree(pidlEntry);
+						}
 					} // IEnumIDList::Next()
 
 					lpe->Release();
@@ -855,9 +1436,10 @@ int DriveBox_Fill(HWND hwnd) {
 		lpsfDesktop->Release();
 	} // SHGetKnownFolderIDList()
 
-	SendMessage(hwnd, WM_SETREDRAW, 1, 0);
-	// Return number of items added to combo box
-	return ComboBox_GetCount(hwnd);
+	if (generation == driveBoxFill.generation) {
+		PostMessage(GetParent(hwnd), DVN_DRIVESFILLED, cDrives, 0);
+	}
+	return 0;
 }
 
 //=============================================================================
@@ -878,8 +1460,8 @@ bool DriveBox_GetSelDrive(HWND hwnd, LPWSTR lpszDrive, int nDrive, bool fNoSlash
 	SendMessage(hwnd, CBEM_GETITEM, 0, AsInteger<LPARAM>(&cbei));
 	const DC_ITEMDATA * const lpdcid = AsPointer<const DC_ITEMDATA *>(cbei.lParam);
 
-	// Get File System Path for Drive
-	IL_GetDisplayName(lpdcid->lpsf, lpdcid->pidl, SHGDN_FORPARSING, lpszDrive, nDrive);
+	// Get File System Path for Drive, cached by the Fill Thread
+	lstrcpyn(lpszDrive, lpdcid->szRoot, nDrive);
 
 	// Remove Backslash if required (makes Drive relative!!!)
 	if (fNoSlash) {
@@ -904,17 +1486,13 @@ bool DriveBox_SelectDrive(HWND hwnd, LPCWSTR lpszPath) {
 	cbei.mask = CBEIF_LPARAM;
 
 	for (int i = 0; i < cbItems; i++) {
-		WCHAR szRoot[64] = L"";
 		// Get DC_ITEMDATA* of Item i
 		cbei.iItem = i;
 		SendMessage(hwnd, CBEM_GETITEM, 0, AsInteger<LPARAM>(&cbei));
 		const DC_ITEMDATA * const lpdcid = AsPointer<const DC_ITEMDATA *>(cbei.lParam);
 
-		// Get File System Path for Drive
-		IL_GetDisplayName(lpdcid->lpsf, lpdcid->pidl, SHGDN_FORPARSING, szRoot, COUNTOF(szRoot));
-
 		// Compare Root Directory with Path
-		if (PathIsSameRoot(lpszPath, szRoot)) {
+		if (PathIsSameRoot(lpszPath, lpdcid->szRoot)) {
 			// Select matching Drive
 			ComboBox_SetCurSel(hwnd, i);
 			return true;
@@ -1007,19 +1585,15 @@ bool DriveBox_GetDispInfo(HWND hwnd, LPARAM lParam) {
 		return false;
 	}
 
-	// Get Display Name
+	// Get Display Name, cached by the Fill Thread
 	if (lpnmcbe->ceItem.mask & CBEIF_TEXT) {
-		IL_GetDisplayName(lpdcid->lpsf, lpdcid->pidl, SHGDN_NORMAL, lpnmcbe->ceItem.pszText, lpnmcbe->ceItem.cchTextMax);
+		lstrcpyn(lpnmcbe->ceItem.pszText, lpdcid->szName, lpnmcbe->ceItem.cchTextMax);
 	}
 
-	// Get Icon Index
+	// Get Icon Index, cached by the Fill Thread
 	if (lpnmcbe->ceItem.mask & (CBEIF_IMAGE | CBEIF_SELECTEDIMAGE)) {
-		WCHAR szTemp[MAX_PATH];
-		SHFILEINFO shfi;
-		IL_GetDisplayName(lpdcid->lpsf, lpdcid->pidl, SHGDN_FORPARSING, szTemp, MAX_PATH);
-		SHGetFileInfo(szTemp, 0, &shfi, sizeof(SHFILEINFO), SHGFI_SYSICONINDEX | SHGFI_SMALLICON);
-		lpnmcbe->ceItem.iImage = shfi.iIcon;
-		lpnmcbe->ceItem.iSelectedImage = shfi.iIcon;
+		lpnmcbe->ceItem.iImage = lpdcid->iIcon;
+		lpnmcbe->ceItem.iSelectedImage = lpdcid->iIcon;
 	}
 
 	// Set values
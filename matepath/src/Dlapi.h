@@ -27,14 +27,21 @@ struct LV_ITEMDATA {
 void DirList_Init(HWND hwnd) noexcept;
 void DirList_Destroy(HWND hwnd);
 void DirList_StartIconThread(HWND hwnd) noexcept;
+bool DirList_StartWatch(HWND hwnd, LPCWSTR lpszDir) noexcept;
+void DirList_StopWatch(HWND hwnd) noexcept;
+int DirList_ProcessChanges(HWND hwnd);
 
 #define DL_FOLDERS      32
 #define DL_NONFOLDERS   64
 #define DL_INCLHIDDEN  128
 #define DL_ALLOBJECTS  (DL_FOLDERS | DL_NONFOLDERS | DL_INCLHIDDEN)
+// Posted to the parent window when a streamed DirList_Fill() has finished,
+// wParam is the final number of items in the control
+#define DLN_ITEMSFILLED	(WM_APP + 5)
 int DirList_Fill(HWND hwnd, LPCWSTR lpszDir, DWORD grfFlags, LPCWSTR lpszFileSpec,
 				 bool bExcludeFilter, bool bNoFadeHidden,
 				 int iSortFlags, bool fSortRev);
+int DirList_ReFilter(HWND hwnd, LPCWSTR lpszFileSpec, bool bExcludeFilter);
 DWORD WINAPI DirList_IconThread(LPVOID lpParam);
 bool DirList_GetDispInfo(HWND hwnd, LPARAM lParam);
 bool DirList_DeleteItem(HWND hwnd, LPARAM lParam);
@@ -78,10 +85,14 @@ struct DirListFilter {
 	LPWSTR pFilter[DL_FILTER_BUFSIZE];
 	void Create(LPCWSTR lpszFileSpec, bool bExclude) noexcept;
 	bool Match(LPSHELLFOLDER lpsf, LPCITEMIDLIST pidl) const noexcept;
+	bool MatchName(DWORD dwFileAttributes, LPCWSTR lpszFileName) const noexcept;
 };
 
+// Posted to the parent window when a streamed DriveBox_Fill() has finished,
+// wParam is the number of drives added to the combo box
+#define DVN_DRIVESFILLED	(WM_APP + 6)
 bool DriveBox_Init(HWND hwnd) noexcept;
-int  DriveBox_Fill(HWND hwnd);
+void DriveBox_Fill(HWND hwnd) noexcept;
 bool DriveBox_GetSelDrive(HWND hwnd, LPWSTR lpszDrive, int nDrive, bool fNoSlash);
 bool DriveBox_SelectDrive(HWND hwnd, LPCWSTR lpszPath);
 bool DriveBox_PropertyDlg(HWND hwnd);
@@ -74,7 +74,6 @@ HWND	hwndMain;
 static HICON hTrayIcon = nullptr;
 static UINT uTrayIconDPI = 0;
 
-static HANDLE hChangeHandle = nullptr;
 HistoryList	mHistory;
 
 WCHAR	szIniFile[MAX_PATH] = L"";
@@ -516,7 +515,6 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT umsg, WPARAM wParam, LPARAM lParam)
 		if (!bShutdownOK) {
 			// Terminate directory watching
 			KillTimer(hwnd, ID_TIMER);
-			FindCloseChangeNotification(hChangeHandle);
 
 			DirList_Destroy(hwndDirList);
 			DragAcceptFiles(hwnd, FALSE);
@@ -583,24 +581,28 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT umsg, WPARAM wParam, LPARAM lParam)
 	}
 	return DefWindowProc(hwnd, umsg, wParam, lParam);
 
-	case WM_TIMER:
-		// Check Change Notification Handle
-		if (WAIT_OBJECT_0 == WaitForSingleObject(hChangeHandle, 0)) {
+	case WM_TIMER: {
+		// Apply pending directory changes item by item
+		const int iChanges = DirList_ProcessChanges(hwndDirList);
+		if (iChanges < 0) {
+			// watcher lost track of the directory -- rebuild the listing
 			// Store information about currently selected item
 			DirListItem dli;
 			dli.mask = DLI_ALL;
 			dli.ntype = DLE_NONE;
 			DirList_GetItem(hwndDirList, -1, &dli);
 
-			FindNextChangeNotification(hChangeHandle);
 			SendWMCommand(hwnd, IDM_VIEW_UPDATE);
 
 			// must use SendMessage() !!
 			if (dli.ntype != DLE_NONE) {
 				DirList_SelectItem(hwndDirList, dli.szDisplayName, dli.szFileName);
 			}
+		} else if (iChanges > 0) {
+			SendMessage(hwnd, DLN_ITEMSFILLED, ListView_GetItemCount(hwndDirList), 0);
 		}
-		break;
+	}
+	break;
 
 	case WM_SIZE:
 		MsgSize(hwnd, wParam, lParam);
@@ -764,6 +766,27 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT umsg, WPARAM wParam, LPARAM lParam)
 	}
 	break;
 
+	case DLN_ITEMSFILLED: {
+		// a streamed DirList_Fill() has finished, update the item count
+		const int cItems = static_cast<int>(wParam);
+		WCHAR tch[256];
+		WCHAR tchnum[64];
+		FormatNumber(tchnum, cItems);
+		WCHAR fmt[64];
+		FormatString(tch, fmt, HasFilter() ? IDS_NUMFILES_FILTER : IDS_NUMFILES, tchnum);
+		StatusSetText(hwndStatus, ID_FILEINFO, tch);
+
+		if (cItems > 0 && ListView_GetNextItem(hwndDirList, -1, LVNI_FOCUSED) < 0) {
+			ListView_SetItemState(hwndDirList, 0, LVIS_FOCUSED, LVIS_FOCUSED);
+		}
+	}
+	break;
+
+	case DVN_DRIVESFILLED:
+		// a streamed DriveBox_Fill() has finished, select the current drive
+		DriveBox_SelectDrive(hwndDriveBox, szCurDir);
+		break;
+
 	default:
 		if (umsg == msgTaskbarCreated) {
 			if (!IsWindowVisible(hwnd)) {
@@ -1544,17 +1567,17 @@ LRESULT MsgCommand(HWND hwnd, WPARAM wParam, LPARAM lParam) {
 		SHFileOperation(&shfos);
 
 		// Check if there are any changes in the directory, then update!
-		if (WAIT_OBJECT_0 == WaitForSingleObject(hChangeHandle, 0)) {
-
-			SendWMCommand(hwnd, IDM_VIEW_UPDATE);
+		const int iChanges = DirList_ProcessChanges(hwndDirList);
+		if (iChanges != 0) {
+			if (iChanges < 0) {
+				SendWMCommand(hwnd, IDM_VIEW_UPDATE);
+			}
 			if (iItem > 0) {
 				iItem--;
 			}
 			iItem = min(iItem, ListView_GetItemCount(hwndDirList) - 1);
 			ListView_SetItemState(hwndDirList, iItem, LVIS_FOCUSED, LVIS_FOCUSED);
 			ListView_EnsureVisible(hwndDirList, iItem, FALSE);
-
-			FindNextChangeNotification(hChangeHandle);
 		}
 	}
 	break;
@@ -1654,7 +1677,21 @@ LRESULT MsgCommand(HWND hwnd, WPARAM wParam, LPARAM lParam) {
 			dli.ntype = DLE_NONE;
 			DirList_GetItem(hwndDirList, -1, &dli);
 
-			SendWMCommand(hwnd, IDM_VIEW_UPDATE);
+			if (HasFilter()) {
+				ListView_SetTextColor(hwndDirList, (bDefColorFilter) ? GetSysColor(COLOR_WINDOWTEXT) : colorFilter);
+			} else {
+				ListView_SetTextColor(hwndDirList, (bDefColorNoFilter) ? GetSysColor(COLOR_WINDOWTEXT) : colorNoFilter);
+			}
+
+			// Re-apply the filter against the directory snapshot; fall back
+			// to a full refresh when the snapshot isn't complete yet
+			const int cItems = DirList_ReFilter(hwndDirList, tchFilter, bNegFilter);
+			if (cItems < 0) {
+				SendWMCommand(hwnd, IDM_VIEW_UPDATE);
+			} else {
+				DirList_StartIconThread(hwndDirList);
+				SendMessage(hwnd, DLN_ITEMSFILLED, cItems, 0);
+			}
 
 			if (dli.ntype != DLE_NONE) {
 				if (!DirList_SelectItem(hwndDirList, dli.szDisplayName, dli.szFileName)) {
@@ -1676,7 +1713,15 @@ LRESULT MsgCommand(HWND hwnd, WPARAM wParam, LPARAM lParam) {
 			dli.ntype = DLE_NONE;
 			DirList_GetItem(hwndDirList, -1, &dli);
 
-			SendWMCommand(hwnd, IDM_VIEW_UPDATE);
+			ListView_SetTextColor(hwndDirList, (bDefColorNoFilter) ? GetSysColor(COLOR_WINDOWTEXT) : colorNoFilter);
+
+			const int cItems = DirList_ReFilter(hwndDirList, tchFilter, bNegFilter);
+			if (cItems < 0) {
+				SendWMCommand(hwnd, IDM_VIEW_UPDATE);
+			} else {
+				DirList_StartIconThread(hwndDirList);
+				SendMessage(hwnd, DLN_ITEMSFILLED, cItems, 0);
+			}
 
 			if (dli.ntype != DLE_NONE) {
 				if (!DirList_SelectItem(hwndDirList, dli.szDisplayName, dli.szFileName)) {
@@ -2334,17 +2379,12 @@ bool ChangeDirectory(HWND hwnd, LPCWSTR lpszNewDir, bool bUpdateHistory) {
 			ListView_EnsureVisible(hwndDirList, iTopItem, TRUE);
 		}
 
-		// setup new change notification handle
-		FindCloseChangeNotification(hChangeHandle);
-		hChangeHandle = FindFirstChangeNotification(szCurDir, FALSE,
-						FILE_NOTIFY_CHANGE_FILE_NAME  | \
-						FILE_NOTIFY_CHANGE_DIR_NAME   | \
-						FILE_NOTIFY_CHANGE_ATTRIBUTES | \
-						FILE_NOTIFY_CHANGE_SIZE | \
-						FILE_NOTIFY_CHANGE_LAST_WRITE);
+		// setup directory watching for the new directory
+		DirList_StartWatch(hwndDirList, szCurDir);
 
+		// streams the drives in from a worker thread,
+		// the current drive is selected on DVN_DRIVESFILLED
 		DriveBox_Fill(hwndDriveBox);
-		DriveBox_SelectDrive(hwndDriveBox, szCurDir);
 
 		WCHAR tch[256];
 		WCHAR tchnum[64];
@@ -3619,6 +3659,53 @@ void LoadLaunchSetings() noexcept {
 	bLoadLaunchSetingsLoaded = true;
 }
 
+//=============================================================================
+//
+//  PrefetchFile()
+//
+//  Warms the system file cache for the file about to be opened, overlapped
+//  with activating the target application: by the time the editor reads the
+//  file its contents no longer wait on the disk
+//
+#define PREFETCH_FILE_MAX_SIZE	(16*1024*1024)
+
+static DWORD WINAPI PrefetchFileThread(LPVOID lpParam) noexcept {
+	LPWSTR const lpszPath = static_cast<LPWSTR>(lpParam);
+	HANDLE hFile = CreateFile(lpszPath, GENERIC_READ,
+							  FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+							  OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (hFile != INVALID_HANDLE_VALUE) {
+		char buf[64*1024];
+		DWORD cbRead = 0;
+		DWORD cbTotal = 0;
+		while (ReadFile(hFile, buf, sizeof(buf), &cbRead, nullptr) && cbRead != 0) {
+			cbTotal += cbRead;
+			if (cbTotal >= PREFETCH_FILE_MAX_SIZE) {
+				break;
+			}
+		}
+		CloseHandle(hFile);
+	}
+	LocalFree(lpszPath);
+	return 0;
+}
+
+static void PrefetchFile(LPCWSTR lpszPath) noexcept {
+	if (StrIsEmpty(lpszPath) || PathIsDirectory(lpszPath)) {
+		return;
+	}
+	LPWSTR const path = StrDup(lpszPath);
+	if (path == nullptr) {
+		return;
+	}
+	HANDLE hThread = CreateThread(nullptr, 0, PrefetchFileThread, path, 0, nullptr);
+	if (hThread != nullptr) {
+		CloseHandle(hThread);
+	} else {
+		LocalFree(path);
+	}
+}
+
 void LaunchTarget(LPCWSTR lpFileName, bool bOpenNew) {
 	if (!bLoadLaunchSetingsLoaded) {
 		LoadLaunchSetings();
@@ -3629,6 +3716,12 @@ void LaunchTarget(LPCWSTR lpFileName, bool bOpenNew) {
 		return;
 	}
 
+	if (StrNotEmpty(lpFileName)) {
+		// start faulting the file into the cache while the window comes forward
+		WCHAR szLnk[MAX_PATH];
+		PrefetchFile(PathGetLnkPath(lpFileName, szLnk) ? szLnk : lpFileName);
+	}
+
 	if (iUseTargetApplication != UseTargetApplication_None && iTargetApplicationMode == TargetApplicationMode_SendMsg) {
 		HWND hwnd = nullptr;
 		if (!bOpenNew) { // hwnd == nullptr
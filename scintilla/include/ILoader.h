@@ -19,6 +19,17 @@ public:
 	virtual void * SCI_METHOD ConvertToDocument() noexcept = 0;
 };
 
+/** Immutable snapshot of a document's bytes, made with SCI_CREATESNAPSHOT,
+ * for reading from a background thread while the owning view continues
+ * editing. AddRef() and Release() may be called from any thread. */
+class ITextSnapshot {
+public:
+	virtual int SCI_METHOD AddRef() noexcept = 0;
+	virtual int SCI_METHOD Release() noexcept = 0;
+	virtual Sci_Position SCI_METHOD Length() const noexcept = 0;
+	virtual const char * SCI_METHOD Data() const noexcept = 0;
+};
+
 static constexpr int deRelease0 = 0;
 
 class IDocumentEditable {
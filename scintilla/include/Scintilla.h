@@ -16,6 +16,9 @@ void Scintilla_LoadDpiForWindow(void);
 /* Return false on failure: */
 int Scintilla_RegisterClasses(void *hInstance);
 int Scintilla_ReleaseResources(void);
+/* Persisted DirectWrite font metrics cache: */
+void Scintilla_LoadFontMetricsCache(const wchar_t *path);
+void Scintilla_SaveFontMetricsCache(const wchar_t *path);
 #endif
 
 }
@@ -88,6 +91,7 @@ typedef sptr_t (*SciFnDirectStatus)(sptr_t ptr, unsigned int iMessage, uptr_t wP
 #define SCI_CONVERTEOLS 2029
 #define SCI_GETEOLMODE 2030
 #define SCI_SETEOLMODE 2031
+#define SCI_GETLINEENDCOUNTS 2822
 #define SCI_STARTSTYLING 2032
 #define SCI_SETSTYLING 2033
 #define SCI_GETBUFFEREDDRAW 2034
@@ -177,6 +181,7 @@ typedef sptr_t (*SciFnDirectStatus)(sptr_t ptr, unsigned int iMessage, uptr_t wP
 #define SCI_MARKERPREVIOUS 2048
 #define SCI_MARKERDEFINEPIXMAP 2049
 #define SCI_MARKERADDSET 2466
+#define SCI_MARKERADDLIST 2819
 #define SCI_MARKERGETLAYER 2734
 #define SCI_MARKERSETLAYER 2735
 #define SC_MAX_MARGIN 4
@@ -347,6 +352,7 @@ typedef sptr_t (*SciFnDirectStatus)(sptr_t ptr, unsigned int iMessage, uptr_t wP
 #define SCI_GETCHARACTERCATEGORYOPTIMIZATION 2721
 #define SCI_BEGINUNDOACTION 2078
 #define SCI_ENDUNDOACTION 2079
+#define SCI_EXECUTEBATCH 2815
 #define SCI_GETUNDOSEQUENCE 2799
 #define SCI_GETUNDOACTIONS 2790
 #define SCI_SETUNDOSAVEPOINT 2791
@@ -659,6 +665,7 @@ typedef sptr_t (*SciFnDirectStatus)(sptr_t ptr, unsigned int iMessage, uptr_t wP
 #define SC_IDLESTYLING_ALL 3
 #define SCI_SETIDLESTYLING 2692
 #define SCI_GETIDLESTYLING 2693
+#define SCI_SETIDLESTYLINGBUDGET 2821
 #define SC_WRAP_NONE 0
 #define SC_WRAP_WORD 1
 #define SC_WRAP_CHAR 2
@@ -691,6 +698,11 @@ typedef sptr_t (*SciFnDirectStatus)(sptr_t ptr, unsigned int iMessage, uptr_t wP
 #define SC_CACHE_DOCUMENT 3
 #define SCI_SETLAYOUTCACHE 2272
 #define SCI_GETLAYOUTCACHE 2273
+#define SCI_SETLAYOUTCACHEBUDGET 2817
+#define SCI_GETLAYOUTCACHESTATS 2818
+#define SCI_GETMEMORYUSAGE 2820
+#define SCI_SETPAINTPROFILER 2823
+#define SCI_GETPAINTPROFILER 2824
 #define SCI_SETSCROLLWIDTH 2274
 #define SCI_GETSCROLLWIDTH 2275
 #define SCI_SETSCROLLWIDTHTRACKING 2516
@@ -971,6 +983,7 @@ typedef sptr_t (*SciFnDirectStatus)(sptr_t ptr, unsigned int iMessage, uptr_t wP
 #define SCI_SETINDICATORVALUE 2502
 #define SCI_GETINDICATORVALUE 2503
 #define SCI_INDICATORFILLRANGE 2504
+#define SCI_INDICATORFILLLIST 2825
 #define SCI_INDICATORCLEARRANGE 2505
 #define SCI_INDICATORALLONFOR 2506
 #define SCI_INDICATORVALUEAT 2507
@@ -1104,6 +1117,7 @@ typedef sptr_t (*SciFnDirectStatus)(sptr_t ptr, unsigned int iMessage, uptr_t wP
 #define SCI_SETTECHNOLOGY 2630
 #define SCI_GETTECHNOLOGY 2631
 #define SCI_CREATELOADER 2632
+#define SCI_CREATESNAPSHOT 2816
 #define SCI_FINDINDICATORSHOW 2640
 #define SCI_FINDINDICATORFLASH 2641
 #define SCI_FINDINDICATORHIDE 2642
@@ -1324,6 +1338,43 @@ struct Sci_TextRangeFull {
 	char *lpstrText;
 };
 
+struct Sci_MessageRecord {
+	unsigned int message;
+	uptr_t wParam;
+	sptr_t lParam;
+};
+
+struct Sci_LayoutCacheStats {
+	uptr_t hits;
+	uptr_t misses;
+	uptr_t cachedLines;
+	uptr_t cachedBytes;
+};
+
+struct Sci_MemoryUsage {
+	uptr_t textBytes;		/* CellBuffer substance */
+	uptr_t styleBytes;		/* CellBuffer styles */
+	uptr_t undoBytes;		/* undo history actions and scraps */
+	uptr_t perLineBytes;	/* markers, fold levels, line states, annotations */
+	uptr_t layoutBytes;		/* line layout cache */
+};
+
+struct Sci_LineEndCounts {
+	Sci_Position crlf;
+	Sci_Position cr;
+	Sci_Position lf;
+};
+
+struct Sci_MarkerList {
+	Sci_Position count;
+	const Sci_Position *lines;	/* sorted ascending */
+};
+
+struct Sci_RangeList {
+	Sci_Position count;	/* number of (start, length) pairs */
+	const Sci_Position *ranges;	/* pairs sorted ascending, non-overlapping */
+};
+
 struct Sci_TextToFindFull {
 	struct Sci_CharacterRangeFull chrg;
 	const char *lpstrText;
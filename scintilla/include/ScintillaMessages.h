@@ -168,6 +168,7 @@ enum class Message {
 	GetCharacterCategoryOptimization = 2721,
 	BeginUndoAction = 2078,
 	EndUndoAction = 2079,
+	ExecuteBatch = 2815,
 	GetUndoSequence = 2799,
 	GetUndoActions = 2790,
 	SetUndoSavePoint = 2791,
@@ -395,6 +396,15 @@ enum class Message {
 	GetWrapIndentMode = 2473,
 	SetLayoutCache = 2272,
 	GetLayoutCache = 2273,
+	SetLayoutCacheBudget = 2817,
+	GetLayoutCacheStats = 2818,
+	MarkerAddList = 2819,
+	GetMemoryUsage = 2820,
+	SetIdleStylingBudget = 2821,
+	GetLineEndCounts = 2822,
+	SetPaintProfiler = 2823,
+	GetPaintProfiler = 2824,
+	IndicatorFillList = 2825,
 	SetScrollWidth = 2274,
 	GetScrollWidth = 2275,
 	SetScrollWidthTracking = 2516,
@@ -732,6 +742,7 @@ enum class Message {
 	SetTechnology = 2630,
 	GetTechnology = 2631,
 	CreateLoader = 2632,
+	CreateSnapshot = 2816,
 	FindIndicatorShow = 2640,
 	FindIndicatorFlash = 2641,
 	FindIndicatorHide = 2642,
@@ -26,6 +26,43 @@ struct TextToFindFull final {
 	CharacterRangeFull chrgText;
 };
 
+struct MessageRecord final {
+	unsigned int message;
+	uptr_t wParam;
+	sptr_t lParam;
+};
+
+struct LayoutCacheStats final {
+	uptr_t hits;
+	uptr_t misses;
+	uptr_t cachedLines;
+	uptr_t cachedBytes;
+};
+
+struct MemoryUsage final {
+	uptr_t textBytes;		// CellBuffer substance
+	uptr_t styleBytes;		// CellBuffer styles
+	uptr_t undoBytes;		// undo history actions and scraps
+	uptr_t perLineBytes;	// markers, fold levels, line states, annotations
+	uptr_t layoutBytes;		// line layout cache
+};
+
+struct LineEndCounts final {
+	Position crlf;
+	Position cr;
+	Position lf;
+};
+
+struct MarkerList final {
+	Position count;
+	const Position *lines;	// sorted ascending
+};
+
+struct RangeList final {
+	Position count;	// number of (start, length) pairs
+	const Position *ranges;	// pairs sorted ascending, non-overlapping
+};
+
 using SurfaceID = void *;
 
 struct Rectangle final {
@@ -372,11 +372,17 @@ void ColouriseCppDoc(Sci_PositionU startPos, Sci_Position length, int initStyle,
 			if (sc.Match('*', '/')) {
 				sc.Forward();
 				sc.ForwardSetState(SCE_C_DEFAULT);
+			} else {
+				// consume the comment body up to the next '*' or line end in one scan
+				sc.SkipRun('*');
 			}
 			break;
 		case SCE_C_COMMENTLINE:
 			if (sc.atLineStart && !continuationLine) {
 				sc.SetState(SCE_C_DEFAULT);
+			} else {
+				// only a backslash (line continuation) is interesting before the line end
+				sc.SkipRun('\\');
 			}
 			break;
 		case SCE_C_COMMENTDOC:
@@ -785,6 +791,40 @@ bool IsCppFoldingLine(LexAccessor &styler, Sci_Line line, int kind) noexcept {
 #define IsDefineLine(line)		IsCppFoldingLine(styler, line, 4)
 #define IsUnDefLine(line)		IsCppFoldingLine(styler, line, 5)
 
+enum {
+	FoldLineKind_Comment = 1 << 0,
+	FoldLineKind_Using = 1 << 1,
+	FoldLineKind_Include = 1 << 2,
+	FoldLineKind_Define = 1 << 3,
+	FoldLineKind_UnDef = 1 << 4,
+	FoldLineKind_Backslash = 1 << 5,
+};
+
+// Classifies all per-line fold predicates in one pass so the fold loop can
+// keep a rolling window of three lines instead of re-scanning each line for
+// every neighbouring query; the first five kinds are mutually exclusive.
+int ClassifyFoldLine(LexAccessor &styler, Sci_Line line) noexcept {
+	if (line < 0) {
+		return 0;
+	}
+	int flags = 0;
+	if (IsLexCommentLine(styler, line, MultiStyle(SCE_C_COMMENTLINE, SCE_C_COMMENTLINEDOC))) {
+		flags |= FoldLineKind_Comment;
+	} else if (IsCppFoldingLine(styler, line, 1)) {
+		flags |= FoldLineKind_Using;
+	} else if (IsCppFoldingLine(styler, line, 3)) {
+		flags |= FoldLineKind_Include;
+	} else if (IsCppFoldingLine(styler, line, 4)) {
+		flags |= FoldLineKind_Define;
+	} else if (IsCppFoldingLine(styler, line, 5)) {
+		flags |= FoldLineKind_UnDef;
+	}
+	if (IsBackslashLine(styler, line)) {
+		flags |= FoldLineKind_Backslash;
+	}
+	return flags;
+}
+
 constexpr bool IsStreamCommentStyle(int style) noexcept {
 	return style == SCE_C_COMMENT || style == SCE_C_COMMENTDOC;
 }
@@ -845,7 +885,9 @@ void FoldCppDoc(Sci_PositionU startPos, Sci_Position length, int initStyle, Lexe
 	int styleEOL = initStyle;
 	int styleNext = styler.StyleAt(startPos);
 	bool isObjCProtocol = false;
-	bool lineCommentCurrent = IsCommentLine(lineCurrent);
+	int foldPrev = ClassifyFoldLine(styler, lineCurrent - 1);
+	int foldCurrent = ClassifyFoldLine(styler, lineCurrent);
+	int foldNext = ClassifyFoldLine(styler, lineCurrent + 1);
 
 	for (Sci_PositionU i = startPos; i < endPos; i++) {
 		const char ch = chNext;
@@ -856,9 +898,9 @@ void FoldCppDoc(Sci_PositionU startPos, Sci_Position length, int initStyle, Lexe
 		const bool atEOL = (ch == '\r' && chNext != '\n') || (ch == '\n');
 
 		{
-			if (lineCommentCurrent) {
+			if (foldCurrent & FoldLineKind_Comment) {
 				if (atEOL) {
-					levelNext += IsCommentLine(lineCurrent + 1) - IsCommentLine(lineCurrent - 1);
+					levelNext += !!(foldNext & FoldLineKind_Comment) - !!(foldPrev & FoldLineKind_Comment);
 				}
 			}
 			else if (IsStreamCommentStyle(style)) {
@@ -870,18 +912,18 @@ void FoldCppDoc(Sci_PositionU startPos, Sci_Position length, int initStyle, Lexe
 			}
 		}
 
-		if (atEOL && IsUsingLine(lineCurrent)) {
-			levelNext += IsUsingLine(lineCurrent + 1) - IsUsingLine(lineCurrent - 1);
+		if (atEOL && (foldCurrent & FoldLineKind_Using)) {
+			levelNext += !!(foldNext & FoldLineKind_Using) - !!(foldPrev & FoldLineKind_Using);
 		}
 		if (atEOL) {
-			if (IsIncludeLine(lineCurrent)) {
-				levelNext += IsIncludeLine(lineCurrent + 1) - IsIncludeLine(lineCurrent - 1);
+			if (foldCurrent & FoldLineKind_Include) {
+				levelNext += !!(foldNext & FoldLineKind_Include) - !!(foldPrev & FoldLineKind_Include);
 			}
-			else if (IsDefineLine(lineCurrent)) {
-				levelNext += IsDefineLine(lineCurrent + 1) - IsDefineLine(lineCurrent - 1);
+			else if (foldCurrent & FoldLineKind_Define) {
+				levelNext += !!(foldNext & FoldLineKind_Define) - !!(foldPrev & FoldLineKind_Define);
 			}
-			else if (IsUnDefLine(lineCurrent)) {
-				levelNext += IsUnDefLine(lineCurrent + 1) - IsUnDefLine(lineCurrent - 1);
+			else if (foldCurrent & FoldLineKind_UnDef) {
+				levelNext += !!(foldNext & FoldLineKind_UnDef) - !!(foldPrev & FoldLineKind_UnDef);
 			}
 			//else if (IsPropertyLine(lineCurrent)) {
 			//	levelNext += IsPropertyLine(lineCurrent + 1) - IsPropertyLine(lineCurrent - 1);
@@ -889,7 +931,7 @@ void FoldCppDoc(Sci_PositionU startPos, Sci_Position length, int initStyle, Lexe
 		}
 
 		if (atEOL && !IsStreamCommentStyle(style) && !IsStreamCommentStyle(styleEOL)) {
-			levelNext += IsBackslashLine(styler, lineCurrent) - IsBackslashLine(styler, lineCurrent - 1);
+			levelNext += !!(foldCurrent & FoldLineKind_Backslash) - !!(foldPrev & FoldLineKind_Backslash);
 		}
 		if (atEOL && !(IsCppInDefine(styler, i)) && IsOpenBraceLine(styler, lineCurrent + 1)) {
 			levelNext++;
@@ -970,11 +1012,17 @@ void FoldCppDoc(Sci_PositionU startPos, Sci_Position length, int initStyle, Lexe
 			visibleChars = 0;
 			isObjCProtocol = false;
 			styleEOL = style;
-			lineCommentCurrent = IsCommentLine(lineCurrent);
+			foldPrev = foldCurrent;
+			foldCurrent = foldNext;
+			foldNext = ClassifyFoldLine(styler, lineCurrent + 1);
 		}
 	}
 }
 
 }
 
-extern const LexerModule lmCPP(SCLEX_CPP, ColouriseCppDoc, "cpp", FoldCppDoc);
+// safeRestart: everything ColouriseCppDoc() carries from one line to the next
+// is encoded in the line state or the end-of-line style except locals that are
+// already lost at restart boundaries, so relexing an edit may stop as soon as
+// the stored line state and style reappear past the change.
+extern const LexerModule lmCPP(SCLEX_CPP, ColouriseCppDoc, "cpp", FoldCppDoc, false, true);
@@ -374,7 +374,8 @@ void ColouriseHyperTextDoc(Sci_PositionU startPos, Sci_Position length, int init
 	script_type clientScript = static_cast<script_type>((lineState >> 8) & 0x0F); // 4 bits of script name
 	int beforePreProc = (lineState >> 12) & 0xFF; // 8 bits of state
 	bool isLanguageType = (lineState >> 20) & 1; // type or language attribute for script tag
-	int sgmlBlockLevel = (lineState >> 21);
+	const bool regexOKAtLineStart = (lineState >> 21) & 1; // 1 bit: checkpoint of the JS regex context
+	int sgmlBlockLevel = (lineState >> 22);
 
 	script_type scriptLanguage = ScriptOfState(state);
 	// If eNonHtmlScript coincides with SCE_H_COMMENT, assume eScriptComment
@@ -410,19 +411,11 @@ void ColouriseHyperTextDoc(Sci_PositionU startPos, Sci_Position length, int init
 	int chPrev = ' ';
 	int ch = ' ';
 	int chPrevNonWhite = ' ';
-	// look back to set chPrevNonWhite properly for better regex colouring
-	if (scriptLanguage == eScriptJS && startPos > 0) {
-		Sci_Position back = startPos;
-		int style = 0;
-		while (--back) {
-			style = styler.StyleIndexAt(back);
-			if (style < SCE_HJ_DEFAULT || style > SCE_HJ_COMMENTDOC)
-				// includes SCE_HJ_COMMENT & SCE_HJ_COMMENTLINE
-				break;
-		}
-		if (style == SCE_HJ_SYMBOLS) {
-			chPrevNonWhite = styler.SafeGetUCharAt(back);
-		}
+	// restore the regex context for better regex colouring from the per-line
+	// checkpoint; scanning back through the block for the previous non-white
+	// character reached arbitrarily far on every styling call inside a big script
+	if (scriptLanguage == eScriptJS && lineCurrent > 0 && !regexOKAtLineStart) {
+		chPrevNonWhite = 'a';
 	}
 
 	styler.StartSegment(startPos);
@@ -481,7 +474,8 @@ void ColouriseHyperTextDoc(Sci_PositionU startPos, Sci_Position length, int init
 			                    (static_cast<int>(clientScript) << 8) |
 			                    (beforePreProc << 12) |
 			                    (static_cast<int>(isLanguageType) << 20) |
-			                    (sgmlBlockLevel << 21));
+			                    (static_cast<int>(IsOKBeforeJSRE(chPrevNonWhite)) << 21) |
+			                    (sgmlBlockLevel << 22));
 			lineCurrent++;
 		}
 
@@ -182,6 +182,11 @@ void ColouriseJSONDoc(Sci_PositionU startPos, Sci_Position lengthDoc, int initSt
 				styler.ColorTo(startPos, state);
 				state = SCE_JSON_DEFAULT;
 				continue;
+			} else if (styler.Encoding() != EncodingType::dbcs) {
+				// consume the plain body of the string in one scan; '\\' is a
+				// valid DBCS trail byte so DBCS text keeps the per character loop.
+				startPos = LexSkipUntil(styler, startPos, sci::min<Sci_PositionU>(endPos, lineStartNext), '\\', static_cast<char>(GetStringQuote(state)));
+				chNext = styler[startPos];
 			}
 			break;
 
@@ -189,6 +194,10 @@ void ColouriseJSONDoc(Sci_PositionU startPos, Sci_Position lengthDoc, int initSt
 			if (atLineStart) {
 				styler.ColorTo(currentPos, state);
 				state = SCE_JSON_DEFAULT;
+			} else {
+				// nothing interesting before the line end
+				startPos = sci::min<Sci_PositionU>(endPos, lineStartNext);
+				chNext = styler[startPos];
 			}
 			break;
 
@@ -200,6 +209,10 @@ void ColouriseJSONDoc(Sci_PositionU startPos, Sci_Position lengthDoc, int initSt
 				state = SCE_JSON_DEFAULT;
 				levelNext--;
 				continue;
+			} else {
+				// consume the comment body up to the next '*' or line end in one scan
+				startPos = LexSkipUntil(styler, startPos, sci::min<Sci_PositionU>(endPos, lineStartNext), '*');
+				chNext = styler[startPos];
 			}
 			break;
 		}
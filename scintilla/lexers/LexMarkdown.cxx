@@ -83,6 +83,9 @@ enum {
 	LineStateListItemFirstLine = 1 << 4,
 	LineStateBlockEndLine = 1 << 5,
 	LineStateSetextFirstLine = 1 << 6,
+	// empty line at the top level with no state carried over: the next line
+	// starts a new block and relexing can be anchored there.
+	LineStateBlockBoundaryLine = 1 << 7,
 
 	// minimum indentChild for unordered list or definition list as container
 	// TODO: support block quote as container
@@ -666,6 +669,9 @@ int MarkdownLexer::UpdateParentIndentCount(int indentCurrent) noexcept {
 			continue;
 		}
 		if (lineState & LineStateEmptyLine) {
+			if (lineState & LineStateBlockBoundaryLine) {
+				break; // no container spans a block boundary
+			}
 			if (indentCount >= 0 && indentCount < MinContainerIndentChild) {
 				break;
 			}
@@ -1843,15 +1849,23 @@ void ColouriseMarkdownDoc(Sci_PositionU startPos, Sci_Position lengthDoc, int in
 		// backtrack to previous line for better coloring on typing.
 		const Sci_PositionU endPos = startPos + lengthDoc;
 		Sci_Line currentLine = styler.GetLine(startPos) - 1;
-		if (currentLine > 0 && (styler.GetLineState(currentLine) & LineStateEmptyLine) != 0) {
-			--currentLine; // fix typing after indented code block
-		}
-		startPos = styler.LineStart(currentLine);
-		lengthDoc = endPos - startPos;
-		initStyle = 0;
-		if (startPos != 0) {
-			initStyle = styler.StyleIndexAt(startPos - 1);
-			BacktrackToStart(styler, LineStateNestedStateLine, startPos, lengthDoc, initStyle);
+		const int linePrevState = (currentLine > 0) ? styler.GetLineState(currentLine) : 0;
+		if (linePrevState & LineStateBlockBoundaryLine) {
+			// the edit is inside a block starting on the next line, relex only that block.
+			startPos = styler.LineStart(currentLine + 1);
+			lengthDoc = endPos - startPos;
+			initStyle = SCE_MARKDOWN_DEFAULT;
+		} else {
+			if (currentLine > 0 && (linePrevState & LineStateEmptyLine) != 0) {
+				--currentLine; // fix typing after indented code block
+			}
+			startPos = styler.LineStart(currentLine);
+			lengthDoc = endPos - startPos;
+			initStyle = 0;
+			if (startPos != 0) {
+				initStyle = styler.StyleIndexAt(startPos - 1);
+				BacktrackToStart(styler, LineStateNestedStateLine, startPos, lengthDoc, initStyle);
+			}
 		}
 	}
 
@@ -1878,7 +1892,7 @@ void ColouriseMarkdownDoc(Sci_PositionU startPos, Sci_Position lengthDoc, int in
 		1: list item first line
 		1: block end line
 		1: setext first line
-		1: unused
+		1: block boundary
 		8: delimiterCount
 		8: indentCurrent
 		8: indentChild
@@ -2436,6 +2450,9 @@ void ColouriseMarkdownDoc(Sci_PositionU startPos, Sci_Position lengthDoc, int in
 			}
 			if (lexer.tagState != HtmlTagState::None || StyleNeedsBacktrack(sc.state) || !lexer.nestedState.empty()) {
 				lineState |= LineStateNestedStateLine;
+			} else if ((lineState & LineStateEmptyLine) != 0 && sc.state == SCE_MARKDOWN_DEFAULT
+				&& lexer.delimiterCount == 0 && lexer.indentParent == 0) {
+				lineState |= LineStateBlockBoundaryLine;
 			}
 			styler.SetLineState(sc.currentLine, static_cast<int>(lineState));
 		}
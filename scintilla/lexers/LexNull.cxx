@@ -119,7 +119,7 @@ void FoldNullDoc(Sci_PositionU startPos, Sci_Position lengthDoc, int /*initStyle
 }
 
 #if !ENABLE_FOLD_NULL_DOCUMENT
-extern const LexerModule lmNull(SCLEX_NULL, ColouriseNullDoc, "null");
+extern const LexerModule lmNull(SCLEX_NULL, ColouriseNullDoc, "null", nullptr, true);
 #else
-extern const LexerModule lmNull(SCLEX_NULL, FoldNullDoc, "null");
+extern const LexerModule lmNull(SCLEX_NULL, FoldNullDoc, "null", nullptr, true);
 #endif
@@ -35,7 +35,7 @@ public:
 		if (static_cast<size_t>(character) < dense.size()) {
 			return static_cast<CharacterCategory>(dense[character]);
 		}
-		// binary search through ranges
+		// multi-stage table lookup
 		return CategoriseCharacter(character);
 	}
 	int Size() const noexcept;
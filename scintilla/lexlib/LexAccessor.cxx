@@ -10,6 +10,7 @@
 #include <vector>
 
 #include "ILexer.h"
+#include "VectorISA.h"
 #include "LexAccessor.h"
 #include "CharacterSet.h"
 #include "LexerUtils.h"
@@ -170,6 +171,69 @@ Sci_Position LexSkipWhiteSpace(LexAccessor &styler, Sci_Position startPos, Sci_P
 	return startPos;
 }
 
+namespace {
+
+// Find the first byte equal to ch0 or ch1 in [s, end),
+// returns end when not found.
+inline const char *FindInSpan(const char *s, const char * const end, const unsigned char ch0, const unsigned char ch1) noexcept {
+#if NP2_USE_AVX2
+	const __m256i mmCh0 = mm256_set1_epi8(ch0);
+	const __m256i mmCh1 = mm256_set1_epi8(ch1);
+	while (s + sizeof(__m256i) <= end) {
+		const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s));
+		const uint32_t mask = mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, mmCh0), _mm256_cmpeq_epi8(chunk, mmCh1)));
+		if (mask != 0) {
+			return s + np2::ctz(mask);
+		}
+		s += sizeof(__m256i);
+	}
+	// end NP2_USE_AVX2
+#elif NP2_USE_SSE2
+	const __m128i mmCh0 = _mm_set1_epi8(ch0);
+	const __m128i mmCh1 = _mm_set1_epi8(ch1);
+	while (s + sizeof(__m128i) <= end) {
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s));
+		const uint32_t mask = mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, mmCh0), _mm_cmpeq_epi8(chunk, mmCh1)));
+		if (mask != 0) {
+			return s + np2::ctz(mask);
+		}
+		s += sizeof(__m128i);
+	}
+	// end NP2_USE_SSE2
+#endif
+	while (s < end) {
+		const unsigned char ch = *s;
+		if (ch == ch0 || ch == ch1) {
+			break;
+		}
+		++s;
+	}
+	return s;
+}
+
+}
+
+Sci_PositionU LexSkipUntil(LexAccessor &styler, Sci_PositionU startPos, Sci_PositionU endPos, char ch0) noexcept {
+	return LexSkipUntil(styler, startPos, endPos, ch0, ch0);
+}
+
+Sci_PositionU LexSkipUntil(LexAccessor &styler, Sci_PositionU startPos, Sci_PositionU endPos, char ch0, char ch1) noexcept {
+	while (startPos < endPos) {
+		Sci_Position length;
+		const char * const s = styler.BufferSpan(startPos, length);
+		if (length == 0) {
+			break;
+		}
+		length = sci::min<Sci_Position>(length, endPos - startPos);
+		const char * const stop = FindInSpan(s, s + length, ch0, ch1);
+		startPos += stop - s;
+		if (stop != s + length) {
+			break;
+		}
+	}
+	return startPos;
+}
+
 Sci_PositionU LexGetRange(LexAccessor &styler, Sci_Position startPos, bool IsWordChar(int) noexcept, char *s, Sci_PositionU len) noexcept {
 	Sci_PositionU i = 0;
 	char ch = styler[startPos];
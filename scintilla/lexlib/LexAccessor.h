@@ -122,6 +122,21 @@ public:
 		return SafeGetCharAt(position, chDefault);
 	}
 #endif
+	/** Expose the contiguous buffered characters from @a position to the end of
+	 * the buffer or the document, whichever is nearer, so runs can be scanned
+	 * without the per-character bounds check in operator[].
+	 * @a length is zero for invalid position. */
+	const char *BufferSpan(Sci_Position position, Sci_Position &length) noexcept {
+		if (position < startPos || position >= endPos) {
+			Fill(position);
+			if (position < startPos || position >= endPos) {
+				length = 0;
+				return buf;
+			}
+		}
+		length = endPos - position;
+		return buf + (position - startPos);
+	}
 	bool IsLeadByte(unsigned char ch) const noexcept {
 		return encodingType == EncodingType::dbcs && (ch & 0x80) != 0 && pAccess->IsDBCSLeadByte(ch);
 	}
@@ -299,6 +314,13 @@ Sci_Position LexSkipWhiteSpace(LexAccessor &styler, Sci_Position startPos, Sci_P
 Sci_Position LexSkipWhiteSpace(LexAccessor &styler, Sci_Position startPos, Sci_Position endPos, bool IsStreamCommentStyle(int) noexcept) noexcept;
 Sci_Position LexSkipWhiteSpace(LexAccessor &styler, Sci_Position startPos, Sci_Position endPos,
 	bool IsStreamCommentStyle(int), const CharacterSet &charSet) noexcept;
+
+// Skip to the next occurrence of ch0 (or ch1) in [startPos, endPos),
+// returning endPos when the run is unbroken. Scans the accessor buffer
+// directly so homogeneous runs are consumed at memory speed.
+// Stop characters that are valid DBCS trail bytes need a caller side guard.
+Sci_PositionU LexSkipUntil(LexAccessor &styler, Sci_PositionU startPos, Sci_PositionU endPos, char ch0) noexcept;
+Sci_PositionU LexSkipUntil(LexAccessor &styler, Sci_PositionU startPos, Sci_PositionU endPos, char ch0, char ch1) noexcept;
 bool IsLexSpaceToEOL(LexAccessor &styler, Sci_Position startPos) noexcept;
 bool IsLexEmptyLine(LexAccessor &styler, Sci_Line line) noexcept;
 
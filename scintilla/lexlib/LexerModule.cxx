@@ -203,6 +203,25 @@ const LexerModule *LexerModule::Find(int language_) noexcept {
 	return &lmNull;
 }
 
+bool LexerModule::UniformStyleLanguage(int language_) noexcept {
+	// No fallback here: an unregistered language may style every character.
+	for (const LexerModule *lm : lexerCatalogue) {
+		if (lm->GetLanguage() == language_) {
+			return lm->UniformStyle();
+		}
+	}
+	return false;
+}
+
+bool LexerModule::SafeRestartLanguage(int language_) noexcept {
+	for (const LexerModule *lm : lexerCatalogue) {
+		if (lm->GetLanguage() == language_) {
+			return lm->SafeRestart();
+		}
+	}
+	return false;
+}
+
 Scintilla::ILexer5 *LexerModule::Create() const {
 	if (fnFactory) {
 		return fnFactory();
@@ -26,17 +26,28 @@ public:
 	LexerFunction const fnFolder;
 	LexerFactoryFunction const fnFactory;
 	const char *const languageName;
+	// all text keeps the default style, so the document drops its style buffer
+	// and answers style queries without ever running the lexer over characters
+	const bool uniformStyle;
+	// the lexer's whole cross-line context is the end-of-line style and the
+	// line state, so relexing after an edit may stop at the first line past
+	// the change that ends with the same stored style and line state
+	const bool safeRestart;
 
 	constexpr LexerModule(
 		int language_,
 		LexerFunction fnLexer_,
 		const char *languageName_ = nullptr,
-		LexerFunction fnFolder_ = nullptr) noexcept:
+		LexerFunction fnFolder_ = nullptr,
+		bool uniformStyle_ = false,
+		bool safeRestart_ = false) noexcept:
 		language(language_),
 		fnLexer(fnLexer_),
 		fnFolder(fnFolder_),
 		fnFactory(nullptr),
-		languageName(languageName_) {
+		languageName(languageName_),
+		uniformStyle(uniformStyle_),
+		safeRestart(safeRestart_) {
 	}
 
 	constexpr LexerModule(
@@ -47,16 +58,28 @@ public:
 		fnLexer(nullptr),
 		fnFolder(nullptr),
 		fnFactory(fnFactory_),
-		languageName(languageName_) {
+		languageName(languageName_),
+		uniformStyle(false),
+		safeRestart(false) {
 	}
 
 	constexpr int GetLanguage() const noexcept {
 		return language;
 	}
 
+	constexpr bool UniformStyle() const noexcept {
+		return uniformStyle;
+	}
+
+	constexpr bool SafeRestart() const noexcept {
+		return safeRestart;
+	}
+
 	Scintilla::ILexer5 *Create() const;
 
 	static const LexerModule *Find(int language_) noexcept;
+	static bool UniformStyleLanguage(int language_) noexcept;
+	static bool SafeRestartLanguage(int language_) noexcept;
 };
 
 constexpr int SCE_SIMPLE_OPERATOR = 5;
@@ -39,6 +39,27 @@ StyleContext::StyleContext(Sci_PositionU startPos, Sci_PositionU length, int ini
 	SeekTo(startPos);
 }
 
+void StyleContext::SkipRun(char ch0, char ch1) noexcept {
+	if (multiByteAccess || atLineEnd) {
+		return;
+	}
+	// stop two characters before the line and range ends so the line ending and
+	// a preceding line continuation backslash are still stepped over.
+	const Sci_PositionU endRange = sci::min(endPos, lineStartNext);
+	if (currentPos + 4 > endRange) {
+		return;
+	}
+	const Sci_PositionU pos = LexSkipUntil(styler, currentPos + 1, endRange - 2, ch0, ch1);
+	if (pos > currentPos + 1) {
+		currentPos = pos - 1;
+		chPrev = styler.SafeGetUCharAt(currentPos - 1);
+		ch = static_cast<unsigned char>(styler[currentPos]);
+		chNext = styler.SafeGetUCharAt(pos);
+		atLineStart = false;
+		atLineEnd = false;
+	}
+}
+
 bool StyleContext::MatchIgnoreCase(const char *s) const noexcept {
 	if (MakeLowerCase(ch) != static_cast<unsigned char>(*s)) {
 		return false;
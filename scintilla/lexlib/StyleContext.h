@@ -122,6 +122,14 @@ public:
 		Forward();
 		SetState(state_);
 	}
+	// Consume the run before the next occurrence of ch0 or ch1 on the current
+	// line in one scan, stopping short so the stop character, the line ending
+	// and any line continuation backslash still go through Forward().
+	// No-op for DBCS text as a stop character may match a trail byte.
+	void SkipRun(char ch0, char ch1) noexcept;
+	void SkipRun(char ch0) noexcept {
+		SkipRun(ch0, ch0);
+	}
 	Sci_Position LengthCurrent() const noexcept {
 		return currentPos - styler.GetStartSegment();
 	}
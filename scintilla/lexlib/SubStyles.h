@@ -12,9 +12,39 @@ class WordClassifier {
 	int baseStyle;
 	int firstStyle = 0;
 	int lenStyles = 0;
-	using WordStyleMap = std::map<std::string, int, std::less<>>;
+	// Hashed with the same FNV-1a used for the WordList keyword index so a
+	// lookup is one hash and (rarely more than) one compare instead of a
+	// tree walk over string keys.
+	struct WordHash {
+		using is_transparent = void;
+		size_t operator()(std::string_view s) const noexcept {
+			unsigned int hash = 2166136261U;
+			for (const char ch : s) {
+				hash = (hash ^ static_cast<unsigned char>(ch)) * 16777619;
+			}
+			return hash;
+		}
+	};
+	using WordStyleMap = std::unordered_map<std::string, int, WordHash, std::equal_to<>>;
 	WordStyleMap wordToStyle;
 
+	// Direct-mapped cache of the most recent resolutions: type-name-heavy
+	// code asks about the same few identifiers over and over within a run.
+	static constexpr size_t cacheSlots = 8;
+	static constexpr size_t cacheWordMax = 63;
+	struct CacheEntry {
+		int style;
+		unsigned char length;
+		char word[cacheWordMax + 1];
+	};
+	mutable CacheEntry cache[cacheSlots] {};
+
+	void FlushCache() const noexcept {
+		for (CacheEntry &entry : cache) {
+			entry.length = 0;
+		}
+	}
+
 public:
 
 	explicit WordClassifier(int baseStyle_) noexcept : baseStyle(baseStyle_) {
@@ -24,6 +54,7 @@ public:
 		firstStyle = firstStyle_;
 		lenStyles = lenStyles_;
 		wordToStyle.clear();
+		FlushCache();
 	}
 
 	int Base() const noexcept {
@@ -46,14 +77,25 @@ public:
 		firstStyle = 0;
 		lenStyles = 0;
 		wordToStyle.clear();
+		FlushCache();
 	}
 
 	int ValueFor(std::string_view s) const {
+		CacheEntry *entry = nullptr;
+		if (!s.empty() && s.length() <= cacheWordMax) {
+			entry = &cache[(s.length() ^ static_cast<unsigned char>(s.front())) & (cacheSlots - 1)];
+			if (entry->length == s.length() && std::string_view(entry->word, entry->length) == s) {
+				return entry->style;
+			}
+		}
 		const auto it = wordToStyle.find(s);
-		if (it != wordToStyle.end())
-			return it->second;
-		else
-			return -1;
+		const int style = (it != wordToStyle.end()) ? it->second : -1;
+		if (entry) {
+			entry->style = style;
+			entry->length = static_cast<unsigned char>(s.length());
+			s.copy(entry->word, s.length());
+		}
+		return style;
 	}
 
 	bool IncludesStyle(int style) const noexcept {
@@ -61,6 +103,7 @@ public:
 	}
 
 	void RemoveStyle(int style) noexcept {
+		FlushCache();
 		auto it = wordToStyle.begin();
 		while (it != wordToStyle.end()) {
 			if (it->second == style) {
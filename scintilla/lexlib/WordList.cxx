@@ -65,11 +65,18 @@ inline char **ArrayFromWordList(char *wordlist, size_t slen, range_t *len) {
 	return keywords;
 }
 
-/** Threshold for linear search.
- * Because of cache locality and other metrics, linear search is faster than binary search
- * when word list contains few words.
+/** FNV-1a hash over a word, stopping at the function marker '(' so that
+ * a definition like "sin(x)" and the query "sin" used in InListPrefixed()
+ * hash to the same value; the caller verifies the characters on a hit.
  */
-constexpr range_t WordListLinearSearchThreshold = 5;
+constexpr unsigned int HashWord(const char *s) noexcept {
+	unsigned int hash = 2166136261U;
+	unsigned char ch;
+	while ((ch = *s++) != '\0' && ch != '(') {
+		hash = (hash ^ ch) * 16777619;
+	}
+	return hash;
+}
 
 // words in [start, end) starts with same character, maximum word count limited to 0xffff.
 struct Range {
@@ -109,8 +116,13 @@ void WordList::Clear() noexcept {
 	if (words) {
 		delete[]words;
 		delete[]list;
+		delete[]hashIndex;
+		delete[]hashes;
 		words = nullptr;
 		list = nullptr;
+		hashIndex = nullptr;
+		hashes = nullptr;
+		hashMask = 0;
 		//len = 0;
 	}
 }
@@ -152,6 +164,26 @@ bool WordList::Set(const char *s, KeywordAttr attribute) {
 		assert(static_cast<unsigned>(indexChar - MinIndexChar) < std::size(ranges));
 		ranges[indexChar - MinIndexChar] = start | (i << 16);
 	}
+
+	if (len != 0) {
+		// open addressing with linear probing, load factor kept at or below 1/2.
+		range_t tableSize = 4;
+		while (tableSize < len + len) {
+			tableSize <<= 1;
+		}
+		hashMask = tableSize - 1;
+		hashes = new unsigned int[len];
+		hashIndex = new range_t[tableSize]();
+		for (range_t i = 0; i < len; i++) {
+			const unsigned int hash = HashWord(words[i]);
+			hashes[i] = hash;
+			range_t slot = hash & hashMask;
+			while (hashIndex[slot]) {
+				slot = (slot + 1) & hashMask;
+			}
+			hashIndex[slot] = i + 1;
+		}
+	}
 	return true;
 }
 
@@ -161,54 +193,26 @@ bool WordList::Set(const char *s, KeywordAttr attribute) {
  * so '^GTK_' matches 'GTK_X', 'GTK_MAJOR_VERSION', and 'GTK_'.
  */
 bool WordList::InList(const char *s) const noexcept {
-	if (nullptr == words) {
+	if (nullptr == hashIndex) {
 		return false;
 	}
-	const unsigned index = static_cast<unsigned char>(s[0]) - MinIndexChar;
-	if (index > std::size(ranges) - 1) {
-		return false;
-	}
-	range_t end = ranges[index];
-	if (end) {
-		Range range(end);
-		range_t count = range.Length();
-		if (count < WordListLinearSearchThreshold) {
-			do {
-				const char *a = words[range.start] + 1;
-				const char *b = s + 1;
-				while (*a && *a == *b) {
-					a++;
-					b++;
-				}
-				if (!*a && !*b) {
-					return true;
-				}
-			} while (range.Next());
-		} else {
-			do {
-				const range_t step = count >> 1;
-				const range_t mid = range.start + step;
-				const char *a = words[mid] + 1;
-				const char *b = s + 1;
-				while (*a && *a == *b) {
-					a++;
-					b++;
-				}
-				const int diff = static_cast<unsigned char>(*a) - static_cast<unsigned char>(*b);
-				if (diff == 0) {
-					return true;
-				}
-				if (diff < 0) {
-					range.start = mid + 1;
-					count -= step + 1;
-				} else {
-					count = step;
-				}
-			} while (count != 0);
+	const unsigned int hash = HashWord(s);
+	for (range_t slot = hash & hashMask; hashIndex[slot]; slot = (slot + 1) & hashMask) {
+		const range_t i = hashIndex[slot] - 1;
+		if (hashes[i] == hash) {
+			const char *a = words[i];
+			const char *b = s;
+			while (*a && *a == *b) {
+				a++;
+				b++;
+			}
+			if (!*a && !*b) {
+				return true;
+			}
 		}
 	}
 
-	end = ranges[static_cast<unsigned char>('^') - MinIndexChar];
+	const range_t end = ranges[static_cast<unsigned char>('^') - MinIndexChar];
 	if (end) {
 		Range range(end);
 		do {
@@ -233,21 +237,16 @@ bool WordList::InList(const char *s) const noexcept {
  * InList(s) == InListPrefixed(s, '\0')
  */
 bool WordList::InListPrefixed(const char *s, const char marker) const noexcept {
-	if (nullptr == words) {
-		return false;
-	}
-	const unsigned index = static_cast<unsigned char>(s[0]) - MinIndexChar;
-	if (index > std::size(ranges) - 1) {
+	if (nullptr == hashIndex) {
 		return false;
 	}
-	range_t end = ranges[index];
-	if (end) {
-		Range range(end);
-		range_t count = range.Length();
-		if (count < WordListLinearSearchThreshold) {
-			do {
-				const char *a = words[range.start] + 1;
-				const char *b = s + 1;
+	if (marker == '(' || marker == '\0') {
+		const unsigned int hash = HashWord(s);
+		for (range_t slot = hash & hashMask; hashIndex[slot]; slot = (slot + 1) & hashMask) {
+			const range_t i = hashIndex[slot] - 1;
+			if (hashes[i] == hash) {
+				const char *a = words[i];
+				const char *b = s;
 				while (*a && *a == *b) {
 					a++;
 					b++;
@@ -255,32 +254,32 @@ bool WordList::InListPrefixed(const char *s, const char marker) const noexcept {
 				if ((!*a || *a == marker) && !*b) {
 					return true;
 				}
-			} while (range.Next());
-		} else {
+			}
+		}
+	} else {
+		// stored words were hashed up to '(', so other markers take the range index.
+		const unsigned index = static_cast<unsigned char>(s[0]) - MinIndexChar;
+		if (index > std::size(ranges) - 1) {
+			return false;
+		}
+		const range_t bucket = ranges[index];
+		if (bucket) {
+			Range range(bucket);
 			do {
-				const range_t step = count >> 1;
-				const range_t mid = range.start + step;
-				const char *a = words[mid] + 1;
+				const char *a = words[range.start] + 1;
 				const char *b = s + 1;
 				while (*a && *a == *b) {
 					a++;
 					b++;
 				}
-				const int diff = static_cast<unsigned char>(*a) - static_cast<unsigned char>(*b);
-				if (diff == 0 || diff == static_cast<unsigned char>(marker)) {
+				if ((!*a || *a == marker) && !*b) {
 					return true;
 				}
-				if (diff < 0) {
-					range.start = mid + 1;
-					count -= step + 1;
-				} else {
-					count = step;
-				}
-			} while (count != 0);
+			} while (range.Next());
 		}
 	}
 
-	end = ranges[static_cast<unsigned char>('^') - MinIndexChar];
+	const range_t end = ranges[static_cast<unsigned char>('^') - MinIndexChar];
 	if (end) {
 		Range range(end);
 		do {
@@ -26,6 +26,11 @@ private:
 	char **words = nullptr;
 	char *list = nullptr;
 	//range_t len = 0;
+	// Open addressing index over the words and their precomputed hashes so
+	// InList() and InListPrefixed() classify a word with one hash and one verify.
+	range_t *hashIndex = nullptr;
+	unsigned int *hashes = nullptr;
+	range_t hashMask = 0;
 #if 1
 	// ASCII graphic character only, most word starts with character in '_a-zA-Z'
 	static constexpr unsigned char MinIndexChar = ' ' + 1;
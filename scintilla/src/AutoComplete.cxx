@@ -205,8 +205,10 @@ void AutoComplete::Show(bool show) const {
 
 void AutoComplete::Cancel() noexcept {
 	if (lb->Created()) {
+		// Hide rather than destroy so the window can be reused by the next
+		// popup, like the call tip window in CallTip::CallTipCancel().
+		lb->Show(false);
 		lb->Clear();
-		lb->Destroy();
 		active = false;
 	}
 }
@@ -17,6 +17,8 @@
 #include <vector>
 #include <algorithm>
 
+#include "VectorISA.h"
+
 #include "CaseConvert.h"
 #include "UniConversion.h"
 
@@ -604,6 +606,9 @@ class CaseConverter final : public ICaseConverter {
 	// The parallel arrays
 	std::vector<int> characters;
 	std::vector<ConversionString> conversions;
+	// First source letter of the ASCII alphabet that changes under this
+	// conversion: 'a' for upper, 'A' for lower and fold.
+	unsigned char asciiSourceBase = 'A';
 
 public:
 	bool Initialised() const noexcept {
@@ -626,11 +631,69 @@ public:
 		size_t mixedPos = 0;
 		unsigned char bytes[UTF8MaxBytes + 1]{};
 		while (mixedPos < lenMixed) {
+#if NP2_USE_AVX2
+			// ASCII runs dominate logs and source code: flip the case bit a
+			// vector at a time and fall back to the table only around bytes
+			// that are not ASCII. ASCII conversions are one byte to one byte,
+			// so output position never outruns the checked bound.
+			if (mixedPos + sizeof(__m256i) <= lenMixed && lenConverted + sizeof(__m256i) <= sizeConverted) {
+				const __m256i vectorBase = _mm256_set1_epi8(static_cast<char>(asciiSourceBase - 1));
+				const __m256i vectorTop = _mm256_set1_epi8(static_cast<char>(asciiSourceBase + 26));
+				const __m256i vectorCaseBit = _mm256_set1_epi8(0x20);
+				do {
+					const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(mixed + mixedPos));
+					if (mm256_movemask_epi8(chunk) != 0) {
+						break; // non-ASCII byte in the chunk
+					}
+					const __m256i letter = _mm256_and_si256(_mm256_cmpgt_epi8(chunk, vectorBase), _mm256_cmpgt_epi8(vectorTop, chunk));
+					_mm256_storeu_si256(reinterpret_cast<__m256i *>(converted + lenConverted),
+						_mm256_xor_si256(chunk, _mm256_and_si256(letter, vectorCaseBit)));
+					mixedPos += sizeof(__m256i);
+					lenConverted += sizeof(__m256i);
+				} while (mixedPos + sizeof(__m256i) <= lenMixed && lenConverted + sizeof(__m256i) <= sizeConverted);
+				if (mixedPos == lenMixed) {
+					break;
+				}
+			}
+#elif NP2_USE_SSE2
+			// ASCII runs dominate logs and source code: flip the case bit a
+			// vector at a time and fall back to the table only around bytes
+			// that are not ASCII. ASCII conversions are one byte to one byte,
+			// so output position never outruns the checked bound.
+			if (mixedPos + sizeof(__m128i) <= lenMixed && lenConverted + sizeof(__m128i) <= sizeConverted) {
+				const __m128i vectorBase = _mm_set1_epi8(static_cast<char>(asciiSourceBase - 1));
+				const __m128i vectorTop = _mm_set1_epi8(static_cast<char>(asciiSourceBase + 26));
+				const __m128i vectorCaseBit = _mm_set1_epi8(0x20);
+				do {
+					const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(mixed + mixedPos));
+					if (_mm_movemask_epi8(chunk) != 0) {
+						break; // non-ASCII byte in the chunk
+					}
+					const __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(chunk, vectorBase), _mm_cmpgt_epi8(vectorTop, chunk));
+					_mm_storeu_si128(reinterpret_cast<__m128i *>(converted + lenConverted),
+						_mm_xor_si128(chunk, _mm_and_si128(letter, vectorCaseBit)));
+					mixedPos += sizeof(__m128i);
+					lenConverted += sizeof(__m128i);
+				} while (mixedPos + sizeof(__m128i) <= lenMixed && lenConverted + sizeof(__m128i) <= sizeConverted);
+				if (mixedPos == lenMixed) {
+					break;
+				}
+			}
+#endif
 			const unsigned char leadByte = mixed[mixedPos];
 			const char *caseConverted = nullptr;
 			size_t lenMixedChar = 1;
 			if (UTF8IsAscii(leadByte)) {
-				caseConverted = Find(leadByte);
+				// ASCII maps one byte to one byte, no need to search the table
+				unsigned char chConverted = leadByte;
+				if (static_cast<unsigned int>(leadByte - asciiSourceBase) < 26) {
+					chConverted ^= 0x20;
+				}
+				converted[lenConverted++] = static_cast<char>(chConverted);
+				if (lenConverted >= sizeConverted)
+					return 0;
+				mixedPos++;
+				continue;
 			} else {
 				bytes[0] = leadByte;
 				const int widthCharBytes = UTF8BytesOfLead(leadByte);
@@ -690,6 +753,7 @@ void CaseConverter::AddSymmetric(CaseConversion conversion, int lower, int upper
 }
 
 void CaseConverter::SetupConversions(CaseConversion conversion) {
+	asciiSourceBase = (conversion == CaseConversion::upper) ? 'a' : 'A';
 	// First initialize for the symmetric ranges
 	for (size_t i = 0; i < std::size(symmetricCaseConversionRanges);) {
 		const int lower = symmetricCaseConversionRanges[i++];
@@ -23,6 +23,7 @@
 #include <memory>
 
 #include "ScintillaTypes.h"
+#include "ScintillaStructures.h"
 
 #include "Debugging.h"
 #include "VectorISA.h"
@@ -78,6 +79,7 @@ public:
 	virtual void InsertLines(Sci::Line line, const Sci::Position *positions, size_t lines, bool lineStart) = 0;
 	virtual void SetLineStart(Sci::Line line, Sci::Position position) noexcept = 0;
 	virtual void RemoveLine(Sci::Line line) = 0;
+	virtual void RemoveLines(Sci::Line line, Sci::Line lines) = 0;
 	virtual Sci::Line Lines() const noexcept = 0;
 	virtual void AllocateLines(Sci::Line lines) = 0;
 	virtual Sci::Line LineFromPosition(Sci::Position pos) const noexcept = 0;
@@ -254,6 +256,20 @@ public:
 			perLine->RemoveLine(line);
 		}
 	}
+	void RemoveLines(Sci::Line line, Sci::Line lines) override {
+		const POS lineAsPos = pos_cast(line);
+		const POS linesAsPos = pos_cast(lines);
+		starts.RemovePartitions(lineAsPos, linesAsPos);
+		if (FlagSet(activeIndices, LineCharacterIndexType::Utf32)) {
+			startsUTF32.starts.RemovePartitions(lineAsPos, linesAsPos);
+		}
+		if (FlagSet(activeIndices, LineCharacterIndexType::Utf16)) {
+			startsUTF16.starts.RemovePartitions(lineAsPos, linesAsPos);
+		}
+		if (perLine) {
+			perLine->RemoveLines(line, lines);
+		}
+	}
 	Sci::Line Lines() const noexcept override {
 		return line_from_pos_cast(starts.Partitions());
 	}
@@ -413,6 +429,20 @@ int CellBuffer::CheckRange(const char *chars, const char *styles, Sci::Position
 	return result;
 }
 
+void CellBuffer::CountMemory(Scintilla::MemoryUsage &usage) const noexcept {
+	usage.textBytes = substance.AllocatedBytes();
+	usage.styleBytes = style.AllocatedBytes();
+	usage.undoBytes = uh->AllocatedBytes();
+}
+
+Sci::Position CellBuffer::CommonPrefix(const char *chars, const char *styles, Sci::Position position, Sci::Position rangeLength) const noexcept {
+	Sci::Position result = substance.CommonPrefix(chars, position, rangeLength);
+	if (hasStyles && result != 0) {
+		result = std::min(result, style.CommonPrefix(styles, position, result));
+	}
+	return result;
+}
+
 Sci::Position CellBuffer::GapPosition() const noexcept {
 	return substance.GapPosition();
 }
@@ -455,17 +485,16 @@ bool CellBuffer::SetStyleAt(Sci::Position position, char styleValue) noexcept {
 	return style.UpdateValueAt(position, styleValue);
 }
 
+bool CellBuffer::SetStyles(Sci::Position position, const char *styles, Sci::Position lengthStyle, Sci::Position &startMod, Sci::Position &endMod) noexcept {
+	PLATFORM_ASSERT(lengthStyle == 0 ||
+		(lengthStyle > 0 && lengthStyle + position <= style.Length()));
+	return style.ReplaceRange(styles, position, lengthStyle, startMod, endMod);
+}
+
 bool CellBuffer::SetStyleFor(Sci::Position position, Sci::Position lengthStyle, char styleValue) noexcept {
-	bool changed = false;
 	PLATFORM_ASSERT(lengthStyle == 0 ||
 		(lengthStyle > 0 && lengthStyle + position <= style.Length()));
-	while (lengthStyle--) {
-		if (style.UpdateValueAt(position, styleValue)) {
-			changed = true;
-		}
-		position++;
-	}
-	return changed;
+	return style.FillRange(position, lengthStyle, styleValue);
 }
 
 // The char* returned is to an allocation owned by the undo history
@@ -654,6 +683,10 @@ void CellBuffer::RemoveLine(Sci::Line line) {
 	plv->RemoveLine(line);
 }
 
+void CellBuffer::RemoveLines(Sci::Line line, Sci::Line lines) {
+	plv->RemoveLines(line, lines);
+}
+
 bool CellBuffer::UTF8LineEndOverlaps(Sci::Position position) const noexcept {
 	const unsigned char bytes[] = {
 		static_cast<unsigned char>(substance.ValueAt(position - 2)),
@@ -737,6 +770,104 @@ namespace {
 CountWidths CountCharacterWidthsUTF8(std::string_view sv) noexcept {
 	CountWidths cw;
 	size_t remaining = sv.length();
+#if NP2_USE_AVX2
+	// Count a vector at a time. Characters are non-trail bytes and astral
+	// plane characters are F1..F3 lead bytes. The window is only counted this
+	// way when each lead has exactly its expected trail bytes and no lead
+	// carries overlong, surrogate or plane limit rules (C0 C1, E0, ED, F0 and
+	// F4 upwards), since those classify byte by byte; such windows and any
+	// sequence crossing the window end go through UTF8Classify as before,
+	// keeping the counts identical for invalid UTF-8.
+	while (remaining >= sizeof(__m256i)) {
+		const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(sv.data()));
+		const uint32_t nonAscii = mm256_movemask_epi8(chunk);
+		if (nonAscii == 0) {
+			cw.countBasePlane += sizeof(__m256i);
+			sv.remove_prefix(sizeof(__m256i));
+			remaining -= sizeof(__m256i);
+			continue;
+		}
+		// 80..BF: trail bytes, signed values below -0x40.
+		const uint32_t trails = mm256_movemask_epi8(_mm256_cmpgt_epi8(_mm256_set1_epi8(-0x40), chunk));
+		const uint32_t leads = nonAscii & ~trails;
+		// C2..DF
+		const uint32_t lead2 = mm256_movemask_epi8(_mm256_and_si256(
+			_mm256_cmpgt_epi8(chunk, _mm256_set1_epi8(-0x3F)), _mm256_cmpgt_epi8(_mm256_set1_epi8(-0x20), chunk)));
+		// E1..EF except ED
+		const uint32_t lead3 = mm256_movemask_epi8(_mm256_andnot_si256(
+			_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(-0x13)),
+			_mm256_and_si256(_mm256_cmpgt_epi8(chunk, _mm256_set1_epi8(-0x20)), _mm256_cmpgt_epi8(_mm256_set1_epi8(-0x10), chunk))));
+		// F1..F3
+		const uint32_t lead4 = mm256_movemask_epi8(_mm256_and_si256(
+			_mm256_cmpgt_epi8(chunk, _mm256_set1_epi8(-0x10)), _mm256_cmpgt_epi8(_mm256_set1_epi8(-0x0C), chunk)));
+		if (leads == (lead2 | lead3 | lead4)) {
+			const uint32_t expected = (leads << 1) | ((lead3 | lead4) << 2) | (lead4 << 3);
+			if (expected == trails) {
+				// A sequence starting in the last bytes finishes in the next window.
+				const uint32_t incomplete = (lead4 & 0xE0000000U) | (lead3 & 0xC0000000U) | (leads & 0x80000000U);
+				const uint32_t validLen = incomplete ? np2_ctz(incomplete) : sizeof(__m256i);
+				const uint32_t maskValid = (validLen == sizeof(__m256i)) ? UINT32_MAX : ((1U << validLen) - 1);
+				const uint32_t countOther = np2_popcount(lead4 & maskValid);
+				cw.countBasePlane += np2_popcount(~trails & maskValid) - countOther;
+				cw.countOtherPlanes += countOther;
+				sv.remove_prefix(validLen);
+				remaining -= validLen;
+				continue;
+			}
+		}
+		const size_t target = remaining - sizeof(__m256i);
+		do {
+			const int utf8Status = UTF8Classify(sv);
+			const int lenChar = utf8Status & UTF8MaskWidth;
+			cw.CountChar(lenChar);
+			sv.remove_prefix(lenChar);
+			remaining -= lenChar;
+		} while (remaining > target);
+	}
+#elif NP2_USE_SSE2
+	// Count a vector at a time, see the AVX2 block above for the rules.
+	while (remaining >= sizeof(__m128i)) {
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(sv.data()));
+		const uint32_t nonAscii = _mm_movemask_epi8(chunk);
+		if (nonAscii == 0) {
+			cw.countBasePlane += sizeof(__m128i);
+			sv.remove_prefix(sizeof(__m128i));
+			remaining -= sizeof(__m128i);
+			continue;
+		}
+		const uint32_t trails = _mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-0x40), chunk));
+		const uint32_t leads = nonAscii & ~trails;
+		const uint32_t lead2 = _mm_movemask_epi8(_mm_and_si128(
+			_mm_cmpgt_epi8(chunk, _mm_set1_epi8(-0x3F)), _mm_cmpgt_epi8(_mm_set1_epi8(-0x20), chunk)));
+		const uint32_t lead3 = _mm_movemask_epi8(_mm_andnot_si128(
+			_mm_cmpeq_epi8(chunk, _mm_set1_epi8(-0x13)),
+			_mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8(-0x20)), _mm_cmpgt_epi8(_mm_set1_epi8(-0x10), chunk))));
+		const uint32_t lead4 = _mm_movemask_epi8(_mm_and_si128(
+			_mm_cmpgt_epi8(chunk, _mm_set1_epi8(-0x10)), _mm_cmpgt_epi8(_mm_set1_epi8(-0x0C), chunk)));
+		if (leads == (lead2 | lead3 | lead4)) {
+			const uint32_t expected = ((leads << 1) | ((lead3 | lead4) << 2) | (lead4 << 3)) & 0xFFFFU;
+			if (expected == trails) {
+				const uint32_t incomplete = (lead4 & 0xE000U) | (lead3 & 0xC000U) | (leads & 0x8000U);
+				const uint32_t validLen = incomplete ? np2_ctz(incomplete) : sizeof(__m128i);
+				const uint32_t maskValid = (1U << validLen) - 1;
+				const uint32_t countOther = np2_popcount(lead4 & maskValid);
+				cw.countBasePlane += np2_popcount(~trails & maskValid) - countOther;
+				cw.countOtherPlanes += countOther;
+				sv.remove_prefix(validLen);
+				remaining -= validLen;
+				continue;
+			}
+		}
+		const size_t target = remaining - sizeof(__m128i);
+		do {
+			const int utf8Status = UTF8Classify(sv);
+			const int lenChar = utf8Status & UTF8MaskWidth;
+			cw.CountChar(lenChar);
+			sv.remove_prefix(lenChar);
+			remaining -= lenChar;
+		} while (remaining > target);
+	}
+#endif
 	while (remaining > 0) {
 		const int utf8Status = UTF8Classify(sv);
 		const int lenChar = utf8Status & UTF8MaskWidth;
@@ -768,6 +899,168 @@ void CellBuffer::RecalculateIndexLineStarts(Sci::Line lineFirst, Sci::Line lineL
 	}
 }
 
+namespace {
+
+// Count CR+LF pairs, lone CR and lone LF in [s, s+length) as the range will sit
+// in the buffer between chPrev and chAfter: a leading LF pairs with a preceding
+// CR and a trailing CR pairs with a following LF. chPrev's own line end is
+// included, chAfter only as a lone LF or the LF of a trailing pair, so applying
+// the same window to the old and the new neighbourhood of a change and
+// subtracting gives the change to the whole buffer counts.
+LineEndCounts CountLineEnds(const char *s, Sci::Position length, unsigned char chPrev, unsigned char chAfter) noexcept {
+	LineEndCounts counts {};
+	if (length == 0) {
+		if (chPrev == '\r') {
+			if (chAfter == '\n') {
+				counts.crlf = 1;
+			} else {
+				counts.cr = 1;
+			}
+		} else if (chAfter == '\n') {
+			counts.lf = 1;
+		}
+		return counts;
+	}
+
+	const uint8_t *ptr = reinterpret_cast<const uint8_t *>(s);
+	const uint8_t * const end = ptr + length;
+	if (chPrev == '\r') {
+		if (*ptr == '\n') {
+			++ptr;
+			++counts.crlf;
+		} else {
+			++counts.cr;
+		}
+	}
+
+#if NP2_USE_AVX2
+	const __m256i vectCR = _mm256_set1_epi8('\r');
+	const __m256i vectLF = _mm256_set1_epi8('\n');
+	while (ptr + 2*sizeof(__m256i) < end) {
+		// unaligned loading: change starts at random position.
+		const __m256i chunk1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ptr));
+		const __m256i chunk2 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ptr + sizeof(__m256i)));
+		ptr += 2*sizeof(__m256i);
+		uint64_t maskCR = mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk1, vectCR));
+		uint64_t maskLF = mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk1, vectLF));
+		maskLF |= static_cast<uint64_t>(mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk2, vectLF))) << sizeof(__m256i);
+		maskCR |= static_cast<uint64_t>(mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk2, vectCR))) << sizeof(__m256i);
+
+		if (maskCR) {
+			if (_addcarry_u64(0, maskCR, maskCR, &maskCR)) {
+				// *ptr is readable: the loop condition keeps at least one byte after the chunks
+				if (*ptr == '\n') {
+					// CR+LF across boundary
+					++ptr;
+					++counts.crlf;
+				} else {
+					++counts.cr;
+				}
+			}
+
+			// maskCR and maskLF never have some bit set, after shifting maskCR by 1 bit,
+			// the bits both set in maskCR and maskLF represents CR+LF;
+			// the bits only set in maskCR or maskLF represents individual CR or LF.
+			const uint64_t maskCRLF = maskCR & maskLF; // CR+LF
+			const uint64_t maskCR_LF = maskCR ^ maskLF;// CR alone or LF alone
+			maskLF = maskCR_LF & maskLF; // LF alone
+			maskCR = maskCR_LF ^ maskLF; // CR alone (with one position offset)
+			if (maskCRLF) {
+				counts.crlf += np2_popcount64(maskCRLF);
+			}
+			if (maskCR) {
+				counts.cr += np2_popcount64(maskCR);
+			}
+		}
+		if (maskLF) {
+			counts.lf += np2_popcount64(maskLF);
+		}
+	}
+	// end NP2_USE_AVX2
+#elif NP2_USE_SSE2
+	const __m128i vectCR = _mm_set1_epi8('\r');
+	const __m128i vectLF = _mm_set1_epi8('\n');
+	while (ptr + 2*sizeof(__m128i) < end) {
+		// unaligned loading: change starts at random position.
+		const __m128i chunk1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr));
+		const __m128i chunk2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr + sizeof(__m128i)));
+		ptr += 2*sizeof(__m128i);
+		uint32_t maskCR = mm_movemask_epi8(_mm_cmpeq_epi8(chunk1, vectCR));
+		uint32_t maskLF = mm_movemask_epi8(_mm_cmpeq_epi8(chunk1, vectLF));
+		maskLF |= mm_movemask_epi8(_mm_cmpeq_epi8(chunk2, vectLF)) << sizeof(__m128i);
+		maskCR |= mm_movemask_epi8(_mm_cmpeq_epi8(chunk2, vectCR)) << sizeof(__m128i);
+
+		if (maskCR) {
+			if (_addcarry_u32(0, maskCR, maskCR, &maskCR)) {
+				if (*ptr == '\n') {
+					// CR+LF across boundary
+					++ptr;
+					++counts.crlf;
+				} else {
+					++counts.cr;
+				}
+			}
+
+			// maskCR and maskLF never have some bit set, after shifting maskCR by 1 bit,
+			// the bits both set in maskCR and maskLF represents CR+LF;
+			// the bits only set in maskCR or maskLF represents individual CR or LF.
+			const uint32_t maskCRLF = maskCR & maskLF; // CR+LF
+			const uint32_t maskCR_LF = maskCR ^ maskLF;// CR alone or LF alone
+			maskLF = maskCR_LF & maskLF; // LF alone
+			maskCR = maskCR_LF ^ maskLF; // CR alone (with one position offset)
+			if (maskCRLF) {
+				counts.crlf += np2_popcount(maskCRLF);
+			}
+			if (maskCR) {
+				counts.cr += np2_popcount(maskCR);
+			}
+		}
+		if (maskLF) {
+			counts.lf += np2_popcount(maskLF);
+		}
+	}
+	// end NP2_USE_SSE2
+#endif
+
+	const uint8_t * const back = end - 1;
+	while (ptr < back) {
+		const uint8_t ch = *ptr++;
+		constexpr uint32_t mask = ((1 << '\r') - 1) ^ (1 << '\n');
+		if (ch > '\r' || ((mask >> ch) & 1) != 0) {
+			continue;
+		}
+		if (ch == '\n') {
+			++counts.lf;
+		} else if (*ptr == '\n') {
+			++ptr;
+			++counts.crlf;
+		} else {
+			++counts.cr;
+		}
+	}
+	if (ptr == back) {
+		const uint8_t ch = *ptr;
+		if (ch == '\r') {
+			if (chAfter == '\n') {
+				++counts.crlf;
+			} else {
+				++counts.cr;
+			}
+			return counts;
+		}
+		if (ch == '\n') {
+			++counts.lf;
+		}
+	}
+	if (chAfter == '\n') {
+		// lone LF: the byte now before it is not a CR
+		++counts.lf;
+	}
+	return counts;
+}
+
+}
+
 void CellBuffer::BasicInsertString(const Sci::Position position, const char * const s, const Sci::Position insertLength) {
 	if (insertLength == 0)
 		return;
@@ -814,6 +1107,14 @@ void CellBuffer::BasicInsertString(const Sci::Position position, const char * co
 		RemoveLine(lineInsert);
 	}
 
+	{
+		const LineEndCounts inserted = CountLineEnds(s, insertLength, chPrev, chAfter);
+		const LineEndCounts joined = CountLineEnds(nullptr, 0, chPrev, chAfter);
+		lineEndCounts.crlf += inserted.crlf - joined.crlf;
+		lineEndCounts.cr += inserted.cr - joined.cr;
+		lineEndCounts.lf += inserted.lf - joined.lf;
+	}
+
 #if defined(_WIN64)
 	constexpr size_t PositionBlockSize = 256;
 #else
@@ -893,6 +1194,88 @@ void CellBuffer::BasicInsertString(const Sci::Position position, const char * co
 				positions[nPositions++] = position + ptr - s;
 			}
 		} while (ptr + 2*sizeof(__m256i) <= end);
+	} else if (utf8LineEnds != LineEndType::Default && ptr + sizeof(__m256i) <= end) {
+		// scan for candidate bytes: CR, LF and the final byte of NEL, LS and PS.
+		// candidates are rare in real text, so each one is verified by looking
+		// at the bytes before it, same as the scalar loop below.
+		const __m256i vectCR = _mm256_set1_epi8('\r');
+		const __m256i vectLF = _mm256_set1_epi8('\n');
+		const __m256i vectNEL = _mm256_set1_epi8(static_cast<char>(0x85));
+		const __m256i vectLS = _mm256_set1_epi8(static_cast<char>(0xa8));
+		const __m256i vectPS = _mm256_set1_epi8(static_cast<char>(0xa9));
+		const unsigned char chBefore1 = chPrev;		// byte before s
+		const unsigned char chBefore2 = chBeforePrev;	// two bytes before s
+		bool skipLF = false;
+		do {
+			const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ptr));
+			__m256i eol = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, vectCR), _mm256_cmpeq_epi8(chunk, vectLF));
+			eol = _mm256_or_si256(eol, _mm256_cmpeq_epi8(chunk, vectNEL));
+			eol = _mm256_or_si256(eol, _mm256_or_si256(_mm256_cmpeq_epi8(chunk, vectLS), _mm256_cmpeq_epi8(chunk, vectPS)));
+			uint32_t mask = mm256_movemask_epi8(eol);
+			if (skipLF) {
+				// LF from a CR+LF pair split across the chunk boundary
+				mask &= ~1U;
+				skipLF = false;
+			}
+			if (mask) {
+				if (nPositions >= PositionBlockSize - sizeof(__m256i)) {
+					plv->InsertLines(lineInsert, positions, nPositions, atLineStart);
+					lineInsert += nPositions;
+					nPositions = 0;
+				}
+
+				uint32_t index = 0;
+				do {
+					const uint32_t trailing = np2::ctz(mask);
+					mask >>= trailing;
+					mask >>= 1;
+					index += trailing;
+					const char * const q = ptr + index;
+					++index;
+					const uint8_t chEol = *q;
+					const uint8_t b1 = (q > s) ? static_cast<uint8_t>(q[-1]) : chBefore1;
+					switch (chEol) {
+					case '\r':
+						if (q[1] == '\n') {	// q + 1 <= end is always readable
+							positions[nPositions++] = position + (q + 2 - s);
+							if (index < sizeof(__m256i)) {
+								mask >>= 1;
+								++index;
+							} else {
+								skipLF = true;
+							}
+							break;
+						}
+						[[fallthrough]];
+					case '\n':
+						positions[nPositions++] = position + (q + 1 - s);
+						break;
+					case 0x85: // NEL
+						if (b1 == 0xc2) {
+							positions[nPositions++] = position + (q + 1 - s);
+						}
+						break;
+					default: { // LS, PS
+						const uint8_t b2 = (q > s + 1) ? static_cast<uint8_t>(q[-2]) : ((q == s) ? chBefore2 : chBefore1);
+						if (b1 == 0x80 && b2 == 0xe2) {
+							positions[nPositions++] = position + (q + 1 - s);
+						}
+					}
+						break;
+					}
+				} while (mask);
+			}
+
+			ptr += sizeof(__m256i);
+		} while (ptr + sizeof(__m256i) <= end);
+		chBeforePrev = ptr[-2];
+		chPrev = ptr[-1];
+		if (skipLF) {
+			// consume the LF so the tail loop does not count the pair twice
+			++ptr;
+			chBeforePrev = chPrev;
+			chPrev = '\n';
+		}
 	}
 	// end NP2_USE_AVX2
 #elif NP2_USE_SSE2
@@ -1203,6 +1586,7 @@ void CellBuffer::BasicDeleteChars(const Sci::Position position, const Sci::Posit
 		// If whole buffer is being deleted, faster to reinitialise lines data
 		// than to delete each line.
 		plv->Init();
+		lineEndCounts = LineEndCounts();
 	} else {
 		// Have to fix up line positions before doing deletion as looking at text in buffer
 		// to work out which lines have been removed
@@ -1238,6 +1622,18 @@ void CellBuffer::BasicDeleteChars(const Sci::Position position, const Sci::Posit
 			}
 		}
 
+		// line ends in the window chBefore + deleted range + chAfter, the same
+		// window over chBefore + chAfter alone is applied after the deletion
+		LineEndCounts removed {};
+		if (chBefore == '\r') {
+			if (chNext == '\n') {
+				removed.crlf++;
+			} else {
+				removed.cr++;
+			}
+		}
+		unsigned char chEolPrev = chBefore;
+
 		bool ignoreNL = false;
 		if (chPrev == '\r' && chNext == '\n') {
 			// Move back one
@@ -1245,9 +1641,12 @@ void CellBuffer::BasicDeleteChars(const Sci::Position position, const Sci::Posit
 			lineRemove++;
 			ignoreNL = true; 	// First \n is not real deletion
 		}
+		// Every removal is at lineRemove so they collapse into one batched call,
+		// updating the line starts and each per-line structure once.
+		Sci::Line linesRemoved = 0;
 		if (utf8LineEnds != LineEndType::Default && UTF8IsTrailByte(chNext)) {
 			if (UTF8LineEndOverlaps(position)) {
-				RemoveLine(lineRemove);
+				linesRemoved++;
 			}
 		}
 
@@ -1256,26 +1655,39 @@ void CellBuffer::BasicDeleteChars(const Sci::Position position, const Sci::Posit
 			chNext = substance.ValueAt(position + i + 1);
 			if (ch == '\r') {
 				if (chNext != '\n') {
-					RemoveLine(lineRemove);
+					linesRemoved++;
+					removed.cr++;
+				} else {
+					// pairs with the byte after the deletion when i is the last index
+					removed.crlf++;
 				}
 			} else if (ch == '\n') {
+				if (chEolPrev != '\r') {
+					removed.lf++;
+				}
 				if (ignoreNL) {
 					ignoreNL = false; 	// Further \n are real deletions
 				} else {
-					RemoveLine(lineRemove);
+					linesRemoved++;
 				}
 			} else if (utf8LineEnds != LineEndType::Default) {
 				if (!UTF8IsAscii(ch)) {
 					const unsigned char next3[3] = { ch, chNext,
 						static_cast<unsigned char>(substance.ValueAt(position + i + 2)) };
 					if (UTF8IsSeparator(next3) || UTF8IsNEL(next3)) {
-						RemoveLine(lineRemove);
+						linesRemoved++;
 					}
 				}
 			}
 
+			chEolPrev = ch;
 			ch = chNext;
 		}
+		if (linesRemoved == 1) {
+			RemoveLine(lineRemove);
+		} else if (linesRemoved != 0) {
+			RemoveLines(lineRemove, linesRemoved);
+		}
 		// May have to fix up end if last deletion causes CR to be next to LF
 		// or removes one of a CR LF pair
 		const char chAfter = substance.ValueAt(position + deleteLength);
@@ -1284,6 +1696,14 @@ void CellBuffer::BasicDeleteChars(const Sci::Position position, const Sci::Posit
 			RemoveLine(lineRemove - 1);
 			plv->SetLineStart(lineRemove - 1, position + 1);
 		}
+
+		if (chAfter == '\n' && chEolPrev != '\r') {
+			removed.lf++;
+		}
+		const LineEndCounts joined = CountLineEnds(nullptr, 0, chBefore, chAfter);
+		lineEndCounts.crlf += joined.crlf - removed.crlf;
+		lineEndCounts.cr += joined.cr - removed.cr;
+		lineEndCounts.lf += joined.lf - removed.lf;
 	}
 	substance.DeleteRange(position, deleteLength);
 	if (lineRecalculateStart >= 0) {
@@ -1333,11 +1753,11 @@ Action CellBuffer::GetUndoStep() const noexcept {
 	return uh->GetUndoStep();
 }
 
-void CellBuffer::PerformUndoStep() {
-	const Action previousStep = uh->GetUndoStep();
+void CellBuffer::PerformUndoStep(const Action &previousStep) {
 	// PreviousBeforeSavePoint and AfterDetachPoint are called since acting on the previous action,
 	// that is currentAction-1
-	if (changeHistory && uh->PreviousBeforeSavePoint()) {
+	const bool previousBeforeSavePoint = changeHistory && uh->PreviousBeforeSavePoint();
+	if (previousBeforeSavePoint) {
 		changeHistory->StartReversion();
 	}
 	if (previousStep.at == ActionType::insert) {
@@ -1347,7 +1767,7 @@ void CellBuffer::PerformUndoStep() {
 		}
 		if (changeHistory) {
 			changeHistory->DeleteRange(previousStep.position, previousStep.lenData,
-				uh->PreviousBeforeSavePoint() && !uh->AfterDetachPoint());
+				previousBeforeSavePoint && !uh->AfterDetachPoint());
 		}
 		BasicDeleteChars(previousStep.position, previousStep.lenData);
 	} else if (previousStep.at == ActionType::remove) {
@@ -1371,8 +1791,7 @@ Action CellBuffer::GetRedoStep() const noexcept {
 	return uh->GetRedoStep();
 }
 
-void CellBuffer::PerformRedoStep() {
-	const Action actionStep = uh->GetRedoStep();
+void CellBuffer::PerformRedoStep(const Action &actionStep) {
 	if (actionStep.at == ActionType::insert) {
 		BasicInsertString(actionStep.position, actionStep.data, actionStep.lenData);
 		if (changeHistory) {
@@ -1529,6 +1948,19 @@ void CellBuffer::ChangeHistorySet(bool set) {
 	}
 }
 
+void CellBuffer::ChangeHistoryCompact() {
+	if (changeHistory) {
+		changeHistory->Compact();
+	}
+}
+
+void CellBuffer::PrepositionGaps() noexcept {
+	substance.PrepositionGap();
+	if (hasStyles) {
+		style.PrepositionGap();
+	}
+}
+
 int CellBuffer::EditionAt(Sci::Position pos) const noexcept {
 	if (changeHistory) {
 		return changeHistory->EditionAt(pos);
@@ -1556,3 +1988,10 @@ Sci::Position CellBuffer::EditionNextDelete(Sci::Position pos) const noexcept {
 	}
 	return Length() + 1;
 }
+
+unsigned int CellBuffer::EditionsInRange(Sci::Position start, Sci::Position end, Sci::Position endDeletes) const noexcept {
+	if (changeHistory) {
+		return changeHistory->EditionsInRange(start, end, endDeletes);
+	}
+	return 0;
+}
@@ -8,6 +8,10 @@
 
 #define InsertString_WithoutPerLine		1023
 
+namespace Scintilla {
+struct MemoryUsage;	// Declare in case ScintillaStructures.h not included
+}
+
 namespace Scintilla::Internal {
 
 // Interface to per-line data that wants to see each line insertion and deletion
@@ -19,6 +23,10 @@ public:
 	virtual void InsertLine(Sci::Line line) = 0;
 	virtual void InsertLines(Sci::Line line, Sci::Line lines) = 0;
 	virtual void RemoveLine(Sci::Line line) = 0;
+	virtual void RemoveLines(Sci::Line line, Sci::Line lines) = 0;
+	virtual size_t AllocatedBytes() const noexcept {
+		return 0;
+	}
 };
 
 class UndoHistory;
@@ -88,6 +96,10 @@ private:
 
 	const std::unique_ptr<ILineVector> plv;
 
+	/// Counts of CR+LF pairs, lone CR and lone LF over the whole buffer,
+	/// maintained incrementally by BasicInsertString() and BasicDeleteChars().
+	Scintilla::LineEndCounts lineEndCounts {};
+
 	bool UTF8LineEndOverlaps(Sci::Position position) const noexcept;
 	bool UTF8IsCharacterBoundary(Sci::Position position) const;
 	void ResetLineEnds();
@@ -117,6 +129,11 @@ public:
 	const char *BufferPointer();
 	const char *RangePointer(Sci::Position position, Sci::Position rangeLength) noexcept;
 	int CheckRange(const char *chars, const char *styles, Sci::Position position, Sci::Position rangeLength) const noexcept;
+	void CountMemory(Scintilla::MemoryUsage &usage) const noexcept;
+	Scintilla::LineEndCounts GetLineEndCounts() const noexcept {
+		return lineEndCounts;
+	}
+	Sci::Position CommonPrefix(const char *chars, const char *styles, Sci::Position position, Sci::Position rangeLength) const noexcept;
 	Sci::Position GapPosition() const noexcept;
 	SplitView AllView() const noexcept;
 
@@ -146,11 +163,13 @@ public:
 	Sci::Line LineFromPositionIndex(Sci::Position pos, Scintilla::LineCharacterIndexType lineCharacterIndex) const noexcept;
 	void InsertLine(Sci::Line line, Sci::Position position, bool lineStart);
 	void RemoveLine(Sci::Line line);
+	void RemoveLines(Sci::Line line, Sci::Line lines);
 	const char *InsertString(Sci::Position position, const char *s, Sci::Position insertLength, bool &startSequence);
 
 	/// Setting styles for positions outside the range of the buffer is safe and has no effect.
 	/// @return true if the style of a character is changed.
 	bool SetStyleAt(Sci::Position position, char styleValue) noexcept;
+	bool SetStyles(Sci::Position position, const char *styles, Sci::Position lengthStyle, Sci::Position &startMod, Sci::Position &endMod) noexcept;
 	bool SetStyleFor(Sci::Position position, Sci::Position lengthStyle, char styleValue) noexcept;
 
 	const char *DeleteChars(Sci::Position position, Sci::Position deleteLength, bool &startSequence);
@@ -193,11 +212,11 @@ public:
 	bool CanUndo() const noexcept;
 	int StartUndo() noexcept;
 	Action GetUndoStep() const noexcept;
-	void PerformUndoStep();
+	void PerformUndoStep(const Action &previousStep);
 	bool CanRedo() const noexcept;
 	int StartRedo() noexcept;
 	Action GetRedoStep() const noexcept;
-	void PerformRedoStep();
+	void PerformRedoStep(const Action &actionStep);
 
 	int UndoActions() const noexcept;
 	void SetUndoSavePoint(int action) noexcept;
@@ -215,10 +234,13 @@ public:
 	void ChangeLastUndoActionText(size_t length, const char *text);
 
 	void ChangeHistorySet(bool set);
+	void ChangeHistoryCompact();
+	void PrepositionGaps() noexcept;
 	[[nodiscard]] int EditionAt(Sci::Position pos) const noexcept;
 	[[nodiscard]] Sci::Position EditionEndRun(Sci::Position pos) const noexcept;
 	[[nodiscard]] unsigned int EditionDeletesAt(Sci::Position pos) const noexcept;
 	[[nodiscard]] Sci::Position EditionNextDelete(Sci::Position pos) const noexcept;
+	[[nodiscard]] unsigned int EditionsInRange(Sci::Position start, Sci::Position end, Sci::Position endDeletes) const noexcept;
 };
 
 }
@@ -311,6 +311,31 @@ void ChangeLog::SetSavePoint() {
 	}
 }
 
+void ChangeLog::Compact(Sci::Position position) {
+	insertEdition.Compact(position);
+	// Merge adjacent same-edition entries inside each deletion set:
+	// InsertFrontDeletionAt prepends without merging so undo cycles
+	// fragment the sets.
+	const Sci::Position length = insertEdition.Length();
+	for (Sci::Position positionDeletion = position; positionDeletion <= length;) {
+		const EditionSetOwned empty{};
+		const EditionSetOwned &editions = deleteEdition.ValueOr(positionDeletion, empty);
+		if (editions && editions->size() > 1) {
+			EditionSet &set = *editions;
+			size_t merged = 0;
+			for (size_t item = 1; item < set.size(); item++) {
+				if (set[merged].edition == set[item].edition) {
+					set[merged].count += set[item].count;
+				} else {
+					set[++merged] = set[item];
+				}
+			}
+			set.erase(set.begin() + merged + 1, set.end());
+		}
+		positionDeletion = deleteEdition.PositionNext(positionDeletion);
+	}
+}
+
 Sci::Position ChangeLog::Length() const noexcept {
 	return insertEdition.Length();
 }
@@ -338,6 +363,17 @@ void ChangeLog::Check() const noexcept {
 
 ChangeHistory::ChangeHistory(Sci::Position length) {
 	changeLog.Clear(length);
+	DiscardSummaryFrom(0);
+}
+
+void ChangeHistory::DiscardSummaryFrom(Sci::Position position) {
+	compactFrom = std::min(compactFrom, position);
+	const size_t blockCount = static_cast<size_t>(changeLog.Length() / blockGrain) + 1;
+	if (blockEditions.size() != blockCount) {
+		blockEditions.resize(blockCount, blockUncounted);
+	}
+	const size_t block = std::min(static_cast<size_t>(position / blockGrain), blockEditions.size());
+	std::fill(blockEditions.begin() + block, blockEditions.end(), blockUncounted);
 }
 
 void ChangeHistory::Insert(Sci::Position position, Sci::Position insertLength, bool collectingUndo, bool beforeSave) {
@@ -352,6 +388,7 @@ void ChangeHistory::Insert(Sci::Position position, Sci::Position insertLength, b
 			changeLogReversions->PopDeletion(position, insertLength);
 		}
 	}
+	DiscardSummaryFrom(position);
 	Check();
 }
 
@@ -365,6 +402,7 @@ void ChangeHistory::DeleteRange(Sci::Position position, Sci::Position deleteLeng
 			changeLogReversions->PushDeletionAt(position, { changeRevertedOriginal, 1 });
 		}
 	}
+	DiscardSummaryFrom(position);
 	Check();
 }
 
@@ -377,6 +415,7 @@ void ChangeHistory::DeleteRangeSavingHistory(Sci::Position position, Sci::Positi
 		}
 		changeLogReversions->DeleteRange(position, deleteLength);
 	}
+	DiscardSummaryFrom(position);
 	Check();
 }
 
@@ -385,17 +424,31 @@ void ChangeHistory::StartReversion() {
 		changeLogReversions = std::make_unique<ChangeLog>();
 		changeLogReversions->Clear(changeLog.Length());
 	}
+	DiscardSummaryFrom(0);
 	Check();
 }
 
 void ChangeHistory::EndReversion() noexcept {
 	changeLogReversions.reset();
+	std::fill(blockEditions.begin(), blockEditions.end(), blockUncounted);
 	Check();
 }
 
 void ChangeHistory::SetSavePoint() {
 	changeLog.SetSavePoint();
 	EndReversion();
+	DiscardSummaryFrom(0);
+}
+
+void ChangeHistory::Compact() {
+	// Compaction does not change the result of any query so the edition
+	// summary blocks stay valid.
+	changeLog.Compact(compactFrom);
+	if (changeLogReversions) {
+		changeLogReversions->Compact(compactFrom);
+	}
+	compactFrom = changeLog.Length();
+	Check();
 }
 
 void ChangeHistory::UndoDeleteStep(Sci::Position position, Sci::Position deleteLength, bool isDetached) {
@@ -408,6 +461,7 @@ void ChangeHistory::UndoDeleteStep(Sci::Position position, Sci::Position deleteL
 			changeLogReversions->Insert(position, deleteLength, 1);
 		}
 	}
+	DiscardSummaryFrom(position);
 	Check();
 }
 
@@ -426,6 +480,7 @@ void ChangeHistory::EditionCreateHistory(Sci::Position start, Sci::Position leng
 		} else {
 			changeLog.PushDeletionAt(start, { historicEpoch, 1 });
 		}
+		DiscardSummaryFrom(start);
 	}
 }
 
@@ -493,6 +548,46 @@ Sci::Position ChangeHistory::EditionNextDelete(Sci::Position pos) const noexcept
 	return next;
 }
 
+// Combine the editions of the insertions in [start, end) with the deletions
+// at [start, endDeletes] into the 4-bit value used for margin markers
+unsigned int ChangeHistory::EditionsScan(Sci::Position start, Sci::Position end, Sci::Position endDeletes) const noexcept {
+	unsigned int editions = 0;
+	for (Sci::Position position = start; position < end;) {
+		const int edition = EditionAt(position);
+		if (edition) {
+			editions |= 1U << (edition - 1);
+		}
+		position = EditionEndRun(position);
+	}
+	for (Sci::Position position = start; position <= endDeletes;) {
+		editions |= EditionDeletesAt(position);
+		position = EditionNextDelete(position);
+	}
+	return editions;
+}
+
+unsigned int ChangeHistory::EditionsInRange(Sci::Position start, Sci::Position end, Sci::Position endDeletes) const noexcept {
+	// Whole blocks covered by the range come from the per-block summary so
+	// painting a line does not rescan each of its runs on every redraw.
+	const Sci::Position covered = std::min(end, endDeletes + 1);
+	const Sci::Position blockFirst = (start + blockGrain - 1) / blockGrain;
+	const Sci::Position blockLast = covered / blockGrain;
+	if (blockFirst >= blockLast || static_cast<size_t>(blockLast) > blockEditions.size()) {
+		return EditionsScan(start, end, endDeletes);
+	}
+	unsigned int editions = EditionsScan(start, blockFirst * blockGrain, blockFirst * blockGrain - 1);
+	for (Sci::Position block = blockFirst; block < blockLast; block++) {
+		unsigned int mask = blockEditions[block];
+		if (mask == blockUncounted) {
+			const Sci::Position blockStart = block * blockGrain;
+			mask = EditionsScan(blockStart, blockStart + blockGrain, blockStart + blockGrain - 1);
+			blockEditions[block] = static_cast<unsigned char>(mask);
+		}
+		editions |= mask;
+	}
+	return editions | EditionsScan(blockLast * blockGrain, end, endDeletes);
+}
+
 size_t ChangeHistory::DeletionCount(Sci::Position start, Sci::Position length) const noexcept {
 	return changeLog.DeletionCount(start, length);
 }
@@ -73,6 +73,7 @@ struct ChangeLog {
 	void SaveHistoryForDelete(Sci::Position position, Sci::Position deleteLength);
 	void DeleteRangeSavingHistory(Sci::Position position, Sci::Position deleteLength);
 	void SetSavePoint();
+	void Compact(Sci::Position position);
 
 	Sci::Position Length() const noexcept;
 	[[nodiscard]] size_t DeletionCount(Sci::Position start, Sci::Position length) const noexcept;
@@ -86,6 +87,17 @@ class ChangeHistory final {
 	std::unique_ptr<ChangeLog> changeLogReversions;
 	int historicEpoch = -1;
 
+	// Per-block OR of the edition bits so margin queries over ranges that
+	// cover whole blocks avoid rescanning every run. Blocks from the first
+	// one touched by a modification are discarded and recounted lazily.
+	static constexpr Sci::Position blockGrain = 0x400;
+	static constexpr unsigned char blockUncounted = 0xff;
+	mutable std::vector<unsigned char> blockEditions;
+	Sci::Position compactFrom = 0;	// lowest position modified since last Compact
+
+	void DiscardSummaryFrom(Sci::Position position);
+	[[nodiscard]] unsigned int EditionsScan(Sci::Position start, Sci::Position end, Sci::Position endDeletes) const noexcept;
+
 public:
 	ChangeHistory(Sci::Position length=0);
 
@@ -98,6 +110,9 @@ public:
 
 	void SetSavePoint();
 
+	// Merge adjacent same-state runs accumulated by editing, called when idle
+	void Compact();
+
 	void UndoDeleteStep(Sci::Position position, Sci::Position deleteLength, bool isDetached);
 
 	[[nodiscard]] Sci::Position Length() const noexcept;
@@ -111,6 +126,7 @@ public:
 	[[nodiscard]] Sci::Position EditionEndRun(Sci::Position pos) const noexcept;
 	[[nodiscard]] unsigned int EditionDeletesAt(Sci::Position pos) const noexcept;
 	[[nodiscard]] Sci::Position EditionNextDelete(Sci::Position pos) const noexcept;
+	[[nodiscard]] unsigned int EditionsInRange(Sci::Position start, Sci::Position end, Sci::Position endDeletes) const noexcept;
 
 	// Testing - not used by Scintilla
 	[[nodiscard]] size_t DeletionCount(Sci::Position start, Sci::Position length) const noexcept;
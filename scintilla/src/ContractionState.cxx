@@ -47,6 +47,18 @@ class ContractionState final : public IContractionState {
 	std::unique_ptr<Partitioning<LINE>> displayLines;
 	Sci::Line linesInDocument = 1;
 
+	// Cache the most recent DocFromDisplay() resolution. Painting and scrolling
+	// resolve runs of consecutive display lines, so most queries land on the
+	// cached line or the one just after it and skip the partition binary search.
+	mutable Sci::Line docLineCached = 0;
+	mutable Sci::Line displayFirstCached = -1;
+	mutable Sci::Line displayNextCached = -1;
+
+	void InvalidateLineCache() const noexcept {
+		displayFirstCached = -1;
+		displayNextCached = -1;
+	}
+
 	void EnsureData();
 
 	bool OneToOne() const noexcept {
@@ -181,6 +193,8 @@ void ContractionState<LINE>::Clear() noexcept {
 #endif
 	displayLines.reset();
 	linesInDocument = 1;
+	docLineCached = 0;
+	InvalidateLineCache();
 }
 
 #define OneToMany_LinesInDoc()		(displayLines->Partitions() - 1)
@@ -234,9 +248,34 @@ Sci::Line ContractionState<LINE>::DocFromDisplay(Sci::Line lineDisplay) const no
 		if (lineDisplay < 0) {
 			return 0;
 		}
+		if (lineDisplay >= displayFirstCached && lineDisplay < displayNextCached) {
+			return docLineCached;
+		}
 		const Sci::Line linesDisplayed = displayLines->PositionFromPartition(OneToMany_LinesInDoc());
 		lineDisplay = std::min(lineDisplay, linesDisplayed);
-		const Sci::Line lineDoc = displayLines->PartitionFromPosition(line_cast(lineDisplay));
+		Sci::Line lineDoc = -1;
+		if (lineDisplay == displayNextCached && lineDisplay < linesDisplayed) {
+			// Stepping to the display line after the cached one: a fold hides a
+			// whole run of document lines, so the next visible line is nearly
+			// always within a few partitions of the cached line.
+			const LINE lineLast = line_cast(LinesInDoc() - 1);
+			LINE line = line_cast(docLineCached);
+			for (int probe = 0; probe < 8; probe++) {
+				if (line == lineLast || displayLines->PositionFromPartition(line + 1) > line_cast(lineDisplay)) {
+					lineDoc = line;
+					break;
+				}
+				++line;
+			}
+		}
+		if (lineDoc < 0) {
+			lineDoc = displayLines->PartitionFromPosition(line_cast(lineDisplay));
+		}
+		if (lineDoc < OneToMany_LinesInDoc()) {
+			docLineCached = lineDoc;
+			displayFirstCached = displayLines->PositionFromPartition(line_cast(lineDoc));
+			displayNextCached = displayFirstCached + heights->ValueAt(line_cast(lineDoc));
+		}
 		PLATFORM_ASSERT(GetVisible(lineDoc));
 		return lineDoc;
 	}
@@ -279,6 +318,7 @@ void ContractionState<LINE>::InsertLines(Sci::Line lineDoc, Sci::Line lineCount)
 #endif // ContractionState_InsertLines_OneByOne
 		//const double duration = period.Duration()*1e3;
 		//printf("%s(%td, %td) duration: %f\n", __func__, lineDoc, lineCount, duration);
+		InvalidateLineCache();
 	}
 	Check();
 }
@@ -314,6 +354,7 @@ void ContractionState<LINE>::DeleteLines(Sci::Line lineDoc, Sci::Line lineCount)
 #endif // ContractionState_DeleteLines_OneByOne
 		//const double duration = period.Duration()*1e3;
 		//printf("%s(%td, %td) duration: %f\n", __func__, lineDoc, lineCount, duration);
+		InvalidateLineCache();
 	}
 	Check();
 }
@@ -351,6 +392,7 @@ bool ContractionState<LINE>::SetVisible(Sci::Line lineDocStart, Sci::Line lineDo
 			if (changed) {
 				visible->FillRange(line_cast(lineDocStart), static_cast<char>(isVisible),
 					line_cast(lineDocEnd - lineDocStart) + 1);
+				InvalidateLineCache();
 			}
 			Check();
 			return changed;
@@ -474,6 +516,7 @@ bool ContractionState<LINE>::SetHeight(Sci::Line lineDoc, int height) {
 				displayLines->InsertText(line_cast(lineDoc), height - h);
 			}
 			heights->SetValueAt(line_cast(lineDoc), height);
+			InvalidateLineCache();
 			Check();
 			return true;
 		} else {
@@ -120,6 +120,7 @@ public:
 
 	// Returns changed=true if some values may have changed
 	FillResult<Sci::Position> FillRange(Sci::Position position, int value, Sci::Position fillLength) override;
+	FillResult<Sci::Position> FillList(const Sci::Position *ranges, size_t count, int value) override;
 
 	void InsertSpace(Sci::Position position, Sci::Position insertLength) override;
 	void DeleteRange(Sci::Position position, Sci::Position deleteLength) override;
@@ -211,6 +212,34 @@ FillResult<Sci::Position> DecorationList<POS>::FillRange(Sci::Position position,
 	return fr;
 }
 
+template <typename POS>
+FillResult<Sci::Position> DecorationList<POS>::FillList(const Sci::Position *ranges, size_t count, int value) {
+	if (!current) {
+		current = DecorationFromIndicator(currentIndicator);
+		if (!current) {
+			current = Create(currentIndicator, lengthDocument);
+		}
+	}
+	// The ranges arrive sorted, so each fill appends right after the previous
+	// one and the run structure is updated in a single forward pass; only the
+	// union of the changes is reported so the caller notifies and redraws once.
+	FillResult<Sci::Position> fr{ false, 0, 0 };
+	for (size_t i = 0; i < 2*count; i += 2) {
+		const FillResult<POS> frOne = current->rs.FillRange(pos_cast(ranges[i]), value, pos_cast(ranges[i + 1]));
+		if (frOne.changed) {
+			if (!fr.changed) {
+				fr.changed = true;
+				fr.position = frOne.position;
+			}
+			fr.fillLength = frOne.position + frOne.fillLength - fr.position;
+		}
+	}
+	if (current->Empty()) {
+		Delete(currentIndicator);
+	}
+	return fr;
+}
+
 template <typename POS>
 void DecorationList<POS>::InsertSpace(Sci::Position position, Sci::Position insertLength) {
 	const bool atEnd = position == lengthDocument;
@@ -35,6 +35,9 @@ public:
 
 	// Returns with changed=true if some values may have changed
 	virtual FillResult<Sci::Position> FillRange(Sci::Position position, int value, Sci::Position fillLength) = 0;
+	// Fills (start, length) pairs sorted ascending in one pass; the returned
+	// fill result spans from the first change to the end of the last one.
+	virtual FillResult<Sci::Position> FillList(const Sci::Position *ranges, size_t count, int value) = 0;
 	virtual void InsertSpace(Sci::Position position, Sci::Position insertLength) = 0;
 	virtual void DeleteRange(Sci::Position position, Sci::Position deleteLength) = 0;
 	virtual void DeleteLexerDecorations() = 0;
@@ -23,6 +23,7 @@
 #include <optional>
 #include <algorithm>
 #include <memory>
+#include <atomic>
 
 #include <windows.h>
 #if defined(BOOST_REGEX_STANDALONE)
@@ -55,6 +56,8 @@
 #include "RESearch.h"
 #include "UniConversion.h"
 #include "ElapsedPeriod.h"
+#include "ParallelSupport.h"
+#include "TraceEvents.h"
 
 using namespace Scintilla;
 using namespace Scintilla::Internal;
@@ -105,6 +108,243 @@ LineEndType LexInterface::LineEndTypesSupported() const noexcept {
 	return LineEndType::Default;
 }
 
+namespace Scintilla::Internal {
+
+// Size of the region lexed ahead of the styled area on a worker thread.
+constexpr Sci::Position backgroundStyleChunkSize = 256*1024;
+
+/**
+ * Lexes one unstyled region on a thread pool worker. The worker sees the real
+ * document through this IDocument shim: reads are delegated to the document,
+ * which is safe because the GUI thread completes the chunk before any
+ * modification, while style bytes, fold levels, line states and decorations
+ * are buffered here and replayed on the GUI thread by
+ * Document::CompleteBackgroundStyling() so the usual notifications are sent.
+ */
+class BackgroundStyler final : public IDocument {
+	Document * const pdoc;
+	Scintilla::ILexer5 * const instance;
+#if USE_WIN32_PTP_WORK
+	PTP_WORK work = nullptr;
+#else
+	HANDLE finishedEvent = nullptr;
+#endif
+	const Sci::Position chunkStart;
+	const Sci::Position chunkEnd;
+	const int initStyle;
+	Sci::Position stylingPos;
+	std::vector<unsigned char> styleBuf;
+	std::vector<std::pair<Sci_Line, int>> levels;
+	std::vector<std::pair<Sci_Line, int>> lineStates;
+	struct FillRange {
+		int indicator;
+		Sci_Position position;
+		int value;
+		Sci_Position length;
+	};
+	std::vector<FillRange> fillRanges;
+	int currentIndicator = 0;
+	Sci::Position changeStart = -1;
+	Sci::Position changeEnd = -1;
+
+	void EnsureStyleCapacity(Sci::Position pos) {
+		if (pos - chunkStart > static_cast<Sci::Position>(styleBuf.size())) {
+			styleBuf.resize(pos - chunkStart);
+		}
+	}
+
+	void Run() noexcept {
+		try {
+			const Sci::Position len = chunkEnd - chunkStart;
+			instance->Lex(chunkStart, len, initStyle, this);
+			instance->Fold(chunkStart, len, initStyle, this);
+		} catch (...) {
+			// drop the chunk; the region will be restyled on the GUI thread
+			stylingPos = chunkStart;
+		}
+	}
+
+#if USE_WIN32_PTP_WORK
+	static VOID CALLBACK WorkCallback([[maybe_unused]] PTP_CALLBACK_INSTANCE callback, PVOID context, [[maybe_unused]] PTP_WORK work_) {
+		static_cast<BackgroundStyler *>(context)->Run();
+	}
+#else
+	static DWORD WINAPI ThreadProc(LPVOID lpParameter) {
+		BackgroundStyler * const styler = static_cast<BackgroundStyler *>(lpParameter);
+		styler->Run();
+		SetEvent(styler->finishedEvent);
+		return 0;
+	}
+#endif
+
+public:
+	BackgroundStyler(Document *pdoc_, Scintilla::ILexer5 *instance_, Sci::Position start, Sci::Position end, int initStyle_) :
+		pdoc(pdoc_), instance(instance_), chunkStart(start), chunkEnd(end), initStyle(initStyle_), stylingPos(start) {
+		styleBuf.resize(end - start);
+	}
+
+	bool Submit() noexcept {
+#if USE_WIN32_PTP_WORK
+		work = CreateThreadpoolWork(WorkCallback, this, nullptr);
+		if (work) {
+			SubmitThreadpoolWork(work);
+		}
+		return work != nullptr;
+#else
+		finishedEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+		if (finishedEvent && !QueueUserWorkItem(ThreadProc, this, WT_EXECUTEDEFAULT)) {
+			CloseHandle(finishedEvent);
+			finishedEvent = nullptr;
+		}
+		return finishedEvent != nullptr;
+#endif
+	}
+
+	void Wait() noexcept {
+#if USE_WIN32_PTP_WORK
+		if (work) {
+			WaitForThreadpoolWorkCallbacks(work, FALSE);
+			CloseThreadpoolWork(work);
+			work = nullptr;
+		}
+#else
+		if (finishedEvent) {
+			WaitForSingleObject(finishedEvent, INFINITE);
+			CloseHandle(finishedEvent);
+			finishedEvent = nullptr;
+		}
+#endif
+	}
+
+	Sci::Position ChunkStart() const noexcept {
+		return chunkStart;
+	}
+
+	// Called on the GUI thread after Wait(): replay the buffered lexer output
+	// through the document so the usual change notifications are sent.
+	void Commit() {
+		const Sci::Position len = std::min(stylingPos, pdoc->Length()) - chunkStart;
+		if (len > 0) {
+			pdoc->StartStyling(chunkStart);
+			pdoc->SetStyles(len, styleBuf.data());
+		}
+		for (const auto &[line, state] : lineStates) {
+			pdoc->SetLineState(line, state);
+		}
+		for (const auto &[line, level] : levels) {
+			pdoc->SetLevel(line, level);
+		}
+		for (const FillRange &fill : fillRanges) {
+			pdoc->DecorationSetCurrentIndicator(fill.indicator);
+			pdoc->DecorationFillRange(fill.position, fill.value, fill.length);
+		}
+		if (changeStart >= 0) {
+			pdoc->ChangeLexerState(changeStart, changeEnd);
+		}
+	}
+
+	// IDocument: reads delegated to the real document, writes buffered.
+	int SCI_METHOD Version() const noexcept override {
+		return pdoc->Version();
+	}
+	void SCI_METHOD SetErrorStatus([[maybe_unused]] int status) noexcept override {}
+	Sci_Position SCI_METHOD Length() const noexcept override {
+		return pdoc->Length();
+	}
+	void SCI_METHOD GetCharRange(char *buffer, Sci_Position position, Sci_Position lengthRetrieve) const noexcept override {
+		pdoc->GetCharRange(buffer, position, lengthRetrieve);
+	}
+	unsigned char SCI_METHOD StyleAt(Sci_Position position) const noexcept override {
+		if (position >= chunkStart && position < stylingPos) {
+			return styleBuf[position - chunkStart];
+		}
+		return pdoc->StyleAt(position);
+	}
+	Sci_Line SCI_METHOD LineFromPosition(Sci_Position position) const noexcept override {
+		return pdoc->LineFromPosition(position);
+	}
+	Sci_Position SCI_METHOD LineStart(Sci_Line line) const noexcept override {
+		return pdoc->LineStart(line);
+	}
+	int SCI_METHOD GetLevel(Sci_Line line) const noexcept override {
+		// most recent write for a line wins, mirroring LineLevels
+		for (auto it = levels.rbegin(); it != levels.rend(); ++it) {
+			if (it->first == line) {
+				return it->second;
+			}
+		}
+		return pdoc->GetLevel(line);
+	}
+	int SCI_METHOD SetLevel(Sci_Line line, int level) override {
+		levels.emplace_back(line, level);
+		return level;
+	}
+	int SCI_METHOD GetLineState(Sci_Line line) const noexcept override {
+		for (auto it = lineStates.rbegin(); it != lineStates.rend(); ++it) {
+			if (it->first == line) {
+				return it->second;
+			}
+		}
+		return pdoc->GetLineState(line);
+	}
+	int SCI_METHOD SetLineState(Sci_Line line, int state) override {
+		lineStates.emplace_back(line, state);
+		return state;
+	}
+	void SCI_METHOD StartStyling(Sci_Position position) noexcept override {
+		stylingPos = position;
+	}
+	bool SCI_METHOD SetStyleFor(Sci_Position length, unsigned char style) override {
+		EnsureStyleCapacity(stylingPos + length);
+		memset(styleBuf.data() + (stylingPos - chunkStart), style, length);
+		stylingPos += length;
+		return true;
+	}
+	bool SCI_METHOD SetStyles(Sci_Position length, const unsigned char *styles) override {
+		EnsureStyleCapacity(stylingPos + length);
+		memcpy(styleBuf.data() + (stylingPos - chunkStart), styles, length);
+		stylingPos += length;
+		return true;
+	}
+	void SCI_METHOD DecorationSetCurrentIndicator(int indicator) noexcept override {
+		currentIndicator = indicator;
+	}
+	void SCI_METHOD DecorationFillRange(Sci_Position position, int value, Sci_Position fillLength) override {
+		fillRanges.push_back({currentIndicator, position, value, fillLength});
+	}
+	void SCI_METHOD ChangeLexerState(Sci_Position start, Sci_Position end) override {
+		changeStart = (changeStart < 0) ? start : std::min(changeStart, start);
+		changeEnd = std::max(changeEnd, end);
+	}
+	int SCI_METHOD CodePage() const noexcept override {
+		return pdoc->CodePage();
+	}
+	bool SCI_METHOD IsDBCSLeadByte(unsigned char ch) const noexcept override {
+		return pdoc->IsDBCSLeadByte(ch);
+	}
+	const char * SCI_METHOD BufferPointer() override {
+		// moving the gap is a modification; no lexer in this tree uses it
+		return nullptr;
+	}
+	int SCI_METHOD GetLineIndentation(Sci_Line line) const noexcept override {
+		return pdoc->GetLineIndentation(line);
+	}
+	Sci_Position SCI_METHOD LineEnd(Sci_Line line) const noexcept override {
+		return pdoc->LineEnd(line);
+	}
+	Sci_Position SCI_METHOD GetRelativePosition(Sci_Position positionStart, Sci_Position characterOffset) const noexcept override {
+		return pdoc->GetRelativePosition(positionStart, characterOffset);
+	}
+	int SCI_METHOD GetCharacterAndWidth(Sci_Position position, Sci_Position *pWidth) const noexcept override {
+		return pdoc->GetCharacterAndWidth(position, pWidth);
+	}
+	CharacterClass SCI_METHOD GetCharacterClass(unsigned int character) const noexcept override {
+		return pdoc->GetCharacterClass(character);
+	}
+};
+
+}
+
 void ActionDuration::AddSample(Sci::Position numberActions, double durationOfActions) noexcept {
 	// Only adjust for multiple actions to avoid instability
 	if (numberActions < unitBytes) {
@@ -151,12 +391,14 @@ Document::Document(DocumentOption options) :
 	perLineData[ldMargin] = std::make_unique<LineAnnotation>();
 	perLineData[ldAnnotation] = std::make_unique<LineAnnotation>();
 	perLineData[ldEOLAnnotation] = std::make_unique<LineAnnotation>();
+	perLineData[ldIndentCache] = std::make_unique<LineIndentCache>();
 
 	cb.SetPerLine(this);
 	cb.SetUTF8Substance(CpUtf8 == dbcsCodePage);
 }
 
 Document::~Document() {
+	CompleteBackgroundStyling(false);
 	for (const auto &watcher : watchers) {
 		watcher.watcher->NotifyDeleted(this, watcher.userData);
 	}
@@ -176,6 +418,43 @@ int SCI_METHOD Document::Release() noexcept {
 	return curRefCount;
 }
 
+namespace {
+
+// Snapshot of the document bytes taken on the UI thread and read from background
+// threads. A single contiguous copy is made at creation: pinning the gap buffer
+// spans instead would break whenever the gap moves, which happens on reads too.
+class TextSnapshot final : public Scintilla::ITextSnapshot {
+	std::atomic<int> refCount {1};
+	const Sci::Position byteLength;
+	const std::unique_ptr<char[]> text;
+public:
+	explicit TextSnapshot(const CellBuffer &cb) :
+		byteLength{cb.Length()}, text{new char[byteLength]} {
+		cb.GetCharRange(text.get(), 0, byteLength);
+	}
+	int SCI_METHOD AddRef() noexcept override {
+		return refCount++;
+	}
+	int SCI_METHOD Release() noexcept override {
+		const int curRefCount = --refCount;
+		if (curRefCount == 0)
+			delete this;
+		return curRefCount;
+	}
+	Sci_Position SCI_METHOD Length() const noexcept override {
+		return byteLength;
+	}
+	const char * SCI_METHOD Data() const noexcept override {
+		return text.get();
+	}
+};
+
+}
+
+ITextSnapshot *Document::CreateSnapshot() const {
+	return new TextSnapshot(cb);
+}
+
 void Document::Init() {
 	for (const auto &pl : perLineData) {
 		if (pl)
@@ -211,6 +490,24 @@ void Document::RemoveLine(Sci::Line line) {
 	}
 }
 
+void Document::RemoveLines(Sci::Line line, Sci::Line lines) {
+	for (const auto &pl : perLineData) {
+		if (pl)
+			pl->RemoveLines(line, lines);
+	}
+}
+
+void Document::CountMemory(Scintilla::MemoryUsage &usage) const noexcept {
+	cb.CountMemory(usage);
+	size_t perLineBytes = 0;
+	for (const std::unique_ptr<PerLine> &pl : perLineData) {
+		if (pl) {
+			perLineBytes += pl->AllocatedBytes();
+		}
+	}
+	usage.perLineBytes = perLineBytes;
+}
+
 LineMarkers *Document::Markers() const noexcept {
 	return static_cast<LineMarkers *>(perLineData[ldMarkers].get());
 }
@@ -235,6 +532,10 @@ LineAnnotation *Document::EOLAnnotations() const noexcept {
 	return static_cast<LineAnnotation *>(perLineData[ldEOLAnnotation].get());
 }
 
+LineIndentCache *Document::IndentCache() const noexcept {
+	return static_cast<LineIndentCache *>(perLineData[ldIndentCache].get());
+}
+
 LineEndType Document::LineEndTypesSupported() const noexcept {
 	if ((CpUtf8 == dbcsCodePage) && pli)
 		return pli->LineEndTypesSupported();
@@ -245,6 +546,7 @@ LineEndType Document::LineEndTypesSupported() const noexcept {
 bool Document::SetDBCSCodePage(int dbcsCodePage_) {
 	if (dbcsCodePage != dbcsCodePage_) {
 		dbcsCodePage = dbcsCodePage_;
+		dbcsBoundaryCache.store(0, std::memory_order_relaxed);
 		pcf.reset();
 		cb.SetLineEndTypes(lineEndBitSet & LineEndTypesSupported());
 		cb.SetUTF8Substance(CpUtf8 == dbcsCodePage);
@@ -331,9 +633,12 @@ void Document::TentativeUndo() {
 					NotifyModified(DocModification(
 						ModificationFlags::BeforeDelete | ModificationFlags::Undo, action));
 				}
-				cb.PerformUndoStep();
-				if (action.at != ActionType::container) {
-					ModifiedAt(action.position);
+				cb.PerformUndoStep(action);
+				if (action.at == ActionType::remove) {
+					// undoing a removal re-inserts the text
+					ModifiedAt(action.position, action.position, action.position + action.lenData);
+				} else if (action.at == ActionType::insert) {
+					ModifiedAt(action.position, action.position + action.lenData, action.position);
 				}
 
 				ModificationFlags modFlags = ModificationFlags::Undo;
@@ -427,22 +732,10 @@ void Document::ChangeLastUndoActionText(size_t length, const char *text) {
 MarkerMask Document::GetMark(Sci::Line line, bool includeChangeHistory) const noexcept {
 	MarkerMask marksHistory = 0;
 	if (includeChangeHistory && (line < LinesTotal())) {
-		MarkerMask marksEdition = 0;
-
 		const Sci::Position start = LineStart(line);
 		const Sci::Position lineNext = LineStart(line + 1);
-		for (Sci::Position position = start; position < lineNext;) {
-			const int edition = EditionAt(position);
-			if (edition) {
-				marksEdition |= 1U << (edition - 1);
-			}
-			position = EditionEndRun(position);
-		}
 		const Sci::Position lineEnd = LineEnd(line);
-		for (Sci::Position position = start; position <= lineEnd;) {
-			marksEdition |= EditionDeletesAt(position);
-			position = EditionNextDelete(position);
-		}
+		const MarkerMask marksEdition = EditionsInRange(start, lineNext, lineEnd);
 
 		/* Bits: RevertedToOrigin, Saved, Modified, RevertedToModified */
 		constexpr unsigned int editionShift = static_cast<unsigned int>(MarkerOutline::HistoryRevertedToOrigin);
@@ -455,6 +748,10 @@ Sci::Line Document::MarkerNext(Sci::Line lineStart, MarkerMask mask) const noexc
 	return Markers()->MarkerNext(lineStart, mask);
 }
 
+Sci::Line Document::MarkerPrevious(Sci::Line lineStart, MarkerMask mask) const noexcept {
+	return Markers()->MarkerPrevious(lineStart, mask);
+}
+
 int Document::AddMark(Sci::Line line, int markerNum) {
 	const Sci::Line lines = LinesTotal();
 	if (IsValidIndex(line, lines)) {
@@ -481,6 +778,25 @@ void Document::AddMarkSet(Sci::Line line, MarkerMask valueSet) {
 	NotifyModified(mh);
 }
 
+void Document::AddMarkList(const Sci::Line *lineList, size_t count, int markerNum) {
+	const Sci::Line lines = LinesTotal();
+	bool someChanges = false;
+	for (size_t i = 0; i < count; i++) {
+		const Sci::Line line = lineList[i];
+		if (IsValidIndex(line, lines)) {
+			Markers()->AddMark(line, markerNum, lines);
+			someChanges = true;
+		}
+	}
+	if (someChanges) {
+		// one notification and one margin redraw for the whole list,
+		// as for DeleteMarkFromHandle()
+		DocModification mh(ModificationFlags::ChangeMarker);
+		mh.line = -1;
+		NotifyModified(mh);
+	}
+}
+
 void Document::DeleteMark(Sci::Line line, int markerNum) {
 	Markers()->DeleteMark(line, markerNum, false);
 	const DocModification mh(ModificationFlags::ChangeMarker, LineStart(line), 0, 0, nullptr, line);
@@ -861,9 +1177,12 @@ Sci::Position Document::MovePositionOutsideChar(Sci::Position pos, int moveDir,
 				// Else invalid UTF-8 so return position of isolated trail byte
 			}
 		} else {
-			// Step back until a non-lead-byte is found.
+			// Step back until a non-lead-byte or an already known character
+			// start is found.
+			const Sci::Position cached = dbcsBoundaryCache.load(std::memory_order_relaxed);
+			const Sci::Position known = (cached <= pos) ? cached : 0;
 			Sci::Position posCheck = pos;
-			while ((posCheck > 0) && IsDBCSLeadByteNoExcept(cb.CharAt(posCheck - 1))) {
+			while ((posCheck > known) && IsDBCSLeadByteNoExcept(cb.CharAt(posCheck - 1))) {
 				posCheck--;
 			}
 
@@ -871,8 +1190,10 @@ Sci::Position Document::MovePositionOutsideChar(Sci::Position pos, int moveDir,
 			while (posCheck < pos) {
 				const int mbsize = IsDBCSDualByteAt(posCheck) ? 2 : 1;
 				if (posCheck + mbsize == pos) {
+					dbcsBoundaryCache.store(posCheck, std::memory_order_relaxed);
 					return pos;
 				} else if (posCheck + mbsize > pos) {
+					dbcsBoundaryCache.store(posCheck, std::memory_order_relaxed);
 					if (moveDir > 0) {
 						return posCheck + mbsize;
 					} else {
@@ -881,6 +1202,7 @@ Sci::Position Document::MovePositionOutsideChar(Sci::Position pos, int moveDir,
 				}
 				posCheck += mbsize;
 			}
+			dbcsBoundaryCache.store(pos, std::memory_order_relaxed);
 		}
 	}
 
@@ -947,21 +1269,26 @@ Sci::Position Document::NextPosition(Sci::Position pos, int moveDir) const noexc
 				if (IsDBCSLeadByteNoExcept(cb.CharAt(pos - 1))) {
 					// Should actually be trail byte
 					if (IsDBCSDualByteAt(pos - 2)) {
+						dbcsBoundaryCache.store(pos - 2, std::memory_order_relaxed);
 						return pos - 2;
 					} else {
 						// Invalid byte pair so treat as one byte wide
 						return pos - 1;
 					}
 				} else {
-					// Otherwise, step back until a non-lead-byte is found.
+					// Otherwise, step back until a non-lead-byte or an already
+					// known character start is found.
+					const Sci::Position cached = dbcsBoundaryCache.load(std::memory_order_relaxed);
+					const Sci::Position known = (cached < pos) ? cached : 0;
 					Sci::Position posTemp = pos - 1;
-					while (--posTemp >= 0 && IsDBCSLeadByteNoExcept(cb.CharAt(posTemp))) {
+					while (--posTemp >= known && IsDBCSLeadByteNoExcept(cb.CharAt(posTemp))) {
 					}
 					// Now posTemp+1 must point to the beginning of a character,
 					// so figure out whether we went back an even or an odd
 					// number of bytes and go back 1 or 2 bytes, respectively.
 					const Sci::Position widthLast = ((pos - posTemp) & 1) + 1;
 					if ((widthLast == 2) && (IsDBCSDualByteAt(pos - widthLast))) {
+						dbcsBoundaryCache.store(pos - widthLast, std::memory_order_relaxed);
 						return pos - widthLast;
 					}
 					// Byte before pos may be valid character or may be an invalid second byte
@@ -1260,6 +1587,38 @@ EncodingFamily Document::CodePageFamily() const noexcept {
 void Document::ModifiedAt(Sci::Position pos) noexcept {
 	if (endStyled > pos)
 		endStyled = pos;
+	// Without knowing what changed (keywords, properties, encoding) the styles
+	// from pos onwards may differ on the next pass, so they can not be adopted.
+	styleValidEnd = std::min(styleValidEnd, pos);
+	styleDamageEnd = std::min(styleDamageEnd, pos);
+	braceMatchCacheCount = 0;
+	braceMatchCacheSlot = 0;
+	if (dbcsBoundaryCache.load(std::memory_order_relaxed) > pos) {
+		// Boundaries before the change are unaffected and a line start is
+		// always a DBCS character start, so resume from the changed line.
+		dbcsBoundaryCache.store(LineStart(SciLineFromPosition(pos)), std::memory_order_relaxed);
+	}
+	// Only the line holding the change can see its whitespace prefix altered;
+	// added and removed lines are handled by InsertLines()/RemoveLines().
+	IndentCache()->Invalidate(SciLineFromPosition(pos));
+}
+
+/**
+ * A text edit replaced [pos, oldEnd) with [pos, newEnd). Styles beyond the
+ * change still match the last pass over the unchanged text, so instead of
+ * discarding them remember how far they reach and how far the pending changes
+ * extend; EnsureStyledTo() uses the pair to stop relexing once a safe-restart
+ * lexer reproduces the stored line state past the changes.
+ */
+void Document::ModifiedAt(Sci::Position pos, Sci::Position oldEnd, Sci::Position newEnd) noexcept {
+	const Sci::Position diff = newEnd - oldEnd;
+	Sci::Position validEnd = std::max(styleValidEnd, endStyled);
+	Sci::Position damageEnd = styleDamageEnd;
+	ModifiedAt(pos);
+	validEnd = (validEnd > oldEnd) ? (validEnd + diff) : std::min(validEnd, pos);
+	damageEnd = (damageEnd > oldEnd) ? (damageEnd + diff) : std::min(damageEnd, pos);
+	styleValidEnd = validEnd;
+	styleDamageEnd = std::max(damageEnd, newEnd);
 }
 
 void Document::CheckReadOnly() noexcept {
@@ -1294,33 +1653,33 @@ bool Document::DeleteChars(Sci::Position pos, Sci::Position len) {
 	CheckReadOnly();
 	if (enteredModification != 0) {
 		return false;
-	} else {
-		enteredModification++;
-		if (!cb.IsReadOnly()) {
-			NotifyModified(
-				DocModification(
-					ModificationFlags::BeforeDelete | ModificationFlags::User,
-					pos, len,
-					0, nullptr));
-			const Sci::Line prevLinesTotal = LinesTotal();
-			const bool startSavePoint = cb.IsSavePoint();
-			bool startSequence = false;
-			const char *text = cb.DeleteChars(pos, len, startSequence);
-			if (startSavePoint && cb.IsCollectingUndo())
-				NotifySavePoint(false);
-			if ((pos < LengthNoExcept()) || (pos == 0))
-				ModifiedAt(pos);
-			else
-				ModifiedAt(pos - 1);
-			NotifyModified(
-				DocModification(
-					ModificationFlags::DeleteText | ModificationFlags::User |
-					(startSequence ? ModificationFlags::StartAction : ModificationFlags::None),
-					pos, len,
-					LinesTotal() - prevLinesTotal, text));
-		}
-		enteredModification--;
 	}
+	CompleteBackgroundStyling(true);
+	enteredModification++;
+	if (!cb.IsReadOnly()) {
+		NotifyModified(
+			DocModification(
+				ModificationFlags::BeforeDelete | ModificationFlags::User,
+				pos, len,
+				0, nullptr));
+		const Sci::Line prevLinesTotal = LinesTotal();
+		const bool startSavePoint = cb.IsSavePoint();
+		bool startSequence = false;
+		const char *text = cb.DeleteChars(pos, len, startSequence);
+		if (startSavePoint && cb.IsCollectingUndo())
+			NotifySavePoint(false);
+		if ((pos < LengthNoExcept()) || (pos == 0))
+			ModifiedAt(pos, pos + len, pos);
+		else
+			ModifiedAt(pos - 1, pos + len, pos);
+		NotifyModified(
+			DocModification(
+				ModificationFlags::DeleteText | ModificationFlags::User |
+				(startSequence ? ModificationFlags::StartAction : ModificationFlags::None),
+				pos, len,
+				LinesTotal() - prevLinesTotal, text));
+	}
+	enteredModification--;
 	return !cb.IsReadOnly();
 }
 
@@ -1355,6 +1714,7 @@ Sci::Position Document::InsertString(Sci::Position position, const char *s, Sci:
 	if (enteredModification != 0) {
 		return 0;
 	}
+	CompleteBackgroundStyling(true);
 	enteredModification++;
 	insertionSet = false;
 	insertion.clear();
@@ -1388,7 +1748,7 @@ Sci::Position Document::InsertString(Sci::Position position, const char *s, Sci:
 #endif
 	if (startSavePoint && cb.IsCollectingUndo())
 		NotifySavePoint(false);
-	ModifiedAt(position);
+	ModifiedAt(position, position, position + insertLength);
 	NotifyModified(
 		DocModification(
 			ModificationFlags::InsertText | ModificationFlags::User |
@@ -1406,6 +1766,138 @@ Sci::Position Document::InsertString(Sci::Position position, std::string_view sv
 	return InsertString(position, sv.data(), sv.length());
 }
 
+/**
+ * Insert the same string before each of count ascending positions as one batch.
+ * Each insertion remains an individual undo action, but watchers are sent one
+ * modification pair describing the whole span as a replacement, so moving
+ * selections, invalidating the display and adjusting container state stay
+ * linear in the number of positions. The text must not contain line end
+ * characters and no position may split a CR+LF; use InsertString() for
+ * anything that changes lines.
+ */
+Sci::Position Document::InsertStringMulti(const Sci::Position *positions, size_t count, const char *s, Sci::Position insertLength) {
+	if (count == 1) {
+		return InsertString(positions[0], s, insertLength);
+	}
+	if (insertLength <= 0 || count == 0) {
+		return 0;
+	}
+	CheckReadOnly();	// Application may change read only state here
+	if (cb.IsReadOnly()) {
+		return 0;
+	}
+	if (enteredModification != 0) {
+		return 0;
+	}
+	CompleteBackgroundStyling(true);
+	enteredModification++;
+	// InsertCheck is not sent: the batch is only used for direct typing and
+	// the insertions could not be changed individually anyway.
+	for (size_t i = 0; i < count; i++) {
+		NotifyModified(
+			DocModification(
+				ModificationFlags::BeforeInsert | ModificationFlags::User,
+				positions[i], insertLength,
+				0, s));
+	}
+	const Sci::Line prevLinesTotal = LinesTotal();
+	const bool startSavePoint = cb.IsSavePoint();
+	bool startSequence = false;
+	for (size_t i = count; i != 0;) {
+		// Insert back to front so earlier positions stay valid and the gap
+		// movement telescopes to a single pass over the span.
+		bool sequence = false;
+		cb.InsertString(positions[--i], s, insertLength, sequence);
+		startSequence = startSequence || sequence;
+	}
+	if (startSavePoint && cb.IsCollectingUndo())
+		NotifySavePoint(false);
+	// Describe the edit as replacing the span between the first and the last
+	// insertion point: positions beyond the span move by the net growth and
+	// everything inside the span is invalidated and rescanned.
+	const Sci::Position spanOld = positions[count - 1] - positions[0];
+	const Sci::Position spanNew = spanOld + insertLength*static_cast<Sci::Position>(count);
+	ModifiedAt(positions[0], positions[0] + spanOld, positions[0] + spanNew);
+	NotifyModified(
+		DocModification(
+			ModificationFlags::DeleteText | ModificationFlags::User,
+			positions[0], spanOld,
+			0, nullptr));
+	NotifyModified(
+		DocModification(
+			ModificationFlags::InsertText | ModificationFlags::User |
+			(startSequence ? ModificationFlags::StartAction : ModificationFlags::None),
+			positions[0], spanNew,
+			LinesTotal() - prevLinesTotal, nullptr));
+	enteredModification--;
+	return insertLength;
+}
+
+/**
+ * Delete count ascending, non-overlapping ranges as one batch. Each deletion
+ * remains an individual undo action, but watchers are sent one modification
+ * pair describing the whole span as a replacement, so moving selections,
+ * invalidating the display and adjusting container state stay linear in the
+ * number of ranges. Ranges must not contain line end characters and must not
+ * split characters; use DeleteChars() for anything that changes lines.
+ */
+bool Document::DeleteRangesMulti(const Sci::Position *positions, const Sci::Position *lengths, size_t count) {
+	if (count == 1) {
+		return DeleteChars(positions[0], lengths[0]);
+	}
+	if (count == 0) {
+		return false;
+	}
+	CheckReadOnly();
+	if (cb.IsReadOnly()) {
+		return false;
+	}
+	if (enteredModification != 0) {
+		return false;
+	}
+	CompleteBackgroundStyling(true);
+	enteredModification++;
+	for (size_t i = 0; i < count; i++) {
+		NotifyModified(
+			DocModification(
+				ModificationFlags::BeforeDelete | ModificationFlags::User,
+				positions[i], lengths[i],
+				0, nullptr));
+	}
+	const bool startSavePoint = cb.IsSavePoint();
+	bool startSequence = false;
+	Sci::Position deletedTotal = 0;
+	for (size_t i = count; i != 0;) {
+		// Delete back to front so earlier positions stay valid and the gap
+		// movement telescopes to a single pass over the span.
+		--i;
+		bool sequence = false;
+		cb.DeleteChars(positions[i], lengths[i], sequence);
+		startSequence = startSequence || sequence;
+		deletedTotal += lengths[i];
+	}
+	if (startSavePoint && cb.IsCollectingUndo())
+		NotifySavePoint(false);
+	// Describe the edit as replacing the span between the first range and the
+	// end of the last: positions beyond the span move by the net shrink and
+	// everything inside the span is invalidated and rescanned.
+	const Sci::Position spanOld = positions[count - 1] + lengths[count - 1] - positions[0];
+	ModifiedAt(positions[0], positions[0] + spanOld, positions[0] + spanOld - deletedTotal);
+	NotifyModified(
+		DocModification(
+			ModificationFlags::DeleteText | ModificationFlags::User |
+			(startSequence ? ModificationFlags::StartAction : ModificationFlags::None),
+			positions[0], spanOld,
+			0, nullptr));
+	NotifyModified(
+		DocModification(
+			ModificationFlags::InsertText | ModificationFlags::User,
+			positions[0], spanOld - deletedTotal,
+			0, nullptr));
+	enteredModification--;
+	return true;
+}
+
 void Document::ChangeInsertion(const char *s, Sci::Position length) {
 	insertionSet = true;
 	insertion.assign(s, length);
@@ -1431,6 +1923,7 @@ Sci::Position Document::Undo() {
 	Sci::Position newPos = -1;
 	CheckReadOnly();
 	if ((enteredModification == 0) && (cb.IsCollectingUndo())) {
+		CompleteBackgroundStyling(true);
 		enteredModification++;
 		if (!cb.IsReadOnly()) {
 			const bool startSavePoint = cb.IsSavePoint();
@@ -1452,9 +1945,14 @@ Sci::Position Document::Undo() {
 					NotifyModified(DocModification(
 						ModificationFlags::BeforeDelete | ModificationFlags::Undo, action));
 				}
-				cb.PerformUndoStep();
+				cb.PerformUndoStep(action);
 				if (action.at != ActionType::container) {
-					ModifiedAt(action.position);
+					if (action.at == ActionType::remove) {
+						// undoing a removal re-inserts the text
+						ModifiedAt(action.position, action.position, action.position + action.lenData);
+					} else {
+						ModifiedAt(action.position, action.position + action.lenData, action.position);
+					}
 					newPos = action.position;
 				}
 
@@ -1500,6 +1998,7 @@ Sci::Position Document::Redo() {
 	Sci::Position newPos = -1;
 	CheckReadOnly();
 	if ((enteredModification == 0) && (cb.IsCollectingUndo())) {
+		CompleteBackgroundStyling(true);
 		enteredModification++;
 		if (!cb.IsReadOnly()) {
 			const bool startSavePoint = cb.IsSavePoint();
@@ -1519,9 +2018,13 @@ Sci::Position Document::Redo() {
 					NotifyModified(DocModification(
 						ModificationFlags::BeforeDelete | ModificationFlags::Redo, action));
 				}
-				cb.PerformRedoStep();
+				cb.PerformRedoStep(action);
 				if (action.at != ActionType::container) {
-					ModifiedAt(action.position);
+					if (action.at == ActionType::insert) {
+						ModifiedAt(action.position, action.position, action.position + action.lenData);
+					} else {
+						ModifiedAt(action.position, action.position + action.lenData, action.position);
+					}
 					newPos = action.position;
 				}
 
@@ -1581,22 +2084,42 @@ static constexpr Sci::Position NextTab(Sci::Position pos, Sci::Position tabSize)
 	return ((pos / tabSize) + 1) * tabSize;
 }
 
-int SCI_METHOD Document::GetLineIndentation(Sci_Line line) const noexcept {
-	int indent = 0;
-	if (IsValidIndex(line, LinesTotal())) {
-		const Sci::Position lineStart = LineStart(line);
-		const Sci::Position length = LengthNoExcept();
-		for (Sci::Position i = lineStart; i < length; i++) {
+// Encoded cache entry for the line: the indentation width with
+// LineIndentCache::whiteLineFlag set when the line is all whitespace.
+int Document::LineIndentValue(Sci::Line line) const noexcept {
+	LineIndentCache * const indentCache = IndentCache();
+	int value = indentCache->ValueAt(line);
+	if (value == LineIndentCache::unknownValue) {
+		int indent = 0;
+		const Sci::Position endLine = LineEnd(line);
+		Sci::Position i = LineStart(line);
+		for (; i < endLine; i++) {
 			const char ch = cb.CharAt(i);
 			if (ch == ' ')
 				indent++;
 			else if (ch == '\t')
 				indent = static_cast<int>(NextTab(indent, tabInChars));
 			else
-				return indent;
+				break;
+		}
+		value = indent;
+		if (i == endLine) {
+			value |= LineIndentCache::whiteLineFlag;
 		}
+		indentCache->SetValue(line, value, LinesTotal());
 	}
-	return indent;
+	return value;
+}
+
+int SCI_METHOD Document::GetLineIndentation(Sci_Line line) const noexcept {
+	if (IsValidIndex(line, LinesTotal())) {
+		return LineIndentValue(line) & ~LineIndentCache::whiteLineFlag;
+	}
+	return 0;
+}
+
+void Document::ClearIndentCache() {
+	IndentCache()->Init();
 }
 
 Sci::Position Document::SetLineIndentation(Sci::Line line, Sci::Position indent) {
@@ -1665,6 +2188,24 @@ Sci::Position Document::GetColumn(Sci::Position pos) const noexcept {
 Sci::Position Document::CountCharacters(Sci::Position startPos, Sci::Position endPos) const noexcept {
 	startPos = MovePositionOutsideChar(startPos, 1, false);
 	endPos = MovePositionOutsideChar(endPos, -1, false);
+	if (dbcsCodePage == 0) {
+		return endPos - startPos;
+	}
+	if (CpUtf8 == dbcsCodePage && FlagSet(LineCharacterIndex(), LineCharacterIndexType::Utf32)) {
+		// the line vector maintains per-line character counts incrementally,
+		// so only the partial lines at either end need to be scanned.
+		const Sci::Line lineStart = SciLineFromPosition(startPos);
+		const Sci::Line lineEnd = SciLineFromPosition(endPos);
+		Sci::Position count = cb.IndexLineStart(lineEnd, LineCharacterIndexType::Utf32)
+			- cb.IndexLineStart(lineStart, LineCharacterIndexType::Utf32);
+		for (Sci::Position i = LineStart(lineEnd); i < endPos; i = NextPosition(i, 1)) {
+			count++;
+		}
+		for (Sci::Position i = LineStart(lineStart); i < startPos; i = NextPosition(i, 1)) {
+			count--;
+		}
+		return count;
+	}
 	Sci::Position count = 0;
 	Sci::Position i = startPos;
 	while (i < endPos) {
@@ -1704,6 +2245,27 @@ void Document::CountCharactersAndColumns(sptr_t lParam) const noexcept {
 Sci::Position Document::CountUTF16(Sci::Position startPos, Sci::Position endPos) const noexcept {
 	startPos = MovePositionOutsideChar(startPos, 1, false);
 	endPos = MovePositionOutsideChar(endPos, -1, false);
+	if (dbcsCodePage == 0) {
+		return endPos - startPos;
+	}
+	if (CpUtf8 == dbcsCodePage && FlagSet(LineCharacterIndex(), LineCharacterIndexType::Utf16)) {
+		// as in CountCharacters(), only the partial end lines need scanning.
+		const Sci::Line lineStart = SciLineFromPosition(startPos);
+		const Sci::Line lineEnd = SciLineFromPosition(endPos);
+		Sci::Position count = cb.IndexLineStart(lineEnd, LineCharacterIndexType::Utf16)
+			- cb.IndexLineStart(lineStart, LineCharacterIndexType::Utf16);
+		for (Sci::Position i = LineStart(lineEnd); i < endPos;) {
+			const Sci::Position next = NextPosition(i, 1);
+			count += ((next - i) > 3) ? 2 : 1;
+			i = next;
+		}
+		for (Sci::Position i = LineStart(lineStart); i < startPos;) {
+			const Sci::Position next = NextPosition(i, 1);
+			count -= ((next - i) > 3) ? 2 : 1;
+			i = next;
+		}
+		return count;
+	}
 	Sci::Position count = 0;
 	Sci::Position i = startPos;
 	while (i < endPos) {
@@ -1793,6 +2355,67 @@ std::string Document::TransformLineEnds(const char *s, size_t len, EndOfLine eol
 void Document::ConvertLineEnds(EndOfLine eolModeSet) {
 	const UndoGroup ug(this);
 
+	if (!IsActive()) {
+		// No per-line data so line ends can be rewritten in large chunks with one
+		// delete and insert per span, avoiding an undo action, notification and
+		// line vector update for every line end converted. The per-line edits
+		// below are kept when markers or other per-line data exist as deleting a
+		// span of lines would merge their data into the first line of the span.
+		const std::string_view eol = EOLForMode(eolModeSet);
+		constexpr Sci::Position chunkBytes = 1024*1024;
+		const std::unique_ptr<char[]> buffer = std::make_unique<char[]>(chunkBytes + 2);
+		std::string converted;
+		Sci::Position pos = 0;
+		while (pos < LengthNoExcept()) {
+			Sci::Position lengthChunk = std::min<Sci::Position>(chunkBytes, LengthNoExcept() - pos);
+			if (cb.CharAt(pos + lengthChunk - 1) == '\r' && cb.CharAt(pos + lengthChunk) == '\n') {
+				// Keep a CR+LF pair inside one chunk
+				lengthChunk++;
+			}
+			GetCharRange(buffer.get(), pos, lengthChunk);
+			buffer[lengthChunk] = '\0';
+			// Bound the span to rewrite by the first and last line end to convert
+			// so a chunk with conforming line ends is only scanned, never edited.
+			Sci::Position firstBad = -1;
+			Sci::Position lastBadEnd = 0;
+			for (Sci::Position i = 0; i < lengthChunk; i++) {
+				const char ch = buffer[i];
+				if (IsEOLCharacter(ch)) {
+					const Sci::Position lengthEol = ((ch == '\r') && (buffer[i + 1] == '\n')) ? 2 : 1;
+					if (lengthEol != static_cast<Sci::Position>(eol.length()) || ch != eol[0]) {
+						if (firstBad < 0) {
+							firstBad = i;
+						}
+						lastBadEnd = i + lengthEol;
+					}
+					i += lengthEol - 1;
+				}
+			}
+			if (firstBad < 0) {
+				pos += lengthChunk;
+				continue;
+			}
+			// Not TransformLineEnds() as the text may contain NUL characters.
+			converted.clear();
+			for (Sci::Position i = firstBad; i < lastBadEnd; i++) {
+				const char ch = buffer[i];
+				if (IsEOLCharacter(ch)) {
+					converted.append(eol);
+					if ((ch == '\r') && (buffer[i + 1] == '\n')) {
+						i++;
+					}
+				} else {
+					converted.push_back(ch);
+				}
+			}
+			const Sci::Position posBad = pos + firstBad;
+			DeleteChars(posBad, lastBadEnd - firstBad);
+			InsertString(posBad, converted.data(), converted.length());
+			pos = posBad + converted.length() + lengthChunk - lastBadEnd;
+		}
+		return;
+	}
+
 	for (Sci::Position pos = 0; pos < LengthNoExcept(); pos++) {
 		const char ch = cb.CharAt(pos);
 		if (ch == '\r') {
@@ -1838,13 +2461,8 @@ DocumentOption Document::Options() const noexcept {
 }
 
 bool Document::IsWhiteLine(Sci::Line line) const noexcept {
-	Sci::Position currentChar = LineStart(line);
-	const Sci::Position endLine = LineEnd(line);
-	while (currentChar < endLine) {
-		if (!IsSpaceOrTab(cb.CharAt(currentChar))) {
-			return false;
-		}
-		++currentChar;
+	if (IsValidIndex(line, LinesTotal())) {
+		return (LineIndentValue(line) & LineIndentCache::whiteLineFlag) != 0;
 	}
 	return true;
 }
@@ -1891,6 +2509,74 @@ CharacterClass SCI_METHOD Document::GetCharacterClass(unsigned int ch) const noe
 	return charClass.GetClass(static_cast<unsigned char>(ch));
 }
 
+/**
+ * Move forward over the run of characters sharing class ccStart, returning the
+ * position after the run. Equivalent to stepping CharacterAfter() one character
+ * at a time, but bytes below 0x80 are classified straight from the class table
+ * over the contiguous buffer segments, which is what makes word movement and
+ * double-click selection usable on multi-megabyte minified lines.
+ */
+Sci::Position Document::WordRunEnd(Sci::Position pos, CharacterClass ccStart) const noexcept {
+	const Sci::Position length = LengthNoExcept();
+	if (dbcsCodePage == 0 || CpUtf8 == dbcsCodePage) {
+		const SplitView cbView = cb.AllView();
+		while (pos < length) {
+			const unsigned char ch = cbView[pos];
+			if (dbcsCodePage && ch >= 0x80) {
+				const CharacterExtracted ce = CharacterAfter(pos);
+				if (WordCharacterClass(ce.character) != ccStart)
+					break;
+				pos += ce.widthBytes;
+			} else {
+				if (charClass.GetClass(ch) != ccStart)
+					break;
+				pos++;
+			}
+		}
+	} else {
+		while (pos < length) {
+			const CharacterExtracted ce = CharacterAfter(pos);
+			if (WordCharacterClass(ce.character) != ccStart)
+				break;
+			pos += ce.widthBytes;
+		}
+	}
+	return pos;
+}
+
+/**
+ * Move backward over the run of characters sharing class ccStart, returning the
+ * first position of the run. A byte below 0x80 is a whole character in both
+ * UTF-8 and single byte encodings, so those are classified straight from the
+ * class table without resynchronizing backwards.
+ */
+Sci::Position Document::WordRunStart(Sci::Position pos, CharacterClass ccStart) const noexcept {
+	if (dbcsCodePage == 0 || CpUtf8 == dbcsCodePage) {
+		const SplitView cbView = cb.AllView();
+		while (pos > 0) {
+			const unsigned char ch = cbView[pos - 1];
+			if (dbcsCodePage && ch >= 0x80) {
+				const CharacterExtracted ce = CharacterBefore(pos);
+				if (WordCharacterClass(ce.character) != ccStart)
+					break;
+				pos -= ce.widthBytes;
+			} else {
+				if (charClass.GetClass(ch) != ccStart)
+					break;
+				pos--;
+			}
+		}
+	} else {
+		while (pos > 0) {
+			const CharacterExtracted ce = CharacterBefore(pos);
+			if (WordCharacterClass(ce.character) != ccStart)
+				break;
+			pos -= ce.widthBytes;
+		}
+	}
+	return pos;
+}
+
 /**
  * Used by commands that want to select whole words.
  * Finds the start of word at pos when delta < 0 or the end of the word when delta >= 0.
@@ -1908,13 +2594,7 @@ Sci::Position Document::ExtendWordSelect(Sci::Position pos, int delta, bool only
 				return MovePositionOutsideChar(pos, delta, true);
 			}
 		}
-		//const int style = StyleIndexAt(pos);
-		while (pos > 0) {
-			const CharacterExtracted ce = CharacterBefore(pos);
-			if (/*StyleIndexAt(pos - 1) != style || */WordCharacterClass(ce.character) != ccStart)
-				break;
-			pos -= ce.widthBytes;
-		}
+		pos = WordRunStart(pos, ccStart);
 	} else {
 		if (pos < LengthNoExcept()) {
 			const CharacterExtracted ce = CharacterAfter(pos);
@@ -1926,13 +2606,7 @@ Sci::Position Document::ExtendWordSelect(Sci::Position pos, int delta, bool only
 				return MovePositionOutsideChar(pos, delta, true);
 			}
 		}
-		//const int style = StyleIndexAt(pos - 1);
-		while (pos < LengthNoExcept()) {
-			const CharacterExtracted ce = CharacterAfter(pos);
-			if (/*StyleIndexAt(pos) != style || */WordCharacterClass(ce.character) != ccStart)
-				break;
-			pos += ce.widthBytes;
-		}
+		pos = WordRunEnd(pos, ccStart);
 	}
 	return MovePositionOutsideChar(pos, delta, true);
 }
@@ -1946,37 +2620,15 @@ Sci::Position Document::ExtendWordSelect(Sci::Position pos, int delta, bool only
  */
 Sci::Position Document::NextWordStart(Sci::Position pos, int delta) const noexcept {
 	if (delta < 0) {
-		while (pos > 0) {
-			const CharacterExtracted ce = CharacterBefore(pos);
-			if (WordCharacterClass(ce.character) != CharacterClass::space)
-				break;
-			pos -= ce.widthBytes;
-		}
+		pos = WordRunStart(pos, CharacterClass::space);
 		if (pos > 0) {
-			CharacterExtracted ce = CharacterBefore(pos);
-			const CharacterClass ccStart = WordCharacterClass(ce.character);
-			while (pos > 0) {
-				ce = CharacterBefore(pos);
-				if (WordCharacterClass(ce.character) != ccStart)
-					break;
-				pos -= ce.widthBytes;
-			}
+			const CharacterExtracted ce = CharacterBefore(pos);
+			pos = WordRunStart(pos, WordCharacterClass(ce.character));
 		}
 	} else {
-		CharacterExtracted ce = CharacterAfter(pos);
-		const CharacterClass ccStart = WordCharacterClass(ce.character);
-		while (pos < LengthNoExcept()) {
-			ce = CharacterAfter(pos);
-			if (WordCharacterClass(ce.character) != ccStart)
-				break;
-			pos += ce.widthBytes;
-		}
-		while (pos < LengthNoExcept()) {
-			ce = CharacterAfter(pos);
-			if (WordCharacterClass(ce.character) != CharacterClass::space)
-				break;
-			pos += ce.widthBytes;
-		}
+		const CharacterExtracted ce = CharacterAfter(pos);
+		pos = WordRunEnd(pos, WordCharacterClass(ce.character));
+		pos = WordRunEnd(pos, CharacterClass::space);
 	}
 	return pos;
 }
@@ -1991,39 +2643,18 @@ Sci::Position Document::NextWordStart(Sci::Position pos, int delta) const noexce
 Sci::Position Document::NextWordEnd(Sci::Position pos, int delta) const noexcept {
 	if (delta < 0) {
 		if (pos > 0) {
-			CharacterExtracted ce = CharacterBefore(pos);
+			const CharacterExtracted ce = CharacterBefore(pos);
 			const CharacterClass ccStart = WordCharacterClass(ce.character);
 			if (ccStart != CharacterClass::space) {
-				while (pos > 0) {
-					ce = CharacterBefore(pos);
-					if (WordCharacterClass(ce.character) != ccStart)
-						break;
-					pos -= ce.widthBytes;
-				}
-			}
-			while (pos > 0) {
-				ce = CharacterBefore(pos);
-				if (WordCharacterClass(ce.character) != CharacterClass::space)
-					break;
-				pos -= ce.widthBytes;
+				pos = WordRunStart(pos, ccStart);
 			}
+			pos = WordRunStart(pos, CharacterClass::space);
 		}
 	} else {
-		while (pos < LengthNoExcept()) {
-			const CharacterExtracted ce = CharacterAfter(pos);
-			if (WordCharacterClass(ce.character) != CharacterClass::space)
-				break;
-			pos += ce.widthBytes;
-		}
+		pos = WordRunEnd(pos, CharacterClass::space);
 		if (pos < LengthNoExcept()) {
-			CharacterExtracted ce = CharacterAfter(pos);
-			const CharacterClass ccStart = WordCharacterClass(ce.character);
-			while (pos < LengthNoExcept()) {
-				ce = CharacterAfter(pos);
-				if (WordCharacterClass(ce.character) != ccStart)
-					break;
-				pos += ce.widthBytes;
-			}
+			const CharacterExtracted ce = CharacterAfter(pos);
+			pos = WordRunEnd(pos, WordCharacterClass(ce.character));
 		}
 	}
 	return pos;
@@ -2170,6 +2801,165 @@ void Document::ExtractCharacter(Sci::Position position, CharacterWideInfo &charI
  * searches (just pass minPos > maxPos to do a backward search)
  * Has not been tested with backwards DBCS searches yet.
  */
+#if NP2_USE_AVX2 || NP2_USE_SSE2
+namespace {
+
+// Scan [pos, candidateEnd) of one contiguous buffer segment for searchData,
+// comparing the first and last pattern bytes over a whole vector and checking
+// the middle with memcmp, see https://0x80.pl/articles/simd-strfind.html.
+// The caller guarantees lengthFind >= 2 and that the pattern fits below
+// candidateEnd + lengthFind - 1 inside the segment.
+Sci::Position FindLiteralInSegment(const unsigned char *base, Sci::Position pos, Sci::Position candidateEnd,
+	const unsigned char *searchData, Sci::Position lengthFind) noexcept {
+	const unsigned char charStart = searchData[0];
+	const unsigned char charLast = searchData[lengthFind - 1];
+#if NP2_USE_AVX2
+	const __m256i vectFirst = mm256_set1_epi8(charStart);
+	const __m256i vectLast = mm256_set1_epi8(charLast);
+	while (pos + static_cast<Sci::Position>(sizeof(__m256i)) <= candidateEnd) {
+		const __m256i chunkFirst = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(base + pos));
+		const __m256i chunkLast = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(base + pos + lengthFind - 1));
+		uint32_t mask = mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(chunkFirst, vectFirst), _mm256_cmpeq_epi8(chunkLast, vectLast)));
+		while (mask != 0) {
+			const uint32_t trailing = np2_ctz(mask);
+			mask &= mask - 1;
+			const Sci::Position match = pos + trailing;
+			if (memcmp(base + match + 1, searchData + 1, lengthFind - 2) == 0) {
+				return match;
+			}
+		}
+		pos += sizeof(__m256i);
+	}
+#elif NP2_USE_SSE2
+	const __m128i vectFirst = _mm_set1_epi8(charStart);
+	const __m128i vectLast = _mm_set1_epi8(charLast);
+	while (pos + static_cast<Sci::Position>(sizeof(__m128i)) <= candidateEnd) {
+		const __m128i chunkFirst = _mm_loadu_si128(reinterpret_cast<const __m128i *>(base + pos));
+		const __m128i chunkLast = _mm_loadu_si128(reinterpret_cast<const __m128i *>(base + pos + lengthFind - 1));
+		uint32_t mask = mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(chunkFirst, vectFirst), _mm_cmpeq_epi8(chunkLast, vectLast)));
+		while (mask != 0) {
+			const uint32_t trailing = np2_ctz(mask);
+			mask &= mask - 1;
+			const Sci::Position match = pos + trailing;
+			if (memcmp(base + match + 1, searchData + 1, lengthFind - 2) == 0) {
+				return match;
+			}
+		}
+		pos += sizeof(__m128i);
+	}
+#endif
+	while (pos < candidateEnd) {
+		if (base[pos] == charStart && base[pos + lengthFind - 1] == charLast
+			&& memcmp(base + pos + 1, searchData + 1, lengthFind - 2) == 0) {
+			return pos;
+		}
+		pos++;
+	}
+	return -1;
+}
+
+// Mirror of FindLiteralInSegment for backward search: scan candidate start
+// positions [candidateFirst, pos] of one contiguous buffer segment from the
+// end, taking the highest set bit of each vector mask so the last occurrence
+// is found first. Same caller guarantees as the forward kernel.
+Sci::Position FindLastLiteralInSegment(const unsigned char *base, Sci::Position candidateFirst, Sci::Position pos,
+	const unsigned char *searchData, Sci::Position lengthFind) noexcept {
+	const unsigned char charStart = searchData[0];
+	const unsigned char charLast = searchData[lengthFind - 1];
+#if NP2_USE_AVX2
+	const __m256i vectFirst = mm256_set1_epi8(charStart);
+	const __m256i vectLast = mm256_set1_epi8(charLast);
+	while (pos - candidateFirst + 1 >= static_cast<Sci::Position>(sizeof(__m256i))) {
+		const Sci::Position block = pos - sizeof(__m256i) + 1;
+		const __m256i chunkFirst = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(base + block));
+		const __m256i chunkLast = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(base + block + lengthFind - 1));
+		uint32_t mask = mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(chunkFirst, vectFirst), _mm256_cmpeq_epi8(chunkLast, vectLast)));
+		while (mask != 0) {
+			const uint32_t leading = np2_bsr(mask);
+			mask ^= 1U << leading;
+			const Sci::Position match = block + leading;
+			if (memcmp(base + match + 1, searchData + 1, lengthFind - 2) == 0) {
+				return match;
+			}
+		}
+		pos = block - 1;
+	}
+#elif NP2_USE_SSE2
+	const __m128i vectFirst = _mm_set1_epi8(charStart);
+	const __m128i vectLast = _mm_set1_epi8(charLast);
+	while (pos - candidateFirst + 1 >= static_cast<Sci::Position>(sizeof(__m128i))) {
+		const Sci::Position block = pos - sizeof(__m128i) + 1;
+		const __m128i chunkFirst = _mm_loadu_si128(reinterpret_cast<const __m128i *>(base + block));
+		const __m128i chunkLast = _mm_loadu_si128(reinterpret_cast<const __m128i *>(base + block + lengthFind - 1));
+		uint32_t mask = mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(chunkFirst, vectFirst), _mm_cmpeq_epi8(chunkLast, vectLast)));
+		while (mask != 0) {
+			const uint32_t leading = np2_bsr(mask);
+			mask ^= 1U << leading;
+			const Sci::Position match = block + leading;
+			if (memcmp(base + match + 1, searchData + 1, lengthFind - 2) == 0) {
+				return match;
+			}
+		}
+		pos = block - 1;
+	}
+#endif
+	while (pos >= candidateFirst) {
+		if (base[pos] == charStart && base[pos + lengthFind - 1] == charLast
+			&& memcmp(base + pos + 1, searchData + 1, lengthFind - 2) == 0) {
+			return pos;
+		}
+		pos--;
+	}
+	return -1;
+}
+
+// Scan [pos, end) of one contiguous buffer segment for the next byte that may
+// start a case-insensitive match: either case variant of the folded pattern's
+// first byte, or any non-ASCII byte since a multi-byte character can fold to
+// ASCII (e.g. U+212A KELVIN SIGN folds to 'k'). Candidates are verified by the
+// caller; returns end when the segment holds no candidate.
+Sci::Position FindCaseCandidateInSegment(const unsigned char *base, Sci::Position pos, Sci::Position end,
+	unsigned char chLower, unsigned char chUpper) noexcept {
+#if NP2_USE_AVX2
+	const __m256i vectLower = mm256_set1_epi8(chLower);
+	const __m256i vectUpper = mm256_set1_epi8(chUpper);
+	while (pos + static_cast<Sci::Position>(sizeof(__m256i)) <= end) {
+		const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(base + pos));
+		// the sign bit marks non-ASCII bytes, so one movemask also collects them
+		const uint32_t mask = mm256_movemask_epi8(_mm256_or_si256(chunk,
+			_mm256_or_si256(_mm256_cmpeq_epi8(chunk, vectLower), _mm256_cmpeq_epi8(chunk, vectUpper))));
+		if (mask != 0) {
+			return pos + np2_ctz(mask);
+		}
+		pos += sizeof(__m256i);
+	}
+#elif NP2_USE_SSE2
+	const __m128i vectLower = _mm_set1_epi8(chLower);
+	const __m128i vectUpper = _mm_set1_epi8(chUpper);
+	while (pos + static_cast<Sci::Position>(sizeof(__m128i)) <= end) {
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(base + pos));
+		// the sign bit marks non-ASCII bytes, so one movemask also collects them
+		const uint32_t mask = mm_movemask_epi8(_mm_or_si128(chunk,
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, vectLower), _mm_cmpeq_epi8(chunk, vectUpper))));
+		if (mask != 0) {
+			return pos + np2_ctz(mask);
+		}
+		pos += sizeof(__m128i);
+	}
+#endif
+	while (pos < end) {
+		const unsigned char ch = base[pos];
+		if (ch == chLower || ch == chUpper || ch >= 0x80) {
+			return pos;
+		}
+		pos++;
+	}
+	return end;
+}
+
+}
+#endif
+
 Sci::Position Document::FindText(Sci::Position minPos, Sci::Position maxPos, const char *search, FindOption flags, Sci::Position *length) {
 	if (*length <= 0) {
 		return minPos;
@@ -2244,6 +3034,95 @@ Sci::Position Document::FindText(Sci::Position minPos, Sci::Position maxPos, con
 			const Sci::Position skip = (direction >= 0) ? lengthFind : -1;
 			const unsigned char safeChar = (skip == 1) ? forwardSafeChar : backwardSafeChar;
 			const unsigned char charStartSearch = searchData[0];
+#if NP2_USE_AVX2 || NP2_USE_SSE2
+			if (direction >= 0 && lengthFind != 1 && forwardSafeChar == 0xff) {
+				// Every byte can be tested directly (UTF-8 / single byte code page),
+				// so candidates are found with a SIMD first/last byte scan over each
+				// contiguous segment; matches straddling the gap are checked here.
+				const Sci::Position length1 = static_cast<Sci::Position>(cbView.length1);
+				const Sci::Position endSearch1 = std::min(endSearch, length1 - lengthFind + 1);
+				while (pos < endSearch1) {
+					const Sci::Position match = FindLiteralInSegment(reinterpret_cast<const unsigned char *>(cbView.segment1),
+						pos, endSearch1, searchData, lengthFind);
+					if (match < 0) {
+						break;
+					}
+					if (MatchesWordOptions(word, wordStart, match, lengthFind)) {
+						return match;
+					}
+					pos = match + 1;
+				}
+				// positions whose match would straddle the segment boundary
+				pos = std::max(pos, endSearch1);
+				const Sci::Position straddleEnd = std::min(endSearch, length1);
+				for (; pos < straddleEnd; pos++) {
+					if (charStartSearch == static_cast<unsigned char>(cbView[pos])) {
+						bool found = true;
+						for (Sci::Position indexSearch = 1; (indexSearch < lengthFind) && found; indexSearch++) {
+							found = static_cast<unsigned char>(cbView[pos + indexSearch]) == searchData[indexSearch];
+						}
+						if (found && MatchesWordOptions(word, wordStart, pos, lengthFind)) {
+							return pos;
+						}
+					}
+				}
+				while (pos < endSearch) {
+					const Sci::Position match = FindLiteralInSegment(reinterpret_cast<const unsigned char *>(cbView.segment2),
+						pos, endSearch, searchData, lengthFind);
+					if (match < 0) {
+						break;
+					}
+					if (MatchesWordOptions(word, wordStart, match, lengthFind)) {
+						return match;
+					}
+					pos = match + 1;
+				}
+				return -1;
+			}
+			if (direction < 0 && lengthFind != 1 && backwardSafeChar == 0xff) {
+				// Mirror of the forward scan for Find Previous: walk the segments
+				// from the end, taking the last candidate of each vector first.
+				const Sci::Position length1 = static_cast<Sci::Position>(cbView.length1);
+				pos -= lengthFind;	// highest candidate start position
+				while (pos >= length1 && pos >= endSearch) {
+					const Sci::Position match = FindLastLiteralInSegment(reinterpret_cast<const unsigned char *>(cbView.segment2),
+						std::max(endSearch, length1), pos, searchData, lengthFind);
+					if (match < 0) {
+						break;
+					}
+					if (MatchesWordOptions(word, wordStart, match, lengthFind)) {
+						return match;
+					}
+					pos = match - 1;
+				}
+				// positions whose match would straddle the segment boundary
+				pos = std::min(pos, length1 - 1);
+				const Sci::Position straddleStart = std::max(endSearch, length1 - lengthFind + 1);
+				for (; pos >= straddleStart; pos--) {
+					if (charStartSearch == static_cast<unsigned char>(cbView[pos])) {
+						bool found = true;
+						for (Sci::Position indexSearch = 1; (indexSearch < lengthFind) && found; indexSearch++) {
+							found = static_cast<unsigned char>(cbView[pos + indexSearch]) == searchData[indexSearch];
+						}
+						if (found && MatchesWordOptions(word, wordStart, pos, lengthFind)) {
+							return pos;
+						}
+					}
+				}
+				while (pos >= endSearch) {
+					const Sci::Position match = FindLastLiteralInSegment(reinterpret_cast<const unsigned char *>(cbView.segment1),
+						endSearch, pos, searchData, lengthFind);
+					if (match < 0) {
+						break;
+					}
+					if (MatchesWordOptions(word, wordStart, match, lengthFind)) {
+						return match;
+					}
+					pos = match - 1;
+				}
+				return -1;
+			}
+#endif
 			if (direction < 0) {
 				pos = MovePositionOutsideChar(pos - lengthFind, -1, false);
 			}
@@ -2282,8 +3161,31 @@ Sci::Position Document::FindText(Sci::Position minPos, Sci::Position maxPos, con
 			searchThing.Allocate((lengthFind + 1) * UTF8MaxBytes * maxFoldingExpansion + 1);
 			const size_t lenSearch = pcf->Fold(searchThing.data(), searchThing.size(), search, lengthFind);
 			const unsigned char * const searchData = reinterpret_cast<const unsigned char *>(searchThing.data());
+#if NP2_USE_AVX2 || NP2_USE_SSE2
+			// Forward searches for a pattern folding to an ASCII first byte can skip
+			// runs of ASCII that start no match with a SIMD scan over each segment.
+			const bool scanCandidates = direction >= 0 && UTF8IsAscii(searchData[0]);
+			const unsigned char chLower = searchData[0];
+			const unsigned char chUpper = MakeUpperCase(chLower);
+			const Sci::Position length1 = static_cast<Sci::Position>(cbView.length1);
+#endif
 			//while (forward ? (pos < endPos) : (pos >= endPos)) {
 			while ((direction ^ (pos - endPos)) < 0) {
+#if NP2_USE_AVX2 || NP2_USE_SSE2
+				if (scanCandidates) {
+					if (pos < length1) {
+						pos = FindCaseCandidateInSegment(reinterpret_cast<const unsigned char *>(cbView.segment1),
+							pos, std::min(endPos, length1), chLower, chUpper);
+					}
+					if (pos >= length1 && pos < endPos) {
+						pos = FindCaseCandidateInSegment(reinterpret_cast<const unsigned char *>(cbView.segment2),
+							pos, endPos, chLower, chUpper);
+					}
+					if (pos >= endPos) {
+						break;
+					}
+				}
+#endif
 				int widthFirstCharacter = 1;
 				Sci::Position posIndexDocument = pos;
 				size_t indexSearch = 0;
@@ -2404,8 +3306,30 @@ Sci::Position Document::FindText(Sci::Position minPos, Sci::Position maxPos, con
 			searchThing.Allocate(lengthFind + 1);
 			pcf->Fold(searchThing.data(), searchThing.size(), search, lengthFind);
 			const char * const searchData = searchThing.data();
+#if NP2_USE_AVX2 || NP2_USE_SSE2
+			// ASCII folds to ASCII here, so skipping ASCII bytes that match neither
+			// case variant of the folded first byte is safe for any folding table.
+			const unsigned char chLower = searchData[0];
+			const unsigned char chUpper = MakeUpperCase(chLower);
+			const Sci::Position length1 = static_cast<Sci::Position>(cbView.length1);
+#endif
 			//while (forward ? (pos < endSearch) : (pos >= endSearch)) {
 			while ((direction ^ (pos - endSearch)) < 0) {
+#if NP2_USE_AVX2 || NP2_USE_SSE2
+				if (direction >= 0) {
+					if (pos < length1) {
+						pos = FindCaseCandidateInSegment(reinterpret_cast<const unsigned char *>(cbView.segment1),
+							pos, std::min(endSearch, length1), chLower, chUpper);
+					}
+					if (pos >= length1 && pos < endSearch) {
+						pos = FindCaseCandidateInSegment(reinterpret_cast<const unsigned char *>(cbView.segment2),
+							pos, endSearch, chLower, chUpper);
+					}
+					if (pos >= endSearch) {
+						break;
+					}
+				}
+#endif
 				bool found = (pos + lengthFind) <= limitPos;
 				for (Sci::Position indexSearch = 0; (indexSearch < lengthFind) && found; indexSearch++) {
 					const char ch = cbView[pos + indexSearch];
@@ -2504,19 +3428,13 @@ bool SCI_METHOD Document::SetStyles(Sci_Position length, const unsigned char *st
 		return false;
 	} else {
 		enteredStyling++;
-		bool didChange = false;
+		PLATFORM_ASSERT(endStyled + length <= LengthNoExcept());
 		Sci::Position startMod = 0;
 		Sci::Position endMod = 0;
-		for (int iPos = 0; iPos < length; iPos++, endStyled++) {
-			PLATFORM_ASSERT(endStyled < LengthNoExcept());
-			if (cb.SetStyleAt(endStyled, styles[iPos])) {
-				if (!didChange) {
-					startMod = endStyled;
-				}
-				didChange = true;
-				endMod = endStyled;
-			}
-		}
+		// bulk adoption of the lexer's style buffer, comparing spans instead of
+		// cells so initial styling of a fresh document is a single copy.
+		const bool didChange = cb.SetStyles(endStyled, reinterpret_cast<const char *>(styles), length, startMod, endMod);
+		endStyled += length;
 		if (didChange) {
 			const DocModification mh(ModificationFlags::ChangeStyle | ModificationFlags::User,
 				startMod, endMod - startMod + 1);
@@ -2529,10 +3447,50 @@ bool SCI_METHOD Document::SetStyles(Sci_Position length, const unsigned char *st
 
 void Document::EnsureStyledTo(Sci::Position pos) {
 	if ((enteredStyling == 0) && (pos > GetEndStyled())) {
+		NP2_TRACE_SCOPE2("Document::EnsureStyledTo", pos - GetEndStyled());
 		IncrementStyleClock();
 		if (pli && !pli->UseContainerLexing()) {
-			const Sci::Position endStyledTo = LineStartPosition(GetEndStyled());
-			pli->Colourise(endStyledTo, pos);
+			// adopt any region already lexed on the background worker
+			CompleteBackgroundStyling(true);
+			while (pos > GetEndStyled()) {
+				const Sci::Position start = LineStartPosition(GetEndStyled());
+				Sci::Position target = pos;
+				Sci::Line lineConverge = -1;
+				int stateBefore = 0;
+				int styleBefore = 0;
+				if (lexerSafeRestart && styleDamageEnd < styleValidEnd) {
+					// The styles beyond the pending changes still match the last
+					// pass over this text. Lex only through the changed lines
+					// plus the first wholly unchanged one: that line still holds
+					// the style and line state of the last pass, so when the
+					// relex reproduces both, every following line would relex
+					// identically and the stale styles are adopted instead.
+					// The damaged lines themselves are no witness as edits leave
+					// default styles and line states on inserted material.
+					const Sci::Line lineDamage = SciLineFromPosition(std::max(start, styleDamageEnd));
+					const Sci::Position boundary = LineStart(lineDamage + 2);
+					if (boundary < std::min(pos, styleValidEnd)) {
+						target = boundary;
+						lineConverge = lineDamage + 1;
+						stateBefore = GetLineState(lineConverge);
+						styleBefore = StyleIndexAt(boundary - 1);
+					}
+				}
+				pli->Colourise(start, target);
+				if (lineConverge < 0 || GetEndStyled() < target) {
+					break;
+				}
+				if (GetLineState(lineConverge) == stateBefore && StyleIndexAt(target - 1) == styleBefore) {
+					endStyled = std::min(styleValidEnd, LengthNoExcept());
+					styleDamageEnd = 0;
+				} else {
+					// Diverged: double the span for the next attempt so a
+					// cascading change costs one extra pass, not one per line.
+					styleDamageEnd = target + (target - start);
+				}
+			}
+			// lex ahead of the styled region for the next request
+			StartBackgroundStyling();
 		} else {
 			// Ask the watchers to style, and stop as soon as one responds.
 			for (auto it = watchers.begin();
@@ -2543,6 +3501,39 @@ void Document::EnsureStyledTo(Sci::Position pos) {
 	}
 }
 
+void Document::StartBackgroundStyling() {
+	if (backgroundStyler || !pli || enteredStyling != 0) {
+		return;
+	}
+	ILexer5 * const instance = pli->BackgroundLexer();
+	if (!instance) {
+		return;
+	}
+	const Sci::Position length = LengthNoExcept();
+	const Sci::Position start = LineStartPosition(GetEndStyled());
+	// only lex ahead when a whole chunk of the document is still unstyled
+	if (length - start < backgroundStyleChunkSize) {
+		return;
+	}
+	const Sci::Position end = LineStart(SciLineFromPosition(start + backgroundStyleChunkSize) + 1);
+	const int initStyle = (start > 0) ? StyleIndexAt(start - 1) : 0;
+	backgroundStyler = std::make_unique<BackgroundStyler>(this, instance, start, end, initStyle);
+	if (!backgroundStyler->Submit()) {
+		backgroundStyler.reset();
+	}
+}
+
+void Document::CompleteBackgroundStyling(bool commit) {
+	if (backgroundStyler) {
+		backgroundStyler->Wait();
+		// the chunk is only valid while styling still ends where the chunk starts
+		if (commit && enteredStyling == 0 && backgroundStyler->ChunkStart() == LineStartPosition(GetEndStyled())) {
+			backgroundStyler->Commit();
+		}
+		backgroundStyler.reset();
+	}
+}
+
 void Document::StyleToAdjustingLineDuration(Sci::Position pos) {
 	const Sci::Position stylingStart = GetEndStyled();
 	const ElapsedPeriod epStyling;
@@ -2551,7 +3542,11 @@ void Document::StyleToAdjustingLineDuration(Sci::Position pos) {
 	durationStyleOneUnit.AddSample(bytesBeingStyled, epStyling.Duration());
 }
 
-void Document::LexerChanged(bool hasStyles_) { //! removed in Scintilla 5.3
+void Document::LexerChanged(bool hasStyles_, bool safeRestart_) { //! removed in Scintilla 5.3
+	CompleteBackgroundStyling(false);
+	lexerSafeRestart = safeRestart_;
+	styleValidEnd = 0;
+	styleDamageEnd = 0;
 	if (cb.EnsureStyleBuffer(hasStyles_)) {
 		endStyled = 0;
 	}
@@ -2562,6 +3557,7 @@ LexInterface *Document::GetLexInterface() const noexcept {
 }
 
 void Document::SetLexInterface(std::unique_ptr<LexInterface> pLexInterface) noexcept {
+	CompleteBackgroundStyling(false);
 	pli = std::move(pLexInterface);
 }
 
@@ -2661,7 +3657,9 @@ void Document::AnnotationClearAll() {
 	}
 	const Sci::Line maxEditorLine = LinesTotal();
 	for (Sci::Line l = 0; l < maxEditorLine; l++) {
-		AnnotationSetText(l, nullptr);
+		if (Annotations()->Text(l)) {
+			AnnotationSetText(l, nullptr);
+		}
 	}
 	// Free remaining data
 	Annotations()->ClearAll();
@@ -2697,7 +3695,9 @@ void Document::EOLAnnotationClearAll() {
 	}
 	const Sci::Line maxEditorLine = LinesTotal();
 	for (Sci::Line l = 0; l < maxEditorLine; l++) {
-		EOLAnnotationSetText(l, nullptr);
+		if (EOLAnnotations()->Text(l)) {
+			EOLAnnotationSetText(l, nullptr);
+		}
 	}
 	// Free remaining data
 	EOLAnnotations()->ClearAll();
@@ -2721,6 +3721,17 @@ void SCI_METHOD Document::DecorationFillRange(Sci_Position position, int value,
 	}
 }
 
+void Document::DecorationFillList(const Sci::Position *ranges, size_t count, int value) {
+	const FillResult<Sci::Position> fr = decorations->FillList(ranges, count, value);
+	if (fr.changed) {
+		// one notification and one redraw spanning the whole sorted list,
+		// as for AddMarkList()
+		const DocModification mh(ModificationFlags::ChangeIndicator | ModificationFlags::User,
+			fr.position, fr.fillLength);
+		NotifyModified(mh);
+	}
+}
+
 bool Document::AddWatcher(DocWatcher *watcher, void *userData) {
 	const WatcherWithUserData wwud(watcher, userData);
 	const auto it = std::find(watchers.begin(), watchers.end(), wwud);
@@ -2935,8 +3946,38 @@ constexpr char BraceOpposite(char ch) noexcept {
 
 }
 
-// TODO: should be able to extend styled region to find matching brace
+void Document::RememberBraceMatch(Sci::Position position, Sci::Position match) const noexcept {
+	braceMatchCache[braceMatchCacheSlot] = { position, match };
+	braceMatchCacheSlot = (braceMatchCacheSlot + 1) % static_cast<unsigned int>(std::size(braceMatchCache));
+	braceMatchCacheCount = std::min(braceMatchCacheCount + 1, static_cast<unsigned int>(std::size(braceMatchCache)));
+}
+
 Sci::Position Document::BraceMatch(Sci::Position position, Sci::Position /*maxReStyle*/, Sci::Position startPos, bool useStartPos) const noexcept {
+	if (useStartPos) {
+		return BraceMatchScan(position, startPos, true);
+	}
+	if (styleClock == braceMatchStyleClock) {
+		for (unsigned int i = 0; i < braceMatchCacheCount; i++) {
+			if (braceMatchCache[i].position == position) {
+				return braceMatchCache[i].match;
+			}
+		}
+	} else {
+		// styling may have moved a brace into or out of a comment or string
+		braceMatchStyleClock = styleClock;
+		braceMatchCacheCount = 0;
+		braceMatchCacheSlot = 0;
+	}
+	const Sci::Position match = BraceMatchScan(position, 0, false);
+	RememberBraceMatch(position, match);
+	if (match >= 0) {
+		RememberBraceMatch(match, position);
+	}
+	return match;
+}
+
+// TODO: should be able to extend styled region to find matching brace
+Sci::Position Document::BraceMatchScan(Sci::Position position, Sci::Position startPos, bool useStartPos) const noexcept {
 	const unsigned char chBrace = CharAt(position);
 	const unsigned char chSeek = BraceOpposite(chBrace);
 	if (chSeek == '\0') {
@@ -3213,6 +4254,18 @@ private:
 	std::string cachedPattern;
 #endif
 	std::string substituted;
+	// replacement template compiled once per Replace All: literal runs with
+	// escapes decoded interleaved with capture group references, so each match
+	// only copies bytes instead of re-parsing the template
+	struct TemplateOp {
+		int group;		// capture group to copy, or -1 for a literal run
+		size_t position;	// start of the run within templateLiteral
+		size_t length;
+	};
+	std::string cachedTemplate;
+	std::string templateLiteral;
+	std::vector<TemplateOp> templateOps;
+	void CompileTemplate(std::string_view text);
 };
 
 /**
@@ -3590,6 +4643,50 @@ Sci::Position BuiltinRegex::CxxRegexFindText(const Document *doc, const RESearch
 
 #endif // BOOST_REGEX_STANDALONE || !NO_CXX11_REGEX
 
+#if NP2_USE_AVX2 || NP2_USE_SSE2
+namespace {
+
+// Forward scan over the whole buffer for the mandatory literal of a regular
+// expression. Candidates straddling the gap are checked through cbView.
+// This is a pure byte scan: CHR nodes match single bytes in every encoding,
+// so an occurrence can never be missed and false candidates are rejected by
+// the automaton afterwards.
+Sci::Position FindRequiredLiteral(const SplitView &cbView, Sci::Position pos, Sci::Position endPos,
+	const unsigned char *searchData, Sci::Position lengthFind) noexcept {
+	const Sci::Position endSearch = endPos - lengthFind + 1;
+	const Sci::Position length1 = static_cast<Sci::Position>(cbView.length1);
+	const Sci::Position endSearch1 = std::min(endSearch, length1 - lengthFind + 1);
+	if (pos < endSearch1) {
+		const Sci::Position match = FindLiteralInSegment(reinterpret_cast<const unsigned char *>(cbView.segment1),
+			pos, endSearch1, searchData, lengthFind);
+		if (match >= 0) {
+			return match;
+		}
+		pos = endSearch1;
+	}
+	// positions whose occurrence would straddle the segment boundary
+	const Sci::Position straddleEnd = std::min(endSearch, length1);
+	for (; pos < straddleEnd; pos++) {
+		if (searchData[0] == static_cast<unsigned char>(cbView[pos])) {
+			bool found = true;
+			for (Sci::Position indexSearch = 1; (indexSearch < lengthFind) && found; indexSearch++) {
+				found = static_cast<unsigned char>(cbView[pos + indexSearch]) == searchData[indexSearch];
+			}
+			if (found) {
+				return pos;
+			}
+		}
+	}
+	if (pos < endSearch) {
+		return FindLiteralInSegment(reinterpret_cast<const unsigned char *>(cbView.segment2),
+			pos, endSearch, searchData, lengthFind);
+	}
+	return -1;
+}
+
+}
+#endif
+
 Sci::Position BuiltinRegex::FindText(const Document *doc, Sci::Position minPos, Sci::Position maxPos, const char *pattern, FindOption flags, Sci::Position *length) {
 	const RESearchRange resr(doc, minPos, maxPos);
 #if defined(BOOST_REGEX_STANDALONE) || !defined(NO_CXX11_REGEX)
@@ -3613,11 +4710,37 @@ Sci::Position BuiltinRegex::FindText(const Document *doc, Sci::Position minPos,
 	const char searchEnd = pattern[patternLen - 1];
 	const char searchEndPrev = (patternLen > 1) ? pattern[patternLen - 2] : '\0';
 	const bool searchforLineEnd = (searchEnd == '$') && (searchEndPrev != '\\');
+#if NP2_USE_AVX2 || NP2_USE_SSE2
+	// prefilter: every match contains the mandatory literal of the pattern,
+	// so lines without its next occurrence are skipped with a vectorised
+	// scan instead of running the automaton over them position by position.
+	const Sci::Position literalLength = search.requiredLiteralLength;
+	const bool prefilter = literalLength >= 2 && resr.increment > 0;
+	const SplitView cbView = prefilter ? doc->AllView() : SplitView{};
+	Sci::Position literalPos = -1;
+	bool literalValid = false;
+#endif
 	for (Sci::Line line = resr.lineRangeStart; line != resr.lineRangeBreak; line += resr.increment) {
 		const Sci::Position lineStartPos = doc->LineStart(line);
 		const Sci::Position lineEndPos = doc->LineEnd(line);
 		Sci::Position startOfLine = lineStartPos;
 		Sci::Position endOfLine = lineEndPos;
+#if NP2_USE_AVX2 || NP2_USE_SSE2
+		if (prefilter) {
+			if (!literalValid || literalPos < lineStartPos) {
+				literalPos = FindRequiredLiteral(cbView, lineStartPos, resr.endPos, search.requiredLiteral, literalLength);
+				literalValid = true;
+				if (literalPos < 0) {
+					break;
+				}
+			}
+			if (literalPos > lineEndPos) {
+				// resume at the line holding the next occurrence
+				line = doc->SciLineFromPosition(literalPos) - 1;
+				continue;
+			}
+		}
+#endif
 
 		if (resr.increment > 0) {
 			if (line == resr.lineRangeStart) {
@@ -3677,57 +4800,84 @@ Sci::Position BuiltinRegex::FindText(const Document *doc, Sci::Position minPos,
 	return pos;
 }
 
-const char *BuiltinRegex::SubstituteByPosition(const Document *doc, const char *text, Sci::Position *length) {
-	// boost::regex or std::regex version of this function should be substituted by wrapping format method of
-	// match_results for max compatibility. eg. catch group $0-$9. see detail:
-	// https://www.boost.org/doc/libs/release/libs/regex/doc/html/boost_regex/format/boost_format_syntax.html
-	// https://en.cppreference.com/w/cpp/regex/match_results/format
-	substituted.clear();
-	for (Sci::Position j = 0; j < *length; j++) {
+void BuiltinRegex::CompileTemplate(std::string_view text) {
+	cachedTemplate = text;
+	templateLiteral.clear();
+	templateOps.clear();
+	size_t literalStart = 0;
+	for (size_t j = 0; j < text.length(); j++) {
 		if (text[j] == '\\') {
-			const char chNext = text[++j];
+			++j;
+			const char chNext = (j < text.length()) ? text[j] : '\0';
 			if (chNext >= '0' && chNext <= '9') {
-				const unsigned int patNum = chNext - '0';
-				const Sci::Position startPos = search.bopat[patNum];
-				const Sci::Position len = search.eopat[patNum] - startPos;
-				if (len > 0) {	// Will be null if try for a match that did not occur
-					const size_t size = substituted.length();
-					substituted.resize(size + len);
-					doc->GetCharRange(substituted.data() + size, startPos, len);
+				if (templateLiteral.length() > literalStart) {
+					templateOps.push_back({ -1, literalStart, templateLiteral.length() - literalStart });
+					literalStart = templateLiteral.length();
 				}
+				templateOps.push_back({ chNext - '0', 0, 0 });
 			} else {
 				switch (chNext) {
 				case 'a':
-					substituted.push_back('\a');
+					templateLiteral.push_back('\a');
 					break;
 				case 'b':
-					substituted.push_back('\b');
+					templateLiteral.push_back('\b');
 					break;
 				case 'f':
-					substituted.push_back('\f');
+					templateLiteral.push_back('\f');
 					break;
 				case 'n':
-					substituted.push_back('\n');
+					templateLiteral.push_back('\n');
 					break;
 				case 'r':
-					substituted.push_back('\r');
+					templateLiteral.push_back('\r');
 					break;
 				case 't':
-					substituted.push_back('\t');
+					templateLiteral.push_back('\t');
 					break;
 				case 'v':
-					substituted.push_back('\v');
+					templateLiteral.push_back('\v');
 					break;
 				case '\\':
-					substituted.push_back('\\');
+					templateLiteral.push_back('\\');
 					break;
 				default:
-					substituted.push_back('\\');
+					templateLiteral.push_back('\\');
 					j--;
 				}
 			}
 		} else {
-			substituted.push_back(text[j]);
+			templateLiteral.push_back(text[j]);
+		}
+	}
+	if (templateLiteral.length() > literalStart) {
+		templateOps.push_back({ -1, literalStart, templateLiteral.length() - literalStart });
+	}
+}
+
+const char *BuiltinRegex::SubstituteByPosition(const Document *doc, const char *text, Sci::Position *length) {
+	// boost::regex or std::regex version of this function should be substituted by wrapping format method of
+	// match_results for max compatibility. eg. catch group $0-$9. see detail:
+	// https://www.boost.org/doc/libs/release/libs/regex/doc/html/boost_regex/format/boost_format_syntax.html
+	// https://en.cppreference.com/w/cpp/regex/match_results/format
+	// The template is compiled once and reused for every match of a Replace All,
+	// so each substitution is literal run copies plus group slice copies.
+	const std::string_view view(text, *length);
+	if (templateOps.empty() || cachedTemplate != view) {
+		CompileTemplate(view);
+	}
+	substituted.clear();
+	for (const TemplateOp &op : templateOps) {
+		if (op.group < 0) {
+			substituted.append(templateLiteral, op.position, op.length);
+		} else {
+			const Sci::Position startPos = search.bopat[op.group];
+			const Sci::Position len = search.eopat[op.group] - startPos;
+			if (len > 0) {	// Will be null if try for a match that did not occur
+				const size_t size = substituted.length();
+				substituted.resize(size + len);
+				doc->GetCharRange(substituted.data() + size, startPos, len);
+			}
 		}
 	}
 	*length = substituted.length();
@@ -15,6 +15,7 @@ class LineMarkers;
 class LineLevels;
 class LineState;
 class LineAnnotation;
+class LineIndentCache;
 
 enum class EncodingFamily {
 	eightBit, unicode, dbcs
@@ -195,10 +196,15 @@ public:
 	LexInterface &operator=(LexInterface &&) = delete;
 	virtual ~LexInterface() noexcept;
 	void Colourise(Sci::Position start, Sci::Position end);
+	Scintilla::ILexer5 *BackgroundLexer() const noexcept {
+		return performingStyle ? nullptr : instance.get();
+	}
 	virtual Scintilla::LineEndType LineEndTypesSupported() const noexcept;
 	bool UseContainerLexing() const noexcept;
 };
 
+class BackgroundStyler;
+
 struct RegexError final : public std::runtime_error {
 	RegexError() : std::runtime_error("regex failure") {}
 };
@@ -283,7 +289,31 @@ private:
 #endif
 	std::unique_ptr<CaseFolder> pcf;
 	Sci::Position endStyled = 0;
+	// Bounded relexing: styles in [endStyled, styleValidEnd) still match the
+	// last pass over text that has not changed since, while styleDamageEnd
+	// bounds the pending changes. A lexer whose whole cross-line context is
+	// the end-of-line style and line state can then stop relexing at the first
+	// line past the changes whose stored values are reproduced.
+	Sci::Position styleValidEnd = 0;
+	Sci::Position styleDamageEnd = 0;
+	bool lexerSafeRestart = false;
 	int styleClock = 0;
+	// recent BraceMatch() results: the caret-move highlight, select to
+	// matching brace and repeated visits to the same brace all ask for the
+	// same pair again, and each fresh scan can walk most of the document.
+	struct BraceMatchEntry {
+		Sci::Position position;
+		Sci::Position match;
+	};
+	mutable BraceMatchEntry braceMatchCache[8] = {};
+	mutable unsigned int braceMatchCacheCount = 0;
+	mutable unsigned int braceMatchCacheSlot = 0;
+	mutable int braceMatchStyleClock = -1;
+	// last known DBCS character start: long ideograph runs are all lead-byte
+	// values so finding a boundary otherwise re-walks the run for every call.
+	// Updated from const lookups the background styler also executes, so the
+	// cache is atomic; any value is merely a hint, relaxed ordering suffices.
+	mutable std::atomic<Sci::Position> dbcsBoundaryCache = 0;
 	int enteredModification = 0;
 	int enteredStyling = 0;
 	int enteredReadOnlyCount = 0;
@@ -296,7 +326,7 @@ private:
 
 	// ldSize is not real data - it is for dimensions and loops
 	enum lineData {
-		ldMarkers, ldLevels, ldState, ldMargin, ldAnnotation, ldEOLAnnotation, ldSize
+		ldMarkers, ldLevels, ldState, ldMargin, ldAnnotation, ldEOLAnnotation, ldIndentCache, ldSize
 	};
 	std::unique_ptr<PerLine> perLineData[ldSize];
 	LineMarkers *Markers() const noexcept;
@@ -305,9 +335,12 @@ private:
 	LineAnnotation *Margins() const noexcept;
 	LineAnnotation *Annotations() const noexcept;
 	LineAnnotation *EOLAnnotations() const noexcept;
+	LineIndentCache *IndentCache() const noexcept;
+	int LineIndentValue(Sci::Line line) const noexcept;
 
 	std::unique_ptr<RegexSearchBase> regex;
 	std::unique_ptr<LexInterface> pli;
+	std::unique_ptr<BackgroundStyler> backgroundStyler;
 	std::unique_ptr<DBCSCharClassify> dbcsCharClass;
 
 public:
@@ -348,6 +381,7 @@ public:
 	void InsertLine(Sci::Line line) override;
 	void InsertLines(Sci::Line line, Sci::Line lines) override;
 	void RemoveLine(Sci::Line line) override;
+	void RemoveLines(Sci::Line line, Sci::Line lines) override;
 
 	Scintilla::LineEndType LineEndTypesSupported() const noexcept;
 	bool SetDBCSCodePage(int dbcsCodePage_);
@@ -401,11 +435,14 @@ public:
 
 	// Gateways to modifying document
 	void ModifiedAt(Sci::Position pos) noexcept;
+	void ModifiedAt(Sci::Position pos, Sci::Position oldEnd, Sci::Position newEnd) noexcept;
 	void CheckReadOnly() noexcept;
 	void TrimReplacement(std::string_view &text, Range &range) const noexcept;
 	bool DeleteChars(Sci::Position pos, Sci::Position len);
 	Sci::Position InsertString(Sci::Position position, const char *s, Sci::Position insertLength);
 	Sci::Position InsertString(Sci::Position position, std::string_view sv);
+	Sci::Position InsertStringMulti(const Sci::Position *positions, size_t count, const char *s, Sci::Position insertLength);
+	bool DeleteRangesMulti(const Sci::Position *positions, const Sci::Position *lengths, size_t count);
 	void ChangeInsertion(const char *s, Sci::Position length);
 	int SCI_METHOD AddData(const char *data, Sci_Position length) override;
 	IDocumentEditable *AsDocumentEditable() noexcept {
@@ -487,6 +524,15 @@ public:
 	[[nodiscard]] Sci::Position EditionNextDelete(Sci::Position pos) const noexcept {
 		return cb.EditionNextDelete(pos);
 	}
+	[[nodiscard]] unsigned int EditionsInRange(Sci::Position start, Sci::Position end, Sci::Position endDeletes) const noexcept {
+		return cb.EditionsInRange(start, end, endDeletes);
+	}
+	void ChangeHistoryCompact() {
+		cb.ChangeHistoryCompact();
+	}
+	void PrepositionGaps() noexcept {
+		cb.PrepositionGaps();
+	}
 
 	const char * SCI_METHOD BufferPointer() override {
 		return cb.BufferPointer();
@@ -494,11 +540,13 @@ public:
 	const char *RangePointer(Sci::Position position, Sci::Position rangeLength) noexcept {
 		return cb.RangePointer(position, rangeLength);
 	}
+	Scintilla::ITextSnapshot *CreateSnapshot() const;
 	Sci::Position GapPosition() const noexcept {
 		return cb.GapPosition();
 	}
 
 	int SCI_METHOD GetLineIndentation(Sci_Line line) const noexcept override;
+	void ClearIndentCache();
 	Sci::Position SetLineIndentation(Sci::Line line, Sci::Position indent);
 	Sci::Position GetLineIndentPosition(Sci::Line line) const noexcept;
 	Sci::Position GetColumn(Sci::Position pos) const noexcept;
@@ -530,6 +578,9 @@ public:
 	unsigned char UCharAt(Sci::Position position) const noexcept {
 		return cb.UCharAt(position);
 	}
+	SplitView AllView() const noexcept {
+		return cb.AllView();
+	}
 	void SCI_METHOD GetCharRange(char *buffer, Sci_Position position, Sci_Position lengthRetrieve) const noexcept override {
 		cb.GetCharRange(buffer, position, lengthRetrieve);
 	}
@@ -545,10 +596,19 @@ public:
 	int CheckRange(const char *chars, const char *styles, Sci::Position position, Sci::Position rangeLength) const noexcept {
 		return cb.CheckRange(chars, styles, position, rangeLength);
 	}
+	Sci::Position CommonPrefix(const char *chars, const char *styles, Sci::Position position, Sci::Position rangeLength) const noexcept {
+		return cb.CommonPrefix(chars, styles, position, rangeLength);
+	}
+	void CountMemory(Scintilla::MemoryUsage &usage) const noexcept;
+	Scintilla::LineEndCounts GetLineEndCounts() const noexcept {
+		return cb.GetLineEndCounts();
+	}
 	MarkerMask GetMark(Sci::Line line, bool includeChangeHistory) const noexcept;
 	Sci::Line MarkerNext(Sci::Line lineStart, MarkerMask mask) const noexcept;
+	Sci::Line MarkerPrevious(Sci::Line lineStart, MarkerMask mask) const noexcept;
 	int AddMark(Sci::Line line, int markerNum);
 	void AddMarkSet(Sci::Line line, MarkerMask valueSet);
+	void AddMarkList(const Sci::Line *lineList, size_t count, int markerNum);
 	void DeleteMark(Sci::Line line, int markerNum);
 	void DeleteMarkFromHandle(int markerHandle);
 	void DeleteAllMarks(int markerNum);
@@ -623,14 +683,17 @@ public:
 		return endStyled;
 	}
 	void EnsureStyledTo(Sci::Position pos);
+	void StartBackgroundStyling();
+	void CompleteBackgroundStyling(bool commit);
 	void StyleToAdjustingLineDuration(Sci::Position pos);
-	void LexerChanged(bool hasStyles_);
+	void LexerChanged(bool hasStyles_, bool safeRestart_);
 	int GetStyleClock() const noexcept {
 		return styleClock;
 	}
 	void IncrementStyleClock() noexcept;
 	void SCI_METHOD DecorationSetCurrentIndicator(int indicator) noexcept override;
 	void SCI_METHOD DecorationFillRange(Sci_Position position, int value, Sci_Position fillLength) override;
+	void DecorationFillList(const Sci::Position *ranges, size_t count, int value);
 	LexInterface *GetLexInterface() const noexcept;
 	void SetLexInterface(std::unique_ptr<LexInterface> pLexInterface) noexcept;
 
@@ -675,6 +738,10 @@ public:
 	Sci::Position BraceMatch(Sci::Position position, Sci::Position maxReStyle, Sci::Position startPos, bool useStartPos) const noexcept;
 
 private:
+	Sci::Position BraceMatchScan(Sci::Position position, Sci::Position startPos, bool useStartPos) const noexcept;
+	void RememberBraceMatch(Sci::Position position, Sci::Position match) const noexcept;
+	Sci::Position WordRunEnd(Sci::Position pos, CharacterClass ccStart) const noexcept;
+	Sci::Position WordRunStart(Sci::Position pos, CharacterClass ccStart) const noexcept;
 	void NotifyModifyAttempt() noexcept;
 	void NotifySavePoint(bool atSavePoint) noexcept;
 	void NotifyModified(DocModification mh);
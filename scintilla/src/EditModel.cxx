@@ -20,6 +20,7 @@
 #include <optional>
 #include <algorithm>
 #include <memory>
+#include <atomic>
 
 #include "ParallelSupport.h"
 #include "ScintillaTypes.h"
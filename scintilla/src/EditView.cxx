@@ -27,6 +27,7 @@
 //#include <future>
 
 #include "ParallelSupport.h"
+#include "TraceEvents.h"
 #include "ScintillaTypes.h"
 #include "ScintillaMessages.h"
 #include "ScintillaStructures.h"
@@ -368,7 +369,8 @@ struct LayoutWorker {
 	const EditModel &model;
 
 	std::vector<TextSegment> segmentList;
-	uint32_t segmentCount = 0;
+	std::vector<uint32_t> groupList; // first segment index of each font group, plus a final sentinel
+	uint32_t groupCount = 0;
 	int maxPosInLine = 0;
 	std::atomic<uint32_t> nextIndex = 0;
 	std::atomic<uint32_t> finishedCount = 0;
@@ -430,6 +432,34 @@ struct LayoutWorker {
 		}
 	}
 
+	void LayoutGroup(uint32_t group, Surface *surface) {
+		const uint32_t first = groupList[group];
+		const uint32_t last = groupList[group + 1];
+		if (last - first == 1) {
+			Layout(segmentList[first], surface);
+			return;
+		}
+		// All segments in the group share a font: shape the combined run with one
+		// measurement and slice each segment's widths out of the shared result.
+		// Keying the cache on the first segment's style is safe as the positions
+		// only depend on the text and the font the whole group was built from.
+		const int start = segmentList[first].start;
+		const int length = segmentList[last - 1].end() - start;
+		const unsigned char styleSegment = ll->styles[start];
+		posCache.MeasureWidths(surface, vstyle.styles[styleSegment], styleSegment,
+			std::string_view(&ll->chars[start], length), &ll->positions[start + 1]);
+		// Rebase trailing segments onto their own starts, in reverse so each base
+		// is read before it is overwritten, to match separately measured segments
+		// for the accumulation pass in LayoutLine().
+		for (uint32_t i = last - 1; i > first; i--) {
+			const TextSegment &ts = segmentList[i];
+			const XYPOSITION base = ll->positions[ts.start];
+			for (int k = ts.start + 1; k <= ts.start + ts.length; k++) {
+				ll->positions[k] -= base;
+			}
+		}
+	}
+
 	uint32_t Start(Sci::Position posLineStart, uint32_t posInLine, LayoutLineOption option) {
 		const int startPos = ll->lastSegmentEnd;
 		const int endPos = ll->numCharsInLine;
@@ -450,10 +480,29 @@ struct LayoutWorker {
 			segmentList.push_back(bfLayout.Next());
 		} while (bfLayout.More());
 
+		// Group consecutive segments that share a font: punctuation heavy code
+		// breaks a line into many tiny segments at style changes while the font
+		// rarely changes, so a group can be shaped with one measurement call.
+		groupList.reserve(segmentList.size() + 1);
+		const Font *groupFont = nullptr;
+		int groupLength = 0;
+		for (uint32_t i = 0; i < static_cast<uint32_t>(segmentList.size()); i++) {
+			const TextSegment &ts = segmentList[i];
+			const Style &style = vstyle.styles[ll->styles[ts.start]];
+			const Font *font = (style.visible && !ts.representation) ? style.font.get() : nullptr;
+			if (font == nullptr || font != groupFont || groupLength + ts.length > BreakFinder::lengthEachSubdivision) {
+				groupList.push_back(i);
+				groupLength = 0;
+			}
+			groupFont = font;
+			groupLength += ts.length;
+		}
+		groupList.push_back(static_cast<uint32_t>(segmentList.size()));
+		groupCount = static_cast<uint32_t>(groupList.size() - 1);
+
 		maxPosInLine = static_cast<int>(posInLine);
 		const uint32_t length = bfLayout.CurrentPos() - startPos;
 		if (length >= model.minParallelLayoutLength && model.hardwareConcurrency > 1) {
-			segmentCount = static_cast<uint32_t>(segmentList.size());
 			const uint32_t threadCount = std::min(length/blockSize, model.hardwareConcurrency);
 #if USE_STD_ASYNC_FUTURE
 			std::vector<std::future<void>> features;
@@ -489,14 +538,15 @@ struct LayoutWorker {
 		void * const idleTaskTimer = model.idleTaskTimer;
 		Surface * const surface = sharedSurface;
 		int processed = 0;
-		auto it = segmentList.begin();
+		uint32_t group = 0;
 		while (true) {
-			const TextSegment &ts = *it++;
-			Layout(ts, surface);
-			if (it == segmentList.end()) {
+			LayoutGroup(group, surface);
+			group++;
+			if (group == groupCount) {
 				break;
 			}
-			processed += ts.length;
+			const TextSegment &ts = segmentList[groupList[group] - 1];
+			processed += ts.end() - segmentList[groupList[group - 1]].start;
 			if (processed >= blockSize) {
 				processed = 0;
 				if (ts.end() > maxPosInLine && WaitableTimerExpired(idleTaskTimer)) {
@@ -505,7 +555,7 @@ struct LayoutWorker {
 			}
 		}
 
-		finishedCount.store(static_cast<uint32_t>(it - segmentList.begin()), std::memory_order_relaxed);
+		finishedCount.store(groupList[group], std::memory_order_relaxed);
 		return 1;
 	}
 
@@ -529,14 +579,15 @@ struct LayoutWorker {
 		int processed = 0;
 		while (true) {
 			const uint32_t index = nextIndex.fetch_add(1, std::memory_order_relaxed);
-			if (index >= segmentCount) {
+			if (index >= groupCount) {
 				break;
 			}
 
-			const TextSegment &ts = segmentList[index];
-			Layout(ts, surface);
-			finished = index + 1;
-			processed += ts.length;
+			LayoutGroup(index, surface);
+			const uint32_t segmentEnd = groupList[index + 1];
+			const TextSegment &ts = segmentList[segmentEnd - 1];
+			finished = segmentEnd;
+			processed += ts.end() - segmentList[groupList[index]].start;
 			if (processed >= blockSize) {
 				processed = 0;
 				if (ts.end() > maxPosInLine && WaitableTimerExpired(idleTaskTimer)) {
@@ -579,6 +630,7 @@ struct LayoutWorker {
 uint64_t EditView::LayoutLine(const EditModel &model, Surface *surface, const ViewStyle &vstyle, LineLayout *ll, int width, LayoutLineOption option, int posInLine) {
 	uint64_t wrappedBytes = 0; // only care about time spend on MeasureWidths()
 	const Sci::Line line = ll->LineNumber();
+	NP2_TRACE_SCOPE2("EditView::LayoutLine", line + 1);
 	PLATFORM_ASSERT(line < model.pdoc->LinesTotal());
 	PLATFORM_ASSERT(ll->chars);
 	const Sci::Position posLineStart = model.pdoc->LineStart(line);
@@ -588,6 +640,7 @@ uint64_t EditView::LayoutLine(const EditModel &model, Surface *surface, const Vi
 	width = std::max(width, 20);
 
 	auto validity = ll->validity;
+	int restartPos = 0;
 	if (validity == LineLayout::ValidLevel::checkTextAndStyle) {
 		const Sci::Position lineLength = (vstyle.viewEOL ? posLineEnd : model.pdoc->LineEnd(line)) - posLineStart;
 		validity = LineLayout::ValidLevel::invalid;
@@ -610,6 +663,14 @@ uint64_t EditView::LayoutLine(const EditModel &model, Surface *surface, const Vi
 				validity = (ll->widthLine != width)? LineLayout::ValidLevel::positions : LineLayout::ValidLevel::lines;
 			}
 		}
+		if (validity == LineLayout::ValidLevel::invalid && ll->lastSegmentEnd > 0) {
+			// Only the content changed, not the styles in use, so positions before
+			// the first changed byte survive and layout can restart there instead
+			// of re-measuring the whole line.
+			const Sci::Position checkLength = std::min<Sci::Position>(lineLength, ll->lastSegmentEnd);
+			restartPos = static_cast<int>(model.pdoc->CommonPrefix(ll->chars.get(),
+				reinterpret_cast<const char *>(ll->styles.get()), posLineStart, checkLength));
+		}
 	}
 	if (validity == LineLayout::ValidLevel::invalid) {
 		// Fill base line layout
@@ -625,8 +686,20 @@ uint64_t EditView::LayoutLine(const EditModel &model, Surface *surface, const Vi
 
 		// Layout the line, determining the position of each character,
 		// with an extra element at the end for the end of the line.
-		ll->ClearPositions();
-		ll->lastSegmentEnd = 0;
+		restartPos = std::min(restartPos, numCharsInLine);
+		if (restartPos > 0 && restartPos != numCharsInLine) {
+			// Retreat to the type of break used when subdividing long runs so the
+			// join between the kept prefix and the re-measured tail is a point a
+			// fresh layout could also have broken at.
+			const int window = std::min<int>(restartPos, BreakFinder::lengthEachSubdivision);
+			restartPos += static_cast<int>(model.pdoc->SafeSegment(&ll->chars[restartPos - window], window, model.pdoc->CodePageFamily())) - window;
+		}
+		if (restartPos > 0) {
+			ll->ClearPositionsAfter(restartPos);
+		} else {
+			ll->ClearPositions();
+			ll->lastSegmentEnd = 0;
+		}
 		ll->numCharsInLine = numCharsInLine;
 		ll->numCharsBeforeEOL = numCharsBeforeEOL;
 
@@ -639,12 +712,20 @@ uint64_t EditView::LayoutLine(const EditModel &model, Surface *surface, const Vi
 			ll->widthLine = width;
 			ll->wrapIndent = 0;
 			validity = LineLayout::ValidLevel::lines;
-		} else if (vstyle.edgeState == EdgeVisualStyle::Background) {
-			Sci::Position edgePosition = model.pdoc->FindColumn(line, vstyle.theEdge.column);
-			if (edgePosition >= posLineStart) {
-				edgePosition -= posLineStart;
+		} else {
+			if (restartPos == numCharsInLine) {
+				// The change was entirely beyond the laid out text, as when a tail
+				// was deleted, so every kept position remains valid and only rewrap
+				// is needed.
+				validity = LineLayout::ValidLevel::positions;
+			}
+			if (vstyle.edgeState == EdgeVisualStyle::Background) {
+				Sci::Position edgePosition = model.pdoc->FindColumn(line, vstyle.theEdge.column);
+				if (edgePosition >= posLineStart) {
+					edgePosition -= posLineStart;
+				}
+				ll->edgeColumn = static_cast<int>(edgePosition);
 			}
-			ll->edgeColumn = static_cast<int>(edgePosition);
 		}
 	}
 
@@ -2168,30 +2249,35 @@ void DrawIndicator(int indicNum, Sci::Position startPos, Sci::Position endPos, S
 }
 
 void DrawIndicators(Surface *surface, const EditModel &model, const ViewStyle &vsDraw, const LineLayout *ll,
-	Sci::Line line, int xStart, PRectangle rcLine, int subLine, Sci::Position lineEnd, bool under, int tabWidthMinimumPixels) {
-	// Draw decorators
+	Sci::Line line, int xStart, PRectangle rcLine, int subLine, Sci::Position lineEnd, bool under, int tabWidthMinimumPixels,
+	const DecorationRunSlice &slice) {
+	// Draw decorators from the runs materialized for this paint
 	const Sci::Position posLineStart = model.pdoc->LineStart(line);
 	const Sci::Position lineStart = ll->LineStart(subLine);
 	const Sci::Position posLineEnd = posLineStart + lineEnd;
-
-	for (const auto *deco : model.pdoc->decorations->View()) {
-		if (under == vsDraw.indicators[deco->Indicator()].under) {
-			Sci::Position startPos = posLineStart + lineStart;
-			while (startPos < posLineEnd) {
-				const Range rangeRun(deco->StartRun(startPos), deco->EndRun(startPos));
-				const Sci::Position endPos = std::min(rangeRun.end, posLineEnd);
-				const int value = deco->ValueAt(startPos);
-				if (value) {
-					const bool hover = vsDraw.indicators[deco->Indicator()].IsDynamic() &&
-						rangeRun.ContainsCharacter(model.hoverIndicatorPos);
-					const Indicator::State state = hover ? Indicator::State::hover : Indicator::State::normal;
-					const Sci::Position posSecond = model.pdoc->MovePositionOutsideChar(rangeRun.First() + 1, 1);
-					DrawIndicator(deco->Indicator(), startPos - posLineStart, endPos - posLineStart,
-						surface, vsDraw, ll, xStart, rcLine, posSecond - posLineStart, subLine, state,
-						value, model.BidirectionalEnabled(), tabWidthMinimumPixels);
-				}
-				startPos = endPos;
-			}
+	const Sci::Position posSubLineStart = posLineStart + lineStart;
+
+	for (size_t decoration = 0; decoration < slice.Decorations(); decoration++) {
+		const auto itEnd = slice.runs.begin() + slice.decorationStart[decoration + 1];
+		auto it = slice.runs.begin() + slice.decorationStart[decoration];
+		if (it == itEnd || under != vsDraw.indicators[it->indicator].under) {
+			continue;
+		}
+		// first run ending beyond the start of this subline
+		it = std::lower_bound(it, itEnd, posSubLineStart, [](const DecorationRun &run, Sci::Position pos) noexcept {
+			return run.end <= pos;
+		});
+		for (; it != itEnd && it->start < posLineEnd; ++it) {
+			const Range rangeRun(it->start, it->end);
+			const Sci::Position startPos = std::max(rangeRun.start, posSubLineStart);
+			const Sci::Position endPos = std::min(rangeRun.end, posLineEnd);
+			const bool hover = vsDraw.indicators[it->indicator].IsDynamic() &&
+				rangeRun.ContainsCharacter(model.hoverIndicatorPos);
+			const Indicator::State state = hover ? Indicator::State::hover : Indicator::State::normal;
+			const Sci::Position posSecond = model.pdoc->MovePositionOutsideChar(rangeRun.First() + 1, 1);
+			DrawIndicator(it->indicator, startPos - posLineStart, endPos - posLineStart,
+				surface, vsDraw, ll, xStart, rcLine, posSecond - posLineStart, subLine, state,
+				it->value, model.BidirectionalEnabled(), tabWidthMinimumPixels);
 		}
 	}
 
@@ -2303,6 +2389,37 @@ ColourRGBA InvertedLight(ColourRGBA orig) noexcept {
 
 }
 
+void DecorationRunSlice::Build(const IDecorationList *decorations, Range rangePaint) {
+	runs.clear();
+	decorationStart.clear();
+	for (const IDecoration *deco : decorations->View()) {
+		decorationStart.push_back(runs.size());
+		const int indicator = deco->Indicator();
+		Sci::Position position = rangePaint.start;
+		while (position < rangePaint.end) {
+			const Sci::Position endRun = deco->EndRun(position);
+			if (const int value = deco->ValueAt(position)) {
+				runs.push_back({ deco->StartRun(position), endRun, value, indicator });
+			}
+			if (endRun <= position) {
+				break;	// empty decoration
+			}
+			position = endRun;
+		}
+	}
+	decorationStart.push_back(runs.size());
+}
+
+const DecorationRun *DecorationRunSlice::RunAt(size_t decoration, Sci::Position position) const noexcept {
+	const DecorationRun *first = runs.data() + decorationStart[decoration];
+	const DecorationRun * const last = runs.data() + decorationStart[decoration + 1];
+	// runs within a decoration are ordered, find the first ending beyond position
+	first = std::lower_bound(first, last, position, [](const DecorationRun &run, Sci::Position pos) noexcept {
+		return run.end <= pos;
+	});
+	return (first != last && first->start <= position) ? first : nullptr;
+}
+
 void EditView::DrawIndentGuide(Surface *surface, XYPOSITION start, PRectangle rcSegment, bool highlight, bool offset) const {
 	const Point from = Point::FromInts(0, offset);
 	const PRectangle rcCopyArea(start + 1, rcSegment.top,
@@ -2360,14 +2477,14 @@ void EditView::DrawForeground(Surface *surface, const EditModel &model, const Vi
 			}
 			if (vsDraw.indicatorsSetFore) {
 				// At least one indicator sets the text colour so see if it applies to this segment
-				for (const auto *deco : model.pdoc->decorations->View()) {
-					const int indicatorValue = deco->ValueAt(ts.start + posLineStart);
-					if (indicatorValue) {
-						const Indicator &indicator = vsDraw.indicators[deco->Indicator()];
+				for (size_t decoration = 0; decoration < decorationSlice.Decorations(); decoration++) {
+					const DecorationRun * const run = decorationSlice.RunAt(decoration, ts.start + posLineStart);
+					if (run) {
+						const int indicatorValue = run->value;
+						const Indicator &indicator = vsDraw.indicators[run->indicator];
 						bool hover = false;
 						if (indicator.IsDynamic()) {
-							const Sci::Position startPos = ts.start + posLineStart;
-							const Range rangeRun(deco->StartRun(startPos), deco->EndRun(startPos));
+							const Range rangeRun(run->start, run->end);
 							hover =	rangeRun.ContainsCharacter(model.hoverIndicatorPos);
 						}
 						if (hover) {
@@ -2472,6 +2589,12 @@ void EditView::DrawForeground(Surface *surface, const EditModel &model, const Vi
 				}
 				if (vsDraw.viewWhitespace != WhiteSpace::Invisible ||
 					(inIndentation && vsDraw.viewIndentationGuides != IndentView::None)) {
+					// batch the visible whitespace dots for this segment into
+					// single fill calls so dense files don't pay one draw call
+					// per space.
+					const ColourRGBA whiteSpaceFore = vsDraw.ElementColour(Element::WhiteSpace).value_or(textFore);
+					PRectangle rcDots[64];
+					size_t dotCount = 0;
 					for (int cpos = 0; cpos <= i - ts.start; cpos++) {
 						if (ll->chars[cpos + ts.start] == ' ') {
 							if (vsDraw.viewWhitespace != WhiteSpace::Invisible) {
@@ -2488,8 +2611,11 @@ void EditView::DrawForeground(Surface *surface, const EditModel &model, const Vi
 										rcSegment.top + vsDraw.lineHeight / 2, 0.0f, 0.0f);
 									rcDot.right = rcDot.left + vsDraw.whitespaceSize;
 									rcDot.bottom = rcDot.top + vsDraw.whitespaceSize;
-									const ColourRGBA whiteSpaceFore = vsDraw.ElementColour(Element::WhiteSpace).value_or(textFore);
-									surface->FillRectangleAligned(rcDot, Fill(whiteSpaceFore));
+									if (dotCount == std::size(rcDots)) {
+										surface->FillRectangleList(rcDots, dotCount, Fill(whiteSpaceFore));
+										dotCount = 0;
+									}
+									rcDots[dotCount++] = rcDot;
 								}
 							}
 							if (inIndentation && vsDraw.viewIndentationGuides == IndentView::Real) {
@@ -2507,6 +2633,9 @@ void EditView::DrawForeground(Surface *surface, const EditModel &model, const Vi
 							inIndentation = false;
 						}
 					}
+					if (dotCount != 0) {
+						surface->FillRectangleList(rcDots, dotCount, Fill(whiteSpaceFore));
+					}
 				}
 			}
 			if ((inHotspot && vsDraw.hotspotUnderline) || vsDraw.styles[styleMain].underline) {
@@ -2635,7 +2764,7 @@ void EditView::DrawLine(Surface *surface, const EditModel &model, const ViewStyl
 
 		if (FlagSet(phase, DrawPhase::indicatorsBack)) {
 			DrawIndicators(surface, model, vsDraw, ll, line, xStart, rcLine, subLine,
-				lineRangeIncludingEnd.end, true, tabWidthMinimumPixels);
+				lineRangeIncludingEnd.end, true, tabWidthMinimumPixels, decorationSlice);
 			DrawEdgeLine(surface, vsDraw, ll, xStart, rcLine, lineRange);
 			DrawMarkUnderline(surface, model, vsDraw, line, rcLine);
 		}
@@ -2657,7 +2786,7 @@ void EditView::DrawLine(Surface *surface, const EditModel &model, const ViewStyl
 
 	if (FlagSet(phase, DrawPhase::indicatorsFore)) {
 		DrawIndicators(surface, model, vsDraw, ll, line, xStart, rcLine, subLine,
-			lineRangeIncludingEnd.end, false, tabWidthMinimumPixels);
+			lineRangeIncludingEnd.end, false, tabWidthMinimumPixels, decorationSlice);
 	}
 
 	DrawFoldDisplayText(surface, model, vsDraw, ll, line, xStart, rcLine, subLine, subLineStart, phase);
@@ -2737,9 +2866,26 @@ void EditView::PaintText(Surface *surfaceWindow, const EditModel &model, const V
 		double durCopy = 0.0;
 		const ElapsedPeriod epWhole;
 #endif
+		const bool profiling = profiler.enabled;
+		double profLayout = 0.0;
+		double profDraw = 0.0;
+		int profLines = 0;
+		int profLayouts = 0;
+		const ElapsedPeriod epFrame;
 		const bool bracesIgnoreStyle = ((vsDraw.braceHighlightIndicatorSet && (model.bracesMatchStyle == StyleBraceLight)) ||
 			(vsDraw.braceBadLightIndicatorSet && (model.bracesMatchStyle == StyleBraceBad)));
 
+		{
+			// Materialize the decoration runs on the painted lines once instead
+			// of binary searching the decoration lists per drawn segment.
+			const Sci::Line firstVisible = model.TopLineOfMain() + screenLinePaintFirst;
+			const Sci::Line lastVisible = std::clamp<Sci::Line>(model.TopLineOfMain() + static_cast<int>(rcArea.bottom - 1) / vsDraw.lineHeight,
+				firstVisible, model.pcs->LinesDisplayed() - 1);
+			const Sci::Position posPaintFirst = model.pdoc->LineStart(model.pcs->DocFromDisplay(firstVisible));
+			const Sci::Position posPaintLast = model.pdoc->LineStart(model.pcs->DocFromDisplay(lastVisible) + 1);
+			decorationSlice.Build(model.pdoc->decorations.get(), Range(posPaintFirst, posPaintLast));
+		}
+
 		Sci::Line lineDocPrevious = -1;	// Used to avoid laying out one document line multiple times
 		LineLayout *ll = nullptr;
 		DrawPhase phase = DrawPhase::all;
@@ -2765,6 +2911,7 @@ void EditView::PaintText(Surface *surfaceWindow, const EditModel &model, const V
 #if defined(TIME_PAINTING)
 				ElapsedPeriod ep;
 #endif
+				ElapsedPeriod epStage;
 				if (lineDoc != lineDocPrevious) {
 					lineDocPrevious = lineDoc;
 					ll = RetrieveLineLayout(lineDoc, model);
@@ -2773,10 +2920,15 @@ void EditView::PaintText(Surface *surfaceWindow, const EditModel &model, const V
 						// Fill the line bidi data
 						UpdateBidiData(model, vsDraw, ll);
 					}
+					++profLayouts;
 				}
 #if defined(TIME_PAINTING)
 				durLayout += ep.Reset();
 #endif
+				if (profiling) {
+					profLayout += epStage.Reset();
+					++profLines;
+				}
 				{
 #if defined(__clang__)
 					__builtin_assume(ll != nullptr); // suppress [clang-analyzer-core.CallAndMessage]
@@ -2807,6 +2959,9 @@ void EditView::PaintText(Surface *surfaceWindow, const EditModel &model, const V
 #if defined(TIME_PAINTING)
 					durPaint += ep.Reset();
 #endif
+					if (profiling) {
+						profDraw += epStage.Reset();
+					}
 					// Restore the previous styles for the brace highlights in case layout is in cache.
 					ll->RestoreBracesHighlight(rangeLine, model.braces, bracesIgnoreStyle);
 #if 0
@@ -2884,6 +3039,65 @@ void EditView::PaintText(Surface *surfaceWindow, const EditModel &model, const V
 			"Layout:%9.6g    Paint:%9.6g    Ratio:%9.6g   Copy:%9.6g   Total:%9.6g\n",
 			durLayout, durPaint, durLayout / durPaint, durCopy, epWhole.Duration());
 #endif
+		if (profiling) {
+			profiler.durLayout = profLayout;
+			profiler.durDraw = profDraw;
+			profiler.linesDrawn = profLines;
+			profiler.linesLaidOut = profLayouts;
+			profiler.RecordFrame(profiler.durStyle + profiler.durWrap + profiler.durMargin + epFrame.Duration());
+			DrawPaintProfiler(surfaceWindow, vsDraw, rcClient);
+		}
+	}
+}
+
+void EditView::DrawPaintProfiler(Surface *surface, const ViewStyle &vsDraw, PRectangle rcClient) const {
+	const Style &style = vsDraw.styles[StyleDefault];
+	const Font *font = style.font.get();
+	const XYPOSITION lineHeight = static_cast<XYPOSITION>(vsDraw.lineHeight);
+
+	char stages[160];
+	snprintf(stages, sizeof(stages), "paint %.2f ms: style %.2f wrap %.2f margin %.2f layout %.2f draw %.2f flush %.2f",
+		profiler.durTotal*1e3, profiler.durStyle*1e3, profiler.durWrap*1e3, profiler.durMargin*1e3,
+		profiler.durLayout*1e3, profiler.durDraw*1e3, profiler.durFlush*1e3);
+	char counts[64];
+	snprintf(counts, sizeof(counts), "%d lines drawn, %d laid out", profiler.linesDrawn, profiler.linesLaidOut);
+
+	constexpr XYPOSITION padding = 4.0;
+	constexpr XYPOSITION barWidth = 3.0;
+	constexpr XYPOSITION histogramHeight = 24.0;
+	const XYPOSITION width = 2*padding + std::max({surface->WidthText(font, stages),
+		surface->WidthText(font, counts), barWidth*PaintProfiler::frameHistory});
+	PRectangle rcBox = rcClient;
+	rcBox.right -= vsDraw.rightMarginWidth + padding;
+	rcBox.left = rcBox.right - width;
+	rcBox.top += padding;
+	rcBox.bottom = rcBox.top + 2*padding + 2*lineHeight + histogramHeight;
+	surface->FillRectangleAligned(rcBox, Fill(style.back));
+
+	PRectangle rcLine = rcBox;
+	rcLine.left += padding;
+	rcLine.top += padding;
+	rcLine.bottom = rcLine.top + lineHeight;
+	surface->DrawTextNoClip(rcLine, font, rcLine.top + vsDraw.maxAscent, stages, style.fore, style.back);
+	rcLine.top = rcLine.bottom;
+	rcLine.bottom = rcLine.top + lineHeight;
+	surface->DrawTextNoClip(rcLine, font, rcLine.top + vsDraw.maxAscent, counts, style.fore, style.back);
+
+	// rolling histogram, oldest frame first; full height at the slowest frame
+	// on record so spikes stay visible relative to their neighbours.
+	double slowest = 0.001;
+	for (const double duration : profiler.history) {
+		slowest = std::max(slowest, duration);
+	}
+	const XYPOSITION baseline = rcLine.bottom + histogramHeight;
+	for (size_t frame = 0; frame < PaintProfiler::frameHistory; frame++) {
+		const double duration = profiler.history[(profiler.historyIndex + frame) % PaintProfiler::frameHistory];
+		PRectangle rcBar;
+		rcBar.left = rcLine.left + barWidth*frame;
+		rcBar.right = rcBar.left + barWidth - 1;
+		rcBar.bottom = baseline;
+		rcBar.top = baseline - std::max<XYPOSITION>(1.0, static_cast<XYPOSITION>(histogramHeight*duration/slowest));
+		surface->FillRectangleAligned(rcBar, Fill(style.fore));
 	}
 }
 
@@ -2980,6 +3194,9 @@ Sci::Position EditView::FormatRange(bool draw, CharacterRangeFull chrg, Scintill
 	// Ensure we are styled to where we are formatting.
 	model.pdoc->EnsureStyledTo(endPosPrint);
 
+	// DrawLine() reads indicators from the slice of materialized decoration runs.
+	decorationSlice.Build(model.pdoc->decorations.get(), Range(model.pdoc->LineStart(linePrintStart), endPosPrint));
+
 	const int xStart = vsPrint.fixedColumnWidth + rc.left;
 	int ypos = rc.top;
 
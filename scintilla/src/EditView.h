@@ -16,6 +16,34 @@ struct PrintParameters {
 	PrintParameters() noexcept;
 };
 
+/**
+* Per-paint stage timings for the opt-in on-screen profiler overlay.
+* Stages outside PaintText are recorded by their callers: styling, wrapping
+* and margin by Editor::Paint, the flush by the platform layer after its
+* EndDraw, so the overlay shows the flush time of the previous frame.
+*/
+struct PaintProfiler {
+	bool enabled = false;
+	double durStyle = 0.0;
+	double durWrap = 0.0;
+	double durMargin = 0.0;
+	double durLayout = 0.0;
+	double durDraw = 0.0;
+	double durFlush = 0.0;
+	double durTotal = 0.0;
+	int linesDrawn = 0;
+	int linesLaidOut = 0;
+	static constexpr size_t frameHistory = 64;
+	double history[frameHistory] {};
+	size_t historyIndex = 0;
+
+	void RecordFrame(double duration) noexcept {
+		durTotal = duration;
+		history[historyIndex] = duration;
+		historyIndex = (historyIndex + 1) % frameHistory;
+	}
+};
+
 /**
 * The view may be drawn in separate phases.
 */
@@ -67,6 +95,32 @@ typedef void (*DrawTabArrowFn)(Surface *surface, PRectangle rcTab, int ymid,
 
 class LineTabstops;
 
+struct DecorationRun {
+	Sci::Position start;
+	Sci::Position end;
+	int value;
+	int indicator;
+};
+
+/**
+* All decoration runs with a value that intersect the painted range,
+* materialized once per paint into a flat array so drawing does not repeat
+* binary position searches per drawn segment per indicator. Runs are ordered
+* by decoration then by position, with decorationStart holding the index of
+* each decoration's first run plus an end sentinel.
+*/
+struct DecorationRunSlice {
+	std::vector<DecorationRun> runs;
+	std::vector<size_t> decorationStart{ 0 };
+
+	void Build(const IDecorationList *decorations, Range rangePaint);
+	size_t Decorations() const noexcept {
+		return decorationStart.size() - 1;
+	}
+	/// The decoration's run containing position, nullptr if none or no value.
+	const DecorationRun *RunAt(size_t decoration, Sci::Position position) const noexcept;
+};
+
 /**
 * EditView draws the main text area.
 */
@@ -101,6 +155,7 @@ public:
 	LineLayoutCache llc;
 	PositionCache posCache;
 	PrintParameters printParameters;
+	PaintProfiler profiler;
 
 	int tabArrowHeight; // draw arrow heads this many pixels above/below line midpoint
 	/** Some platforms, notably PLAT_CURSES, do not support Scintilla's native
@@ -166,6 +221,9 @@ private:
 		Sci::Line line, int xStart, PRectangle rcLine, int subLine, Sci::Line lineVisible) const;
 	void SCICALL DrawLine(Surface *surface, const EditModel &model, const ViewStyle &vsDraw, const LineLayout *ll,
 		Sci::Line line, Sci::Line lineVisible, int xStart, PRectangle rcLine, int subLine, DrawPhase phase);
+	void SCICALL DrawPaintProfiler(Surface *surface, const ViewStyle &vsDraw, PRectangle rcClient) const;
+
+	DecorationRunSlice decorationSlice;
 
 public:
 	void SCICALL PaintText(Surface *surfaceWindow, const EditModel &model, const ViewStyle &vsDraw,
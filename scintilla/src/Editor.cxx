@@ -23,8 +23,10 @@
 #include <algorithm>
 #include <iterator>
 #include <memory>
+#include <atomic>
 
 #include "ParallelSupport.h"
+#include "TraceEvents.h"
 #include "ScintillaTypes.h"
 #include "ScintillaMessages.h"
 #include "ScintillaStructures.h"
@@ -87,6 +89,10 @@ constexpr bool CanEliminate(const DocModification &mh) noexcept {
 	return FlagSet(mh.modificationType, (ModificationFlags::BeforeInsert | ModificationFlags::BeforeDelete));
 }
 
+// Try to keep time taken by styling reasonable so interaction remains smooth.
+// Scrolling gets a quarter of the budget to stay responsive.
+constexpr double defaultIdleStyleBudget = 0.02;
+
 /*
 	return whether this modification represents the FINAL step
 	in a [possibly lengthy] multi-step Undo/Redo sequence
@@ -198,6 +204,8 @@ Editor::Editor() {
 	willRedrawAll = false;
 	idleStyling = IdleStyling::None;
 	needIdleStyling = false;
+	needIdleLayout = false;
+	idleStyleBudget = defaultIdleStyleBudget;
 
 	recordingMacro = false;
 	convertPastes = true;
@@ -241,6 +249,7 @@ void Editor::InvalidateStyleData() noexcept {
 void Editor::InvalidateStyleRedraw() {
 	NeedWrapping();
 	InvalidateStyleData();
+	InvalidateWrapSnapshots();
 	Redraw();
 }
 
@@ -427,6 +436,10 @@ void Editor::SetTopLine(Sci::Line topLineNew) noexcept {
 	if ((topLine != topLineNew) && (topLineNew >= 0)) {
 		topLine = topLineNew;
 		ContainerNeedsUpdate(Update::VScroll);
+		// Prefetch layouts around the new viewport so further scrolling
+		// exposes lines that are already in the layout cache.
+		needIdleLayout = true;
+		SetIdle(true);
 	}
 	posTopLine = pdoc->LineStart(pcs->DocFromDisplay(topLine));
 }
@@ -479,6 +492,32 @@ void Editor::Redraw() noexcept {
 	}
 }
 
+void Editor::RedrawFromLine(Sci::Line displayLine) noexcept {
+	// Invalidate the band from displayLine to the bottom of the view:
+	// folding and unfolding only move the lines below the fold header,
+	// so everything above the band is still valid on screen.
+	if (redrawPendingText) {
+		return;
+	}
+	PRectangle rcClient = GetClientRectangle();
+	const XYPOSITION top = static_cast<XYPOSITION>((displayLine - TopLineOfMain()) * vs.lineHeight);
+	if (top >= rcClient.bottom) {
+		return;	// band starts below the visible area
+	}
+	if (top <= rcClient.top) {
+		Redraw();
+		return;
+	}
+	rcClient.top = top;
+	wMain.InvalidateRectangle(rcClient);
+	if (HasMarginWindow()) {
+		PRectangle rcMargin = rcClient;
+		const Point ptOrigin = GetVisibleOriginInMain();
+		rcMargin.Move(-ptOrigin.x, -ptOrigin.y);
+		wMargin.InvalidateRectangle(rcMargin);
+	}
+}
+
 void Editor::RedrawSelMargin(Sci::Line line, bool allAfter) noexcept {
 	const bool markersInText = vs.maskInLine || vs.maskDrawInText;
 	if (!HasMarginWindow() || markersInText) {	// May affect text area so may need to abandon and retry
@@ -945,6 +984,8 @@ void Editor::SetLastXChosen() {
 void Editor::ScrollTo(Sci::Line line, bool moveThumb) {
 	const Sci::Line topLineNew = std::clamp<Sci::Line>(line, 0, MaxScrollPos());
 	if (topLineNew != topLine) {
+		// Invalidated marker rectangles move with the scroll
+		redrawPendingMarkerLine = -1;
 		// Try to optimise small scrolls
 #ifndef UNDER_CE
 		const Sci::Line linesToMove = topLine - topLineNew;
@@ -1045,6 +1086,34 @@ void Editor::MoveSelectedLines(int lineDelta) {
 
 	const UndoGroup ug(pdoc);
 
+	// Moving by one line swaps the selection with the single adjacent line, so
+	// relocate that one line instead of copying, deleting and reinserting the
+	// whole selection. This keeps the work and the undo storage proportional
+	// to one line, making repeated moves of huge selections interactive.
+	// Ranges without a trailing end of line fall through to the general code.
+	if (lineDelta == -1 && !appendEol && IsEOLCharacter(pdoc->CharAt(selectionEnd - 1))) {
+		const Sci::Position lineAboveStart = pdoc->LineStart(startLine - 1);
+		const std::string lineAbove = RangeText(lineAboveStart, selectionStart);
+		const Sci::Position lengthLine = selectionStart - lineAboveStart;
+		pdoc->DeleteChars(lineAboveStart, lengthLine);
+		pdoc->InsertString(selectionEnd - lengthLine, lineAbove);
+		SetSelection(selectionStart - lengthLine, selectionEnd - lengthLine);
+		EnsureCaretVisible();
+		return;
+	}
+	if (lineDelta == 1 && selectionEnd != pdoc->LineStart(pdoc->LinesTotal() - 1)) {
+		const Sci::Position lineBelowEnd = pdoc->LineStart(endLine + 1);
+		if (lineBelowEnd > selectionEnd && IsEOLCharacter(pdoc->CharAt(lineBelowEnd - 1))) {
+			const std::string lineBelow = RangeText(selectionEnd, lineBelowEnd);
+			const Sci::Position lengthLine = lineBelowEnd - selectionEnd;
+			pdoc->DeleteChars(selectionEnd, lengthLine);
+			pdoc->InsertString(selectionStart, lineBelow);
+			SetSelection(selectionStart + lengthLine, selectionEnd + lengthLine);
+			EnsureCaretVisible();
+			return;
+		}
+	}
+
 	if (lineDelta > 0 && selectionEnd == pdoc->LineStart(pdoc->LinesTotal() - 1)) {
 		SetSelection(pdoc->MovePositionOutsideChar(selectionEnd - 1, -1), selectionEnd);
 		ClearSelection();
@@ -1486,6 +1555,88 @@ void Editor::NeedWrapping(Sci::Line docLineStart, Sci::Line docLineEnd, bool inv
 	}
 }
 
+// Capture the display heights of a completed wrap so that returning to the
+// current width and zoom can skip re-wrapping. Keeps a few recent snapshots
+// in most recently used order, enough for bouncing a window between two snap
+// positions or Ctrl+wheel zooming back and forth during a review.
+void Editor::SnapshotWrapHeights() {
+	if (wrapWidth <= 0 || wrapWidth == LineLayout::wrapWidthInfinite || wrapPending.NeedsWrap()) {
+		return;
+	}
+	// overwrite the matching slot, otherwise evict the oldest
+	size_t slot = std::size(wrapSnapshots) - 1;
+	for (size_t i = 0; i < std::size(wrapSnapshots); i++) {
+		if (wrapSnapshots[i].width == wrapWidth && wrapSnapshots[i].zoomLevel == vs.zoomLevel) {
+			slot = i;
+			break;
+		}
+	}
+	while (slot > 0) {
+		std::swap(wrapSnapshots[slot], wrapSnapshots[slot - 1]);
+		--slot;
+	}
+	WrapHeightSnapshot &current = wrapSnapshots[0];
+	current.width = wrapWidth;
+	current.zoomLevel = vs.zoomLevel;
+	const Sci::Line linesInDoc = pdoc->LinesTotal();
+	current.heights.resize(linesInDoc);
+	for (Sci::Line lineDoc = 0; lineDoc < linesInDoc; lineDoc++) {
+		current.heights[lineDoc] = pcs->GetHeight(lineDoc);
+	}
+}
+
+bool Editor::RestoreWrapHeights(int widthNew) {
+	for (size_t i = 0; i < std::size(wrapSnapshots); i++) {
+		const WrapHeightSnapshot &snapshot = wrapSnapshots[i];
+		if (snapshot.width == widthNew && snapshot.zoomLevel == vs.zoomLevel
+			&& snapshot.heights.size() == static_cast<size_t>(pdoc->LinesTotal())) {
+			wrapWidth = widthNew;
+			const Sci::Line linesInDoc = pdoc->LinesTotal();
+			for (Sci::Line lineDoc = 0; lineDoc < linesInDoc; lineDoc++) {
+				pcs->SetHeight(lineDoc, snapshot.heights[lineDoc]);
+			}
+			// layouts are still validated against their own wrapped width,
+			// so visible lines relayout lazily and match these heights
+			wrapPending.Reset();
+			while (i > 0) {
+				std::swap(wrapSnapshots[i], wrapSnapshots[i - 1]);
+				--i;
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+void Editor::InvalidateWrapSnapshots() noexcept {
+	for (WrapHeightSnapshot &snapshot : wrapSnapshots) {
+		snapshot.width = 0;
+	}
+}
+
+void Editor::SetZoomLevel(int zoomLevel) {
+	if (zoomLevel != vs.zoomLevel) {
+		// a zoom change invalidates fonts and layout but not the document, so
+		// keep the wrap snapshots: remember the geometry of the current zoom
+		// level and try to reuse one captured for the new level, which makes
+		// Ctrl+wheel bouncing over a wrapped file cheap after the first visit
+		// to each level.
+		if (Wrapping()) {
+			SnapshotWrapHeights();
+		}
+		vs.zoomLevel = zoomLevel;
+		vs.fontsValid = false;
+		NeedWrapping();
+		InvalidateStyleData();
+		if (Wrapping() && RestoreWrapHeights(wrapWidth)) {
+			SetScrollBars();
+			SetVerticalScrollPos();
+		}
+		Redraw();
+		NotifyZoom();
+	}
+}
+
 bool Editor::WrapOneLine(Surface *surface, Sci::Position positionInsert) {
 	const Sci::Line lineToWrap = pdoc->SciLineFromPosition(positionInsert);
 	const int posInLine = static_cast<int>(positionInsert - pdoc->LineStart(lineToWrap));
@@ -1512,6 +1663,124 @@ void Editor::OnLineWrapped(Sci::Line lineDoc, int linesWrapped, int option) {
 	}
 }
 
+namespace {
+
+// Lays out a block of lines over thread pool workers for Editor::WrapBlock().
+// Each line is measured into a private LineLayout so the layout cache is left
+// untouched and only the resulting sub-line counts survive; the cache is
+// refilled for the visible lines when they are painted. GDI text measurement
+// needs a surface per worker while DirectWrite measurement is thread safe on
+// the shared surface, as in EditView's LayoutWorker.
+class WrapBlockWorker {
+	EditView &view;
+	const EditModel &model;
+	const ViewStyle &vstyle;
+	Surface * const sharedSurface;
+	const Sci::Line lineToWrap;
+	const uint32_t lineCount;
+	const int wrapWidth;
+	int * const linesAfterWrap;
+	std::atomic<uint32_t> nextIndex = 0;
+#if !USE_WIN32_PTP_WORK
+	std::atomic<uint32_t> runningThread = 0;
+	HANDLE finishedEvent = nullptr;
+#endif
+
+public:
+	std::atomic<uint32_t> firstPartialLine = UINT32_MAX;
+	std::atomic<uint32_t> wrappedBytesAllThread = 0;
+	std::atomic<uint32_t> wrappedBytesOneThread = 0;
+
+	WrapBlockWorker(EditView &view_, const EditModel &model_, const ViewStyle &vstyle_, Surface *surface,
+		Sci::Line lineToWrap_, uint32_t lineCount_, int wrapWidth_, int *linesAfterWrap_) noexcept :
+		view{view_}, model{model_}, vstyle{vstyle_}, sharedSurface{surface},
+		lineToWrap{lineToWrap_}, lineCount{lineCount_}, wrapWidth{wrapWidth_}, linesAfterWrap{linesAfterWrap_} {}
+
+	std::unique_ptr<Surface> CreateMeasurementSurface() const {
+		if (vstyle.technology == Technology::Default) {
+			std::unique_ptr<Surface> surf = Surface::Allocate(Technology::Default);
+			surf->Init(nullptr);
+			surf->SetMode(model.CurrentSurfaceMode());
+			return surf;
+		}
+		return {};
+	}
+
+	void DoWork() {
+		const std::unique_ptr<Surface> surf{CreateMeasurementSurface()};
+		Surface * const surface = surf ? surf.get() : sharedSurface;
+		while (true) {
+			const uint32_t index = nextIndex.fetch_add(1, std::memory_order_relaxed);
+			if (index >= lineCount || index >= firstPartialLine.load(std::memory_order_relaxed)) {
+				break;
+			}
+			const Sci::Line lineNumber = lineToWrap + index;
+			const Sci::Position lineStart = model.pdoc->LineStart(lineNumber);
+			const int lengthLine = static_cast<int>(model.pdoc->LineStart(lineNumber + 1) - lineStart);
+			LineLayout ll(lineNumber, lengthLine);
+			const uint64_t wrappedBytes = view.LayoutLine(model, surface, vstyle, &ll, wrapWidth, LayoutLineOption::IdleUpdate);
+			wrappedBytesAllThread.fetch_add(wrappedBytes & UINT32_MAX, std::memory_order_relaxed);
+			wrappedBytesOneThread.fetch_add(static_cast<uint32_t>(wrappedBytes >> 32), std::memory_order_relaxed);
+			linesAfterWrap[index] = ll.lines;
+			if (ll.PartialPosition()) {
+				// idle time budget exhausted: remaining lines stay pending as in the serial path
+				uint32_t expected = firstPartialLine.load(std::memory_order_relaxed);
+				while (index < expected && !firstPartialLine.compare_exchange_weak(expected, index, std::memory_order_relaxed)) {
+					// retry
+				}
+				break;
+			}
+		}
+#if !USE_WIN32_PTP_WORK
+		const uint32_t prev = runningThread.fetch_sub(1, std::memory_order_release);
+		if (prev == 1) {
+			SetEvent(finishedEvent);
+		}
+#endif
+	}
+
+	void Run(uint32_t threadCount) {
+#if USE_WIN32_PTP_WORK
+		PTP_WORK work = CreateThreadpoolWork(WorkCallback, this, nullptr);
+		if (work) {
+			for (uint32_t i = 0; i < threadCount; i++) {
+				SubmitThreadpoolWork(work);
+			}
+			WaitForThreadpoolWorkCallbacks(work, FALSE);
+			CloseThreadpoolWork(work);
+			return;
+		}
+#else
+		finishedEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+		if (finishedEvent) {
+			runningThread.store(threadCount, std::memory_order_relaxed);
+			for (uint32_t i = 0; i < threadCount; i++) {
+				QueueUserWorkItem(ThreadProc, this, WT_EXECUTEDEFAULT);
+			}
+			WaitForSingleObject(finishedEvent, INFINITE);
+			CloseHandle(finishedEvent);
+			return;
+		}
+#endif
+		DoWork();
+	}
+
+#if USE_WIN32_PTP_WORK
+	static VOID CALLBACK WorkCallback([[maybe_unused]] PTP_CALLBACK_INSTANCE instance, PVOID context, [[maybe_unused]] PTP_WORK work) {
+		WrapBlockWorker *worker = static_cast<WrapBlockWorker *>(context);
+		worker->DoWork();
+	}
+#else
+	static DWORD WINAPI ThreadProc(LPVOID lpParameter) {
+		WrapBlockWorker *worker = static_cast<WrapBlockWorker *>(lpParameter);
+		worker->DoWork();
+		return 0;
+	}
+#endif
+};
+
+}
+
 bool Editor::WrapBlock(Surface *surface, Sci::Line lineToWrap, Sci::Line lineToWrapEnd, Sci::Line &partialLine) {
 	const size_t linesBeingWrapped = static_cast<size_t>(lineToWrapEnd - lineToWrap);
 	const std::unique_ptr<int[]> linesAfterWrap = std::make_unique<int[]>(linesBeingWrapped);
@@ -1530,28 +1799,45 @@ bool Editor::WrapBlock(Surface *surface, Sci::Line lineToWrap, Sci::Line lineToW
 	const ElapsedPeriod epWrapping;
 	SetIdleTaskTime(IdleLineWrapTime);
 
-	// Wrap all the long lines in the main thread.
-	// LayoutLine may then multi-thread over segments in each line.
 	uint32_t wrappedBytesAllThread = 0;
 	uint32_t wrappedBytesOneThread = 0;
-	for (size_t index = 0; index < linesBeingWrapped; index++) {
-		const Sci::Line lineNumber = lineToWrap + index;
-		const Sci::Position lineStart = pdoc->LineStart(lineNumber);
-		const Sci::Position lineEnd = pdoc->LineStart(lineNumber + 1);
-		const int lengthLine = static_cast<int>(lineEnd - lineStart);
-		LineLayout * const ll = view.llc.Retrieve(lineNumber, significantLines, lengthLine);
-		if (lineNumber == significantLines.lineCaret) {
-			ll->caretPosition = static_cast<int>(caretPosition - lineStart);
-		} else {
-			ll->caretPosition = 0;
-		}
-		const uint64_t wrappedBytes = view.LayoutLine(*this, surface, vs, ll, wrapWidth, LayoutLineOption::IdleUpdate);
-		wrappedBytesAllThread += wrappedBytes & UINT32_MAX;
-		wrappedBytesOneThread += wrappedBytes >> 32;
-		linesAfterWrap[index] = ll->lines;
-		if (ll->PartialPosition()) {
-			partialLine = lineNumber;
-			break;
+
+	// Large blocks (idle or full re-wrap) are partitioned over the thread pool;
+	// the small visible-priority blocks stay serial so their layouts are cached.
+	constexpr size_t minParallelWrapLines = 256;
+	if (linesBeingWrapped >= minParallelWrapLines && hardwareConcurrency > 1) {
+		WrapBlockWorker worker{view, *this, vs, surface, lineToWrap,
+			static_cast<uint32_t>(linesBeingWrapped), wrapWidth, linesAfterWrap.get()};
+		const uint32_t threadCount = std::min(hardwareConcurrency, static_cast<uint32_t>(linesBeingWrapped / 64));
+		worker.Run(threadCount);
+		wrappedBytesAllThread = worker.wrappedBytesAllThread.load(std::memory_order_relaxed);
+		wrappedBytesOneThread = worker.wrappedBytesOneThread.load(std::memory_order_relaxed);
+		const uint32_t firstPartial = worker.firstPartialLine.load(std::memory_order_relaxed);
+		if (firstPartial != UINT32_MAX) {
+			partialLine = lineToWrap + firstPartial;
+		}
+	} else {
+		// Wrap all the long lines in the main thread.
+		// LayoutLine may then multi-thread over segments in each line.
+		for (size_t index = 0; index < linesBeingWrapped; index++) {
+			const Sci::Line lineNumber = lineToWrap + index;
+			const Sci::Position lineStart = pdoc->LineStart(lineNumber);
+			const Sci::Position lineEnd = pdoc->LineStart(lineNumber + 1);
+			const int lengthLine = static_cast<int>(lineEnd - lineStart);
+			LineLayout * const ll = view.llc.Retrieve(lineNumber, significantLines, lengthLine);
+			if (lineNumber == significantLines.lineCaret) {
+				ll->caretPosition = static_cast<int>(caretPosition - lineStart);
+			} else {
+				ll->caretPosition = 0;
+			}
+			const uint64_t wrappedBytes = view.LayoutLine(*this, surface, vs, ll, wrapWidth, LayoutLineOption::IdleUpdate);
+			wrappedBytesAllThread += wrappedBytes & UINT32_MAX;
+			wrappedBytesOneThread += wrappedBytes >> 32;
+			linesAfterWrap[index] = ll->lines;
+			if (ll->PartialPosition()) {
+				partialLine = lineNumber;
+				break;
+			}
 		}
 	}
 
@@ -1786,8 +2072,10 @@ void Editor::RefreshPixMaps(Surface *surfaceWindow) {
 }
 
 void Editor::Paint(Surface *surfaceWindow, PRectangle rcArea) {
+	NP2_TRACE_SCOPE2("Editor::Paint", rcArea.Height());
 	redrawPendingText = false;
 	redrawPendingMargin = false;
+	redrawPendingMarkerLine = -1;
 
 	//Platform::DebugPrintf("Paint:%1d (%.0f,%.0f) ... (%.0f,%.0f)\n",
 	//	paintingAllText, rcArea.left, rcArea.top, rcArea.right, rcArea.bottom);
@@ -1799,7 +2087,12 @@ void Editor::Paint(Surface *surfaceWindow, PRectangle rcArea) {
 
 	paintAbandonedByStyling = false;
 
+	const bool profilePaint = view.profiler.enabled;
+	ElapsedPeriod epStage;
 	StyleAreaBounded(rcArea, false);
+	if (profilePaint) {
+		view.profiler.durStyle = epStage.Reset();
+	}
 
 	const PRectangle rcClient = GetClientRectangle();
 	//Platform::DebugPrintf("Client: (%.0f,%.0f) ... (%.0f,%.0f)\n",
@@ -1811,6 +2104,9 @@ void Editor::Paint(Surface *surfaceWindow, PRectangle rcArea) {
 	}
 
 	// Wrap the visible lines if needed.
+	if (profilePaint) {
+		epStage.Reset();
+	}
 	if (WrapLines(WrapScope::wsVisible)) {
 		// The wrapping process has changed the height of some lines so
 		// abandon this paint for a complete repaint.
@@ -1819,6 +2115,9 @@ void Editor::Paint(Surface *surfaceWindow, PRectangle rcArea) {
 		}
 		RefreshPixMaps(surfaceWindow);	// In case pixmaps invalidated by scrollbar change
 	}
+	if (profilePaint) {
+		view.profiler.durWrap = epStage.Reset();
+	}
 
 	if (!marginView.pixmapSelPattern->Initialised()) {
 		// When Direct2D is used, pixmap creation may fail with D2DERR_RECREATE_TARGET so
@@ -1830,6 +2129,9 @@ void Editor::Paint(Surface *surfaceWindow, PRectangle rcArea) {
 	if (!view.bufferedDraw)
 		surfaceWindow->SetClip(rcArea);
 
+	if (profilePaint) {
+		epStage.Reset();
+	}
 	if (paintState != PaintState::abandoned) {
 		if (vs.marginInside) {
 			PaintSelMargin(surfaceWindow, rcArea);
@@ -1847,6 +2149,9 @@ void Editor::Paint(Surface *surfaceWindow, PRectangle rcArea) {
 			}
 		}
 	}
+	if (profilePaint) {
+		view.profiler.durMargin = epStage.Duration();
+	}
 
 	if (paintState == PaintState::abandoned) {
 		// Either styling or NotifyUpdateUI noticed that painting is needed
@@ -1938,8 +2243,17 @@ void Editor::ChangeSize() {
 		PRectangle rcTextArea = GetClientRectangle();
 		rcTextArea.left = static_cast<XYPOSITION>(vs.textStart);
 		rcTextArea.right -= vs.rightMarginWidth;
-		if (wrapWidth != rcTextArea.Width()) {
-			NeedWrapping();
+		const int widthNew = static_cast<int>(rcTextArea.Width());
+		if (wrapWidth != widthNew) {
+			// remember the completed wrap for the old width, then try to
+			// reuse a wrap previously computed for the new width
+			SnapshotWrapHeights();
+			if (RestoreWrapHeights(widthNew)) {
+				SetScrollBars();
+				SetVerticalScrollPos();
+			} else {
+				NeedWrapping();
+			}
 			Redraw();
 		}
 	}
@@ -2011,8 +2325,45 @@ void Editor::InsertCharacter(std::string_view sv, CharacterSource charSource) {
 		std::sort(selPtrs.begin(), selPtrs.end(),
 			[](const SelectionRange *a, const SelectionRange *b) noexcept { return *a < *b; });
 
+		bool batched = false;
+		if (selPtrs.size() > 1 && encloseCh == '\0' && sel.Empty() && !inOverstrike &&
+			sv.find_first_of("\r\n") == std::string_view::npos) {
+			// Batch plain typing into many carets, as with a large rectangular
+			// selection: one insertion pass over the buffer and one span-wide
+			// modification pair instead of a pair per caret, so updating
+			// selections and the display stays linear in the caret count.
+			std::vector<Sci::Position> positions;
+			positions.reserve(selPtrs.size());
+			Sci::Position previous = -1;
+			for (const SelectionRange *currentSel : selPtrs) {
+				const Sci::Position positionInsert = currentSel->caret.Position();
+				if (positionInsert <= previous || currentSel->caret.VirtualSpace() != 0 ||
+					RangeContainsProtected(*currentSel) || pdoc->IsCrLf(positionInsert - 1)) {
+					break;
+				}
+				previous = positionInsert;
+				positions.push_back(positionInsert);
+			}
+			if (positions.size() == selPtrs.size()) {
+				const Sci::Position lengthInserted = pdoc->InsertStringMulti(positions.data(), positions.size(), sv.data(), sv.length());
+				batched = true;
+				if (lengthInserted > 0) {
+					Sci::Position moved = lengthInserted;
+					for (size_t i = 0; i < positions.size(); i++) {
+						*selPtrs[i] = SelectionRange(positions[i] + moved);
+						moved += lengthInserted;
+					}
+					if (Wrapping()) {
+						NeedWrapping(pdoc->SciLineFromPosition(positions.front()),
+							pdoc->SciLineFromPosition(positions.back() + moved - lengthInserted) + 1);
+						wrapOccurred = true;
+					}
+				}
+			}
+		}
+
 		// Loop in reverse to avoid disturbing positions of selections yet to be processed.
-		for (auto rit = selPtrs.rbegin(); rit != selPtrs.rend(); ++rit) {
+		for (auto rit = selPtrs.rbegin(); !batched && rit != selPtrs.rend(); ++rit) {
 			SelectionRange *currentSel = *rit;
 			if (!RangeContainsProtected(*currentSel)) {
 				Sci::Position positionInsert = currentSel->Start().Position();
@@ -2423,6 +2774,56 @@ bool Editor::BackspaceUnindent(Sci::Position lineCurrentPos, Sci::Position caret
 	return false;
 }
 
+bool Editor::DelCharBackMulti() {
+	// Batch plain backspace over many carets, as with batched typing: one
+	// deletion pass over the buffer and one span-wide modification pair
+	// instead of a pair per caret. Any caret that needs the general path
+	// (virtual space, line joining, unindenting, protection) sends the
+	// whole edit back to the per-caret loop.
+	std::vector<SelectionRange *> selPtrs;
+	for (size_t r = 0; r < sel.Count(); r++) {
+		selPtrs.push_back(&sel.Range(r));
+	}
+	std::sort(selPtrs.begin(), selPtrs.end(),
+		[](const SelectionRange *a, const SelectionRange *b) noexcept { return *a < *b; });
+
+	std::vector<Sci::Position> positions;
+	std::vector<Sci::Position> lengths;
+	positions.reserve(selPtrs.size());
+	lengths.reserve(selPtrs.size());
+	Sci::Position previousEnd = 0;
+	for (const SelectionRange *currentSel : selPtrs) {
+		const Sci::Position caretPosition = currentSel->caret.Position();
+		if (currentSel->caret.VirtualSpace() != 0 ||
+			RangeContainsProtected(caretPosition - 1, caretPosition)) {
+			return false;
+		}
+		const Sci::Line lineCurrentPos = pdoc->SciLineFromPosition(caretPosition);
+		if (pdoc->LineStart(lineCurrentPos) == caretPosition) {
+			return false;	// joins lines or deletes nothing
+		}
+		if (pdoc->backspaceUnindents && IsSpaceOrTab(pdoc->CharAt(caretPosition - 1))) {
+			return false;	// may unindent instead
+		}
+		const Sci::Position startChar = pdoc->NextPosition(caretPosition, -1);
+		if (startChar < previousEnd) {
+			return false;	// duplicate or touching carets
+		}
+		previousEnd = caretPosition;
+		positions.push_back(startChar);
+		lengths.push_back(caretPosition - startChar);
+	}
+	if (!pdoc->DeleteRangesMulti(positions.data(), lengths.data(), positions.size())) {
+		return false;
+	}
+	Sci::Position removed = 0;
+	for (size_t i = 0; i < positions.size(); i++) {
+		removed += lengths[i];
+		*selPtrs[i] = SelectionRange(positions[i] + lengths[i] - removed);
+	}
+	return true;
+}
+
 void Editor::DelCharBack(bool allowLineStartDeletion) {
 	RefreshStyleData();
 	if (!sel.IsRectangular())
@@ -2431,26 +2832,28 @@ void Editor::DelCharBack(bool allowLineStartDeletion) {
 		allowLineStartDeletion = false;
 	const UndoGroup ug(pdoc, (sel.Count() > 1) || !sel.Empty());
 	if (sel.Empty()) {
-		for (size_t r = 0; r < sel.Count(); r++) {
-			const Sci::Position caretPosition = sel.Range(r).caret.Position();
-			if (!RangeContainsProtected(caretPosition - 1, caretPosition)) {
-				if (sel.Range(r).caret.VirtualSpace()) {
-					sel.Range(r).caret.SetVirtualSpace(sel.Range(r).caret.VirtualSpace() - 1);
-					sel.Range(r).anchor.SetVirtualSpace(sel.Range(r).caret.VirtualSpace());
-				} else {
-					const Sci::Line lineCurrentPos = pdoc->SciLineFromPosition(caretPosition);
-					if (allowLineStartDeletion || (pdoc->LineStart(lineCurrentPos) != caretPosition)) {
-						Sci::Position posSelect;
-						if (BackspaceUnindent(lineCurrentPos, caretPosition, &posSelect)) {
-							// SetEmptySelection
-							sel.Range(r) = SelectionRange(posSelect);
-						} else {
-							pdoc->DelCharBack(caretPosition);
+		if (sel.Count() <= 1 || !DelCharBackMulti()) {
+			for (size_t r = 0; r < sel.Count(); r++) {
+				const Sci::Position caretPosition = sel.Range(r).caret.Position();
+				if (!RangeContainsProtected(caretPosition - 1, caretPosition)) {
+					if (sel.Range(r).caret.VirtualSpace()) {
+						sel.Range(r).caret.SetVirtualSpace(sel.Range(r).caret.VirtualSpace() - 1);
+						sel.Range(r).anchor.SetVirtualSpace(sel.Range(r).caret.VirtualSpace());
+					} else {
+						const Sci::Line lineCurrentPos = pdoc->SciLineFromPosition(caretPosition);
+						if (allowLineStartDeletion || (pdoc->LineStart(lineCurrentPos) != caretPosition)) {
+							Sci::Position posSelect;
+							if (BackspaceUnindent(lineCurrentPos, caretPosition, &posSelect)) {
+								// SetEmptySelection
+								sel.Range(r) = SelectionRange(posSelect);
+							} else {
+								pdoc->DelCharBack(caretPosition);
+							}
 						}
 					}
+				} else {
+					sel.Range(r).ClearVirtualSpace();
 				}
-			} else {
-				sel.Range(r).ClearVirtualSpace();
 			}
 		}
 		ThinRectangularRange();
@@ -2726,8 +3129,19 @@ constexpr Sci::Position MovePositionForDeletion(Sci::Position position, Sci::Pos
 }
 
 void Editor::NotifyModified(Document *, DocModification mh, void *) {
+	if (FlagSet(mh.modificationType, ModificationFlags::InsertText | ModificationFlags::DeleteText
+		| ModificationFlags::ChangeStyle | ModificationFlags::ChangeAnnotation)) {
+		// the captured wrap heights no longer describe the document
+		InvalidateWrapSnapshots();
+	}
 	if (FlagSet(mh.modificationType, ModificationFlags::InsertText | ModificationFlags::DeleteText)) {
 		ContainerNeedsUpdate(Update::Content);
+		if (changeHistoryOption != ChangeHistoryOption::Disabled) {
+			// Compact the change history runs fragmented by the edit once idle
+			QueueIdleWork(WorkItems::changeHistory);
+		}
+		// Move the buffer gaps towards the predicted next edit site once idle
+		QueueIdleWork(WorkItems::gapPosition);
 	}
 	if (paintState == PaintState::painting) {
 		CheckForChangeOutsidePaint(Range(mh.position, mh.position + mh.length));
@@ -2800,7 +3214,10 @@ void Editor::NotifyModified(Document *, DocModification mh, void *) {
 			const Sci::Line lineDoc = pdoc->SciLineFromPosition(mh.position);
 			if (vs.annotationVisible != AnnotationVisible::Hidden) {
 				if (pcs->SetHeight(lineDoc, pcs->GetHeight(lineDoc) + static_cast<int>(mh.annotationLinesAdded))) {
-					SetScrollBars();
+					// Coalesce the scroll revalidation: annotating thousands of
+					// lines in one batch then revalidates once before the next
+					// paint instead of per call.
+					QueueIdleWork(WorkItems::scrollBars);
 				}
 				Redraw();
 			}
@@ -2861,12 +3278,20 @@ void Editor::NotifyModified(Document *, DocModification mh, void *) {
 		SetScrollBars();
 	}
 
+	if (mh.linesAdded != 0) {
+		// Line numbers shifted so the remembered marker line is stale
+		redrawPendingMarkerLine = -1;
+	}
 	if (FlagSet(mh.modificationType, (ModificationFlags::ChangeMarker | ModificationFlags::ChangeMargin))) {
 		if ((!willRedrawAll) && ((paintState == PaintState::notPainting) || !PaintContainsMargin())) {
 			if (FlagSet(mh.modificationType, ModificationFlags::ChangeFold)) {
 				// Fold changes can affect the drawing of following lines so redraw whole margin
 				RedrawSelMargin(marginView.highlightDelimiter.isEnabled ? -1 : mh.line - 1, true);
-			} else {
+			} else if (mh.line != redrawPendingMarkerLine) {
+				// Marker changes arrive one notification per marker and Find All
+				// can add many bookmarks to one line in a burst, so skip lines
+				// whose rectangle was already invalidated since the last paint
+				redrawPendingMarkerLine = mh.line;
 				RedrawSelMargin(mh.line);
 			}
 		}
@@ -4021,16 +4446,10 @@ int Editor::KeyCommand(Message iMessage) {
 		AddChar('\f');
 		break;
 	case Message::ZoomIn:
-		if (vs.ZoomIn()) {
-			InvalidateStyleRedraw();
-			NotifyZoom();
-		}
+		SetZoomLevel(vs.NextZoomLevel(true));
 		break;
 	case Message::ZoomOut:
-		if (vs.ZoomOut()) {
-			InvalidateStyleRedraw();
-			NotifyZoom();
-		}
+		SetZoomLevel(vs.NextZoomLevel(false));
 		break;
 
 	case Message::DelWordLeft:
@@ -5196,6 +5615,8 @@ bool Editor::Idle() {
 		needWrap = wrapPending.NeedsWrap();
 	} else if (needIdleStyling) {
 		IdleStyle();
+	} else if (needIdleLayout) {
+		IdleLayout();
 	}
 
 	// Add more idle things to do here, but make sure idleDone is
@@ -5203,7 +5624,7 @@ bool Editor::Idle() {
 	// false will stop calling this idle function until SetIdle() is
 	// called again.
 
-	const bool idleDone = !needWrap && !needIdleStyling; // && thatDone && theOtherThingDone...
+	const bool idleDone = !needWrap && !needIdleStyling && !needIdleLayout; // && thatDone && theOtherThingDone...
 
 	return !idleDone;
 }
@@ -5294,16 +5715,12 @@ void Editor::StyleToPositionInView(Sci::Position pos) {
 	}
 }
 
-Sci::Position Editor::PositionAfterMaxStyling(Sci::Position posMax, bool scrolling) const noexcept {
+Sci::Position Editor::PositionAfterMaxStyling(Sci::Position posMax, double secondsAllowed) const noexcept {
 	if (SynchronousStylingToVisible()) {
 		// Both states do not limit styling
 		return posMax;
 	}
 
-	// Try to keep time taken by styling reasonable so interaction remains smooth.
-	// When scrolling, allow less time to ensure responsive
-	const double secondsAllowed = scrolling ? 0.005 : 0.02;
-
 	Sci::Line lineLast = pdoc->SciLineFromPosition(pdoc->GetEndStyled());
 	const int actionsInAllowedTime = pdoc->durationStyleOneUnit.ActionsInAllowedTime(secondsAllowed);
 	lineLast = pdoc->LineFromPositionAfter(lineLast, actionsInAllowedTime);
@@ -5330,7 +5747,8 @@ void Editor::StartIdleStyling(bool truncatedLastStyling) noexcept {
 // Style for an area but bound the amount of styling to remain responsive
 void Editor::StyleAreaBounded(PRectangle rcArea, bool scrolling) {
 	const Sci::Position posAfterArea = PositionAfterArea(rcArea);
-	const Sci::Position posAfterMax = PositionAfterMaxStyling(posAfterArea, scrolling);
+	// When scrolling, allow less time to ensure responsive
+	const Sci::Position posAfterMax = PositionAfterMaxStyling(posAfterArea, scrolling ? idleStyleBudget*0.25 : idleStyleBudget);
 	if (posAfterMax < posAfterArea) {
 		// Idle styling may be performed before current visible area
 		// Style a bit now then style further in idle time
@@ -5342,23 +5760,98 @@ void Editor::StyleAreaBounded(PRectangle rcArea, bool scrolling) {
 	StartIdleStyling(posAfterMax < posAfterArea);
 }
 
+// Style ahead of a scrollbar drag: the caller extrapolates where the thumb is
+// heading and styling runs toward that display line on the tighter scrolling
+// budget, so scrubbing through an unstyled region keeps showing styled lines.
+// Styling is sequential, so an upward drag never has unstyled text ahead and
+// returns immediately. Layout of the band around the new top line is
+// prefetched in idle time afterwards.
+void Editor::StyleScrollPrediction(Sci::Line displayLine) {
+	displayLine = std::clamp<Sci::Line>(displayLine, 0, pcs->LinesDisplayed() - 1);
+	const Sci::Line lineDoc = pcs->DocFromDisplay(displayLine);
+	const Sci::Position posPredicted = pdoc->LineStart(lineDoc + 1);
+	if (pdoc->GetEndStyled() < posPredicted) {
+		const Sci::Position posAfterMax = PositionAfterMaxStyling(posPredicted, idleStyleBudget*0.25);
+		pdoc->StyleToAdjustingLineDuration(posAfterMax);
+		StartIdleStyling(posAfterMax < posPredicted);
+	}
+	needIdleLayout = true;
+	SetIdle(true);
+}
+
 void Editor::IdleStyle() {
+	// Styling is sequential from the last styled position so a scroll
+	// destination can not be styled out of order; prioritize it by dedicating
+	// the slice to the viewport whenever it is still unstyled, so the pending
+	// paint runs as soon as the view is healed instead of after the slice has
+	// also raced ahead into the rest of the document.
 	const Sci::Position posAfterArea = PositionAfterArea(GetClientRectangle());
 	const Sci::Position endGoal = (idleStyling >= IdleStyling::AfterVisible) ?
 		pdoc->LengthNoExcept() : posAfterArea;
-	const Sci::Position posAfterMax = PositionAfterMaxStyling(endGoal, false);
-	pdoc->StyleToAdjustingLineDuration(posAfterMax);
+	const Sci::Position sliceGoal = (pdoc->GetEndStyled() < posAfterArea) ? posAfterArea : endGoal;
+	// Style in sub-slices against a measured deadline rather than trusting a
+	// single duration estimate: the estimate can be far off right after a
+	// lexer change and overshooting here steals whole frames from scrolling.
+	const ElapsedPeriod epBudget;
+	do {
+		const Sci::Position posAfterMax = PositionAfterMaxStyling(sliceGoal, idleStyleBudget*0.25);
+		pdoc->StyleToAdjustingLineDuration(posAfterMax);
+	} while ((pdoc->GetEndStyled() < sliceGoal) && (epBudget.Duration() < idleStyleBudget*0.75));
 	if (pdoc->GetEndStyled() >= endGoal) {
 		needIdleStyling = false;
 	}
 }
 
+void Editor::IdleLayout() {
+	// Lay out the lines one page above and below the viewport into the layout
+	// cache so lines exposed by scrolling paint without cold layout cost.
+	// One page on each side also keeps the whole window inside the near arena
+	// of the page level cache so prefetched layouts do not evict each other.
+	needIdleLayout = false;
+	RefreshStyleData();
+	const AutoSurface surface(this);
+	if (!surface) {
+		return;
+	}
+	const Sci::Line lineDocTop = pcs->DocFromDisplay(topLine);
+	const Sci::Line linesOnScreen = LinesOnScreen();
+	const Sci::Line lineStart = std::max<Sci::Line>(lineDocTop - linesOnScreen, 0);
+	const Sci::Line lineEnd = std::min(lineDocTop + 2*linesOnScreen + 1, pdoc->LinesTotal());
+	pdoc->EnsureStyledTo(pdoc->LineStart(lineEnd));
+	SetIdleTaskTime(IdleLineWrapTime);
+	for (Sci::Line lineDoc = lineStart; lineDoc < lineEnd; lineDoc++) {
+		if (!pcs->GetVisible(lineDoc)) {
+			continue;
+		}
+		LineLayout * const ll = view.RetrieveLineLayout(lineDoc, *this);
+		view.LayoutLine(*this, surface, vs, ll, wrapWidth, LayoutLineOption::IdleUpdate);
+		if (ll->PartialPosition() || WaitableTimerExpired(idleTaskTimer)) {
+			// Out of time, continue from a fresh window in the next idle slice.
+			needIdleLayout = true;
+			break;
+		}
+	}
+}
+
 void Editor::IdleWork() {
 	// Style the line after the modification as this allows modifications that change just the
 	// line of the modification to heal instead of propagating to the rest of the window.
 	if (FlagSet(workNeeded.items, WorkItems::style)) {
 		StyleToPositionInView(pdoc->LineStart(pdoc->SciLineFromPosition(workNeeded.upTo) + 2));
 	}
+	if (FlagSet(workNeeded.items, WorkItems::changeHistory)) {
+		pdoc->ChangeHistoryCompact();
+	}
+	if (FlagSet(workNeeded.items, WorkItems::gapPosition)) {
+		// moving the buffer gaps would race the background styler's live
+		// reads of the buffer: complete the pending chunk first, the same
+		// handoff the modification gateways perform.
+		pdoc->CompleteBackgroundStyling(true);
+		pdoc->PrepositionGaps();
+	}
+	if (FlagSet(workNeeded.items, WorkItems::scrollBars)) {
+		SetScrollBars();
+	}
 	NotifyUpdateUI();
 	workNeeded.Reset();
 }
@@ -5482,6 +5975,7 @@ void Editor::SetDocPointer(Document *document) {
 	pcs->InsertLines(0, pdoc->LinesTotal() - 1);
 	SetAnnotationHeights(0, pdoc->LinesTotal());
 	view.llc.Deallocate();
+	InvalidateWrapSnapshots();
 	NeedWrapping();
 
 	hotspot = Range(Sci::invalidPosition);
@@ -5593,7 +6087,8 @@ void Editor::FoldLine(Sci::Line line, FoldAction action) {
 		}
 
 		SetScrollBars();
-		Redraw();
+		// the header keeps its display position; only the band below it changed
+		RedrawFromLine(pcs->DisplayFromDoc(line));
 	}
 }
 
@@ -5612,6 +6107,7 @@ void Editor::FoldExpand(Sci::Line line, FoldAction action, FoldLevel level) {
 	}
 
 	const Sci::Line lineMaxSubord = pdoc->GetLastChild(line, level);
+	const Sci::Line lineDisplay = pcs->DisplayFromDoc(line);
 	line++;
 	pcs->SetVisible(line, lineMaxSubord, expanding);
 	while (line <= lineMaxSubord) {
@@ -5622,7 +6118,7 @@ void Editor::FoldExpand(Sci::Line line, FoldAction action, FoldLevel level) {
 		line++;
 	}
 	SetScrollBars();
-	Redraw();
+	RedrawFromLine(lineDisplay);
 }
 
 Sci::Line Editor::ContractedFoldNext(Sci::Line lineStart) const noexcept {
@@ -6647,6 +7143,20 @@ sptr_t Editor::WndProc(Message iMessage, uptr_t wParam, sptr_t lParam) {
 		}
 		return 0;
 
+	case Message::ExecuteBatch: {
+		// execute a recorded command sequence inside one entry into the window
+		// procedure, with a single undo group and one redraw/notification cycle.
+		const MessageRecord *records = AsPointer<const MessageRecord *>(lParam);
+		const UndoGroup ug(pdoc, wParam > 1);
+		BeginBatchUpdate();
+		sptr_t result = 0;
+		for (uptr_t i = 0; i < wParam; i++) {
+			result = WndProc(static_cast<Message>(records[i].message), records[i].wParam, records[i].lParam);
+		}
+		EndBatchUpdate();
+		return result;
+	}
+
 	case Message::GetUndoSequence:
 		return pdoc->UndoSequenceDepth();
 
@@ -7005,6 +7515,8 @@ sptr_t Editor::WndProc(Message iMessage, uptr_t wParam, sptr_t lParam) {
 			pdoc->tabInChars = static_cast<int>(wParam);
 			if (pdoc->indentInChars == 0)
 				pdoc->actualIndentInChars = pdoc->tabInChars;
+			// cached indentation widths depend on the tab width
+			pdoc->ClearIndentCache();
 		}
 		InvalidateStyleRedraw();
 		break;
@@ -7103,6 +7615,11 @@ sptr_t Editor::WndProc(Message iMessage, uptr_t wParam, sptr_t lParam) {
 		idleStyling = static_cast<IdleStyling>(wParam);
 		break;
 
+	case Message::SetIdleStylingBudget:
+		// milliseconds of styling per idle slice or paint, 0 restores the default
+		idleStyleBudget = wParam ? static_cast<double>(wParam) / 1000.0 : defaultIdleStyleBudget;
+		break;
+
 	case Message::GetIdleStyling:
 		return static_cast<sptr_t>(idleStyling);
 
@@ -7166,6 +7683,41 @@ sptr_t Editor::WndProc(Message iMessage, uptr_t wParam, sptr_t lParam) {
 	case Message::GetLayoutCache:
 		return static_cast<sptr_t>(view.llc.GetLevel());
 
+	case Message::SetLayoutCacheBudget:
+		view.llc.SetBudget(wParam);
+		break;
+
+	case Message::GetLayoutCacheStats:
+		if (LayoutCacheStats *stats = AsPointer<LayoutCacheStats *>(lParam)) {
+			view.llc.GetStatistics(*stats);
+		}
+		break;
+
+	case Message::GetMemoryUsage:
+		if (MemoryUsage *usage = AsPointer<MemoryUsage *>(lParam)) {
+			*usage = {};
+			pdoc->CountMemory(*usage);
+			LayoutCacheStats stats {};
+			view.llc.GetStatistics(stats);
+			usage->layoutBytes = stats.cachedBytes;
+			return usage->textBytes + usage->styleBytes + usage->undoBytes + usage->perLineBytes + usage->layoutBytes;
+		}
+		break;
+
+	case Message::GetLineEndCounts:
+		if (LineEndCounts *counts = AsPointer<LineEndCounts *>(lParam)) {
+			*counts = pdoc->GetLineEndCounts();
+		}
+		break;
+
+	case Message::SetPaintProfiler:
+		view.profiler.enabled = wParam != 0;
+		Redraw();
+		break;
+
+	case Message::GetPaintProfiler:
+		return view.profiler.enabled;
+
 	case Message::SetPositionCache:
 		view.posCache.SetSize(wParam);
 		break;
@@ -7397,6 +7949,12 @@ sptr_t Editor::WndProc(Message iMessage, uptr_t wParam, sptr_t lParam) {
 			pdoc->AddMarkSet(LineFromUPtr(wParam), static_cast<MarkerMask>(lParam));
 		break;
 
+	case Message::MarkerAddList:
+		if (const MarkerList *list = AsPointer<const MarkerList *>(lParam)) {
+			pdoc->AddMarkList(reinterpret_cast<const Sci::Line *>(list->lines), static_cast<size_t>(list->count), static_cast<int>(wParam));
+		}
+		break;
+
 	case Message::MarkerDelete:
 		pdoc->DeleteMark(LineFromUPtr(wParam), static_cast<int>(lParam));
 		break;
@@ -7412,6 +7970,12 @@ sptr_t Editor::WndProc(Message iMessage, uptr_t wParam, sptr_t lParam) {
 		return pdoc->MarkerNext(LineFromUPtr(wParam), static_cast<MarkerMask>(lParam));
 
 	case Message::MarkerPrevious: {
+			/* Bits: RevertedToOrigin, Saved, Modified, RevertedToModified */
+			constexpr MarkerMask maskHistory = 0xFU << static_cast<unsigned int>(MarkerOutline::HistoryRevertedToOrigin);
+			if ((lParam & maskHistory) == 0) {
+				return pdoc->MarkerPrevious(LineFromUPtr(wParam), static_cast<MarkerMask>(lParam));
+			}
+			// Change history marks are computed per line so scan
 			for (Sci::Line iLine = LineFromUPtr(wParam); iLine >= 0; iLine--) {
 				if ((GetMark(iLine) & lParam) != 0)
 					return iLine;
@@ -7982,6 +8546,13 @@ sptr_t Editor::WndProc(Message iMessage, uptr_t wParam, sptr_t lParam) {
 			pdoc->decorations->GetCurrentValue(), lParam);
 		break;
 
+	case Message::IndicatorFillList:
+		if (const RangeList *list = AsPointer<const RangeList *>(lParam)) {
+			pdoc->DecorationFillList(reinterpret_cast<const Sci::Position *>(list->ranges),
+				static_cast<size_t>(list->count), pdoc->decorations->GetCurrentValue());
+		}
+		break;
+
 	case Message::IndicatorClearRange:
 		pdoc->DecorationFillRange(PositionFromUPtr(wParam), 0, lParam);
 		break;
@@ -8153,16 +8724,9 @@ sptr_t Editor::WndProc(Message iMessage, uptr_t wParam, sptr_t lParam) {
 		InvalidateStyleRedraw();
 		break;
 
-	case Message::SetZoom: {
-		const int zoomLevel = std::clamp(static_cast<int>(wParam), MinZoomLevel, MaxZoomLevel);
-		if (zoomLevel != vs.zoomLevel) {
-			vs.zoomLevel = zoomLevel;
-			vs.fontsValid = false;
-			InvalidateStyleRedraw();
-			NotifyZoom();
-		}
+	case Message::SetZoom:
+		SetZoomLevel(std::clamp(static_cast<int>(wParam), MinZoomLevel, MaxZoomLevel));
 		break;
-	}
 
 	case Message::GetZoom:
 		return vs.zoomLevel;
@@ -8250,9 +8814,12 @@ sptr_t Editor::WndProc(Message iMessage, uptr_t wParam, sptr_t lParam) {
 			doc->Allocate(PositionFromUPtr(wParam));
 			doc->SetUndoCollection(false);
 			pcs = ContractionStateCreate(pdoc->IsLarge());
-			return AsInteger<sptr_t>(doc);
+			return AsInteger<sptr_t>(static_cast<ILoader *>(doc));
 		}
 
+	case Message::CreateSnapshot:
+		return AsInteger<sptr_t>(pdoc->CreateSnapshot());
+
 	case Message::SetModEventMask:
 		modEventMask = static_cast<ModificationFlags>(wParam);
 		return 0;
@@ -41,7 +41,10 @@ public:
 enum class WorkItems {
 	none = 0,
 	style = 1,
-	updateUI = 2
+	updateUI = 2,
+	changeHistory = 4,
+	scrollBars = 8,
+	gapPosition = 16
 };
 
 class WorkNeeded {
@@ -149,6 +152,14 @@ struct WrapPending {
 	}
 };
 
+struct WrapHeightSnapshot {
+	// Display heights captured from a completed wrap, keyed by the wrap
+	// width and zoom level they were computed for; width 0 marks an empty slot
+	int width = 0;
+	int zoomLevel = 0;
+	std::vector<int> heights;
+};
+
 struct CaretPolicySlop {
 	Scintilla::CaretPolicy policy;
 	int slop;	// Pixels for X, lines for Y
@@ -195,6 +206,7 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 	// Optimization that avoids superfluous invalidations
 	bool redrawPendingText = false;
 	bool redrawPendingMargin = false;
+	Sci::Line redrawPendingMarkerLine = -1;	///< document line already invalidated for a marker change
 
 	/** Style resources may be expensive to allocate so are cached between uses.
 	 * When a style attribute is changed, this cache is flushed. */
@@ -277,6 +289,8 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 	WorkNeeded workNeeded;
 	Scintilla::IdleStyling idleStyling;
 	bool needIdleStyling;
+	bool needIdleLayout;
+	double idleStyleBudget;	///< seconds of styling allowed per idle slice or paint
 
 	bool recordingMacro;
 	bool convertPastes;
@@ -303,6 +317,10 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 
 	// Wrapping support
 	WrapPending wrapPending;
+	// Recently completed wraps in most recently used order, so toggling
+	// between window widths or bouncing through zoom levels restores the
+	// previous wrap geometry instead of re-wrapping
+	WrapHeightSnapshot wrapSnapshots[4];
 
 	Editor();
 	// ~Editor() in public section
@@ -345,6 +363,7 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 	virtual void SCICALL RedrawRect(PRectangle rc) noexcept;
 	virtual void DiscardOverdraw() noexcept;
 	virtual void Redraw() noexcept;
+	void RedrawFromLine(Sci::Line displayLine) noexcept;
 	void RedrawSelMargin(Sci::Line line = -1, bool allAfter = false) noexcept;
 	PRectangle RectangleFromRange(Range r, int overlap) const noexcept;
 	void InvalidateRange(Sci::Position start, Sci::Position end) noexcept;
@@ -415,6 +434,10 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 
 	bool Wrapping() const noexcept;
 	void NeedWrapping(Sci::Line docLineStart = 0, Sci::Line docLineEnd = WrapPending::lineLarge, bool invalidate = true) noexcept;
+	void SnapshotWrapHeights();
+	bool RestoreWrapHeights(int widthNew);
+	void InvalidateWrapSnapshots() noexcept;
+	void SetZoomLevel(int zoomLevel);
 	bool WrapOneLine(Surface *surface, Sci::Position positionInsert);
 	bool WrapBlock(Surface *surface, Sci::Line lineToWrap, Sci::Line lineToWrapEnd, Sci::Line &partialLine);
 	enum class WrapScope {
@@ -464,6 +487,7 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 	virtual void Undo();
 	virtual void Redo();
 	bool BackspaceUnindent(Sci::Position lineCurrentPos, Sci::Position caretPosition, Sci::Position *posSelect);
+	bool DelCharBackMulti();
 	void DelCharBack(bool allowLineStartDeletion);
 	virtual void ClaimSelection() noexcept = 0;
 
@@ -586,13 +610,15 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 
 	Sci::Position SCICALL PositionAfterArea(PRectangle rcArea) const noexcept;
 	void StyleToPositionInView(Sci::Position pos);
-	Sci::Position PositionAfterMaxStyling(Sci::Position posMax, bool scrolling) const noexcept;
+	Sci::Position PositionAfterMaxStyling(Sci::Position posMax, double secondsAllowed) const noexcept;
 	void StartIdleStyling(bool truncatedLastStyling) noexcept;
 	void SCICALL StyleAreaBounded(PRectangle rcArea, bool scrolling);
+	void StyleScrollPrediction(Sci::Line displayLine);
 	constexpr bool SynchronousStylingToVisible() const noexcept {
 		return (idleStyling == Scintilla::IdleStyling::None) || (idleStyling == Scintilla::IdleStyling::AfterVisible);
 	}
 	void IdleStyle();
+	void IdleLayout();
 	virtual void IdleWork();
 	virtual void QueueIdleWork(WorkItems items, Sci::Position upTo = 0) noexcept;
 
@@ -13,6 +13,7 @@
 #include <vector>
 #include <map>
 #include <optional>
+#include <algorithm>
 #include <memory>
 
 #include "ScintillaTypes.h"
@@ -27,7 +28,7 @@
 using namespace Scintilla;
 using namespace Scintilla::Internal;
 
-KeyMap::KeyMap() {
+KeyMap::KeyMap() : dispatch(dispatchKeys*dispatchMods, static_cast<Message>(0)) {
 	for (int i = 0; static_cast<int>(MapDefault[i].key); i++) {
 		AssignCmdKey(MapDefault[i].key,
 			MapDefault[i].modifiers,
@@ -37,6 +38,7 @@ KeyMap::KeyMap() {
 
 void KeyMap::Clear() noexcept {
 	kmap.clear();
+	std::fill(dispatch.begin(), dispatch.end(), static_cast<Message>(0));
 }
 
 void KeyMap::AssignCmdKey(Keys key, KeyMod modifiers, Message msg) {
@@ -44,9 +46,19 @@ void KeyMap::AssignCmdKey(Keys key, KeyMod modifiers, Message msg) {
 	if (!success) {
 		it->second = msg;
 	}
+	const size_t indexKey = static_cast<size_t>(key);
+	const size_t indexMod = static_cast<size_t>(modifiers);
+	if (indexKey < dispatchKeys && indexMod < dispatchMods) {
+		dispatch[indexMod*dispatchKeys + indexKey] = msg;
+	}
 }
 
 Message KeyMap::Find(Keys key, KeyMod modifiers) const {
+	const size_t indexKey = static_cast<size_t>(key);
+	const size_t indexMod = static_cast<size_t>(modifiers);
+	if (indexKey < dispatchKeys && indexMod < dispatchMods) {
+		return dispatch[indexMod*dispatchKeys + indexKey];
+	}
 	const auto it = kmap.find(KeyModifiers(key, modifiers));
 	return (it == kmap.end()) ? static_cast<Message>(0) : it->second;
 }
@@ -46,6 +46,13 @@ public:
  */
 class KeyMap {
 	std::map<KeyModifiers, Scintilla::Message> kmap;
+	// Dense dispatch table over the map so the per-keystroke Find() is one
+	// array load: every named key fits below dispatchKeys and the platform
+	// layer only sends Shift/Ctrl/Alt combinations. Assignments outside
+	// these bounds stay reachable through the map.
+	static constexpr size_t dispatchKeys = 384;
+	static constexpr size_t dispatchMods = 8;
+	std::vector<Scintilla::Message> dispatch;
 	static const KeyToCommand MapDefault[];
 
 public:
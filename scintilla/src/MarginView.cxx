@@ -21,6 +21,7 @@
 #include <optional>
 #include <algorithm>
 #include <memory>
+#include <atomic>
 
 #include "ParallelSupport.h"
 #include "ScintillaTypes.h"
@@ -114,12 +115,63 @@ void DrawWrapMarker(Surface *surface, PRectangle rcPlace, bool isEndMarker, Colo
 MarginView::MarginView() noexcept {
 	wrapMarkerPaddingRight = 3;
 	customDrawWrapMarker = nullptr;
+	digitFont = nullptr;
+	std::fill(std::begin(digitWidths), std::end(digitWidths), XYPOSITION());
 }
 
 void MarginView::DropGraphics() noexcept {
 	pixmapSelMargin.reset();
 	pixmapSelPattern.reset();
 	pixmapSelPatternOffset1.reset();
+	markerPixMaps.reset();
+	digitFont = nullptr;
+}
+
+namespace {
+
+// FoldPart::undefined .. FoldPart::headWithTail
+constexpr size_t foldPartCount = 5;
+
+}
+
+Surface *MarginView::CachedMarker(Surface *surface, const ViewStyle &vs, int markBit, int part,
+	int width, int height, ColourRGBA background, Scintilla::MarginType marginType) {
+	const LineMarker &marker = vs.markers[markBit];
+	if (marker.customDraw || marker.layer != Layer::Base
+		|| marker.markType >= MarkerSymbol::Character || marker.pxpm || marker.image) {
+		// drawing depends on a font or an image, or blends with what is below
+		return nullptr;
+	}
+	if (!markerPixMaps) {
+		markerPixMaps = std::make_unique<MarkerPixMap[]>((MarkerMax + 1)*foldPartCount);
+	}
+	MarkerPixMap &entry = markerPixMaps[markBit*foldPartCount + part];
+	if (entry.pixmap && entry.width == width && entry.height == height && entry.back == background) {
+		return entry.pixmap.get();
+	}
+	entry.pixmap = surface->AllocatePixMap(width, height);
+	if (!entry.pixmap) {
+		return nullptr;
+	}
+	entry.width = width;
+	entry.height = height;
+	entry.back = background;
+	const PRectangle rcWhole = PRectangle::FromInts(0, 0, width, height);
+	entry.pixmap->FillRectangle(rcWhole, background);
+	marker.Draw(entry.pixmap.get(), rcWhole, nullptr, static_cast<LineMarker::FoldPart>(part), marginType);
+	entry.pixmap->FlushDrawing();
+	return entry.pixmap.get();
+}
+
+void MarginView::MeasureDigitWidths(Surface *surface, const ViewStyle &vs) {
+	const Font * const font = vs.styles[StyleLineNumber].font.get();
+	if (font != digitFont) {
+		digitFont = font;
+		for (int digit = 0; digit < 10; digit++) {
+			const char ch = static_cast<char>('0' + digit);
+			digitWidths[digit] = surface->WidthText(font, std::string_view(&ch, 1));
+		}
+	}
 }
 
 void MarginView::RefreshPixMaps(Surface *surfaceWindow, const ViewStyle &vsDraw) {
@@ -273,7 +325,43 @@ constexpr LineMarker::FoldPart PartForBar(bool markBefore, bool markAfter) noexc
 }
 
 void MarginView::PaintOneMargin(Surface *surface, PRectangle rc, PRectangle rcOneMargin, const MarginStyle &marginStyle,
-	const EditModel &model, const ViewStyle &vs) const {
+	const EditModel &model, const ViewStyle &vs) {
+	// The flat background colour under the markers, when there is one: it is
+	// baked into cached marker pixmaps so they can be blitted per line. The
+	// folding margin is flat unless its fill and highlight colours differ and
+	// produce the chequerboard pattern.
+	bool flatBackground = true;
+	ColourRGBA background = vs.styles[StyleLineNumber].back;
+	switch (marginStyle.style) {
+	case MarginType::Back:
+		background = vs.styles[StyleDefault].back;
+		break;
+	case MarginType::Fore:
+		background = vs.styles[StyleDefault].fore;
+		break;
+	case MarginType::Colour:
+		background = marginStyle.back;
+		break;
+	default:
+		break;
+	}
+	if (marginStyle.ShowsFolding()) {
+		// same colour selection as the pattern in RefreshPixMaps()
+		ColourRGBA colourFMFill = vs.selbar;
+		ColourRGBA colourFMStripes = vs.selbarlight;
+		if (!(vs.selbarlight == white)) {
+			colourFMFill = vs.selbarlight;
+		}
+		if (vs.foldmarginColour) {
+			colourFMFill = *vs.foldmarginColour;
+		}
+		if (vs.foldmarginHighlightColour) {
+			colourFMStripes = *vs.foldmarginHighlightColour;
+		}
+		flatBackground = colourFMFill == colourFMStripes;
+		background = colourFMFill;
+	}
+
 	const Point ptOrigin = model.GetVisibleOriginInMain();
 	const Style &lineNumberStyle = vs.styles[StyleLineNumber];
 	const Sci::Line lineStartPaint = static_cast<Sci::Line>(rcOneMargin.top + ptOrigin.y) / vs.lineHeight;
@@ -387,8 +475,23 @@ void MarginView::PaintOneMargin(Surface *surface, PRectangle rc, PRectangle rcOn
 					sNumber = std::string_view(number, length);
 				}
 				PRectangle rcNumber = rcMarker;
-				// Right justify
-				const XYPOSITION width = surface->WidthText(lineNumberStyle.font.get(), sNumber);
+				// Right justify, assembling the width from the cached digit
+				// advances; only the fold flag debug formats contain
+				// non-digits and fall back to measuring the text
+				XYPOSITION width = 0;
+				bool assembled = digitFont == lineNumberStyle.font.get();
+				if (assembled) {
+					for (const char ch : sNumber) {
+						if (ch < '0' || ch > '9') {
+							assembled = false;
+							break;
+						}
+						width += digitWidths[ch - '0'];
+					}
+				}
+				if (!assembled) {
+					width = surface->WidthText(lineNumberStyle.font.get(), sNumber);
+				}
 				const XYPOSITION xpos = rcNumber.right - width - vs.marginNumberPadding;
 				rcNumber.left = xpos;
 				DrawTextNoClipPhase(surface, rcNumber, lineNumberStyle,
@@ -448,7 +551,13 @@ void MarginView::PaintOneMargin(Surface *surface, PRectangle rc, PRectangle rcOn
 					const LineMarker::FoldPart part = marginStyle.ShowsFolding() ?
 						PartForFoldHighlight(highlightDelimiter, lineDoc, firstSubLine, headWithTail, isExpanded) :
 						LineMarker::FoldPart::undefined;
-					vs.markers[markBit].Draw(surface, rcMarker, lineNumberStyle.font.get(), part, marginStyle.style);
+					Surface *pixmap = flatBackground ? CachedMarker(surface, vs, markBit, static_cast<int>(part),
+						static_cast<int>(rcMarker.Width()), vs.lineHeight, background, marginStyle.style) : nullptr;
+					if (pixmap) {
+						surface->Copy(rcMarker, Point(), *pixmap);
+					} else {
+						vs.markers[markBit].Draw(surface, rcMarker, lineNumberStyle.font.get(), part, marginStyle.style);
+					}
 				}
 				marks >>= 1;
 			}
@@ -502,6 +611,7 @@ void MarginView::PaintMargin(Surface *surface, Sci::Line topLine, PRectangle rc,
 				}
 			} else {
 				surface->FillRectangle(rcOneMargin, vs.styles[StyleLineNumber].back);
+				MeasureDigitWidths(surface, vs);
 			}
 
 			if (marginStyle.ShowsFolding() && highlightDelimiter.isEnabled) {
@@ -20,10 +20,25 @@ public:
 	std::unique_ptr<Surface> pixmapSelMargin;
 	std::unique_ptr<Surface> pixmapSelPattern;
 	std::unique_ptr<Surface> pixmapSelPatternOffset1;
+	// Markers pre-rendered to pixmaps once per appearance or size change and
+	// blitted per line, so a margin with a marker on every line doesn't replay
+	// the vector drawing calls for each line on each paint. Only markers over
+	// a flat background can be cached as the background is baked in.
+	struct MarkerPixMap {
+		std::unique_ptr<Surface> pixmap;
+		int width;
+		int height;
+		ColourRGBA back;
+	};
+	std::unique_ptr<MarkerPixMap[]> markerPixMaps;	// [MarkerMax + 1] x fold parts
 	// Highlight current folding block
 	HighlightDelimiter highlightDelimiter;
 
 	int wrapMarkerPaddingRight; // right-most pixel padding of wrap markers
+	// Advance of each digit in the line number style, measured once per font
+	// so right justifying a line number needs no text measurement per line
+	const Font *digitFont;
+	XYPOSITION digitWidths[10];
 	/** Some platforms, notably PLAT_CURSES, do not support Scintilla's native
 	 * DrawWrapMarker function for drawing wrap markers. Allow those platforms to
 	 * override it instead of creating a new method in the Surface class that
@@ -34,8 +49,11 @@ public:
 
 	void DropGraphics() noexcept;
 	void RefreshPixMaps(Surface *surfaceWindow, const ViewStyle &vsDraw);
+	void MeasureDigitWidths(Surface *surface, const ViewStyle &vs);
+	Surface *CachedMarker(Surface *surface, const ViewStyle &vs, int markBit, int part,
+		int width, int height, ColourRGBA background, Scintilla::MarginType marginType);
 	void SCICALL PaintOneMargin(Surface *surface, PRectangle rc, PRectangle rcOneMargin, const MarginStyle &marginStyle,
-		const EditModel &model, const ViewStyle &vs) const;
+		const EditModel &model, const ViewStyle &vs);
 	void SCICALL PaintMargin(Surface *surface, Sci::Line topLine, PRectangle rc, PRectangle rcMargin,
 		const EditModel &model, const ViewStyle &vs);
 };
@@ -167,6 +167,18 @@ public:
 		body.Delete(partition);
 	}
 
+	// Remove a run of partitions with one gap move, equivalent to calling
+	// RemovePartition(partition) deletions times.
+	void RemovePartitions(T partition, T deletions) {
+		if (partition > stepPartition) {
+			ApplyStep(partition);
+			stepPartition = partition - 1;
+		} else {
+			stepPartition = std::max<T>(partition - 1, stepPartition - deletions);
+		}
+		body.DeleteRange(partition, deletions);
+	}
+
 	T PositionFromPartition(T partition) const noexcept {
 		PLATFORM_ASSERT(partition >= 0);
 		PLATFORM_ASSERT(partition < body.Length());
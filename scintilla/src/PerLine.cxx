@@ -91,6 +91,8 @@ void MarkerHandleSet::CombineWith(MarkerHandleSet *other) noexcept {
 
 void LineMarkers::Init() {
 	markers.DeleteAll();
+	std::vector<Sci::Line>().swap(markedLines);
+	markedLinesValid = false;
 }
 
 bool LineMarkers::IsActive() const noexcept {
@@ -99,12 +101,14 @@ bool LineMarkers::IsActive() const noexcept {
 
 void LineMarkers::InsertLine(Sci::Line line) {
 	if (markers.Length()) {
+		markedLinesValid = false;
 		markers.Insert(line, nullptr);
 	}
 }
 
 void LineMarkers::InsertLines(Sci::Line line, Sci::Line lines) {
 	if (markers.Length()) {
+		markedLinesValid = false;
 		markers.InsertEmpty(line, lines);
 	}
 }
@@ -112,6 +116,7 @@ void LineMarkers::InsertLines(Sci::Line line, Sci::Line lines) {
 void LineMarkers::RemoveLine(Sci::Line line) {
 	// Retain the markers from the deleted line by oring them into the previous line
 	if (markers.Length()) {
+		markedLinesValid = false;
 		if (line > 0) {
 			MergeMarkers(line - 1);
 		}
@@ -119,6 +124,28 @@ void LineMarkers::RemoveLine(Sci::Line line) {
 	}
 }
 
+void LineMarkers::RemoveLines(Sci::Line line, Sci::Line lines) {
+	// Retain the markers from the deleted lines by oring them into the previous line
+	if (markers.Length()) {
+		markedLinesValid = false;
+		if (line > 0) {
+			for (Sci::Line i = 0; i < lines; i++) {
+				if (markers[line + i]) {
+					if (!markers[line - 1])
+						markers[line - 1] = std::make_unique<MarkerHandleSet>();
+					markers[line - 1]->CombineWith(markers[line + i].get());
+					markers[line + i].reset();
+				}
+			}
+		}
+		markers.DeleteRange(line, lines);
+	}
+}
+
+size_t LineMarkers::AllocatedBytes() const noexcept {
+	return markers.AllocatedBytes() + markedLines.capacity() * sizeof(Sci::Line);
+}
+
 Sci::Line LineMarkers::LineFromHandle(int markerHandle) const noexcept {
 	for (Sci::Line line = 0; line < markers.Length(); line++) {
 		if (markers[line] && markers[line]->Contains(markerHandle)) {
@@ -146,6 +173,7 @@ int LineMarkers::NumberFromLine(Sci::Line line, int which) const noexcept {
 
 void LineMarkers::MergeMarkers(Sci::Line line) {
 	if (markers[line + 1]) {
+		markedLinesValid = false;
 		if (!markers[line])
 			markers[line] = std::make_unique<MarkerHandleSet>();
 		markers[line]->CombineWith(markers[line + 1].get());
@@ -160,11 +188,41 @@ MarkerMask LineMarkers::MarkValue(Sci::Line line) const noexcept {
 		return 0;
 }
 
+void LineMarkers::BuildMarkedLines() const noexcept {
+	markedLines.clear();
+	const Sci::Line length = markers.Length();
+	for (Sci::Line line = 0; line < length; line++) {
+		if (markers[line]) {
+			markedLines.push_back(line);
+		}
+	}
+	markedLinesValid = true;
+}
+
 Sci::Line LineMarkers::MarkerNext(Sci::Line lineStart, MarkerMask mask) const noexcept {
 	if (lineStart < 0)
 		lineStart = 0;
-	const Sci::Line length = markers.Length();
-	for (Sci::Line iLine = lineStart; iLine < length; iLine++) {
+	if (!markedLinesValid) {
+		BuildMarkedLines();
+	}
+	const auto end = markedLines.end();
+	for (auto it = std::lower_bound(markedLines.begin(), end, lineStart); it != end; ++it) {
+		const Sci::Line iLine = *it;
+		const MarkerHandleSet *onLine = markers[iLine].get();
+		if (onLine && ((onLine->MarkValue() & mask) != 0))
+			return iLine;
+	}
+	return -1;
+}
+
+Sci::Line LineMarkers::MarkerPrevious(Sci::Line lineStart, MarkerMask mask) const noexcept {
+	if (!markedLinesValid) {
+		BuildMarkedLines();
+	}
+	auto it = std::upper_bound(markedLines.begin(), markedLines.end(), lineStart);
+	while (it != markedLines.begin()) {
+		--it;
+		const Sci::Line iLine = *it;
 		const MarkerHandleSet *onLine = markers[iLine].get();
 		if (onLine && ((onLine->MarkValue() & mask) != 0))
 			return iLine;
@@ -179,6 +237,7 @@ int LineMarkers::AddMark(Sci::Line line, int markerNum, Sci::Line lines) {
 	}
 	if (!markers[line]) {
 		// Need new structure to hold marker handle
+		markedLinesValid = false;
 		markers[line] = std::make_unique<MarkerHandleSet>();
 	}
 
@@ -193,10 +252,12 @@ bool LineMarkers::DeleteMark(Sci::Line line, int markerNum, bool all) {
 		if (markerNum < 0) {
 			someChanges = true;
 			markers[line].reset();
+			markedLinesValid = false;
 		} else {
 			someChanges = markers[line]->RemoveNumber(markerNum, all);
 			if (markers[line]->Empty()) {
 				markers[line].reset();
+				markedLinesValid = false;
 			}
 		}
 	}
@@ -209,6 +270,7 @@ void LineMarkers::DeleteMarkFromHandle(int markerHandle) {
 		markers[line]->RemoveHandle(markerHandle);
 		if (markers[line]->Empty()) {
 			markers[line].reset();
+			markedLinesValid = false;
 		}
 	}
 }
@@ -248,6 +310,30 @@ void LineLevels::RemoveLine(Sci::Line line) {
 	}
 }
 
+void LineLevels::RemoveLines(Sci::Line line, Sci::Line lines) {
+	if (levels.Length()) {
+		if (line > 0 && line + lines < levels.Length() - 1) {
+			// Merge header flags from the deleted lines into the line before
+			// to avoid a temporary disappearance causing expansion.
+			int header = 0;
+			for (Sci::Line i = 0; i < lines; i++) {
+				header |= levels[line + i] & static_cast<int>(Scintilla::FoldLevel::HeaderFlag);
+			}
+			levels.DeleteRange(line, lines);
+			levels[line - 1] |= header;
+		} else {
+			// Near the start or end the last line special case may trigger
+			while (lines--) {
+				RemoveLine(line);
+			}
+		}
+	}
+}
+
+size_t LineLevels::AllocatedBytes() const noexcept {
+	return levels.AllocatedBytes();
+}
+
 void LineLevels::ExpandLevels(Sci::Line sizeNew) {
 	levels.InsertValue(levels.Length(), sizeNew - levels.Length(), static_cast<int>(Scintilla::FoldLevel::Base));
 }
@@ -325,6 +411,16 @@ void LineState::RemoveLine(Sci::Line line) {
 	}
 }
 
+void LineState::RemoveLines(Sci::Line line, Sci::Line lines) {
+	if (lineStates.Length() > line) {
+		lineStates.DeleteRange(line, std::min(lines, lineStates.Length() - line));
+	}
+}
+
+size_t LineState::AllocatedBytes() const noexcept {
+	return lineStates.AllocatedBytes();
+}
+
 int LineState::SetLineState(Sci::Line line, int state, Sci::Line lines) {
 	if (IsValidIndex(line, lines)) {
 		lineStates.EnsureLength(lines + 1);
@@ -340,6 +436,68 @@ int LineState::GetLineState(Sci::Line line) const noexcept {
 	return 0;
 }
 
+void LineIndentCache::Init() {
+	cache.DeleteAll();
+}
+
+bool LineIndentCache::IsActive() const noexcept {
+	return cache.Length() != 0;
+}
+
+void LineIndentCache::InsertLine(Sci::Line line) {
+	if (cache.Length()) {
+		cache.Insert(line, unknownValue);
+	}
+}
+
+void LineIndentCache::InsertLines(Sci::Line line, Sci::Line lines) {
+	if (cache.Length()) {
+		cache.InsertValue(line, lines, unknownValue);
+	}
+}
+
+void LineIndentCache::RemoveLine(Sci::Line line) {
+	if (cache.Length() > line) {
+		cache.Delete(line);
+	}
+}
+
+void LineIndentCache::RemoveLines(Sci::Line line, Sci::Line lines) {
+	if (cache.Length() > line) {
+		cache.DeleteRange(line, std::min(lines, cache.Length() - line));
+	}
+}
+
+size_t LineIndentCache::AllocatedBytes() const noexcept {
+	return cache.AllocatedBytes();
+}
+
+int LineIndentCache::ValueAt(Sci::Line line) const noexcept {
+	if (IsValidIndex(line, cache.Length())) {
+		return cache[line];
+	}
+	return unknownValue;
+}
+
+void LineIndentCache::SetValue(Sci::Line line, int value, Sci::Line lines) {
+	if (IsValidIndex(line, lines)) {
+		if (cache.Length() == 0) {
+			// first use: populate the whole document as unknown so the line
+			// count stays in step with InsertLine()/RemoveLine() from here on
+			cache.InsertValue(0, lines, unknownValue);
+		}
+		if (IsValidIndex(line, cache.Length())) {
+			cache.ReplaceValueAt(line, value);
+		}
+	}
+}
+
+void LineIndentCache::Invalidate(Sci::Line line) noexcept {
+	if (IsValidIndex(line, cache.Length())) {
+		cache.ReplaceValueAt(line, unknownValue);
+	}
+}
+
 // Each allocated LineAnnotation is a char array which starts with an AnnotationHeader
 // and then has text and optional styles.
 
@@ -398,6 +556,28 @@ void LineAnnotation::RemoveLine(Sci::Line line) {
 	}
 }
 
+void LineAnnotation::RemoveLines(Sci::Line line, Sci::Line lines) {
+	// see https://sourceforge.net/p/scintilla/bugs/1577/
+	if (IsValidIndex(line - 1, annotations.Length())) {
+		lines = std::min(lines, annotations.Length() - (line - 1));
+		for (Sci::Line i = 0; i < lines; i++) {
+			annotations[line - 1 + i].reset();
+		}
+		annotations.DeleteRange(line - 1, lines);
+	}
+}
+
+size_t LineAnnotation::AllocatedBytes() const noexcept {
+	size_t bytes = annotations.AllocatedBytes();
+	for (Sci::Line line = 0; line < annotations.Length(); line++) {
+		if (annotations[line]) {
+			const AnnotationHeader *pah = reinterpret_cast<const AnnotationHeader *>(annotations[line].get());
+			bytes += sizeof(AnnotationHeader) + pah->length + ((pah->style == IndividualStyles) ? pah->length : 0);
+		}
+	}
+	return bytes;
+}
+
 bool LineAnnotation::MultipleStyles(Sci::Line line) const noexcept {
 	if (IsValidIndex(line, annotations.Length()) && annotations[line])
 		return reinterpret_cast<AnnotationHeader *>(annotations[line].get())->style == IndividualStyles;
@@ -523,6 +703,16 @@ void LineTabstops::RemoveLine(Sci::Line line) {
 	}
 }
 
+void LineTabstops::RemoveLines(Sci::Line line, Sci::Line lines) {
+	if (tabstops.Length() > line) {
+		lines = std::min(lines, tabstops.Length() - line);
+		for (Sci::Line i = 0; i < lines; i++) {
+			tabstops[line + i].reset();
+		}
+		tabstops.DeleteRange(line, lines);
+	}
+}
+
 bool LineTabstops::ClearTabstops(Sci::Line line) noexcept {
 	if (line < tabstops.Length()) {
 		TabstopList *tl = tabstops[line].get();
@@ -40,6 +40,11 @@ class LineMarkers final : public PerLine {
 	SplitVector<std::unique_ptr<MarkerHandleSet>> markers;
 	/// Handles are allocated sequentially and should never have to be reused as 32 bit ints are very big.
 	int handleCurrent;
+	/// Sorted list of lines holding markers, rebuilt lazily so repeated
+	/// MarkerNext/MarkerPrevious only visit marked lines instead of every line.
+	mutable std::vector<Sci::Line> markedLines;
+	mutable bool markedLinesValid = false;
+	void BuildMarkedLines() const noexcept;
 public:
 	LineMarkers() noexcept : handleCurrent(0) {}
 	void Init() override;
@@ -47,9 +52,12 @@ public:
 	void InsertLine(Sci::Line line) override;
 	void InsertLines(Sci::Line line, Sci::Line lines) override;
 	void RemoveLine(Sci::Line line) override;
+	void RemoveLines(Sci::Line line, Sci::Line lines) override;
+	size_t AllocatedBytes() const noexcept override;
 
 	MarkerMask MarkValue(Sci::Line line) const noexcept;
 	Sci::Line MarkerNext(Sci::Line lineStart, MarkerMask mask) const noexcept;
+	Sci::Line MarkerPrevious(Sci::Line lineStart, MarkerMask mask) const noexcept;
 	int AddMark(Sci::Line line, int markerNum, Sci::Line lines);
 	void MergeMarkers(Sci::Line line);
 	bool DeleteMark(Sci::Line line, int markerNum, bool all);
@@ -69,6 +77,8 @@ public:
 	void InsertLine(Sci::Line line) override;
 	void InsertLines(Sci::Line line, Sci::Line lines) override;
 	void RemoveLine(Sci::Line line) override;
+	void RemoveLines(Sci::Line line, Sci::Line lines) override;
+	size_t AllocatedBytes() const noexcept override;
 
 	void ExpandLevels(Sci::Line sizeNew = -1);
 	void ClearLevels();
@@ -86,11 +96,38 @@ public:
 	void InsertLine(Sci::Line line) override;
 	void InsertLines(Sci::Line line, Sci::Line lines) override;
 	void RemoveLine(Sci::Line line) override;
+	void RemoveLines(Sci::Line line, Sci::Line lines) override;
+	size_t AllocatedBytes() const noexcept override;
 
 	int SetLineState(Sci::Line line, int state, Sci::Line lines);
 	int GetLineState(Sci::Line line) const noexcept;
 };
 
+/**
+ * Caches the column width of each line's whitespace prefix as computed by
+ * Document::GetLineIndentation(), with a flag marking fully blank lines, so
+ * painting indentation guides does not rescan line text on every paint.
+ * Entries are invalidated line by line from Document::ModifiedAt().
+ */
+class LineIndentCache final : public PerLine {
+	SplitVector<int> cache;
+public:
+	static constexpr int unknownValue = -1;
+	static constexpr int whiteLineFlag = 0x40000000;
+	LineIndentCache() noexcept = default;
+	void Init() override;
+	bool IsActive() const noexcept override;
+	void InsertLine(Sci::Line line) override;
+	void InsertLines(Sci::Line line, Sci::Line lines) override;
+	void RemoveLine(Sci::Line line) override;
+	void RemoveLines(Sci::Line line, Sci::Line lines) override;
+	size_t AllocatedBytes() const noexcept override;
+
+	int ValueAt(Sci::Line line) const noexcept;
+	void SetValue(Sci::Line line, int value, Sci::Line lines);
+	void Invalidate(Sci::Line line) noexcept;
+};
+
 class LineAnnotation : public PerLine {
 	SplitVector<std::unique_ptr<char[]>> annotations;
 public:
@@ -102,6 +139,8 @@ public:
 	void InsertLine(Sci::Line line) override;
 	void InsertLines(Sci::Line line, Sci::Line lines) override;
 	void RemoveLine(Sci::Line line) override;
+	void RemoveLines(Sci::Line line, Sci::Line lines) override;
+	size_t AllocatedBytes() const noexcept override;
 
 	bool MultipleStyles(Sci::Line line) const noexcept;
 	int Style(Sci::Line line) const noexcept;
@@ -126,6 +165,7 @@ public:
 	void InsertLine(Sci::Line line) override;
 	void InsertLines(Sci::Line line, Sci::Line lines) override;
 	void RemoveLine(Sci::Line line) override;
+	void RemoveLines(Sci::Line line, Sci::Line lines) override;
 
 	bool ClearTabstops(Sci::Line line) noexcept;
 	bool AddTabstop(Sci::Line line, int x);
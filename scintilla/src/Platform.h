@@ -216,6 +216,7 @@ public:
 	virtual void SCICALL RectangleFrame(PRectangle rc, Stroke stroke) = 0;
 	virtual void SCICALL FillRectangle(PRectangle rc, Fill fill) = 0;
 	virtual void SCICALL FillRectangleAligned(PRectangle rc, Fill fill) = 0;
+	virtual void FillRectangleList(const PRectangle *prcs, size_t nrcs, Fill fill) = 0;
 	virtual void SCICALL FillRectangle(PRectangle rc, Surface &surfacePattern) = 0;
 	virtual void SCICALL RoundedRectangle(PRectangle rc, FillStroke fillStroke) = 0;
 	virtual void SCICALL AlphaRectangle(PRectangle rc, XYPOSITION cornerSize, FillStroke fillStroke) = 0;
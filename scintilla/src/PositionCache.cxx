@@ -22,10 +22,12 @@
 #include <algorithm>
 #include <iterator>
 #include <memory>
+#include <atomic>
 
 #include "ParallelSupport.h"
 #include "ScintillaTypes.h"
 #include "ScintillaMessages.h"
+#include "ScintillaStructures.h"
 #include "ILoader.h"
 #include "ILexer.h"
 
@@ -137,6 +139,15 @@ void LineLayout::ClearPositions() const noexcept {
 	memset(positions.get(), 0, (maxLineLength + 2) * sizeof(XYPOSITION));
 }
 
+void LineLayout::ClearPositionsAfter(int position) noexcept {
+	// Keep the absolute positions of the unchanged prefix, including the element
+	// at position which the next layout pass accumulates from, and clear the
+	// stale tail so invisible segments read zero as when laid out from scratch.
+	PLATFORM_ASSERT(position <= lastSegmentEnd);
+	memset(&positions[position + 1], 0, (lastSegmentEnd + 1 - position) * sizeof(XYPOSITION));
+	lastSegmentEnd = position;
+}
+
 void LineLayout::Invalidate(ValidLevel validity_) noexcept {
 	if (validity > validity_)
 		validity = validity_;
@@ -342,6 +353,17 @@ int LineLayout::EndLineStyle() const noexcept {
 	return styles[numCharsBeforeEOL > 0 ? numCharsBeforeEOL - 1 : 0];
 }
 
+size_t LineLayout::EstimateMemory() const noexcept {
+	size_t size = sizeof(LineLayout) + lenLineStarts*sizeof(int);
+	if (chars) {
+		size += (maxLineLength + 1)*(sizeof(char) + sizeof(unsigned char) + sizeof(XYPOSITION));
+	}
+	if (bidiData) {
+		size += sizeof(BidiData) + maxLineLength*(sizeof(std::shared_ptr<Font>) + sizeof(XYPOSITION));
+	}
+	return size;
+}
+
 namespace {
 
 enum class WrapBreak {
@@ -563,6 +585,7 @@ bool SignificantLines::LineMayCache(Sci::Line line) const noexcept {
 
 LineLayoutCache::LineLayoutCache() noexcept:
 	lastCaretSlot(SIZE_MAX),
+	budgetLines(budgetLinesDefault), hits(0), misses(0),
 	level(LineCache::None),
 	maxValidity(LineLayout::ValidLevel::invalid), styleClock(-1) {
 }
@@ -702,7 +725,7 @@ void LineLayoutCache::AllocateForLevel(Sci::Line linesOnScreen, Sci::Line linesI
 	} else if (level == LineCache::Caret) {
 		lengthForLevel = 2;
 	} else if (level == LineCache::Document) {
-		lengthForLevel = NP2_align_up(linesInDoc, 64);
+		lengthForLevel = std::min(static_cast<size_t>(NP2_align_up(linesInDoc, 64)), budgetLines);
 	}
 	if (lengthForLevel != shortCache.size()) {
 		maxValidity = LineLayout::ValidLevel::lines;
@@ -747,6 +770,30 @@ void LineLayoutCache::SetLevel(LineCache level_) noexcept {
 	}
 }
 
+void LineLayoutCache::SetBudget(size_t lines) noexcept {
+	budgetLines = lines ? NP2_align_up(lines, 64) : budgetLinesDefault;
+	// AllocateForLevel() resizes on the next retrieval when the budget shrank.
+}
+
+void LineLayoutCache::GetStatistics(Scintilla::LayoutCacheStats &stats) const noexcept {
+	stats.hits = hits;
+	stats.misses = misses;
+	size_t cachedLines = 0;
+	size_t cachedBytes = 0;
+	for (const auto &ll : shortCache) {
+		if (ll) {
+			cachedLines += 1;
+			cachedBytes += ll->EstimateMemory();
+		}
+	}
+	for (const auto &ll : longCache) {
+		cachedLines += 1;
+		cachedBytes += ll->EstimateMemory();
+	}
+	stats.cachedLines = cachedLines;
+	stats.cachedBytes = cachedBytes;
+}
+
 LineLayout *LineLayoutCache::Retrieve(Sci::Line lineNumber, Sci::Line lineCaret, int maxChars, int styleClock_,
 	Sci::Line linesOnScreen, Sci::Line linesInDoc, Sci::Line topLine) {
 	AllocateForLevel(linesOnScreen, linesInDoc);
@@ -781,15 +828,21 @@ LineLayout *LineLayoutCache::Retrieve(Sci::Line lineNumber, Sci::Line lineCaret,
 			} else {
 				lastCaretSlot = pos;
 			}
-		} else if (pos == lastCaretSlot) {
-			// save cache for caret line.
+		} else if (pos == lastCaretSlot && shortCache[pos] && shortCache[pos]->LineNumber() == lineCaret) {
+			// another line hashes to the slot holding the caret line: save the
+			// caret line into the reserved slot instead of evicting it.
+			// When the slot holds lineNumber itself (the line the caret just
+			// left, repainted to clear its caret line background), keep it in
+			// place so vertical caret movement reuses the layout.
 			lastCaretSlot = 0;
 			std::swap(shortCache[0], shortCache[pos]);
 		}
 	} else if (level == LineCache::Caret) {
 		pos = lineNumber != lineCaret;
 	} else if (level == LineCache::Document) {
-		pos = lineNumber;
+		// direct mapped; the modulo only wraps when the document exceeds the
+		// budget and the cache was sized to budgetLines slots.
+		pos = static_cast<size_t>(lineNumber) % shortCache.size();
 	}
 
 	if (!useLongCache) {
@@ -799,15 +852,18 @@ LineLayout *LineLayoutCache::Retrieve(Sci::Line lineNumber, Sci::Line lineCaret,
 		if (!ret->CanHold(lineNumber, maxChars)) {
 			//printf("USE line=%zd/%zd, caret=%zd/%zd top=%zd, pos=%zu, clock=%d\n",
 			//	lineNumber, ret->lineNumber, lineCaret, lastCaretSlot, topLine, pos, styleClock_);
+			misses++;
 			ret->Free();
 			::new (ret) LineLayout(lineNumber, maxChars);
 		} else {
 			//printf("HIT line=%zd, caret=%zd/%zd top=%zd, pos=%zu, clock=%d, validity=%d\n",
 			//	lineNumber, lineCaret, lastCaretSlot, topLine, pos, styleClock_, ret->validity);
+			hits++;
 		}
 	} else {
 		//printf("NEW line=%zd, caret=%zd/%zd top=%zd, pos=%zu, clock=%d\n",
 		//	lineNumber, lineCaret, lastCaretSlot, topLine, pos, styleClock_);
+		misses++;
 		auto ll = std::make_unique<LineLayout>(lineNumber, maxChars);
 		ret = ll.get();
 		if (useLongCache) {
@@ -856,6 +912,9 @@ void SpecialRepresentations::SetRepresentation(std::string_view charBytes, std::
 			// New entry so increment for first byte
 			const unsigned char ucStart = charBytes[0];
 			startByteHasReprs[ucStart]++;
+			if (ucStart >= ' ' && ucStart < 0x7f) {
+				graphicReprs++;
+			}
 			if (key > maxKey) {
 				maxKey = key;
 			}
@@ -899,6 +958,9 @@ void SpecialRepresentations::ClearRepresentation(std::string_view charBytes) {
 			mapReprs.erase(it);
 			const unsigned char ucStart = charBytes[0];
 			startByteHasReprs[ucStart]--;
+			if (ucStart >= ' ' && ucStart < 0x7f) {
+				graphicReprs--;
+			}
 			if (key == maxKey && startByteHasReprs[ucStart] == 0) {
 				maxKey = mapReprs.empty() ? 0 : mapReprs.crbegin()->first;
 			}
@@ -937,6 +999,7 @@ void SpecialRepresentations::Clear() noexcept {
 	constexpr unsigned char none = 0;
 	std::fill(startByteHasReprs, std::end(startByteHasReprs), none);
 	maxKey = 0;
+	graphicReprs = 0;
 	crlf = false;
 }
 
@@ -1092,44 +1155,90 @@ BreakFinder::BreakFinder(const LineLayout *ll_, const Selection *psel, Range lin
 
 BreakFinder::~BreakFinder() = default;
 
+namespace {
+
+// Length of the leading run of ASCII graphic characters and spaces, i.e.
+// bytes in [0x20, 0x7e]: no C0 controls, DEL or UTF-8 lead/trail bytes.
+// When no representation starts with such a byte the whole run needs no
+// representation lookups and every character is one byte wide.
+inline int GraphicASCIIRunLength(const char *text, ptrdiff_t length) noexcept {
+	const char *ptr = text;
+	const char * const end = text + length;
+#if NP2_USE_SSE2
+	if (length >= static_cast<ptrdiff_t>(sizeof(__m128i))) {
+		const char * const xend = end - sizeof(__m128i);
+		const __m128i space = _mm_set1_epi8(' ');
+		const __m128i del = _mm_set1_epi8('\x7f');
+		do {
+			__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr));
+			chunk = _mm_or_si128(_mm_cmplt_epi8(chunk, space), _mm_cmpeq_epi8(chunk, del));
+			if (const uint32_t mask = _mm_movemask_epi8(chunk)) {
+				return static_cast<int>(ptr - text + np2::ctz(mask));
+			}
+			ptr += sizeof(__m128i);
+		} while (ptr <= xend);
+	}
+#endif
+	while (ptr < end) {
+		const unsigned char ch = *ptr;
+		if (ch < ' ' || ch >= 0x7f) {
+			break;
+		}
+		++ptr;
+	}
+	return static_cast<int>(ptr - text);
+}
+
+}
+
 TextSegment BreakFinder::Next() {
 	if (subBreak < 0) {
 		const int prev = nextBreak;
 		const Representation *repr = nullptr;
+		// no representation starts with an ASCII graphic character in the
+		// common case, so whole runs of them can skip the per character
+		// representation lookup and width handling below.
+		const bool useGraphicRuns = !reprs->ContainsGraphicASCII();
+		int graphicEnd = nextBreak;
 		while (nextBreak < endPos) {
 			int charWidth = 1;
 			const char * const chars = &ll->chars[nextBreak];
 			const unsigned char ch = chars[0];
-			//bool characterStyleConsistent = true;	// All bytes of character in same style?
-			if (!UTF8IsAscii(ch) && encodingFamily != EncodingFamily::eightBit) {
-				if (encodingFamily == EncodingFamily::unicode) {
-					charWidth = UTF8DrawBytes(chars, endPos - nextBreak);
-				} else {
-					charWidth = pdoc->DBCSDrawBytes(chars, endPos - nextBreak);
+			repr = nullptr;
+			if (nextBreak >= graphicEnd && useGraphicRuns && ch >= ' ' && ch < 0x7f) {
+				graphicEnd = nextBreak + GraphicASCIIRunLength(chars, endPos - nextBreak);
+			}
+			if (nextBreak >= graphicEnd) {
+				//bool characterStyleConsistent = true;	// All bytes of character in same style?
+				if (!UTF8IsAscii(ch) && encodingFamily != EncodingFamily::eightBit) {
+					if (encodingFamily == EncodingFamily::unicode) {
+						charWidth = UTF8DrawBytes(chars, endPos - nextBreak);
+					} else {
+						charWidth = pdoc->DBCSDrawBytes(chars, endPos - nextBreak);
+					}
+					//for (int trail = 1; trail < charWidth; trail++) {
+					//	if (ll->styles[nextBreak] != ll->styles[nextBreak + trail]) {
+					//		characterStyleConsistent = false;
+					//	}
+					//}
 				}
-				//for (int trail = 1; trail < charWidth; trail++) {
-				//	if (ll->styles[nextBreak] != ll->styles[nextBreak + trail]) {
-				//		characterStyleConsistent = false;
+				//if (!characterStyleConsistent) {
+				//	if (nextBreak == prev) {
+				//		// Show first character representation bytes since it has inconsistent styles.
+				//		charWidth = 1;
+				//	} else {
+				//		// Return segment before nextBreak but allow to be split up if too long
+				//		// If not split up, next call will hit the above 'charWidth = 1;' and display bytes.
+				//		break;
 				//	}
 				//}
-			}
-			//if (!characterStyleConsistent) {
-			//	if (nextBreak == prev) {
-			//		// Show first character representation bytes since it has inconsistent styles.
-			//		charWidth = 1;
-			//	} else {
-			//		// Return segment before nextBreak but allow to be split up if too long
-			//		// If not split up, next call will hit the above 'charWidth = 1;' and display bytes.
-			//		break;
-			//	}
- 			//}
-			repr = nullptr;
-			if (reprs->MayContains(ch)) {
-				// Special case \r\n line ends if there is a representation
-				if (ch == '\r' && reprs->ContainsCrLf() && chars[1] == '\n') {
-					charWidth = 2;
+				if (reprs->MayContains(ch)) {
+					// Special case \r\n line ends if there is a representation
+					if (ch == '\r' && reprs->ContainsCrLf() && chars[1] == '\n') {
+						charWidth = 2;
+					}
+					repr = reprs->GetRepresentation(std::string_view(chars, charWidth));
 				}
-				repr = reprs->GetRepresentation(std::string_view(chars, charWidth));
 			}
 			if (((nextBreak > 0) && (ll->styles[nextBreak] != ll->styles[nextBreak - 1])) ||
 				repr ||
@@ -6,6 +6,10 @@
 // The License.txt file describes the conditions under which this software may be distributed.
 #pragma once
 
+namespace Scintilla {
+struct LayoutCacheStats;	// Declare in case ScintillaStructures.h not included
+}
+
 namespace Scintilla::Internal {
 
 /**
@@ -89,6 +93,7 @@ public:
 	void EnsureBidiData();
 	void Free() noexcept;
 	void ClearPositions() const noexcept;
+	void ClearPositionsAfter(int position) noexcept;
 	void Invalidate(ValidLevel validity_) noexcept;
 	Sci::Line LineNumber() const noexcept {
 		return lineNumber;
@@ -117,6 +122,7 @@ public:
 	Interval Span(int start, int end) const noexcept;
 	Interval SpanByte(int index) const noexcept;
 	int EndLineStyle() const noexcept;
+	size_t EstimateMemory() const noexcept;
 	void SCICALL WrapLine(const Document *pdoc, Sci::Position posLineStart, Wrap wrapState, XYPOSITION wrapWidth, XYPOSITION wrapIndent_, bool partialLine);
 };
 
@@ -167,9 +173,15 @@ private:
 	std::vector<std::unique_ptr<LineLayout>> shortCache;
 	std::vector<std::unique_ptr<LineLayout>> longCache;
 	size_t lastCaretSlot;
+	// whole document caching direct maps lines into at most this many slots,
+	// so a multi-million line file can't keep a layout alive per line.
+	size_t budgetLines;
+	size_t hits;
+	size_t misses;
 	Scintilla::LineCache level;
 	LineLayout::ValidLevel maxValidity;
 	int styleClock;
+	static constexpr size_t budgetLinesDefault = 1 << 19;
 	void AllocateForLevel(Sci::Line linesOnScreen, Sci::Line linesInDoc);
 public:
 	LineLayoutCache() noexcept;
@@ -185,6 +197,8 @@ public:
 	Scintilla::LineCache GetLevel() const noexcept {
 		return level;
 	}
+	void SetBudget(size_t lines) noexcept;
+	void GetStatistics(Scintilla::LayoutCacheStats &stats) const noexcept;
 	LineLayout* SCICALL Retrieve(Sci::Line lineNumber, Sci::Line lineCaret, int maxChars, int styleClock_,
 		Sci::Line linesOnScreen, Sci::Line linesInDoc, Sci::Line topLine);
 	LineLayout* Retrieve(Sci::Line lineNumber, const SignificantLines &significantLines, int maxChars) {
@@ -240,6 +254,7 @@ class SpecialRepresentations {
 	std::map<unsigned int, Representation> mapReprs;
 	unsigned char startByteHasReprs[0x100] {};
 	unsigned int maxKey = 0;
+	unsigned int graphicReprs = 0;	// representations starting with an ASCII graphic character
 	bool crlf = false;
 public:
 	void SetRepresentation(std::string_view charBytes, std::string_view value);
@@ -251,6 +266,9 @@ public:
 	bool ContainsCrLf() const noexcept {
 		return crlf;
 	}
+	bool ContainsGraphicASCII() const noexcept {
+		return graphicReprs != 0;
+	}
 	bool MayContains(unsigned char ch) const noexcept {
 		return startByteHasReprs[ch] != 0;
 	}
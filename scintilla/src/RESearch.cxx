@@ -207,6 +207,7 @@
 #include <stdexcept>
 #include <string>
 #include <array>
+#include <vector>
 #include <algorithm>
 #include <iterator>
 
@@ -263,7 +264,9 @@ RESearch::RESearch(const CharClassify *charClassTable) noexcept {
 	lineStartPos = 0;
 	lineEndPos = 0;
 	sta = NOP;                  /* status of lastpat */
+	nfaUsed = 0;
 	previousFlags = FindOption::None;
+	requiredLiteralLength = 0;
 	memset(nfa, END, 4);
 	memset(bittab, 0, BITBLK);
 	Clear();
@@ -425,10 +428,31 @@ const char *RESearch::Compile(const char *pattern, size_t length, FindOption fla
 		return nullptr;
 	}
 
+	for (auto it = savedPrograms.begin(); it != savedPrograms.end(); ++it) {
+		if (flags == it->flags && length == it->pattern.length()
+			&& memcmp(pattern, it->pattern.data(), length) == 0) {
+			memcpy(nfa, it->program.data(), it->program.length());
+			nfaUsed = static_cast<int>(it->program.length());
+			requiredLiteralLength = it->literalLength;
+			memcpy(requiredLiteral, it->literal, sizeof(requiredLiteral));
+			sta = OKP;
+			previousFlags = flags;
+			cachedPattern.assign(pattern, length);
+			std::rotate(savedPrograms.begin(), it, it + 1);
+			return nullptr;
+		}
+	}
+
 	const char * const errmsg = DoCompile(pattern, length, flags);
 	if (errmsg == nullptr) {
 		previousFlags = flags;
 		cachedPattern.assign(pattern, length);
+		if (savedPrograms.size() == MaxSavedPrograms) {
+			savedPrograms.pop_back();
+		}
+		SavedProgram program { flags, requiredLiteralLength, {}, cachedPattern, std::string(nfa, nfaUsed) };
+		memcpy(program.literal, requiredLiteral, sizeof(requiredLiteral));
+		savedPrograms.insert(savedPrograms.begin(), std::move(program));
 	}
 	return errmsg;
 }
@@ -722,10 +746,91 @@ const char *RESearch::DoCompile(const char *pattern, size_t length, FindOption f
 	if (tagi > 0)
 		return badpat((posix ? "Unmatched (" : "Unmatched \\("));
 	*mp = END;
+	nfaUsed = static_cast<int>(mp - nfa) + 1;
 	sta = OKP;
+	ComputeRequiredLiteral();
 	return nullptr;
 }
 
+/*
+ * RESearch::ComputeRequiredLiteral:
+ *   walk the compiled automaton and record the longest run of CHR
+ *   nodes outside any closure. Those bytes appear contiguously in
+ *   every match, so a caller can skip text that does not contain
+ *   them before running the automaton at all. Tag markers (BOT/EOT)
+ *   match empty input and do not interrupt a run.
+ */
+void RESearch::ComputeRequiredLiteral() noexcept {
+	requiredLiteralLength = 0;
+	unsigned char run[MaxRequiredLiteral];
+	int runLength = 0;
+	const char *ap = nfa;
+	for (;;) {
+		const unsigned char op = *ap;
+		bool breakRun = true;
+		switch (op) {
+		case CHR:
+			if (runLength < MaxRequiredLiteral) {
+				run[runLength++] = ap[1];
+			}
+			breakRun = false;
+			ap += 2;
+			break;
+		case CCL:
+			ap += 1 + BITBLK;
+			break;
+		case ANY:
+		case BOL:
+		case EOL:
+		case BOW:
+		case EOW:
+			ap += 1;
+			break;
+		case BOT:
+		case EOT:
+			breakRun = false;
+			ap += 2;
+			break;
+		case REF:
+			ap += 2;
+			break;
+		case CLO:
+		case CLQ:
+		case LCLO: {
+			ap += 1;
+			const unsigned char closed = *ap;
+			if (closed == CHR) {
+				ap += 2;
+			} else if (closed == CCL) {
+				ap += 1 + BITBLK;
+			} else {	/* ANY or EOL */
+				ap += 1;
+			}
+			if (*ap != END) {	/* unexpected layout: don't trust anything */
+				requiredLiteralLength = 0;
+				return;
+			}
+			ap += 1;
+		} break;
+		case END:
+			break;
+		default:	/* unexpected opcode: don't trust anything */
+			requiredLiteralLength = 0;
+			return;
+		}
+		if (breakRun || op == END) {
+			if (runLength > requiredLiteralLength) {
+				requiredLiteralLength = runLength;
+				memcpy(requiredLiteral, run, runLength);
+			}
+			runLength = 0;
+			if (op == END) {
+				break;
+			}
+		}
+	}
+}
+
 /*
  * RESearch::Execute:
  *   execute nfa to find a match.
@@ -34,6 +34,12 @@ public:
 	MatchPositions bopat;
 	MatchPositions eopat;
 
+	// longest run of literal bytes every match must contain,
+	// extracted from the automaton for use as a search prefilter.
+	static constexpr int MaxRequiredLiteral = 16;
+	int requiredLiteralLength;
+	unsigned char requiredLiteral[MaxRequiredLiteral];
+
 private:
 	static constexpr int MAXNFA = 4096;
 	// The following constants are not meant to be changeable.
@@ -43,6 +49,7 @@ private:
 
 	void ChSet(unsigned char c) noexcept;
 	void ChSetWithCase(unsigned char c, bool caseSensitive) noexcept;
+	void ComputeRequiredLiteral() noexcept;
 	int GetBackslashExpression(const char *pattern, int &incr) noexcept;
 
 	const char *DoCompile(const char *pattern, size_t length, Scintilla::FindOption flags) noexcept;
@@ -52,12 +59,25 @@ private:
 	Sci::Position lineStartPos;
 	Sci::Position lineEndPos;
 	char nfa[MAXNFA];    /* automaton */
+	int nfaUsed;         /* bytes of nfa occupied by the compiled program */
 	int sta;
 
 	// cache for previous pattern to avoid recompile
 	Scintilla::FindOption previousFlags;
 	std::string cachedPattern;
 
+	// recently compiled programs, so alternating among a handful of patterns
+	// (e.g. saved searches) restores the automaton instead of recompiling it.
+	static constexpr size_t MaxSavedPrograms = 16;
+	struct SavedProgram {
+		Scintilla::FindOption flags;
+		int literalLength;
+		unsigned char literal[MaxRequiredLiteral];
+		std::string pattern;
+		std::string program;
+	};
+	std::vector<SavedProgram> savedPrograms;
+
 	unsigned char bittab[BITBLK]; /* bit table for CCL pre-set bits */
 	const CharClassify *charClass;
 	bool iswordc(unsigned char x) const noexcept {
@@ -255,6 +255,18 @@ void RunStyles<DISTANCE, STYLE>::DeleteRange(DISTANCE position, DISTANCE deleteL
 	}
 }
 
+template <typename DISTANCE, typename STYLE>
+void RunStyles<DISTANCE, STYLE>::Compact(DISTANCE position) {
+	// DeleteRange may leave adjacent runs with the same value when it removes
+	// a whole run, so long editing sessions accumulate fragmented runs.
+	// Only runs from position onwards can be fragmented; merge them going
+	// backwards so removals do not disturb unvisited runs.
+	const DISTANCE runFirst = std::max<DISTANCE>(RunFromPosition(position), 1);
+	for (DISTANCE run = starts.Partitions() - 1; run >= runFirst; run--) {
+		RemoveRunIfSameAsPrevious(run);
+	}
+}
+
 template <typename DISTANCE, typename STYLE>
 DISTANCE RunStyles<DISTANCE, STYLE>::Runs() const noexcept {
 	return starts.Partitions();
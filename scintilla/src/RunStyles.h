@@ -43,6 +43,7 @@ public:
 	void InsertSpace(DISTANCE position, DISTANCE insertLength);
 	void DeleteAll();
 	void DeleteRange(DISTANCE position, DISTANCE deleteLength);
+	void Compact(DISTANCE position);
 	DISTANCE Runs() const noexcept;
 	bool AllSame() const noexcept;
 	bool AllSameAs(STYLE value) const noexcept;
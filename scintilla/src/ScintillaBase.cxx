@@ -20,6 +20,7 @@
 #include <optional>
 #include <algorithm>
 #include <memory>
+#include <atomic>
 
 #include "ParallelSupport.h"
 #include "ScintillaTypes.h"
@@ -659,8 +660,12 @@ LexState::LexState(Document *pdoc_) noexcept : LexInterface(pdoc_) {
 }
 
 void LexState::SetInstance(ILexer5 *instance_) {
+	// the background styler holds the raw lexer pointer: wait for the
+	// in-flight chunk before destroying the old instance under it
+	pdoc->CompleteBackgroundStyling(false);
 	instance.reset(instance_);
-	pdoc->LexerChanged(GetIdentifier() != SCLEX_NULL);
+	const int language = GetIdentifier();
+	pdoc->LexerChanged(!LexerModule::UniformStyleLanguage(language), LexerModule::SafeRestartLanguage(language));
 }
 
 LexState *ScintillaBase::DocumentLexState() {
@@ -672,13 +677,18 @@ LexState *ScintillaBase::DocumentLexState() {
 
 void LexState::SetLexer(int language) { //! removed in Scintilla 5
 	ILexer5 *instance_ = nullptr;
+	bool hasStyles_ = true;
+	bool safeRestart_ = false;
 	if (language != SCLEX_CONTAINER) {
 		const LexerModule *lex = LexerModule::Find(language);
-		language = lex->GetLanguage();
 		instance_ = lex->Create();
+		hasStyles_ = !lex->UniformStyle();
+		safeRestart_ = lex->SafeRestart();
 	}
+	// see SetInstance(): the old lexer may still be styling on the worker
+	pdoc->CompleteBackgroundStyling(false);
 	instance.reset(instance_);
-	pdoc->LexerChanged(language != SCLEX_NULL);
+	pdoc->LexerChanged(hasStyles_, safeRestart_);
 }
 
 const char *LexState::DescribeWordListSets() const noexcept {
@@ -39,6 +39,38 @@ protected:
 	ptrdiff_t gapLength = 0;	/// invariant: gapLength == body.size() - lengthBody
 	size_t growSize;
 
+	/// Recent distinct edit sites, most recent first, for PrepositionGap().
+	/// Consecutive edits near the same site collapse into one entry so a run
+	/// of typing or appending counts as a single site.
+	ptrdiff_t editSites[4] = {};
+	int editSiteCount = 0;
+	bool prepositionPending = false;
+
+	/// Edit sites this close count as the same cluster.
+	static constexpr ptrdiff_t prepositionSlack = 0x1000;
+	/// Gap moves shorter than this are left to happen on demand.
+	static constexpr ptrdiff_t prepositionMinDistance = 0x100000;
+
+	static constexpr ptrdiff_t Distance(ptrdiff_t a, ptrdiff_t b) noexcept {
+		return (a < b) ? b - a : a - b;
+	}
+
+	/// Remember the position of a real insertion or deletion.
+	void RecordEdit(ptrdiff_t position) noexcept {
+		if (editSiteCount != 0 && Distance(position, editSites[0]) <= prepositionSlack) {
+			editSites[0] = position;
+			return;
+		}
+		editSites[3] = editSites[2];
+		editSites[2] = editSites[1];
+		editSites[1] = editSites[0];
+		editSites[0] = position;
+		if (editSiteCount < 4) {
+			editSiteCount++;
+		}
+		prepositionPending = true;
+	}
+
 	/// Move the gap to a particular position so that insertion and
 	/// deletion at that point will not require much copying and
 	/// hence be fast.
@@ -81,6 +113,96 @@ protected:
 		}
 	}
 
+	/// As RoomFor but, when a reallocation is required, builds the new buffer
+	/// with the gap already at the insertion position. Each element is then
+	/// copied exactly once, where ReAllocate followed by GapTo first compacts
+	/// the gap to the end, copies the whole body into the grown allocation and
+	/// moves the gap again - up to three full passes for an insertion near the
+	/// start of a large document.
+	void RoomForAt(ptrdiff_t insertionLength, ptrdiff_t position) {
+		if (gapLength < insertionLength) {
+			const size_t size = body.size();
+			const size_t upper = size / 6;
+			while (growSize < upper) {
+				growSize *= 2;
+			}
+			const size_t newSize = size + insertionLength + growSize;
+			std::vector<T> newBody;
+			newBody.reserve(newSize);
+			newBody.resize(newSize);
+			const ptrdiff_t newGapLength = static_cast<ptrdiff_t>(newSize) - lengthBody;
+			// logical [0, position) to the front, [position, lengthBody) to the back,
+			// each range split where it straddles the old gap.
+			MoveRange(newBody.data(), 0, position);
+			MoveRange(newBody.data() + position + newGapLength, position, lengthBody);
+			body = std::move(newBody);
+			part1Length = position;
+			gapLength = newGapLength;
+		}
+	}
+
+	/// Move the logical range [from, to) into dest, crossing the gap if needed.
+	void MoveRange(T *dest, ptrdiff_t from, ptrdiff_t to) noexcept {
+		const ptrdiff_t end1 = std::min(to, part1Length);
+		if (from < end1) {
+			MoveElements(dest, body.data() + from, end1 - from);
+			dest += end1 - from;
+			from = end1;
+		}
+		if (from < to) {
+			MoveElements(dest, body.data() + gapLength + from, to - from);
+		}
+	}
+
+	static void MoveElements(T *dest, T *src, ptrdiff_t count) noexcept {
+		if constexpr (__is_trivially_copyable(T)) {
+			memcpy(dest, src, count*sizeof(T));
+		} else {
+			std::move(src, src + count, dest);
+		}
+	}
+
+	/// Copy the differing middle of buffer into data, widening [first, last] to
+	/// cover the changed elements.
+	static void ReplaceSpan(T *data, const T *buffer, ptrdiff_t count, ptrdiff_t offset, ptrdiff_t &first, ptrdiff_t &last) noexcept {
+		ptrdiff_t start = 0;
+		while (start < count && data[start] == buffer[start]) {
+			start++;
+		}
+		if (start == count) {
+			return;
+		}
+		ptrdiff_t end = count;
+		while (data[end - 1] == buffer[end - 1]) {
+			end--;
+		}
+		if constexpr (__is_trivially_copyable(T)) {
+			memcpy(data + start, buffer + start, (end - start)*sizeof(T));
+		} else {
+			std::copy(buffer + start, buffer + end, data + start);
+		}
+		first = std::min(first, offset + start);
+		last = std::max(last, offset + end - 1);
+	}
+
+	/// Set the differing middle of the span to v.
+	/// @return true when any element changed.
+	static bool FillSpan(T *data, ptrdiff_t count, const T v) noexcept {
+		ptrdiff_t start = 0;
+		while (start < count && data[start] == v) {
+			start++;
+		}
+		if (start == count) {
+			return false;
+		}
+		ptrdiff_t end = count;
+		while (data[end - 1] == v) {
+			end--;
+		}
+		std::fill(data + start, data + end, v);
+		return true;
+	}
+
 	void Init() {
 		body.clear();
 		body.shrink_to_fit();
@@ -88,6 +210,8 @@ protected:
 		part1Length = 0;
 		gapLength = 0;
 		growSize = 8;
+		editSiteCount = 0;
+		prepositionPending = false;
 	}
 
 public:
@@ -213,6 +337,11 @@ public:
 		return lengthBody;
 	}
 
+	/// Memory allocated for the buffer including the gap, for diagnostics.
+	size_t AllocatedBytes() const noexcept {
+		return body.capacity() * sizeof(T);
+	}
+
 	/// Insert a single value into the buffer.
 	/// Inserting at positions outside the current range fails.
 	void Insert(ptrdiff_t position, T v) {
@@ -220,7 +349,8 @@ public:
 		if (!InRangeInclusive(position, lengthBody)) {
 			return;
 		}
-		RoomFor(1);
+		RecordEdit(position);
+		RoomForAt(1, position);
 		GapTo(position);
 		body[part1Length] = std::move(v);
 		lengthBody++;
@@ -236,7 +366,8 @@ public:
 			if (!InRangeInclusive(position, lengthBody)) {
 				return;
 			}
-			RoomFor(insertLength);
+			RecordEdit(position);
+			RoomForAt(insertLength, position);
 			GapTo(position);
 			std::fill_n(body.data() + part1Length, insertLength, v);
 			lengthBody += insertLength;
@@ -255,7 +386,8 @@ public:
 			if (!InRangeInclusive(position, lengthBody)) {
 				return nullptr;
 			}
-			RoomFor(insertLength);
+			RecordEdit(position);
+			RoomForAt(insertLength, position);
 			GapTo(position);
 			T *ptr = body.data() + part1Length;
 			//std::uninitialized_value_construct_n(ptr, insertLength);
@@ -289,9 +421,10 @@ public:
 			if (!InRangeInclusive(positionToInsert, lengthBody)) {
 				return;
 			}
-			RoomFor(insertLength);
+			RecordEdit(positionToInsert);
+			RoomForAt(insertLength, positionToInsert);
 			GapTo(positionToInsert);
-			if constexpr (__is_standard_layout(T)) {
+			if constexpr (__is_trivially_copyable(T)) {
 				memcpy(body.data() + part1Length, s + positionFrom, insertLength*sizeof(T));
 			} else {
 				std::copy_n(s + positionFrom, insertLength, body.data() + part1Length);
@@ -317,6 +450,7 @@ public:
 			// Full deallocation returns storage and is faster
 			Init();
 		} else if (position >= 0 && deleteLength > 0 && (position + deleteLength) <= lengthBody) {
+			RecordEdit(position);
 			GapTo(position);
 			lengthBody -= deleteLength;
 			gapLength += deleteLength;
@@ -344,6 +478,46 @@ public:
 		}
 	}
 
+	/// Replace a range of elements from an array.
+	/// @return true when any element changed, with the positions of the first and
+	/// last changed elements. Only the changed middle of each span is written so
+	/// restyling a range with identical contents does no writes.
+	bool ReplaceRange(const T *buffer, ptrdiff_t position, ptrdiff_t rangeLength, ptrdiff_t &first, ptrdiff_t &last) noexcept {
+		// Split into up to 2 ranges, before and after the split, then compare and copy each.
+		first = position + rangeLength;
+		last = position - 1;
+		ptrdiff_t range1Length = 0;
+		T* data = body.data() + position;
+		if (position < part1Length) {
+			range1Length = std::min(rangeLength, part1Length - position);
+			ReplaceSpan(data, buffer, range1Length, position, first, last);
+		}
+		if (range1Length < rangeLength) {
+			data += range1Length + gapLength;
+			ReplaceSpan(data, buffer + range1Length, rangeLength - range1Length, position + range1Length, first, last);
+		}
+		return last >= first;
+	}
+
+	/// Set a range of elements to a single value.
+	/// @return true when any element changed. Only the changed middle of each
+	/// span is written so restyling a run with its current style does no writes.
+	bool FillRange(ptrdiff_t position, ptrdiff_t rangeLength, T v) noexcept {
+		// Split into up to 2 ranges, before and after the split, then fill each.
+		bool changed = false;
+		ptrdiff_t range1Length = 0;
+		T* data = body.data() + position;
+		if (position < part1Length) {
+			range1Length = std::min(rangeLength, part1Length - position);
+			changed = FillSpan(data, range1Length, v);
+		}
+		if (range1Length < rangeLength) {
+			data += range1Length + gapLength;
+			changed = FillSpan(data, rangeLength - range1Length, v) || changed;
+		}
+		return changed;
+	}
+
 	int CheckRange(const T *buffer, ptrdiff_t position, ptrdiff_t rangeLength) const noexcept {
 		// Split into up to 2 ranges, before and after the split then use memcmp on each.
 		ptrdiff_t range1Length = 0;
@@ -362,6 +536,26 @@ public:
 		return result;
 	}
 
+	/// Length of the common prefix of buffer and a range of elements.
+	ptrdiff_t CommonPrefix(const T *buffer, ptrdiff_t position, ptrdiff_t rangeLength) const noexcept {
+		// Split into up to 2 ranges, before and after the split then use mismatch on each.
+		ptrdiff_t range1Length = 0;
+		const T* data = body.data() + position;
+		if (position < part1Length) {
+			range1Length = std::min(rangeLength, part1Length - position);
+			const T* match = std::mismatch(buffer, buffer + range1Length, data).first;
+			if (match != buffer + range1Length) {
+				return match - buffer;
+			}
+		}
+		if (range1Length < rangeLength) {
+			data += range1Length + gapLength;
+			const T* match = std::mismatch(buffer + range1Length, buffer + rangeLength, data).first;
+			return match - buffer;
+		}
+		return rangeLength;
+	}
+
 	/// Compact the buffer and return a pointer to the first element.
 	/// Also ensures there is an empty element beyond logical end in case its
 	/// passed to a function expecting a NUL terminated string.
@@ -411,6 +605,35 @@ public:
 	ptrdiff_t GapPosition() const noexcept {
 		return part1Length;
 	}
+
+	/// Move the gap to the predicted next edit site. Call while idle: when
+	/// recent edits alternate between two distant sites, such as a header
+	/// and the end of a log, this pays the long memmove outside the edit so
+	/// the next insertion or deletion at the other site finds the gap ready.
+	/// Moving the gap invalidates pointers returned by RangePointer and
+	/// BufferPointer, the same as a modification does.
+	/// @return true when the gap was moved.
+	bool PrepositionGap() noexcept {
+		if (!prepositionPending) {
+			return false;
+		}
+		prepositionPending = false;
+		if (editSiteCount < 4 || gapLength == 0) {
+			return false;
+		}
+		// only act on an established alternating pattern: a stray jump, a
+		// linear scan or scattered edits must not trigger speculative moves.
+		if (Distance(editSites[0], editSites[2]) > prepositionSlack ||
+			Distance(editSites[1], editSites[3]) > prepositionSlack) {
+			return false;
+		}
+		const ptrdiff_t predicted = std::min(editSites[1], lengthBody);
+		if (Distance(predicted, part1Length) < prepositionMinDistance) {
+			return false;
+		}
+		GapTo(predicted);
+		return true;
+	}
 };
 
 }
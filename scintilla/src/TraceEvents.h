@@ -0,0 +1,66 @@
+// This file is part of Notepad4.
+// See License.txt for details about distribution and modification.
+// Lightweight TraceLogging (ETW) instrumentation for the editing and painting
+// hot paths. The provider is compiled into release builds: while no trace
+// session listens, each scope costs one predictable branch on the provider
+// enable flag. Capture with any session enabling the provider by name, e.g.
+//   wpr -start GeneralProfile -start Notepad4.wprp
+// or
+//   xperf -start trace -on *Notepad4.Trace
+// then view the paired Start/Stop opcodes as regions of interest in WPA.
+#pragma once
+
+#include <windows.h>
+#if defined(__has_include) && __has_include(<TraceLoggingProvider.h>)
+#include <winmeta.h>
+#include <TraceLoggingProvider.h>
+#define NP2_TRACE_EVENTS	1
+#else
+// older MinGW distributions lack the TraceLogging headers
+#define NP2_TRACE_EVENTS	0
+#endif
+
+#if NP2_TRACE_EVENTS
+
+// {4a19744c-8d88-53bf-047f-f7c548575b68}, hashed from the provider name
+// "Notepad4.Trace" with the standard ETW algorithm, so "*Notepad4.Trace"
+// enables the provider in wpr/xperf/traceview without knowing the GUID.
+// Defined and registered in ScintillaWin.cxx.
+TRACELOGGING_DECLARE_PROVIDER(hTraceEventProvider);
+
+// Emits paired Start/Stop events around a scope when a trace session has the
+// provider enabled; WPA shows the pair as a named region. The optional detail
+// value carries a site specific argument such as the message or line number.
+class TraceEventScope {
+	const char * const name;
+	const bool enabled;
+public:
+	explicit TraceEventScope(const char *name_, unsigned int detail = 0) noexcept
+		: name{name_}, enabled{!!TraceLoggingProviderEnabled(hTraceEventProvider, WINEVENT_LEVEL_VERBOSE, 0)} {
+		if (enabled) {
+			TraceLoggingWrite(hTraceEventProvider, "ScopeBegin",
+				TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+				TraceLoggingOpcode(WINEVENT_OPCODE_START),
+				TraceLoggingString(name, "Scope"),
+				TraceLoggingUInt32(detail, "Detail"));
+		}
+	}
+	~TraceEventScope() {
+		if (enabled) {
+			TraceLoggingWrite(hTraceEventProvider, "ScopeEnd",
+				TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+				TraceLoggingOpcode(WINEVENT_OPCODE_STOP),
+				TraceLoggingString(name, "Scope"));
+		}
+	}
+	TraceEventScope(const TraceEventScope &) = delete;
+	TraceEventScope &operator=(const TraceEventScope &) = delete;
+};
+
+#define NP2_TRACE_SCOPE(name)			const TraceEventScope traceEventScope{name}
+#define NP2_TRACE_SCOPE2(name, detail)	const TraceEventScope traceEventScope{(name), static_cast<unsigned int>(detail)}
+
+#else
+#define NP2_TRACE_SCOPE(name)			static_cast<void>(0)
+#define NP2_TRACE_SCOPE2(name, detail)	static_cast<void>(0)
+#endif
@@ -298,6 +298,10 @@ const char *ScrapStack::TextAt(size_t position) const noexcept {
 	return stack.data() + position;
 }
 
+size_t ScrapStack::SizeInBytes() const noexcept {
+	return stack.capacity();
+}
+
 // The undo history stores a sequence of user operations that represent the user's view of the
 // commands executed on the text.
 // Each user operation contains a sequence of text insertion and text deletion actions.
@@ -445,6 +449,13 @@ int UndoHistory::Actions() const noexcept {
 	return static_cast<int>(actions.SSize());
 }
 
+size_t UndoHistory::AllocatedBytes() const noexcept {
+	return actions.types.capacity() * sizeof(UndoActionType)
+		+ actions.positions.SizeInBytes()
+		+ actions.lengths.SizeInBytes()
+		+ scraps->SizeInBytes();
+}
+
 void UndoHistory::SetSavePoint(int action) noexcept {
 	savePoint = action;
 }
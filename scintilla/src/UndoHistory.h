@@ -72,6 +72,7 @@ public:
 	void MoveBack(size_t length) noexcept;
 	[[nodiscard]] const char *CurrentText() const noexcept;
 	[[nodiscard]] const char *TextAt(size_t position) const noexcept;
+	[[nodiscard]] size_t SizeInBytes() const noexcept;
 };
 
 constexpr int coalesceFlag = 0x100;
@@ -105,6 +106,7 @@ public:
 	void DeleteUndoHistory() noexcept;
 
 	[[nodiscard]] int Actions() const noexcept;
+	[[nodiscard]] size_t AllocatedBytes() const noexcept;
 
 	/// The save point is a marker in the undo stack where the container has stated that
 	/// the buffer was saved. Undo and redo can move over the save point.
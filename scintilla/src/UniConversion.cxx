@@ -12,25 +12,59 @@
 #include <string>
 #include <string_view>
 
+#include "VectorISA.h"
 #include "UniConversion.h"
 
 namespace Scintilla::Internal {
 
 size_t UTF8Length(std::wstring_view wsv) noexcept {
+	const size_t length = wsv.length();
 	size_t len = 0;
-	for (size_t i = 0; i < wsv.length() && wsv[i];) {
+	size_t i = 0;
+	while (i < length && wsv[i]) {
 		const unsigned int uch = wsv[i];
 		if (uch < 0x80) {
 			len++;
+			i++;
+#if NP2_USE_AVX2
+			// ASCII dominates large pastes and maps one unit to one byte, so count
+			// it a vector at a time. packus saturates each UTF-16 unit into a byte
+			// whose sign bit marks values outside ASCII (0x8000.. wrap to NUL), so
+			// one movemask finds NUL terminator and non-ASCII lanes together.
+			while (i + sizeof(__m256i) / 2 <= length) {
+				const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(wsv.data() + i));
+				const __m256i packed = _mm256_packus_epi16(chunk, chunk);
+				if (mm256_movemask_epi8(_mm256_or_si256(packed, _mm256_cmpeq_epi8(packed, _mm256_setzero_si256()))) != 0) {
+					break;
+				}
+				len += sizeof(__m256i) / 2;
+				i += sizeof(__m256i) / 2;
+			}
+#elif NP2_USE_SSE2
+			// ASCII dominates large pastes and maps one unit to one byte, so count
+			// it a vector at a time. packus saturates each UTF-16 unit into a byte
+			// whose sign bit marks values outside ASCII (0x8000.. wrap to NUL), so
+			// one movemask finds NUL terminator and non-ASCII lanes together.
+			while (i + sizeof(__m128i) / 2 <= length) {
+				const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(wsv.data() + i));
+				const __m128i packed = _mm_packus_epi16(chunk, chunk);
+				if (mm_movemask_epi8(_mm_or_si128(packed, _mm_cmpeq_epi8(packed, _mm_setzero_si128()))) != 0) {
+					break;
+				}
+				len += sizeof(__m128i) / 2;
+				i += sizeof(__m128i) / 2;
+			}
+#endif
 		} else if (uch < 0x800) {
 			len += 2;
+			i++;
 		} else if ((uch >= SURROGATE_LEAD_FIRST) && (uch <= SURROGATE_TRAIL_LAST)) {
 			len += 4;
-			i++;
+			i += 2;
 		} else {
 			len += 3;
+			i++;
 		}
-		i++;
 	}
 	return len;
 }
@@ -52,12 +86,44 @@ size_t UTF8PositionFromUTF16Position(std::string_view u8Text, size_t positionUTF
 #define UTF16_TO_UTF32(lead, trail)	(((lead) << 10) + (trail) + SURROGATE_OFFSET)
 
 void UTF8FromUTF16(std::wstring_view wsv, char *putf, size_t len) noexcept {
+	const size_t length = wsv.length();
 	size_t k = 0;
-	for (size_t i = 0; i < wsv.length() && wsv[i];) {
+	size_t i = 0;
+	while (i < length && wsv[i]) {
 		const unsigned int uch = wsv[i];
 		if (uch < 0x80) {
 			putf[k++] = static_cast<char>(uch);
-		} else if (uch < 0x800) {
+			i++;
+#if NP2_USE_AVX2
+			// Narrow runs of ASCII a vector at a time, same screening as UTF8Length().
+			while (i + sizeof(__m256i) / 2 <= length) {
+				const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(wsv.data() + i));
+				const __m256i packed = _mm256_packus_epi16(chunk, chunk);
+				if (mm256_movemask_epi8(_mm256_or_si256(packed, _mm256_cmpeq_epi8(packed, _mm256_setzero_si256()))) != 0) {
+					break;
+				}
+				// packus packs within 128-bit lanes, gather the two distinct quadwords
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(putf + k),
+					_mm256_castsi256_si128(_mm256_permute4x64_epi64(packed, 0x88)));
+				k += sizeof(__m256i) / 2;
+				i += sizeof(__m256i) / 2;
+			}
+#elif NP2_USE_SSE2
+			// Narrow runs of ASCII a vector at a time, same screening as UTF8Length().
+			while (i + sizeof(__m128i) / 2 <= length) {
+				const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(wsv.data() + i));
+				const __m128i packed = _mm_packus_epi16(chunk, chunk);
+				if (mm_movemask_epi8(_mm_or_si128(packed, _mm_cmpeq_epi8(packed, _mm_setzero_si128()))) != 0) {
+					break;
+				}
+				_mm_storel_epi64(reinterpret_cast<__m128i *>(putf + k), packed);
+				k += sizeof(__m128i) / 2;
+				i += sizeof(__m128i) / 2;
+			}
+#endif
+			continue;
+		}
+		if (uch < 0x800) {
 			putf[k++] = static_cast<char>(0xC0 | (uch >> 6));
 			putf[k++] = static_cast<char>(0x80 | (uch & 0x3f));
 		} else if ((uch >= SURROGATE_LEAD_FIRST) && (uch <= SURROGATE_TRAIL_LAST)) {
@@ -109,6 +175,35 @@ size_t UTF16Length(std::string_view svu8) noexcept {
 		byteCount = UTF8BytesOfLead(ch);
 		i += byteCount;
 		ulen += UTF16LengthFromUTF8ByteCount(byteCount);
+#if NP2_USE_AVX2
+		if (ch < 0x80) {
+			// ASCII maps one byte to one unit and dominates large documents, so
+			// count it a vector at a time. Lead and trail bytes all have the sign
+			// bit set so one movemask screens a whole vector for non-ASCII.
+			while (i + sizeof(__m256i) <= svu8.length()) {
+				const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(svu8.data() + i));
+				if (mm256_movemask_epi8(chunk) != 0) {
+					break;
+				}
+				ulen += sizeof(__m256i);
+				i += sizeof(__m256i);
+			}
+		}
+#elif NP2_USE_SSE2
+		if (ch < 0x80) {
+			// ASCII maps one byte to one unit and dominates large documents, so
+			// count it a vector at a time. Lead and trail bytes all have the sign
+			// bit set so one movemask screens a whole vector for non-ASCII.
+			while (i + sizeof(__m128i) <= svu8.length()) {
+				const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(svu8.data() + i));
+				if (mm_movemask_epi8(chunk) != 0) {
+					break;
+				}
+				ulen += sizeof(__m128i);
+				i += sizeof(__m128i);
+			}
+		}
+#endif
 	}
 
 	// Invalid 4-bytes UTF-8 lead byte at string end.
@@ -146,6 +241,38 @@ size_t UTF16FromUTF8(std::string_view svu8, wchar_t *tbuf, size_t tlen) noexcept
 		switch (byteCount) {
 		case 1:
 			tbuf[ui] = ch;
+#if NP2_USE_AVX2
+			// Widen runs of ASCII a vector at a time, same screening as UTF16Length().
+			// ptr already passed ch and ui is incremented after the switch, so the
+			// vector output lands one unit past the scalar one.
+			while (ptr + sizeof(__m256i) <= end && ui + 1 + sizeof(__m256i) <= tlen) {
+				const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ptr));
+				if (mm256_movemask_epi8(chunk) != 0) {
+					break;
+				}
+				_mm256_storeu_si256(reinterpret_cast<__m256i *>(tbuf + ui + 1),
+					_mm256_cvtepu8_epi16(_mm256_castsi256_si128(chunk)));
+				_mm256_storeu_si256(reinterpret_cast<__m256i *>(tbuf + ui + 1 + sizeof(__m256i)/2),
+					_mm256_cvtepu8_epi16(_mm256_extracti128_si256(chunk, 1)));
+				ui += sizeof(__m256i);
+				ptr += sizeof(__m256i);
+			}
+#elif NP2_USE_SSE2
+			// Widen runs of ASCII a vector at a time, same screening as UTF16Length().
+			// ptr already passed ch and ui is incremented after the switch, so the
+			// vector output lands one unit past the scalar one.
+			while (ptr + sizeof(__m128i) <= end && ui + 1 + sizeof(__m128i) <= tlen) {
+				const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr));
+				if (mm_movemask_epi8(chunk) != 0) {
+					break;
+				}
+				const __m128i zero = _mm_setzero_si128();
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(tbuf + ui + 1), _mm_unpacklo_epi8(chunk, zero));
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(tbuf + ui + 1 + sizeof(__m128i)/2), _mm_unpackhi_epi8(chunk, zero));
+				ui += sizeof(__m128i);
+				ptr += sizeof(__m128i);
+			}
+#endif
 			break;
 		case 2:
 			value = (ch & 0x1F) << 6;
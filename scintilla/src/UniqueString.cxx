@@ -23,6 +23,11 @@ UniqueString UniqueStringCopy(const char *text) {
 	return UniqueCopy(text, std::char_traits<char>::length(text) + 1);
 }
 
+const char *UniqueStringIntern(const char *text) {
+	static UniqueStringSet pool;
+	return pool.Save(text);
+}
+
 // A set of strings that always returns the same pointer for each string.
 
 UniqueStringSet::UniqueStringSet() noexcept = default;
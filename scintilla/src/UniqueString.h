@@ -42,6 +42,12 @@ using UniqueString = std::unique_ptr<const char[]>;
 /// into collections.
 UniqueString UniqueStringCopy(const char *text);
 
+/// A process-wide intern pool for strings such as font names that recur across
+/// many style objects. The returned pointer is stable for the lifetime of the
+/// process, so interned strings may be shared and compared by pointer.
+/// Must only be called from the GUI thread.
+const char *UniqueStringIntern(const char *text);
+
 // A set of strings that always returns the same pointer for each string.
 
 class UniqueStringSet {
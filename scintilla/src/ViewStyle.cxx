@@ -241,10 +241,8 @@ ViewStyle::ViewStyle(size_t stylesSize_):
 // modified for printing styles.
 ViewStyle::ViewStyle(const ViewStyle &source) : ViewStyle(source.styles.size()) {
 	styles = source.styles;
-	for (auto &style : styles) {
-		// Can't just copy fontName as its lifetime is relative to its owning ViewStyle
-		style.fontName = fontNames.Save(style.fontName);
-	}
+	// fontName pointers remain valid in the copy as font names are interned
+	// in a process-wide pool, see UniqueStringIntern().
 	markers = source.markers;
 	nextExtendedStyle = source.nextExtendedStyle;
 	CalcLargestMarkerHeight();
@@ -348,19 +346,36 @@ void ViewStyle::CalculateMarginWidthAndMask() noexcept {
 void ViewStyle::Refresh(Surface &surface, int tabInChars) {
 	if (!fontsValid) {
 		fontsValid = true;
-		fonts.clear();
+		// When everything that goes into realising a font is unchanged, carry
+		// the realised fonts over instead of re-creating identical platform
+		// fonts: a scheme switch refreshes the view several times with mostly
+		// the same font specifications.
+		FontMap previousFonts;
+		const int logPixelsY = surface.LogPixelsY();
+		if (zoomLevel == fontsZoomLevel && technology == fontsTechnology
+			&& logPixelsY == fontsLogPixelsY && localeName == fontsLocaleName) {
+			previousFonts.swap(fonts);
+		} else {
+			fonts.clear();
+			fontsZoomLevel = zoomLevel;
+			fontsTechnology = technology;
+			fontsLogPixelsY = logPixelsY;
+			fontsLocaleName = localeName;
+		}
 
 		// Apply the extra font flag which controls text drawing quality to each style.
 		const FontQuality quality = extraFontFlag;
 		// Create a FontRealised object for each unique font in the styles.
 		for (auto &style : styles) {
 			style.extraFontFlag = quality;
-			CreateAndAddFont(style);
+			CreateAndAddFont(style, previousFonts);
 		}
 
-		// Ask platform to allocate each unique font.
+		// Ask platform to allocate each unique font not carried over.
 		for (const auto &font : fonts) {
-			font.second->Realise(surface, zoomLevel, technology, font.first, localeName.c_str());
+			if (!font.second->font) {
+				font.second->Realise(surface, zoomLevel, technology, font.first, localeName.c_str());
+			}
 		}
 
 		// Set the platform font handle and measurements for each style.
@@ -452,7 +467,7 @@ void ViewStyle::EnsureStyle([[maybe_unused]] size_t index) {
 
 void ViewStyle::ResetDefaultStyle() {
 	fontsValid = false;
-	styles[StyleDefault].ResetDefault(fontNames.Save(Platform::DefaultFont()));
+	styles[StyleDefault].ResetDefault(UniqueStringIntern(Platform::DefaultFont()));
 }
 
 void ViewStyle::ClearStyles() noexcept {
@@ -485,7 +500,7 @@ void ViewStyle::CopyStyles(size_t sourceIndex, size_t destStyles) {
 
 void ViewStyle::SetStyleFontName(int styleIndex, const char *name) {
 	fontsValid = false;
-	styles[styleIndex].fontName = fontNames.Save(name);
+	styles[styleIndex].fontName = UniqueStringIntern(name);
 }
 
 void ViewStyle::SetFontLocaleName(const char *name) {
@@ -749,49 +764,26 @@ ViewStyle::CaretShape ViewStyle::CaretShapeForMode(bool inOverstrike, bool isMai
 	return (style <= CaretStyle::Block) ? static_cast<CaretShape>(style) : CaretShape::line;
 }
 
-bool ViewStyle::ZoomIn() noexcept {
-	if (zoomLevel < MaxZoomLevel) {
-		int level = zoomLevel;
-		if (level < 200) {
-			level += 10;
-		} else {
-			level += 25;
-		}
-
-		level = std::min(level, MaxZoomLevel);
-		if (level != zoomLevel) {
-			zoomLevel = level;
-			fontsValid = false;
-			return true;
-		}
-	}
-	return false;
-}
-
-bool ViewStyle::ZoomOut() noexcept {
-	if (zoomLevel > MinZoomLevel) {
-		int level = zoomLevel;
-		if (level <= 200) {
-			level -= 10;
-		} else {
-			level -= 25;
-		}
-
-		level = std::max(level, MinZoomLevel);
-		if (level != zoomLevel) {
-			zoomLevel = level;
-			fontsValid = false;
-			return true;
-		}
+int ViewStyle::NextZoomLevel(bool zoomIn) const noexcept {
+	int level = zoomLevel;
+	if (zoomIn) {
+		level += (level < 200) ? 10 : 25;
+	} else {
+		level -= (level <= 200) ? 10 : 25;
 	}
-	return false;
+	return std::clamp(level, MinZoomLevel, MaxZoomLevel);
 }
 
-void ViewStyle::CreateAndAddFont(const FontSpecification &fs) {
+void ViewStyle::CreateAndAddFont(const FontSpecification &fs, FontMap &previousFonts) {
 	if (fs.fontName) {
 		const auto it = fonts.find(fs);
 		if (it == fonts.end()) {
-			fonts.emplace(fs, std::make_unique<FontRealised>());
+			auto node = previousFonts.extract(fs);
+			if (node) {
+				fonts.insert(std::move(node));
+			} else {
+				fonts.emplace(fs, std::make_unique<FontRealised>());
+			}
 		}
 	}
 }
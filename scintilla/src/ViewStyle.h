@@ -113,8 +113,14 @@ enum StyleIndices {
 /**
  */
 class ViewStyle final {
-	UniqueStringSet fontNames;
 	FontMap fonts;
+	// inputs the current FontRealised objects were realised with: when these
+	// are unchanged a refresh reuses the realised fonts instead of creating
+	// identical platform fonts again.
+	int fontsZoomLevel = 0;
+	int fontsLogPixelsY = 0;
+	Scintilla::Technology fontsTechnology = Scintilla::Technology::Default;
+	std::string fontsLocaleName;
 public:
 	std::vector<Style> styles;
 	std::vector<LineMarker> markers;
@@ -254,13 +260,12 @@ public:
 	bool DrawCaretInsideSelection(bool inOverstrike, bool imeCaretBlockOverride) const noexcept;
 	CaretShape CaretShapeForMode(bool inOverstrike, bool isMainSelection, bool drawDrag, bool drawOverstrikeCaret, bool imeCaretBlockOverride) const noexcept;
 
-	bool ZoomIn() noexcept;
-	bool ZoomOut() noexcept;
+	int NextZoomLevel(bool zoomIn) const noexcept;
 
 private:
 	XYPOSITION maxFontAscent;
 	XYPOSITION maxFontDescent;
-	void CreateAndAddFont(const FontSpecification &fs);
+	void CreateAndAddFont(const FontSpecification &fs, FontMap &previousFonts);
 	FontRealised *Find(const FontSpecification &fs) const;
 	void FindMaxAscentDescent() noexcept;
 };
@@ -0,0 +1,264 @@
+// This file is part of Notepad4.
+// See License.txt for details about distribution and modification.
+// Micro benchmark suite for hot editing paths, built on reproducible synthetic
+// corpora (fixed PCG32 seeds) so numbers are comparable between builds.
+// Each result is printed as a CSV row:
+//     benchmark,bytes,repeat,seconds,MB/s,checksum
+// The checksum must stay identical between builds of the same sources;
+// a changed checksum means the benchmark measured different work.
+#define _CRT_SECURE_NO_WARNINGS
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include "../include/VectorISA.h"
+#include "../src/Debugging.h"
+#include "../src/SplitVector.h"
+#include "../lexlib/WordList.h"
+#include "TestUtils.h"
+
+// cl /EHsc /std:c++20 /DNDEBUG /O2 /GS- /GR- /Gv /W4 /arch:AVX2 PerfTest.cpp ../lexlib/WordList.cxx
+// clang-cl /EHsc /std:c++20 /DNDEBUG /O2 /GS- /GR- /Gv /W4 -march=x86-64-v3 PerfTest.cpp ../lexlib/WordList.cxx
+// g++ -std=gnu++20 -DNDEBUG -O3 -fno-rtti -Wall -Wextra -march=x86-64-v3 PerfTest.cpp ../lexlib/WordList.cxx -o PerfTest
+
+using Scintilla::Internal::SplitVector;
+using Lexilla::WordList;
+
+namespace {
+
+using PerfClock = std::chrono::steady_clock;
+
+double SecondsSince(PerfClock::time_point start) noexcept {
+	const auto duration = std::chrono::duration_cast<std::chrono::duration<double>>(PerfClock::now() - start);
+	return duration.count();
+}
+
+void Report(const char *name, uint64_t bytes, uint32_t repeat, double seconds, uint64_t checksum) noexcept {
+	const double rate = (seconds > 0.0) ? (static_cast<double>(bytes)*repeat)/(seconds*1024*1024) : 0.0;
+	printf("%s,%llu,%u,%.6f,%.1f,%llu\n", name,
+		static_cast<unsigned long long>(bytes), repeat, seconds, rate,
+		static_cast<unsigned long long>(checksum));
+}
+
+// synthetic application log, one record per line, sprinkled with ERROR lines.
+std::string BuildLogCorpus(size_t size) {
+	PCG32Random random(UINT64_C(0x853c49e6748fea9b), UINT64_C(0xda3e39cb94b95bdb));
+	static const char * const levels[8] = {
+		"INFO ", "DEBUG", "INFO ", "WARN ", "INFO ", "TRACE", "INFO ", "ERROR",
+	};
+	std::string text;
+	text.reserve(size + 128);
+	uint32_t tick = 0;
+	while (text.length() < size) {
+		char line[128];
+		const uint32_t value = random.Next();
+		tick += 1 + (value & 7);
+		sprintf(line, "2026-08-28 %02u:%02u:%02u.%03u %s worker-%u request id=%u completed in %u ms\n",
+			(tick/3600000) % 24, (tick/60000) % 60, (tick/1000) % 60, tick % 1000,
+			levels[value & 7], (value >> 3) & 15, random.Next(), (value >> 7) & 511);
+		text += line;
+	}
+	return text;
+}
+
+// synthetic JSON document with strings, escapes and numbers.
+std::string BuildJsonCorpus(size_t size) {
+	PCG32Random random(UINT64_C(0x2545f4914f6cdd1d), UINT64_C(0x9e3779b97f4a7c15));
+	std::string text;
+	text.reserve(size + 160);
+	text += "[\n";
+	while (text.length() < size) {
+		char line[160];
+		const uint32_t value = random.Next();
+		sprintf(line, "\t{\"id\": %u, \"name\": \"item %u\", \"path\": \"C:\\\\data\\\\%02x\\\\file%u.txt\", \"ok\": %s},\n",
+			value, value & 0xffff, value & 0xff, random.Next() & 0xfff, (value & 1) ? "true" : "false");
+		text += line;
+	}
+	text += "]\n";
+	return text;
+}
+
+// CellBuffer substance: gap buffer insert/delete in bursts of local edits at
+// pseudo random places, the access pattern typing and replace-all produce.
+void BenchGapBuffer(uint32_t scale) {
+	constexpr size_t documentSize = 4*1024*1024;
+	constexpr uint32_t editCount = 100000;
+	constexpr uint32_t burstMask = 63; // edits per location
+	constexpr char fragment[] = "0123456789abcdef";
+	constexpr ptrdiff_t fragmentLength = sizeof(fragment) - 1;
+
+	SplitVector<char> buffer;
+	buffer.InsertValue(0, documentSize, ' ');
+	PCG32Random random(UINT64_C(0xda3e39cb94b95bdb), UINT64_C(0x853c49e6748fea9b));
+	uint64_t checksum = 0;
+	ptrdiff_t base = 0;
+	const auto start = PerfClock::now();
+	for (uint32_t repeat = 0; repeat < scale; repeat++) {
+		for (uint32_t i = 0; i < editCount; i++) {
+			if ((i & burstMask) == 0) {
+				base = random.Next() % (documentSize - 256);
+			}
+			const ptrdiff_t position = base + (random.Next() & 255);
+			buffer.InsertFromArray(position, fragment, 0, fragmentLength);
+			buffer.DeleteRange(position, fragmentLength);
+			checksum += position;
+		}
+	}
+	const double seconds = SecondsSince(start);
+	Report("GapBufferEdit", 2*fragmentLength*editCount, scale, seconds, checksum);
+}
+
+// FindText substance: find all occurrences of a needle with the first/last
+// character chunk scan used by Document::FindText, plus verification.
+uint64_t CountOccurrences(const char *s, size_t length, const char *needle, size_t needleLength) noexcept {
+	uint64_t count = 0;
+	const unsigned char chFirst = needle[0];
+	const unsigned char chLast = needle[needleLength - 1];
+	size_t position = 0;
+	const size_t maxPos = length - needleLength;
+#if NP2_USE_AVX2
+	const __m256i mmFirst = mm256_set1_epi8(chFirst);
+	const __m256i mmLast = mm256_set1_epi8(chLast);
+	while (position + sizeof(__m256i) <= maxPos) {
+		const __m256i chunkFirst = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + position));
+		const __m256i chunkLast = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + position + needleLength - 1));
+		uint32_t mask = mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(chunkFirst, mmFirst), _mm256_cmpeq_epi8(chunkLast, mmLast)));
+		while (mask) {
+			const size_t index = position + np2::ctz(mask);
+			mask &= mask - 1;
+			count += memcmp(s + index, needle, needleLength) == 0;
+		}
+		position += sizeof(__m256i);
+	}
+	// end NP2_USE_AVX2
+#elif NP2_USE_SSE2
+	const __m128i mmFirst = _mm_set1_epi8(chFirst);
+	const __m128i mmLast = _mm_set1_epi8(chLast);
+	while (position + sizeof(__m128i) <= maxPos) {
+		const __m128i chunkFirst = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + position));
+		const __m128i chunkLast = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + position + needleLength - 1));
+		uint32_t mask = mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(chunkFirst, mmFirst), _mm_cmpeq_epi8(chunkLast, mmLast)));
+		while (mask) {
+			const size_t index = position + np2::ctz(mask);
+			mask &= mask - 1;
+			count += memcmp(s + index, needle, needleLength) == 0;
+		}
+		position += sizeof(__m128i);
+	}
+	// end NP2_USE_SSE2
+#endif
+	for (; position <= maxPos; position++) {
+		if (static_cast<unsigned char>(s[position]) == chFirst && memcmp(s + position, needle, needleLength) == 0) {
+			++count;
+		}
+	}
+	return count;
+}
+
+void BenchFindText(const std::string &corpus, uint32_t scale) {
+	constexpr char needle[] = "ERROR";
+	const uint32_t repeat = 8*scale;
+	uint64_t checksum = 0;
+	const auto start = PerfClock::now();
+	for (uint32_t i = 0; i < repeat; i++) {
+		checksum += CountOccurrences(corpus.c_str(), corpus.length(), needle, sizeof(needle) - 1);
+	}
+	const double seconds = SecondsSince(start);
+	Report("FindText", corpus.length(), repeat, seconds, checksum);
+}
+
+// Lexer substance: consume homogeneous runs stopping at the next delimiter or
+// escape, the hot loop behind string and comment styling (LexSkipUntil).
+uint64_t CountStops(const char *s, const char * const end, const unsigned char ch0, const unsigned char ch1) noexcept {
+	uint64_t count = 0;
+#if NP2_USE_AVX2
+	const __m256i mmCh0 = mm256_set1_epi8(ch0);
+	const __m256i mmCh1 = mm256_set1_epi8(ch1);
+	while (s + sizeof(__m256i) <= end) {
+		const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s));
+		const uint32_t mask = mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, mmCh0), _mm256_cmpeq_epi8(chunk, mmCh1)));
+		count += np2::popcount(mask);
+		s += sizeof(__m256i);
+	}
+	// end NP2_USE_AVX2
+#elif NP2_USE_SSE2
+	const __m128i mmCh0 = _mm_set1_epi8(ch0);
+	const __m128i mmCh1 = _mm_set1_epi8(ch1);
+	while (s + sizeof(__m128i) <= end) {
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s));
+		const uint32_t mask = mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, mmCh0), _mm_cmpeq_epi8(chunk, mmCh1)));
+		count += np2::popcount(mask);
+		s += sizeof(__m128i);
+	}
+	// end NP2_USE_SSE2
+#endif
+	while (s < end) {
+		const unsigned char ch = *s++;
+		count += (ch == ch0 || ch == ch1);
+	}
+	return count;
+}
+
+void BenchStyleScan(const std::string &corpus, uint32_t scale) {
+	const uint32_t repeat = 8*scale;
+	uint64_t checksum = 0;
+	const auto start = PerfClock::now();
+	for (uint32_t i = 0; i < repeat; i++) {
+		checksum += CountStops(corpus.c_str(), corpus.c_str() + corpus.length(), '\"', '\\');
+	}
+	const double seconds = SecondsSince(start);
+	Report("StyleScan", corpus.length(), repeat, seconds, checksum);
+}
+
+// Keyword classification, the other hot loop of lexing identifiers.
+void BenchWordList(uint32_t scale) {
+	static const char * const tokens[16] = {
+		"if", "index", "return", "result", "while", "widget", "static", "status",
+		"const", "count", "double", "dispatch", "switch", "symbol", "template", "token",
+	};
+
+	WordList wordList;
+	(void)wordList.Set("alignas alignof asm auto bool break case catch char class const constexpr"
+		" continue decltype default delete do double dynamic_cast else enum explicit export extern"
+		" false float for friend goto if inline int long mutable namespace new noexcept nullptr"
+		" operator private protected public register reinterpret_cast return short signed sizeof"
+		" static static_assert static_cast struct switch template this thread_local throw true try"
+		" typedef typeid typename union unsigned using virtual void volatile wchar_t while");
+
+	constexpr uint32_t lookupCount = 1000000;
+	PCG32Random random(UINT64_C(0x9e3779b97f4a7c15), UINT64_C(0x2545f4914f6cdd1d));
+	uint64_t bytes = 0;
+	uint64_t checksum = 0;
+	const auto start = PerfClock::now();
+	for (uint32_t repeat = 0; repeat < scale; repeat++) {
+		for (uint32_t i = 0; i < lookupCount; i++) {
+			const char * const token = tokens[random.Next() & 15];
+			bytes += strlen(token);
+			checksum += wordList.InList(token);
+		}
+	}
+	const double seconds = SecondsSince(start);
+	Report("WordListInList", bytes/scale, scale, seconds, checksum);
+}
+
+}
+
+int main(int argc, char *argv[]) {
+	// scale multiplies the repeat counts for more stable numbers on fast machines.
+	const uint32_t scale = (argc > 1) ? max(1, atoi(argv[1])) : 1;
+	constexpr size_t corpusSize = 16*1024*1024;
+	const std::string logCorpus = BuildLogCorpus(corpusSize);
+	const std::string jsonCorpus = BuildJsonCorpus(corpusSize);
+
+	printf("benchmark,bytes,repeat,seconds,MB/s,checksum\n");
+	BenchGapBuffer(scale);
+	BenchFindText(logCorpus, scale);
+	BenchStyleScan(jsonCorpus, scale);
+	BenchWordList(scale);
+	return 0;
+}
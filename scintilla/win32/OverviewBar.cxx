@@ -0,0 +1,576 @@
+// Scintilla source code edit control
+/** @file OverviewBar.cxx
+ ** Overview strip ("minimap") child window rendered from style runs and change history.
+ **/
+// This file is part of Notepad4.
+// See License.txt for details about distribution and modification.
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstdint>
+#include <cassert>
+#include <cstring>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <algorithm>
+#include <memory>
+#include <atomic>
+
+struct IUnknown;
+#include <windows.h>
+#include <windowsx.h>
+
+#include "ParallelSupport.h"
+#include "ScintillaTypes.h"
+#include "ScintillaMessages.h"
+#include "ILoader.h"
+#include "ILexer.h"
+
+#include "Debugging.h"
+#include "Geometry.h"
+#include "Platform.h"
+
+#include "Position.h"
+#include "UniqueString.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "RunStyles.h"
+#include "CellBuffer.h"
+#include "CharClassify.h"
+#include "Decoration.h"
+#include "CaseFolder.h"
+#include "Document.h"
+
+#include "WinTypes.h"
+#include "PlatWin.h"
+#include "OverviewBar.h"
+
+using namespace Scintilla;
+using namespace Scintilla::Internal;
+
+namespace {
+
+const WCHAR *overviewBarClassName = L"OverviewBar";
+HINSTANCE hinstOverviewBar;
+
+// worker thread finished rasterizing a frame
+constexpr UINT OVB_RENDERED = WM_APP;
+// coalesce modification and styling notifications before rebuilding
+constexpr UINT_PTR rebuildTimerID = 1;
+constexpr UINT rebuildDelay = 50;
+// the strip maps this many columns onto its full width
+constexpr int columnsMapped = 120;
+// width of the change mark column on the left edge
+constexpr int changeMarkWidth = 3;
+
+constexpr int styleDefault = static_cast<int>(StylesCommon::Default);
+constexpr int styleMax = static_cast<int>(StylesCommon::Max);
+
+// Per-line digest of the style runs and change history, cheap enough to keep
+// for every line of a giant file and to recompute for modified lines only.
+struct LineSummary {
+	uint16_t indent;	// leading blanks in columns, capped
+	uint16_t length;	// line length in characters, capped
+	uint8_t style;		// style of the first non-blank character
+	uint8_t editions;	// low nibble: highest insertion edition; bit 4: deletion mark
+};
+
+// Everything the rasterizer reads or writes, copied so the worker never
+// touches the document or the window while the GUI thread mutates them.
+struct RenderFrame {
+	HWND hwnd;
+	int width;
+	int height;
+	uint32_t backColour;
+	uint32_t palette[styleMax + 1];
+	uint32_t editionColour[5];
+	std::vector<LineSummary> lines;
+	std::vector<uint32_t> pixels;
+#if USE_WIN32_PTP_WORK
+	PTP_WORK work = nullptr;
+#else
+	HANDLE finishedEvent = nullptr;
+#endif
+
+	void Run() noexcept;
+	bool Submit() noexcept;
+	void Wait() noexcept;
+
+#if USE_WIN32_PTP_WORK
+	static VOID CALLBACK WorkCallback([[maybe_unused]] PTP_CALLBACK_INSTANCE callback, PVOID context, [[maybe_unused]] PTP_WORK work_) {
+		static_cast<RenderFrame *>(context)->Run();
+	}
+#else
+	static DWORD WINAPI ThreadProc(LPVOID lpParameter) {
+		RenderFrame * const frame = static_cast<RenderFrame *>(lpParameter);
+		frame->Run();
+		SetEvent(frame->finishedEvent);
+		return 0;
+	}
+#endif
+};
+
+void RenderFrame::Run() noexcept {
+	const Sci::Line lineCount = std::max<Sci::Line>(static_cast<Sci::Line>(lines.size()), 1);
+	std::fill(pixels.begin(), pixels.end(), backColour);
+	for (Sci::Line line = 0; line < static_cast<Sci::Line>(lines.size()); line++) {
+		const LineSummary &summary = lines[line];
+		const int y0 = static_cast<int>(line * height / lineCount);
+		const int y1 = std::max(y0 + 1, static_cast<int>((line + 1) * height / lineCount));
+		if (summary.length != 0) {
+			const int x0 = std::min(width - 1, changeMarkWidth + summary.indent * width / columnsMapped);
+			const int x1 = std::min(width, std::max(x0 + 1, changeMarkWidth + (summary.indent + summary.length) * width / columnsMapped));
+			const uint32_t colour = palette[summary.style];
+			for (int y = y0; y < std::min(y1, height); y++) {
+				std::fill_n(pixels.begin() + static_cast<ptrdiff_t>(y) * width + x0, x1 - x0, colour);
+			}
+		}
+		if (summary.editions != 0) {
+			// insertion edition wins over a bare deletion mark
+			const unsigned int edition = (summary.editions & 0x0f) ? (summary.editions & 0x0f) : 4;
+			const uint32_t colour = editionColour[std::min(edition, 4U)];
+			for (int y = y0; y < std::min(y1, height); y++) {
+				std::fill_n(pixels.begin() + static_cast<ptrdiff_t>(y) * width, changeMarkWidth, colour);
+			}
+		}
+	}
+	PostMessage(hwnd, OVB_RENDERED, 0, 0);
+}
+
+bool RenderFrame::Submit() noexcept {
+#if USE_WIN32_PTP_WORK
+	work = CreateThreadpoolWork(WorkCallback, this, nullptr);
+	if (work) {
+		SubmitThreadpoolWork(work);
+	}
+	return work != nullptr;
+#else
+	finishedEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+	if (finishedEvent && !QueueUserWorkItem(ThreadProc, this, WT_EXECUTEDEFAULT)) {
+		CloseHandle(finishedEvent);
+		finishedEvent = nullptr;
+	}
+	return finishedEvent != nullptr;
+#endif
+}
+
+void RenderFrame::Wait() noexcept {
+#if USE_WIN32_PTP_WORK
+	if (work) {
+		WaitForThreadpoolWorkCallbacks(work, FALSE);
+		CloseThreadpoolWork(work);
+		work = nullptr;
+	}
+#else
+	if (finishedEvent) {
+		WaitForSingleObject(finishedEvent, INFINITE);
+		CloseHandle(finishedEvent);
+		finishedEvent = nullptr;
+	}
+#endif
+}
+
+constexpr uint32_t PixelFromColourRef(COLORREF colour) noexcept {
+	// COLORREF is 0x00BBGGRR, a top-down 32 bit DIB pixel is 0x00RRGGBB
+	return (GetRValue(colour) << 16) | (GetGValue(colour) << 8) | GetBValue(colour);
+}
+
+class OverviewBar final : public DocWatcher {
+	HWND hwnd;
+	HWND hwndSci;
+	Document *pdoc = nullptr;
+	std::vector<LineSummary> summaries;
+	Sci::Line dirtyFirst = 0;
+	Sci::Line dirtyLast = 0;
+	bool dirty = false;
+	bool rendering = false;
+	bool framePending = false;
+	std::unique_ptr<RenderFrame> frame;
+	// cached rasterized bitmap blitted in WM_PAINT
+	HBITMAP bitmap = nullptr;
+	int bitmapWidth = 0;
+	int bitmapHeight = 0;
+
+	sptr_t SciMessage(Message iMessage, uptr_t wParam = 0, sptr_t lParam = 0) const noexcept {
+		return SendMessage(hwndSci, static_cast<UINT>(iMessage), wParam, lParam);
+	}
+
+	void AttachDocument();
+	void DetachDocument() noexcept;
+	void MarkDirty(Sci::Line first, Sci::Line last) noexcept;
+	void Schedule() noexcept;
+	LineSummary Summarize(Sci::Line line) const noexcept;
+	void Rebuild();
+	void Render();
+	void OnRendered();
+	void Paint();
+	void ScrollTo(int y) noexcept;
+
+public:
+	OverviewBar(HWND hwnd_, HWND hwndSci_) : hwnd(hwnd_), hwndSci(hwndSci_) {
+		AttachDocument();
+	}
+	// Deleted so OverviewBar objects can not be copied.
+	OverviewBar(const OverviewBar &) = delete;
+	OverviewBar(OverviewBar &&) = delete;
+	OverviewBar &operator=(const OverviewBar &) = delete;
+	OverviewBar &operator=(OverviewBar &&) = delete;
+	~OverviewBar() override {
+		if (frame) {
+			frame->Wait();
+		}
+		DetachDocument();
+		if (bitmap) {
+			DeleteObject(bitmap);
+		}
+	}
+
+	LRESULT WndProc(UINT iMessage, WPARAM wParam, LPARAM lParam);
+
+	// DocWatcher
+	void NotifyModifyAttempt([[maybe_unused]] Document *doc, [[maybe_unused]] void *userData) noexcept override {}
+	void NotifySavePoint([[maybe_unused]] Document *doc, [[maybe_unused]] void *userData, [[maybe_unused]] bool atSavePoint) noexcept override {
+		// saving or undoing across the save point recolours the whole change history
+		if (pdoc) {
+			MarkDirty(0, pdoc->LinesTotal() - 1);
+			Schedule();
+		}
+	}
+	void NotifyModified(Document *doc, DocModification mh, void *userData) override;
+	void NotifyDeleted(Document *doc, [[maybe_unused]] void *userData) noexcept override {
+		if (doc == pdoc) {
+			pdoc = nullptr;
+			summaries.clear();
+		}
+	}
+	void NotifyStyleNeeded([[maybe_unused]] Document *doc, [[maybe_unused]] void *userData, [[maybe_unused]] Sci::Position endPos) override {}
+	void NotifyErrorOccurred([[maybe_unused]] Document *doc, [[maybe_unused]] void *userData, [[maybe_unused]] Status status) noexcept override {}
+};
+
+void OverviewBar::AttachDocument() {
+	Document * const doc = reinterpret_cast<Document *>(SciMessage(Message::GetDocPointer));
+	if (doc == pdoc) {
+		return;
+	}
+	DetachDocument();
+	pdoc = doc;
+	if (pdoc) {
+		pdoc->AddWatcher(this, nullptr);
+		summaries.resize(pdoc->LinesTotal());
+		MarkDirty(0, pdoc->LinesTotal() - 1);
+	}
+}
+
+void OverviewBar::DetachDocument() noexcept {
+	if (pdoc) {
+		pdoc->RemoveWatcher(this, nullptr);
+		pdoc = nullptr;
+	}
+	summaries.clear();
+}
+
+void OverviewBar::MarkDirty(Sci::Line first, Sci::Line last) noexcept {
+	if (dirty) {
+		dirtyFirst = std::min(dirtyFirst, first);
+		dirtyLast = std::max(dirtyLast, last);
+	} else {
+		dirty = true;
+		dirtyFirst = first;
+		dirtyLast = last;
+	}
+}
+
+void OverviewBar::Schedule() noexcept {
+	SetTimer(hwnd, rebuildTimerID, rebuildDelay, nullptr);
+}
+
+void OverviewBar::NotifyModified([[maybe_unused]] Document *doc, DocModification mh, [[maybe_unused]] void *userData) {
+	if (FlagSet(mh.modificationType, ModificationFlags::InsertText | ModificationFlags::DeleteText)) {
+		const Sci::Line line = pdoc->SciLineFromPosition(mh.position);
+		if (mh.linesAdded > 0) {
+			summaries.insert(summaries.begin() + std::min<Sci::Line>(line + 1, static_cast<Sci::Line>(summaries.size())), mh.linesAdded, LineSummary());
+		} else if (mh.linesAdded < 0 && !summaries.empty()) {
+			const Sci::Line first = std::min<Sci::Line>(line + 1, static_cast<Sci::Line>(summaries.size()));
+			const Sci::Line last = std::min<Sci::Line>(first - mh.linesAdded, static_cast<Sci::Line>(summaries.size()));
+			summaries.erase(summaries.begin() + first, summaries.begin() + last);
+		}
+		MarkDirty(line, line + std::max<Sci::Line>(mh.linesAdded, 0));
+		Schedule();
+	} else if (FlagSet(mh.modificationType, ModificationFlags::ChangeStyle)) {
+		// the strip is rendered from style runs, so recolouring is a real change
+		MarkDirty(pdoc->SciLineFromPosition(mh.position), pdoc->SciLineFromPosition(mh.position + mh.length));
+		Schedule();
+	}
+}
+
+LineSummary OverviewBar::Summarize(Sci::Line line) const noexcept {
+	LineSummary summary{};
+	const Sci::Position start = pdoc->LineStart(line);
+	const Sci::Position end = pdoc->LineEnd(line);
+	Sci::Position pos = start;
+	unsigned int indent = 0;
+	while (pos < end) {
+		const char ch = pdoc->CharAt(pos);
+		if (ch == ' ') {
+			indent++;
+		} else if (ch == '\t') {
+			indent = indent - indent % pdoc->tabInChars + pdoc->tabInChars;
+		} else {
+			break;
+		}
+		pos++;
+	}
+	if (pos < end) {
+		summary.style = pdoc->StyleIndexAt(pos);
+		summary.indent = static_cast<uint16_t>(std::min(indent, static_cast<unsigned int>(columnsMapped)));
+		summary.length = static_cast<uint16_t>(std::min<Sci::Position>(end - pos, columnsMapped));
+	}
+
+	unsigned int edition = 0;
+	Sci::Position runPos = start;
+	while (runPos < end) {
+		edition = std::max(edition, static_cast<unsigned int>(pdoc->EditionAt(runPos)));
+		runPos = pdoc->EditionEndRun(runPos);
+	}
+	const bool deleted = pdoc->EditionDeletesAt(start) != 0 || pdoc->EditionNextDelete(start) <= end;
+	summary.editions = static_cast<uint8_t>(std::min(edition, 4U) | (deleted ? 0x10 : 0));
+	return summary;
+}
+
+void OverviewBar::Rebuild() {
+	AttachDocument();
+	if (!pdoc) {
+		return;
+	}
+	const Sci::Line lineCount = pdoc->LinesTotal();
+	if (static_cast<Sci::Line>(summaries.size()) != lineCount) {
+		// lost a notification somewhere; resync the whole strip
+		summaries.resize(lineCount);
+		MarkDirty(0, lineCount - 1);
+	}
+	if (dirty) {
+		const Sci::Line first = std::clamp<Sci::Line>(dirtyFirst, 0, lineCount - 1);
+		const Sci::Line last = std::clamp<Sci::Line>(dirtyLast, first, lineCount - 1);
+		for (Sci::Line line = first; line <= last; line++) {
+			summaries[line] = Summarize(line);
+		}
+		dirty = false;
+	}
+	Render();
+}
+
+void OverviewBar::Render() {
+	if (rendering) {
+		framePending = true;
+		return;
+	}
+	RECT rc;
+	GetClientRect(hwnd, &rc);
+	const int width = rc.right - rc.left;
+	const int height = rc.bottom - rc.top;
+	if (width <= changeMarkWidth || height <= 0 || summaries.empty()) {
+		return;
+	}
+	if (!frame) {
+		frame = std::make_unique<RenderFrame>();
+	}
+	frame->hwnd = hwnd;
+	frame->width = width;
+	frame->height = height;
+	frame->backColour = PixelFromColourRef(static_cast<COLORREF>(SciMessage(Message::StyleGetBack, styleDefault)));
+	for (int style = 0; style <= styleMax; style++) {
+		frame->palette[style] = PixelFromColourRef(static_cast<COLORREF>(SciMessage(Message::StyleGetFore, style)));
+	}
+	// change history: reverted to origin, saved, modified, reverted to change;
+	// same defaults as the edition indicators in ViewStyle.cxx
+	frame->editionColour[0] = frame->backColour;
+	frame->editionColour[1] = PixelFromColourRef(RGB(0x40, 0xA0, 0xBF));
+	frame->editionColour[2] = PixelFromColourRef(RGB(0x00, 0xA0, 0x00));
+	frame->editionColour[3] = PixelFromColourRef(RGB(0xFF, 0x80, 0x00));
+	frame->editionColour[4] = PixelFromColourRef(RGB(0xA0, 0xC0, 0x00));
+	frame->lines = summaries;
+	frame->pixels.resize(static_cast<size_t>(width) * height);
+	rendering = true;
+	if (!frame->Submit()) {
+		// no worker available: rasterize synchronously, completion message is already posted
+		frame->Run();
+	}
+}
+
+void OverviewBar::OnRendered() {
+	if (!rendering) {
+		return;
+	}
+	frame->Wait();
+	rendering = false;
+	if (bitmap == nullptr || bitmapWidth != frame->width || bitmapHeight != frame->height) {
+		if (bitmap) {
+			DeleteObject(bitmap);
+			bitmap = nullptr;
+		}
+		bitmapWidth = frame->width;
+		bitmapHeight = frame->height;
+		BITMAPINFOHEADER bpih = { sizeof(BITMAPINFOHEADER), bitmapWidth, -bitmapHeight, 1, 32, BI_RGB, 0, 0, 0, 0, 0 };
+		HDC hdc = GetDC(hwnd);
+		bitmap = CreateDIBSection(hdc, reinterpret_cast<BITMAPINFO *>(&bpih), DIB_RGB_COLORS, nullptr, nullptr, 0);
+		ReleaseDC(hwnd, hdc);
+	}
+	if (bitmap) {
+		BITMAPINFOHEADER bpih = { sizeof(BITMAPINFOHEADER), bitmapWidth, -bitmapHeight, 1, 32, BI_RGB, 0, 0, 0, 0, 0 };
+		SetDIBits(nullptr, bitmap, 0, bitmapHeight, frame->pixels.data(),
+			reinterpret_cast<BITMAPINFO *>(&bpih), DIB_RGB_COLORS);
+		InvalidateRect(hwnd, nullptr, FALSE);
+	}
+	if (framePending) {
+		framePending = false;
+		Render();
+	}
+}
+
+void OverviewBar::Paint() {
+	PAINTSTRUCT ps;
+	HDC hdc = BeginPaint(hwnd, &ps);
+	RECT rc;
+	GetClientRect(hwnd, &rc);
+	if (bitmap) {
+		HDC hMemDC = CreateCompatibleDC(hdc);
+		HGDIOBJ prev = SelectObject(hMemDC, bitmap);
+		BitBlt(hdc, 0, 0, bitmapWidth, bitmapHeight, hMemDC, 0, 0, SRCCOPY);
+		SelectObject(hMemDC, prev);
+		DeleteDC(hMemDC);
+	} else {
+		FillRect(hdc, &rc, GetSysColorBrush(COLOR_WINDOW));
+	}
+	// frame the lines currently on screen so the strip reads as a scrollbar
+	const Sci::Line lineCount = std::max<Sci::Line>(static_cast<Sci::Line>(summaries.size()), 1);
+	const Sci::Line firstVisible = SciMessage(Message::DocLineFromVisible, SciMessage(Message::GetFirstVisibleLine));
+	const Sci::Line lastVisible = SciMessage(Message::DocLineFromVisible,
+		SciMessage(Message::GetFirstVisibleLine) + SciMessage(Message::LinesOnScreen));
+	const int height = rc.bottom - rc.top;
+	RECT rcVisible = rc;
+	rcVisible.top = static_cast<LONG>(std::min<Sci::Line>(firstVisible, lineCount) * height / lineCount);
+	rcVisible.bottom = static_cast<LONG>(std::min<Sci::Line>(lastVisible + 1, lineCount) * height / lineCount);
+	rcVisible.bottom = std::max(rcVisible.bottom, rcVisible.top + 2);
+	HBRUSH brush = GetSysColorBrush(COLOR_HIGHLIGHT);
+	FrameRect(hdc, &rcVisible, brush);
+	InflateRect(&rcVisible, -1, -1);
+	FrameRect(hdc, &rcVisible, brush);
+	EndPaint(hwnd, &ps);
+}
+
+void OverviewBar::ScrollTo(int y) noexcept {
+	const Sci::Line lineCount = std::max<Sci::Line>(static_cast<Sci::Line>(summaries.size()), 1);
+	RECT rc;
+	GetClientRect(hwnd, &rc);
+	const int height = std::max<int>(rc.bottom - rc.top, 1);
+	const Sci::Line line = std::clamp<Sci::Line>(static_cast<Sci::Line>(y) * lineCount / height, 0, lineCount - 1);
+	const Sci::Line visible = SciMessage(Message::VisibleFromDocLine, line);
+	SciMessage(Message::SetFirstVisibleLine, std::max<Sci::Line>(visible - SciMessage(Message::LinesOnScreen) / 2, 0));
+}
+
+LRESULT OverviewBar::WndProc(UINT iMessage, WPARAM wParam, LPARAM lParam) {
+	switch (iMessage) {
+	case WM_SIZE:
+		Schedule();
+		return 0;
+
+	case WM_TIMER:
+		if (wParam == rebuildTimerID) {
+			KillTimer(hwnd, rebuildTimerID);
+			Rebuild();
+			return 0;
+		}
+		break;
+
+	case OVB_RENDERED:
+		OnRendered();
+		return 0;
+
+	case WM_PAINT:
+		Paint();
+		return 0;
+
+	case WM_ERASEBKGND:
+		return 1;
+
+	case WM_LBUTTONDOWN:
+		SetCapture(hwnd);
+		ScrollTo(GET_Y_LPARAM(lParam));
+		InvalidateRect(hwnd, nullptr, FALSE);
+		return 0;
+
+	case WM_MOUSEMOVE:
+		if (wParam & MK_LBUTTON) {
+			ScrollTo(GET_Y_LPARAM(lParam));
+			InvalidateRect(hwnd, nullptr, FALSE);
+		}
+		return 0;
+
+	case WM_LBUTTONUP:
+		ReleaseCapture();
+		return 0;
+
+	case WM_MOUSEWHEEL:
+		// scroll the view, not the strip
+		return SendMessage(hwndSci, iMessage, wParam, lParam);
+
+	default:
+		break;
+	}
+	return DefWindowProc(hwnd, iMessage, wParam, lParam);
+}
+
+LRESULT CALLBACK OverviewBarWndProc(HWND hWnd, UINT iMessage, WPARAM wParam, LPARAM lParam) {
+	OverviewBar *bar = PointerFromWindow<OverviewBar *>(hWnd);
+	if (bar == nullptr) {
+		if (iMessage == WM_CREATE) {
+			const CREATESTRUCT * const pCreate = reinterpret_cast<CREATESTRUCT *>(lParam);
+			try {
+				bar = new OverviewBar(hWnd, static_cast<HWND>(pCreate->lpCreateParams));
+				SetWindowPointer(hWnd, bar);
+				return 0;
+			} catch (...) {
+				return -1;
+			}
+		}
+		return DefWindowProc(hWnd, iMessage, wParam, lParam);
+	}
+	if (iMessage == WM_NCDESTROY) {
+		delete bar;
+		SetWindowPointer(hWnd, nullptr);
+		return DefWindowProc(hWnd, iMessage, wParam, lParam);
+	}
+	try {
+		return bar->WndProc(iMessage, wParam, lParam);
+	} catch (...) {
+		return DefWindowProc(hWnd, iMessage, wParam, lParam);
+	}
+}
+
+}
+
+namespace Scintilla::Internal {
+
+bool OverviewBarRegister(HINSTANCE hInstance) noexcept {
+	hinstOverviewBar = hInstance;
+	WNDCLASSEX wndclass {};
+	wndclass.cbSize = sizeof(wndclass);
+	wndclass.lpfnWndProc = OverviewBarWndProc;
+	wndclass.cbWndExtra = sizeof(OverviewBar *);
+	wndclass.hInstance = hInstance;
+	wndclass.hCursor = LoadCursor(nullptr, IDC_ARROW);
+	wndclass.lpszClassName = overviewBarClassName;
+	return RegisterClassEx(&wndclass) != 0;
+}
+
+void OverviewBarUnregister() noexcept {
+	if (hinstOverviewBar) {
+		UnregisterClass(overviewBarClassName, hinstOverviewBar);
+		hinstOverviewBar = nullptr;
+	}
+}
+
+}
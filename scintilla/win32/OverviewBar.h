@@ -0,0 +1,20 @@
+// Scintilla source code edit control
+/** @file OverviewBar.h
+ ** Overview strip ("minimap") child window rendered from style runs and change history.
+ **/
+// This file is part of Notepad4.
+// See License.txt for details about distribution and modification.
+#pragma once
+
+namespace Scintilla::Internal {
+
+// The overview bar is a "OverviewBar" class child window the container creates
+// next to a Scintilla window, passing the Scintilla HWND as lpCreateParams.
+// It paints a miniature of the whole document built from per-line style run
+// summaries and ChangeHistory editions - no text layout - rasterized on a
+// background thread into a bitmap which is updated for modified ranges only,
+// and scrolls the attached view when clicked or dragged.
+bool OverviewBarRegister(HINSTANCE hInstance) noexcept;
+void OverviewBarUnregister() noexcept;
+
+}
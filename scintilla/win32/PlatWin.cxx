@@ -47,6 +47,7 @@ struct IUnknown;
 #include "CharClassify.h"
 #include "UniConversion.h"
 
+#include "ParallelSupport.h"
 #include "WinTypes.h"
 #include "PlatWin.h"
 
@@ -364,6 +365,119 @@ bool GetDWriteFontProperties(const LOGFONTW &lf, std::wstring &wsFamily,
 	return success;
 }
 
+// Persisted font realization cache. Resolving a LOGFONT to a DirectWrite
+// family and measuring line metrics through a throwaway text layout dominate
+// the cost of realising the static style set at startup, and their results
+// only change when fonts or DirectWrite itself change, so the container can
+// persist them across runs; entries are keyed by a hash of the requested
+// font (the size already reflects DPI and zoom) and the whole cache is
+// validated against the identity of dwrite.dll.
+
+struct FontMetricsCacheEntry {
+	UINT64 key;
+	FLOAT yAscent;
+	FLOAT yDescent;
+	FLOAT yInternalLeading;
+	FLOAT lineHeight;
+	FLOAT lineBaseline;
+	UINT32 weight;
+	UINT32 style;
+	UINT32 stretch;
+	WCHAR wsFamily[64];
+};
+
+struct FontMetricsCacheHeader {
+	UINT32 magic;
+	UINT32 count;
+	UINT64 identity;
+};
+
+constexpr UINT32 FontMetricsCacheMagic = 0x304D4634; // "4FM0": format version 0
+constexpr UINT32 FontMetricsCacheMaxCount = 1024;
+
+std::vector<FontMetricsCacheEntry> fontMetricsCache;
+bool fontMetricsCacheDirty = false;
+
+UINT64 FontMetricsCacheKey(const LOGFONTW &lf, FLOAT size, FontStretch fontStretch, const char *localeName) noexcept {
+	UINT64 hash = UINT64_C(0xcbf29ce484222325);
+	const auto fold = [&hash](const void *data, size_t length) noexcept {
+		const unsigned char *bytes = static_cast<const unsigned char *>(data);
+		for (size_t i = 0; i < length; i++) {
+			hash = (hash ^ bytes[i]) * UINT64_C(0x100000001b3);
+		}
+	};
+	fold(lf.lfFaceName, wcslen(lf.lfFaceName) * sizeof(WCHAR));
+	fold(&size, sizeof(size));
+	fold(&lf.lfWeight, sizeof(lf.lfWeight));
+	fold(&lf.lfItalic, sizeof(lf.lfItalic));
+	fold(&lf.lfCharSet, sizeof(lf.lfCharSet));
+	fold(&fontStretch, sizeof(fontStretch));
+	fold(localeName, strlen(localeName));
+	return hash;
+}
+
+const FontMetricsCacheEntry *FontMetricsCacheFind(UINT64 key) noexcept {
+	for (const FontMetricsCacheEntry &entry : fontMetricsCache) {
+		if (entry.key == key) {
+			return &entry;
+		}
+	}
+	return nullptr;
+}
+
+// size and timestamp of dwrite.dll: a DirectWrite update invalidates the cache
+UINT64 DirectWriteIdentity() noexcept {
+	WCHAR path[MAX_PATH];
+	const UINT len = ::GetSystemDirectoryW(path, MAX_PATH - 12);
+	if (len == 0 || len > MAX_PATH - 12) {
+		return 0;
+	}
+	memcpy(path + len, L"\\dwrite.dll", sizeof(L"\\dwrite.dll"));
+	WIN32_FILE_ATTRIBUTE_DATA data {};
+	if (!::GetFileAttributesExW(path, GetFileExInfoStandard, &data)) {
+		return 0;
+	}
+	const UINT64 size = (static_cast<UINT64>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+	const UINT64 written = (static_cast<UINT64>(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime;
+	return size ^ written;
+}
+
+}
+
+void Scintilla_LoadFontMetricsCache(const wchar_t *path) {
+	HANDLE file = ::CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return;
+	}
+	FontMetricsCacheHeader header {};
+	DWORD bytesRead = 0;
+	if (::ReadFile(file, &header, sizeof(header), &bytesRead, nullptr) && bytesRead == sizeof(header)
+		&& header.magic == FontMetricsCacheMagic && header.identity == DirectWriteIdentity()
+		&& header.count != 0 && header.count <= FontMetricsCacheMaxCount) {
+		std::vector<FontMetricsCacheEntry> entries(header.count);
+		const DWORD cbData = header.count * sizeof(FontMetricsCacheEntry);
+		if (::ReadFile(file, entries.data(), cbData, &bytesRead, nullptr) && bytesRead == cbData) {
+			fontMetricsCache = std::move(entries);
+		}
+	}
+	::CloseHandle(file);
+}
+
+void Scintilla_SaveFontMetricsCache(const wchar_t *path) {
+	if (!fontMetricsCacheDirty || fontMetricsCache.empty()) {
+		return;
+	}
+	HANDLE file = ::CreateFileW(path, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return;
+	}
+	const UINT32 count = static_cast<UINT32>(std::min<size_t>(fontMetricsCache.size(), FontMetricsCacheMaxCount));
+	const FontMetricsCacheHeader header = { FontMetricsCacheMagic, count, DirectWriteIdentity() };
+	DWORD bytesWritten = 0;
+	::WriteFile(file, &header, sizeof(header), &bytesWritten, nullptr);
+	::WriteFile(file, fontMetricsCache.data(), count * sizeof(FontMetricsCacheEntry), &bytesWritten, nullptr);
+	::CloseHandle(file);
+	fontMetricsCacheDirty = false;
 }
 
 std::shared_ptr<Font> Font::Allocate(const FontParameters &fp) {
@@ -383,12 +497,19 @@ std::shared_ptr<Font> Font::Allocate(const FontParameters &fp) {
 		DWRITE_FONT_WEIGHT weight = static_cast<DWRITE_FONT_WEIGHT>(fp.weight);
 		DWRITE_FONT_STYLE style = fp.italic ? DWRITE_FONT_STYLE_ITALIC : DWRITE_FONT_STYLE_NORMAL;
 		DWRITE_FONT_STRETCH stretch = static_cast<DWRITE_FONT_STRETCH>(fp.stretch);
-		if (!GetDWriteFontProperties(lf, wsFamily, weight, style, stretch)) {
+		const FLOAT fHeight = static_cast<FLOAT>(fp.size);
+		const UINT64 cacheKey = FontMetricsCacheKey(lf, fHeight, fp.stretch, fp.localeName);
+		const FontMetricsCacheEntry * const cached = FontMetricsCacheFind(cacheKey);
+		if (cached) {
+			wsFamily = cached->wsFamily;
+			weight = static_cast<DWRITE_FONT_WEIGHT>(cached->weight);
+			style = static_cast<DWRITE_FONT_STYLE>(cached->style);
+			stretch = static_cast<DWRITE_FONT_STRETCH>(cached->stretch);
+		} else if (!GetDWriteFontProperties(lf, wsFamily, weight, style, stretch)) {
 			wsFamily = WStringFromUTF8(fp.faceName);
 		}
 
 		const std::wstring wsLocale = WStringFromUTF8(fp.localeName);
-		const FLOAT fHeight = static_cast<FLOAT>(fp.size);
 		IDWriteTextFormat *pTextFormat = nullptr;
 		HRESULT hr = pIDWriteFactory->CreateTextFormat(wsFamily.c_str(), nullptr,
 			weight, style, stretch, fHeight, wsLocale.c_str(), &pTextFormat);
@@ -403,26 +524,49 @@ std::shared_ptr<Font> Font::Allocate(const FontParameters &fp) {
 			FLOAT yAscent = 2.0f;
 			FLOAT yDescent = 1.0f;
 			FLOAT yInternalLeading = 0.0f;
-			IDWriteTextLayout *pTextLayout = nullptr;
-			hr = pIDWriteFactory->CreateTextLayout(L"X", 1, pTextFormat,
-				100.0f, 100.0f, &pTextLayout);
-			if (SUCCEEDED(hr) && pTextLayout) {
-				constexpr int maxLines = 2;
-				DWRITE_LINE_METRICS lineMetrics[maxLines]{};
-				UINT32 lineCount = 0;
-				hr = pTextLayout->GetLineMetrics(lineMetrics, maxLines, &lineCount);
-				if (SUCCEEDED(hr)) {
-					yAscent = lineMetrics[0].baseline;
-					yDescent = lineMetrics[0].height - lineMetrics[0].baseline;
-
-					FLOAT emHeight;
-					hr = pTextLayout->GetFontSize(0, &emHeight);
+			if (cached) {
+				yAscent = cached->yAscent;
+				yDescent = cached->yDescent;
+				yInternalLeading = cached->yInternalLeading;
+				pTextFormat->SetLineSpacing(DWRITE_LINE_SPACING_METHOD_UNIFORM, cached->lineHeight, cached->lineBaseline);
+			} else {
+				IDWriteTextLayout *pTextLayout = nullptr;
+				hr = pIDWriteFactory->CreateTextLayout(L"X", 1, pTextFormat,
+					100.0f, 100.0f, &pTextLayout);
+				if (SUCCEEDED(hr) && pTextLayout) {
+					constexpr int maxLines = 2;
+					DWRITE_LINE_METRICS lineMetrics[maxLines]{};
+					UINT32 lineCount = 0;
+					hr = pTextLayout->GetLineMetrics(lineMetrics, maxLines, &lineCount);
 					if (SUCCEEDED(hr)) {
-						yInternalLeading = lineMetrics[0].height - emHeight;
+						yAscent = lineMetrics[0].baseline;
+						yDescent = lineMetrics[0].height - lineMetrics[0].baseline;
+
+						FLOAT emHeight;
+						hr = pTextLayout->GetFontSize(0, &emHeight);
+						if (SUCCEEDED(hr)) {
+							yInternalLeading = lineMetrics[0].height - emHeight;
+						}
+					}
+					ReleaseUnknown(pTextLayout);
+					pTextFormat->SetLineSpacing(DWRITE_LINE_SPACING_METHOD_UNIFORM, lineMetrics[0].height, lineMetrics[0].baseline);
+					FontMetricsCacheEntry entry {};
+					if (lineCount != 0 && wsFamily.length() < std::size(entry.wsFamily)
+						&& fontMetricsCache.size() < FontMetricsCacheMaxCount) {
+						entry.key = cacheKey;
+						entry.yAscent = yAscent;
+						entry.yDescent = yDescent;
+						entry.yInternalLeading = yInternalLeading;
+						entry.lineHeight = lineMetrics[0].height;
+						entry.lineBaseline = lineMetrics[0].baseline;
+						entry.weight = weight;
+						entry.style = style;
+						entry.stretch = stretch;
+						memcpy(entry.wsFamily, wsFamily.c_str(), (wsFamily.length() + 1) * sizeof(WCHAR));
+						fontMetricsCache.push_back(entry);
+						fontMetricsCacheDirty = true;
 					}
 				}
-				ReleaseUnknown(pTextLayout);
-				pTextFormat->SetLineSpacing(DWRITE_LINE_SPACING_METHOD_UNIFORM, lineMetrics[0].height, lineMetrics[0].baseline);
 			}
 			return std::make_shared<FontDirectWrite>(lf, pTextFormat, fp.extraFontFlag, yAscent, yDescent, yInternalLeading);
 		}
@@ -623,6 +767,7 @@ public:
 	void SCICALL RectangleFrame(PRectangle rc, Stroke stroke) noexcept override;
 	void SCICALL FillRectangle(PRectangle rc, Fill fill) noexcept override;
 	void SCICALL FillRectangleAligned(PRectangle rc, Fill fill) noexcept override;
+	void FillRectangleList(const PRectangle *prcs, size_t nrcs, Fill fill) noexcept override;
 	void SCICALL FillRectangle(PRectangle rc, Surface &surfacePattern) noexcept override;
 	void SCICALL RoundedRectangle(PRectangle rc, FillStroke fillStroke) noexcept override;
 	void SCICALL AlphaRectangle(PRectangle rc, XYPOSITION cornerSize, FillStroke fillStroke) noexcept override;
@@ -851,6 +996,21 @@ void SurfaceGDI::FillRectangleAligned(PRectangle rc, Fill fill) noexcept {
 	FillRectangle(PixelAlign(rc, 1), fill);
 }
 
+void SurfaceGDI::FillRectangleList(const PRectangle *prcs, size_t nrcs, Fill fill) noexcept {
+	if (fill.colour.IsOpaque()) {
+		// one background colour selection for the whole batch.
+		::SetBkColor(hdc, fill.colour.OpaqueRGB());
+		for (size_t index = 0; index < nrcs; index++) {
+			const RECT rcw = RectFromPRectangleEx(PixelAlign(prcs[index], 1));
+			::ExtTextOut(hdc, rcw.left, rcw.top, ETO_OPAQUE, &rcw, TEXT(""), 0, nullptr);
+		}
+	} else {
+		for (size_t index = 0; index < nrcs; index++) {
+			AlphaRectangle(PixelAlign(prcs[index], 1), 0, FillStroke(fill.colour));
+		}
+	}
+}
+
 void SurfaceGDI::FillRectangle(PRectangle rc, Surface &surfacePattern) noexcept {
 	HBRUSH br;
 	if (SurfaceGDI *psgdi = down_cast<SurfaceGDI *>(&surfacePattern); psgdi && psgdi->bitmap) {
@@ -1526,6 +1686,96 @@ GeometrySink GeometrySinkCreate(ID2D1PathGeometry *geometry) noexcept {
 	return GeometrySink(sink);
 }
 
+// Cache of text layouts for short runs drawn repeatedly with the same font, such as
+// margin line numbers and styled words that recur across the view. Creating a layout
+// shapes the text, which costs far more than drawing it, so reuse removes most of the
+// DirectWrite work when repainting unchanged text. Keying on the format pointer and
+// characters alone is safe as all formats are created with DWRITE_WORD_WRAPPING_NO_WRAP,
+// making the glyphs independent of the layout box. Each entry holds a reference on its
+// format so a dead font can not alias a live entry. Shared between drawing on the UI
+// thread and measurement on the parallel layout threads, so a lock guards the table;
+// creating a layout (shaping plus fallback font resolution) dwarfs the lock cost.
+constexpr UINT maxCachedLayoutLength = 32;
+
+class TextLayoutCache {
+	struct Entry {
+		IDWriteTextFormat *pTextFormat = nullptr;
+		IDWriteTextLayout *pTextLayout = nullptr;
+		UINT length = 0;
+		wchar_t text[maxCachedLayoutLength];
+	};
+	static constexpr size_t cacheSize = 128; // direct mapped
+	Entry cache[cacheSize];
+	NativeMutex cacheLock;
+
+	static size_t Slot(const IDWriteTextFormat *pTextFormat, const wchar_t *text, UINT length) noexcept {
+		uptr_t hash = reinterpret_cast<uptr_t>(pTextFormat) >> 4;
+		for (UINT i = 0; i < length; i++) {
+			hash = hash*31 + text[i];
+		}
+		return hash & (cacheSize - 1);
+	}
+
+public:
+	// On a hit a reference is added for the caller, so found and created layouts
+	// are released the same way.
+	IDWriteTextLayout *Find(const IDWriteTextFormat *pTextFormat, const wchar_t *text, UINT length) noexcept {
+		LockGuard<NativeMutex> guard(cacheLock);
+		Entry &entry = cache[Slot(pTextFormat, text, length)];
+		if (entry.pTextFormat == pTextFormat && entry.length == length
+			&& memcmp(entry.text, text, length*sizeof(wchar_t)) == 0) {
+			entry.pTextLayout->AddRef();
+			return entry.pTextLayout;
+		}
+		return nullptr;
+	}
+
+	void Add(IDWriteTextFormat *pTextFormat, const wchar_t *text, UINT length, IDWriteTextLayout *pTextLayout) noexcept {
+		LockGuard<NativeMutex> guard(cacheLock);
+		Entry &entry = cache[Slot(pTextFormat, text, length)];
+		ReleaseUnknown(entry.pTextFormat);
+		ReleaseUnknown(entry.pTextLayout);
+		pTextFormat->AddRef();
+		pTextLayout->AddRef();
+		entry.pTextFormat = pTextFormat;
+		entry.pTextLayout = pTextLayout;
+		entry.length = length;
+		memcpy(entry.text, text, length*sizeof(wchar_t));
+	}
+
+	void Flush() noexcept {
+		LockGuard<NativeMutex> guard(cacheLock);
+		for (Entry &entry : cache) {
+			ReleaseUnknown(entry.pTextFormat);
+			ReleaseUnknown(entry.pTextLayout);
+			entry.length = 0;
+		}
+	}
+};
+
+TextLayoutCache layoutCache;
+
+// Stroke styles are device independent factory resources, so the two solid
+// styles used for drawing are created once and shared by every surface and
+// render target instead of being rebuilt for each line of each paint.
+ID2D1StrokeStyle *strokeStyleSquareCap = nullptr;
+ID2D1StrokeStyle *strokeStyleRoundCap = nullptr;
+
+ID2D1StrokeStyle *GetStrokeStyle(ID2D1StrokeStyle *&strokeStyle, D2D1_CAP_STYLE capStyle) noexcept {
+	if (strokeStyle == nullptr) {
+		D2D1_STROKE_STYLE_PROPERTIES strokeProps {};
+		strokeProps.startCap = capStyle;
+		strokeProps.endCap = capStyle;
+		strokeProps.dashCap = D2D1_CAP_STYLE_FLAT;
+		strokeProps.lineJoin = D2D1_LINE_JOIN_MITER;
+		strokeProps.miterLimit = 4.0f;
+		strokeProps.dashStyle = D2D1_DASH_STYLE_SOLID;
+		strokeProps.dashOffset = 0;
+		pD2DFactory->CreateStrokeStyle(strokeProps, nullptr, 0, &strokeStyle);
+	}
+	return strokeStyle;
+}
+
 }
 
 class BlobInline;
@@ -1583,6 +1833,7 @@ public:
 	void SCICALL RectangleFrame(PRectangle rc, Stroke stroke) override;
 	void SCICALL FillRectangle(PRectangle rc, Fill fill) override;
 	void SCICALL FillRectangleAligned(PRectangle rc, Fill fill) override;
+	void FillRectangleList(const PRectangle *prcs, size_t nrcs, Fill fill) override;
 	void SCICALL FillRectangle(PRectangle rc, Surface &surfacePattern) override;
 	void SCICALL RoundedRectangle(PRectangle rc, FillStroke fillStroke) override;
 	void SCICALL AlphaRectangle(PRectangle rc, XYPOSITION cornerSize, FillStroke fillStroke) override;
@@ -1750,26 +2001,13 @@ int SurfaceD2D::DeviceHeightFont(int points) const noexcept {
 void SurfaceD2D::LineDraw(Point start, Point end, Stroke stroke) {
 	D2DPenColourAlpha(stroke.colour);
 
-	D2D1_STROKE_STYLE_PROPERTIES strokeProps {};
-	strokeProps.startCap = D2D1_CAP_STYLE_SQUARE;
-	strokeProps.endCap = D2D1_CAP_STYLE_SQUARE;
-	strokeProps.dashCap = D2D1_CAP_STYLE_FLAT;
-	strokeProps.lineJoin = D2D1_LINE_JOIN_MITER;
-	strokeProps.miterLimit = 4.0f;
-	strokeProps.dashStyle = D2D1_DASH_STYLE_SOLID;
-	strokeProps.dashOffset = 0;
-
 	// get the stroke style to apply
-	ID2D1StrokeStyle *pStrokeStyle = nullptr;
-	const HRESULT hr = pD2DFactory->CreateStrokeStyle(
-		strokeProps, nullptr, 0, &pStrokeStyle);
-	if (SUCCEEDED(hr)) {
+	ID2D1StrokeStyle * const pStrokeStyle = GetStrokeStyle(strokeStyleSquareCap, D2D1_CAP_STYLE_SQUARE);
+	if (pStrokeStyle) {
 		pRenderTarget->DrawLine(
 			DPointFromPointEx(start),
 			DPointFromPointEx(end), pBrush, stroke.WidthF(), pStrokeStyle);
 	}
-
-	ReleaseUnknown(pStrokeStyle);
 }
 
 Geometry SurfaceD2D::GeometricFigure(const Point *pts, size_t npts, D2D1_FIGURE_BEGIN figureBegin) noexcept {
@@ -1801,23 +2039,11 @@ void SurfaceD2D::PolyLine(const Point *pts, size_t npts, Stroke stroke) {
 	}
 
 	D2DPenColourAlpha(stroke.colour);
-	D2D1_STROKE_STYLE_PROPERTIES strokeProps {};
-	strokeProps.startCap = D2D1_CAP_STYLE_ROUND;
-	strokeProps.endCap = D2D1_CAP_STYLE_ROUND;
-	strokeProps.dashCap = D2D1_CAP_STYLE_FLAT;
-	strokeProps.lineJoin = D2D1_LINE_JOIN_MITER;
-	strokeProps.miterLimit = 4.0f;
-	strokeProps.dashStyle = D2D1_DASH_STYLE_SOLID;
-	strokeProps.dashOffset = 0;
-
 	// get the stroke style to apply
-	ID2D1StrokeStyle *pStrokeStyle = nullptr;
-	const HRESULT hr = pD2DFactory->CreateStrokeStyle(
-		strokeProps, nullptr, 0, &pStrokeStyle);
-	if (SUCCEEDED(hr)) {
+	ID2D1StrokeStyle * const pStrokeStyle = GetStrokeStyle(strokeStyleRoundCap, D2D1_CAP_STYLE_ROUND);
+	if (pStrokeStyle) {
 		pRenderTarget->DrawGeometry(geometry.get(), pBrush, stroke.WidthF(), pStrokeStyle);
 	}
-	ReleaseUnknown(pStrokeStyle);
 }
 
 void SurfaceD2D::Polygon(const Point *pts, size_t npts, FillStroke fillStroke) {
@@ -1869,6 +2095,17 @@ void SurfaceD2D::FillRectangleAligned(PRectangle rc, Fill fill) {
 	FillRectangle(PixelAlign(rc, 1), fill);
 }
 
+void SurfaceD2D::FillRectangleList(const PRectangle *prcs, size_t nrcs, Fill fill) {
+	if (pRenderTarget) {
+		// one brush colour update for the whole batch.
+		D2DPenColourAlpha(fill.colour);
+		for (size_t index = 0; index < nrcs; index++) {
+			const D2D1_RECT_F rectangle = RectangleFromPRectangleEx(PixelAlign(prcs[index], 1));
+			pRenderTarget->FillRectangle(&rectangle, pBrush);
+		}
+	}
+}
+
 void SurfaceD2D::FillRectangle(PRectangle rc, Surface &surfacePattern) {
 	SurfaceD2D *psurfOther = down_cast<SurfaceD2D *>(&surfacePattern);
 	PLATFORM_ASSERT(psurfOther);
@@ -2529,12 +2766,18 @@ void SurfaceD2D::DrawTextCommon(PRectangle rc, const Font *font_, XYPOSITION yba
 		//pfm->pTextFormat->SetReadingDirection(mode.bidiR2L ? DWRITE_READING_DIRECTION_RIGHT_TO_LEFT : DWRITE_READING_DIRECTION_LEFT_TO_RIGHT);
 
 		// Explicitly creating a text layout appears a little faster
-		IDWriteTextLayout *pTextLayout = nullptr;
-		const HRESULT hr = pIDWriteFactory->CreateTextLayout(tbuf.data(), tbuf.length(),
-			pfm->pTextFormat,
-			static_cast<FLOAT>(rc.Width()),
-			static_cast<FLOAT>(rc.Height()),
-			&pTextLayout);
+		IDWriteTextLayout *pTextLayout = layoutCache.Find(pfm->pTextFormat, tbuf.data(), tbuf.length());
+		HRESULT hr = S_OK;
+		if (!pTextLayout) {
+			hr = pIDWriteFactory->CreateTextLayout(tbuf.data(), tbuf.length(),
+				pfm->pTextFormat,
+				static_cast<FLOAT>(rc.Width()),
+				static_cast<FLOAT>(rc.Height()),
+				&pTextLayout);
+			if (SUCCEEDED(hr) && tbuf.length() <= maxCachedLayoutLength) {
+				layoutCache.Add(pfm->pTextFormat, tbuf.data(), tbuf.length(), pTextLayout);
+			}
+		}
 		if (SUCCEEDED(hr)) {
 			const D2D1_POINT_2F origin = DPointFromPoint(Point(rc.left, ybase - pfm->yAscent));
 			//DWRITE_TEXT_METRICS textMetrics{};
@@ -2598,14 +2841,21 @@ HRESULT MeasurePositions(const Font *font_, TextWideD2D &tbuf) {
 		return E_FAIL;
 	}
 
-	// Create a layout
-	IDWriteTextLayout *pTextLayout = nullptr;
-	const HRESULT hrCreate = pIDWriteFactory->CreateTextLayout(tbuf.data(), tbuf.length(), pfm->pTextFormat, 10000.0, 1000.0, &pTextLayout);
-	if (!SUCCEEDED(hrCreate)) {
-		return hrCreate;
-	}
+	// Create a layout. Font fallback for runs the base font can not cover is
+	// resolved during creation, so sharing the layout cache with the draw path
+	// reuses that mapping across lines and document switches.
+	IDWriteTextLayout *pTextLayout = layoutCache.Find(pfm->pTextFormat, tbuf.data(), tbuf.length());
 	if (!pTextLayout) {
-		return E_FAIL;
+		const HRESULT hrCreate = pIDWriteFactory->CreateTextLayout(tbuf.data(), tbuf.length(), pfm->pTextFormat, 10000.0, 1000.0, &pTextLayout);
+		if (!SUCCEEDED(hrCreate)) {
+			return hrCreate;
+		}
+		if (!pTextLayout) {
+			return E_FAIL;
+		}
+		if (tbuf.length() <= maxCachedLayoutLength) {
+			layoutCache.Add(pfm->pTextFormat, tbuf.data(), tbuf.length(), pTextLayout);
+		}
 	}
 
 	tbuf.allocate();
@@ -2686,9 +2936,14 @@ XYPOSITION SurfaceD2D::WidthText(const Font *font_, std::string_view text) {
 	if (pfm->pTextFormat) {
 		const TextWide tbuf(text, mode.codePage);
 		// Create a layout
-		IDWriteTextLayout *pTextLayout = nullptr;
-		const HRESULT hr = pIDWriteFactory->CreateTextLayout(tbuf.data(), tbuf.length(), pfm->pTextFormat, 1000.0, 1000.0, &pTextLayout);
-		if (SUCCEEDED(hr) && pTextLayout) {
+		IDWriteTextLayout *pTextLayout = layoutCache.Find(pfm->pTextFormat, tbuf.data(), tbuf.length());
+		if (!pTextLayout) {
+			const HRESULT hr = pIDWriteFactory->CreateTextLayout(tbuf.data(), tbuf.length(), pfm->pTextFormat, 1000.0, 1000.0, &pTextLayout);
+			if (SUCCEEDED(hr) && pTextLayout && tbuf.length() <= maxCachedLayoutLength) {
+				layoutCache.Add(pfm->pTextFormat, tbuf.data(), tbuf.length(), pTextLayout);
+			}
+		}
+		if (pTextLayout) {
 			DWRITE_TEXT_METRICS textMetrics;
 			if (SUCCEEDED(pTextLayout->GetMetrics(&textMetrics)))
 				width = textMetrics.widthIncludingTrailingWhitespace;
@@ -2761,9 +3016,14 @@ XYPOSITION SurfaceD2D::WidthTextUTF8(const Font * font_, std::string_view text)
 	if (pfm->pTextFormat) {
 		const TextWide tbuf(text, CpUtf8);
 		// Create a layout
-		IDWriteTextLayout *pTextLayout = nullptr;
-		const HRESULT hr = pIDWriteFactory->CreateTextLayout(tbuf.data(), tbuf.length(), pfm->pTextFormat, 1000.0, 1000.0, &pTextLayout);
-		if (SUCCEEDED(hr)) {
+		IDWriteTextLayout *pTextLayout = layoutCache.Find(pfm->pTextFormat, tbuf.data(), tbuf.length());
+		if (!pTextLayout) {
+			const HRESULT hr = pIDWriteFactory->CreateTextLayout(tbuf.data(), tbuf.length(), pfm->pTextFormat, 1000.0, 1000.0, &pTextLayout);
+			if (SUCCEEDED(hr) && pTextLayout && tbuf.length() <= maxCachedLayoutLength) {
+				layoutCache.Add(pfm->pTextFormat, tbuf.data(), tbuf.length(), pTextLayout);
+			}
+		}
+		if (pTextLayout) {
 			DWRITE_TEXT_METRICS textMetrics;
 			if (SUCCEEDED(pTextLayout->GetMetrics(&textMetrics)))
 				width = textMetrics.widthIncludingTrailingWhitespace;
@@ -3536,15 +3796,25 @@ void ListBoxX::Create(Window &parent_, int ctrlID_, Point location_, int lineHei
 	unicodeMode = unicodeMode_;
 	technology = technology_;
 	HWND hwndParent = HwndFromWindow(*parent);
-	HINSTANCE hinstanceParent = GetWindowInstance(hwndParent);
-	// Window created as popup so not clipped within parent client area
-	wid = ::CreateWindowEx(
-		WS_EX_WINDOWEDGE, ListBoxX_ClassName, L"",
-		WS_POPUP | frameStyle,
-		100, 100, 150, 80, hwndParent,
-		{},
-		hinstanceParent,
-		this);
+	if (wid) {
+		// Reuse the hidden window from the previous popup: window creation
+		// dominates the latency of showing the completion list, so cancelling
+		// the list only hides the window and it is repositioned and
+		// repopulated here. Update the frame in case options changed.
+		HWND hwnd = HwndFromWindowID(wid);
+		const DWORD style = (GetWindowStyle(hwnd) & ~(WS_THICKFRAME | WS_BORDER)) | frameStyle;
+		::SetWindowLong(hwnd, GWL_STYLE, style);
+	} else {
+		HINSTANCE hinstanceParent = GetWindowInstance(hwndParent);
+		// Window created as popup so not clipped within parent client area
+		wid = ::CreateWindowEx(
+			WS_EX_WINDOWEDGE, ListBoxX_ClassName, L"",
+			WS_POPUP | frameStyle,
+			100, 100, 150, 80, hwndParent,
+			{},
+			hinstanceParent,
+			this);
+	}
 
 	dpi = GetWindowDPI(hwndParent);
 	POINT locationw = POINTFromPointEx(location);
@@ -4490,6 +4760,9 @@ void Platform_Initialise(void *hInstance) noexcept {
 
 void Platform_Finalise(bool fromDllMain) noexcept {
 	if (!fromDllMain) {
+		layoutCache.Flush();
+		ReleaseUnknown(strokeStyleSquareCap);
+		ReleaseUnknown(strokeStyleRoundCap);
 		ReleaseUnknown(gdiInterop);
 		ReleaseUnknown(pIDWriteFactory);
 		ReleaseUnknown(pD2DFactory);
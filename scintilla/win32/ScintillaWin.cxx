@@ -23,6 +23,7 @@
 #include <optional>
 #include <algorithm>
 #include <memory>
+#include <atomic>
 //#include <mutex>
 
 // WIN32_LEAN_AND_MEAN is defined to avoid including commdlg.h
@@ -54,6 +55,7 @@ Used by VSCode, Atom etc.
 #define Enable_ChromiumWebCustomMIMEDataFormat	0
 
 #include "ParallelSupport.h"
+#include "TraceEvents.h"
 #include "ScintillaTypes.h"
 #include "ScintillaMessages.h"
 #include "ScintillaStructures.h"
@@ -91,7 +93,7 @@ Used by VSCode, Atom etc.
 #include "MarginView.h"
 #include "EditView.h"
 #include "Editor.h"
-//#include "ElapsedPeriod.h"
+#include "ElapsedPeriod.h"
 
 #include "AutoComplete.h"
 #include "ScintillaBase.h"
@@ -100,6 +102,7 @@ Used by VSCode, Atom etc.
 #include "PlatWin.h"
 #include "HanjaDic.h"
 #include "LaTeXInput.h"
+#include "OverviewBar.h"
 
 #define APPM_DROPFILES				(WM_APP + 7)
 #ifndef WM_DPICHANGED
@@ -118,6 +121,12 @@ Used by VSCode, Atom etc.
 using namespace Scintilla;
 using namespace Scintilla::Internal;
 
+#if NP2_TRACE_EVENTS
+// provider GUID hashed from the name, see TraceEvents.h.
+TRACELOGGING_DEFINE_PROVIDER(hTraceEventProvider, "Notepad4.Trace",
+	(0x4a19744c, 0x8d88, 0x53bf, 0x04, 0x7f, 0xf7, 0xc5, 0x48, 0x57, 0x5b, 0x68));
+#endif
+
 namespace {
 
 // Two idle messages SC_WIN_IDLE and SC_WORK_IDLE.
@@ -420,6 +429,7 @@ class ScintillaWin final :
 	BOOL typingWithoutCursor = FALSE;
 	UINT linesPerScroll = 0;	///< Intellimouse support
 	UINT charsPerScroll = 0;	///< Intellimouse support
+	Sci::Line lineThumbTrackLast = -1;	///< previous SB_THUMBTRACK position, -1 when the thumb is not held
 	MouseWheelDelta verticalWheelDelta;
 	MouseWheelDelta horizontalWheelDelta;
 
@@ -460,6 +470,10 @@ class ScintillaWin final :
 	// The current input Language ID.
 	LANGID inputLang = LANG_USER_DEFAULT;
 
+	// selection retained for delayed clipboard rendering; only converted to
+	// CF_UNICODETEXT in WM_RENDERFORMAT when another application pastes.
+	mutable SelectionText clipboardRetained;
+
 	bool renderTargetValid = true;
 	ID2D1RenderTarget *pRenderTarget = nullptr;
 	// rendering parameters for current monitor
@@ -524,7 +538,6 @@ class ScintillaWin final :
 	}
 
 	void MoveImeCarets(Sci::Position offset) noexcept;
-	void DrawImeIndicator(int indicator, Sci::Position len);
 	void SetCandidateWindowPos();
 	void SelectionToHangul();
 	void EscapeHanja();
@@ -586,6 +599,7 @@ class ScintillaWin final :
 	void GetMouseParameters() noexcept;
 	void CopyToGlobal(GlobalMemory &gmUnicode, const SelectionText &selectedText, CopyEncoding encoding) const;
 	void CopyToClipboard(const SelectionText &selectedText) const override;
+	void RenderClipboard(UINT uFormat) const;
 	void ScrollMessage(WPARAM wParam);
 	void HorizontalScrollMessage(WPARAM wParam);
 	void FullPaint();
@@ -746,6 +760,33 @@ void ScintillaWin::Finalise() noexcept {
 	::RevokeDragDrop(MainHWND());
 }
 
+namespace {
+
+// Rendering parameters were rebuilt on every hop between monitors, which
+// contributes a visible hitch when dragging the window across a mixed-DPI
+// monitor boundary. Retain the parameters for recently seen monitors so a
+// hop back to a known monitor is a lookup; the cache is flushed whenever
+// display settings change and the parameters have to be requeried.
+struct MonitorRenderingParams {
+	HMONITOR monitor;
+	IDWriteRenderingParams *defaultParams;
+	IDWriteRenderingParams *customParams;
+};
+
+MonitorRenderingParams renderingParamsCache[4] {};
+unsigned int renderingParamsCacheSlot = 0;
+
+void FlushRenderingParamsCache() noexcept {
+	for (MonitorRenderingParams &entry : renderingParamsCache) {
+		ReleaseUnknown(entry.defaultParams);
+		ReleaseUnknown(entry.customParams);
+		entry.monitor = {};
+	}
+	renderingParamsCacheSlot = 0;
+}
+
+}
+
 bool ScintillaWin::UpdateRenderingParams(bool force) noexcept {
 	// see https://sourceforge.net/p/scintilla/bugs/2344/?page=2
 	//HWND topLevel = ::GetAncestor(MainHWND(), GA_ROOT);
@@ -758,17 +799,47 @@ bool ScintillaWin::UpdateRenderingParams(bool force) noexcept {
 	IDWriteRenderingParams *monitorRenderingParams = nullptr;
 	IDWriteRenderingParams *customClearTypeRenderingParams = nullptr;
 	if (technology != Technology::Default) {
-		const HRESULT hr = pIDWriteFactory->CreateMonitorRenderingParams(monitor, &monitorRenderingParams);
-		UINT clearTypeContrast = 0;
-		if (SUCCEEDED(hr) && ::SystemParametersInfo(SPI_GETFONTSMOOTHINGCONTRAST, 0, &clearTypeContrast, 0) != 0) {
-			if (clearTypeContrast >= 1000 && clearTypeContrast <= 2200) {
-				const FLOAT gamma = static_cast<FLOAT>(clearTypeContrast) / 1000.0f;
-				pIDWriteFactory->CreateCustomRenderingParams(gamma,
-					monitorRenderingParams->GetEnhancedContrast(),
-					monitorRenderingParams->GetClearTypeLevel(),
-					monitorRenderingParams->GetPixelGeometry(),
-					monitorRenderingParams->GetRenderingMode(),
-					&customClearTypeRenderingParams);
+		if (force) {
+			// display settings changed: every cached entry may be stale
+			FlushRenderingParamsCache();
+		}
+		for (const MonitorRenderingParams &entry : renderingParamsCache) {
+			if (entry.monitor == monitor) {
+				monitorRenderingParams = entry.defaultParams;
+				customClearTypeRenderingParams = entry.customParams;
+				monitorRenderingParams->AddRef();
+				if (customClearTypeRenderingParams) {
+					customClearTypeRenderingParams->AddRef();
+				}
+				break;
+			}
+		}
+		if (monitorRenderingParams == nullptr) {
+			const HRESULT hr = pIDWriteFactory->CreateMonitorRenderingParams(monitor, &monitorRenderingParams);
+			UINT clearTypeContrast = 0;
+			if (SUCCEEDED(hr) && ::SystemParametersInfo(SPI_GETFONTSMOOTHINGCONTRAST, 0, &clearTypeContrast, 0) != 0) {
+				if (clearTypeContrast >= 1000 && clearTypeContrast <= 2200) {
+					const FLOAT gamma = static_cast<FLOAT>(clearTypeContrast) / 1000.0f;
+					pIDWriteFactory->CreateCustomRenderingParams(gamma,
+						monitorRenderingParams->GetEnhancedContrast(),
+						monitorRenderingParams->GetClearTypeLevel(),
+						monitorRenderingParams->GetPixelGeometry(),
+						monitorRenderingParams->GetRenderingMode(),
+						&customClearTypeRenderingParams);
+				}
+			}
+			if (monitorRenderingParams) {
+				MonitorRenderingParams &entry = renderingParamsCache[renderingParamsCacheSlot];
+				renderingParamsCacheSlot = (renderingParamsCacheSlot + 1) % std::size(renderingParamsCache);
+				ReleaseUnknown(entry.defaultParams);
+				ReleaseUnknown(entry.customParams);
+				entry.monitor = monitor;
+				entry.defaultParams = monitorRenderingParams;
+				entry.customParams = customClearTypeRenderingParams;
+				monitorRenderingParams->AddRef();
+				if (customClearTypeRenderingParams) {
+					customClearTypeRenderingParams->AddRef();
+				}
 			}
 		}
 	}
@@ -1088,7 +1159,15 @@ bool ScintillaWin::PaintDC(HDC hdc) {
 				pRenderTarget->BeginDraw();
 				Paint(surfaceWindow, rcPaint);
 				surfaceWindow->Release();
+				// the batched drawing is executed and presented here, so this
+				// scope is where the hardware path spends its GPU time while
+				// Editor::Paint above covers layout and command generation.
+				NP2_TRACE_SCOPE2("ScintillaWin::EndDraw", rcPaint.Height());
+				const ElapsedPeriod epFlush;
 				const HRESULT hr = pRenderTarget->EndDraw();
+				if (view.profiler.enabled) {
+					view.profiler.durFlush = epFlush.Duration();
+				}
 				if (hr == static_cast<HRESULT>(D2DERR_RECREATE_TARGET)) {
 					DropRenderTarget();
 					return false;
@@ -1165,21 +1244,6 @@ void ScintillaWin::MoveImeCarets(Sci::Position offset) noexcept {
 	}
 }
 
-void ScintillaWin::DrawImeIndicator(int indicator, Sci::Position len) {
-	// Emulate the visual style of IME characters with indicators.
-	// Draw an indicator on the character before caret by the character bytes of len
-	// so it should be called after InsertCharacter().
-	// It does not affect caret positions.
-	if (indicator < 8 || indicator > IndicatorMax) {
-		return;
-	}
-	pdoc->DecorationSetCurrentIndicator(indicator);
-	for (size_t r = 0; r < sel.Count(); r++) {
-		const Sci::Position positionInsert = sel.Range(r).Start().Position();
-		pdoc->DecorationFillRange(positionInsert - len, 1, len);
-	}
-}
-
 // See Chromium's IMM32Manager::MoveImeWindow()
 void ScintillaWin::SetCandidateWindowPos() {
 	const IMContext imc(MainHWND());
@@ -1345,6 +1409,13 @@ void ScintillaWin::AddWString(std::wstring_view wsv, CharacterSource charSource)
 		return;
 
 	const UINT codePage = CodePageOfDocument();
+	if (wsv.size() > UTF16CharLength(wsv[0])) {
+		// a coalesced typing burst: convert and insert in one batch so the
+		// buffer, styling and the display are updated once for the whole run
+		const std::string text = StringEncode(wsv, codePage);
+		InsertCharacter(text, charSource);
+		return;
+	}
 	char inBufferCP[16];
 	for (size_t i = 0; i < wsv.size(); ) {
 		const size_t ucWidth = UTF16CharLength(wsv[i]);
@@ -1495,18 +1566,45 @@ sptr_t ScintillaWin::HandleCompositionInline(uptr_t, sptr_t lParam) {
 		std::vector<BYTE> imeIndicator = imc.GetImeAttributes();
 		const int indicatorMask = MapImeIndicators(imeIndicator);
 
+		// Insert the whole composition string with one document operation:
+		// InsertCharacter() rewraps the line and scrolls after every call, so
+		// going character by character lays out a long wrapped line once per
+		// composition character and stutters with multi-character CJK
+		// compositions. Keep the byte length of each character so the
+		// indicators can be filled after the single insertion.
 		const UINT codePage = CodePageOfDocument();
 		const std::wstring_view wsv = wcs;
+		std::string compositionCP;
+		std::vector<int> charBytes(wsv.size());
 		char inBufferCP[16];
 		for (size_t i = 0; i < wsv.size(); ) {
 			const size_t ucWidth = UTF16CharLength(wsv[i]);
 			const int size = MultiByteFromWideChar(codePage, wsv.substr(i, ucWidth), inBufferCP, sizeof(inBufferCP) - 1);
-			inBufferCP[size] = '\0';
-			InsertCharacter(std::string_view(inBufferCP, size), CharacterSource::TentativeInput);
-
-			DrawImeIndicator(imeIndicator[i], size);
+			compositionCP.append(inBufferCP, size);
+			charBytes[i] = size;
 			i += ucWidth;
 		}
+		InsertCharacter(compositionCP, CharacterSource::TentativeInput);
+
+		// Emulate the visual style of IME characters with indicators, merging
+		// a run of equal attributes into one fill per caret. Caret positions
+		// are not affected.
+		for (size_t r = 0; r < sel.Count(); r++) {
+			Sci::Position position = sel.Range(r).Start().Position() - compositionCP.length();
+			for (size_t i = 0; i < wsv.size(); ) {
+				const BYTE indicator = imeIndicator[i];
+				Sci::Position len = 0;
+				do {
+					len += charBytes[i];
+					i += UTF16CharLength(wsv[i]);
+				} while (i < wsv.size() && imeIndicator[i] == indicator);
+				if (indicator >= 8 && indicator <= IndicatorMax) {
+					pdoc->DecorationSetCurrentIndicator(indicator);
+					pdoc->DecorationFillRange(position, 1, len);
+				}
+				position += len;
+			}
+		}
 
 		// Japanese IME after pressing Space or Tab replaces input string with first candidate item (target string);
 		// when selecting other candidate item, previous item will be replaced with current one.
@@ -1869,7 +1967,51 @@ sptr_t ScintillaWin::KeyMessage(unsigned int iMessage, uptr_t wParam, sptr_t lPa
 				lastHighSurrogateChar = 0;
 				wclen = 2;
 			}
-			AddWString(std::wstring_view(wcs, wclen), CharacterSource::DirectInput);
+
+			// Coalesce the rest of a typing burst already waiting in the queue
+			// into this insertion. During fast key repeat in a heavy document
+			// each character otherwise pays its own restyle, rewrap and paint
+			// and input falls ever further behind; a batch pays once for the
+			// whole run. Only plain printable input is folded in: control
+			// characters, surrogate halves and keys that may carry a command
+			// binding keep the one-message path.
+			std::wstring burst;
+			if (ch >= ' ') {
+				MSG msg;
+				for (;;) {
+					if (::PeekMessageW(&msg, MainHWND(), WM_CHAR, WM_CHAR, PM_NOREMOVE)) {
+						const wchar_t wch = static_cast<wchar_t>(msg.wParam);
+						if (wch < ' ' || IS_SURROGATE(wch)) {
+							break;
+						}
+						::PeekMessageW(&msg, MainHWND(), WM_CHAR, WM_CHAR, PM_REMOVE);
+						burst.push_back(wch);
+						continue;
+					}
+					if (::PeekMessageW(&msg, MainHWND(), WM_KEYDOWN, WM_KEYDOWN, PM_NOREMOVE)) {
+						// auto-repeat queues untranslated key downs; translate
+						// the plain ones here so their characters join the batch
+						const UINT vk = static_cast<UINT>(msg.wParam);
+						const bool plain = ((vk >= '0' && vk <= '9') || (vk >= 'A' && vk <= 'Z') ||
+							vk == VK_SPACE || (vk >= VK_NUMPAD0 && vk <= VK_DIVIDE) ||
+							(vk >= VK_OEM_1 && vk <= VK_OEM_102)) &&
+							!KeyboardIsKeyDown(VK_CONTROL) && !KeyboardIsKeyDown(VK_MENU);
+						if (!plain) {
+							break;
+						}
+						::PeekMessageW(&msg, MainHWND(), WM_KEYDOWN, WM_KEYDOWN, PM_REMOVE);
+						::TranslateMessage(&msg);
+						continue;
+					}
+					break;
+				}
+			}
+			if (burst.empty()) {
+				AddWString(std::wstring_view(wcs, wclen), CharacterSource::DirectInput);
+			} else {
+				burst.insert(0, wcs, wclen);
+				AddWString(burst, CharacterSource::DirectInput);
+			}
 		}
 		return 0;
 
@@ -2226,6 +2368,39 @@ sptr_t ScintillaWin::WndProc(Message iMessage, uptr_t wParam, sptr_t lParam) {
 	try {
 		//Platform::DebugPrintf("S M:%x WP:%x L:%x\n", iMessage, wParam, lParam);
 		const unsigned int msg = static_cast<unsigned int>(iMessage);
+		NP2_TRACE_SCOPE2("ScintillaWin::WndProc", msg);
+		if (msg - SCI_START < 3000U) {
+			// The SCI_* API range [SCI_START, 5000) contains none of the window
+			// messages handled below, so the millions of calls issued through
+			// the direct function jump straight to the dense message switches
+			// instead of walking the window message dispatch first.
+			switch (iMessage) {
+			case Message::GetDirectFunction:
+			case Message::GetDirectStatusFunction:
+			case Message::GetDirectPointer:
+			case Message::GrabFocus:
+			case Message::SetTechnology:
+			case Message::SetBidirectional:
+			case Message::TargetAsUTF8:
+			case Message::EncodedFromUTF8:
+				return SciMessage(iMessage, wParam, lParam);
+
+			case Message::Tab:
+				if (wParam & static_cast<int>(TabCompletion::Latex)) {
+					if (HandleLaTeXTabCompletion()) {
+						break;
+					}
+					if (!(wParam & static_cast<int>(TabCompletion::Default))) {
+						break;
+					}
+				}
+				[[fallthrough]];
+
+			default:
+				return ScintillaBase::WndProc(iMessage, wParam, lParam);
+			}
+			return 0;
+		}
 		switch (msg) {
 
 		case WM_CREATE:
@@ -2377,6 +2552,26 @@ sptr_t ScintillaWin::WndProc(Message iMessage, uptr_t wParam, sptr_t lParam) {
 			capturedMouse = false;
 			return 0;
 
+		case WM_RENDERFORMAT:
+			// another application pastes the delay rendered selection
+			RenderClipboard(static_cast<UINT>(wParam));
+			return 0;
+
+		case WM_RENDERALLFORMATS:
+			// about to lose the ability to render: convert what remains
+			if (::OpenClipboard(MainHWND())) {
+				if (::GetClipboardOwner() == MainHWND()) {
+					RenderClipboard(CF_UNICODETEXT);
+				}
+				::CloseClipboard();
+			}
+			return 0;
+
+		case WM_DESTROYCLIPBOARD:
+			// the clipboard now holds other content
+			clipboardRetained.Clear();
+			return 0;
+
 			// These are not handled in Scintilla and it's faster to dispatch them here.
 			// Also moves time out to here so profile doesn't count lots of empty message calls.
 
@@ -2435,32 +2630,9 @@ sptr_t ScintillaWin::WndProc(Message iMessage, uptr_t wParam, sptr_t lParam) {
 			return EditMessage(msg, wParam, lParam);
 		}
 
+		// remaining EM_* messages and unhandled window messages.
 		iMessage = SciMessageFromEM(msg);
-		switch (iMessage) {
-		case Message::GetDirectFunction:
-		case Message::GetDirectStatusFunction:
-		case Message::GetDirectPointer:
-		case Message::GrabFocus:
-		case Message::SetTechnology:
-		case Message::SetBidirectional:
-		case Message::TargetAsUTF8:
-		case Message::EncodedFromUTF8:
-			return SciMessage(iMessage, wParam, lParam);
-
-		case Message::Tab:
-			if (wParam & static_cast<int>(TabCompletion::Latex)) {
-				if (HandleLaTeXTabCompletion()) {
-					break;
-				}
-				if (!(wParam & static_cast<int>(TabCompletion::Default))) {
-					break;
-				}
-			}
-			[[fallthrough]];
-
-		default:
-			return ScintillaBase::WndProc(iMessage, wParam, lParam);
-		}
+		return ScintillaBase::WndProc(iMessage, wParam, lParam);
 	} catch (std::bad_alloc &) {
 		errorStatus = Status::BadAlloc;
 	} catch (...) {
@@ -2624,12 +2796,22 @@ bool ScintillaWin::PaintContains(PRectangle rc) const noexcept {
 	return true;
 }
 
-void ScintillaWin::ScrollText(Sci::Line /* linesToMove */) {
+void ScintillaWin::ScrollText(Sci::Line linesToMove) {
 	//Platform::DebugPrintf("ScintillaWin::ScrollText %d\n", linesToMove);
-	//::ScrollWindow(MainHWND(), 0,
-	//	vs.lineHeight * linesToMove, 0, 0);
-	//::UpdateWindow(MainHWND());
-	Redraw();
+	// On GDI a short scroll is a blit: every visible pixel moves by a whole
+	// number of lines, so shift the window contents and repaint only the
+	// strip that scrolls into view. The Direct2D modes present through a
+	// swap chain the blit cannot reach, so they still repaint in full.
+	// Skip the blit when an update is already pending as ScrollWindowEx
+	// would shift the stale region along with the valid pixels.
+	if (technology == Technology::Default && !HasMarginWindow()
+		&& !::GetUpdateRect(MainHWND(), nullptr, FALSE)) {
+		const int dy = static_cast<int>(vs.lineHeight * linesToMove);
+		::ScrollWindowEx(MainHWND(), 0, dy, nullptr, nullptr, nullptr, nullptr, SW_INVALIDATE);
+		::UpdateWindow(MainHWND());
+	} else {
+		Redraw();
+	}
 	UpdateSystemCaret();
 }
 
@@ -3034,6 +3216,10 @@ public:
 	}
 };
 
+// selections at least this large are placed on the clipboard with delayed
+// rendering so the UTF-16 conversion only runs when something actually pastes.
+constexpr size_t delayedRenderSize = 1024*1024;
+
 inline bool IsValidFormatEtc(const FORMATETC *pFE) noexcept {
 	return pFE->ptd == nullptr
 		&& (pFE->dwAspect & DVASPECT_CONTENT) != 0
@@ -3573,14 +3759,23 @@ void ScintillaWin::CopyToClipboard(const SelectionText &selectedText) const {
 	}
 	::EmptyClipboard();
 
-	GlobalMemory uniText;
-	CopyToGlobal(uniText, selectedText, selectedText.asBinary ? CopyEncoding::Binary : CopyEncoding::Unicode);
+	if (!selectedText.asBinary && selectedText.Length() >= delayedRenderSize) {
+		// retain the 8-bit selection and delay the conversion until another
+		// application pastes, so a large copy neither allocates nor fills the
+		// UTF-16 global up front. EmptyClipboard() above already sent any
+		// WM_DESTROYCLIPBOARD clearing the previously retained selection.
+		clipboardRetained = selectedText;
+		::SetClipboardData(CF_UNICODETEXT, nullptr);
+	} else {
+		GlobalMemory uniText;
+		CopyToGlobal(uniText, selectedText, selectedText.asBinary ? CopyEncoding::Binary : CopyEncoding::Unicode);
 
-	if (uniText) {
-		uniText.SetClip(selectedText.asBinary ? CF_TEXT : CF_UNICODETEXT);
+		if (uniText) {
+			uniText.SetClip(selectedText.asBinary ? CF_TEXT : CF_UNICODETEXT);
 
-		if (selectedText.asBinary) {
-			// encode length information
+			if (selectedText.asBinary) {
+				// encode length information
+			}
 		}
 	}
 
@@ -3605,6 +3800,18 @@ void ScintillaWin::CopyToClipboard(const SelectionText &selectedText) const {
 	//}
 }
 
+void ScintillaWin::RenderClipboard(UINT uFormat) const {
+	// the clipboard is open: the system opens it around WM_RENDERFORMAT and
+	// WM_RENDERALLFORMATS opens it explicitly before calling here.
+	if (uFormat == CF_UNICODETEXT && !clipboardRetained.Empty()) {
+		GlobalMemory uniText;
+		CopyToGlobal(uniText, clipboardRetained, CopyEncoding::Unicode);
+		if (uniText) {
+			uniText.SetClip(CF_UNICODETEXT);
+		}
+	}
+}
+
 void ScintillaWin::ScrollMessage(WPARAM wParam) {
 	//DWORD dwStart = GetTickCount();
 	//Platform::DebugPrintf("Scroll %x %d\n", wParam, lParam);
@@ -3647,6 +3854,19 @@ void ScintillaWin::ScrollMessage(WPARAM wParam) {
 		break;
 	}
 	ScrollTo(topLineNew);
+	if (LOWORD(wParam) == SB_THUMBTRACK) {
+		// While the thumb is held, extrapolate the drag from the previous
+		// track position and style toward the band the next track message is
+		// likely to expose, so scrubbing an unstyled region stays painted.
+		Sci::Line lookAhead = LinesOnScreen();
+		if (lineThumbTrackLast >= 0 && topLineNew > lineThumbTrackLast) {
+			lookAhead += topLineNew - lineThumbTrackLast;
+		}
+		lineThumbTrackLast = topLineNew;
+		StyleScrollPrediction(topLineNew + lookAhead);
+	} else {
+		lineThumbTrackLast = -1;
+	}
 }
 
 void ScintillaWin::HorizontalScrollMessage(WPARAM wParam) {
@@ -3938,6 +4158,17 @@ STDMETHODIMP ScintillaWin::Drop(LPDATAOBJECT pIDataSource, DWORD grfKeyState, PO
 
 		SetDragPosition(SelectionPosition(Sci::invalidPosition));
 
+		if ((pIDataSource == static_cast<IDataObject *>(&dob)) && !drag.Empty()) {
+			// Dropping our own drag: the dragged text is already held in drag,
+			// so skip GetData which round-trips large selections through
+			// UTF-16 global memory and back.
+			POINT rpt = { pt.x, pt.y };
+			::ScreenToClient(MainHWND(), &rpt);
+			const SelectionPosition movePos = SPositionFromLocation(PointFromPOINT(rpt), false, false, UserVirtualSpace());
+			DropAt(movePos, drag.Data(), drag.Length(), *pdwEffect == DROPEFFECT_MOVE, drag.rectangular);
+			return S_OK;
+		}
+
 		std::string putf;
 		HRESULT hr = DV_E_FORMATETC;
 
@@ -4303,12 +4534,21 @@ extern "C" {
 // This function is externally visible so it can be called from container when building statically.
 // Must be called once only.
 int Scintilla_RegisterClasses(void *hInstance) {
-	const bool result = ScintillaWin::Register(static_cast<HINSTANCE>(hInstance));
+#if NP2_TRACE_EVENTS
+	TraceLoggingRegister(hTraceEventProvider);
+#endif
+	const bool result = ScintillaWin::Register(static_cast<HINSTANCE>(hInstance))
+		&& OverviewBarRegister(static_cast<HINSTANCE>(hInstance));
 	return result;
 }
 
 // This function is externally visible so it can be called from container when building statically.
 int Scintilla_ReleaseResources(void) {
+#if NP2_TRACE_EVENTS
+	TraceLoggingUnregister(hTraceEventProvider);
+#endif
+	OverviewBarUnregister();
+	FlushRenderingParamsCache();
 	const bool result = ScintillaWin::Unregister();
 	Platform_Finalise(false);
 	return result;
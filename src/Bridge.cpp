@@ -94,6 +94,109 @@ void EditPrintInit() noexcept {
 	}
 }
 
+// SCI_FORMATRANGE has to run on the editor's thread, so pages are formatted
+// there into enhanced metafiles and cached ahead of a worker thread which
+// owns the printer DC and drains the cache; a slow driver then only stalls
+// the worker, not the editor.
+constexpr UINT PrintCacheSlotCount = 16;
+
+struct PagePrintContext {
+	HDC hdc;				// printer DC, owned by the worker thread
+	LPCWSTR pszDocTitle;
+	POINT ptDpi;
+	HANDLE pagesAvailable;	// semaphore: rendered pages waiting in the cache
+	HANDLE slotsFree;		// semaphore: cache slots the worker has retired
+	HANDLE cancelEvent;		// manual reset: user canceled or the printer failed
+	HENHMETAFILE cache[PrintCacheSlotCount];
+	bool failed;
+};
+
+PagePrintContext *printAbortContext = nullptr;
+
+BOOL CALLBACK PrintAbortProc(HDC /*hdc*/, int /*error*/) noexcept {
+	// GDI polls this while spooling, so a cancel takes effect in the middle
+	// of the current page instead of after it.
+	return WaitForSingleObject(printAbortContext->cancelEvent, 0) != WAIT_OBJECT_0;
+}
+
+DWORD WINAPI PagePrintThread(LPVOID lpParam) noexcept {
+	PagePrintContext * const print = static_cast<PagePrintContext *>(lpParam);
+	SetAbortProc(print->hdc, PrintAbortProc);
+	const DOCINFO di = {sizeof(DOCINFO), print->pszDocTitle, nullptr, nullptr, 0};
+	if (StartDoc(print->hdc, &di) < 0) {
+		print->failed = true;
+		SetEvent(print->cancelEvent);
+		return 1;
+	}
+
+	const HANDLE objects[2] = { print->cancelEvent, print->pagesAvailable };
+	UINT slot = 0;
+	for (;;) {
+		if (WaitForMultipleObjects(2, objects, FALSE, INFINITE) != WAIT_OBJECT_0 + 1) {
+			AbortDoc(print->hdc);
+			return 1;
+		}
+		HENHMETAFILE const page = print->cache[slot];
+		print->cache[slot] = nullptr;
+		slot = (slot + 1) % PrintCacheSlotCount;
+		if (page == nullptr) {
+			// end marker: every formatted page has been printed
+			EndDoc(print->hdc);
+			return 0;
+		}
+
+		ENHMETAHEADER header;
+		memset(&header, 0, sizeof(header));
+		GetEnhMetaFileHeader(page, sizeof(header), &header);
+		// map the frame back to the device units the page was recorded in
+		const RECT rc = {
+			MulDiv(header.rclFrame.left, print->ptDpi.x, 2540),
+			MulDiv(header.rclFrame.top, print->ptDpi.y, 2540),
+			MulDiv(header.rclFrame.right, print->ptDpi.x, 2540),
+			MulDiv(header.rclFrame.bottom, print->ptDpi.y, 2540),
+		};
+		bool ok = StartPage(print->hdc) > 0;
+		if (ok) {
+			ok = PlayEnhMetaFile(print->hdc, page, &rc) && EndPage(print->hdc) > 0;
+		}
+		DeleteEnhMetaFile(page);
+		ReleaseSemaphore(print->slotsFree, 1, nullptr);
+		if (!ok) {
+			// distinguish a driver failure from the abort we caused ourselves
+			print->failed = WaitForSingleObject(print->cancelEvent, 0) != WAIT_OBJECT_0;
+			SetEvent(print->cancelEvent);
+			AbortDoc(print->hdc);
+			return 1;
+		}
+	}
+}
+
+void PrintPumpMessages(const PagePrintContext &print) noexcept {
+	// dispatch paint messages only: the window stays responsive without
+	// letting commands re-enter the print path; Escape cancels the job.
+	MSG msg;
+	while (PeekMessage(&msg, nullptr, WM_PAINT, WM_PAINT, PM_REMOVE)) {
+		DispatchMessage(&msg);
+	}
+	while (PeekMessage(&msg, nullptr, WM_KEYFIRST, WM_KEYLAST, PM_REMOVE)) {
+		if (msg.message == WM_KEYDOWN && msg.wParam == VK_ESCAPE) {
+			SetEvent(print.cancelEvent);
+		}
+	}
+}
+
+// wait for a free cache slot (or the end of the job) while keeping the UI live
+bool PrintWaitForSlot(const PagePrintContext &print) noexcept {
+	const HANDLE objects[2] = { print.cancelEvent, print.slotsFree };
+	for (;;) {
+		const DWORD result = MsgWaitForMultipleObjects(2, objects, FALSE, INFINITE, QS_PAINT | QS_KEY);
+		if (result != WAIT_OBJECT_0 + 2) {
+			return result == WAIT_OBJECT_0 + 1;
+		}
+		PrintPumpMessages(print);
+	}
+}
+
 }
 
 //=============================================================================
@@ -255,8 +358,19 @@ bool EditPrint(HWND hwnd, LPCWSTR pszDocTitle, BOOL bDefault) noexcept {
 		footerLineHeight = 0;
 	}
 
-	const DOCINFO di = {sizeof(DOCINFO), pszDocTitle, nullptr, nullptr, 0};
-	if (StartDoc(hdc, &di) < 0) {
+	// The printer DC goes to the worker thread, so formatting needs its own
+	// information context for metafile recording and text measurement.
+	HDC hdcRef = nullptr;
+	if (const DEVNAMES * const pDevNames = static_cast<const DEVNAMES *>(GlobalLock(hDevNames))) {
+		const DEVMODE * const pDevMode = static_cast<const DEVMODE *>(GlobalLock(hDevMode));
+		LPCWSTR const strings = reinterpret_cast<LPCWSTR>(pDevNames);
+		hdcRef = CreateIC(strings + pDevNames->wDriverOffset, strings + pDevNames->wDeviceOffset, nullptr, pDevMode);
+		if (pDevMode != nullptr) {
+			GlobalUnlock(hDevMode);
+		}
+		GlobalUnlock(hDevNames);
+	}
+	if (hdcRef == nullptr) {
 		DeleteDC(hdc);
 		if (fontHeader) {
 			DeleteObject(fontHeader);
@@ -306,8 +420,8 @@ bool EditPrint(HWND hwnd, LPCWSTR pszDocTitle, BOOL bDefault) noexcept {
 
 	// We must substract the physical margins from the printable area
 	Sci_RangeToFormatFull frPrint;
-	frPrint.hdc = hdc;
-	frPrint.hdcTarget = hdc;
+	frPrint.hdc = hdcRef;
+	frPrint.hdcTarget = hdcRef;
 	frPrint.rc.left		= rectMargins.left - rectPhysMargins.left;
 	frPrint.rc.top		= rectMargins.top - rectPhysMargins.top;
 	frPrint.rc.right	= ptPage.x - rectMargins.right - rectPhysMargins.left;
@@ -326,19 +440,63 @@ bool EditPrint(HWND hwnd, LPCWSTR pszDocTitle, BOOL bDefault) noexcept {
 	GetString(IDS_PRINT_PAGENUM, tchPageFormat, COUNTOF(tchPageFormat));
 	GetString(IDS_PRINTFILE, tchPageStatus, COUNTOF(tchPageStatus));
 
+	PagePrintContext print;
+	memset(&print, 0, sizeof(print));
+	print.hdc = hdc;
+	print.pszDocTitle = pszDocTitle;
+	print.ptDpi = ptDpi;
+	print.pagesAvailable = CreateSemaphore(nullptr, 0, PrintCacheSlotCount, nullptr);
+	print.slotsFree = CreateSemaphore(nullptr, PrintCacheSlotCount, PrintCacheSlotCount, nullptr);
+	print.cancelEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+	printAbortContext = &print;
+	HANDLE hThread = CreateThread(nullptr, 0, PagePrintThread, &print, 0, nullptr);
+	if (hThread == nullptr) {
+		printAbortContext = nullptr;
+		CloseHandle(print.pagesAvailable);
+		CloseHandle(print.slotsFree);
+		CloseHandle(print.cancelEvent);
+		DeleteDC(hdcRef);
+		DeleteDC(hdc);
+		if (fontHeader) {
+			DeleteObject(fontHeader);
+		}
+		if (fontFooter) {
+			DeleteObject(fontFooter);
+		}
+		return false;
+	}
+
 	// Show wait cursor...
 	BeginWaitCursor();
 
+	// record each page with the full page as its frame (in 0.01 mm units)
+	// so playback geometry never depends on what the page happens to draw
+	const RECT rcFrame = {0, 0, MulDiv(ptPage.x, 2540, ptDpi.x), MulDiv(ptPage.y, 2540, ptDpi.y)};
+	UINT writeSlot = 0;
 	bool printEmpty = lengthPrinted == lengthDoc;
 	while (lengthPrinted < lengthDoc || printEmpty) {
 		printEmpty = false;
+		PrintPumpMessages(print);
+		if (WaitForSingleObject(print.cancelEvent, 0) == WAIT_OBJECT_0) {
+			break;
+		}
 		const bool printPage = !(pdlg.Flags & PD_PAGENUMS) || (pageNum >= pdlg.nFromPage && pageNum <= pdlg.nToPage);
 		WCHAR tchNum[32];
 		FormatNumber(tchNum, pageNum);
 		WCHAR pageString[128];
 		wsprintf(pageString, tchPageFormat, tchNum);
 
+		HDC hdcMF = hdcRef;
 		if (printPage) {
+			if (!PrintWaitForSlot(print)) {
+				break;
+			}
+			hdcMF = CreateEnhMetaFile(hdcRef, nullptr, &rcFrame, nullptr);
+			if (hdcMF == nullptr) {
+				SetEvent(print.cancelEvent);
+				break;
+			}
+
 			// Display current page number in Statusbar
 			WCHAR statusString[128];
 			wsprintf(statusString, tchPageStatus, tchNum);
@@ -349,19 +507,17 @@ bool EditPrint(HWND hwnd, LPCWSTR pszDocTitle, BOOL bDefault) noexcept {
 			InvalidateRect(hwndStatus, nullptr, TRUE);
 			UpdateWindow(hwndStatus);
 
-			StartPage(hdc);
-
-			SetTextColor(hdc, RGB(0, 0, 0));
-			SetBkColor(hdc, RGB(255, 255, 255));
-			SelectFont(hdc, fontHeader);
-			const UINT ta = SetTextAlign(hdc, TA_BOTTOM);
+			SetTextColor(hdcMF, RGB(0, 0, 0));
+			SetBkColor(hdcMF, RGB(255, 255, 255));
+			SelectFont(hdcMF, fontHeader);
+			const UINT ta = SetTextAlign(hdcMF, TA_BOTTOM);
 			RECT rcw = {
 				frPrint.rc.left, frPrint.rc.top - headerLineHeight - headerLineHeight / 2,
 				frPrint.rc.right, frPrint.rc.top - headerLineHeight / 2
 			};
 
 			if (iPrintHeader != PrintHeaderOption_LeaveBlank) {
-				ExtTextOut(hdc, rcw.left + 5, rcw.bottom,
+				ExtTextOut(hdcMF, rcw.left + 5, rcw.bottom,
 						   ETO_OPAQUE, &rcw, pszDocTitle,
 						   lstrlen(pszDocTitle), nullptr);
 			}
@@ -370,37 +526,38 @@ bool EditPrint(HWND hwnd, LPCWSTR pszDocTitle, BOOL bDefault) noexcept {
 			if (iPrintHeader == PrintHeaderOption_FilenameAndDateTime || iPrintHeader == PrintHeaderOption_FilenameAndDate) {
 				SIZE sizeInfo;
 				const int len = lstrlen(dateString);
-				SelectFont(hdc, fontFooter);
-				GetTextExtentPoint32(hdc, dateString, len, &sizeInfo);
+				SelectFont(hdcMF, fontFooter);
+				GetTextExtentPoint32(hdcMF, dateString, len, &sizeInfo);
 				rcw.left = frPrint.rc.right - 10 - sizeInfo.cx;
-				ExtTextOut(hdc, rcw.left + 5, rcw.bottom,
+				ExtTextOut(hdcMF, rcw.left + 5, rcw.bottom,
 						   ETO_OPAQUE, &rcw, dateString,
 						   len, nullptr);
 			}
 
-			SetTextAlign(hdc, ta);
+			SetTextAlign(hdcMF, ta);
 			if (iPrintHeader != PrintHeaderOption_LeaveBlank) {
 				HPEN pen = CreatePen(0, 1, RGB(0, 0, 0));
-				HPEN penOld = SelectPen(hdc, pen);
-				MoveToEx(hdc, frPrint.rc.left, frPrint.rc.top - headerLineHeight / 4, nullptr);
-				LineTo(hdc, frPrint.rc.right, frPrint.rc.top - headerLineHeight / 4);
-				SelectPen(hdc, penOld);
+				HPEN penOld = SelectPen(hdcMF, pen);
+				MoveToEx(hdcMF, frPrint.rc.left, frPrint.rc.top - headerLineHeight / 4, nullptr);
+				LineTo(hdcMF, frPrint.rc.right, frPrint.rc.top - headerLineHeight / 4);
+				SelectPen(hdcMF, penOld);
 				DeleteObject(pen);
 			}
 		}
 
+		frPrint.hdc = hdcMF;
 		frPrint.chrg.cpMin = lengthPrinted;
 		frPrint.chrg.cpMax = lengthDoc;
 
 		lengthPrinted = SciCall_FormatRangeFull(printPage, &frPrint);
 
 		if (printPage) {
-			SetTextColor(hdc, RGB(0, 0, 0));
-			SetBkColor(hdc, RGB(255, 255, 255));
+			SetTextColor(hdcMF, RGB(0, 0, 0));
+			SetBkColor(hdcMF, RGB(255, 255, 255));
 
 			if (iPrintFooter == PrintFooterOption_PageNumber) {
-				SelectFont(hdc, fontFooter);
-				const UINT ta = SetTextAlign(hdc, TA_TOP);
+				SelectFont(hdcMF, fontFooter);
+				const UINT ta = SetTextAlign(hdcMF, TA_TOP);
 				const RECT rcw = {
 					frPrint.rc.left, frPrint.rc.bottom + footerLineHeight / 2,
 					frPrint.rc.right, frPrint.rc.bottom + footerLineHeight + footerLineHeight / 2
@@ -408,22 +565,30 @@ bool EditPrint(HWND hwnd, LPCWSTR pszDocTitle, BOOL bDefault) noexcept {
 
 				SIZE sizeFooter;
 				const int len = lstrlen(pageString);
-				GetTextExtentPoint32(hdc, pageString, len, &sizeFooter);
-				ExtTextOut(hdc, rcw.right - 5 - sizeFooter.cx, rcw.top,
+				GetTextExtentPoint32(hdcMF, pageString, len, &sizeFooter);
+				ExtTextOut(hdcMF, rcw.right - 5 - sizeFooter.cx, rcw.top,
 						   ETO_OPAQUE, &rcw, pageString,
 						   len, nullptr);
 
-				SetTextAlign(hdc, ta);
+				SetTextAlign(hdcMF, ta);
 				HPEN pen = ::CreatePen(0, 1, RGB(0, 0, 0));
-				HPEN penOld = SelectPen(hdc, pen);
-				SetBkColor(hdc, RGB(0, 0, 0));
-				MoveToEx(hdc, frPrint.rc.left, frPrint.rc.bottom + footerLineHeight / 4, nullptr);
-				LineTo(hdc, frPrint.rc.right, frPrint.rc.bottom + footerLineHeight / 4);
-				SelectPen(hdc, penOld);
+				HPEN penOld = SelectPen(hdcMF, pen);
+				SetBkColor(hdcMF, RGB(0, 0, 0));
+				MoveToEx(hdcMF, frPrint.rc.left, frPrint.rc.bottom + footerLineHeight / 4, nullptr);
+				LineTo(hdcMF, frPrint.rc.right, frPrint.rc.bottom + footerLineHeight / 4);
+				SelectPen(hdcMF, penOld);
 				DeleteObject(pen);
 			}
 
-			EndPage(hdc);
+			// hand the finished page over to the printer thread
+			HENHMETAFILE const page = CloseEnhMetaFile(hdcMF);
+			if (page == nullptr) {
+				SetEvent(print.cancelEvent);
+				break;
+			}
+			print.cache[writeSlot] = page;
+			writeSlot = (writeSlot + 1) % PrintCacheSlotCount;
+			ReleaseSemaphore(print.pagesAvailable, 1, nullptr);
 		}
 		pageNum++;
 
@@ -434,7 +599,30 @@ bool EditPrint(HWND hwnd, LPCWSTR pszDocTitle, BOOL bDefault) noexcept {
 
 	SciCall_FormatRangeFull(false, nullptr);
 
-	EndDoc(hdc);
+	// queue the end marker (an empty slot) unless the job was already canceled
+	if (PrintWaitForSlot(print)) {
+		print.cache[writeSlot] = nullptr;
+		ReleaseSemaphore(print.pagesAvailable, 1, nullptr);
+	}
+	for (;;) {
+		const DWORD result = MsgWaitForMultipleObjects(1, &hThread, FALSE, INFINITE, QS_PAINT | QS_KEY);
+		if (result != WAIT_OBJECT_0 + 1) {
+			break;
+		}
+		PrintPumpMessages(print);
+	}
+	CloseHandle(hThread);
+	printAbortContext = nullptr;
+	for (HENHMETAFILE page : print.cache) {
+		if (page) {
+			DeleteEnhMetaFile(page);
+		}
+	}
+	CloseHandle(print.pagesAvailable);
+	CloseHandle(print.slotsFree);
+	CloseHandle(print.cancelEvent);
+
+	DeleteDC(hdcRef);
 	DeleteDC(hdc);
 	if (fontHeader) {
 		DeleteObject(fontHeader);
@@ -449,7 +637,7 @@ bool EditPrint(HWND hwnd, LPCWSTR pszDocTitle, BOOL bDefault) noexcept {
 	// Remove wait cursor...
 	EndWaitCursor();
 
-	return true;
+	return !print.failed;
 }
 
 //=============================================================================
@@ -998,6 +1186,10 @@ int AddStyleSeparator(LPCEDITLEXER pLex, int ch, int chPrev, int style) noexcept
 }
 
 void CodePretty(std::string &output, LPCEDITLEXER pLex, const char *styledText, size_t textLength) {
+	// all input characters are kept plus inserted line breaks and indentation;
+	// pre-size the output so appending chunks doesn't repeatedly reallocate
+	// and copy the whole result for large documents.
+	output.reserve(textLength + textLength/8);
 	char fmtbuf[128];
 	std::string braceStack(1, '\0'); // sentinel
 	memset(fmtbuf, 0, 4);
@@ -1359,7 +1551,63 @@ void EditFormatCode(int menu) noexcept {
 						chPrev = ' ';
 						styledText[index++] = ' ';
 					}
+					// bulk-copy the rest of a long token (string, number):
+					// characters inside a same-style run are kept verbatim.
+					// the stores stay behind the styles still to be read as
+					// index never runs ahead of offset by more than one.
+#if NP2_USE_AVX2
+					const __m256i styleRun = _mm256_set1_epi8(static_cast<char>(style));
+					while (offset + 1 + sizeof(__m256i) <= textLength) {
+						const __m256i styles = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(styledText.get() + offset + 1));
+						if (mm256_movemask_epi8(_mm256_cmpeq_epi8(styles, styleRun)) != UINT32_MAX) {
+							break;
+						}
+						const __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(textBuffer + offset + 1));
+						_mm256_storeu_si256(reinterpret_cast<__m256i *>(styledText.get() + index), chars);
+						index += sizeof(__m256i);
+						offset += sizeof(__m256i);
+						chPrev = static_cast<uint8_t>(textBuffer[offset]);
+					}
+#elif NP2_USE_SSE2
+					const __m128i styleRun = _mm_set1_epi8(static_cast<char>(style));
+					while (offset + 1 + sizeof(__m128i) <= textLength) {
+						const __m128i styles = _mm_loadu_si128(reinterpret_cast<const __m128i *>(styledText.get() + offset + 1));
+						if (mm_movemask_epi8(_mm_cmpeq_epi8(styles, styleRun)) != 0xFFFFU) {
+							break;
+						}
+						const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(textBuffer + offset + 1));
+						_mm_storeu_si128(reinterpret_cast<__m128i *>(styledText.get() + index), chars);
+						index += sizeof(__m128i);
+						offset += sizeof(__m128i);
+						chPrev = static_cast<uint8_t>(textBuffer[offset]);
+					}
+#endif
+				}
+#if NP2_USE_AVX2
+				else {
+					// skip the rest of a whitespace or comment run
+					const __m256i styleRun = _mm256_set1_epi8(static_cast<char>(style));
+					while (offset + 1 + sizeof(__m256i) <= textLength) {
+						const __m256i styles = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(styledText.get() + offset + 1));
+						if (mm256_movemask_epi8(_mm256_cmpeq_epi8(styles, styleRun)) != UINT32_MAX) {
+							break;
+						}
+						offset += sizeof(__m256i);
+					}
 				}
+#elif NP2_USE_SSE2
+				else {
+					// skip the rest of a whitespace or comment run
+					const __m128i styleRun = _mm_set1_epi8(static_cast<char>(style));
+					while (offset + 1 + sizeof(__m128i) <= textLength) {
+						const __m128i styles = _mm_loadu_si128(reinterpret_cast<const __m128i *>(styledText.get() + offset + 1));
+						if (mm_movemask_epi8(_mm_cmpeq_epi8(styles, styleRun)) != 0xFFFFU) {
+							break;
+						}
+						offset += sizeof(__m128i);
+					}
+				}
+#endif
 				stylePrev = style;
 			}
 			styledText[index] = '\0';
@@ -1093,6 +1093,8 @@ static INT_PTR CALLBACK FileMRUDlgProc(HWND hwnd, UINT umsg, WPARAM wParam, LPAR
 
 		// Update view
 		SendWMCommand(hwnd, IDC_FILEMRU_UPDATE_VIEW);
+		// re-resolve entry existence for the OK handler without blocking here
+		MRUPathCacheRefresh();
 		SetDlgItemInt(hwnd, IDC_MRU_COUNT_VALUE, iMaxRecentFiles, FALSE);
 
 		if (bSaveRecentFiles) {
@@ -1217,6 +1219,7 @@ static INT_PTR CALLBACK FileMRUDlgProc(HWND hwnd, UINT umsg, WPARAM wParam, LPAR
 		} else if (pnmhdr->idFrom == IDC_EMPTY_MRU) {
 			if ((pnmhdr->code == NM_CLICK || pnmhdr->code == NM_RETURN)) {
 				mruFile.Empty(false);
+				ClearFileViewStates();
 				if (StrNotEmpty(szCurFile)) {
 					mruFile.Add(szCurFile);
 				}
@@ -1279,7 +1282,9 @@ static INT_PTR CALLBACK FileMRUDlgProc(HWND hwnd, UINT umsg, WPARAM wParam, LPAR
 
 				PathUnquoteSpaces(tch);
 
-				if (!PathIsFile(tch)) {
+				// cached answer: no blocking probe on a dead share, an
+				// unresolved entry is simply attempted.
+				if (MRUPathCacheLookup(tch) == TripleBoolean_False) {
 					// Ask...
 					if (IDYES == MsgBoxWarn(MB_YESNO, IDS_ERR_MRUDLG)) {
 						mruFile.DeleteFileFromStore(tch);
@@ -1834,8 +1839,57 @@ struct ENCODEDLG {
 	int  cxDlg;
 	int  cyDlg;
 	UINT uidLabel;
+	// head of the file on disk, previewed in the selected encoding
+	char *previewData;
+	DWORD cbPreviewData;
 };
 
+// enough to fill the preview many times over, cheap to decode on every
+// selection change.
+constexpr DWORD cbEncodingPreviewMax = 64*1024;
+
+static void SetEncodingPreviewText(HWND hwnd, const ENCODEDLG *pdd, int iEncoding) noexcept {
+	const char *lpData = pdd->previewData;
+	const DWORD cbData = pdd->cbPreviewData;
+	const UINT uFlags = mEncoding[iEncoding].uFlags;
+	LPWSTR textW = static_cast<LPWSTR>(NP2HeapAlloc((cbData + 1)*sizeof(WCHAR)));
+	LPWSTR pszTextW = textW;
+	int cchTextW;
+	if (uFlags & NCP_UNICODE) {
+		cchTextW = static_cast<int>(cbData/sizeof(WCHAR));
+		memcpy(textW, lpData, cchTextW*sizeof(WCHAR));
+		if (uFlags & NCP_UNICODE_REVERSE) {
+			_swab(reinterpret_cast<char *>(textW), reinterpret_cast<char *>(textW), cchTextW*static_cast<int>(sizeof(WCHAR)));
+		}
+		if (cchTextW != 0 && *pszTextW == 0xFEFF) {
+			pszTextW += 1;
+			cchTextW -= 1;
+		}
+	} else {
+		UINT uCodePage = mEncoding[iEncoding].uCodePage;
+		int cb = static_cast<int>(cbData);
+		if (uFlags & NCP_UTF8) {
+			uCodePage = CP_UTF8;
+			if ((uFlags & NCP_UTF8_SIGN) && cb >= 3) {
+				lpData += 3;
+				cb -= 3;
+			}
+		} else if (uFlags & NCP_DEFAULT) {
+			uCodePage = mEncoding[CPI_DEFAULT].uCodePage;
+		}
+		cchTextW = MultiByteToWideChar(uCodePage, 0, lpData, cb, textW, static_cast<int>(cbData));
+	}
+	// the edit control stops at an embedded NUL
+	for (int i = 0; i < cchTextW; i++) {
+		if (pszTextW[i] == L'\0') {
+			pszTextW[i] = L' ';
+		}
+	}
+	pszTextW[cchTextW] = L'\0';
+	SetDlgItemText(hwnd, IDC_ENCODING_PREVIEW, pszTextW);
+	NP2HeapFree(textW);
+}
+
 static INT_PTR CALLBACK SelectDefEncodingDlgProc(HWND hwnd, UINT umsg, WPARAM wParam, LPARAM lParam) noexcept {
 	switch (umsg) {
 	case WM_INITDIALOG: {
@@ -1924,7 +1978,7 @@ static INT_PTR CALLBACK SelectEncodingDlgProc(HWND hwnd, UINT umsg, WPARAM wPara
 	switch (umsg) {
 	case WM_INITDIALOG: {
 		SetWindowLongPtr(hwnd, DWLP_USER, lParam);
-		const ENCODEDLG * const pdd = AsPointer<const ENCODEDLG*>(lParam);
+		ENCODEDLG * const pdd = AsPointer<ENCODEDLG *>(lParam);
 		ResizeDlg_Init(hwnd, pdd->cxDlg, pdd->cyDlg, IDC_RESIZEGRIP);
 
 		WCHAR wch[256];
@@ -1957,6 +2011,41 @@ static INT_PTR CALLBACK SelectEncodingDlgProc(HWND hwnd, UINT umsg, WPARAM wPara
 		TreeView_SetImageList(hwndTV, himl, TVSIL_NORMAL);
 		Encoding_AddToTreeView(hwndTV, pdd->idEncoding, pdd->bRecodeOnly);
 
+		// when reloading, preview the head of the file on disk decoded in the
+		// selected encoding, so a wrong pick is visible before converting the
+		// whole file.
+		if (pdd->bRecodeOnly && StrNotEmpty(szCurFile)) {
+			HANDLE hFile = CreateFile(szCurFile,
+							   GENERIC_READ,
+							   FILE_SHARE_READ | FILE_SHARE_WRITE,
+							   nullptr, OPEN_EXISTING,
+							   FILE_ATTRIBUTE_NORMAL,
+							   nullptr);
+			if (hFile != INVALID_HANDLE_VALUE) {
+				char *lpData = static_cast<char *>(NP2HeapAlloc(cbEncodingPreviewMax));
+				DWORD cbData = 0;
+				const BOOL bReadSuccess = ReadFile(hFile, lpData, cbEncodingPreviewMax, &cbData, nullptr);
+				CloseHandle(hFile);
+				if (bReadSuccess && cbData != 0) {
+					pdd->previewData = lpData;
+					pdd->cbPreviewData = cbData;
+					SetEncodingPreviewText(hwnd, pdd, pdd->idEncoding);
+				} else {
+					NP2HeapFree(lpData);
+				}
+			}
+		}
+		if (pdd->previewData == nullptr) {
+			// nothing to preview: give the space to the encoding list
+			HWND hwndPreview = GetDlgItem(hwnd, IDC_ENCODING_PREVIEW);
+			RECT rc;
+			RECT rcTV;
+			GetWindowRect(hwndPreview, &rc);
+			GetWindowRect(hwndTV, &rcTV);
+			ShowWindow(hwndPreview, SW_HIDE);
+			ResizeDlgCtl(hwnd, IDC_ENCODINGLIST, 0, rc.bottom - rcTV.bottom);
+		}
+
 		CenterDlgInParent(hwnd);
 	}
 	return TRUE;
@@ -1966,6 +2055,10 @@ static INT_PTR CALLBACK SelectEncodingDlgProc(HWND hwnd, UINT umsg, WPARAM wPara
 		ResizeDlg_Destroy(hwnd, &pdd->cxDlg, &pdd->cyDlg);
 		HIMAGELIST himl = TreeView_GetImageList(GetDlgItem(hwnd, IDC_ENCODINGLIST), TVSIL_NORMAL);
 		ImageList_Destroy(himl);
+		if (pdd->previewData != nullptr) {
+			NP2HeapFree(pdd->previewData);
+			pdd->previewData = nullptr;
+		}
 	}
 	return FALSE;
 
@@ -1975,12 +2068,14 @@ static INT_PTR CALLBACK SelectEncodingDlgProc(HWND hwnd, UINT umsg, WPARAM wPara
 
 		ResizeDlg_Size(hwnd, lParam, &dx, &dy);
 
-		HDWP hdwp = BeginDeferWindowPos(4);
+		HDWP hdwp = BeginDeferWindowPos(5);
 		hdwp = DeferCtlPos(hdwp, hwnd, IDC_RESIZEGRIP, dx, dy, SWP_NOSIZE);
 		hdwp = DeferCtlPos(hdwp, hwnd, IDOK, dx, dy, SWP_NOSIZE);
 		hdwp = DeferCtlPos(hdwp, hwnd, IDCANCEL, dx, dy, SWP_NOSIZE);
 		hdwp = DeferCtlPos(hdwp, hwnd, IDC_ENCODINGLIST, dx, dy, SWP_NOMOVE);
+		hdwp = DeferCtlPos(hdwp, hwnd, IDC_ENCODING_PREVIEW, 0, dy, SWP_NOSIZE);
 		EndDeferWindowPos(hdwp);
+		ResizeDlgCtl(hwnd, IDC_ENCODING_PREVIEW, dx, 0);
 	}
 	return TRUE;
 
@@ -2005,6 +2100,12 @@ static INT_PTR CALLBACK SelectEncodingDlgProc(HWND hwnd, UINT umsg, WPARAM wPara
 				EnableWindow(GetDlgItem(hwnd, IDOK), lpnmtv->itemNew.lParam != 0);
 				if (lpnmtv->itemNew.lParam == 0) {
 					TreeView_Expand(GetDlgItem(hwnd, IDC_ENCODINGLIST), lpnmtv->itemNew.hItem, TVE_EXPAND);
+				} else {
+					const ENCODEDLG * const pdd = AsPointer<const ENCODEDLG *>(GetWindowLongPtr(hwnd, DWLP_USER));
+					const int iEncoding = static_cast<int>(lpnmtv->itemNew.lParam - 1);
+					if (pdd->previewData != nullptr && Encoding_IsValid(iEncoding)) {
+						SetEncodingPreviewText(hwnd, pdd, iEncoding);
+					}
 				}
 			}
 			break;
@@ -2052,6 +2153,8 @@ bool SelectEncodingDlg(HWND hwnd, int *pidREncoding, UINT uidLabel) noexcept {
 	dd.cxDlg = cxEncodingDlg;
 	dd.cyDlg = cyEncodingDlg;
 	dd.uidLabel = uidLabel;
+	dd.previewData = nullptr;
+	dd.cbPreviewData = 0;
 
 	const INT_PTR iResult = ThemedDialogBoxParam(g_hInstance, MAKEINTRESOURCE(IDD_SELECT_ENCODING), hwnd, SelectEncodingDlgProc, AsInteger<LPARAM>(&dd));
 
@@ -3034,3 +3137,284 @@ INT_PTR CALLBACK SystemIntegrationDlgProc(HWND hwnd, UINT umsg, WPARAM wParam, L
 void SystemIntegrationDlg(HWND hwnd) noexcept {
 	ThemedDialogBoxParam(g_hInstance, MAKEINTRESOURCE(IDD_SYSTEM_INTEGRATION), hwnd, SystemIntegrationDlgProc, 0);
 }
+
+//=============================================================================
+//
+// CommandPaletteDlgProc()
+//
+// fuzzy searchable flat list of every command on the main menu.
+//
+namespace {
+
+constexpr UINT MaxCommandPaletteItemSize = 128;
+constexpr UINT MaxCommandPaletteResults = 96;
+constexpr UINT MaxCommandPaletteMRU = 12;
+
+struct CommandPaletteItem {
+	UINT id;
+	int score;
+	WCHAR text[MaxCommandPaletteItemSize];
+};
+
+CommandPaletteItem *paletteItemList = nullptr;
+UINT paletteItemCount = 0;
+// commands executed through the palette this session, most recent first.
+UINT paletteMRUList[MaxCommandPaletteMRU];
+
+// append menu item text with mnemonic ampersands stripped and any
+// accelerator hint after the tab dropped.
+UINT CommandPaletteAppendText(LPWSTR dest, UINT index, LPCWSTR text) noexcept {
+	while (*text != L'\0' && *text != L'\t' && index < MaxCommandPaletteItemSize - 1) {
+		WCHAR ch = *text++;
+		if (ch == L'&') {
+			if (*text != L'&') {
+				continue;
+			}
+			++text; // keep literal '&&' as '&'
+		}
+		dest[index++] = ch;
+	}
+	dest[index] = L'\0';
+	return index;
+}
+
+// walk the menu tree, flattening popups with a " > " joined path.
+// two passes share this function: with a null list only count the items.
+void CommandPaletteAddMenu(HMENU hmenu, LPCWSTR prefix) noexcept {
+	WCHAR path[MaxCommandPaletteItemSize];
+	WCHAR name[MaxCommandPaletteItemSize];
+	const int count = GetMenuItemCount(hmenu);
+	for (int index = 0; index < count; index++) {
+		MENUITEMINFO mii;
+		mii.cbSize = sizeof(MENUITEMINFO);
+		mii.fMask = MIIM_ID | MIIM_SUBMENU | MIIM_FTYPE | MIIM_STRING;
+		mii.dwTypeData = name;
+		mii.cch = COUNTOF(name);
+		if (!GetMenuItemInfo(hmenu, index, TRUE, &mii) || (mii.fType & MFT_SEPARATOR) != 0) {
+			continue;
+		}
+		if (mii.hSubMenu != nullptr) {
+			UINT len = lstrlen(prefix);
+			memcpy(path, prefix, len * sizeof(WCHAR));
+			len = CommandPaletteAppendText(path, len, name);
+			if (len < MaxCommandPaletteItemSize - 3) {
+				memcpy(path + len, L" > ", 4 * sizeof(WCHAR));
+			}
+			CommandPaletteAddMenu(mii.hSubMenu, path);
+		} else if (mii.wID != 0) {
+			if (paletteItemList != nullptr) {
+				CommandPaletteItem &item = paletteItemList[paletteItemCount];
+				item.id = mii.wID;
+				const UINT len = lstrlen(prefix);
+				memcpy(item.text, prefix, len * sizeof(WCHAR));
+				CommandPaletteAppendText(item.text, len, name);
+			}
+			++paletteItemCount;
+		}
+	}
+}
+
+constexpr WCHAR PaletteToLower(WCHAR ch) noexcept {
+	return (ch >= L'A' && ch <= L'Z') ? (ch + L'a' - L'A') : ch;
+}
+
+// greedy case insensitive subsequence match: every pattern character must
+// appear in order, word starts and runs of adjacent matches score higher.
+// spaces in the pattern only reset adjacency, so "fil sav" works naturally.
+int CommandPaletteFuzzyScore(LPCWSTR text, LPCWSTR pattern) noexcept {
+	int score = 0;
+	bool adjacent = false;
+	WCHAR chPrev = L' ';
+	for (WCHAR ch = *pattern++; ch != L'\0'; ch = *pattern++) {
+		if (ch == L' ') {
+			adjacent = false;
+			continue;
+		}
+		ch = PaletteToLower(ch);
+		bool matched = false;
+		while (*text != L'\0') {
+			const WCHAR chText = *text++;
+			if (PaletteToLower(chText) == ch) {
+				if (adjacent) {
+					score += 4;
+				} else if (chPrev == L' ' || chPrev == L'>') {
+					score += 8;
+				} else {
+					score += 1;
+				}
+				adjacent = true;
+				chPrev = chText;
+				matched = true;
+				break;
+			}
+			adjacent = false;
+			chPrev = chText;
+		}
+		if (!matched) {
+			return -1;
+		}
+	}
+	return score;
+}
+
+void CommandPaletteUpdateList(HWND hwndList, LPCWSTR pattern) noexcept {
+	SendMessage(hwndList, WM_SETREDRAW, FALSE, 0);
+	ListBox_ResetContent(hwndList);
+	for (UINT index = 0; index < paletteItemCount; index++) {
+		CommandPaletteItem &item = paletteItemList[index];
+		int score = CommandPaletteFuzzyScore(item.text, pattern);
+		if (score >= 0) {
+			for (UINT slot = 0; slot < MaxCommandPaletteMRU; slot++) {
+				if (paletteMRUList[slot] == item.id) {
+					score += (MaxCommandPaletteMRU - slot) * 32;
+					break;
+				}
+			}
+		}
+		item.score = score;
+	}
+
+	for (UINT added = 0; added < MaxCommandPaletteResults; added++) {
+		int best = -1;
+		UINT bestIndex = 0;
+		for (UINT index = 0; index < paletteItemCount; index++) {
+			if (paletteItemList[index].score > best) {
+				best = paletteItemList[index].score;
+				bestIndex = index;
+			}
+		}
+		if (best < 0) {
+			break;
+		}
+		paletteItemList[bestIndex].score = -1;
+		const int lbIndex = ListBox_AddString(hwndList, paletteItemList[bestIndex].text);
+		ListBox_SetItemData(hwndList, lbIndex, paletteItemList[bestIndex].id);
+	}
+
+	ListBox_SetCurSel(hwndList, 0);
+	SendMessage(hwndList, WM_SETREDRAW, TRUE, 0);
+	InvalidateRect(hwndList, nullptr, TRUE);
+}
+
+void CommandPaletteExecute(HWND hwnd) noexcept {
+	HWND hwndList = GetDlgItem(hwnd, IDC_PALETTE_LIST);
+	const int index = ListBox_GetCurSel(hwndList);
+	if (index < 0) {
+		return;
+	}
+	const UINT id = static_cast<UINT>(ListBox_GetItemData(hwndList, index));
+	UINT slot = MaxCommandPaletteMRU - 1;
+	for (UINT i = 0; i < MaxCommandPaletteMRU; i++) {
+		if (paletteMRUList[i] == id) {
+			slot = i;
+			break;
+		}
+	}
+	memmove(paletteMRUList + 1, paletteMRUList, slot * sizeof(UINT));
+	paletteMRUList[0] = id;
+	EndDialog(hwnd, IDOK);
+	// post after the dialog is gone so commands that inspect the active
+	// window or open their own dialog see the main window.
+	PostWMCommand(hwndMain, id);
+}
+
+LRESULT CALLBACK CommandPaletteEditProc(HWND hwnd, UINT umsg, WPARAM wParam, LPARAM lParam, UINT_PTR uIdSubclass, DWORD_PTR dwRefData) noexcept {
+	UNREFERENCED_PARAMETER(dwRefData);
+	switch (umsg) {
+	case WM_KEYDOWN: {
+		int delta;
+		switch (wParam) {
+		case VK_UP:
+			delta = -1;
+			break;
+		case VK_DOWN:
+			delta = 1;
+			break;
+		case VK_PRIOR:
+			delta = -8;
+			break;
+		case VK_NEXT:
+			delta = 8;
+			break;
+		default:
+			delta = 0;
+			break;
+		}
+		if (delta != 0) {
+			HWND hwndList = GetDlgItem(GetParent(hwnd), IDC_PALETTE_LIST);
+			const int count = ListBox_GetCount(hwndList);
+			if (count > 0) {
+				int index = ListBox_GetCurSel(hwndList) + delta;
+				index = clamp(index, 0, count - 1);
+				ListBox_SetCurSel(hwndList, index);
+			}
+			return 0;
+		}
+	}
+	break;
+
+	case WM_NCDESTROY:
+		RemoveWindowSubclass(hwnd, CommandPaletteEditProc, uIdSubclass);
+		break;
+	}
+	return DefSubclassProc(hwnd, umsg, wParam, lParam);
+}
+
+INT_PTR CALLBACK CommandPaletteDlgProc(HWND hwnd, UINT umsg, WPARAM wParam, LPARAM lParam) noexcept {
+	UNREFERENCED_PARAMETER(lParam);
+	switch (umsg) {
+	case WM_INITDIALOG: {
+		paletteItemCount = 0;
+		CommandPaletteAddMenu(GetMenu(hwndMain), L"");
+		paletteItemList = static_cast<CommandPaletteItem *>(NP2HeapAlloc(paletteItemCount * sizeof(CommandPaletteItem)));
+		paletteItemCount = 0;
+		CommandPaletteAddMenu(GetMenu(hwndMain), L"");
+
+		HWND hwndEdit = GetDlgItem(hwnd, IDC_PALETTE_QUERY);
+		SendMessage(hwndEdit, EM_LIMITTEXT, MaxCommandPaletteItemSize - 1, 0);
+		SetWindowSubclass(hwndEdit, CommandPaletteEditProc, 0, 0);
+		CommandPaletteUpdateList(GetDlgItem(hwnd, IDC_PALETTE_LIST), L"");
+		CenterDlgInParent(hwnd);
+	}
+	return TRUE;
+
+	case WM_COMMAND:
+		switch (LOWORD(wParam)) {
+		case IDC_PALETTE_QUERY:
+			if (HIWORD(wParam) == EN_CHANGE) {
+				WCHAR pattern[MaxCommandPaletteItemSize];
+				GetDlgItemText(hwnd, IDC_PALETTE_QUERY, pattern, COUNTOF(pattern));
+				CommandPaletteUpdateList(GetDlgItem(hwnd, IDC_PALETTE_LIST), pattern);
+			}
+			break;
+
+		case IDC_PALETTE_LIST:
+			if (HIWORD(wParam) == LBN_DBLCLK) {
+				CommandPaletteExecute(hwnd);
+			}
+			break;
+
+		case IDOK:
+			CommandPaletteExecute(hwnd);
+			break;
+
+		case IDCANCEL:
+			EndDialog(hwnd, IDCANCEL);
+			break;
+		}
+		return TRUE;
+
+	case WM_DESTROY:
+		NP2HeapFree(paletteItemList);
+		paletteItemList = nullptr;
+		paletteItemCount = 0;
+		return FALSE;
+	}
+	return FALSE;
+}
+
+}
+
+void CommandPaletteDlg(HWND hwnd) noexcept {
+	ThemedDialogBoxParam(g_hInstance, MAKEINTRESOURCE(IDD_COMMANDPALETTE), hwnd, CommandPaletteDlgProc, 0);
+}
@@ -55,6 +55,7 @@ bool	WarnLineEndingDlg(HWND hwnd, EditFileIOStatus *status) noexcept;
 void	InitZoomLevelComboBox(HWND hwnd, int nCtlId, int zoomLevel) noexcept;
 bool	GetZoomLevelComboBoxValue(HWND hwnd, int nCtrId, int *zoomLevel) noexcept;
 void	ZoomLevelDlg(HWND hwnd, bool bBottom) noexcept;
+void	CommandPaletteDlg(HWND hwnd) noexcept;
 bool	AutoCompletionSettingsDlg(HWND hwnd) noexcept;
 bool	AutoSaveSettingsDlg(HWND hwnd) noexcept;
 
@@ -34,10 +34,14 @@ struct IUnknown;
 #include <climits>
 #include <cinttypes>
 #include "SciCall.h"
+#include "ILoader.h"
+#include "ParallelSupport.h"
+#include "TraceEvents.h"
 #include "VectorISA.h"
 #include "Helpers.h"
 #include "Notepad4.h"
 #include "Edit.h"
+#include "EditPageView.h"
 #include "Styles.h"
 #include "Dialogs.h"
 #include "resource.h"
@@ -66,6 +70,7 @@ extern int iCurrentEncoding;
 
 extern MRUList mruFind;
 extern MRUList mruReplace;
+extern MRUList mruSavedFind;
 
 static LPWSTR wchPrefixSelection;
 static LPWSTR wchAppendSelection;
@@ -134,10 +139,74 @@ extern bool bLargeFileMode;
 extern int iWrapColumn;
 extern int iWordWrapIndent;
 
+namespace {
+
+// For big files the document is built on a worker thread through ILoader,
+// so buffer growth and line parsing happen off the UI thread while the
+// window keeps painting, then the finished document is attached in one step.
+constexpr DWORD AsyncLoadThreshold = 32u << 20;
+constexpr DWORD AsyncLoadChunkSize = 4u << 20;
+
+struct DocumentLoader {
+	Scintilla::ILoader *loader;
+	LPCSTR text;
+	DWORD length;
+	int status;
+};
+
+DWORD WINAPI EditLoadDocumentThread(LPVOID lpParam) noexcept {
+	DocumentLoader * const load = static_cast<DocumentLoader *>(lpParam);
+	DWORD offset = 0;
+	while (offset < load->length) {
+		const DWORD chunk = min(AsyncLoadChunkSize, load->length - offset);
+		load->status = load->loader->AddData(load->text + offset, chunk);
+		if (load->status != SC_STATUS_OK) {
+			break;
+		}
+		offset += chunk;
+	}
+	return 0;
+}
+
+bool EditLoadTextInBackground(LPCSTR lpstrText, DWORD cbText) noexcept {
+	Scintilla::ILoader * const loader = static_cast<Scintilla::ILoader *>(SciCall_CreateLoader(cbText + 1, SciCall_GetDocumentOptions()));
+	if (loader == nullptr) {
+		return false;
+	}
+	DocumentLoader load = { loader, lpstrText, cbText, SC_STATUS_OK };
+	HANDLE hThread = CreateThread(nullptr, 0, EditLoadDocumentThread, &load, 0, nullptr);
+	if (hThread == nullptr) {
+		loader->Release();
+		return false;
+	}
+	// dispatch paint messages only: the window stays live without letting
+	// commands re-enter the load path.
+	for (;;) {
+		const DWORD result = MsgWaitForMultipleObjects(1, &hThread, FALSE, INFINITE, QS_PAINT);
+		if (result != WAIT_OBJECT_0 + 1) {
+			break;
+		}
+		MSG msg;
+		while (PeekMessage(&msg, nullptr, WM_PAINT, WM_PAINT, PM_REMOVE)) {
+			DispatchMessage(&msg);
+		}
+	}
+	CloseHandle(hThread);
+	if (load.status != SC_STATUS_OK) {
+		loader->Release();
+		return false;
+	}
+	EditReplaceDocument(loader->ConvertToDocument());
+	return true;
+}
+
+}
+
 void EditSetNewText(LPCSTR lpstrText, DWORD cbText, Sci_Line lineCount) noexcept {
 	bFreezeAppTitle = true;
 	bReadOnlyMode = false;
 	iWrapColumn = 0;
+	EditResetSavedFileState();
 
 	SciCall_SetReadOnly(false);
 	SciCall_Cancel();
@@ -147,6 +216,8 @@ void EditSetNewText(LPCSTR lpstrText, DWORD cbText, Sci_Line lineCount) noexcept
 	SciCall_ClearAll();
 	SciCall_ClearMarker();
 	SciCall_SetXOffset(0);
+	foldOutline.Empty();
+	EditElasticTabStopsOnNewDocument();
 
 #if defined(_WIN64)
 	// enable conversion between line endings
@@ -170,8 +241,10 @@ void EditSetNewText(LPCSTR lpstrText, DWORD cbText, Sci_Line lineCount) noexcept
 		StopWatch watch;
 		watch.Start();
 #endif
-		SciCall_AllocateLines(lineCount);
-		SciCall_AppendText(cbText, lpstrText);
+		if (cbText < AsyncLoadThreshold || !EditLoadTextInBackground(lpstrText, cbText)) {
+			SciCall_AllocateLines(lineCount);
+			SciCall_AppendText(cbText, lpstrText);
+		}
 #if 0
 		watch.Stop();
 		watch.ShowLog("AddText time");
@@ -203,17 +276,14 @@ bool EditConvertText(UINT cpSource, UINT cpDest) noexcept {
 		return true;
 	}
 
+	// Take one copy of the source text, then stream it through fixed size
+	// conversion buffers into the re-encoded document, so the transient memory
+	// is the source copy plus two chunk buffers instead of whole document
+	// worst case allocations for both conversion directions.
 	char *pchText = nullptr;
-	int cbText = 0;
 	if (length > 0) {
-		// DBCS: length -> WCHAR: sizeof(WCHAR) * (length / 2) -> UTF-8: kMaxMultiByteCount * (length / 2)
-		pchText = static_cast<char *>(NP2HeapAlloc((length + 1) * sizeof(WCHAR)));
+		pchText = static_cast<char *>(NP2HeapAlloc(length + 1));
 		SciCall_GetText(length, pchText);
-
-		WCHAR *pwchText = static_cast<WCHAR *>(NP2HeapAlloc((length + 1) * sizeof(WCHAR)));
-		const int cbwText = MultiByteToWideChar(cpSource, 0, pchText, static_cast<int>(length), pwchText, static_cast<int>(NP2HeapSize(pwchText) / sizeof(WCHAR)));
-		cbText = WideCharToMultiByte(cpDest, 0, pwchText, cbwText, pchText, static_cast<int>(NP2HeapSize(pchText)), nullptr, nullptr);
-		NP2HeapFree(pwchText);
 	}
 
 	bReadOnlyMode = false;
@@ -226,13 +296,47 @@ bool EditConvertText(UINT cpSource, UINT cpDest) noexcept {
 	SciCall_ClearMarker();
 	SciCall_SetCodePage(cpDest);
 
-	if (cbText > 0) {
+	if (length > 0) {
+		// one byte of source text becomes at most one WCHAR, a straddling DBCS
+		// pair can push one trail byte past the chunk cut, hence the extra WCHAR.
+		constexpr Sci_Position cbChunkSize = 1024*1024;
+		WCHAR *pwchChunk = static_cast<WCHAR *>(NP2HeapAlloc((cbChunkSize + 1) * sizeof(WCHAR)));
+		char *pchChunk = static_cast<char *>(NP2HeapAlloc((cbChunkSize + 1) * kMaxMultiByteCount));
+		const bool dbcs = !(cpSource == CP_UTF8 || cpSource == 0);
 		SendMessage(hwndEdit, WM_SETREDRAW, FALSE, 0);
 		SciCall_SetModEventMask(SC_MOD_NONE);
-		SciCall_AppendText(cbText, pchText);
+		Sci_Position pos = 0;
+		while (pos < length) {
+			const char * const chunk = pchText + pos;
+			Sci_Position cbChunk = min(length - pos, cbChunkSize);
+			if (pos + cbChunk < length) {
+				// Cut the chunk at a character boundary of the source encoding.
+				if (cpSource == CP_UTF8) {
+					Sci_Position cut = cbChunk;
+					while (cut > 0 && (chunk[cut] & 0xC0) == 0x80) {
+						cut--;
+					}
+					if (cut != 0) {
+						cbChunk = cut;
+					}
+				} else if (dbcs) {
+					Sci_Position i = 0;
+					while (i < cbChunk) {
+						i += (IsDBCSLeadByteEx(cpSource, chunk[i]) && pos + i + 1 < length) ? 2 : 1;
+					}
+					cbChunk = i;
+				}
+			}
+			const int cbwText = MultiByteToWideChar(cpSource, 0, chunk, static_cast<int>(cbChunk), pwchChunk, static_cast<int>(cbChunkSize + 1));
+			const int cbText = WideCharToMultiByte(cpDest, 0, pwchChunk, cbwText, pchChunk, static_cast<int>(NP2HeapSize(pchChunk)), nullptr, nullptr);
+			SciCall_AppendText(cbText, pchChunk);
+			pos += cbChunk;
+		}
 		SciCall_SetModEventMask(SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT);
 		SendMessage(hwndEdit, WM_SETREDRAW, TRUE, 0);
 		InvalidateRect(hwndEdit, nullptr, TRUE);
+		NP2HeapFree(pwchChunk);
+		NP2HeapFree(pchChunk);
 	}
 	if (pchText != nullptr) {
 		NP2HeapFree(pchText);
@@ -403,6 +507,75 @@ LPWSTR EditGetClipboardTextW() noexcept {
 //
 // EditCopyAppend()
 //
+// Appended fragments are collected into a growable buffer while the main
+// window owns the clipboard with a delayed rendering promise, so appending is
+// O(fragment) instead of rewriting the whole clipboard each invocation; the
+// combined text is only materialized when something requests it.
+namespace {
+struct EditCopyAppendCollector {
+	WCHAR *buffer;
+	size_t length;		// collected characters, excluding the terminating NUL
+	size_t capacity;	// allocated characters
+	bool rendered;		// the promise was rendered since the last append
+};
+}
+
+static EditCopyAppendCollector copyAppendCollector;
+
+static void EditCopyAppendCollect(LPCWSTR pszText, size_t cch) noexcept {
+	EditCopyAppendCollector &collector = copyAppendCollector;
+	if (collector.length + cch >= collector.capacity) {
+		size_t capacity = (collector.capacity == 0) ? 512 : collector.capacity*2;
+		while (capacity <= collector.length + cch) {
+			capacity *= 2;
+		}
+		WCHAR *buffer;
+		if (collector.buffer == nullptr) {
+			buffer = static_cast<WCHAR *>(NP2HeapAlloc(capacity * sizeof(WCHAR)));
+		} else {
+			buffer = static_cast<WCHAR *>(NP2HeapReAlloc(collector.buffer, capacity * sizeof(WCHAR)));
+		}
+		collector.buffer = buffer;
+		collector.capacity = NP2HeapSize(buffer) / sizeof(WCHAR);
+	}
+	memcpy(collector.buffer + collector.length, pszText, cch * sizeof(WCHAR));
+	collector.length += cch;
+}
+
+// WM_RENDERFORMAT: materialize the collected text for whoever asked for it.
+void EditCopyAppendRender(UINT format) noexcept {
+	if (format == CF_UNICODETEXT && copyAppendCollector.buffer != nullptr) {
+		HANDLE hNew = GlobalAlloc(GMEM_MOVEABLE, (copyAppendCollector.length + 1) * sizeof(WCHAR));
+		WCHAR *pszNew = static_cast<WCHAR *>(GlobalLock(hNew));
+		if (pszNew != nullptr) {
+			memcpy(pszNew, copyAppendCollector.buffer, copyAppendCollector.length * sizeof(WCHAR));
+			pszNew[copyAppendCollector.length] = L'\0';
+			GlobalUnlock(hNew);
+			SetClipboardData(CF_UNICODETEXT, hNew);
+			copyAppendCollector.rendered = true;
+		}
+	}
+}
+
+// WM_RENDERALLFORMATS: the main window is being destroyed while it still owns
+// the clipboard.
+void EditCopyAppendRenderAll(HWND hwnd) noexcept {
+	if (OpenClipboard(hwnd)) {
+		if (GetClipboardOwner() == hwnd) {
+			EditCopyAppendRender(CF_UNICODETEXT);
+		}
+		CloseClipboard();
+	}
+}
+
+// WM_DESTROYCLIPBOARD: something else took the clipboard over.
+void EditCopyAppendDestroy() noexcept {
+	if (copyAppendCollector.buffer != nullptr) {
+		NP2HeapFree(copyAppendCollector.buffer);
+	}
+	copyAppendCollector = {};
+}
+
 bool EditCopyAppend(HWND hwnd) noexcept {
 	if (!IsClipboardFormatAvailable(CF_UNICODETEXT)) {
 		SciCall_Copy(false);
@@ -439,24 +612,47 @@ bool EditCopyAppend(HWND hwnd) noexcept {
 	NP2HeapFree(pszText);
 
 	bool succ = false;
-	if (OpenClipboard(GetParent(hwnd))) {
+	HWND hwndOwner = GetParent(hwnd);
+	if (copyAppendCollector.buffer != nullptr && GetClipboardOwner() == hwndOwner) {
+		// already collecting: append the fragment and leave the clipboard
+		// promise pending.
+		if (pszTextW != nullptr) {
+			EditCopyAppendCollect(pszTextW, lstrlen(pszTextW));
+		}
+		succ = true;
+		if (copyAppendCollector.rendered && OpenClipboard(hwndOwner)) {
+			// the rendered text is stale now, renew the promise.
+			copyAppendCollector.rendered = false;
+			SetClipboardData(CF_UNICODETEXT, nullptr);
+			CloseClipboard();
+		}
+	} else if (OpenClipboard(hwndOwner)) {
+		// seed the collector with the current clipboard text, then take the
+		// clipboard over with a delayed rendering promise.
 		HANDLE hOld = GetClipboardData(CF_UNICODETEXT);
 		LPCWSTR pszOld = static_cast<LPCWSTR>(GlobalLock(hOld));
-
-		HANDLE hNew = GlobalAlloc(GMEM_MOVEABLE | GMEM_ZEROINIT,
-						   sizeof(WCHAR) * (lstrlen(pszOld) + lstrlen(pszTextW) + 1));
-		WCHAR *pszNew = static_cast<WCHAR *>(GlobalLock(hNew));
-
-		lstrcpy(pszNew, pszOld);
-		lstrcat(pszNew, pszTextW);
-
+		WCHAR *pszSeed = nullptr;
+		int cchSeed = 0;
+		if (pszOld != nullptr) {
+			cchSeed = lstrlen(pszOld);
+			pszSeed = static_cast<WCHAR *>(NP2HeapAlloc((cchSeed + 1) * sizeof(WCHAR)));
+			memcpy(pszSeed, pszOld, cchSeed * sizeof(WCHAR));
+		}
 		GlobalUnlock(hOld);
-		GlobalUnlock(hNew);
 
+		// EmptyClipboard() frees the old data and notifies the old owner,
+		// which resets the collector when this window owned the clipboard
+		// for another format, so collect only afterwards.
 		EmptyClipboard();
-		SetClipboardData(CF_UNICODETEXT, hNew);
+		if (pszSeed != nullptr) {
+			EditCopyAppendCollect(pszSeed, cchSeed);
+			NP2HeapFree(pszSeed);
+		}
+		if (pszTextW != nullptr) {
+			EditCopyAppendCollect(pszTextW, lstrlen(pszTextW));
+		}
+		SetClipboardData(CF_UNICODETEXT, nullptr);
 		CloseClipboard();
-
 		succ = true;
 	}
 
@@ -960,11 +1156,62 @@ labelStart:
 #endif
 }
 
+//=============================================================================
+//
+// EditFreeFileData()
+// release the raw file content, either a heap buffer or a mapped view.
+//
+static void EditFreeFileData(char *lpData, HANDLE hFileMapping) noexcept {
+	if (hFileMapping) {
+		UnmapViewOfFile(lpData);
+		CloseHandle(hFileMapping);
+	} else {
+		NP2HeapFree(lpData);
+	}
+}
+
+//=============================================================================
+//
+// EditComputeLineStatistics()
+// max and ~95th percentile line length over the line starts Scintilla just
+// built, so FileLoad() can flip mitigations (wrap off, whole document layout
+// cache, brace match skipping) for pathological long line documents at load
+// instead of becoming unresponsive on the first layout.
+//
+static void EditComputeLineStatistics(EditFileIOStatus &status) noexcept {
+	if (SciCall_GetLength() < NP2_LONG_LINE_MITIGATION_LIMIT) {
+		return; // no line can be pathological
+	}
+	const Sci_Line lineCount = SciCall_GetLineCount();
+	Sci_Line histogram[32] = {}; // log2 buckets: [1 << k, 2 << k)
+	Sci_Position maxLength = 0;
+	Sci_Position prev = 0;
+	for (Sci_Line line = 1; line <= lineCount; line++) {
+		const Sci_Position next = SciCall_PositionFromLine(line);
+		const Sci_Position length = next - prev; // including the line ending
+		prev = next;
+		maxLength = max(maxLength, length);
+		histogram[np2::bsr(static_cast<uint32_t>(min<Sci_Position>(length, INT32_MAX)) | 1)] += 1;
+	}
+	status.maxLineLength = maxLength;
+	// upper bound of the first bucket covering 95% of the lines
+	const Sci_Line bound = lineCount - lineCount/20;
+	Sci_Line cumulative = 0;
+	for (unsigned k = 0; k < COUNTOF(histogram); k++) {
+		cumulative += histogram[k];
+		if (cumulative >= bound) {
+			status.percentileLineLength = min<Sci_Position>(maxLength, static_cast<Sci_Position>(2) << k);
+			break;
+		}
+	}
+}
+
 //=============================================================================
 //
 // EditLoadFile()
 //
 bool EditLoadFile(LPWSTR pszFile, EditFileIOStatus &status) noexcept {
+	NP2_TRACE_SCOPE("EditLoadFile");
 	HANDLE hFile = CreateFile(pszFile,
 					   GENERIC_READ,
 					   FILE_SHARE_READ | FILE_SHARE_WRITE,
@@ -1029,20 +1276,52 @@ bool EditLoadFile(LPWSTR pszFile, EditFileIOStatus &status) noexcept {
 		StrFormatByteSize(maxFileSize, tchMaxSize, COUNTOF(tchMaxSize));
 		FormatNumber64(tchDocBytes, fileSize.QuadPart);
 		FormatNumber64(tchMaxBytes, maxFileSize);
-		MsgBoxWarn(MB_OK, IDS_WARNLOADBIGFILE, pszFile, tchDocSize, tchDocBytes, tchMaxSize, tchMaxBytes);
+		// offer the windowed read-only view instead of refusing outright,
+		// see EditPageView.cpp; the caller starts it off the bPagedView flag.
+		if (MsgBoxAsk(MB_YESNO, IDS_ASK_PAGED_VIEW, pszFile, tchDocSize, tchDocBytes, tchMaxSize, tchMaxBytes) == IDYES) {
+			status.bPagedView = true;
+		}
 		return false;
 	}
 
-	char *lpData = static_cast<char *>(NP2HeapAlloc(static_cast<size_t>(fileSize.QuadPart) + NP2_ENCODING_DETECTION_PADDING));
-	DWORD cbData = 0;
-	const BOOL bReadSuccess = ReadFile(hFile, lpData, static_cast<DWORD>(fileSize.QuadPart), &cbData, nullptr);
-	dwLastIOError = GetLastError();
-	CloseHandle(hFile);
+	// Map large files into memory instead of reading them into a second full-size
+	// heap buffer, which halves peak memory and avoids the long blocking ReadFile().
+	// The view is mapped copy-on-write so in-place fix-up during encoding detection
+	// (e.g. UTF-16 byte swapping) stays private to this process.
+	char *lpData = nullptr;
+	HANDLE hFileMapping = nullptr;
+	constexpr LONGLONG minFileMappingSize = 32 << 20;
+	if (fileSize.QuadPart >= minFileMappingSize) {
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		const DWORD remain = static_cast<DWORD>(fileSize.QuadPart) & (info.dwPageSize - 1);
+		// encoding detection over-reads up to NP2_ENCODING_DETECTION_PADDING bytes,
+		// which must stay inside the zero-filled tail of the last mapped page.
+		if (remain != 0 && remain + NP2_ENCODING_DETECTION_PADDING <= info.dwPageSize) {
+			hFileMapping = CreateFileMapping(hFile, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+			if (hFileMapping) {
+				lpData = static_cast<char *>(MapViewOfFile(hFileMapping, FILE_MAP_COPY, 0, 0, 0));
+				if (lpData == nullptr) {
+					CloseHandle(hFileMapping);
+					hFileMapping = nullptr;
+				}
+			}
+		}
+	}
 
-	if (!bReadSuccess) {
-		NP2HeapFree(lpData);
-		return false;
+	DWORD cbData = static_cast<DWORD>(fileSize.QuadPart);
+	if (lpData == nullptr) {
+		lpData = static_cast<char *>(NP2HeapAlloc(static_cast<size_t>(fileSize.QuadPart) + NP2_ENCODING_DETECTION_PADDING));
+		cbData = 0;
+		const BOOL bReadSuccess = ReadFile(hFile, lpData, static_cast<DWORD>(fileSize.QuadPart), &cbData, nullptr);
+		dwLastIOError = GetLastError();
+		if (!bReadSuccess) {
+			CloseHandle(hFile);
+			NP2HeapFree(lpData);
+			return false;
+		}
 	}
+	CloseHandle(hFile);
 
 	status.iEOLMode = GetScintillaEOLMode(iDefaultEOLMode);
 	status.bInconsistent = false;
@@ -1061,7 +1340,7 @@ bool EditLoadFile(LPWSTR pszFile, EditFileIOStatus &status) noexcept {
 		SciCall_SetCodePage((uFlags & NCP_DEFAULT) ? iDefaultCodePage : SC_CP_UTF8);
 		EditSetEmptyText();
 		SciCall_SetEOLMode(status.iEOLMode);
-		NP2HeapFree(lpData);
+		EditFreeFileData(lpData, hFileMapping);
 		return true;
 	}
 
@@ -1086,7 +1365,8 @@ bool EditLoadFile(LPWSTR pszFile, EditFileIOStatus &status) noexcept {
 			cbData -= 1;
 		}
 
-		NP2HeapFree(lpData);
+		EditFreeFileData(lpData, hFileMapping);
+		hFileMapping = nullptr;
 		lpData = lpDataUTF8;
 		fvCurFile.Init(lpData, cbData);
 	} else if (uFlags & NCP_UTF8) {
@@ -1098,7 +1378,8 @@ bool EditLoadFile(LPWSTR pszFile, EditFileIOStatus &status) noexcept {
 		if (encodingFlag != EncodingFlag_UTF7 || (uFlags & NCP_7BIT) != 0) {
 			const UINT uCodePage = mEncoding[iEncoding].uCodePage;
 			lpDataUTF8 = RecodeAsUTF8(lpData, &cbData, uCodePage, 0);
-			NP2HeapFree(lpData);
+			EditFreeFileData(lpData, hFileMapping);
+			hFileMapping = nullptr;
 			lpData = lpDataUTF8;
 		}
 	} else if (cbData < MAX_NON_UTF8_SIZE && (encodingFlag & (EncodingFlag_Binary | EncodingFlag_Invalid)) == 0
@@ -1109,7 +1390,8 @@ bool EditLoadFile(LPWSTR pszFile, EditFileIOStatus &status) noexcept {
 		const UINT legacyACP = mEncoding[CPI_DEFAULT].uCodePage;
 		char * const result = RecodeAsUTF8(lpData, &back, legacyACP, MB_ERR_INVALID_CHARS);
 		if (result) {
-			NP2HeapFree(lpData);
+			EditFreeFileData(lpData, hFileMapping);
+			hFileMapping = nullptr;
 			lpDataUTF8 = result;
 			lpData = result;
 			cbData = back;
@@ -1124,11 +1406,232 @@ bool EditLoadFile(LPWSTR pszFile, EditFileIOStatus &status) noexcept {
 	}
 	SciCall_SetCodePage((uFlags & NCP_DEFAULT) ? iDefaultCodePage : SC_CP_UTF8);
 	EditSetNewText(lpDataUTF8, cbData, status.totalLineCount);
+	EditComputeLineStatistics(status);
 
-	NP2HeapFree(lpData);
+	EditFreeFileData(lpData, hFileMapping);
 	return true;
 }
 
+// Incremental save bookkeeping: the document range modified since the last
+// save and the payload (after any BOM) written by that save. Only maintained
+// for pass-through encodings where document bytes equal file bytes.
+static Sci_Position dirtyRangeStart = PTRDIFF_MAX;
+static Sci_Position cleanSuffixLength = PTRDIFF_MAX;
+static LONGLONG savedPayloadSize = -1;
+static int savedEncoding = CPI_NONE;
+static FILETIME savedWriteTime;
+// copy of the payload written by the last save, kept so a change notification
+// can diff the rewritten disk file against what we last wrote and splice in
+// external changes that don't overlap the unsaved edits.
+static char *savedPayload = nullptr;
+static bool savedWithBOM = false;
+// beyond this the snapshot doubles the working set for little gain.
+constexpr LONGLONG MaxMergeSnapshotSize = 64*1024*1024;
+
+void EditMarkDirtyRange(Sci_Position position, Sci_Position changeEnd) noexcept {
+	dirtyRangeStart = min(dirtyRangeStart, position);
+	cleanSuffixLength = min(cleanSuffixLength, SciCall_GetLength() - changeEnd);
+}
+
+void EditResetSavedFileState() noexcept {
+	dirtyRangeStart = PTRDIFF_MAX;
+	cleanSuffixLength = PTRDIFF_MAX;
+	savedPayloadSize = -1;
+	savedEncoding = CPI_NONE;
+	if (savedPayload != nullptr) {
+		NP2HeapFree(savedPayload);
+		savedPayload = nullptr;
+	}
+}
+
+//=============================================================================
+//
+// EditWriteFileData()
+// write document bytes for a pass-through encoding, reusing the unchanged
+// on-disk prefix (and suffix when the length is unchanged) when only the
+// middle of the document changed since the last save to the same file.
+//
+static BOOL EditWriteFileData(HANDLE hFile, LPCSTR lpData, DWORD cbData, bool withBOM, int iEncoding, int saveFlag) noexcept {
+	const DWORD cbBOM = withBOM ? 3 : 0;
+	DWORD dwBytesWritten;
+	BOOL bWriteSuccess = FALSE;
+	bool bWritten = false;
+	if (iEncoding == savedEncoding && savedPayloadSize >= 0
+		&& dirtyRangeStart > 0 && dirtyRangeStart != PTRDIFF_MAX) {
+		// the file must be untouched since our last save
+		FILETIME ftWrite;
+		LARGE_INTEGER fileSize;
+		if (GetFileTime(hFile, nullptr, nullptr, &ftWrite) && CompareFileTime(&ftWrite, &savedWriteTime) == 0
+			&& GetFileSizeEx(hFile, &fileSize) && fileSize.QuadPart == savedPayloadSize + cbBOM) {
+			const Sci_Position prefix = min(dirtyRangeStart, min(static_cast<Sci_Position>(cbData), static_cast<Sci_Position>(savedPayloadSize)));
+			const Sci_Position suffix = (static_cast<LONGLONG>(cbData) == savedPayloadSize)
+				? min(cleanSuffixLength, static_cast<Sci_Position>(cbData) - prefix) : 0;
+			LARGE_INTEGER pointer;
+			pointer.QuadPart = cbBOM + prefix;
+			if (SetFilePointerEx(hFile, pointer, nullptr, FILE_BEGIN)) {
+				bWriteSuccess = WriteFile(hFile, lpData + prefix, static_cast<DWORD>(cbData - prefix - suffix), &dwBytesWritten, nullptr);
+				dwLastIOError = GetLastError();
+				if (bWriteSuccess && suffix == 0) {
+					SetEndOfFile(hFile);
+				}
+				bWritten = true;
+			}
+		}
+	}
+	if (!bWritten) {
+		SetEndOfFile(hFile);
+		if (withBOM) {
+			WriteFile(hFile, "\xEF\xBB\xBF", 3, &dwBytesWritten, nullptr);
+		}
+		bWriteSuccess = WriteFile(hFile, lpData, cbData, &dwBytesWritten, nullptr);
+		dwLastIOError = GetLastError();
+	}
+	if (bWriteSuccess && !(saveFlag & FileSaveFlag_SaveCopy)) {
+		// pin the write time so the next save can prove the file is still ours
+		FILETIME ftNow;
+		GetSystemTimeAsFileTime(&ftNow);
+		SetFileTime(hFile, nullptr, nullptr, &ftNow);
+		savedWriteTime = ftNow;
+		savedPayloadSize = cbData;
+		savedEncoding = iEncoding;
+		savedWithBOM = withBOM;
+		dirtyRangeStart = PTRDIFF_MAX;
+		cleanSuffixLength = PTRDIFF_MAX;
+		if (savedPayload != nullptr) {
+			NP2HeapFree(savedPayload);
+			savedPayload = nullptr;
+		}
+		if (cbData <= MaxMergeSnapshotSize) {
+			savedPayload = static_cast<char *>(NP2HeapAlloc(cbData + 1));
+			memcpy(savedPayload, lpData, cbData);
+		}
+	}
+	return bWriteSuccess;
+}
+
+namespace {
+
+// longest common prefix, a page sized chunk at a time before the byte scan.
+Sci_Position CommonPrefixLength(const char *base, const char *disk, Sci_Position limit) noexcept {
+	constexpr Sci_Position chunkSize = 4096;
+	Sci_Position index = 0;
+	while (index + chunkSize <= limit && memcmp(base + index, disk + index, chunkSize) == 0) {
+		index += chunkSize;
+	}
+	while (index < limit && base[index] == disk[index]) {
+		index++;
+	}
+	return index;
+}
+
+Sci_Position CommonSuffixLength(const char *base, Sci_Position baseLen, const char *disk, Sci_Position diskLen, Sci_Position limit) noexcept {
+	constexpr Sci_Position chunkSize = 4096;
+	Sci_Position index = 0;
+	while (index + chunkSize <= limit && memcmp(base + baseLen - index - chunkSize, disk + diskLen - index - chunkSize, chunkSize) == 0) {
+		index += chunkSize;
+	}
+	while (index < limit && base[baseLen - index - 1] == disk[diskLen - index - 1]) {
+		index++;
+	}
+	return index;
+}
+
+}
+
+//=============================================================================
+//
+// EditMergeDiskChanges()
+// called when file watching reports an external change while the document has
+// unsaved edits. Diffs the rewritten disk file against the snapshot of our
+// last save: when the disk change and the unsaved edits touch disjoint parts
+// of the file, the disk change is spliced into the buffer, keeping the edits
+// and the undo history instead of forcing a reload-or-ignore choice on the
+// user. Returns false when the changes overlap or nothing can be proven,
+// leaving the existing prompt to handle the notification.
+//
+bool EditMergeDiskChanges(LPCWSTR pszFile) noexcept {
+	if (savedPayload == nullptr || savedEncoding != iCurrentEncoding
+		|| dirtyRangeStart == PTRDIFF_MAX || bReadOnlyMode || SciCall_GetReadOnly()) {
+		return false;
+	}
+
+	HANDLE hFile = CreateFile(pszFile,
+					   GENERIC_READ,
+					   FILE_SHARE_READ | FILE_SHARE_WRITE,
+					   nullptr, OPEN_EXISTING,
+					   FILE_ATTRIBUTE_NORMAL,
+					   nullptr);
+	if (hFile == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	bool merged = false;
+	char *diskData = nullptr;
+	FILETIME ftWrite;
+	LARGE_INTEGER fileSize;
+	const DWORD cbBOM = savedWithBOM ? 3 : 0;
+	if (GetFileTime(hFile, nullptr, nullptr, &ftWrite)
+		&& GetFileSizeEx(hFile, &fileSize)
+		&& fileSize.QuadPart >= cbBOM && fileSize.QuadPart <= MaxMergeSnapshotSize) {
+		const DWORD cbData = static_cast<DWORD>(fileSize.QuadPart);
+		diskData = static_cast<char *>(NP2HeapAlloc(cbData + 1));
+		DWORD cbRead = 0;
+		if (ReadFile(hFile, diskData, cbData, &cbRead, nullptr) && cbRead == cbData
+			&& (cbBOM == 0 || memcmp(diskData, "\xEF\xBB\xBF", 3) == 0)) {
+			const char * const disk = diskData + cbBOM;
+			const Sci_Position diskLen = cbData - cbBOM;
+			const Sci_Position baseLen = static_cast<Sci_Position>(savedPayloadSize);
+			const Sci_Position docLen = SciCall_GetLength();
+			// both ranges below are in base (last saved content) coordinates.
+			const Sci_Position dirtyStart = dirtyRangeStart;
+			const Sci_Position dirtyEnd = baseLen - cleanSuffixLength;
+			const Sci_Position prefix = CommonPrefixLength(savedPayload, disk, min(baseLen, diskLen));
+			if (prefix == baseLen && prefix == diskLen) {
+				// rewritten with identical content, nothing to splice
+				savedWriteTime = ftWrite;
+				merged = true;
+			} else {
+				const Sci_Position suffix = CommonSuffixLength(savedPayload, baseLen, disk, diskLen, min(baseLen, diskLen) - prefix);
+				const Sci_Position delta = diskLen - baseLen;
+				// the disk change [prefix, baseLen - suffix) must not touch
+				// the unsaved edits [dirtyStart, dirtyEnd).
+				if (baseLen - suffix <= dirtyStart) {
+					// disk change is inside the clean prefix
+					SciCall_SetTargetRange(prefix, baseLen - suffix);
+					SciCall_ReplaceTarget(diskLen - suffix - prefix, disk + prefix);
+					dirtyRangeStart = dirtyStart + delta;
+					cleanSuffixLength = baseLen - dirtyEnd;
+					merged = true;
+				} else if (prefix >= dirtyEnd) {
+					// disk change is inside the clean suffix
+					SciCall_SetTargetRange(prefix + docLen - baseLen, docLen - suffix);
+					SciCall_ReplaceTarget(diskLen - suffix - prefix, disk + prefix);
+					dirtyRangeStart = dirtyStart;
+					cleanSuffixLength = baseLen - dirtyEnd + delta;
+					merged = true;
+				}
+				if (merged) {
+					// the disk file becomes the new base for the dirty range
+					// and for the next incremental save.
+					if (cbBOM != 0) {
+						memmove(diskData, disk, diskLen);
+					}
+					NP2HeapFree(savedPayload);
+					savedPayload = diskData;
+					diskData = nullptr;
+					savedPayloadSize = diskLen;
+					savedWriteTime = ftWrite;
+				}
+			}
+		}
+	}
+	if (diskData != nullptr) {
+		NP2HeapFree(diskData);
+	}
+	CloseHandle(hFile);
+	return merged;
+}
+
 //=============================================================================
 //
 // EditSaveFile()
@@ -1231,9 +1734,6 @@ bool EditSaveFile(HWND hwnd, LPCWSTR pszFile, int saveFlag, EditFileIOStatus &st
 		if (uFlags & NCP_UNICODE) {
 			SetEndOfFile(hFile);
 
-			LPWSTR lpDataWide = static_cast<LPWSTR>(NP2HeapAlloc(cbData * sizeof(WCHAR) + 16));
-			const int cbDataWide = MultiByteToWideChar(CP_UTF8, 0, lpData, cbData, lpDataWide, static_cast<int>(NP2HeapSize(lpDataWide) / sizeof(WCHAR)));
-
 			if (uFlags & NCP_UNICODE_BOM) {
 				if (uFlags & NCP_UNICODE_REVERSE) {
 					WriteFile(hFile, "\xFE\xFF", 2, &dwBytesWritten, nullptr);
@@ -1242,23 +1742,34 @@ bool EditSaveFile(HWND hwnd, LPCWSTR pszFile, int saveFlag, EditFileIOStatus &st
 				}
 			}
 
-			if (uFlags & NCP_UNICODE_REVERSE) {
-				_swab(reinterpret_cast<char *>(lpDataWide), reinterpret_cast<char *>(lpDataWide), static_cast<int>(cbDataWide * sizeof(WCHAR)));
+			// Convert and write in blocks: WriteFile() returns once a block is in
+			// the system cache, so converting the next block overlaps the physical
+			// write of the previous one, and peak memory no longer doubles the
+			// document for a big file.
+			constexpr DWORD cbEncodeBlock = 8u << 20;
+			LPWSTR lpDataWide = static_cast<LPWSTR>(NP2HeapAlloc((min(cbData, cbEncodeBlock) + 4) * sizeof(WCHAR)));
+			bWriteSuccess = TRUE;
+			DWORD offset = 0;
+			while (bWriteSuccess && offset < cbData) {
+				DWORD cbBlock = min(cbEncodeBlock, cbData - offset);
+				if (cbBlock < cbData - offset) {
+					// don't split a UTF-8 sequence across blocks
+					for (int back = 0; back < 3 && (lpData[offset + cbBlock] & 0xC0) == 0x80; back++) {
+						cbBlock--;
+					}
+				}
+				const int cbDataWide = MultiByteToWideChar(CP_UTF8, 0, lpData + offset, cbBlock, lpDataWide, static_cast<int>(NP2HeapSize(lpDataWide) / sizeof(WCHAR)));
+				if (uFlags & NCP_UNICODE_REVERSE) {
+					_swab(reinterpret_cast<char *>(lpDataWide), reinterpret_cast<char *>(lpDataWide), static_cast<int>(cbDataWide * sizeof(WCHAR)));
+				}
+				bWriteSuccess = WriteFile(hFile, lpDataWide, cbDataWide * sizeof(WCHAR), &dwBytesWritten, nullptr);
+				offset += cbBlock;
 			}
-
-			bWriteSuccess = WriteFile(hFile, lpDataWide, cbDataWide * sizeof(WCHAR), &dwBytesWritten, nullptr);
 			dwLastIOError = GetLastError();
 
 			NP2HeapFree(lpDataWide);
 		} else if (uFlags & NCP_UTF8) {
-			SetEndOfFile(hFile);
-
-			if (uFlags & NCP_UTF8_SIGN) {
-				WriteFile(hFile, "\xEF\xBB\xBF", 3, &dwBytesWritten, nullptr);
-			}
-
-			bWriteSuccess = WriteFile(hFile, lpData, cbData, &dwBytesWritten, nullptr);
-			dwLastIOError = GetLastError();
+			bWriteSuccess = EditWriteFileData(hFile, lpData, cbData, (uFlags & NCP_UTF8_SIGN) != 0, iEncoding, saveFlag);
 		} else if (uFlags & (NCP_8BIT | NCP_7BIT)) {
 			BOOL bCancelDataLoss = FALSE;
 			const UINT uCodePage = mEncoding[iEncoding].uCodePage;
@@ -1288,9 +1799,7 @@ bool EditSaveFile(HWND hwnd, LPCWSTR pszFile, int saveFlag, EditFileIOStatus &st
 				status.bCancelDataLoss = true;
 			}
 		} else {
-			SetEndOfFile(hFile);
-			bWriteSuccess = WriteFile(hFile, lpData, cbData, &dwBytesWritten, nullptr);
-			dwLastIOError = GetLastError();
+			bWriteSuccess = EditWriteFileData(hFile, lpData, cbData, false, iEncoding, saveFlag);
 		}
 	}
 
@@ -1309,59 +1818,573 @@ bool EditSaveFile(HWND hwnd, LPCWSTR pszFile, int saveFlag, EditFileIOStatus &st
 	return false;
 }
 
-void EditReplaceRange(Sci_Position iSelStart, Sci_Position iSelEnd, Sci_Position cchText, LPCSTR pszText) noexcept {
-	Sci_Position iCurPos = SciCall_GetCurrentPos();
-	Sci_Position iAnchorPos = SciCall_GetAnchor();
+//=============================================================================
+//
+// Persistent style cache. Styling a huge document from byte zero on every
+// open can take longer than loading it, so the finished styling result
+// (style run lengths, fold levels and per-line lexer states) is serialized
+// into a hidden sidecar file when the document is closed and replayed on the
+// next open. The sidecar is keyed by a content hash: a stale cache is simply
+// ignored and deleted, so no attempt is made to keep it in sync elsewhere.
+//
+namespace {
 
-	if (iAnchorPos > iCurPos) {
-		iCurPos = iSelStart;
-		iAnchorPos = iSelStart + cchText;
-	} else {
-		iAnchorPos = iSelStart;
-		iCurPos = iSelStart + cchText;
+constexpr DWORD StyleCacheMagic = 0x5334504E;	// "NP4S"
+constexpr DWORD StyleCacheVersion = 1;
+// styling smaller files is cheaper than hashing the content plus the sidecar I/O.
+constexpr Sci_Position MinStyleCacheSize = 16*1024*1024;
+constexpr Sci_Position StyleCacheChunkSize = 1024*1024;
+
+struct StyleCacheHeader {
+	DWORD magic;
+	DWORD version;
+	int iLexerRid;
+	DWORD styleRunCount;
+	DWORD foldRunCount;
+	DWORD lineStateCount;
+	UINT64 contentHash;
+	INT64 contentLength;
+	INT64 lineCount;
+};
+
+// style runs: length in bytes, value is the style.
+// fold runs: length in lines, value is the fold level.
+// line states: length is the line delta from the previous entry, value is the state.
+struct StyleCacheRun {
+	UINT32 length;
+	INT32 value;
+};
+
+struct StyleCacheRunList {
+	StyleCacheRun *runs = nullptr;
+	DWORD count = 0;
+	DWORD capacity = 0;
+
+	bool Add(UINT32 length, INT32 value) noexcept {
+		if (count == capacity) {
+			capacity = (capacity == 0) ? 4096 : capacity*2;
+			StyleCacheRun *block = static_cast<StyleCacheRun *>(runs ? NP2HeapReAlloc(runs, capacity*sizeof(StyleCacheRun)) : NP2HeapAlloc(capacity*sizeof(StyleCacheRun)));
+			if (block == nullptr) {
+				return false;
+			}
+			runs = block;
+		}
+		runs[count] = { length, value };
+		count++;
+		return true;
 	}
 
-	SciCall_SetTargetRange(iSelStart, iSelEnd);
-	SciCall_ReplaceTarget(cchText, pszText);
-	SciCall_SetSel(iAnchorPos, iCurPos);
-}
+	~StyleCacheRunList() {
+		if (runs != nullptr) {
+			NP2HeapFree(runs);
+		}
+	}
+};
 
-void EditReplaceMainSelection(Sci_Position cchText, LPCSTR pszText) noexcept {
-	EditReplaceRange(SciCall_GetSelectionStart(), SciCall_GetSelectionEnd(), cchText, pszText);
+void StyleCacheGetPath(LPCWSTR pszFile, LPWSTR tchCache) noexcept {
+	lstrcpy(tchCache, pszFile);
+	lstrcat(tchCache, L".np4-styles");
 }
 
-static inline char *EditGetTextRange(Sci_Position iStartPos, Sci_Position iEndPos) noexcept {
-	const Sci_Position len = iEndPos - iStartPos;
-	if (len <= 0) {
-		return nullptr;
+// FNV-1a folded over eight-byte words: not the reference byte hash,
+// but stable and fast enough to fingerprint hundreds of megabytes.
+UINT64 StyleCacheHashContent() noexcept {
+	const Sci_Position length = SciCall_GetLength();
+	const char *text = SciCall_GetRangePointer(0, length);
+	UINT64 hash = UINT64_C(0xcbf29ce484222325);
+	Sci_Position pos = 0;
+	for (; pos + 8 <= length; pos += 8) {
+		UINT64 word;
+		memcpy(&word, text + pos, 8);
+		hash = (hash ^ word) * UINT64_C(0x100000001b3);
+	}
+	for (; pos < length; pos++) {
+		hash = (hash ^ static_cast<unsigned char>(text[pos])) * UINT64_C(0x100000001b3);
 	}
+	return hash;
+}
 
-	char *mszBuf = static_cast<char *>(NP2HeapAlloc(len + 1));
-	const Sci_TextRangeFull tr = { { iStartPos, iEndPos }, mszBuf };
-	SciCall_GetTextRangeFull(&tr);
-	return mszBuf;
 }
 
-// https://docs.microsoft.com/en-us/windows/win32/intl/transliteration-services
-#include <elscore.h>
-#if defined(__MINGW32__)
-#if defined(__has_include) && __has_include(<elssrvc.h>)
-#include <elssrvc.h>
-#else
-// {A3A8333B-F4FC-42f6-A0C4-0462FE7317CB}
-static const GUID ELS_GUID_TRANSLITERATION_HANT_TO_HANS =
-	{ 0xA3A8333B, 0xF4FC, 0x42f6, { 0xA0, 0xC4, 0x04, 0x62, 0xFE, 0x73, 0x17, 0xCB } };
+void EditSaveStyleCache(LPCWSTR pszFile) noexcept {
+	const Sci_Position length = SciCall_GetLength();
+	if (StrIsEmpty(pszFile) || length < MinStyleCacheSize
+		|| pLexCurrent->iLexer == SCLEX_NULL || SciCall_GetEndStyled() < length) {
+		return;
+	}
 
-// {3CACCDC8-5590-42dc-9A7B-B5A6B5B3B63B}
-static const GUID ELS_GUID_TRANSLITERATION_HANS_TO_HANT =
-	{ 0x3CACCDC8, 0x5590, 0x42dc, { 0x9A, 0x7B, 0xB5, 0xA6, 0xB5, 0xB3, 0xB6, 0x3B } };
+	StyleCacheRunList styleRuns;
+	StyleCacheRunList foldRuns;
+	StyleCacheRunList lineStates;
+	char * const buffer = static_cast<char *>(NP2HeapAlloc(2*(StyleCacheChunkSize + 1)));
+	bool success = true;
+
+	int style = -1;
+	UINT32 runLength = 0;
+	for (Sci_Position pos = 0; success && pos < length; pos += StyleCacheChunkSize) {
+		const Sci_Position end = min(pos + StyleCacheChunkSize, length);
+		const Sci_TextRangeFull tr = { { pos, end }, buffer };
+		SciCall_GetStyledTextFull(&tr);
+		for (Sci_Position offset = 0; offset < end - pos; offset++) {
+			const unsigned char st = buffer[2*offset + 1];
+			if (st == style && runLength != UINT32_MAX) {
+				runLength++;
+			} else {
+				if (style >= 0 && !styleRuns.Add(runLength, style)) {
+					success = false;
+					break;
+				}
+				style = st;
+				runLength = 1;
+			}
+		}
+	}
+	NP2HeapFree(buffer);
+	success = success && styleRuns.Add(runLength, style);
 
-// {D8B983B1-F8BF-4a2b-BCD5-5B5EA20613E1}
-static const GUID ELS_GUID_TRANSLITERATION_MALAYALAM_TO_LATIN =
-	{ 0xD8B983B1, 0xF8BF, 0x4a2b, { 0xBC, 0xD5, 0x5B, 0x5E, 0xA2, 0x06, 0x13, 0xE1 } };
+	const Sci_Line lineCount = SciCall_GetLineCount();
+	int level = SciCall_GetFoldLevel(0);
+	runLength = 0;
+	Sci_Line stateLine = 0;
+	for (Sci_Line line = 0; success && line < lineCount; line++) {
+		const int current = SciCall_GetFoldLevel(line);
+		if (current == level && runLength != UINT32_MAX) {
+			runLength++;
+		} else {
+			success = foldRuns.Add(runLength, level);
+			level = current;
+			runLength = 1;
+		}
+		const int state = SciCall_GetLineState(line);
+		if (state != 0) {
+			success = success && lineStates.Add(static_cast<UINT32>(line - stateLine), state);
+			stateLine = line;
+		}
+	}
+	success = success && foldRuns.Add(runLength, level);
+	if (!success) {
+		return;
+	}
 
-// {C4A4DCFE-2661-4d02-9835-F48187109803}
-static const GUID ELS_GUID_TRANSLITERATION_DEVANAGARI_TO_LATIN =
+	WCHAR tchCache[MAX_PATH + 16];
+	StyleCacheGetPath(pszFile, tchCache);
+	HANDLE hFile = CreateFile(tchCache,
+					   GENERIC_WRITE, FILE_SHARE_READ,
+					   nullptr, CREATE_ALWAYS,
+					   FILE_ATTRIBUTE_HIDDEN,
+					   nullptr);
+	if (hFile == INVALID_HANDLE_VALUE) {
+		return;
+	}
+
+	StyleCacheHeader header;
+	header.magic = StyleCacheMagic;
+	header.version = StyleCacheVersion;
+	header.iLexerRid = pLexCurrent->rid;
+	header.styleRunCount = styleRuns.count;
+	header.foldRunCount = foldRuns.count;
+	header.lineStateCount = lineStates.count;
+	header.contentHash = StyleCacheHashContent();
+	header.contentLength = length;
+	header.lineCount = lineCount;
+
+	DWORD dwBytesWritten;
+	success = WriteFile(hFile, &header, sizeof(StyleCacheHeader), &dwBytesWritten, nullptr)
+		&& WriteFile(hFile, styleRuns.runs, styleRuns.count*sizeof(StyleCacheRun), &dwBytesWritten, nullptr)
+		&& WriteFile(hFile, foldRuns.runs, foldRuns.count*sizeof(StyleCacheRun), &dwBytesWritten, nullptr)
+		&& (lineStates.count == 0 || WriteFile(hFile, lineStates.runs, lineStates.count*sizeof(StyleCacheRun), &dwBytesWritten, nullptr));
+	CloseHandle(hFile);
+	if (!success) {
+		DeleteFile(tchCache);
+	}
+}
+
+bool EditRestoreStyleCache(LPCWSTR pszFile) noexcept {
+	const Sci_Position length = SciCall_GetLength();
+	if (StrIsEmpty(pszFile) || length < MinStyleCacheSize || pLexCurrent->iLexer == SCLEX_NULL) {
+		return false;
+	}
+
+	WCHAR tchCache[MAX_PATH + 16];
+	StyleCacheGetPath(pszFile, tchCache);
+	HANDLE hFile = CreateFile(tchCache,
+					   GENERIC_READ, FILE_SHARE_READ,
+					   nullptr, OPEN_EXISTING,
+					   FILE_ATTRIBUTE_NORMAL,
+					   nullptr);
+	if (hFile == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	StyleCacheHeader header{};
+	DWORD dwBytesRead;
+	bool success = ReadFile(hFile, &header, sizeof(StyleCacheHeader), &dwBytesRead, nullptr)
+		&& dwBytesRead == sizeof(StyleCacheHeader)
+		&& header.magic == StyleCacheMagic
+		&& header.version == StyleCacheVersion
+		&& header.iLexerRid == pLexCurrent->rid
+		&& header.contentLength == length
+		&& header.lineCount == SciCall_GetLineCount()
+		&& header.styleRunCount != 0 && header.foldRunCount != 0;
+
+	StyleCacheRun *runs = nullptr;
+	DWORD total = 0;
+	if (success) {
+		total = header.styleRunCount + header.foldRunCount + header.lineStateCount;
+		const DWORD cbRuns = total*sizeof(StyleCacheRun);
+		success = total >= header.styleRunCount; // overflow
+		if (success) {
+			runs = static_cast<StyleCacheRun *>(NP2HeapAlloc(cbRuns));
+			success = ReadFile(hFile, runs, cbRuns, &dwBytesRead, nullptr) && dwBytesRead == cbRuns;
+		}
+	}
+	CloseHandle(hFile);
+
+	if (success) {
+		// the cache must describe exactly this content before any of it is applied
+		UINT64 total2 = 0;
+		for (DWORD i = 0; i < header.styleRunCount; i++) {
+			total2 += runs[i].length;
+		}
+		success = total2 == static_cast<UINT64>(length);
+		total2 = 0;
+		for (DWORD i = header.styleRunCount; i < header.styleRunCount + header.foldRunCount; i++) {
+			total2 += runs[i].length;
+		}
+		success = success && total2 == static_cast<UINT64>(header.lineCount)
+			&& header.contentHash == StyleCacheHashContent();
+	}
+
+	if (success) {
+		char * const buffer = static_cast<char *>(NP2HeapAlloc(StyleCacheChunkSize));
+		Sci_Position buffered = 0;
+		SciCall_StartStyling(0);
+		for (DWORD i = 0; i < header.styleRunCount; i++) {
+			UINT32 remain = runs[i].length;
+			while (remain != 0) {
+				const UINT32 fill = static_cast<UINT32>(min(static_cast<Sci_Position>(remain), StyleCacheChunkSize - buffered));
+				memset(buffer + buffered, runs[i].value, fill);
+				buffered += fill;
+				remain -= fill;
+				if (buffered == StyleCacheChunkSize) {
+					SciCall_SetStylingEx(buffered, buffer);
+					buffered = 0;
+				}
+			}
+		}
+		if (buffered != 0) {
+			SciCall_SetStylingEx(buffered, buffer);
+		}
+		NP2HeapFree(buffer);
+
+		Sci_Line line = 0;
+		for (DWORD i = header.styleRunCount; i < header.styleRunCount + header.foldRunCount; i++) {
+			const Sci_Line end = line + runs[i].length;
+			for (; line < end; line++) {
+				SciCall_SetFoldLevel(line, runs[i].value);
+			}
+		}
+
+		line = 0;
+		for (DWORD i = header.styleRunCount + header.foldRunCount; i < total; i++) {
+			line += runs[i].length;
+			SciCall_SetLineState(line, runs[i].value);
+		}
+	} else if (runs != nullptr || header.magic == StyleCacheMagic) {
+		// stale or truncated cache: the next close will rewrite it
+		DeleteFile(tchCache);
+	}
+
+	if (runs != nullptr) {
+		NP2HeapFree(runs);
+	}
+	return success;
+}
+
+//=============================================================================
+//
+// Persistent undo history. The in-memory undo trail dies with the process, so
+// the completed actions are serialized into a hidden sidecar file whenever the
+// document matches the file on disk (explicit save, overwriting autosave and
+// close) and replayed on the next open. Like the style cache the sidecar is
+// keyed by a content hash: the history only applies to exactly the content it
+// was recorded against, a stale sidecar is ignored and deleted.
+//
+namespace {
+
+constexpr DWORD UndoCacheMagic = 0x5534504E;	// "NP4U"
+constexpr DWORD UndoCacheVersion = 1;
+// bound the sidecar by evicting the oldest actions past this much action text.
+constexpr UINT64 UndoCacheMaxTextSize = 256*1024*1024;
+
+struct UndoCacheHeader {
+	DWORD magic;
+	DWORD version;
+	INT32 actionCount;
+	INT32 currentAction;
+	INT32 savePoint;
+	INT32 unused;
+	UINT64 contentHash;
+	INT64 contentLength;
+	UINT64 textLength;
+};
+
+// type is the ActionType with the coalesce flag, see SCI_GETUNDOACTIONTYPE.
+struct UndoCacheAction {
+	INT64 position;
+	UINT32 length;
+	INT32 type;
+};
+
+void UndoCacheGetPath(LPCWSTR pszFile, LPWSTR tchCache) noexcept {
+	lstrcpy(tchCache, pszFile);
+	lstrcat(tchCache, L".np4-undo");
+}
+
+}
+
+void EditSaveUndoHistory(LPCWSTR pszFile) noexcept {
+	if (StrIsEmpty(pszFile) || SciCall_GetModify() || SciCall_GetUndoSequence() != 0) {
+		// unsaved content can not be replayed against the file on disk;
+		// keep the sidecar from the last state that matched it.
+		return;
+	}
+
+	WCHAR tchCache[MAX_PATH + 16];
+	UndoCacheGetPath(pszFile, tchCache);
+	const int actionCount = static_cast<int>(SciCall_GetUndoActions());
+	if (actionCount == 0) {
+		DeleteFile(tchCache);
+		return;
+	}
+
+	UndoCacheAction * const cacheActions = static_cast<UndoCacheAction *>(NP2HeapAlloc(actionCount*sizeof(UndoCacheAction)));
+	UINT64 textLength = 0;
+	for (int action = 0; action < actionCount; action++) {
+		cacheActions[action].position = SciCall_GetUndoActionPosition(action);
+		cacheActions[action].length = static_cast<UINT32>(SciCall_GetUndoActionText(action, nullptr));
+		cacheActions[action].type = SciCall_GetUndoActionType(action);
+		textLength += cacheActions[action].length;
+	}
+
+	// evict the oldest actions, but the save point and current position must
+	// stay replayable; the trimmed history remains internally consistent as
+	// the eviction horizon simply becomes the new original document state.
+	const int currentAction = SciCall_GetUndoCurrent();
+	const int savePoint = SciCall_GetUndoSavePoint();
+	int firstAction = 0;
+	const int keepFrom = min(currentAction, (savePoint < 0) ? currentAction : savePoint);
+	while (textLength > UndoCacheMaxTextSize && firstAction < keepFrom) {
+		textLength -= cacheActions[firstAction].length;
+		firstAction++;
+	}
+
+	bool success = textLength <= UndoCacheMaxTextSize;
+	HANDLE hFile = INVALID_HANDLE_VALUE;
+	if (success) {
+		hFile = CreateFile(tchCache,
+						   GENERIC_WRITE, FILE_SHARE_READ,
+						   nullptr, CREATE_ALWAYS,
+						   FILE_ATTRIBUTE_HIDDEN,
+						   nullptr);
+		success = hFile != INVALID_HANDLE_VALUE;
+	}
+	if (success) {
+		UndoCacheHeader header;
+		header.magic = UndoCacheMagic;
+		header.version = UndoCacheVersion;
+		header.actionCount = actionCount - firstAction;
+		header.currentAction = currentAction - firstAction;
+		header.savePoint = (savePoint < firstAction) ? -1 : savePoint - firstAction;
+		header.unused = 0;
+		header.contentHash = StyleCacheHashContent();
+		header.contentLength = SciCall_GetLength();
+		header.textLength = textLength;
+
+		DWORD dwBytesWritten;
+		success = WriteFile(hFile, &header, sizeof(UndoCacheHeader), &dwBytesWritten, nullptr)
+			&& WriteFile(hFile, cacheActions + firstAction, header.actionCount*sizeof(UndoCacheAction), &dwBytesWritten, nullptr);
+		for (int action = firstAction; success && action < actionCount; action++) {
+			if (cacheActions[action].length != 0) {
+				char * const text = static_cast<char *>(NP2HeapAlloc(cacheActions[action].length + 1));
+				SciCall_GetUndoActionText(action, text);
+				success = WriteFile(hFile, text, cacheActions[action].length, &dwBytesWritten, nullptr);
+				NP2HeapFree(text);
+			}
+		}
+		CloseHandle(hFile);
+		if (!success) {
+			DeleteFile(tchCache);
+		}
+	}
+	NP2HeapFree(cacheActions);
+}
+
+bool EditRestoreUndoHistory(LPCWSTR pszFile) noexcept {
+	const Sci_Position length = SciCall_GetLength();
+	if (StrIsEmpty(pszFile) || length == 0 || SciCall_GetUndoActions() != 0) {
+		return false;
+	}
+
+	WCHAR tchCache[MAX_PATH + 16];
+	UndoCacheGetPath(pszFile, tchCache);
+	HANDLE hFile = CreateFile(tchCache,
+					   GENERIC_READ, FILE_SHARE_READ,
+					   nullptr, OPEN_EXISTING,
+					   FILE_ATTRIBUTE_NORMAL,
+					   nullptr);
+	if (hFile == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	UndoCacheHeader header{};
+	DWORD dwBytesRead;
+	bool success = ReadFile(hFile, &header, sizeof(UndoCacheHeader), &dwBytesRead, nullptr)
+		&& dwBytesRead == sizeof(UndoCacheHeader)
+		&& header.magic == UndoCacheMagic
+		&& header.version == UndoCacheVersion
+		&& header.actionCount > 0
+		&& header.currentAction >= 0 && header.currentAction <= header.actionCount
+		&& header.savePoint <= header.actionCount
+		&& header.contentLength == length
+		&& header.textLength <= UndoCacheMaxTextSize
+		&& header.contentHash == StyleCacheHashContent();
+
+	UndoCacheAction *cacheActions = nullptr;
+	char *text = nullptr;
+	if (success) {
+		const DWORD cbActions = header.actionCount*sizeof(UndoCacheAction);
+		cacheActions = static_cast<UndoCacheAction *>(NP2HeapAlloc(cbActions));
+		success = ReadFile(hFile, cacheActions, cbActions, &dwBytesRead, nullptr) && dwBytesRead == cbActions;
+		if (success) {
+			UINT64 textLength = 0;
+			for (int action = 0; action < header.actionCount; action++) {
+				textLength += cacheActions[action].length;
+			}
+			success = textLength == header.textLength;
+		}
+		if (success && header.textLength != 0) {
+			text = static_cast<char *>(NP2HeapAlloc(static_cast<SIZE_T>(header.textLength)));
+			success = ReadFile(hFile, text, static_cast<DWORD>(header.textLength), &dwBytesRead, nullptr)
+				&& dwBytesRead == header.textLength;
+		}
+	}
+	CloseHandle(hFile);
+
+	if (success) {
+		const char *scrap = text;
+		for (int action = 0; action < header.actionCount; action++) {
+			SciCall_PushUndoActionType(cacheActions[action].type, cacheActions[action].position);
+			if (cacheActions[action].length != 0) {
+				SciCall_ChangeLastUndoActionText(cacheActions[action].length, scrap);
+				scrap += cacheActions[action].length;
+			}
+		}
+		// the restored content is the state the history was recorded against
+		SciCall_SetUndoSavePoint((header.savePoint < 0) ? header.currentAction : header.savePoint);
+		SciCall_SetUndoCurrent(header.currentAction);
+	} else if (header.magic == UndoCacheMagic || cacheActions != nullptr) {
+		// stale or truncated sidecar: the next save will rewrite it
+		DeleteFile(tchCache);
+	}
+
+	if (text != nullptr) {
+		NP2HeapFree(text);
+	}
+	if (cacheActions != nullptr) {
+		NP2HeapFree(cacheActions);
+	}
+	return success;
+}
+
+void EditReplaceRange(Sci_Position iSelStart, Sci_Position iSelEnd, Sci_Position cchText, LPCSTR pszText) noexcept {
+	Sci_Position iCurPos = SciCall_GetCurrentPos();
+	Sci_Position iAnchorPos = SciCall_GetAnchor();
+
+	if (iAnchorPos > iCurPos) {
+		iCurPos = iSelStart;
+		iAnchorPos = iSelStart + cchText;
+	} else {
+		iAnchorPos = iSelStart;
+		iCurPos = iSelStart + cchText;
+	}
+
+	// replace only the span that differs from what is in the document, so a
+	// transform changing few bytes of a huge selection doesn't push the whole
+	// selection into the undo history twice.
+	Sci_Position iTargetStart = iSelStart;
+	Sci_Position iTargetEnd = iSelEnd;
+	if (cchText != 0 && iTargetEnd > iTargetStart) {
+		const Sci_Position docLen = iSelEnd - iSelStart;
+		const char * const pDoc = SciCall_GetRangePointer(iSelStart, docLen);
+		Sci_Position prefix = 0;
+		const Sci_Position maxPrefix = min(docLen, cchText);
+		while (prefix < maxPrefix && pDoc[prefix] == pszText[prefix]) {
+			++prefix;
+		}
+		Sci_Position suffix = 0;
+		const Sci_Position maxSuffix = maxPrefix - prefix;
+		while (suffix < maxSuffix && pDoc[docLen - 1 - suffix] == pszText[cchText - 1 - suffix]) {
+			++suffix;
+		}
+		if (SciCall_GetCodePage() == SC_CP_UTF8) {
+			// keep the target on character boundaries; the trimmed bytes are
+			// identical in the document, so aligning by the replacement text
+			// aligns the document positions as well.
+			while (prefix > 0 && prefix < cchText && (pszText[prefix] & 0xC0) == 0x80) {
+				--prefix;
+			}
+			while (suffix > 0 && (pszText[cchText - suffix] & 0xC0) == 0x80) {
+				--suffix;
+			}
+		}
+		iTargetStart += prefix;
+		iTargetEnd -= suffix;
+		pszText += prefix;
+		cchText -= prefix + suffix;
+	}
+
+	SciCall_SetTargetRange(iTargetStart, iTargetEnd);
+	SciCall_ReplaceTarget(cchText, pszText);
+	SciCall_SetSel(iAnchorPos, iCurPos);
+}
+
+void EditReplaceMainSelection(Sci_Position cchText, LPCSTR pszText) noexcept {
+	EditReplaceRange(SciCall_GetSelectionStart(), SciCall_GetSelectionEnd(), cchText, pszText);
+}
+
+static inline char *EditGetTextRange(Sci_Position iStartPos, Sci_Position iEndPos) noexcept {
+	const Sci_Position len = iEndPos - iStartPos;
+	if (len <= 0) {
+		return nullptr;
+	}
+
+	char *mszBuf = static_cast<char *>(NP2HeapAlloc(len + 1));
+	const Sci_TextRangeFull tr = { { iStartPos, iEndPos }, mszBuf };
+	SciCall_GetTextRangeFull(&tr);
+	return mszBuf;
+}
+
+// https://docs.microsoft.com/en-us/windows/win32/intl/transliteration-services
+#include <elscore.h>
+#if defined(__MINGW32__)
+#if defined(__has_include) && __has_include(<elssrvc.h>)
+#include <elssrvc.h>
+#else
+// {A3A8333B-F4FC-42f6-A0C4-0462FE7317CB}
+static const GUID ELS_GUID_TRANSLITERATION_HANT_TO_HANS =
+	{ 0xA3A8333B, 0xF4FC, 0x42f6, { 0xA0, 0xC4, 0x04, 0x62, 0xFE, 0x73, 0x17, 0xCB } };
+
+// {3CACCDC8-5590-42dc-9A7B-B5A6B5B3B63B}
+static const GUID ELS_GUID_TRANSLITERATION_HANS_TO_HANT =
+	{ 0x3CACCDC8, 0x5590, 0x42dc, { 0x9A, 0x7B, 0xB5, 0xA6, 0xB5, 0xB3, 0xB6, 0x3B } };
+
+// {D8B983B1-F8BF-4a2b-BCD5-5B5EA20613E1}
+static const GUID ELS_GUID_TRANSLITERATION_MALAYALAM_TO_LATIN =
+	{ 0xD8B983B1, 0xF8BF, 0x4a2b, { 0xBC, 0xD5, 0x5B, 0x5E, 0xA2, 0x06, 0x13, 0xE1 } };
+
+// {C4A4DCFE-2661-4d02-9835-F48187109803}
+static const GUID ELS_GUID_TRANSLITERATION_DEVANAGARI_TO_LATIN =
 	{ 0xC4A4DCFE, 0x2661, 0x4d02, { 0x98, 0x35, 0xF4, 0x81, 0x87, 0x10, 0x98, 0x03 } };
 
 // {3DD12A98-5AFD-4903-A13F-E17E6C0BFE01}
@@ -1724,6 +2747,68 @@ LPWSTR EditURLEncodeSelection(int *pcchEscaped, bool component) noexcept {
 	return pszEscapedW;
 }
 
+// bit set: the byte must be percent-encoded.
+// URL_ESCAPE_AS_UTF8: C0 controls, DEL, non-ASCII bytes and RFC 1738 unsafe characters.
+static const uint32_t UrlUnsafeCharSet[8] = {
+0xffffffffU, 0x50000005U, 0x78000000U, 0xb8000001U,
+0xffffffffU, 0xffffffffU, 0xffffffffU, 0xffffffffU
+};
+// URL_ESCAPE_ASCII_URI_COMPONENT: everything outside the RFC 3986 unreserved set.
+static const uint32_t UrlComponentCharSet[8] = {
+0xffffffffU, 0xfc009fffU, 0x78000001U, 0xb8000001U,
+0xffffffffU, 0xffffffffU, 0xffffffffU, 0xffffffffU
+};
+
+// the blank set EditURLEncodeSelection() trims from both ends.
+static constexpr bool IsURLTrimChar(uint8_t ch) noexcept {
+	return ch == ' ' || (ch >= '\a' && ch <= '\r');
+}
+
+// find the next byte outside the RFC 3986 unreserved set: only such bytes are
+// candidates for percent-encoding, everything in between is copied unchanged
+// in one block.
+static const char *FindUrlEscapeCandidate(const char *ptr, const char * const end) noexcept {
+#if NP2_USE_AVX2
+	while (ptr + sizeof(__m256i) <= end) {
+		const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ptr));
+		__m256i safe = _mm256_and_si256(_mm256_cmpgt_epi8(chunk, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), chunk));
+		safe = _mm256_or_si256(safe, _mm256_and_si256(_mm256_cmpgt_epi8(chunk, _mm256_set1_epi8('A' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), chunk)));
+		safe = _mm256_or_si256(safe, _mm256_and_si256(_mm256_cmpgt_epi8(chunk, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), chunk)));
+		safe = _mm256_or_si256(safe, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('-')));
+		safe = _mm256_or_si256(safe, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('.')));
+		safe = _mm256_or_si256(safe, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('_')));
+		safe = _mm256_or_si256(safe, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('~')));
+		const uint32_t mask = ~mm256_movemask_epi8(safe);
+		if (mask != 0) {
+			return ptr + np2_ctz(mask);
+		}
+		ptr += sizeof(__m256i);
+	}
+	// end NP2_USE_AVX2
+#elif NP2_USE_SSE2
+	while (ptr + sizeof(__m128i) <= end) {
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr));
+		__m128i safe = _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(chunk, _mm_set1_epi8('9' + 1)));
+		safe = _mm_or_si128(safe, _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8('A' - 1)), _mm_cmplt_epi8(chunk, _mm_set1_epi8('Z' + 1))));
+		safe = _mm_or_si128(safe, _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(chunk, _mm_set1_epi8('z' + 1))));
+		safe = _mm_or_si128(safe, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('-')));
+		safe = _mm_or_si128(safe, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('.')));
+		safe = _mm_or_si128(safe, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('_')));
+		safe = _mm_or_si128(safe, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('~')));
+		const uint32_t mask = mm_movemask_epi8(safe) ^ 0xffff;
+		if (mask != 0) {
+			return ptr + np2_ctz(mask);
+		}
+		ptr += sizeof(__m128i);
+	}
+	// end NP2_USE_SSE2
+#endif
+	while (ptr < end && !BitTestEx(UrlComponentCharSet, static_cast<uint8_t>(*ptr))) {
+		++ptr;
+	}
+	return ptr;
+}
+
 void EditURLEncode(bool component) noexcept {
 	const Sci_Position iSelCount = SciCall_GetSelTextLength();
 	if (iSelCount == 0) {
@@ -1734,25 +2819,115 @@ void EditURLEncode(bool component) noexcept {
 		return;
 	}
 
-	int cchEscapedW;
-	LPWSTR pszEscapedW = EditURLEncodeSelection(&cchEscapedW, component);
-	if (pszEscapedW == nullptr) {
+	const UINT cpEdit = SciCall_GetCodePage();
+	if (cpEdit != SC_CP_UTF8) {
+		// URL_ESCAPE_AS_UTF8 requires converting DBCS text through UTF-16.
+		int cchEscapedW;
+		LPWSTR pszEscapedW = EditURLEncodeSelection(&cchEscapedW, component);
+		if (pszEscapedW == nullptr) {
+			return;
+		}
+
+		char *pszEscaped = static_cast<char *>(NP2HeapAlloc(cchEscapedW * kMaxMultiByteCount));
+		const int cchEscaped = WideCharToMultiByte(cpEdit, 0, pszEscapedW, cchEscapedW, pszEscaped, static_cast<int>(NP2HeapSize(pszEscaped)), nullptr, nullptr);
+		EditReplaceMainSelection(cchEscaped, pszEscaped);
+
+		NP2HeapFree(pszEscaped);
+		NP2HeapFree(pszEscapedW);
 		return;
 	}
 
-	const UINT cpEdit = SciCall_GetCodePage();
-	char *pszEscaped = static_cast<char *>(NP2HeapAlloc(cchEscapedW * kMaxMultiByteCount));
-	const int cchEscaped = WideCharToMultiByte(cpEdit, 0, pszEscapedW, cchEscapedW, pszEscaped, static_cast<int>(NP2HeapSize(pszEscaped)), nullptr, nullptr);
-	EditReplaceMainSelection(cchEscaped, pszEscaped);
+	// UTF-8 text is escaped directly as bytes, the escaped bytes are counted
+	// first so the output is allocated at its exact size instead of three
+	// times the selection.
+	char *pszText = static_cast<char *>(NP2HeapAlloc(iSelCount + 1));
+	SciCall_GetSelText(pszText);
+
+	const char *start = pszText;
+	const char *end = pszText + iSelCount;
+	while (start < end && IsURLTrimChar(*start)) {
+		++start;
+	}
+	while (end > start && IsURLTrimChar(end[-1])) {
+		--end;
+	}
+	if (start == end) {
+		NP2HeapFree(pszText);
+		return;
+	}
+
+	const uint32_t * const escapeSet = component ? UrlComponentCharSet : UrlUnsafeCharSet;
+	Sci_Position count = 0;
+	const char *ptr = start;
+	while (ptr < end) {
+		ptr = FindUrlEscapeCandidate(ptr, end);
+		if (ptr < end) {
+			count += BitTestEx(escapeSet, static_cast<uint8_t>(*ptr));
+			++ptr;
+		}
+	}
+
+	char *pszEscaped = static_cast<char *>(NP2HeapAlloc(end - start + 2*count + 1));
+	char *out = pszEscaped;
+	ptr = start;
+	while (ptr < end) {
+		const char * const next = FindUrlEscapeCandidate(ptr, end);
+		memcpy(out, ptr, next - ptr);
+		out += next - ptr;
+		ptr = next;
+		if (ptr < end) {
+			const uint8_t ch = *ptr++;
+			if (BitTestEx(escapeSet, ch)) {
+				*out++ = '%';
+				*out++ = "0123456789ABCDEF"[ch >> 4];
+				*out++ = "0123456789ABCDEF"[ch & 15];
+			} else {
+				*out++ = static_cast<char>(ch);
+			}
+		}
+	}
 
+	EditReplaceMainSelection(out - pszEscaped, pszEscaped);
+	NP2HeapFree(pszText);
 	NP2HeapFree(pszEscaped);
-	NP2HeapFree(pszEscapedW);
 }
 
 //=============================================================================
 //
 // EditURLDecode()
 //
+// find the next '%' that may start an escaped sequence: everything in between
+// is copied unchanged in one block.
+static const char *FindPercentSign(const char *ptr, const char * const end) noexcept {
+#if NP2_USE_AVX2
+	const __m256i vectPercent = _mm256_set1_epi8('%');
+	while (ptr + sizeof(__m256i) <= end) {
+		const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ptr));
+		const uint32_t mask = mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, vectPercent));
+		if (mask != 0) {
+			return ptr + np2_ctz(mask);
+		}
+		ptr += sizeof(__m256i);
+	}
+	// end NP2_USE_AVX2
+#elif NP2_USE_SSE2
+	const __m128i vectPercent = _mm_set1_epi8('%');
+	while (ptr + sizeof(__m128i) <= end) {
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr));
+		const uint32_t mask = mm_movemask_epi8(_mm_cmpeq_epi8(chunk, vectPercent));
+		if (mask != 0) {
+			return ptr + np2_ctz(mask);
+		}
+		ptr += sizeof(__m128i);
+	}
+	// end NP2_USE_SSE2
+#endif
+	while (ptr < end && *ptr != '%') {
+		++ptr;
+	}
+	return ptr;
+}
+
 void EditURLDecode() noexcept {
 	const Sci_Position iSelCount = SciCall_GetSelTextLength();
 	if (iSelCount == 0) {
@@ -1763,11 +2938,59 @@ void EditURLDecode() noexcept {
 		return;
 	}
 
+	const UINT cpEdit = SciCall_GetCodePage();
+	if (cpEdit == SC_CP_UTF8) {
+		// URL_UNESCAPE_AS_UTF8 semantics: escaped sequences are UTF-8 bytes,
+		// decode them in place. Every valid %XX shrinks the text by two bytes,
+		// so counting them first gives the exact output size.
+		char *pszText = static_cast<char *>(NP2HeapAlloc(iSelCount + 1));
+		SciCall_GetSelText(pszText);
+		const char * const end = pszText + iSelCount;
+
+		Sci_Position count = 0;
+		const char *ptr = pszText;
+		while ((ptr = FindPercentSign(ptr, end)) != end) {
+			if (end - ptr >= 3 && IsHexDigit(ptr[1]) && IsHexDigit(ptr[2])) {
+				++count;
+				ptr += 3;
+			} else {
+				++ptr;
+			}
+		}
+		if (count == 0) {
+			NP2HeapFree(pszText);
+			return;
+		}
+
+		char *pszUnescaped = static_cast<char *>(NP2HeapAlloc(iSelCount - 2*count + 1));
+		char *out = pszUnescaped;
+		ptr = pszText;
+		while (ptr < end) {
+			const char * const next = FindPercentSign(ptr, end);
+			memcpy(out, ptr, next - ptr);
+			out += next - ptr;
+			ptr = next;
+			if (ptr < end) {
+				if (end - ptr >= 3 && IsHexDigit(ptr[1]) && IsHexDigit(ptr[2])) {
+					*out++ = static_cast<char>((GetHexDigit(ptr[1]) << 4) | GetHexDigit(ptr[2]));
+					ptr += 3;
+				} else {
+					*out++ = '%';
+					++ptr;
+				}
+			}
+		}
+
+		EditReplaceMainSelection(out - pszUnescaped, pszUnescaped);
+		NP2HeapFree(pszText);
+		NP2HeapFree(pszUnescaped);
+		return;
+	}
+
 	char *pszText = static_cast<char *>(NP2HeapAlloc(iSelCount + 1));
 	LPWSTR pszTextW = static_cast<LPWSTR>(NP2HeapAlloc((iSelCount + 1) * sizeof(WCHAR)));
 
 	SciCall_GetSelText(pszText);
-	const UINT cpEdit = SciCall_GetCodePage();
 	MultiByteToWideChar(cpEdit, 0, pszText, static_cast<int>(iSelCount), pszTextW, static_cast<int>(NP2HeapSize(pszTextW) / sizeof(WCHAR)));
 
 	char *pszUnescaped = static_cast<char *>(NP2HeapAlloc(NP2HeapSize(pszText) * 3));
@@ -2133,49 +3356,211 @@ void EditShowHex() noexcept {
 	NP2HeapFree(cch);
 }
 
-void EditBase64Encode(Base64EncodingFlag encodingFlag) noexcept {
-	const size_t len = SciCall_GetSelTextLength();
-	if (len == 0) {
-		return;
-	}
-	if (SciCall_IsRectangleSelection()){
-		NotifyRectangleSelection();
-		return;
-	}
-
-	char *input = static_cast<char *>(NP2HeapAlloc(len + 1));
-	SciCall_GetSelBytes(input);
-	size_t outLen = (len*4)/3 + 4 + MAX_PATH*2;
-	char *output = static_cast<char *>(NP2HeapAlloc(outLen));
-	outLen = 0;
-	if (encodingFlag == Base64EncodingFlag_HtmlEmbeddedImage) {
-		memcpy(output, "<img src=\"data:image/", CSTRLEN("<img src=\"data:image/"));
-		outLen = CSTRLEN("<img src=\"data:image/");
-		LPCWSTR suffix = PathFindExtension(szCurFile);
-		if (*suffix == L'.') {
-			// image file extension should be ASCII
-			++suffix;
-			while (*suffix) {
-				output[outLen++] = static_cast<char>(ToLowerA(*suffix++));
+//=============================================================================
+//
+// EditToggleHexView()
+// Read-only hex presentation of the current document. Only a window of bytes
+// around the caret is ever formatted; scrolling near either edge of the dump
+// slides the window (EditHexViewFollowScroll()), so the mode opens instantly
+// on gigabyte files without materializing a four times larger text copy.
+//
+bool bHexViewMode = false;
+static HANDLE hexViewDocSource = nullptr;	// the real document, referenced while the mode is active
+static HANDLE hexViewDocView = nullptr;		// the dump document shown in the view
+static Sci_Position hexViewSourceLength;
+static Sci_Position hexViewWindowStart;
+static Sci_Position hexViewWindowEnd;
+
+constexpr Sci_Position HexViewBytesPerLine = 16;
+constexpr Sci_Position HexViewWindowBytes = 256*1024;
+// slide the window when scrolled this close to either edge of the dump
+constexpr Sci_Line HexViewMarginLines = 64;
+// 8 hex digit offset, two spaces, 16 "XX " columns, the printable bytes between '|'.
+constexpr Sci_Position HexViewCharsPerLine = 8 + 2 + 3*HexViewBytesPerLine + 2 + HexViewBytesPerLine + 1;
+
+static void EditHexViewRender(Sci_Position startByte) noexcept {
+	startByte = max<Sci_Position>(startByte, 0) & ~(HexViewBytesPerLine - 1);
+	startByte = min(startByte, hexViewSourceLength & ~(HexViewBytesPerLine - 1));
+	const Sci_Position endByte = min(startByte + HexViewWindowBytes, hexViewSourceLength);
+	const Sci_Position count = endByte - startByte;
+
+	// take a copy of the bytes while the real document is attached to the view
+	char * const bytes = static_cast<char *>(NP2HeapAlloc(count + 1));
+	if (count != 0) {
+		SciCall_SetDocPointer(hexViewDocSource);
+		memcpy(bytes, SciCall_GetRangePointer(startByte, count), count);
+		SciCall_SetDocPointer(hexViewDocView);
+	}
+
+	const Sci_Line lineCount = (count + HexViewBytesPerLine - 1)/HexViewBytesPerLine;
+	char * const dump = static_cast<char *>(NP2HeapAlloc(max<Sci_Position>(lineCount, 1)*HexViewCharsPerLine + 1));
+	static constexpr char hex[] = "0123456789ABCDEF";
+	const uint8_t *p = reinterpret_cast<const uint8_t *>(bytes);
+	char *t = dump;
+	for (Sci_Position offset = startByte; offset < endByte; offset += HexViewBytesPerLine) {
+		const Sci_Position chunk = min(endByte - offset, HexViewBytesPerLine);
+		for (int shift = 28; shift >= 0; shift -= 4) {
+			*t++ = hex[(offset >> shift) & 15];
+		}
+		*t++ = ' ';
+		*t++ = ' ';
+		for (Sci_Position i = 0; i < HexViewBytesPerLine; i++) {
+			if (i < chunk) {
+				const uint8_t c = p[i];
+				*t++ = hex[c >> 4];
+				*t++ = hex[c & 15];
+			} else {
+				*t++ = ' ';
+				*t++ = ' ';
 			}
+			*t++ = ' ';
 		}
-		memcpy(output + outLen, ";base64,", CSTRLEN(";base64,"));
-		outLen += CSTRLEN(";base64,");
-	}
-	outLen += Base64Encode(output + outLen, reinterpret_cast<const uint8_t *>(input), len, encodingFlag == Base64EncodingFlag_UrlSafe);
-	if (encodingFlag == Base64EncodingFlag_HtmlEmbeddedImage) {
-		memcpy(output + outLen, "\" />", CSTRLEN("\" />"));
-		outLen += CSTRLEN("\" />");
+		*t++ = '|';
+		for (Sci_Position i = 0; i < chunk; i++) {
+			const uint8_t c = p[i];
+			*t++ = (c >= 32 && c < 127) ? static_cast<char>(c) : '.';
+		}
+		*t++ = '|';
+		*t++ = '\n';
+		p += chunk;
 	}
+	*t = '\0';
 
-	EditReplaceMainSelection(outLen, output);
-	NP2HeapFree(input);
-	NP2HeapFree(output);
-}
-
-void EditBase64Decode(bool decodeAsHex) noexcept {
-	size_t len = SciCall_GetSelTextLength();
-	if (len == 0) {
+	bFreezeAppTitle = true;
+	SciCall_SetModEventMask(SC_MOD_NONE);
+	SciCall_SetReadOnly(false);
+	SciCall_SetText(dump);
+	SciCall_SetReadOnly(true);
+	SciCall_SetSavePoint();
+	SciCall_SetModEventMask(SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT);
+	bFreezeAppTitle = false;
+	NP2HeapFree(bytes);
+	NP2HeapFree(dump);
+	hexViewWindowStart = startByte;
+	hexViewWindowEnd = endByte;
+}
+
+void EditToggleHexView() noexcept {
+	if (!bHexViewMode) {
+		hexViewDocSource = SciCall_GetDocPointer();
+		SciCall_AddRefDocument(hexViewDocSource);
+		hexViewSourceLength = SciCall_GetLength();
+		const Sci_Position pos = SciCall_GetCurrentPos();
+
+		// the dump never holds more than one window of formatted text
+		const int options = SciCall_GetDocumentOptions() | SC_DOCUMENTOPTION_STYLES_NONE;
+		hexViewDocView = SciCall_CreateDocument(HexViewWindowBytes*HexViewCharsPerLine/HexViewBytesPerLine, options);
+		SciCall_SetDocPointer(hexViewDocView);	// the view takes its own reference
+		SciCall_SetCodePage(SC_CP_UTF8);
+		SciCall_SetUndoCollection(false);
+		bHexViewMode = true;
+		EditHexViewRender(pos - HexViewWindowBytes/2);
+		SciCall_GotoLine((pos - hexViewWindowStart)/HexViewBytesPerLine);
+	} else {
+		// return with the caret on the byte of the dump line it was on
+		const Sci_Position offset = min(hexViewWindowStart
+			+ SciCall_LineFromPosition(SciCall_GetCurrentPos())*HexViewBytesPerLine, hexViewSourceLength);
+		bHexViewMode = false;
+		SciCall_SetDocPointer(hexViewDocSource);
+		SciCall_ReleaseDocument(hexViewDocView);
+		SciCall_ReleaseDocument(hexViewDocSource);
+		hexViewDocView = nullptr;
+		hexViewDocSource = nullptr;
+		SciCall_GotoPos(offset);
+	}
+}
+
+void EditHexViewFollowScroll() noexcept {
+	static bool sliding = false;
+	if (sliding) {
+		return;
+	}
+	const Sci_Line topLine = SciCall_DocLineFromVisible(SciCall_GetFirstVisibleLine());
+	const Sci_Line lineCount = SciCall_GetLineCount();
+	const bool nearStart = hexViewWindowStart > 0 && topLine < HexViewMarginLines;
+	const bool nearEnd = hexViewWindowEnd < hexViewSourceLength
+		&& topLine > lineCount - HexViewMarginLines - SciCall_LinesOnScreen();
+	if (!nearStart && !nearEnd) {
+		return;
+	}
+
+	sliding = true;
+	const Sci_Position topByte = hexViewWindowStart + topLine*HexViewBytesPerLine;
+	const Sci_Position caretByte = hexViewWindowStart
+		+ SciCall_LineFromPosition(SciCall_GetCurrentPos())*HexViewBytesPerLine;
+	EditHexViewRender(topByte - HexViewWindowBytes/2);
+	// keep the same bytes on screen and under the caret
+	SciCall_GotoLine((caretByte - hexViewWindowStart)/HexViewBytesPerLine);
+	SciCall_SetFirstVisibleLine(SciCall_VisibleFromDocLine((topByte - hexViewWindowStart)/HexViewBytesPerLine));
+	sliding = false;
+}
+
+// multiple of 3 input bytes and 4 base64 characters, so every chunk but the
+// last transforms whole groups and chunks can be replaced independently.
+// also a multiple of 16 decoded bytes to keep the hex dump lines aligned.
+#define NP2_BASE64_CHUNK_CHARS	(1024*1024)
+
+void EditBase64Encode(Base64EncodingFlag encodingFlag) noexcept {
+	const Sci_Position iSelStart = SciCall_GetSelectionStart();
+	const Sci_Position iSelEnd = SciCall_GetSelectionEnd();
+	if (iSelStart == iSelEnd) {
+		return;
+	}
+	if (SciCall_IsRectangleSelection()){
+		NotifyRectangleSelection();
+		return;
+	}
+
+	// stream the selection through Base64Encode() one chunk at a time, each
+	// replaced in place, so a huge selection never materializes input and
+	// output buffers for the whole text at once.
+	constexpr Sci_Position chunkBytes = NP2_BASE64_CHUNK_CHARS/4*3;
+	char * const output = static_cast<char *>(NP2HeapAlloc(NP2_BASE64_CHUNK_CHARS + 8 + MAX_PATH*2));
+	const bool backwards = SciCall_GetAnchor() > SciCall_GetCurrentPos();
+	Sci_Position readPos = iSelStart;
+	Sci_Position remaining = iSelEnd - iSelStart;
+	SciCall_BeginUndoAction();
+	while (remaining > 0) {
+		const Sci_Position inLen = min(remaining, chunkBytes);
+		size_t outLen = 0;
+		if (readPos == iSelStart && encodingFlag == Base64EncodingFlag_HtmlEmbeddedImage) {
+			memcpy(output, "<img src=\"data:image/", CSTRLEN("<img src=\"data:image/"));
+			outLen = CSTRLEN("<img src=\"data:image/");
+			LPCWSTR suffix = PathFindExtension(szCurFile);
+			if (*suffix == L'.') {
+				// image file extension should be ASCII
+				++suffix;
+				while (*suffix) {
+					output[outLen++] = static_cast<char>(ToLowerA(*suffix++));
+				}
+			}
+			memcpy(output + outLen, ";base64,", CSTRLEN(";base64,"));
+			outLen += CSTRLEN(";base64,");
+		}
+		const char * const input = SciCall_GetRangePointer(readPos, inLen);
+		outLen += Base64Encode(output + outLen, reinterpret_cast<const uint8_t *>(input), inLen, encodingFlag == Base64EncodingFlag_UrlSafe);
+		remaining -= inLen;
+		if (remaining == 0 && encodingFlag == Base64EncodingFlag_HtmlEmbeddedImage) {
+			memcpy(output + outLen, "\" />", CSTRLEN("\" />"));
+			outLen += CSTRLEN("\" />");
+		}
+		SciCall_SetTargetRange(readPos, readPos + inLen);
+		SciCall_ReplaceTarget(outLen, output);
+		readPos += outLen;
+	}
+	SciCall_EndUndoAction();
+	if (backwards) {
+		SciCall_SetSel(readPos, iSelStart);
+	} else {
+		SciCall_SetSel(iSelStart, readPos);
+	}
+	NP2HeapFree(output);
+}
+
+void EditBase64Decode(bool decodeAsHex) noexcept {
+	const Sci_Position iSelStart = SciCall_GetSelectionStart();
+	Sci_Position iSelEnd = SciCall_GetSelectionEnd();
+	if (iSelStart == iSelEnd) {
 		return;
 	}
 	if (SciCall_IsRectangleSelection()){
@@ -2183,18 +3568,33 @@ void EditBase64Decode(bool decodeAsHex) noexcept {
 		return;
 	}
 
-	char *input = static_cast<char *>(NP2HeapAlloc(len + 1));
-	SciCall_GetSelText(input);
-	size_t outLen = (len*3)/4 + 4;
-	uint8_t *output = static_cast<uint8_t *>(NP2HeapAlloc(outLen));
-	outLen = Base64Decode(output, reinterpret_cast<const uint8_t *>(input), len);
-	NP2HeapFree(input);
-	if (outLen != 0) {
-		if(decodeAsHex) {
-			const int iEOLMode = SciCall_GetEOLMode();
-			len = outLen*3 + outLen/8;
-			input = static_cast<char *>(NP2HeapAlloc(len + 1));
-			char *t = input;
+	// stream the selection through Base64Decode() one chunk at a time. a
+	// chunk that stops before a character outside the alphabet ends the
+	// transform: everything from there to the end of the selection is
+	// dropped with the final replacement, as the whole-buffer version did.
+	constexpr Sci_Position chunkBytes = NP2_BASE64_CHUNK_CHARS/4*3;
+	const int iEOLMode = SciCall_GetEOLMode();
+	uint8_t * const output = static_cast<uint8_t *>(NP2HeapAlloc(chunkBytes + 4));
+	char * const text = decodeAsHex ? static_cast<char *>(NP2HeapAlloc(chunkBytes*3 + chunkBytes/8 + 4)) : nullptr;
+	const bool backwards = SciCall_GetAnchor() > SciCall_GetCurrentPos();
+	Sci_Position readPos = iSelStart;
+	bool replaced = false;
+	SciCall_BeginUndoAction();
+	while (readPos < iSelEnd) {
+		const Sci_Position inLen = min<Sci_Position>(iSelEnd - readPos, NP2_BASE64_CHUNK_CHARS);
+		const char * const input = SciCall_GetRangePointer(readPos, inLen);
+		const size_t outLen = Base64Decode(output, reinterpret_cast<const uint8_t *>(input), inLen);
+		// a full chunk is whole groups, so any stop shows in the length
+		const Sci_Position tailChars = inLen & 3;
+		const bool stopped = outLen != static_cast<size_t>((inLen/4)*3 + tailChars - (tailChars > 1 ? 1 : 0));
+		if (outLen == 0 && !replaced) {
+			break;	// nothing decodable, leave the selection untouched
+		}
+		const char *chunkText = reinterpret_cast<char *>(output);
+		size_t textLen = outLen;
+		if (decodeAsHex && outLen != 0) {
+			// chunks decode whole hex dump lines, so (i & 15) stays aligned
+			char *t = text;
 			size_t i = 0;
 			do {
 				const uint8_t c = output[i++];
@@ -2220,11 +3620,29 @@ void EditBase64Decode(bool decodeAsHex) noexcept {
 			if ((i & 15) != 0) {
 				--t;
 			}
-			outLen = t - input;
-			NP2HeapFree(output);
-			output = reinterpret_cast<uint8_t *>(input);
+			chunkText = text;
+			textLen = t - text;
+		}
+		const Sci_Position replaceEnd = stopped ? iSelEnd : readPos + inLen;
+		SciCall_SetTargetRange(readPos, replaceEnd);
+		SciCall_ReplaceTarget(textLen, chunkText);
+		replaced = true;
+		iSelEnd += textLen - (replaceEnd - readPos);
+		readPos += textLen;
+		if (stopped) {
+			break;
 		}
-		EditReplaceMainSelection(outLen, reinterpret_cast<char *>(output));
+	}
+	SciCall_EndUndoAction();
+	if (replaced) {
+		if (backwards) {
+			SciCall_SetSel(readPos, iSelStart);
+		} else {
+			SciCall_SetSel(iSelStart, readPos);
+		}
+	}
+	if (text != nullptr) {
+		NP2HeapFree(text);
 	}
 	NP2HeapFree(output);
 }
@@ -2461,6 +3879,66 @@ void EditModifyNumber(bool bIncrease) {
 	}
 }
 
+//=============================================================================
+//
+// EditTabsToSpaces() / EditSpacesToTabs()
+//
+// find the next character the conversion state machine has to look at:
+// a line end plus the whitespace characters currently being converted;
+// everything in between is copied unchanged in one block.
+static const WCHAR *FindTabConvBreak(const WCHAR *ptr, const WCHAR * const end, WCHAR chExtra1, WCHAR chExtra2) noexcept {
+#if NP2_USE_AVX2
+	const __m256i vectCR = _mm256_set1_epi16(L'\r');
+	const __m256i vectLF = _mm256_set1_epi16(L'\n');
+	const __m256i vectExtra1 = _mm256_set1_epi16(chExtra1);
+	const __m256i vectExtra2 = _mm256_set1_epi16(chExtra2);
+	while (ptr + sizeof(__m256i)/sizeof(WCHAR) <= end) {
+		const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ptr));
+		__m256i found = _mm256_or_si256(_mm256_cmpeq_epi16(chunk, vectCR), _mm256_cmpeq_epi16(chunk, vectLF));
+		found = _mm256_or_si256(found, _mm256_cmpeq_epi16(chunk, vectExtra1));
+		found = _mm256_or_si256(found, _mm256_cmpeq_epi16(chunk, vectExtra2));
+		const uint32_t mask = mm256_movemask_epi8(found);
+		if (mask != 0) {
+			return ptr + np2_ctz(mask)/2;
+		}
+		ptr += sizeof(__m256i)/sizeof(WCHAR);
+	}
+	// end NP2_USE_AVX2
+#elif NP2_USE_SSE2
+	const __m128i vectCR = _mm_set1_epi16(L'\r');
+	const __m128i vectLF = _mm_set1_epi16(L'\n');
+	const __m128i vectExtra1 = _mm_set1_epi16(chExtra1);
+	const __m128i vectExtra2 = _mm_set1_epi16(chExtra2);
+	while (ptr + sizeof(__m128i)/sizeof(WCHAR) <= end) {
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr));
+		__m128i found = _mm_or_si128(_mm_cmpeq_epi16(chunk, vectCR), _mm_cmpeq_epi16(chunk, vectLF));
+		found = _mm_or_si128(found, _mm_cmpeq_epi16(chunk, vectExtra1));
+		found = _mm_or_si128(found, _mm_cmpeq_epi16(chunk, vectExtra2));
+		const uint32_t mask = mm_movemask_epi8(found);
+		if (mask != 0) {
+			return ptr + np2_ctz(mask)/2;
+		}
+		ptr += sizeof(__m128i)/sizeof(WCHAR);
+	}
+	// end NP2_USE_SSE2
+#endif
+	while (ptr < end) {
+		const WCHAR w = *ptr;
+		if (w == L'\r' || w == L'\n' || w == chExtra1 || w == chExtra2) {
+			break;
+		}
+		++ptr;
+	}
+	return ptr;
+}
+
+static inline bool IsAllSpaces(const WCHAR *ptr, const WCHAR * const end) noexcept {
+	while (ptr < end && *ptr == L' ') {
+		++ptr;
+	}
+	return ptr == end;
+}
+
 //=============================================================================
 //
 // EditTabsToSpaces()
@@ -2498,8 +3976,26 @@ void EditTabsToSpaces(int nTabWidth, bool bOnlyIndentingWS) noexcept {
 	bool bModified = false;
 	// Contributed by Homam, Thank you very much!
 	int i = 0;
-	for (int iTextW = 0; iTextW < cchTextW; iTextW++) {
-		const WCHAR w = pszTextW[iTextW];
+	const WCHAR * const pwEnd = pszTextW + cchTextW;
+	const WCHAR *pw = pszTextW;
+	while (pw < pwEnd) {
+		// tabs after the indentation are left alone until the next line end.
+		const WCHAR chExtra = (!bOnlyIndentingWS || bIsLineStart) ? L'\t' : L'\r';
+		const WCHAR * const next = FindTabConvBreak(pw, pwEnd, chExtra, chExtra);
+		if (next != pw) {
+			const int len = static_cast<int>(next - pw);
+			if (bOnlyIndentingWS && bIsLineStart && !IsAllSpaces(pw, next)) {
+				bIsLineStart = false;
+			}
+			memcpy(pszConvW + cchConvW, pw, len * sizeof(WCHAR));
+			cchConvW += len;
+			i += len;
+			pw = next;
+			if (pw == pwEnd) {
+				break;
+			}
+		}
+		const WCHAR w = *pw++;
 		if (w == L'\t' && (!bOnlyIndentingWS || bIsLineStart)) {
 			for (int j = 0; j < nTabWidth - (i % nTabWidth); j++) {
 				pszConvW[cchConvW++] = L' ';
@@ -2511,7 +4007,7 @@ void EditTabsToSpaces(int nTabWidth, bool bOnlyIndentingWS) noexcept {
 			if (w == L'\n' || w == L'\r') {
 				i = 0;
 				bIsLineStart = true;
-			} else if (w != L' ') {
+			} else {
 				bIsLineStart = false;
 			}
 			pszConvW[cchConvW++] = w;
@@ -2570,12 +4066,33 @@ void EditSpacesToTabs(int nTabWidth, bool bOnlyIndentingWS) noexcept {
 	int i = 0;
 	int j = 0;
 	WCHAR space[256];
-	for (int iTextW = 0; iTextW < cchTextW; iTextW++) {
-		const WCHAR w = pszTextW[iTextW];
+	const WCHAR * const pwEnd = pszTextW + cchTextW;
+	const WCHAR *pw = pszTextW;
+	while (pw < pwEnd) {
+		// whitespace after the indentation is left alone until the next line end.
+		const bool convert = !bOnlyIndentingWS || bIsLineStart;
+		const WCHAR * const next = FindTabConvBreak(pw, pwEnd, convert ? L'\t' : L'\r', convert ? L' ' : L'\r');
+		if (next != pw) {
+			const int len = static_cast<int>(next - pw);
+			i += j + len;
+			if (j > 0) {
+				memcpy(pszConvW + cchConvW, space, j * sizeof(WCHAR));
+				cchConvW += j;
+				j = 0;
+			}
+			memcpy(pszConvW + cchConvW, pw, len * sizeof(WCHAR));
+			cchConvW += len;
+			bIsLineStart = false;
+			pw = next;
+			if (pw == pwEnd) {
+				break;
+			}
+		}
+		const WCHAR w = *pw++;
 		if ((w == L' ' || w == L'\t') && (!bOnlyIndentingWS || bIsLineStart)) {
 			space[j++] = w;
 			if (j == nTabWidth - (i % nTabWidth) || w == L'\t') {
-				if (j > 1 || pszTextW[iTextW + 1] == L' ' || pszTextW[iTextW + 1] == L'\t') {
+				if (j > 1 || *pw == L' ' || *pw == L'\t') {
 					pszConvW[cchConvW++] = L'\t';
 				} else {
 					pszConvW[cchConvW++] = w;
@@ -2586,10 +4103,8 @@ void EditSpacesToTabs(int nTabWidth, bool bOnlyIndentingWS) noexcept {
 		} else {
 			i += j + 1;
 			if (j > 0) {
-				//space[j] = '\0';
-				for (int t = 0; t < j; t++) {
-					pszConvW[cchConvW++] = space[t];
-				}
+				memcpy(pszConvW + cchConvW, space, j * sizeof(WCHAR));
+				cchConvW += j;
 				j = 0;
 			}
 			if (w == L'\n' || w == L'\r') {
@@ -2603,9 +4118,8 @@ void EditSpacesToTabs(int nTabWidth, bool bOnlyIndentingWS) noexcept {
 	}
 
 	if (j > 0) {
-		for (int t = 0; t < j; t++) {
-			pszConvW[cchConvW++] = space[t];
-		}
+		memcpy(pszConvW + cchConvW, space, j * sizeof(WCHAR));
+		cchConvW += j;
 	}
 
 	NP2HeapFree(pszTextW);
@@ -2788,7 +4302,7 @@ struct EditModifyLinesText {
 	char *mszPrefix;
 	const char *mszSuffix;
 	void Parse(LPCWSTR pszTextW, Sci_Line iLineStart, Sci_Line iLineEnd, UINT cpEdit, int iEOLMode) noexcept;
-	void Insert(char *mszInsert, Sci_Line iLine, Sci_Position position) noexcept;
+	void Format(char *mszInsert, Sci_Line iLine) noexcept;
 };
 
 void EditModifyLinesText::Parse(LPCWSTR pszTextW, Sci_Line iLineStart, Sci_Line iLineEnd, UINT cpEdit, int iEOLMode) noexcept {
@@ -2834,7 +4348,7 @@ void EditModifyLinesText::Parse(LPCWSTR pszTextW, Sci_Line iLineStart, Sci_Line
 	}
 }
 
-void EditModifyLinesText::Insert(char *mszInsert, Sci_Line iLine, Sci_Position position) noexcept {
+void EditModifyLinesText::Format(char *mszInsert, Sci_Line iLine) noexcept {
 	strcpy(mszInsert, mszPrefix);
 	if (substitution != EditModifyLinesSubstitution_None) {
 		char tchNum[64];
@@ -2857,9 +4371,87 @@ void EditModifyLinesText::Insert(char *mszInsert, Sci_Line iLine, Sci_Position p
 		strcat(mszInsert, mszSuffix);
 		number++;
 	}
+}
+
+// Collects replacements computed from a document snapshot and commits them in
+// one batch: spans are recorded in document order while scanning, then applied
+// bottom up inside a single undo action and modification batch, so recorded
+// positions never need adjusting, the buffer gap moves monotonically and the
+// container pays one notification round instead of one per line. Targeted
+// spans (rather than rewriting the whole range) keep markers, bookmarks and
+// change history on untouched text alive.
+struct EditSpanBatch {
+	struct Span {
+		Sci_Position pos;
+		Sci_Position deleteLength;
+		Sci_Position insertLength;
+		Sci_Position textOffset;	// into the text arena
+	};
+	Span *spans;
+	size_t count;
+	size_t capacity;
+	char *text;
+	Sci_Position textUsed;
+	Sci_Position textCapacity;
+
+	void Replace(Sci_Position pos, Sci_Position deleteLength, const char *insert, Sci_Position insertLength) noexcept;
+	void Delete(Sci_Position pos, Sci_Position deleteLength) noexcept {
+		Replace(pos, deleteLength, nullptr, 0);
+	}
+	void Insert(Sci_Position pos, const char *insert, Sci_Position insertLength) noexcept {
+		Replace(pos, 0, insert, insertLength);
+	}
+	void Apply() noexcept;
+	void Free() noexcept;
+};
+
+void EditSpanBatch::Replace(Sci_Position pos, Sci_Position deleteLength, const char *insert, Sci_Position insertLength) noexcept {
+	if (count == capacity) {
+		capacity = (capacity == 0) ? 256 : capacity*2;
+		spans = static_cast<Span *>(spans
+			? NP2HeapReAlloc(spans, capacity*sizeof(Span))
+			: NP2HeapAlloc(capacity*sizeof(Span)));
+	}
+	if (insertLength != 0) {
+		if (textUsed + insertLength > textCapacity) {
+			textCapacity = max(textUsed + insertLength, (textCapacity == 0) ? 4096 : textCapacity*2);
+			text = static_cast<char *>(text
+				? NP2HeapReAlloc(text, textCapacity)
+				: NP2HeapAlloc(textCapacity));
+		}
+		memcpy(text + textUsed, insert, insertLength);
+	}
+	Span &span = spans[count++];
+	span.pos = pos;
+	span.deleteLength = deleteLength;
+	span.insertLength = insertLength;
+	span.textOffset = textUsed;
+	textUsed += insertLength;
+}
+
+void EditSpanBatch::Apply() noexcept {
+	if (count == 0) {
+		return;
+	}
+	SciCall_BeginUndoAction();
+	BeginModificationBatch();
+	for (size_t i = count; i != 0; ) {
+		--i;
+		const Span &span = spans[i];
+		SciCall_SetTargetRange(span.pos, span.pos + span.deleteLength);
+		SciCall_ReplaceTarget(span.insertLength, (span.insertLength != 0) ? text + span.textOffset : "");
+	}
+	EndModificationBatch();
+	SciCall_EndUndoAction();
+}
 
-	SciCall_SetTargetRange(position, position);
-	SciCall_ReplaceTarget(-1, mszInsert);
+void EditSpanBatch::Free() noexcept {
+	if (spans) {
+		NP2HeapFree(spans);
+	}
+	if (text) {
+		NP2HeapFree(text);
+	}
 }
 
 }
@@ -2902,26 +4494,26 @@ void EditModifyLines(LPCWSTR pwszPrefix, LPCWSTR pwszAppend, bool skipEmptyLine)
 	suffix.Parse(pwszAppend, iLineStart, iLineEnd, cpEdit, iEOLMode);
 
 	char *mszInsert = static_cast<char *>(NP2HeapAlloc(prefix.length + suffix.length + 64));
-	SciCall_BeginUndoAction();
-	for (Sci_Line iLine = iLineStart, iLineDest = iLineStart; iLine <= iLineEnd; iLine++, iLineDest++) {
-		const Sci_Position iStartPos = SciCall_PositionFromLine(iLineDest);
-		Sci_Position iEndPos = SciCall_GetLineEndPosition(iLineDest);
+	// positions all refer to the unmodified document, the batch applies
+	// them bottom up so inserted prefix lines can't shift later spans.
+	EditSpanBatch batch {};
+	for (Sci_Line iLine = iLineStart; iLine <= iLineEnd; iLine++) {
+		const Sci_Position iStartPos = SciCall_PositionFromLine(iLine);
+		const Sci_Position iEndPos = SciCall_GetLineEndPosition(iLine);
 		if (skipEmptyLine && iStartPos == iEndPos) {
 			continue;
 		}
 		if (prefix.length != 0) {
-			iLineDest += prefix.lineCount;
-			prefix.Insert(mszInsert, iLine, iStartPos);
+			prefix.Format(mszInsert, iLine);
+			batch.Insert(iStartPos, mszInsert, strlen(mszInsert));
 		}
 		if (suffix.length != 0) {
-			if (prefix.length != 0) {
-				iEndPos = SciCall_GetLineEndPosition(iLineDest);
-			}
-			iLineDest += suffix.lineCount;
-			suffix.Insert(mszInsert, iLine, iEndPos);
+			suffix.Format(mszInsert, iLine);
+			batch.Insert(iEndPos, mszInsert, strlen(mszInsert));
 		}
 	}
-	SciCall_EndUndoAction();
+	batch.Apply();
+	batch.Free();
 
 	//// Fix selection
 	//if (iSelStart != iSelEnd && SciCall_GetTargetEnd() > SciCall_GetSelectionEnd()) {
@@ -3017,14 +4609,17 @@ void EditAlignText(EditAlignMode nMode) noexcept {
 			WCHAR wchNewLineBuf[BUFSIZE_ALIGN * 3];
 		};
 		EditAlignTextVar * const var = static_cast<EditAlignTextVar *>(NP2HeapAlloc(sizeof(EditAlignTextVar)));
-		SciCall_BeginUndoAction();
+		const int tabWidth = max(fvCurFile.iTabWidth, 1);
+		// the whole pass records spans against the unmodified document and
+		// commits them in one batch instead of editing each line in place.
+		EditSpanBatch batch {};
 		for (Sci_Line iLine = iLineStart; iLine <= iLineEnd; iLine++) {
+			const Sci_Position iStartPos = SciCall_PositionFromLine(iLine);
 			const Sci_Position iIndentPos = SciCall_GetLineIndentPosition(iLine);
 			const Sci_Position iEndPos = SciCall_GetLineEndPosition(iLine);
 
 			if (iIndentPos == iEndPos && iEndPos > 0) {
-				const Sci_Position iStartPos = SciCall_PositionFromLine(iLine);
-				SciCall_DeleteRange(iStartPos, iEndPos - iStartPos);
+				batch.Delete(iStartPos, iEndPos - iStartPos);
 			} else {
 				char* const tchLineBuf = var->tchLineBuf;
 				WCHAR* const wchLineBuf = var->wchLineBuf;
@@ -3090,12 +4685,6 @@ void EditAlignText(EditAlignMode nMode) noexcept {
 								lstrcat(p, pWords[i]);
 								p = StrEnd(p);
 							}
-
-							WideCharToMultiByte(cpEdit, 0, wchNewLineBuf, -1, tchLineBuf, COUNTOF(var->tchLineBuf), nullptr, nullptr);
-
-							SciCall_SetTargetRange(SciCall_PositionFromLine(iLine), SciCall_GetLineEndPosition(iLine));
-							SciCall_ReplaceTarget(-1, tchLineBuf);
-							SciCall_SetLineIndentation(iLine, iMinIndent);
 						} else {
 							lstrcpy(wchNewLineBuf, pWords[0]);
 							p = StrEnd(wchNewLineBuf);
@@ -3106,12 +4695,6 @@ void EditAlignText(EditAlignMode nMode) noexcept {
 								lstrcat(wchNewLineBuf, pWords[i]);
 								p = StrEnd(p);
 							}
-
-							WideCharToMultiByte(cpEdit, 0, wchNewLineBuf, -1, tchLineBuf, COUNTOF(var->tchLineBuf), nullptr, nullptr);
-
-							SciCall_SetTargetRange(SciCall_PositionFromLine(iLine), SciCall_GetLineEndPosition(iLine));
-							SciCall_ReplaceTarget(-1, tchLineBuf);
-							SciCall_SetLineIndentation(iLine, iMinIndent);
 						}
 					} else {
 						const Sci_Position iExtraSpaces = iMaxLength - iMinIndent - iWordsLength - iWords + 1;
@@ -3142,27 +4725,26 @@ void EditAlignText(EditAlignMode nMode) noexcept {
 							}
 							p = StrEnd(p);
 						}
+					}
 
-						WideCharToMultiByte(cpEdit, 0, wchNewLineBuf, -1, tchLineBuf, COUNTOF(var->tchLineBuf), nullptr, nullptr);
-
-						Sci_Position iPos;
-						if (nMode == EditAlignMode_Right || nMode == EditAlignMode_Center) {
-							SciCall_SetLineIndentation(iLine, iMinIndent);
-							iPos = SciCall_GetLineIndentPosition(iLine);
-						} else {
-							iPos = SciCall_PositionFromLine(iLine);
-						}
-
-						SciCall_SetTargetRange(iPos, SciCall_GetLineEndPosition(iLine));
-						SciCall_ReplaceTarget(-1, tchLineBuf);
-						if (nMode == EditAlignMode_Left) {
-							SciCall_SetLineIndentation(iLine, iMinIndent);
-						}
+					// every mode reduces to the common indentation followed by
+					// the rebuilt content, replacing the whole line.
+					Sci_Position tab = 0;
+					Sci_Position count = iMinIndent;
+					if (!fvCurFile.bTabsAsSpaces) {
+						tab = count / tabWidth;
+						count %= tabWidth;
+						memset(tchLineBuf, '\t', tab);
 					}
+					memset(tchLineBuf + tab, ' ', count);
+					const Sci_Position cbIndent = tab + count;
+					WideCharToMultiByte(cpEdit, 0, wchNewLineBuf, -1, tchLineBuf + cbIndent, static_cast<int>(COUNTOF(var->tchLineBuf) - cbIndent), nullptr, nullptr);
+					batch.Replace(iStartPos, iEndPos - iStartPos, tchLineBuf, cbIndent + strlen(tchLineBuf + cbIndent));
 				}
 			}
 		}
-		SciCall_EndUndoAction();
+		batch.Apply();
+		batch.Free();
 		NP2HeapFree(var);
 	} else {
 		MsgBoxInfo(MB_OK, IDS_BUFFERTOOSMALL);
@@ -3296,19 +4878,57 @@ void EditToggleLineComments(LPCWSTR pwszComment, int commentFlag) noexcept {
 		}
 	}
 
+	// one pass over the document snapshot computes per-line geometry, the
+	// second decides each line's action; edits are committed as one batch
+	// instead of a message round trip per line.
+	struct CommentLineRecord {
+		Sci_Position start;		// offsets into the snapshot
+		Sci_Position indent;	// first character past the leading whitespace
+		Sci_Position end;		// line end excluding the line break
+	};
+
+	const Sci_Position iRangeStart = SciCall_PositionFromLine(iLineStart);
+	const Sci_Position iRangeEnd = SciCall_GetLineEndPosition(iLineEnd);
+	const Sci_Position iRangeLength = iRangeEnd - iRangeStart;
+	const char * const snapshot = SciCall_GetRangePointer(iRangeStart, iRangeLength);
+	const int tabWidth = max(fvCurFile.iTabWidth, 1);
+	CommentLineRecord * const records = static_cast<CommentLineRecord *>(NP2HeapAlloc((iLineEnd - iLineStart + 1)*sizeof(CommentLineRecord)));
+
 	Sci_Position iCommentCol = 0;
 	if ((commentFlag & AutoInsertMask_CommentAtStart) == 0) {
 		iCommentCol = 1024 - 1 - cchComment;
-		for (Sci_Line iLine = iLineStart; iLine <= iLineEnd; iLine++) {
-			const Sci_Position iLineEndPos = SciCall_GetLineEndPosition(iLine);
-			const Sci_Position iLineIndentPos = SciCall_GetLineIndentPosition(iLine);
-
-			if (iLineIndentPos != iLineEndPos) {
-				const Sci_Position iIndentColumn = SciCall_GetColumn(iLineIndentPos);
-				iCommentCol = min(iCommentCol, iIndentColumn);
+	}
+	Sci_Line lineCount = 0;
+	for (Sci_Position offset = 0; offset <= iRangeLength; lineCount++) {
+		CommentLineRecord &record = records[lineCount];
+		record.start = offset;
+		Sci_Position column = 0;
+		while (offset < iRangeLength) {
+			const char ch = snapshot[offset];
+			if (ch == ' ') {
+				++column;
+			} else if (ch == '\t') {
+				column = (column/tabWidth + 1)*tabWidth;
+			} else {
+				break;
 			}
+			++offset;
 		}
+		record.indent = offset;
+		while (offset < iRangeLength && snapshot[offset] != '\r' && snapshot[offset] != '\n') {
+			++offset;
+		}
+		record.end = offset;
+		if (iCommentCol != 0 && record.indent != record.end) {
+			iCommentCol = min(iCommentCol, column);
+		}
+		if (offset == iRangeLength) {
+			break;
+		}
+		// skip the line break
+		offset += (snapshot[offset] == '\r' && offset + 1 < iRangeLength && snapshot[offset + 1] == '\n') ? 2 : 1;
 	}
+	++lineCount;
 
 	enum CommentAction {
 		CommentAction_None,
@@ -3316,41 +4936,55 @@ void EditToggleLineComments(LPCWSTR pwszComment, int commentFlag) noexcept {
 		CommentAction_Delete,
 	} iAction = CommentAction_None;
 
-	SciCall_BeginUndoAction();
-	for (Sci_Line iLine = iLineStart; iLine <= iLineEnd; iLine++) {
-		const Sci_Position iIndentPos = SciCall_GetLineIndentPosition(iLine);
-		const Sci_Position iLineEndPos = SciCall_GetLineEndPosition(iLine);
-
-		char tchBuf[32] = "";
-		const Sci_TextRangeFull tr = { { iIndentPos, min(iIndentPos + 31, iLineEndPos) }, tchBuf };
-		SciCall_GetTextRangeFull(&tr);
+	EditSpanBatch batch {};
+	for (Sci_Line index = 0; index < lineCount; index++) {
+		const CommentLineRecord &record = records[index];
+		// same result as SCI_FINDCOLUMN: first position at or past the column,
+		// only leading whitespace is walked so byte equals character here.
+		Sci_Position iCommentPos = record.start;
+		Sci_Position column = 0;
+		while (column < iCommentCol && iCommentPos < record.end) {
+			if (snapshot[iCommentPos] == '\t') {
+				const Sci_Position next = (column/tabWidth + 1)*tabWidth;
+				if (next > iCommentCol) {
+					break; // the tab spans the column, stop before it
+				}
+				column = next;
+			} else {
+				++column;
+			}
+			++iCommentPos;
+		}
 
-		if (_strnicmp(tchBuf, mszComment, cchComment) == 0 && (commentEnd != ' ' || static_cast<uint8_t>(tchBuf[cchComment]) <= ' ')) {
+		const bool commented = record.end - record.indent >= cchComment
+			&& _strnicmp(snapshot + record.indent, mszComment, cchComment) == 0
+			&& (commentEnd != ' ' || record.indent + cchComment == record.end
+				|| static_cast<uint8_t>(snapshot[record.indent + cchComment]) <= ' ');
+		if (commented) {
 			switch (iAction) {
 			case CommentAction_None:
 				iAction = CommentAction_Delete;
 				[[fallthrough]];
 				// fall through
 			case CommentAction_Delete: {
-				Sci_Position iCommentPos = iIndentPos;
-				Sci_Position iEndPos = iIndentPos + cchComment;
+				Sci_Position iDeleteStart = record.indent;
+				Sci_Position iDeleteEnd = record.indent + cchComment;
 				// a line with [space/tab] comment only
-				if (commentPad == ' ' && tchBuf[cchComment] == ' ') {
+				if (commentPad == ' ' && iDeleteEnd < record.end && snapshot[iDeleteEnd] == ' ') {
 					// TODO: detect indentation space and alignment space
-					++iEndPos;
+					++iDeleteEnd;
 				}
-				if (iEndPos == iLineEndPos) {
-					iCommentPos = SciCall_PositionFromLine(iLine);
+				if (iDeleteEnd == record.end) {
+					iDeleteStart = record.start;
 				}
-				SciCall_DeleteRange(iCommentPos, iEndPos - iCommentPos);
+				batch.Delete(iRangeStart + iDeleteStart, iDeleteEnd - iDeleteStart);
 			} break;
-			case CommentAction_Add: {
-				const Sci_Position iCommentPos = SciCall_FindColumn(iLine, iCommentCol);
-				if (iCommentPos != iIndentPos) {
+			case CommentAction_Add:
+				if (iCommentPos != record.indent) {
 					mszComment[cchComment] = commentPad;
-					SciCall_InsertText(iCommentPos, mszComment);
+					batch.Insert(iRangeStart + iCommentPos, mszComment, cchComment + (commentPad ? 1 : 0));
 				}
-			} break;
+				break;
 			}
 		} else {
 			switch (iAction) {
@@ -3358,33 +4992,34 @@ void EditToggleLineComments(LPCWSTR pwszComment, int commentFlag) noexcept {
 				iAction = CommentAction_Add;
 				[[fallthrough]];
 				// fall through
-			case CommentAction_Add: {
-				const Sci_Position iCommentPos = SciCall_FindColumn(iLine, iCommentCol);
-				if (iCommentCol == 0 || iLineStart == iLineEnd || iIndentPos != iLineEndPos) {
-					mszComment[cchComment] = (iCommentPos == iLineEndPos) ? '\0' : commentPad;
-					SciCall_InsertText(iCommentPos, mszComment);
+			case CommentAction_Add:
+				if (iCommentCol == 0 || iLineStart == iLineEnd || record.indent != record.end) {
+					const char pad = (iCommentPos == record.end) ? '\0' : commentPad;
+					mszComment[cchComment] = pad;
+					batch.Insert(iRangeStart + iCommentPos, mszComment, cchComment + (pad ? 1 : 0));
 				} else {
 					char tchComment[1024] = "";
 					Sci_Position tab = 0;
 					Sci_Position count = iCommentCol;
 					if (!fvCurFile.bTabsAsSpaces) {
-						const int tabWidth = fvCurFile.iTabWidth;
 						tab = count / tabWidth;
 						count %= tabWidth;
 						memset(tchComment, '\t', tab);
 					}
 					memset(tchComment + tab, ' ', count);
 					memcpy(tchComment + tab + count, mszComment, cchComment);
-					SciCall_InsertText(iCommentPos, tchComment);
+					batch.Insert(iRangeStart + iCommentPos, tchComment, tab + count + cchComment);
 				}
-			} break;
+				break;
 			case CommentAction_Delete:
 				break;
 			}
 		}
 	}
 
-	SciCall_EndUndoAction();
+	batch.Apply();
+	batch.Free();
+	NP2HeapFree(records);
 	if (iSelStart != iSelEnd) {
 		Sci_Position iAnchorPos;
 		if (iCurPos == iSelStart) {
@@ -3473,7 +5108,10 @@ void EditPadWithSpaces(bool bSkipEmpty, bool bNoUndoGroup) noexcept {
 			SciCall_BeginUndoAction();
 		}
 
-		for (Sci_Line iLine = iLineStart; iLine <= iLineEnd; iLine++) {
+		// walk back to front so each insertion leaves the positions of the
+		// lines still to be visited untouched, then the edits can be batched.
+		SciMessageBatch<256> batch;
+		for (Sci_Line iLine = iLineEnd; iLine >= iLineStart; iLine--) {
 			const Sci_Position iLineSelEndPos = SciCall_GetLineSelEndPosition(iLine);
 			if (bIsRectangular && iLineSelEndPos < 0) {
 				continue;
@@ -3490,10 +5128,11 @@ void EditPadWithSpaces(bool bSkipEmpty, bool bNoUndoGroup) noexcept {
 
 			const Sci_Position iPadLen = iMaxColumn - SciCall_GetColumn(iPos);
 
-			SciCall_SetTargetRange(iPos, iPos);
-			SciCall_ReplaceTarget(iPadLen, pmszPadStr);
+			batch.Record(SCI_SETTARGETRANGE, iPos, iPos);
+			batch.Record(SCI_REPLACETARGET, iPadLen, pmszPadStr);
 		}
 
+		batch.Flush();
 		NP2HeapFree(pmszPadStr);
 		if (!bNoUndoGroup) {
 			SciCall_EndUndoAction();
@@ -3601,6 +5240,67 @@ void EditStripLastCharacter() noexcept {
 	SciCall_EndUndoAction();
 }
 
+namespace {
+
+// Mass transforms used to issue one SCI_DELETERANGE or SCI_REPLACETARGET per
+// line while walking forward, so each replacement shifted every position
+// behind it and the buffer gap bounced across the whole document: quadratic
+// on million-line files. TextSpanList collects all (range, replacement) pairs
+// from a single pass over a range pointer, then applies them back to front in
+// one undo group, so pending spans stay valid without revalidation and the
+// gap only ever moves backward.
+struct TextSpanList {
+	struct Span {
+		Sci_Position start;
+		Sci_Position end;
+		const char *text;	// replacement text, nullptr deletes the span
+		Sci_Position length;
+	};
+
+	Span *spans = nullptr;
+	size_t count = 0;
+	size_t capacity = 0;
+
+	void Add(Sci_Position start, Sci_Position end, const char *text = nullptr, Sci_Position length = 0) noexcept {
+		if (count == capacity) {
+			capacity = (capacity == 0) ? 1024 : capacity*2;
+			spans = static_cast<Span *>(spans ? NP2HeapReAlloc(spans, capacity*sizeof(Span)) : NP2HeapAlloc(capacity*sizeof(Span)));
+		}
+		spans[count] = { start, end, text, length };
+		count++;
+	}
+
+	// Returns the change in document length.
+	Sci_Position Apply() noexcept {
+		Sci_Position delta = 0;
+		if (count != 0) {
+			SciCall_BeginUndoAction();
+			BeginModificationBatch();
+			for (size_t i = count; i != 0; ) {
+				const Span &span = spans[--i];
+				if (span.text == nullptr) {
+					SciCall_DeleteRange(span.start, span.end - span.start);
+				} else {
+					SciCall_SetTargetRange(span.start, span.end);
+					SciCall_ReplaceTarget(span.length, span.text);
+				}
+				delta += span.length - (span.end - span.start);
+			}
+			EndModificationBatch();
+			SciCall_EndUndoAction();
+		}
+		if (spans != nullptr) {
+			NP2HeapFree(spans);
+			spans = nullptr;
+		}
+		count = 0;
+		capacity = 0;
+		return delta;
+	}
+};
+
+}
+
 //=============================================================================
 //
 // EditStripTrailingBlanks()
@@ -3619,26 +5319,28 @@ void EditStripTrailingBlanks(HWND hwnd, bool bIgnoreSelection) noexcept {
 		}
 	}
 
-	// Code from SciTE...
-	SciCall_BeginUndoAction();
-	const Sci_Line maxLines = SciCall_GetLineCount();
-	for (Sci_Line line = 0; line < maxLines; line++) {
-		const Sci_Position lineStart = SciCall_PositionFromLine(line);
-		const Sci_Position lineEnd = SciCall_GetLineEndPosition(line);
-		Sci_Position i = lineEnd;
-		while (i >= lineStart) {
-			i--;
-			const int ch = SciCall_GetCharAt(i);
-			if (!IsASpaceOrTab(ch)) {
-				break;
+	// collect the blank run ending each line in one pass, delete back to front
+	const Sci_Position iLength = SciCall_GetLength();
+	const char * const text = SciCall_GetRangePointer(0, iLength);
+	TextSpanList spans;
+	Sci_Position runStart = -1;
+	for (Sci_Position i = 0; i < iLength; i++) {
+		const char ch = text[i];
+		if (IsASpaceOrTab(ch)) {
+			if (runStart < 0) {
+				runStart = i;
 			}
-		}
-		i++;
-		if (i < lineEnd) {
-			SciCall_DeleteRange(i, lineEnd - i);
+		} else {
+			if (runStart >= 0 && IsEOLChar(ch)) {
+				spans.Add(runStart, i);
+			}
+			runStart = -1;
 		}
 	}
-	SciCall_EndUndoAction();
+	if (runStart >= 0) {
+		spans.Add(runStart, iLength);
+	}
+	spans.Apply();
 }
 
 //=============================================================================
@@ -3659,17 +5361,27 @@ void EditStripLeadingBlanks(HWND hwnd, bool bIgnoreSelection) noexcept {
 		}
 	}
 
-	// Code from SciTE...
-	SciCall_BeginUndoAction();
-	const Sci_Line maxLines = SciCall_GetLineCount();
-	for (Sci_Line line = 0; line < maxLines; line++) {
-		const Sci_Position lineStart = SciCall_PositionFromLine(line);
-		const Sci_Position lineEnd = SciCall_GetLineIndentPosition(line);
-		if (lineEnd > lineStart) {
-			SciCall_DeleteRange(lineStart, lineEnd - lineStart);
+	// collect the blank run starting each line in one pass, delete back to front
+	const Sci_Position iLength = SciCall_GetLength();
+	const char * const text = SciCall_GetRangePointer(0, iLength);
+	TextSpanList spans;
+	Sci_Position i = 0;
+	while (i < iLength) {
+		if (IsASpaceOrTab(text[i])) {
+			const Sci_Position blankStart = i;
+			do {
+				i++;
+			} while (i < iLength && IsASpaceOrTab(text[i]));
+			spans.Add(blankStart, i);
+		}
+		while (i < iLength && !IsEOLChar(text[i])) {
+			i++;
+		}
+		while (i < iLength && IsEOLChar(text[i])) {
+			i++;
 		}
 	}
-	SciCall_EndUndoAction();
+	spans.Apply();
 }
 
 //=============================================================================
@@ -3685,21 +5397,13 @@ void EditCompressSpaces() noexcept {
 	Sci_Position iSelStart = SciCall_GetSelectionStart();
 	Sci_Position iSelEnd = SciCall_GetSelectionEnd();
 	const Sci_Position iLength = SciCall_GetLength();
-	Sci_Position iSelCount;
-	char *pszIn;
 	char chPrev = '\n';
 	char chNext = '\n';
 
 	if (iSelStart == iSelEnd) {
 		iSelStart = 0;
 		iSelEnd = iLength;
-		iSelCount = iLength;
-		pszIn = static_cast<char *>(NP2HeapAlloc(iSelCount + 2));
-		SciCall_GetText(iSelCount, pszIn);
 	} else {
-		iSelCount = SciCall_GetSelTextLength();
-		pszIn = static_cast<char *>(NP2HeapAlloc(iSelCount + 2));
-		SciCall_GetSelText(pszIn);
 		if (iSelEnd < iLength) {
 			chNext = static_cast<char>(SciCall_GetCharAt(iSelEnd));
 		}
@@ -3708,35 +5412,48 @@ void EditCompressSpaces() noexcept {
 		}
 	}
 
-	pszIn[iSelCount] = chNext;
-	const char * const end = pszIn + iSelCount;
-	char *co = pszIn;
-	bool bModified = false;
-	for (char *ci = pszIn; ci < end;) {
-		const char ch = *ci++;
-		if (ch != ' ' && ch != '\t') {
-			chPrev = ch;
-			*co++ = ch;
-		} else if (chPrev != '\n' && chPrev != '\r') {
-			while (ci < end && (*ci == ' ' || *ci == '\t')) {
-				++ci;
-			}
-			if (*ci != '\n' && *ci != '\r') {
-				chPrev = ' ';
-				*co++ = ' ';
-				if (ch == '\t') {
-					bModified = true;
+	// collect each blank run with its replacement in one pass, apply back to
+	// front so untouched text keeps its markers and undo stays per run
+	const Sci_Position iSelCount = iSelEnd - iSelStart;
+	const char * const text = SciCall_GetRangePointer(iSelStart, iSelCount);
+	TextSpanList spans;
+	for (Sci_Position i = 0; i < iSelCount; ) {
+		const char ch = text[i];
+		if (ch == ' ' || ch == '\t') {
+			const Sci_Position runStart = i;
+			do {
+				i++;
+			} while (i < iSelCount && (text[i] == ' ' || text[i] == '\t'));
+			const char next = (i < iSelCount) ? text[i] : chNext;
+			if (chPrev == '\n' || chPrev == '\r' || next == '\n' || next == '\r') {
+				// at the start or end of a line the run disappears
+				spans.Add(iSelStart + runStart, iSelStart + i);
+			} else {
+				if (i - runStart > 1 || ch == '\t') {
+					spans.Add(iSelStart + runStart, iSelStart + i, " ", 1);
 				}
+				chPrev = ' ';
 			}
+		} else {
+			chPrev = ch;
+			i++;
 		}
 	}
 
-	if (bModified || co < end) {
-		*co = '\0';
-		iSelCount = co - pszIn;
-		EditReplaceRange(iSelStart, iSelEnd, iSelCount, pszIn);
+	if (spans.count != 0) {
+		Sci_Position iCurPos = SciCall_GetCurrentPos();
+		Sci_Position iAnchorPos = SciCall_GetAnchor();
+		const Sci_Position cchText = iSelCount + spans.Apply();
+		// keep the replaced range selected, as EditReplaceRange() did
+		if (iAnchorPos > iCurPos) {
+			iCurPos = iSelStart;
+			iAnchorPos = iSelStart + cchText;
+		} else {
+			iAnchorPos = iSelStart;
+			iCurPos = iSelStart + cchText;
+		}
+		SciCall_SetSel(iAnchorPos, iCurPos);
 	}
-	NP2HeapFree(pszIn);
 }
 
 //=============================================================================
@@ -3799,37 +5516,28 @@ void EditRemoveBlankLines(bool bMerge) noexcept {
 //
 // EditWrapToColumn()
 //
-void EditWrapToColumn(int nColumn/*, int nTabWidth*/) noexcept {
-	if (SciCall_IsSelectionEmpty()) {
-		return;
-	}
-	if (SciCall_IsRectangleSelection()) {
-		NotifyRectangleSelection();
-		return;
-	}
-
-	Sci_Position iSelStart = SciCall_GetSelectionStart();
-	const Sci_Position iSelEnd = SciCall_GetSelectionEnd();
-
-	const Sci_Line iLine = SciCall_LineFromPosition(iSelStart);
-	iSelStart = SciCall_PositionFromLine(iLine);
-
-	const Sci_Position iSelCount = iSelEnd - iSelStart;
-	char *pszText = static_cast<char *>(NP2HeapAlloc(iSelCount + 1 + 2));
-	LPWSTR pszTextW = static_cast<LPWSTR>(NP2HeapAlloc((iSelCount + 1 + 2) * sizeof(WCHAR)));
-
-	const Sci_TextRangeFull tr = { { iSelStart, iSelEnd }, pszText };
-	SciCall_GetTextRangeFull(&tr);
-
-	const UINT cpEdit = SciCall_GetCodePage();
-	const int cchTextW = MultiByteToWideChar(cpEdit, 0, pszText, static_cast<int>(iSelCount), pszTextW, static_cast<int>(NP2HeapSize(pszTextW) / sizeof(WCHAR)));
-	NP2HeapFree(pszText);
-
-	LPWSTR pszConvW = static_cast<LPWSTR>(NP2HeapAlloc(cchTextW * sizeof(WCHAR) * 3 + 2));
+// The reflow state resets at every line break and the word lookahead stops at
+// one, so ranges cut right after a line break can be rewrapped independently
+// and spliced back together in input order.
+constexpr int ParallelWrapMinChars = 256*1024;
+constexpr DWORD ParallelWrapMaxChunks = 8;
+
+struct WrapChunk {
+	const WCHAR *pszTextW;	// whole NUL terminated input, for the lookahead
+	WCHAR *pszConvW;		// this chunk's output, 3*(end - start) + 2 WCHARs
+	int start;
+	int end;
+	int cchConvW;
+	int nColumn;
+	unsigned wszEOL;
+	int eolWidth;
+	bool bModified;
+};
 
-	const unsigned iEOLMode = SciCall_GetEOLMode();
-	unsigned wszEOL = '\r' | ('\n' << 16);
-	wszEOL >>= 16*(iEOLMode >> 1);
+static void WrapToColumnChunk(WrapChunk &chunk) noexcept {
+	const WCHAR * const pszTextW = chunk.pszTextW;
+	WCHAR * const pszConvW = chunk.pszConvW;
+	const int nColumn = chunk.nColumn;
 
 #define ISDELIMITER(wc) StrChr(L",;.:-+%&\xA6|/*?!\"\'~\xB4#=", wc)
 #define ISWHITE(wc)		IsASpaceOrTab(wc)
@@ -3838,7 +5546,7 @@ void EditWrapToColumn(int nColumn/*, int nTabWidth*/) noexcept {
 	int cchConvW = 0;
 	int iLineLength = 0;
 	bool bModified = false;
-	for (int iTextW = 0; iTextW < cchTextW; iTextW++) {
+	for (int iTextW = chunk.start; iTextW < chunk.end; iTextW++) {
 		const WCHAR w = pszTextW[iTextW];
 
 		//if (ISDELIMITER(w)) {
@@ -3846,8 +5554,8 @@ void EditWrapToColumn(int nColumn/*, int nTabWidth*/) noexcept {
 		//	WCHAR w2 = pszTextW[iTextW + 1];
 		//
 		//	if (iLineLength + iNextWordLen + 1 > nColumn) {
-		//		memcpy(pszConvW + cchConvW, &wszEOL, 2*sizeof(WCHAR));
-		//		cchConvW += (iEOLMode == SC_EOL_CRLF) ? 2 : 1;
+		//		memcpy(pszConvW + cchConvW, &chunk.wszEOL, 2*sizeof(WCHAR));
+		//		cchConvW += chunk.eolWidth;
 		//		iLineLength = 0;
 		//		bModified = true;
 		//	}
@@ -3865,8 +5573,8 @@ void EditWrapToColumn(int nColumn/*, int nTabWidth*/) noexcept {
 		//
 		//	if (iNextWordLen > 0) {
 		//		if (iLineLength + iNextWordLen + 1 > nColumn) {
-		//			memcpy(pszConvW + cchConvW, &wszEOL, 2*sizeof(WCHAR));
-		//			cchConvW += (iEOLMode == SC_EOL_CRLF) ? 2 : 1;
+		//			memcpy(pszConvW + cchConvW, &chunk.wszEOL, 2*sizeof(WCHAR));
+		//			cchConvW += chunk.eolWidth;
 		//			iLineLength = 0;
 		//			bModified = true;
 		//		}
@@ -3891,8 +5599,8 @@ void EditWrapToColumn(int nColumn/*, int nTabWidth*/) noexcept {
 			//	iNextWordLen++;
 			if (iNextWordLen > 0) {
 				if (iLineLength + iNextWordLen + 1 > nColumn) {
-					memcpy(pszConvW + cchConvW, &wszEOL, 2*sizeof(WCHAR));
-					cchConvW += (iEOLMode == SC_EOL_CRLF) ? 2 : 1;
+					memcpy(pszConvW + cchConvW, &chunk.wszEOL, 2*sizeof(WCHAR));
+					cchConvW += chunk.eolWidth;
 					iLineLength = 0;
 					bModified = true;
 				} else {
@@ -3912,23 +5620,17 @@ void EditWrapToColumn(int nColumn/*, int nTabWidth*/) noexcept {
 		}
 	}
 
-	NP2HeapFree(pszTextW);
-
-	if (bModified) {
-		pszText = static_cast<char *>(NP2HeapAlloc(cchConvW * kMaxMultiByteCount));
-		const int cchText = WideCharToMultiByte(cpEdit, 0, pszConvW, cchConvW, pszText, static_cast<int>(NP2HeapSize(pszText)), nullptr, nullptr);
-		EditReplaceRange(iSelStart, iSelEnd, cchText, pszText);
-		NP2HeapFree(pszText);
-	}
+	chunk.cchConvW = cchConvW;
+	chunk.bModified = bModified;
+}
 
-	NP2HeapFree(pszConvW);
+#if USE_WIN32_PTP_WORK
+VOID CALLBACK WrapChunkWorkCallback([[maybe_unused]] PTP_CALLBACK_INSTANCE instance, PVOID context, [[maybe_unused]] PTP_WORK work) {
+	WrapToColumnChunk(*static_cast<WrapChunk *>(context));
 }
+#endif // USE_WIN32_PTP_WORK
 
-//=============================================================================
-//
-// EditJoinLinesEx()
-//
-void EditJoinLinesEx() noexcept {
+void EditWrapToColumn(int nColumn/*, int nTabWidth*/) noexcept {
 	if (SciCall_IsSelectionEmpty()) {
 		return;
 	}
@@ -3939,20 +5641,132 @@ void EditJoinLinesEx() noexcept {
 
 	Sci_Position iSelStart = SciCall_GetSelectionStart();
 	const Sci_Position iSelEnd = SciCall_GetSelectionEnd();
+
 	const Sci_Line iLine = SciCall_LineFromPosition(iSelStart);
 	iSelStart = SciCall_PositionFromLine(iLine);
 
 	const Sci_Position iSelCount = iSelEnd - iSelStart;
 	char *pszText = static_cast<char *>(NP2HeapAlloc(iSelCount + 1 + 2));
-	char *pszJoin = static_cast<char *>(NP2HeapAlloc(NP2HeapSize(pszText)));
+	LPWSTR pszTextW = static_cast<LPWSTR>(NP2HeapAlloc((iSelCount + 1 + 2) * sizeof(WCHAR)));
 
 	const Sci_TextRangeFull tr = { { iSelStart, iSelEnd }, pszText };
 	SciCall_GetTextRangeFull(&tr);
 
-	const unsigned iEOLMode = SciCall_GetEOLMode();
-	unsigned szEOL = '\r' | ('\n' << 8);
-	szEOL >>= 8*(iEOLMode >> 1);
-
+	const UINT cpEdit = SciCall_GetCodePage();
+	const int cchTextW = MultiByteToWideChar(cpEdit, 0, pszText, static_cast<int>(iSelCount), pszTextW, static_cast<int>(NP2HeapSize(pszTextW) / sizeof(WCHAR)));
+	NP2HeapFree(pszText);
+
+	// worst case every character is followed by an inserted CRLF, plus one
+	// stray WCHAR per chunk: the EOL memcpy always writes two WCHARs even
+	// when only the CR is counted.
+	LPWSTR pszConvW = static_cast<LPWSTR>(NP2HeapAlloc((3*cchTextW + 2*ParallelWrapMaxChunks) * sizeof(WCHAR)));
+
+	const unsigned iEOLMode = SciCall_GetEOLMode();
+	unsigned wszEOL = '\r' | ('\n' << 16);
+	wszEOL >>= 16*(iEOLMode >> 1);
+	const int eolWidth = (iEOLMode == SC_EOL_CRLF) ? 2 : 1;
+
+	int cchConvW = 0;
+	bool bModified = false;
+#if USE_WIN32_PTP_WORK
+	DWORD chunkCount = 1;
+	if (cchTextW >= ParallelWrapMinChars) {
+		SYSTEM_INFO info;
+		GetNativeSystemInfo(&info);
+		chunkCount = min(info.dwNumberOfProcessors, ParallelWrapMaxChunks);
+	}
+	if (chunkCount >= 2) {
+		WrapChunk chunks[ParallelWrapMaxChunks];
+		PTP_WORK works[ParallelWrapMaxChunks];
+		const int step = cchTextW/static_cast<int>(chunkCount);
+		DWORD created = 0;
+		int start = 0;
+		for (DWORD i = 0; i < chunkCount && start < cchTextW; i++) {
+			int end = cchTextW;
+			if (i + 1 < chunkCount) {
+				// cut only right after a line break so every chunk starts at column zero
+				end = min(start + step, cchTextW);
+				while (end < cchTextW && !IsEOLChar(pszTextW[end - 1])) {
+					end++;
+				}
+			}
+			// output regions are disjoint: each chunk gets its full worst case
+			chunks[created] = { pszTextW, pszConvW + 3*start + 2*created, start, end, 0, nColumn, wszEOL, eolWidth, false };
+			works[created] = CreateThreadpoolWork(WrapChunkWorkCallback, &chunks[created], nullptr);
+			if (works[created] != nullptr) {
+				SubmitThreadpoolWork(works[created]);
+			}
+			start = end;
+			created++;
+		}
+		for (DWORD i = 0; i < created; i++) {
+			if (works[i] != nullptr) {
+				WaitForThreadpoolWorkCallbacks(works[i], FALSE);
+				CloseThreadpoolWork(works[i]);
+			} else {
+				// thread pool refused the work: rewrap the chunk here
+				WrapToColumnChunk(chunks[i]);
+			}
+			// splice in input order; the spliced prefix never reaches into a
+			// pending chunk's region, so no need to wait for all of them.
+			if (pszConvW + cchConvW != chunks[i].pszConvW) {
+				memmove(pszConvW + cchConvW, chunks[i].pszConvW, chunks[i].cchConvW * sizeof(WCHAR));
+			}
+			cchConvW += chunks[i].cchConvW;
+			bModified |= chunks[i].bModified;
+		}
+	} else
+#endif // USE_WIN32_PTP_WORK
+	{
+		WrapChunk chunk = { pszTextW, pszConvW, 0, cchTextW, 0, nColumn, wszEOL, eolWidth, false };
+		WrapToColumnChunk(chunk);
+		cchConvW = chunk.cchConvW;
+		bModified = chunk.bModified;
+	}
+
+	NP2HeapFree(pszTextW);
+
+	if (bModified) {
+		pszText = static_cast<char *>(NP2HeapAlloc(cchConvW * kMaxMultiByteCount));
+		const int cchText = WideCharToMultiByte(cpEdit, 0, pszConvW, cchConvW, pszText, static_cast<int>(NP2HeapSize(pszText)), nullptr, nullptr);
+		BeginModificationBatch();
+		EditReplaceRange(iSelStart, iSelEnd, cchText, pszText);
+		EndModificationBatch();
+		NP2HeapFree(pszText);
+	}
+
+	NP2HeapFree(pszConvW);
+}
+
+//=============================================================================
+//
+// EditJoinLinesEx()
+//
+void EditJoinLinesEx() noexcept {
+	if (SciCall_IsSelectionEmpty()) {
+		return;
+	}
+	if (SciCall_IsRectangleSelection()) {
+		NotifyRectangleSelection();
+		return;
+	}
+
+	Sci_Position iSelStart = SciCall_GetSelectionStart();
+	const Sci_Position iSelEnd = SciCall_GetSelectionEnd();
+	const Sci_Line iLine = SciCall_LineFromPosition(iSelStart);
+	iSelStart = SciCall_PositionFromLine(iLine);
+
+	const Sci_Position iSelCount = iSelEnd - iSelStart;
+	char *pszText = static_cast<char *>(NP2HeapAlloc(iSelCount + 1 + 2));
+	char *pszJoin = static_cast<char *>(NP2HeapAlloc(NP2HeapSize(pszText)));
+
+	const Sci_TextRangeFull tr = { { iSelStart, iSelEnd }, pszText };
+	SciCall_GetTextRangeFull(&tr);
+
+	const unsigned iEOLMode = SciCall_GetEOLMode();
+	unsigned szEOL = '\r' | ('\n' << 8);
+	szEOL >>= 8*(iEOLMode >> 1);
+
 	Sci_Position cchJoin = 0;
 	bool bModified = false;
 	for (Sci_Position i = 0; i < iSelCount; i++) {
@@ -3985,7 +5799,9 @@ void EditJoinLinesEx() noexcept {
 	NP2HeapFree(pszText);
 
 	if (bModified) {
+		BeginModificationBatch();
 		EditReplaceRange(iSelStart, iSelEnd, cchJoin, pszJoin);
+		EndModificationBatch();
 	}
 
 	NP2HeapFree(pszJoin);
@@ -4035,12 +5851,439 @@ int __cdecl CmpSortLine(const void *p1, const void *p2) noexcept {
 	return cmp;
 }
 
-int __cdecl DontSortLine(const void *p1, const void *p2) noexcept {
-	const SORTLINE *s1 = static_cast<const SORTLINE *>(p1);
-	const SORTLINE *s2 = static_cast<const SORTLINE *>(p2);
-	return s1->iLine - s2->iLine;
+UINT HashSortLine(LPCWSTR s) noexcept {
+	UINT hash = 2166136261U; // FNV-1a
+	while (*s) {
+		hash = (hash ^ *s++) * 16777619U;
+	}
+	return hash;
+}
+
+#if USE_WIN32_PTP_WORK
+// sort each chunk on the system thread pool, then merge the sorted runs.
+// CmpSortLine breaks ties by line number, so the order is total and the
+// merge result matches the single-threaded qsort.
+constexpr Sci_Line ParallelSortMinLines = 64*1024;
+constexpr DWORD ParallelSortMaxChunks = 8;
+
+struct SortChunk {
+	SORTLINE *base;
+	Sci_Line count;
+};
+
+VOID CALLBACK SortChunkWorkCallback([[maybe_unused]] PTP_CALLBACK_INSTANCE instance, PVOID context, [[maybe_unused]] PTP_WORK work) {
+	const SortChunk * const chunk = static_cast<const SortChunk *>(context);
+	qsort(chunk->base, chunk->count, sizeof(SORTLINE), CmpSortLine);
+}
+
+struct HashChunk {
+	const SORTLINE *base;
+	UINT *hashes;
+	Sci_Line count;
+};
+
+VOID CALLBACK HashChunkWorkCallback([[maybe_unused]] PTP_CALLBACK_INSTANCE instance, PVOID context, [[maybe_unused]] PTP_WORK work) {
+	const HashChunk * const chunk = static_cast<const HashChunk *>(context);
+	for (Sci_Line i = 0; i < chunk->count; i++) {
+		chunk->hashes[i] = HashSortLine(chunk->base[i].pwszSortLine);
+	}
+}
+
+void MergeSortedRuns(SORTLINE *dest, const SORTLINE *left, Sci_Line leftCount, const SORTLINE *right, Sci_Line rightCount) noexcept {
+	while (leftCount != 0 && rightCount != 0) {
+		if (CmpSortLine(left, right) <= 0) {
+			*dest++ = *left++;
+			--leftCount;
+		} else {
+			*dest++ = *right++;
+			--rightCount;
+		}
+	}
+	if (leftCount != 0) {
+		memcpy(dest, left, leftCount*sizeof(SORTLINE));
+	} else {
+		memcpy(dest, right, rightCount*sizeof(SORTLINE));
+	}
+}
+
+bool SortLinesParallel(SORTLINE *pLines, Sci_Line iLineCount) noexcept {
+	SYSTEM_INFO info;
+	GetNativeSystemInfo(&info);
+	DWORD chunkCount = min(info.dwNumberOfProcessors, ParallelSortMaxChunks);
+	if (chunkCount < 2) {
+		return false;
+	}
+
+	SortChunk chunks[ParallelSortMaxChunks];
+	PTP_WORK works[ParallelSortMaxChunks];
+	const Sci_Line step = (iLineCount + chunkCount - 1)/chunkCount;
+	Sci_Line offset = 0;
+	DWORD created = 0;
+	for (DWORD i = 0; i < chunkCount && offset < iLineCount; i++) {
+		chunks[i].base = pLines + offset;
+		chunks[i].count = min(step, iLineCount - offset);
+		offset += chunks[i].count;
+		works[i] = CreateThreadpoolWork(SortChunkWorkCallback, &chunks[i], nullptr);
+		if (works[i] != nullptr) {
+			SubmitThreadpoolWork(works[i]);
+		}
+		created = i + 1;
+	}
+	chunkCount = created;
+	for (DWORD i = 0; i < chunkCount; i++) {
+		if (works[i] != nullptr) {
+			WaitForThreadpoolWorkCallbacks(works[i], FALSE);
+			CloseThreadpoolWork(works[i]);
+		} else {
+			// thread pool refused the work: sort the chunk here
+			qsort(chunks[i].base, chunks[i].count, sizeof(SORTLINE), CmpSortLine);
+		}
+	}
+	if (chunkCount < 2) {
+		return true;
+	}
+
+	SORTLINE * const temp = static_cast<SORTLINE *>(NP2HeapAlloc(sizeof(SORTLINE)*iLineCount));
+	SORTLINE *src = pLines;
+	SORTLINE *dest = temp;
+	while (chunkCount > 1) {
+		DWORD merged = 0;
+		Sci_Line position = 0;
+		for (DWORD i = 0; i < chunkCount; i += 2, merged++) {
+			const Sci_Line leftCount = chunks[i].count;
+			const Sci_Line rightCount = (i + 1 < chunkCount) ? chunks[i + 1].count : 0;
+			MergeSortedRuns(dest + position, src + position, leftCount, src + position + leftCount, rightCount);
+			chunks[merged].count = leftCount + rightCount;
+			position += leftCount + rightCount;
+		}
+		chunkCount = merged;
+		SORTLINE * const t = src;
+		src = dest;
+		dest = t;
+	}
+	if (src != pLines) {
+		memcpy(pLines, src, iLineCount*sizeof(SORTLINE));
+	}
+	NP2HeapFree(temp);
+	return true;
+}
+#endif // USE_WIN32_PTP_WORK
+
+// classify duplicate lines while keeping the original order: hash every line,
+// then find each line's first occurrence through an open addressing hash index.
+// This is linear time instead of sorting, marking runs and sorting back by
+// line number, and never compares lines with different hashes.
+void MarkDuplicateLines(SORTLINE *pLines, Sci_Line iLineCount, EditSortFlag iSortFlags) noexcept {
+	UINT * const hashes = static_cast<UINT *>(NP2HeapAlloc(iLineCount*sizeof(UINT)));
+	Sci_Line hashed = 0;
+#if USE_WIN32_PTP_WORK
+	if (iLineCount >= ParallelSortMinLines) {
+		SYSTEM_INFO info;
+		GetNativeSystemInfo(&info);
+		const DWORD chunkCount = min(info.dwNumberOfProcessors, ParallelSortMaxChunks);
+		if (chunkCount >= 2) {
+			HashChunk chunks[ParallelSortMaxChunks];
+			PTP_WORK works[ParallelSortMaxChunks];
+			const Sci_Line step = (iLineCount + chunkCount - 1)/chunkCount;
+			Sci_Line offset = 0;
+			DWORD created = 0;
+			for (DWORD i = 0; i < chunkCount && offset < iLineCount; i++) {
+				chunks[i].base = pLines + offset;
+				chunks[i].hashes = hashes + offset;
+				chunks[i].count = min(step, iLineCount - offset);
+				offset += chunks[i].count;
+				works[i] = CreateThreadpoolWork(HashChunkWorkCallback, &chunks[i], nullptr);
+				if (works[i] != nullptr) {
+					SubmitThreadpoolWork(works[i]);
+				}
+				created = i + 1;
+			}
+			for (DWORD i = 0; i < created; i++) {
+				if (works[i] != nullptr) {
+					WaitForThreadpoolWorkCallbacks(works[i], FALSE);
+					CloseThreadpoolWork(works[i]);
+				} else {
+					// thread pool refused the work: hash the chunk here
+					for (Sci_Line j = 0; j < chunks[i].count; j++) {
+						chunks[i].hashes[j] = HashSortLine(chunks[i].base[j].pwszSortLine);
+					}
+				}
+			}
+			hashed = offset;
+		}
+	}
+#endif // USE_WIN32_PTP_WORK
+	for (Sci_Line i = hashed; i < iLineCount; i++) {
+		hashes[i] = HashSortLine(pLines[i].pwszSortLine);
+	}
+
+	// power of two capacity, load factor below 2/3. SORTLINE::iLine is int,
+	// so line indices fit an UINT slot, stored as index plus one.
+	size_t indexSize = 64;
+	while (indexSize < static_cast<size_t>(iLineCount) + static_cast<size_t>(iLineCount)/2) {
+		indexSize <<= 1;
+	}
+	UINT * const index = static_cast<UINT *>(NP2HeapAlloc(indexSize*sizeof(UINT)));
+	// 0: unique, 1: first line of a duplicate group, 2: later duplicate
+	uint8_t * const state = static_cast<uint8_t *>(NP2HeapAlloc(iLineCount));
+	const size_t mask = indexSize - 1;
+	for (Sci_Line i = 0; i < iLineCount; i++) {
+		const UINT hash = hashes[i];
+		size_t slot = hash & mask;
+		for (;;) {
+			if (index[slot] == 0) {
+				index[slot] = static_cast<UINT>(i + 1);
+				break;
+			}
+			const Sci_Line j = index[slot] - 1;
+			if (hashes[j] == hash && wcscmp(pLines[j].pwszSortLine, pLines[i].pwszSortLine) == 0) {
+				state[j] = 1;
+				state[i] = 2;
+				break;
+			}
+			slot = (slot + 1) & mask;
+		}
+	}
+
+	// same semantics as the sorted path: merge keeps the first line of a group,
+	// remove duplicate drops the whole group, remove unique drops the rest.
+	static constexpr int dropFlag[3] = {
+		EditSortFlag_RemoveUnique,
+		EditSortFlag_RemoveDuplicate,
+		EditSortFlag_MergeDuplicate | EditSortFlag_RemoveDuplicate,
+	};
+	for (Sci_Line i = 0; i < iLineCount; i++) {
+		if (iSortFlags & dropFlag[state[i]]) {
+			pLines[i].pwszLine = nullptr;
+		}
+	}
+	NP2HeapFree(hashes);
+	NP2HeapFree(index);
+	NP2HeapFree(state);
+}
+
+}
+
+//=============================================================================
+//
+// EditShowDocumentStatistics()
+// wc-style counts in one pass over the document buffer: the byte histogram
+// answers bytes, characters (UTF-8 continuation bytes) and non-ASCII, the
+// same loop tracks word starts, CR+LF pairs and line runs. Chunks run on the
+// thread pool and the per-chunk partials merge on the calling thread; each
+// chunk knows the byte before it, so only the line run straddling a cut
+// needs fixing up in the merge.
+//
+namespace {
+
+struct DocStatistics {
+	uint64_t words;
+	uint64_t chars;
+	uint64_t nonAscii;
+	uint64_t crlf;
+	uint64_t loneLF;
+	uint64_t loneCR;
+	uint64_t longestLine;
+};
+
+struct StatisticsChunk {
+	const uint8_t *base;
+	size_t length;
+	uint8_t prevByte;	// byte before the chunk, '\n' at the document start
+	// per-chunk partials
+	uint64_t hist[256];
+	uint64_t words;
+	uint64_t crlf;
+	uint64_t firstRun;	// bytes before the first line break in the chunk
+	uint64_t maxRun;	// longest line wholly inside the chunk
+	uint64_t lastRun;	// bytes after the last line break
+	bool hasEOL;
+};
+
+// wc semantics: a word is a maximal run of non-whitespace bytes, so
+// multi-byte sequences without whitespace count as one word.
+constexpr bool IsWhiteSpaceByte(uint8_t ch) noexcept {
+	return ch == ' ' || static_cast<uint8_t>(ch - '\t') < 5; // \t \n \v \f \r
+}
+
+void CountStatisticsChunk(StatisticsChunk &chunk) noexcept {
+	// four interleaved tables keep the counter increments independent: the
+	// single table form stalls on store to load forwarding whenever the
+	// input repeats a byte. The histogram is a scatter, which vector loads
+	// can't express, so the kernel stays scalar.
+	uint64_t hist[4][256] = {};
+	const uint8_t * const p = chunk.base;
+	const size_t length = chunk.length;
+	uint8_t prev = chunk.prevByte;
+	uint64_t run = 0;
+	uint64_t maxRun = 0;
+	uint64_t firstRun = 0;
+	uint64_t words = 0;
+	uint64_t crlf = 0;
+	bool hasEOL = false;
+	for (size_t i = 0; i < length; i++) {
+		const uint8_t ch = p[i];
+		hist[i & 3][ch] += 1;
+		if (ch == '\n' || ch == '\r') {
+			if (!hasEOL) {
+				firstRun = run;
+				hasEOL = true;
+			}
+			maxRun = max(maxRun, run);
+			run = 0;
+			crlf += ch == '\n' && prev == '\r';
+		} else {
+			run += 1;
+			words += IsWhiteSpaceByte(prev) && !IsWhiteSpaceByte(ch);
+		}
+		prev = ch;
+	}
+	for (unsigned i = 0; i < 256; i++) {
+		chunk.hist[i] = hist[0][i] + hist[1][i] + hist[2][i] + hist[3][i];
+	}
+	chunk.words = words;
+	chunk.crlf = crlf;
+	chunk.firstRun = hasEOL ? firstRun : run;
+	chunk.maxRun = maxRun;
+	chunk.lastRun = run;
+	chunk.hasEOL = hasEOL;
+}
+
+#if USE_WIN32_PTP_WORK
+VOID CALLBACK StatisticsChunkWorkCallback([[maybe_unused]] PTP_CALLBACK_INSTANCE instance, PVOID context, [[maybe_unused]] PTP_WORK work) {
+	CountStatisticsChunk(*static_cast<StatisticsChunk *>(context));
+}
+#endif // USE_WIN32_PTP_WORK
+
+constexpr size_t ParallelStatisticsMinBytes = 16*1024*1024;
+constexpr DWORD ParallelStatisticsMaxChunks = 8;
+
+// cached by modification generation so a second invocation is free
+struct DocStatisticsCache {
+	bool valid;
+	DWORD docReversion;
+	Sci_Position length;
+	Sci_Line lineCount;
+	DocStatistics stats;
+};
+DocStatisticsCache docStatisticsCache;
+
 }
 
+void EditShowDocumentStatistics(DWORD docReversion) noexcept {
+	const Sci_Position length = SciCall_GetLength();
+	const Sci_Line lineCount = SciCall_GetLineCount();
+	DocStatisticsCache &cache = docStatisticsCache;
+	if (!cache.valid || cache.docReversion != docReversion || cache.length != length || cache.lineCount != lineCount) {
+		BeginWaitCursor();
+		const uint8_t * const base = reinterpret_cast<const uint8_t *>(SciCall_GetRangePointer(0, length));
+		StatisticsChunk chunks[ParallelStatisticsMaxChunks];
+		memset(chunks, 0, sizeof(chunks));
+		DWORD chunkCount = 1;
+#if USE_WIN32_PTP_WORK
+		if (static_cast<size_t>(length) >= ParallelStatisticsMinBytes) {
+			SYSTEM_INFO info;
+			GetNativeSystemInfo(&info);
+			chunkCount = min(info.dwNumberOfProcessors, ParallelStatisticsMaxChunks);
+		}
+#endif // USE_WIN32_PTP_WORK
+		const size_t step = (static_cast<size_t>(length) + chunkCount - 1)/chunkCount;
+		size_t offset = 0;
+		DWORD used = 0;
+		for (DWORD i = 0; i < chunkCount && offset < static_cast<size_t>(length); i++) {
+			chunks[i].base = base + offset;
+			chunks[i].length = min(step, static_cast<size_t>(length) - offset);
+			chunks[i].prevByte = (offset == 0) ? uint8_t{'\n'} : base[offset - 1];
+			offset += chunks[i].length;
+			used = i + 1;
+		}
+#if USE_WIN32_PTP_WORK
+		if (used > 1) {
+			PTP_WORK works[ParallelStatisticsMaxChunks];
+			for (DWORD i = 0; i < used; i++) {
+				works[i] = CreateThreadpoolWork(StatisticsChunkWorkCallback, &chunks[i], nullptr);
+				if (works[i] != nullptr) {
+					SubmitThreadpoolWork(works[i]);
+				}
+			}
+			for (DWORD i = 0; i < used; i++) {
+				if (works[i] != nullptr) {
+					WaitForThreadpoolWorkCallbacks(works[i], FALSE);
+					CloseThreadpoolWork(works[i]);
+				} else {
+					// thread pool refused the work: count the chunk here
+					CountStatisticsChunk(chunks[i]);
+				}
+			}
+		} else if (used != 0) {
+			CountStatisticsChunk(chunks[0]);
+		}
+#else
+		for (DWORD i = 0; i < used; i++) {
+			CountStatisticsChunk(chunks[i]);
+		}
+#endif // USE_WIN32_PTP_WORK
+
+		uint64_t hist[256] = {};
+		DocStatistics stats = {};
+		uint64_t carry = 0;
+		for (DWORD i = 0; i < used; i++) {
+			const StatisticsChunk &chunk = chunks[i];
+			for (unsigned b = 0; b < 256; b++) {
+				hist[b] += chunk.hist[b];
+			}
+			stats.words += chunk.words;
+			stats.crlf += chunk.crlf;
+			if (chunk.hasEOL) {
+				stats.longestLine = max(stats.longestLine, carry + chunk.firstRun);
+				stats.longestLine = max(stats.longestLine, chunk.maxRun);
+				carry = chunk.lastRun;
+			} else {
+				carry += chunk.lastRun;
+			}
+		}
+		stats.longestLine = max(stats.longestLine, carry);
+		uint64_t continuation = 0;
+		for (unsigned b = 0x80; b < 0x100; b++) {
+			stats.nonAscii += hist[b];
+			if (b < 0xC0) {
+				continuation += hist[b];
+			}
+		}
+		stats.loneLF = hist['\n'] - stats.crlf;
+		stats.loneCR = hist['\r'] - stats.crlf;
+		stats.chars = static_cast<uint64_t>(length);
+		if (SciCall_GetCodePage() == SC_CP_UTF8) {
+			stats.chars -= continuation;
+		}
+		cache.valid = true;
+		cache.docReversion = docReversion;
+		cache.length = length;
+		cache.lineCount = lineCount;
+		cache.stats = stats;
+		EndWaitCursor();
+	}
+
+	const DocStatistics &stats = cache.stats;
+	WCHAR tchLine[32];
+	WCHAR tchWord[32];
+	WCHAR tchChar[32];
+	WCHAR tchByte[32];
+	WCHAR tchNonAscii[32];
+	WCHAR tchLongest[32];
+	WCHAR tchCRLF[32];
+	WCHAR tchLF[32];
+	WCHAR tchCR[32];
+	FormatNumber64(tchLine, static_cast<uint64_t>(lineCount));
+	FormatNumber64(tchWord, stats.words);
+	FormatNumber64(tchChar, stats.chars);
+	FormatNumber64(tchByte, static_cast<uint64_t>(length));
+	FormatNumber64(tchNonAscii, stats.nonAscii);
+	FormatNumber64(tchLongest, stats.longestLine);
+	FormatNumber64(tchCRLF, stats.crlf);
+	FormatNumber64(tchLF, stats.loneLF);
+	FormatNumber64(tchCR, stats.loneCR);
+	MsgBoxInfo(MB_OK, IDS_DOC_STATISTICS, tchLine, tchWord, tchChar, tchByte, tchNonAscii, tchLongest, tchCRLF, tchLF, tchCR);
 }
 
 void EditSortLines(EditSortFlag iSortFlags) noexcept {
@@ -4093,6 +6336,33 @@ void EditSortLines(EditSortFlag iSortFlags) noexcept {
 		return;
 	}
 
+	Sci_Position iSortField = -1;
+	uint32_t csvOption = 0;
+	if ((iSortFlags & EditSortFlag_ColumnSort) && pLexCurrent->iLexer == SCLEX_CSV) {
+		// sort by the CSV field under the sort column on the first line of the
+		// range instead of by display column: fields are rarely aligned.
+		csvOption = Style_GetCsvOption();
+		const uint8_t delimiter = csvOption & 0xff;
+		const uint8_t quoteChar = (csvOption >> 8) & 0x7f;
+		const Sci_Position iLineStartPos = SciCall_PositionFromLine(iLineStart);
+		const Sci_Position iColumnPos = SciCall_FindColumn(iLineStart, iSortColumn);
+		const char *p = SciCall_GetRangePointer(iLineStartPos, iColumnPos - iLineStartPos);
+		iSortField = 0;
+		bool quoted = false;
+		uint8_t chPrev = 0;
+		for (Sci_Position pos = iLineStartPos; pos < iColumnPos; pos++) {
+			const uint8_t ch = *p++;
+			if (ch == quoteChar) {
+				quoted = !quoted;
+			} else if (ch == delimiter && !quoted) {
+				if (ch != chPrev || (csvOption & CsvOption_MergeDelimiter) == 0) {
+					iSortField++;
+				}
+			}
+			chPrev = ch;
+		}
+	}
+
 	SciCall_BeginUndoAction();
 	if (bIsRectangular) {
 		EditPadWithSpaces(!(iSortFlags & EditSortFlag_Shuffle), true);
@@ -4143,7 +6413,25 @@ void EditSortLines(EditSortFlag iSortFlags) noexcept {
 			}
 
 			pLines[i].pwszSortLine = pwszLine;
-			if (iSortFlags & EditSortFlag_ColumnSort) {
+			if (iSortField >= 0) {
+				// skip to the start of the sort field, honouring quoted fields
+				const WCHAR delimiter = csvOption & 0xff;
+				const WCHAR quoteChar = (csvOption >> 8) & 0x7f;
+				Sci_Position field = 0;
+				bool quoted = false;
+				WCHAR chPrev = 0;
+				while (*pwszLine && field < iSortField) {
+					const WCHAR ch = *pwszLine++;
+					if (ch == quoteChar) {
+						quoted = !quoted;
+					} else if (ch == delimiter && !quoted) {
+						if (ch != chPrev || (csvOption & CsvOption_MergeDelimiter) == 0) {
+							field++;
+						}
+					}
+					chPrev = ch;
+				}
+			} else if (iSortFlags & EditSortFlag_ColumnSort) {
 				const int tabWidth = fvCurFile.iTabWidth;
 				Sci_Position col = 0;
 				Sci_Position tabs = tabWidth;
@@ -4189,8 +6477,19 @@ void EditSortLines(EditSortFlag iSortFlags) noexcept {
 			pLines[i] = pLines[j];
 			pLines[j] = sLine;
 		}
+	} else if (iSortFlags & EditSortFlag_DontSort) {
+		// keep the original order: no sorting needed, only duplicate handling
+		if (iSortFlags & (EditSortFlag_MergeDuplicate | EditSortFlag_RemoveDuplicate | EditSortFlag_RemoveUnique)) {
+			MarkDuplicateLines(pLines, iLineCount, iSortFlags);
+		}
 	} else {
+#if USE_WIN32_PTP_WORK
+		if (iLineCount < ParallelSortMinLines || !SortLinesParallel(pLines, iLineCount)) {
+			qsort(pLines, iLineCount, sizeof(SORTLINE), CmpSortLine);
+		}
+#else
 		qsort(pLines, iLineCount, sizeof(SORTLINE), CmpSortLine);
+#endif
 		if (iSortFlags > EditSortFlag_Shuffle) {
 			bool bLastDup = false;
 			for (Sci_Line i = 0; i < iLineCount; i++) {
@@ -4207,9 +6506,6 @@ void EditSortLines(EditSortFlag iSortFlags) noexcept {
 				}
 			}
 		}
-		if (iSortFlags & EditSortFlag_DontSort) {
-			qsort(pLines, iLineCount, sizeof(SORTLINE), DontSortLine);
-		}
 	}
 
 	const unsigned iEOLMode = SciCall_GetEOLMode();
@@ -4285,6 +6581,10 @@ void EditSortLines(EditSortFlag iSortFlags) noexcept {
 // EditJumpTo()
 //
 void EditJumpTo(Sci_Line iNewLine, Sci_Position iNewCol) noexcept {
+	if (bPageViewMode) {
+		// whole-file line number to window-local through the line index
+		EditPageViewGoToLine(iNewLine);
+	}
 	// Jumpt to end with line set to -1
 	if (iNewLine < 0 || iNewLine > SciCall_GetLineCount()) {
 		iNewCol = SciCall_GetLength();
@@ -4368,13 +6668,24 @@ void EditEnsureConsistentLineEndings() noexcept {
 	if (lineCount < 2) {
 		return;
 	}
+
+	const int iEOLMode = SciCall_GetEOLMode();
+	Sci_LineEndCounts lineEndCounts;
+	SciCall_GetLineEndCounts(&lineEndCounts);
+	// values must kept in same order as SC_EOL_CRLF, SC_EOL_CR, SC_EOL_LF
+	const Sci_Position linesCount[3] = { lineEndCounts.crlf, lineEndCounts.cr, lineEndCounts.lf };
+	if (linesCount[iEOLMode] == static_cast<Sci_Position>(lineCount - 1)) {
+		// all line endings already match the current mode,
+		// skip the whole document scan inside ConvertEOLs()
+		return;
+	}
+
 	const size_t actions = SciCall_GetUndoActions();
 	if (lineCount + actions >= MAX_NON_UTF8_SIZE) {
 		// Scintilla undo stack is indexed with int
 		return;
 	}
 
-	const int iEOLMode = SciCall_GetEOLMode();
 	if (iEOLMode == SC_EOL_CRLF) {
 #if defined(_WIN64)
 		const int options = SciCall_GetDocumentOptions();
@@ -4621,87 +6932,397 @@ void EditSaveSelectionAsFindText(EDITFINDREPLACE *lpefr, int menu, bool findSele
 	}
 }
 
-static void FindReplaceSetFont(HWND hwnd, bool monospaced, HFONT *hFontFindReplaceEdit) noexcept {
-	HWND hwndFind = GetDlgItem(hwnd, IDC_FINDTEXT);
-	HWND hwndRepl = GetDlgItem(hwnd, IDC_REPLACETEXT);
-	HFONT font = nullptr;
-	if (monospaced) {
-		font = *hFontFindReplaceEdit;
-		if (font == nullptr) {
-			*hFontFindReplaceEdit = font = Style_CreateCodeFont(g_uCurrentDPI);
+//=============================================================================
+//
+// EditSavedSearchAdd()
+// Saved searches keep the search flags together with the pattern so invoking
+// one restores regex / match case / transform state. Stored INI form:
+// search flags, space, option flags, tab, pattern; the pattern is backslash
+// escaped the same way as the find MRU so it stays on one line.
+//
+void EditSavedSearchAdd(EDITFINDREPLACE *lpefr) noexcept {
+	if (StrIsEmpty(lpefr->szFind)) {
+		EditSaveSelectionAsFindText(lpefr, IDM_EDIT_SAVEFIND, true);
+		if (StrIsEmpty(lpefr->szFind)) {
+			return;
 		}
 	}
-	if (font == nullptr) {
-		// use font from parent window
-		font = GetWindowFont(hwnd);
-	}
-	SetWindowFont(hwndFind, font, TRUE);
-	if (hwndRepl) {
-		SetWindowFont(hwndRepl, font, TRUE);
-	}
-}
 
-static bool CopySelectionAsFindText(HWND hwnd, EDITFINDREPLACE *lpefr, bool bFirstTime) noexcept {
-	const Sci_Position cchSelection = SciCall_GetSelTextLength();
-	char *lpszSelection = nullptr;
+	WCHAR wszFind[NP2_FIND_REPLACE_LIMIT];
+	MultiByteToWideChar(CP_UTF8, 0, lpefr->szFindUTF8, -1, wszFind, COUNTOF(wszFind));
 
-	if (cchSelection != 0 && cchSelection <= NP2_FIND_REPLACE_LIMIT && (iSelectOption & SelectOption_CopySelectionAsFindText)) {
-		lpszSelection = static_cast<char *>(NP2HeapAlloc(cchSelection + 1));
-		SciCall_GetSelText(lpszSelection);
+	LPWSTR const lpszEsc = static_cast<LPWSTR>(NP2HeapAlloc((2*NP2_FIND_REPLACE_LIMIT + 32)*sizeof(WCHAR)));
+	UINT option = lpefr->option & FindReplaceOption_SearchMask;
+	if (AddBackslashW(lpszEsc + 32, wszFind)) {
+		if ((lpefr->fuFlags & SCFIND_REGEXP) == 0) {
+			option |= FindReplaceOption_TransformBackslash;
+		}
 	}
 
-	// only for manually selected text
-	const bool hasFindText = StrNotEmpty(lpszSelection);
+	WCHAR tchHead[32];
+	const int len = wsprintf(tchHead, L"%u %u\t", lpefr->fuFlags, option);
+	LPWSTR const item = lpszEsc + 32 - len;
+	memcpy(item, tchHead, len*sizeof(WCHAR));
+	mruSavedFind.Add(item);
+	NP2HeapFree(lpszEsc);
+}
 
-	// First time you bring up find/replace dialog,
-	// copy content from clipboard to find box when nothing is selected in the editor.
-	if (!hasFindText && bFirstTime && (iSelectOption & SelectOption_CopyPasteBufferAsFindText)) {
-		char *pClip = EditGetClipboardText(hwnd);
-		if (pClip != nullptr) {
-			const size_t len = strlen(pClip);
-			if (len > 0 && len <= NP2_FIND_REPLACE_LIMIT) {
-				NP2HeapFree(lpszSelection);
-				lpszSelection = static_cast<char *>(NP2HeapAlloc(len + 2));
-				strcpy(lpszSelection, pClip);
-			}
-			LocalFree(pClip);
-		}
+//=============================================================================
+//
+// EditSavedSearchMenu()
+//
+void EditSavedSearchMenu(HWND hwnd) noexcept {
+	if (mruSavedFind.iSize <= 0) {
+		return;
 	}
 
-	if (StrNotEmpty(lpszSelection)) {
-		char *lpszEscSel = static_cast<char *>(NP2HeapAlloc((2 * NP2_FIND_REPLACE_LIMIT)));
-		unsigned option = lpefr->option & ~FindReplaceOption_TransformBackslash;
-		if (AddBackslashA(lpszEscSel, lpszSelection)) {
-			if ((lpefr->fuFlags & SCFIND_REGEXP) == 0) {
-				option |= FindReplaceOption_TransformBackslash;
+	HMENU hmenu = CreatePopupMenu();
+	MENUITEMINFO mii;
+	mii.cbSize = sizeof(MENUITEMINFO);
+	mii.fMask = MIIM_ID | MIIM_STRING;
+	WCHAR tch[128];
+	for (int i = 0; i < mruSavedFind.iSize; i++) {
+		LPCWSTR pattern = StrChr(mruSavedFind.pszItems[i], L'\t');
+		if (pattern == nullptr) {
+			continue;
+		}
+		++pattern;
+		WCHAR *t = tch + wsprintf(tch, (i < 9) ? L"&%d  " : L"%d  ", i + 1);
+		WCHAR * const end = tch + COUNTOF(tch) - 2;
+		while (*pattern && t < end) {
+			const WCHAR ch = *pattern++;
+			if (ch == L'&') {
+				*t++ = L'&';
 			}
+			*t++ = ch;
 		}
-
-		lpefr->option = option;
-		const UINT cpEdit = SciCall_GetCodePage();
-		SetDlgItemTextA2W(cpEdit, hwnd, IDC_FINDTEXT, lpszEscSel);
-		NP2HeapFree(lpszEscSel);
+		if (*pattern) {
+			t[-1] = L'\x2026';
+		}
+		*t = L'\0';
+		mii.wID = i + IDM_SAVED_SEARCH_START;
+		mii.dwTypeData = tch;
+		InsertMenuItem(hmenu, i, TRUE, &mii);
 	}
 
-	if (lpszSelection != nullptr) {
-		NP2HeapFree(lpszSelection);
-	}
-	return hasFindText;
+	const Sci_Position iCurrentPos = SciCall_GetCurrentPos();
+	POINT pt = { SciCall_PointXFromPosition(iCurrentPos), SciCall_PointYFromPosition(iCurrentPos) };
+	ClientToScreen(hwndEdit, &pt);
+	TrackPopupMenuEx(hmenu, TPM_LEFTBUTTON | TPM_RIGHTBUTTON, pt.x + 1, pt.y + 1, hwnd, nullptr);
+	DestroyMenu(hmenu);
 }
 
 //=============================================================================
 //
-// EditFindReplaceDlgProc()
+// EditSavedSearchInvoke()
 //
-static INT_PTR CALLBACK EditFindReplaceDlgProc(HWND hwnd, UINT umsg, WPARAM wParam, LPARAM lParam) noexcept {
-	static int bSwitchedFindReplace = 0;
-	static int xFindReplaceDlgSave;
-	static int yFindReplaceDlgSave;
-	static HFONT hFontFindReplaceEdit;
+void EditSavedSearchInvoke(EDITFINDREPLACE *lpefr, int index) noexcept {
+	if (index >= mruSavedFind.iSize) {
+		return;
+	}
 
-	WCHAR tch[NP2_FIND_REPLACE_LIMIT + 32];
+	int64_t fuFlags = 0;
+	int64_t option = 0;
+	LPCWSTR p = ParseInt64(mruSavedFind.pszItems[index], &fuFlags);
+	if (p != nullptr) {
+		p = ParseInt64(p, &option);
+	}
+	if (p == nullptr || *p != L'\t') {
+		return;
+	}
+	++p;
 
-	switch (umsg) {
+	lpefr->fuFlags = static_cast<UINT>(fuFlags);
+	lpefr->option = (lpefr->option & ~FindReplaceOption_SearchMask) | (static_cast<UINT>(option) & FindReplaceOption_SearchMask);
+	memset(lpefr->szFindUTF8, 0, COUNTOF(lpefr->szFindUTF8));
+	WideCharToMultiByte(CP_UTF8, 0, p, -1, lpefr->szFindUTF8, COUNTOF(lpefr->szFindUTF8), nullptr, nullptr);
+	const UINT cpEdit = SciCall_GetCodePage();
+	memset(lpefr->szFind, 0, COUNTOF(lpefr->szFind));
+	WideCharToMultiByte(cpEdit, 0, p, -1, lpefr->szFind, COUNTOF(lpefr->szFind), nullptr, nullptr);
+	EditFindNext(lpefr, false);
+}
+
+//=============================================================================
+//
+// EditMarkAllSavedSearches()
+// Marks every plain text saved search in a single pass over the document:
+// the needles are compiled into one Aho-Corasick automaton so a large log is
+// scanned once instead of once per pattern, and each pattern colors its hits
+// with its own indicator from the IndicatorNumber_MultiPatternMark palette.
+// Regex and wildcard entries are skipped as they don't fit a literal matcher.
+//
+void EditMarkAllSavedSearches() noexcept {
+	// clear previous marks, an invocation without usable needles acts as clear
+	const Sci_Position iLength = SciCall_GetLength();
+	for (int i = 0; i < MultiPatternMarkCount; i++) {
+		SciCall_SetIndicatorCurrent(IndicatorNumber_MultiPatternMark + i);
+		SciCall_IndicatorClearRange(0, iLength);
+	}
+	if (iLength == 0 || mruSavedFind.iSize <= 0) {
+		return;
+	}
+
+	struct PatternNeedle {
+		char *text;
+		int length;
+		int next;			// next needle ending on the same trie node
+		int indicator;
+		bool verifyCase;	// folded hits need an exact comparison
+	};
+
+	// patterns are inserted with ASCII bytes case folded so one automaton
+	// serves both sensitivities; exact case needles verify at match time.
+	// byte wise folding would corrupt DBCS trail bytes, so for DBCS pages
+	// everything is matched exactly, same as the lexers do.
+	const UINT cpEdit = SciCall_GetCodePage();
+	const bool bFoldCase = !IsDBCSCodePage(cpEdit);
+
+	PatternNeedle needles[MRU_MAX_SAVED_FIND];
+	int needleCount = 0;
+	int totalLength = 0;
+	for (int i = 0; i < mruSavedFind.iSize; i++) {
+		int64_t fuFlags = 0;
+		int64_t option = 0;
+		LPCWSTR p = ParseInt64(mruSavedFind.pszItems[i], &fuFlags);
+		if (p != nullptr) {
+			p = ParseInt64(p, &option);
+		}
+		if (p == nullptr || *p != L'\t' || (fuFlags & SCFIND_REGEXP) != 0 || (option & FindReplaceOption_WildcardSearch) != 0) {
+			continue;
+		}
+		++p;
+
+		char * const text = static_cast<char *>(NP2HeapAlloc(kMaxMultiByteCount*NP2_FIND_REPLACE_LIMIT));
+		WideCharToMultiByte(cpEdit, 0, p, -1, text, kMaxMultiByteCount*NP2_FIND_REPLACE_LIMIT, nullptr, nullptr);
+		if (option & FindReplaceOption_TransformBackslash) {
+			TransformBackslashes(text, FALSE, cpEdit);
+		}
+		const int length = static_cast<int>(strlen(text));
+		if (length == 0) {
+			NP2HeapFree(text);
+			continue;
+		}
+		PatternNeedle &needle = needles[needleCount];
+		needle.text = text;
+		needle.length = length;
+		needle.next = -1;
+		needle.indicator = IndicatorNumber_MultiPatternMark + needleCount % MultiPatternMarkCount;
+		needle.verifyCase = bFoldCase && (fuFlags & SCFIND_MATCHCASE) != 0;
+		++needleCount;
+		totalLength += length;
+	}
+	if (needleCount == 0) {
+		return;
+	}
+
+	struct TrieNode {
+		int fail;
+		int out;			// nearest terminal node along the fail chain
+		int firstChild;
+		int sibling;
+		int needle;			// first needle ending here, -1 if none
+		int depth;
+		unsigned char ch;	// byte on the edge from the parent
+	};
+
+	TrieNode * const nodes = static_cast<TrieNode *>(NP2HeapAlloc((totalLength + 1)*sizeof(TrieNode)));
+	nodes[0].needle = -1;
+	int nodeCount = 1;
+	for (int i = 0; i < needleCount; i++) {
+		PatternNeedle &needle = needles[i];
+		int state = 0;
+		for (int j = 0; j < needle.length; j++) {
+			unsigned char ch = needle.text[j];
+			if (bFoldCase && ch >= 'A' && ch <= 'Z') {
+				ch += 'a' - 'A';
+			}
+			int child = nodes[state].firstChild;
+			while (child != 0 && nodes[child].ch != ch) {
+				child = nodes[child].sibling;
+			}
+			if (child == 0) {
+				child = nodeCount++;
+				TrieNode &node = nodes[child];
+				node.ch = ch;
+				node.needle = -1;
+				node.depth = j + 1;
+				node.sibling = nodes[state].firstChild;
+				nodes[state].firstChild = child;
+			}
+			state = child;
+		}
+		needle.next = nodes[state].needle;
+		nodes[state].needle = i;
+	}
+
+	// breadth first pass filling failure and output links
+	int * const queue = static_cast<int *>(NP2HeapAlloc(nodeCount*sizeof(int)));
+	int head = 0;
+	int tail = 0;
+	for (int child = nodes[0].firstChild; child != 0; child = nodes[child].sibling) {
+		queue[tail++] = child;	// fail and out already point at the root
+	}
+	while (head < tail) {
+		const int state = queue[head++];
+		for (int child = nodes[state].firstChild; child != 0; child = nodes[child].sibling) {
+			const unsigned char ch = nodes[child].ch;
+			int fail = nodes[state].fail;
+			int next;
+			for (;;) {
+				next = nodes[fail].firstChild;
+				while (next != 0 && nodes[next].ch != ch) {
+					next = nodes[next].sibling;
+				}
+				if (next != 0 || fail == 0) {
+					break;
+				}
+				fail = nodes[fail].fail;
+			}
+			nodes[child].fail = next;
+			nodes[child].out = (nodes[next].needle >= 0) ? next : nodes[next].out;
+			queue[tail++] = child;
+		}
+	}
+
+	// dense transition table for the root, where most bytes fall through
+	int rootNext[256] = {};
+	for (int child = nodes[0].firstChild; child != 0; child = nodes[child].sibling) {
+		rootNext[nodes[child].ch] = child;
+	}
+
+	BeginWaitCursor();
+	const char * const snapshot = SciCall_GetRangePointer(0, iLength);
+	int currentIndicator = -1;
+	int state = 0;
+	for (Sci_Position pos = 0; pos < iLength; pos++) {
+		unsigned char ch = snapshot[pos];
+		if (bFoldCase && ch >= 'A' && ch <= 'Z') {
+			ch += 'a' - 'A';
+		}
+		int next;
+		for (;;) {
+			if (state == 0) {
+				next = rootNext[ch];
+				break;
+			}
+			next = nodes[state].firstChild;
+			while (next != 0 && nodes[next].ch != ch) {
+				next = nodes[next].sibling;
+			}
+			if (next != 0) {
+				break;
+			}
+			state = nodes[state].fail;
+		}
+		state = next;
+		if (state != 0) {
+			int term = (nodes[state].needle >= 0) ? state : nodes[state].out;
+			while (term != 0) {
+				const Sci_Position start = pos + 1 - nodes[term].depth;
+				for (int k = nodes[term].needle; k >= 0; k = needles[k].next) {
+					const PatternNeedle &needle = needles[k];
+					if (!needle.verifyCase || memcmp(snapshot + start, needle.text, needle.length) == 0) {
+						if (currentIndicator != needle.indicator) {
+							currentIndicator = needle.indicator;
+							SciCall_SetIndicatorCurrent(currentIndicator);
+						}
+						SciCall_IndicatorFillRange(start, needle.length);
+					}
+				}
+				term = nodes[term].out;
+			}
+		}
+	}
+	EndWaitCursor();
+
+	NP2HeapFree(queue);
+	NP2HeapFree(nodes);
+	for (int i = 0; i < needleCount; i++) {
+		NP2HeapFree(needles[i].text);
+	}
+}
+
+static void FindReplaceSetFont(HWND hwnd, bool monospaced, HFONT *hFontFindReplaceEdit) noexcept {
+	HWND hwndFind = GetDlgItem(hwnd, IDC_FINDTEXT);
+	HWND hwndRepl = GetDlgItem(hwnd, IDC_REPLACETEXT);
+	HFONT font = nullptr;
+	if (monospaced) {
+		font = *hFontFindReplaceEdit;
+		if (font == nullptr) {
+			*hFontFindReplaceEdit = font = Style_CreateCodeFont(g_uCurrentDPI);
+		}
+	}
+	if (font == nullptr) {
+		// use font from parent window
+		font = GetWindowFont(hwnd);
+	}
+	SetWindowFont(hwndFind, font, TRUE);
+	if (hwndRepl) {
+		SetWindowFont(hwndRepl, font, TRUE);
+	}
+}
+
+static bool CopySelectionAsFindText(HWND hwnd, EDITFINDREPLACE *lpefr, bool bFirstTime) noexcept {
+	const Sci_Position cchSelection = SciCall_GetSelTextLength();
+	char *lpszSelection = nullptr;
+
+	if (cchSelection != 0 && cchSelection <= NP2_FIND_REPLACE_LIMIT && (iSelectOption & SelectOption_CopySelectionAsFindText)) {
+		lpszSelection = static_cast<char *>(NP2HeapAlloc(cchSelection + 1));
+		SciCall_GetSelText(lpszSelection);
+	}
+
+	// only for manually selected text
+	const bool hasFindText = StrNotEmpty(lpszSelection);
+
+	// First time you bring up find/replace dialog,
+	// copy content from clipboard to find box when nothing is selected in the editor.
+	if (!hasFindText && bFirstTime && (iSelectOption & SelectOption_CopyPasteBufferAsFindText)) {
+		char *pClip = EditGetClipboardText(hwnd);
+		if (pClip != nullptr) {
+			const size_t len = strlen(pClip);
+			if (len > 0 && len <= NP2_FIND_REPLACE_LIMIT) {
+				NP2HeapFree(lpszSelection);
+				lpszSelection = static_cast<char *>(NP2HeapAlloc(len + 2));
+				strcpy(lpszSelection, pClip);
+			}
+			LocalFree(pClip);
+		}
+	}
+
+	if (StrNotEmpty(lpszSelection)) {
+		char *lpszEscSel = static_cast<char *>(NP2HeapAlloc((2 * NP2_FIND_REPLACE_LIMIT)));
+		unsigned option = lpefr->option & ~FindReplaceOption_TransformBackslash;
+		if (AddBackslashA(lpszEscSel, lpszSelection)) {
+			if ((lpefr->fuFlags & SCFIND_REGEXP) == 0) {
+				option |= FindReplaceOption_TransformBackslash;
+			}
+		}
+
+		lpefr->option = option;
+		const UINT cpEdit = SciCall_GetCodePage();
+		SetDlgItemTextA2W(cpEdit, hwnd, IDC_FINDTEXT, lpszEscSel);
+		NP2HeapFree(lpszEscSel);
+	}
+
+	if (lpszSelection != nullptr) {
+		NP2HeapFree(lpszSelection);
+	}
+	return hasFindText;
+}
+
+//=============================================================================
+//
+// EditFindReplaceDlgProc()
+//
+static INT_PTR CALLBACK EditFindReplaceDlgProc(HWND hwnd, UINT umsg, WPARAM wParam, LPARAM lParam) noexcept {
+	static int bSwitchedFindReplace = 0;
+	static int xFindReplaceDlgSave;
+	static int yFindReplaceDlgSave;
+	static HFONT hFontFindReplaceEdit;
+
+	WCHAR tch[NP2_FIND_REPLACE_LIMIT + 32];
+
+	switch (umsg) {
 	case WM_INITDIALOG: {
 		SetWindowLongPtr(hwnd, DWLP_USER, lParam);
 		ResizeDlg_InitX(hwnd, cxFindReplaceDlg, IDC_RESIZEGRIP2);
@@ -5268,6 +7889,37 @@ int EditPrepareReplace(HWND hwnd, char *szFind2, char **pszReplace2, BOOL *bRepl
 	return searchFlags;
 }
 
+namespace {
+// Incremental find session: remembers the prepared needle and the match the
+// previous search landed on. When the needle in the Find dialog is extended
+// the next search continues at the current match instead of starting behind
+// it, so typing one more character keeps (or minimally advances) the match
+// rather than rescanning the document for the next occurrence.
+struct IncrementalFindSession {
+	char szFind[NP2_FIND_REPLACE_LIMIT] = "";
+	int searchFlags = NP2_InvalidSearchFlags;
+	Sci_Position matchPos = -1;
+
+	bool Continues(const char *szFind2, int flags, Sci_Position selStart) const noexcept {
+		// the session is stale once the caret left the remembered match,
+		// the needle was edited elsewhere than its end, or the flags changed.
+		if (flags != searchFlags || selStart != matchPos || matchPos < 0) {
+			return false;
+		}
+		const size_t prevLen = strlen(szFind);
+		return prevLen != 0 && strlen(szFind2) > prevLen && strncmp(szFind, szFind2, prevLen) == 0;
+	}
+	void Remember(const char *szFind2, int flags, Sci_Position pos) noexcept {
+		strcpy(szFind, szFind2);
+		searchFlags = flags;
+		matchPos = pos;
+	}
+};
+
+IncrementalFindSession incrementalFind;
+
+}
+
 //=============================================================================
 //
 // EditFindNext()
@@ -5281,8 +7933,12 @@ void EditFindNext(const EDITFINDREPLACE *lpefr, bool fExtendSelection) noexcept
 
 	const Sci_Position iSelPos = SciCall_GetCurrentPos();
 	const Sci_Position iSelAnchor = SciCall_GetAnchor();
+	Sci_Position iSearchFrom = SciCall_GetSelectionEnd();
+	if (incrementalFind.Continues(szFind2, searchFlags, SciCall_GetSelectionStart())) {
+		iSearchFrom = incrementalFind.matchPos;
+	}
 
-	Sci_TextToFindFull ttf = { { SciCall_GetSelectionEnd(), SciCall_GetLength() }, szFind2, { 0, 0 } };
+	Sci_TextToFindFull ttf = { { iSearchFrom, SciCall_GetLength() }, szFind2, { 0, 0 } };
 	Sci_Position iPos = SciCall_FindTextFull(searchFlags, &ttf);
 	bool bSuppressNotFound = false;
 
@@ -5297,12 +7953,14 @@ void EditFindNext(const EDITFINDREPLACE *lpefr, bool fExtendSelection) noexcept
 
 	if (iPos < 0) {
 		// not found
+		incrementalFind.matchPos = -1;
 		if (!bSuppressNotFound) {
 			InfoBoxWarn(MB_OK, L"MsgNotFound", IDS_NOTFOUND);
 		}
 	} else {
 		if (!fExtendSelection) {
 			EditSelectEx(ttf.chrgText.cpMin, ttf.chrgText.cpMax);
+			incrementalFind.Remember(szFind2, searchFlags, ttf.chrgText.cpMin);
 		} else {
 			EditSelectEx(min(iSelAnchor, iSelPos), ttf.chrgText.cpMax);
 		}
@@ -5327,8 +7985,15 @@ void EditFindPrev(const EDITFINDREPLACE *lpefr, bool fExtendSelection) noexcept
 
 	const Sci_Position iSelPos = SciCall_GetCurrentPos();
 	const Sci_Position iSelAnchor = SciCall_GetAnchor();
+	Sci_Position iSearchFrom = SciCall_GetSelectionStart();
+	if (incrementalFind.Continues(szFind2, searchFlags, iSearchFrom)) {
+		// let the backward search re-consider the current match; the needle
+		// length bounds a literal match, a longer regex match is simply
+		// treated as stale and found again on the next wrap.
+		iSearchFrom = incrementalFind.matchPos + static_cast<Sci_Position>(strlen(szFind2));
+	}
 
-	Sci_TextToFindFull ttf = { { SciCall_GetSelectionStart(), 0 }, szFind2, { 0, 0 } };
+	Sci_TextToFindFull ttf = { { iSearchFrom, 0 }, szFind2, { 0, 0 } };
 	Sci_Position iPos = SciCall_FindTextFull(searchFlags, &ttf);
 	const Sci_Position iLength = SciCall_GetLength();
 	bool bSuppressNotFound = false;
@@ -5344,12 +8009,14 @@ void EditFindPrev(const EDITFINDREPLACE *lpefr, bool fExtendSelection) noexcept
 
 	if (iPos < 0) {
 		// not found
+		incrementalFind.matchPos = -1;
 		if (!bSuppressNotFound) {
 			InfoBoxWarn(MB_OK, L"MsgNotFound", IDS_NOTFOUND);
 		}
 	} else {
 		if (!fExtendSelection) {
 			EditSelectEx(ttf.chrgText.cpMin, ttf.chrgText.cpMax);
+			incrementalFind.Remember(szFind2, searchFlags, ttf.chrgText.cpMin);
 		} else {
 			EditSelectEx(max(iSelPos, iSelAnchor), ttf.chrgText.cpMin);
 		}
@@ -5448,6 +8115,7 @@ extern HANDLE idleTaskTimer;
 // when selection no longer changed, this make continuous selecting smooth.
 #define EditMarkAll_DefaultDuration		64
 #define EditMarkAll_RangeCacheCount		256
+#define EditMarkAll_MaxCachedPositions	(1024*1024)
 //static UINT EditMarkAll_Runs;
 
 void EditMarkAll::Reset(int findFlag, Sci_Position iSelCount, LPSTR text) noexcept {
@@ -5480,15 +8148,29 @@ void EditMarkAll::Reset(int findFlag, Sci_Position iSelCount, LPSTR text) noexce
 	lastMatchPos = 0;
 	prevStopPos = 0;
 	prevBookmarkLine = -1;
+	visibleMarkedStart = 0;
+	visibleMarkedEnd = 0;
+	dirtyStartPos = PTRDIFF_MAX;
+	dirtyEndPos = 0;
+	positionCount = 0;
+	if (positionCapacity > 256*1024) {
+		// don't keep a huge cache from the previous search
+		NP2HeapFree(positions);
+		positions = nullptr;
+		positionCapacity = 0;
+	}
 }
 
 void EditMarkAll::Start(BOOL bChanged, int findFlag, Sci_Position iSelCount, LPSTR text) noexcept {
-	if (!bChanged && (findFlag == markFlag
+	if (findFlag == markFlag
 		&& iSelCount == length
 		// _stricmp() is not safe for DBCS string.
-		&& memcmp(text, pszText, iSelCount) == 0)) {
-		NP2HeapFree(text);
-		return;
+		&& memcmp(text, pszText, iSelCount) == 0) {
+		// same pattern: only the modified range needs rescanning.
+		if (!bChanged || Rescan()) {
+			NP2HeapFree(text);
+			return;
+		}
 	}
 
 	Reset(findFlag, iSelCount, text);
@@ -5508,9 +8190,76 @@ void EditMarkAll::Start(BOOL bChanged, int findFlag, Sci_Position iSelCount, LPS
 		bookmarkForFindAll = (findFlag & NP2_FromFindAll) != 0;
 		Style_SetBookmark();
 	}
+	MarkVisible();
 	Continue(idleTaskTimer);
 }
 
+void EditMarkAll::MarkVisible() noexcept {
+	// mark the matches on screen before the time sliced scan reaches them,
+	// so Find All gives immediate feedback near the end of a large file.
+	// Called again on every vertical scroll while the scan is pending, so
+	// scrolling around an unscanned region still shows its matches.
+	// Only indicators are placed here: refilling them when Continue() counts
+	// the region is harmless, while selections and bookmarks are not.
+	if (markFlag & NP2_MarkAllSelectAll) {
+		return;
+	}
+	const Sci_Line iVisTopLine = SciCall_GetFirstVisibleLine();
+	const Sci_Line iLinesOnScreen = SciCall_LinesOnScreen();
+	// pad the viewport by one screen on both sides so wheel scrolling moves
+	// inside an already marked band instead of searching on every notch.
+	const Sci_Line iDocTopLine = SciCall_DocLineFromVisible(max<Sci_Line>(iVisTopLine - iLinesOnScreen, 0));
+	Sci_Position windowStart = SciCall_PositionFromLine(iDocTopLine);
+	if (windowStart < EditMarkAll_MeasuredSize && prevStopPos == 0) {
+		// the first incremental slice covers the visible range anyway
+		return;
+	}
+	const Sci_Line iDocLastLine = SciCall_DocLineFromVisible(iVisTopLine + 2*iLinesOnScreen);
+	Sci_Position windowEnd = SciCall_GetLineEndPosition(iDocLastLine);
+	// the time sliced scan in Continue() has already marked [0, prevStopPos).
+	windowStart = max(windowStart, prevStopPos);
+	if (windowStart >= windowEnd || (windowStart >= visibleMarkedStart && windowEnd <= visibleMarkedEnd)) {
+		// the scroll position moved within the marked band, reuse it
+		return;
+	}
+	if (windowStart >= visibleMarkedStart && windowStart <= visibleMarkedEnd) {
+		// scrolled down: only search past the end of the band
+		windowStart = visibleMarkedEnd;
+		visibleMarkedEnd = windowEnd;
+	} else if (windowEnd >= visibleMarkedStart && windowEnd <= visibleMarkedEnd) {
+		// scrolled up: only search before the start of the band
+		windowEnd = visibleMarkedStart;
+		visibleMarkedStart = windowStart;
+	} else {
+		// jumped outside the band, restart it here
+		visibleMarkedStart = windowStart;
+		visibleMarkedEnd = windowEnd;
+	}
+	Sci_Position cpMin = windowStart;
+	if (markFlag & NP2_MarkAllMultiline) {
+		// rewind so a match straddling the top of the window is marked too
+		cpMin = max<Sci_Position>(windowStart - length + 1, 0);
+	}
+
+	SciCall_SetIndicatorCurrent(IndicatorNumber_MarkOccurrence);
+	Sci_TextToFindFull ttf = { { cpMin, windowEnd }, pszText, { 0, 0 } };
+	while (cpMin < windowEnd) {
+		ttf.chrg.cpMin = cpMin;
+		const Sci_Position iPos = SciCall_FindTextFull(markFlag, &ttf);
+		if (iPos < 0) {
+			break;
+		}
+		const Sci_Position iSelCount = ttf.chrgText.cpMax - iPos;
+		if (iSelCount == 0) {
+			// empty regex
+			cpMin = SciCall_PositionAfter(iPos);
+			continue;
+		}
+		SciCall_IndicatorFillRange(iPos, iSelCount);
+		cpMin = ttf.chrgText.cpMax;
+	}
+}
+
 void EditMarkAll::Stop() noexcept {
 	pending = false;
 	matchCount = 0;
@@ -5528,21 +8277,39 @@ static Sci_Line EditMarkAll_Bookmark(Sci_Line bookmarkLine, const Sci_Position *
 		for (; i < index; i += 2) {
 			SciCall_AddSelection(ranges[i] + ranges[i + 1], ranges[i]);
 		}
-	} else {
-		for (UINT i = 0; i < index; i += 2) {
-			SciCall_IndicatorFillRange(ranges[i], ranges[i + 1]);
-		}
+	} else if (index != 0) {
+		// the collected (start, length) pairs are already sorted: commit the
+		// batch with one SCI_INDICATORFILLLIST, one notification and one
+		// redraw instead of one per match.
+		const Sci_RangeList list = { static_cast<Sci_Position>(index/2), ranges };
+		SciCall_IndicatorFillList(&list);
 	}
 	if (!(findFlag & NP2_MarkAllBookmark)) {
 		return bookmarkLine;
 	}
+	// collect the sorted line list, then commit all markers with one
+	// SCI_MARKERADDLIST: one notification and one margin redraw per batch
+	// instead of one per line.
+	Sci_Position lineBuf[EditMarkAll_RangeCacheCount];
+	Sci_Position *lines = lineBuf;
+	size_t capacity = COUNTOF(lineBuf);
+	size_t count = 0;
 	if (findFlag & NP2_MarkAllMultiline) {
 		for (UINT i = 0; i < index; i += 2) {
 			Sci_Line line = SciCall_LineFromPosition(ranges[i]);
 			const Sci_Line lineEnd = SciCall_LineFromPosition(ranges[i] + ranges[i + 1]);
 			line = max(bookmarkLine + 1, line);
 			while (line <= lineEnd) {
-				SciCall_MarkerAdd(line, MarkerNumber_Bookmark);
+				if (count == capacity) {
+					capacity *= 2;
+					if (lines == lineBuf) {
+						lines = static_cast<Sci_Position *>(NP2HeapAlloc(capacity*sizeof(Sci_Position)));
+						memcpy(lines, lineBuf, count*sizeof(Sci_Position));
+					} else {
+						lines = static_cast<Sci_Position *>(NP2HeapReAlloc(lines, capacity*sizeof(Sci_Position)));
+					}
+				}
+				lines[count++] = line;
 				++line;
 			}
 			bookmarkLine = lineEnd;
@@ -5551,11 +8318,18 @@ static Sci_Line EditMarkAll_Bookmark(Sci_Line bookmarkLine, const Sci_Position *
 		for (UINT i = 0; i < index; i += 2) {
 			const Sci_Line line = SciCall_LineFromPosition(ranges[i]);
 			if (line != bookmarkLine) {
-				SciCall_MarkerAdd(line, MarkerNumber_Bookmark);
+				lines[count++] = line;
 				bookmarkLine = line;
 			}
 		}
 	}
+	if (count != 0) {
+		const Sci_MarkerList list = { static_cast<Sci_Position>(count), lines };
+		SciCall_MarkerAddList(MarkerNumber_Bookmark, &list);
+	}
+	if (lines != lineBuf) {
+		NP2HeapFree(lines);
+	}
 	return bookmarkLine;
 }
 
@@ -5609,6 +8383,7 @@ void EditMarkAll::Continue(HANDLE timer) noexcept {
 			continue;
 		}
 
+		CachePosition(iPos);
 		if (index != 0 && iPos == cpMin && (findFlag & NP2_MarkAllSelectAll) == 0) {
 			// merge adjacent indicator ranges
 			ranges[index - 1] += iSelCount;
@@ -5654,6 +8429,143 @@ void EditMarkAll::Continue(HANDLE timer) noexcept {
 	}
 }
 
+void EditMarkAll::CachePosition(Sci_Position pos) noexcept {
+	if (positionCount < 0) {
+		return;
+	}
+	if (positionCount == positionCapacity) {
+		if (positionCount >= EditMarkAll_MaxCachedPositions) {
+			// too many matches to track, fall back to full rescan on changes
+			positionCount = -1;
+			return;
+		}
+		positionCapacity = (positionCapacity == 0) ? 1024 : positionCapacity*2;
+		positions = static_cast<Sci_Position *>(positions
+			? NP2HeapReAlloc(positions, positionCapacity*sizeof(Sci_Position))
+			: NP2HeapAlloc(positionCapacity*sizeof(Sci_Position)));
+	}
+	positions[positionCount] = pos;
+	positionCount += 1;
+}
+
+void EditMarkAll::OnModified(Sci_Position position, Sci_Position changeEnd, Sci_Position delta) noexcept {
+	if (pszText == nullptr) {
+		return;
+	}
+	if (dirtyEndPos > position) {
+		dirtyEndPos = max(position, dirtyEndPos + delta);
+	}
+	dirtyStartPos = min(dirtyStartPos, position);
+	dirtyEndPos = max(dirtyEndPos, changeEnd);
+	if (positionCount > 0) {
+		// keep cached positions in current document coordinates
+		Sci_Position lo = 0;
+		Sci_Position hi = positionCount;
+		while (lo < hi) {
+			const Sci_Position mid = (lo + hi)/2;
+			if (positions[mid] < position) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+		for (Sci_Position i = lo; i < positionCount; i++) {
+			positions[i] = max(position, positions[i] + delta);
+		}
+	}
+}
+
+// rescan only the lines around the range modified since the last scan, so typing
+// in a large file with many marked occurrences does not restart the whole search.
+bool EditMarkAll::Rescan() noexcept {
+	if (pending || positionCount < 0
+		|| (markFlag & (SCFIND_REGEXP | NP2_MarkAllSelectAll | NP2_MarkAllBookmark | NP2_MarkAllMultiline)) != 0) {
+		return false;
+	}
+	if (dirtyStartPos == PTRDIFF_MAX) {
+		return true; // nothing was modified
+	}
+
+	const Sci_Position iLength = SciCall_GetLength();
+	// matches don't span lines here (multiline searches fall back above), so
+	// expanding to whole lines re-evaluates matches beside or around the change.
+	const Sci_Position windowStart = SciCall_PositionFromLine(SciCall_LineFromPosition(dirtyStartPos));
+	const Sci_Position windowEnd = SciCall_GetLineEndPosition(SciCall_LineFromPosition(min(dirtyEndPos, iLength)));
+	if (windowEnd - windowStart > EditMarkAll_MeasuredSize) {
+		// large change, use the time sliced full scan instead
+		return false;
+	}
+	dirtyStartPos = PTRDIFF_MAX;
+	dirtyEndPos = 0;
+
+	// previous matches inside the window; no match starting before the window
+	// can reach into it as it would have to span the line break.
+	Sci_Position lo = 0;
+	Sci_Position hi = positionCount;
+	while (lo < hi) {
+		const Sci_Position mid = (lo + hi)/2;
+		if (positions[mid] < windowStart) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	hi = lo;
+	while (hi < positionCount && positions[hi] < windowEnd) {
+		++hi;
+	}
+	const Sci_Position oldCount = hi - lo;
+
+	SciCall_SetIndicatorCurrent(IndicatorNumber_MarkOccurrence);
+	SciCall_IndicatorClearRange(windowStart, windowEnd - windowStart);
+
+	Sci_Position cpMin = windowStart;
+	Sci_TextToFindFull ttf = { { cpMin, windowEnd }, pszText, { 0, 0 } };
+	Sci_Position foundCapacity = EditMarkAll_RangeCacheCount;
+	Sci_Position *found = static_cast<Sci_Position *>(NP2HeapAlloc(foundCapacity*sizeof(Sci_Position)));
+	Sci_Position newCount = 0;
+	while (cpMin < windowEnd) {
+		ttf.chrg.cpMin = cpMin;
+		const Sci_Position iPos = SciCall_FindTextFull(markFlag, &ttf);
+		if (iPos < 0) {
+			break;
+		}
+		SciCall_IndicatorFillRange(iPos, ttf.chrgText.cpMax - iPos);
+		if (newCount == foundCapacity) {
+			foundCapacity *= 2;
+			found = static_cast<Sci_Position *>(NP2HeapReAlloc(found, foundCapacity*sizeof(Sci_Position)));
+		}
+		found[newCount] = iPos;
+		++newCount;
+		cpMin = ttf.chrgText.cpMax;
+	}
+
+	// splice the new matches over the old ones so the cache stays sorted
+	const Sci_Position total = positionCount - oldCount + newCount;
+	if (total > EditMarkAll_MaxCachedPositions) {
+		positionCount = -1;
+	} else {
+		if (total > positionCapacity) {
+			positionCapacity = max(total, positionCapacity*2);
+			positions = static_cast<Sci_Position *>(positions
+				? NP2HeapReAlloc(positions, positionCapacity*sizeof(Sci_Position))
+				: NP2HeapAlloc(positionCapacity*sizeof(Sci_Position)));
+		}
+		memmove(positions + lo + newCount, positions + hi, (positionCount - hi)*sizeof(Sci_Position));
+		memcpy(positions + lo, found, newCount*sizeof(Sci_Position));
+		positionCount = total;
+	}
+	NP2HeapFree(found);
+
+	if (newCount != oldCount) {
+		matchCount += newCount - oldCount;
+		UpdateStatusBarCache(StatusItem_Find);
+		UpdateStatusbar();
+	}
+	prevStopPos = iLength;
+	return true;
+}
+
 void EditMarkAll::MarkAll(BOOL bChanged, int option) noexcept {
 	// get current selection
 	Sci_Position iSelStart = SciCall_GetSelectionStart();
@@ -5791,46 +8703,83 @@ void EditReplaceAll(HWND hwnd, const EDITFINDREPLACE *lpefr) noexcept {
 	watch.Start();
 #endif
 
-	const bool bRegexStartOfLine = bReplaceRE && (szFind2[0] == '^');
 	Sci_TextToFindFull ttf = { { 0, SciCall_GetLength() }, szFind2, { 0, 0 } };
 	Sci_Position iCount = 0;
-	while (SciCall_FindTextFull(searchFlags, &ttf) >= 0) {
-		++iCount;
-		if (iCount == 1) {
+	if (!bReplaceRE) {
+		// Plan all edits first against the unmodified document, then apply
+		// them in reverse order inside one batch update: the search never has
+		// to restart over shifted text, and applying from the back keeps the
+		// planned positions valid without any fix up. Regex replacement can't
+		// be planned this way as SCI_REPLACETARGETRE substitutes the capture
+		// groups of the most recent search.
+		Sci_Position capacity = 0;
+		Sci_Position *ranges = nullptr;
+		while (SciCall_FindTextFull(searchFlags, &ttf) >= 0) {
+			if (2*iCount == capacity) {
+				capacity = (capacity == 0) ? 1024 : capacity*2;
+				ranges = static_cast<Sci_Position *>(ranges
+					? NP2HeapReAlloc(ranges, capacity*sizeof(Sci_Position))
+					: NP2HeapAlloc(capacity*sizeof(Sci_Position)));
+			}
+			ranges[2*iCount] = ttf.chrgText.cpMin;
+			ranges[2*iCount + 1] = ttf.chrgText.cpMax;
+			++iCount;
+			ttf.chrg.cpMin = ttf.chrgText.cpMax;
+		}
+		if (iCount) {
 			SciCall_BeginBatchUpdate();
+			const Sci_Position cchReplace = strlen(pszReplace2);
+			for (Sci_Position i = iCount - 1; i >= 0; i--) {
+				SciCall_SetTargetRange(ranges[2*i], ranges[2*i + 1]);
+				SciCall_ReplaceTarget(cchReplace, pszReplace2);
+			}
 		}
-
-		SciCall_SetTargetRange(ttf.chrgText.cpMin, ttf.chrgText.cpMax);
-		const Sci_Position iReplacedLen = SciCall_ReplaceTargetEx(bReplaceRE, -1, pszReplace2);
-
-		ttf.chrg.cpMin = (ttf.chrgText.cpMin + iReplacedLen);
-		// document length change: iReplacedLen - (ttf.chrgText.cpMax - ttf.chrgText.cpMin)
-		ttf.chrg.cpMax += ttf.chrg.cpMin - ttf.chrgText.cpMax;
-
-		if (ttf.chrg.cpMin == ttf.chrg.cpMax) {
-			break;
+		if (ranges) {
+			NP2HeapFree(ranges);
 		}
+	} else {
+		const bool bRegexStartOfLine = szFind2[0] == '^';
+		// pass the template length so Scintilla can reuse its compiled form
+		// for every match instead of measuring and re-parsing it each time
+		const Sci_Position cchReplace = strlen(pszReplace2);
+		while (SciCall_FindTextFull(searchFlags, &ttf) >= 0) {
+			++iCount;
+			if (iCount == 1) {
+				SciCall_BeginBatchUpdate();
+			}
 
-		if (ttf.chrgText.cpMin == ttf.chrgText.cpMax && !bRegexStartOfLine) {
-			// move to next line after the replacement.
-			ttf.chrg.cpMin = SciCall_PositionAfter(ttf.chrg.cpMin);
-		}
+			SciCall_SetTargetRange(ttf.chrgText.cpMin, ttf.chrgText.cpMax);
+			const Sci_Position iReplacedLen = SciCall_ReplaceTargetRE(cchReplace, pszReplace2);
 
-		if (bRegexStartOfLine) {
-			const Sci_Line iLine = SciCall_LineFromPosition(ttf.chrg.cpMin);
-			const Sci_Position ilPos = SciCall_PositionFromLine(iLine);
+			ttf.chrg.cpMin = (ttf.chrgText.cpMin + iReplacedLen);
+			// document length change: iReplacedLen - (ttf.chrgText.cpMax - ttf.chrgText.cpMin)
+			ttf.chrg.cpMax += ttf.chrg.cpMin - ttf.chrgText.cpMax;
 
-			if (ilPos == ttf.chrg.cpMin) {
-				ttf.chrg.cpMin = SciCall_PositionFromLine(iLine + 1);
-			}
 			if (ttf.chrg.cpMin == ttf.chrg.cpMax) {
 				break;
 			}
-		}
-	}
 
-#if 0
-	watch.Stop();
+			if (ttf.chrgText.cpMin == ttf.chrgText.cpMax && !bRegexStartOfLine) {
+				// move to next line after the replacement.
+				ttf.chrg.cpMin = SciCall_PositionAfter(ttf.chrg.cpMin);
+			}
+
+			if (bRegexStartOfLine) {
+				const Sci_Line iLine = SciCall_LineFromPosition(ttf.chrg.cpMin);
+				const Sci_Position ilPos = SciCall_PositionFromLine(iLine);
+
+				if (ilPos == ttf.chrg.cpMin) {
+					ttf.chrg.cpMin = SciCall_PositionFromLine(iLine + 1);
+				}
+				if (ttf.chrg.cpMin == ttf.chrg.cpMax) {
+					break;
+				}
+			}
+		}
+	}
+
+#if 0
+	watch.Stop();
 	watch.ShowLog("EditReplaceAll() time");
 #endif
 	if (iCount) {
@@ -7442,6 +10391,155 @@ void EditSetWrapIndentMode(int tabWidth, int indentWidth) noexcept {
 	SciCall_SetWrapIndentMode(indentMode);
 }
 
+//=============================================================================
+//
+// Elastic tab stops: align tab separated cells across neighbouring lines by
+// feeding computed tab positions (SCI_ADDTABSTOP) into the layout engine.
+// Only a band of lines around the viewport is solved, so the cost per update
+// is bounded by the screen size, not the document size: a million line TSV
+// pays for roughly three screens of cell measurements per edit or scroll.
+//
+
+extern bool bElasticTabStops;
+
+#define ElasticTabStops_MaxLines		512		// solver band limit
+#define ElasticTabStops_MaxColumns		64
+#define ElasticTabStops_MaxLineLength	4096	// don't measure pathological long lines
+
+// lines currently carrying computed tab stops, -1 when none
+static Sci_Line elasticBandStart = -1;
+static Sci_Line elasticBandEnd = -1;
+
+void EditElasticTabStopsOnNewDocument() noexcept {
+	// per line tab stops died with the old document
+	elasticBandStart = -1;
+	elasticBandEnd = -1;
+}
+
+// commit the stops shared by all lines of a column block.
+static void EditElasticTabStopsSolveBlock(Sci_Line blockStart, Sci_Line blockEnd, const int *stops, UINT stopCount) noexcept {
+	for (Sci_Line line = blockStart; line <= blockEnd; line++) {
+		// skip lines whose stops are unchanged to avoid layout invalidation
+		int x = 0;
+		UINT index = 0;
+		while (index < stopCount) {
+			x = SciCall_GetNextTabStop(line, x);
+			if (x != stops[index]) {
+				break;
+			}
+			++index;
+		}
+		if (index == stopCount && SciCall_GetNextTabStop(line, x) == 0) {
+			continue;
+		}
+		SciCall_ClearTabStops(line);
+		for (index = 0; index < stopCount; index++) {
+			SciCall_AddTabStop(line, stops[index]);
+		}
+	}
+}
+
+void EditElasticTabStopsRefresh(bool scrollOnly) noexcept {
+	if (!bElasticTabStops) {
+		return;
+	}
+	const Sci_Line iVisTopLine = SciCall_GetFirstVisibleLine();
+	const Sci_Line iLinesOnScreen = SciCall_LinesOnScreen();
+	// pad the viewport by one screen on both sides so small scrolls stay
+	// inside the solved band.
+	Sci_Line top = SciCall_DocLineFromVisible(max<Sci_Line>(iVisTopLine - iLinesOnScreen, 0));
+	Sci_Line bottom = SciCall_DocLineFromVisible(iVisTopLine + 2*iLinesOnScreen);
+	const Sci_Line lineCount = SciCall_GetLineCount();
+	bottom = min(bottom, lineCount - 1);
+	if (bottom - top >= ElasticTabStops_MaxLines) {
+		bottom = top + ElasticTabStops_MaxLines - 1;
+	}
+	if (scrollOnly && elasticBandStart >= 0 && top >= elasticBandStart && bottom <= elasticBandEnd) {
+		// only the scroll position moved inside the solved band
+		return;
+	}
+	// drop stops on lines leaving the band
+	if (elasticBandStart >= 0) {
+		const Sci_Line bandEnd = min(elasticBandEnd, lineCount - 1);
+		for (Sci_Line line = elasticBandStart; line <= bandEnd; line++) {
+			if (line < top || line > bottom) {
+				SciCall_ClearTabStops(line);
+			}
+		}
+	}
+	elasticBandStart = top;
+	elasticBandEnd = bottom;
+
+	const int spaceWidth = max(SciCall_TextWidth(STYLE_DEFAULT, " "), 1);
+	const int padding = 2*spaceWidth;
+	char szLine[ElasticTabStops_MaxLineLength + 1];
+	int widths[ElasticTabStops_MaxColumns];
+	int maxWidth[ElasticTabStops_MaxColumns];
+	Sci_Line blockStart = -1;
+	UINT blockColumns = 0;
+
+	for (Sci_Line line = top; line <= bottom + 1; line++) {
+		// measure the cells in front of each tab; the cell after the last
+		// tab doesn't constrain any stop.
+		UINT columns = 0;
+		if (line <= bottom) {
+			const Sci_Position iLineLength = SciCall_GetLineLength(line);
+			if (iLineLength != 0 && iLineLength <= ElasticTabStops_MaxLineLength) {
+				SciCall_GetLine(line, szLine);
+				szLine[iLineLength] = '\0';
+				char *cell = szLine;
+				char *tab;
+				while (columns < ElasticTabStops_MaxColumns && (tab = strchr(cell, '\t')) != nullptr) {
+					*tab = '\0';
+					widths[columns++] = SciCall_TextWidth(STYLE_DEFAULT, cell);
+					cell = tab + 1;
+				}
+			}
+		}
+		if (columns == 0) {
+			// a line without tabs (or an over long one) ends the column block
+			if (blockStart >= 0) {
+				int x = 0;
+				for (UINT i = 0; i < blockColumns; i++) {
+					x += max(maxWidth[i], spaceWidth) + padding;
+					maxWidth[i] = x;
+				}
+				EditElasticTabStopsSolveBlock(blockStart, line - 1, maxWidth, blockColumns);
+				blockStart = -1;
+			}
+			if (line > bottom) {
+				break;
+			}
+			SciCall_ClearTabStops(line);
+			continue;
+		}
+		if (blockStart < 0) {
+			blockStart = line;
+			blockColumns = 0;
+		}
+		for (UINT i = 0; i < columns; i++) {
+			if (i >= blockColumns || widths[i] > maxWidth[i]) {
+				maxWidth[i] = widths[i];
+			}
+		}
+		blockColumns = max(blockColumns, columns);
+	}
+}
+
+void EditElasticTabStops(bool enable) noexcept {
+	// clear the old band first: on zoom or font change the widths below it
+	// were computed for another geometry.
+	const Sci_Line bandStart = elasticBandStart;
+	const Sci_Line bandEnd = min(elasticBandEnd, SciCall_GetLineCount() - 1);
+	EditElasticTabStopsOnNewDocument();
+	for (Sci_Line line = bandStart; line >= 0 && line <= bandEnd; line++) {
+		SciCall_ClearTabStops(line);
+	}
+	if (enable) {
+		EditElasticTabStopsRefresh(false);
+	}
+}
+
 //=============================================================================
 //
 // FileVars_Apply()
@@ -7736,6 +10834,60 @@ void FinishBatchFold() noexcept {
 
 }
 
+FoldOutline foldOutline;
+
+void FoldOutline::Empty() noexcept {
+	if (nodes != nullptr) {
+		NP2HeapFree(nodes);
+		nodes = nullptr;
+	}
+	count = 0;
+	capacity = 0;
+	valid = false;
+}
+
+void FoldOutline::Build() noexcept {
+	SciCall_ColouriseAll();
+	count = 0;
+	const Sci_Line lineCount = SciCall_GetLineCount();
+	for (Sci_Line line = 0; line < lineCount; line++) {
+		const int level = SciCall_GetFoldLevel(line);
+		if (level & SC_FOLDLEVELHEADERFLAG) {
+			if (count == capacity) {
+				capacity = (capacity == 0) ? 256 : capacity*2;
+				nodes = static_cast<Node *>(nodes ? NP2HeapReAlloc(nodes, capacity*sizeof(Node)) : NP2HeapAlloc(capacity*sizeof(Node)));
+			}
+			nodes[count] = { line, level & SC_FOLDLEVELNUMBERMASK };
+			count++;
+		}
+	}
+	valid = true;
+}
+
+Sci_Line FoldOutline::IndexBefore(Sci_Line line) const noexcept {
+	Sci_Line lo = 0;
+	Sci_Line hi = count;
+	while (lo < hi) {
+		const Sci_Line mid = (lo + hi)/2;
+		if (nodes[mid].line <= line) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo - 1;
+}
+
+Sci_Line FoldOutline::ParentIndex(Sci_Line line, int levelNum) const noexcept {
+	// as for SCI_GETFOLDPARENT: the nearest header before line with a
+	// smaller level number
+	Sci_Line i = IndexBefore(line - 1);
+	while (i >= 0 && nodes[i].level >= levelNum) {
+		--i;
+	}
+	return i;
+}
+
 bool EditIsLineContainsStyle(Sci_Line line, int style) noexcept {
 	Sci_Position lineStart = SciCall_PositionFromLine(line);
 	Sci_Position lineEnd = SciCall_PositionFromLine(line + 1);
@@ -7776,42 +10928,41 @@ void FoldToggleAll(FOLD_ACTION action) noexcept {
 }
 
 void FoldToggleLevel(int lev, FOLD_ACTION action) noexcept {
-	SciCall_ColouriseAll();
-	const Sci_Line lineCount = SciCall_GetLineCount();
-	Sci_Line line = 0;
+	if (!foldOutline.valid) {
+		foldOutline.Build();
+	}
 
 	SendMessage(hwndEdit, WM_SETREDRAW, FALSE, 0);
 #if 0
 	StopWatch watch;
 	watch.Start();
 #endif
+	Sci_Line skipTo = -1; // headers inside a toggled block are not visited
 	if (pLexCurrent->lexerAttr & LexerAttr_IndentBasedFolding) {
 		FoldLevelStack levelStack{};
 		++lev;
-		while (line < lineCount) {
-			int level = SciCall_GetFoldLevel(line);
-			if (level & SC_FOLDLEVELHEADERFLAG) {
-				level &= SC_FOLDLEVELNUMBERMASK;
-				levelStack.Push(level);
-				if (lev == levelStack.levelCount) {
-					action = FoldToggleNode(line, action);
-					line = SciCall_GetLastChildEx(line, level);
-				}
+		for (Sci_Line i = 0; i < foldOutline.count; i++) {
+			const FoldOutline::Node node = foldOutline.nodes[i];
+			if (node.line <= skipTo) {
+				continue;
+			}
+			levelStack.Push(node.level);
+			if (lev == levelStack.levelCount) {
+				action = FoldToggleNode(node.line, action);
+				skipTo = SciCall_GetLastChildEx(node.line, node.level);
 			}
-			++line;
 		}
 	} else {
 		lev += SC_FOLDLEVELBASE;
-		while (line < lineCount) {
-			int level = SciCall_GetFoldLevel(line);
-			if (level & SC_FOLDLEVELHEADERFLAG) {
-				level &= SC_FOLDLEVELNUMBERMASK;
-				if (lev == level) {
-					action = FoldToggleNode(line, action);
-					line = SciCall_GetLastChildEx(line, level);
-				}
+		for (Sci_Line i = 0; i < foldOutline.count; i++) {
+			const FoldOutline::Node node = foldOutline.nodes[i];
+			if (node.line <= skipTo) {
+				continue;
+			}
+			if (lev == node.level) {
+				action = FoldToggleNode(node.line, action);
+				skipTo = SciCall_GetLastChildEx(node.line, node.level);
 			}
-			++line;
 		}
 	}
 
@@ -8026,11 +11177,17 @@ void EditGotoBlock(int menu) noexcept {
 	const Sci_Position iCurPos = SciCall_GetCurrentPos();
 	const Sci_Line iCurLine = SciCall_LineFromPosition(iCurPos);
 
-	Sci_Line iLine = iCurLine;
-	int level = SciCall_GetFoldLevel(iLine);
-	if (!(level & SC_FOLDLEVELHEADERFLAG)) {
-		iLine = SciCall_GetFoldParent(iLine);
+	if (!foldOutline.valid) {
+		foldOutline.Build();
 	}
+	const FoldOutline::Node * const nodes = foldOutline.nodes;
+	const Sci_Line headerCount = foldOutline.count;
+
+	const int level = SciCall_GetFoldLevel(iCurLine);
+	const int levelNum = level & SC_FOLDLEVELNUMBERMASK;
+	// index of the current block's header in the outline
+	const Sci_Line iBlock = (level & SC_FOLDLEVELHEADERFLAG) ? foldOutline.IndexBefore(iCurLine) : foldOutline.ParentIndex(iCurLine, levelNum);
+	Sci_Line iLine = (iBlock >= 0) ? nodes[iBlock].line : -1;
 
 	switch (menu) {
 	case IDM_EDIT_GOTO_BLOCK_START:
@@ -8044,75 +11201,54 @@ void EditGotoBlock(int menu) noexcept {
 
 	case IDM_EDIT_GOTO_PREVIOUS_BLOCK:
 	case IDM_EDIT_GOTO_PREV_SIBLING_BLOCK: {
-		bool sibling = menu == IDM_EDIT_GOTO_PREV_SIBLING_BLOCK;
-		Sci_Line line = iCurLine - 1;
-		Sci_Line first = -1;
-		level &= SC_FOLDLEVELNUMBERMASK;
-
-		while (line >= 0) {
-			const int lev = SciCall_GetFoldLevel(line);
-			 if ((lev & SC_FOLDLEVELHEADERFLAG) && line != iLine) {
-				if (sibling) {
-					if (first < 0) {
-						first = line;
-					}
-					if (level >= (lev & SC_FOLDLEVELNUMBERMASK)) {
-						iLine = line;
-						sibling = false;
-						break;
-					}
-					line = SciCall_GetFoldParent(line);
-					continue;
-				}
-
-				iLine = line;
-				break;
+		Sci_Line i = foldOutline.IndexBefore(iCurLine - 1);
+		if (menu == IDM_EDIT_GOTO_PREV_SIBLING_BLOCK) {
+			if (i == iBlock) {
+				--i;
+			}
+			const Sci_Line first = (i >= 0) ? nodes[i].line : -1;
+			while (i >= 0 && (i == iBlock || nodes[i].level > levelNum)) {
+				--i;
+			}
+			if (i >= 0) {
+				iLine = nodes[i].line;
+			} else if (first >= 0) {
+				iLine = first;
+			}
+		} else {
+			if (i == iBlock) {
+				--i;
+			}
+			if (i >= 0) {
+				iLine = nodes[i].line;
 			}
-			--line;
-		}
-		if (sibling && first >= 0) {
-			iLine = first;
 		}
 	}
 	break;
 
 	case IDM_EDIT_GOTO_NEXT_BLOCK:
 	case IDM_EDIT_GOTO_NEXT_SIBLING_BLOCK: {
-		const Sci_Line lineCount = SciCall_GetLineCount();
+		const bool sibling = menu == IDM_EDIT_GOTO_NEXT_SIBLING_BLOCK;
 		if (iLine >= 0) {
 			iLine = SciCall_GetLastChild(iLine);
 		}
 
-		bool sibling = menu == IDM_EDIT_GOTO_NEXT_SIBLING_BLOCK;
 		Sci_Line line = iCurLine + 1;
-		Sci_Line first = -1;
 		if (sibling && iLine > 0 && (level & SC_FOLDLEVELHEADERFLAG)) {
 			line = iLine + 1;
 		}
-		level &= SC_FOLDLEVELNUMBERMASK;
 
-		while (line < lineCount) {
-			const int lev = SciCall_GetFoldLevel(line);
-			if (lev & SC_FOLDLEVELHEADERFLAG) {
-				if (sibling) {
-					if (first < 0) {
-						first = line;
-					}
-					if (level >= (lev & SC_FOLDLEVELNUMBERMASK)) {
-						iLine = line;
-						sibling = false;
-						break;
-					}
-					line = SciCall_GetLastChildEx(line, lev);
-				} else {
-					iLine = line;
-					break;
+		Sci_Line i = foldOutline.IndexBefore(line - 1) + 1; // first header at or after line
+		if (i < headerCount) {
+			if (sibling) {
+				const Sci_Line first = nodes[i].line;
+				while (i < headerCount && nodes[i].level > levelNum) {
+					++i;
 				}
+				iLine = (i < headerCount) ? nodes[i].line : first;
+			} else {
+				iLine = nodes[i].line;
 			}
-			++line;
-		}
-		if (sibling && first >= 0) {
-			iLine = first;
 		}
 	}
 	break;
@@ -8123,3 +11259,585 @@ void EditGotoBlock(int menu) noexcept {
 		EditJumpTo(iLine + 1, column + 1);
 	}
 }
+
+//=============================================================================
+//
+// Find in Files
+// A worker pool walks the directory tree, memory-maps each candidate file
+// and searches it for the needle. Hits stream into the results list while
+// the scan is still running and open in the editor through EditJumpTo().
+//
+namespace {
+
+constexpr UINT APPM_FIF_RESULT = WM_APP + 1;	// dialog private
+constexpr UINT APPM_FIF_DONE = WM_APP + 2;
+constexpr UINT FIF_MaxWorkerCount = 8;
+constexpr LONGLONG FIF_MaxFileSize = 256*1024*1024;
+constexpr LONG FIF_MaxHitCount = 64*1024;
+constexpr int FIF_MaxExcerptLength = 250;
+
+struct FindInFilesHit {
+	Sci_Line line;
+	LPWSTR pszPath;		// points into this allocation
+	LPWSTR pszText;		// points into this allocation
+};
+
+struct FindInFilesPath {
+	FindInFilesPath *next;
+	WCHAR path[1];
+};
+
+struct FindInFilesSearch {
+	HWND hDlg;
+	volatile LONG stop;
+	volatile LONG activeThreadCount;
+	bool matchCase;
+	bool subdirectories;
+	bool enumerationDone;
+	UINT needleLength;
+	UINT threadCount;	// workers, excluding the enumeration thread
+	volatile LONG fileCount;
+	volatile LONG hitCount;
+	CRITICAL_SECTION lock;
+	HANDLE semaphore;
+	FindInFilesPath *head;
+	FindInFilesPath *tail;
+	HANDLE threads[FIF_MaxWorkerCount + 1];
+	WCHAR directory[MAX_PATH];
+	WCHAR filter[128];
+	char needle[NP2_FIND_REPLACE_LIMIT];	// UTF-8
+};
+
+FindInFilesSearch *pFindInFilesSearch = nullptr;
+
+constexpr char FindInFilesToLower(char ch) noexcept {
+	return (ch >= 'A' && ch <= 'Z') ? static_cast<char>(ch | 0x20) : ch;
+}
+
+// case folding is ASCII only, same as the document search fast path.
+const char* FindInFilesNextMatch(const char *ptr, const char *end, const char *needle, UINT needleLength, bool matchCase) noexcept {
+	if (matchCase) {
+		const char first = needle[0];
+		while (ptr + needleLength <= end) {
+			const char *match = static_cast<const char *>(memchr(ptr, first, end - ptr - needleLength + 1));
+			if (match == nullptr) {
+				return nullptr;
+			}
+			if (memcmp(match + 1, needle + 1, needleLength - 1) == 0) {
+				return match;
+			}
+			ptr = match + 1;
+		}
+	} else {
+		const char first = FindInFilesToLower(needle[0]);
+		for (; ptr + needleLength <= end; ptr++) {
+			if (FindInFilesToLower(*ptr) == first) {
+				UINT index = 1;
+				for (; index < needleLength; index++) {
+					if (FindInFilesToLower(ptr[index]) != FindInFilesToLower(needle[index])) {
+						break;
+					}
+				}
+				if (index == needleLength) {
+					return ptr;
+				}
+			}
+		}
+	}
+	return nullptr;
+}
+
+void FindInFilesPostHit(const FindInFilesSearch *search, LPCWSTR path, Sci_Line line, const char *text, int textLength) noexcept {
+	WCHAR excerpt[FIF_MaxExcerptLength + 1];
+	// most files are UTF-8 or ASCII; fall back to ANSI like the editor does
+	int cchExcerpt = MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, text, textLength, excerpt, COUNTOF(excerpt) - 1);
+	if (cchExcerpt == 0 && textLength != 0) {
+		cchExcerpt = MultiByteToWideChar(CP_ACP, 0, text, textLength, excerpt, COUNTOF(excerpt) - 1);
+	}
+	excerpt[cchExcerpt] = L'\0';
+
+	const int cchPath = lstrlen(path);
+	FindInFilesHit *hit = static_cast<FindInFilesHit *>(NP2HeapAlloc(sizeof(FindInFilesHit) + (cchPath + cchExcerpt + 2)*sizeof(WCHAR)));
+	hit->line = line;
+	hit->pszPath = reinterpret_cast<LPWSTR>(hit + 1);
+	hit->pszText = hit->pszPath + cchPath + 1;
+	memcpy(hit->pszPath, path, cchPath*sizeof(WCHAR));
+	memcpy(hit->pszText, excerpt, cchExcerpt*sizeof(WCHAR));
+	if (!PostMessage(search->hDlg, APPM_FIF_RESULT, 0, AsInteger<LPARAM>(hit))) {
+		NP2HeapFree(hit);
+	}
+}
+
+void FindInFilesSearchFile(FindInFilesSearch *search, LPCWSTR path) noexcept {
+	HANDLE hFile = CreateFile(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+					   nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE) {
+		return;
+	}
+	LARGE_INTEGER fileSize;
+	fileSize.QuadPart = 0;
+	GetFileSizeEx(hFile, &fileSize);
+	if (fileSize.QuadPart == 0 || fileSize.QuadPart > FIF_MaxFileSize) {
+		CloseHandle(hFile);
+		return;
+	}
+	HANDLE hFileMapping = CreateFileMapping(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(hFile);
+	if (hFileMapping == nullptr) {
+		return;
+	}
+	const char * const base = static_cast<const char *>(MapViewOfFile(hFileMapping, FILE_MAP_READ, 0, 0, 0));
+	if (base == nullptr) {
+		CloseHandle(hFileMapping);
+		return;
+	}
+	InterlockedIncrement(&search->fileCount);
+
+	const char *data = base;
+	DWORD cbData = static_cast<DWORD>(fileSize.QuadPart);
+	char *converted = nullptr;
+	if (cbData >= 2 && ((data[0] == '\xFF' && data[1] == '\xFE') || (data[0] == '\xFE' && data[1] == '\xFF'))) {
+		// UTF-16: search the UTF-8 form, same bytes the editor would hold
+		const bool reverse = data[0] == '\xFE';
+		LPCWSTR pszWide = reinterpret_cast<LPCWSTR>(data + 2);
+		const DWORD cchWide = (cbData - 2)/sizeof(WCHAR);
+		char *swapped = nullptr;
+		if (reverse) {
+			swapped = static_cast<char *>(NP2HeapAlloc(cchWide*sizeof(WCHAR) + 1));
+			_swab(const_cast<char *>(data + 2), swapped, static_cast<int>(cchWide*sizeof(WCHAR)));
+			pszWide = reinterpret_cast<LPCWSTR>(swapped);
+		}
+		const int cbConverted = WideCharToMultiByte(CP_UTF8, 0, pszWide, cchWide, nullptr, 0, nullptr, nullptr);
+		if (cbConverted > 0) {
+			converted = static_cast<char *>(NP2HeapAlloc(cbConverted));
+			WideCharToMultiByte(CP_UTF8, 0, pszWide, cchWide, converted, cbConverted, nullptr, nullptr);
+			data = converted;
+			cbData = cbConverted;
+		} else {
+			cbData = 0;
+		}
+		if (swapped != nullptr) {
+			NP2HeapFree(swapped);
+		}
+	} else if (cbData >= 3 && data[0] == '\xEF' && data[1] == '\xBB' && data[2] == '\xBF') {
+		data += 3;
+		cbData -= 3;
+	}
+
+	const char * const end = data + cbData;
+	const char *ptr = data;
+	const char *counted = data;
+	Sci_Line line = 1;
+	while (search->stop == 0 && search->hitCount < FIF_MaxHitCount) {
+		const char *match = FindInFilesNextMatch(ptr, end, search->needle, search->needleLength, search->matchCase);
+		if (match == nullptr) {
+			break;
+		}
+		const char *lineStart = counted;
+		for (const char *t = counted; t < match; t++) {
+			if (*t == '\n') {
+				++line;
+				lineStart = t + 1;
+			}
+		}
+		counted = match;
+		// skip back to the real line start when the previous hit was on the same line
+		while (lineStart > data && lineStart[-1] != '\n') {
+			--lineStart;
+		}
+		const char *lineEnd = static_cast<const char *>(memchr(match, '\n', end - match));
+		if (lineEnd == nullptr) {
+			lineEnd = end;
+		}
+		while (lineEnd > lineStart && (lineEnd[-1] == '\r' || lineEnd[-1] == '\n')) {
+			--lineEnd;
+		}
+		InterlockedIncrement(&search->hitCount);
+		FindInFilesPostHit(search, path, line, lineStart, static_cast<int>(min<ptrdiff_t>(lineEnd - lineStart, FIF_MaxExcerptLength)));
+		// one hit per line keeps the list readable
+		ptr = (lineEnd < end) ? lineEnd + 1 : end;
+	}
+
+	if (converted != nullptr) {
+		NP2HeapFree(converted);
+	}
+	UnmapViewOfFile(base);
+	CloseHandle(hFileMapping);
+}
+
+void FindInFilesQueuePath(FindInFilesSearch *search, LPCWSTR path) noexcept {
+	FindInFilesPath *node = static_cast<FindInFilesPath *>(NP2HeapAlloc(sizeof(FindInFilesPath) + lstrlen(path)*sizeof(WCHAR)));
+	lstrcpy(node->path, path);
+	EnterCriticalSection(&search->lock);
+	if (search->tail != nullptr) {
+		search->tail->next = node;
+	} else {
+		search->head = node;
+	}
+	search->tail = node;
+	LeaveCriticalSection(&search->lock);
+	ReleaseSemaphore(search->semaphore, 1, nullptr);
+}
+
+void FindInFilesScanDirectory(FindInFilesSearch *search, LPCWSTR pszDir) noexcept {
+	WCHAR tchPath[MAX_PATH];
+	PathCombine(tchPath, pszDir, L"*");
+
+	WIN32_FIND_DATA fd;
+	HANDLE hFind = FindFirstFileEx(tchPath, FindExInfoBasic, &fd, FindExSearchNameMatch, nullptr, 0);
+	if (hFind == INVALID_HANDLE_VALUE) {
+		return;
+	}
+	do {
+		if (search->stop != 0) {
+			break;
+		}
+		if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+			if (search->subdirectories
+				&& !(fd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)
+				&& fd.cFileName[0] != L'.') {
+				if (PathCombine(tchPath, pszDir, fd.cFileName)) {
+					FindInFilesScanDirectory(search, tchPath);
+				}
+			}
+		} else if (PathMatchSpec(fd.cFileName, search->filter)) {
+			if (PathCombine(tchPath, pszDir, fd.cFileName)) {
+				FindInFilesQueuePath(search, tchPath);
+			}
+		}
+	} while (FindNextFile(hFind, &fd));
+	FindClose(hFind);
+}
+
+DWORD WINAPI FindInFilesEnumThread(LPVOID lpParam) noexcept {
+	FindInFilesSearch * const search = static_cast<FindInFilesSearch *>(lpParam);
+	FindInFilesScanDirectory(search, search->directory);
+	EnterCriticalSection(&search->lock);
+	search->enumerationDone = true;
+	LeaveCriticalSection(&search->lock);
+	// wake every worker so those seeing an empty queue can exit
+	ReleaseSemaphore(search->semaphore, search->threadCount, nullptr);
+	if (InterlockedDecrement(&search->activeThreadCount) == 0) {
+		PostMessage(search->hDlg, APPM_FIF_DONE, 0, 0);
+	}
+	return 0;
+}
+
+DWORD WINAPI FindInFilesWorkerThread(LPVOID lpParam) noexcept {
+	FindInFilesSearch * const search = static_cast<FindInFilesSearch *>(lpParam);
+	for (;;) {
+		WaitForSingleObject(search->semaphore, INFINITE);
+		if (search->stop != 0) {
+			break;
+		}
+		EnterCriticalSection(&search->lock);
+		FindInFilesPath * const node = search->head;
+		if (node != nullptr) {
+			search->head = node->next;
+			if (search->head == nullptr) {
+				search->tail = nullptr;
+			}
+		}
+		const bool done = search->enumerationDone;
+		LeaveCriticalSection(&search->lock);
+		if (node == nullptr) {
+			if (done) {
+				break;
+			}
+			continue;
+		}
+		FindInFilesSearchFile(search, node->path);
+		NP2HeapFree(node);
+	}
+	if (InterlockedDecrement(&search->activeThreadCount) == 0) {
+		PostMessage(search->hDlg, APPM_FIF_DONE, 0, 0);
+	}
+	return 0;
+}
+
+// releases everything once all threads have exited
+void FindInFilesFreeSearch() noexcept {
+	FindInFilesSearch * const search = pFindInFilesSearch;
+	if (search == nullptr) {
+		return;
+	}
+	pFindInFilesSearch = nullptr;
+	for (UINT i = 0; i <= search->threadCount; i++) {
+		if (search->threads[i] != nullptr) {
+			CloseHandle(search->threads[i]);
+		}
+	}
+	CloseHandle(search->semaphore);
+	DeleteCriticalSection(&search->lock);
+	FindInFilesPath *node = search->head;
+	while (node != nullptr) {
+		FindInFilesPath * const next = node->next;
+		NP2HeapFree(node);
+		node = next;
+	}
+	NP2HeapFree(search);
+}
+
+void FindInFilesStop(HWND hwnd) noexcept {
+	FindInFilesSearch * const search = pFindInFilesSearch;
+	if (search == nullptr) {
+		return;
+	}
+	InterlockedExchange(&search->stop, 1);
+	ReleaseSemaphore(search->semaphore, search->threadCount + 1, nullptr);
+	WaitForMultipleObjects(search->threadCount + 1, search->threads, TRUE, INFINITE);
+	FindInFilesFreeSearch();
+	// drop hits still queued for a window that no longer wants them
+	MSG msg;
+	while (PeekMessage(&msg, hwnd, APPM_FIF_RESULT, APPM_FIF_RESULT, PM_REMOVE)) {
+		NP2HeapFree(AsPointer<void *>(msg.lParam));
+	}
+}
+
+void FindInFilesClearResults(HWND hwndLV) noexcept {
+	const int count = ListView_GetItemCount(hwndLV);
+	LVITEM lvi;
+	lvi.mask = LVIF_PARAM;
+	lvi.iSubItem = 0;
+	for (int i = 0; i < count; i++) {
+		lvi.iItem = i;
+		if (ListView_GetItem(hwndLV, &lvi) && lvi.lParam != 0) {
+			NP2HeapFree(AsPointer<void *>(lvi.lParam));
+		}
+	}
+	ListView_DeleteAllItems(hwndLV);
+}
+
+void FindInFilesUpdateStatus(HWND hwnd, bool running) noexcept {
+	const FindInFilesSearch * const search = pFindInFilesSearch;
+	WCHAR tch[128];
+	if (search != nullptr) {
+		wsprintf(tch, L"%ld hit(s) in %ld file(s)%s", search->hitCount, search->fileCount, running ? L" ..." : L"");
+	} else {
+		tch[0] = L'\0';
+	}
+	SetDlgItemText(hwnd, IDC_FIF_STATUS, tch);
+}
+
+void FindInFilesStart(HWND hwnd) noexcept {
+	FindInFilesStop(hwnd);
+	FindInFilesClearResults(GetDlgItem(hwnd, IDC_FIF_RESULTS));
+
+	WCHAR tchFind[NP2_FIND_REPLACE_LIMIT];
+	GetDlgItemText(hwnd, IDC_FIF_FINDTEXT, tchFind, COUNTOF(tchFind));
+	if (StrIsEmpty(tchFind)) {
+		return;
+	}
+
+	FindInFilesSearch * const search = static_cast<FindInFilesSearch *>(NP2HeapAlloc(sizeof(FindInFilesSearch)));
+	search->hDlg = hwnd;
+	search->needleLength = WideCharToMultiByte(CP_UTF8, 0, tchFind, -1, search->needle, COUNTOF(search->needle), nullptr, nullptr);
+	if (search->needleLength > 0) {
+		search->needleLength -= 1;	// terminating NUL
+	}
+	GetDlgItemText(hwnd, IDC_FIF_DIR, search->directory, COUNTOF(search->directory));
+	GetDlgItemText(hwnd, IDC_FIF_FILTER, search->filter, COUNTOF(search->filter));
+	search->matchCase = IsButtonChecked(hwnd, IDC_FIF_CASE);
+	search->subdirectories = IsButtonChecked(hwnd, IDC_FIF_SUBDIRS);
+	if (search->needleLength == 0 || StrIsEmpty(search->directory) || !PathIsDirectory(search->directory)) {
+		NP2HeapFree(search);
+		return;
+	}
+	if (StrIsEmpty(search->filter)) {
+		lstrcpy(search->filter, L"*.*");
+	}
+
+	SYSTEM_INFO info;
+	GetNativeSystemInfo(&info);
+	search->threadCount = max(1U, min(info.dwNumberOfProcessors, FIF_MaxWorkerCount));
+	InitializeCriticalSection(&search->lock);
+	search->semaphore = CreateSemaphore(nullptr, 0, LONG_MAX, nullptr);
+	search->activeThreadCount = search->threadCount + 1;
+	pFindInFilesSearch = search;
+
+	search->threads[search->threadCount] = CreateThread(nullptr, 0, FindInFilesEnumThread, search, 0, nullptr);
+	for (UINT i = 0; i < search->threadCount; i++) {
+		search->threads[i] = CreateThread(nullptr, 0, FindInFilesWorkerThread, search, 0, nullptr);
+		if (search->threads[i] == nullptr) {
+			// degraded but correct: remaining work is shared by the created threads
+			InterlockedDecrement(&search->activeThreadCount);
+		}
+	}
+	FindInFilesUpdateStatus(hwnd, true);
+}
+
+void FindInFilesOpenSelected(HWND hwnd) noexcept {
+	HWND hwndLV = GetDlgItem(hwnd, IDC_FIF_RESULTS);
+	LVITEM lvi;
+	lvi.mask = LVIF_PARAM;
+	lvi.iItem = ListView_GetNextItem(hwndLV, -1, LVNI_SELECTED);
+	lvi.iSubItem = 0;
+	if (lvi.iItem >= 0 && ListView_GetItem(hwndLV, &lvi) && lvi.lParam != 0) {
+		const FindInFilesHit * const hit = AsPointer<const FindInFilesHit *>(lvi.lParam);
+		if (FileLoad(FileLoadFlag_DontSave, hit->pszPath)) {
+			EditJumpTo(hit->line, 1);
+		}
+	}
+}
+
+int cxFindInFilesDlg;
+int cyFindInFilesDlg;
+
+INT_PTR CALLBACK FindInFilesDlgProc(HWND hwnd, UINT umsg, WPARAM wParam, LPARAM lParam) {
+	switch (umsg) {
+	case WM_INITDIALOG: {
+		ResizeDlg_Init(hwnd, cxFindInFilesDlg, cyFindInFilesDlg, IDC_RESIZEGRIP3);
+
+		HWND hwndLV = GetDlgItem(hwnd, IDC_FIF_RESULTS);
+		InitWindowCommon(hwndLV);
+		ListView_SetExtendedListViewStyle(hwndLV, LVS_EX_FULLROWSELECT | LVS_EX_DOUBLEBUFFER | LVS_EX_LABELTIP);
+		LVCOLUMN lvc;
+		memset(&lvc, 0, sizeof(LVCOLUMN));
+		lvc.mask = LVCF_FMT | LVCF_TEXT | LVCF_WIDTH;
+		lvc.fmt = LVCFMT_LEFT;
+		lvc.pszText = const_cast<LPWSTR>(L"File");
+		lvc.cx = 220;
+		ListView_InsertColumn(hwndLV, 0, &lvc);
+		lvc.fmt = LVCFMT_RIGHT;
+		lvc.pszText = const_cast<LPWSTR>(L"Line");
+		lvc.cx = 50;
+		ListView_InsertColumn(hwndLV, 1, &lvc);
+		lvc.fmt = LVCFMT_LEFT;
+		lvc.pszText = const_cast<LPWSTR>(L"Text");
+		lvc.cx = 320;
+		ListView_InsertColumn(hwndLV, 2, &lvc);
+
+		// default to the directory of the current file
+		WCHAR tchDir[MAX_PATH] = L"";
+		if (StrNotEmpty(szCurFile)) {
+			lstrcpy(tchDir, szCurFile);
+			PathRemoveFileSpec(tchDir);
+		} else {
+			GetCurrentDirectory(COUNTOF(tchDir), tchDir);
+		}
+		SetDlgItemText(hwnd, IDC_FIF_DIR, tchDir);
+		SetDlgItemText(hwnd, IDC_FIF_FILTER, L"*.*");
+		CheckDlgButton(hwnd, IDC_FIF_SUBDIRS, BST_CHECKED);
+		CenterDlgInParent(hwnd);
+	}
+	return TRUE;
+
+	case WM_DESTROY:
+		FindInFilesStop(hwnd);
+		FindInFilesClearResults(GetDlgItem(hwnd, IDC_FIF_RESULTS));
+		ResizeDlg_Destroy(hwnd, &cxFindInFilesDlg, &cyFindInFilesDlg);
+		return FALSE;
+
+	case WM_SIZE: {
+		int dx;
+		int dy;
+
+		ResizeDlg_Size(hwnd, lParam, &dx, &dy);
+
+		HDWP hdwp = BeginDeferWindowPos(6);
+		hdwp = DeferCtlPos(hdwp, hwnd, IDC_RESIZEGRIP3, dx, dy, SWP_NOSIZE);
+		hdwp = DeferCtlPos(hdwp, hwnd, IDOK, dx, 0, SWP_NOSIZE);
+		hdwp = DeferCtlPos(hdwp, hwnd, IDC_FIF_STOP, dx, 0, SWP_NOSIZE);
+		hdwp = DeferCtlPos(hdwp, hwnd, IDC_FIF_BROWSE, dx, 0, SWP_NOSIZE);
+		hdwp = DeferCtlPos(hdwp, hwnd, IDC_FIF_RESULTS, dx, dy, SWP_NOMOVE);
+		hdwp = DeferCtlPos(hdwp, hwnd, IDC_FIF_STATUS, 0, dy, SWP_NOSIZE);
+		EndDeferWindowPos(hdwp);
+
+		ResizeDlgCtl(hwnd, IDC_FIF_FINDTEXT, dx, 0);
+		ResizeDlgCtl(hwnd, IDC_FIF_DIR, dx, 0);
+	}
+	return TRUE;
+
+	case WM_GETMINMAXINFO:
+		ResizeDlg_GetMinMaxInfo(hwnd, lParam);
+		return TRUE;
+
+	case APPM_FIF_RESULT: {
+		FindInFilesHit * const hit = AsPointer<FindInFilesHit *>(lParam);
+		if (pFindInFilesSearch == nullptr) {
+			NP2HeapFree(hit);
+			return TRUE;
+		}
+		HWND hwndLV = GetDlgItem(hwnd, IDC_FIF_RESULTS);
+		LVITEM lvi;
+		memset(&lvi, 0, sizeof(LVITEM));
+		lvi.mask = LVIF_TEXT | LVIF_PARAM;
+		lvi.iItem = ListView_GetItemCount(hwndLV);
+		lvi.pszText = hit->pszPath;
+		lvi.lParam = AsInteger<LPARAM>(hit);
+		const int iItem = ListView_InsertItem(hwndLV, &lvi);
+		if (iItem >= 0) {
+			WCHAR tchLine[32];
+			wsprintf(tchLine, L"%I64d", static_cast<__int64>(hit->line));
+			ListView_SetItemText(hwndLV, iItem, 1, tchLine);
+			ListView_SetItemText(hwndLV, iItem, 2, hit->pszText);
+			if ((iItem & 63) == 0) {
+				FindInFilesUpdateStatus(hwnd, true);
+			}
+		} else {
+			NP2HeapFree(hit);
+		}
+	}
+	return TRUE;
+
+	case APPM_FIF_DONE:
+		if (pFindInFilesSearch != nullptr) {
+			FindInFilesUpdateStatus(hwnd, false);
+			WaitForMultipleObjects(pFindInFilesSearch->threadCount + 1, pFindInFilesSearch->threads, TRUE, INFINITE);
+			FindInFilesFreeSearch();
+		}
+		return TRUE;
+
+	case WM_COMMAND:
+		switch (LOWORD(wParam)) {
+		case IDOK:
+			FindInFilesStart(hwnd);
+			break;
+
+		case IDC_FIF_STOP:
+			FindInFilesStop(hwnd);
+			FindInFilesUpdateStatus(hwnd, false);
+			break;
+
+		case IDC_FIF_BROWSE: {
+			WCHAR tchDir[MAX_PATH];
+			GetDlgItemText(hwnd, IDC_FIF_DIR, tchDir, COUNTOF(tchDir));
+			if (GetDirectory(hwnd, IDS_FINDINFILES, tchDir, tchDir)) {
+				SetDlgItemText(hwnd, IDC_FIF_DIR, tchDir);
+			}
+		}
+		break;
+
+		case IDCANCEL:
+			DestroyWindow(hwnd);
+			break;
+		}
+		return TRUE;
+
+	case WM_NOTIFY: {
+		LPNMHDR pnmhdr = AsPointer<LPNMHDR>(lParam);
+		if (pnmhdr->idFrom == IDC_FIF_RESULTS && (pnmhdr->code == NM_DBLCLK || pnmhdr->code == LVN_ITEMACTIVATE)) {
+			FindInFilesOpenSelected(hwnd);
+		}
+	}
+	break;
+	}
+
+	return FALSE;
+}
+
+}
+
+//=============================================================================
+//
+// EditFindInFilesDlg()
+//
+HWND EditFindInFilesDlg(HWND hwnd) noexcept {
+	HWND hDlg = CreateThemedDialogParam(g_hInstance,
+								   MAKEINTRESOURCE(IDD_FINDINFILES),
+								   GetParent(hwnd),
+								   FindInFilesDlgProc, 0);
+
+	ShowWindow(hDlg, SW_SHOW);
+	return hDlg;
+}
@@ -24,6 +24,9 @@
 
 #define NP2_FIND_REPLACE_LIMIT	2048
 #define NP2_LONG_LINE_LIMIT		4096
+// line length in bytes (including the line ending) at or above which FileLoad()
+// flips mitigations for pathological long line documents.
+#define NP2_LONG_LINE_MITIGATION_LIMIT	(64*1024)
 
 #define NP2_InvalidSearchFlags	(-1)
 #define NP2_MarkAllMultiline	0x00001000
@@ -128,6 +131,9 @@ void	EditReplaceDocument(HANDLE pdoc) noexcept;
 
 char*	EditGetClipboardText(HWND hwnd) noexcept; // LocalFree()
 bool	EditCopyAppend(HWND hwnd) noexcept;
+void	EditCopyAppendRender(UINT format) noexcept;
+void	EditCopyAppendRenderAll(HWND hwnd) noexcept;
+void	EditCopyAppendDestroy() noexcept;
 
 constexpr int GetScintillaEOLMode(int mode) noexcept {
 	constexpr UINT mask = (SC_EOL_CRLF << 2*0) | (SC_EOL_LF << 2*1) | (SC_EOL_CR << 2*2);
@@ -142,6 +148,13 @@ struct EditFileIOStatus;
 void 	EditDetectEOLMode(LPCSTR lpData, DWORD cbData, EditFileIOStatus &status) noexcept;
 bool	EditLoadFile(LPWSTR pszFile, EditFileIOStatus &status) noexcept;
 bool	EditSaveFile(HWND hwnd, LPCWSTR pszFile, int saveFlag, EditFileIOStatus &status) noexcept;
+void	EditMarkDirtyRange(Sci_Position position, Sci_Position changeEnd) noexcept;
+void	EditResetSavedFileState() noexcept;
+bool	EditMergeDiskChanges(LPCWSTR pszFile) noexcept;
+void	EditSaveStyleCache(LPCWSTR pszFile) noexcept;
+bool	EditRestoreStyleCache(LPCWSTR pszFile) noexcept;
+void	EditSaveUndoHistory(LPCWSTR pszFile) noexcept;
+bool	EditRestoreUndoHistory(LPCWSTR pszFile) noexcept;
 
 void	EditReplaceMainSelection(Sci_Position cchText, LPCSTR pszText) noexcept;
 void	EditMapTextCase(int menu) noexcept;
@@ -155,6 +168,9 @@ void	EditUnescapeXHTMLChars(HWND hwnd) noexcept;
 void	EditChar2Hex() noexcept;
 void	EditHex2Char() noexcept;
 void	EditShowHex() noexcept;
+extern bool bHexViewMode;
+void	EditToggleHexView() noexcept;
+void	EditHexViewFollowScroll() noexcept;
 
 enum Base64EncodingFlag {
 	Base64EncodingFlag_Default,
@@ -185,6 +201,7 @@ void	EditRemoveBlankLines(bool bMerge) noexcept;
 void	EditWrapToColumn(int nColumn/*, int nTabWidth*/) noexcept;
 void	EditJoinLinesEx() noexcept;
 void	EditSortLines(EditSortFlag iSortFlags) noexcept;
+void	EditShowDocumentStatistics(DWORD docReversion) noexcept;
 
 void	EditJumpTo(Sci_Line iNewLine, Sci_Position iNewCol) noexcept;
 void	EditSelectEx(Sci_Position iAnchorPos, Sci_Position iCurrentPos) noexcept;
@@ -196,7 +213,12 @@ void	EditGetExcerpt(LPWSTR lpszExcerpt, DWORD cchExcerpt) noexcept;
 void	EditSelectWord() noexcept;
 void	EditSelectLines(bool currentBlock, bool lineSelection) noexcept;
 void	EditSaveSelectionAsFindText(EDITFINDREPLACE *lpefr, int menu, bool findSelection) noexcept;
+void	EditSavedSearchAdd(EDITFINDREPLACE *lpefr) noexcept;
+void	EditSavedSearchMenu(HWND hwnd) noexcept;
+void	EditSavedSearchInvoke(EDITFINDREPLACE *lpefr, int index) noexcept;
+void	EditMarkAllSavedSearches() noexcept;
 HWND	EditFindReplaceDlg(HWND hwnd, EDITFINDREPLACE *lpefr, bool bReplace) noexcept;
+HWND	EditFindInFilesDlg(HWND hwnd) noexcept;
 void	EditFindNext(const EDITFINDREPLACE *lpefr, bool fExtendSelection) noexcept;
 void	EditFindPrev(const EDITFINDREPLACE *lpefr, bool fExtendSelection) noexcept;
 void	EditFindAll(const EDITFINDREPLACE *lpefr, bool selectAll) noexcept;
@@ -243,6 +265,10 @@ enum {
 	IndicatorNumber_MarkOccurrence = INDICATOR_CONTAINER + 0,
 	IndicatorNumber_MatchBrace = INDICATOR_CONTAINER + 1,
 	IndicatorNumber_MatchBraceError = INDICATOR_CONTAINER + 2,
+	IndicatorNumber_SpellCheck = INDICATOR_CONTAINER + 3,
+	// rotating color palette for marking all saved searches at once
+	IndicatorNumber_MultiPatternMark = INDICATOR_CONTAINER + 4,
+	MultiPatternMarkCount = 8,
 	// [INDICATOR_IME, INDICATOR_IME_MAX] are reserved for IME.
 
 	MarginNumber_LineNumber = 0,
@@ -273,6 +299,13 @@ struct EditMarkAll {
 	Sci_Position lastMatchPos;	// last matching position
 	Sci_Position prevStopPos;	// previous stop position
 	Sci_Line prevBookmarkLine;	// previous bookmark line
+	Sci_Position dirtyStartPos;	// document range modified since last scan
+	Sci_Position dirtyEndPos;
+	Sci_Position visibleMarkedStart;	// band already marked by MarkVisible()
+	Sci_Position visibleMarkedEnd;
+	Sci_Position *positions;	// sorted match positions for incremental rescan
+	Sci_Position positionCount;	// negative when the cache overflowed
+	Sci_Position positionCapacity;
 	StopWatch watch;			// used to dynamic compute increment size
 
 	void Reset(int findFlag, Sci_Position iSelCount, LPSTR text) noexcept;
@@ -280,9 +313,13 @@ struct EditMarkAll {
 		Reset(0, 0, nullptr);
 	}
 	void Start(BOOL bChanged, int findFlag, Sci_Position iSelCount, LPSTR text) noexcept;
+	void MarkVisible() noexcept;
 	void Continue(HANDLE timer) noexcept;
 	void Stop() noexcept;
 	void MarkAll(BOOL bChanged, int option) noexcept;
+	void OnModified(Sci_Position position, Sci_Position changeEnd, Sci_Position delta) noexcept;
+	void CachePosition(Sci_Position pos) noexcept;
+	bool Rescan() noexcept;
 };
 
 void EditToggleBookmarkAt(Sci_Position iPos) noexcept;
@@ -392,6 +429,8 @@ void	EditCompleteUpdateConfig() noexcept;
 bool	IsDocWordChar(uint32_t ch) noexcept;
 bool	IsAutoCompletionWordCharacter(uint32_t ch) noexcept;
 void	EditCompleteWord(int iCondition, bool autoInsert) noexcept;
+void	EditCompleteWordInvalidateCache(Sci_Position position, Sci_Position length, bool insertion) noexcept;
+size_t	EditCompleteWordCacheBytes() noexcept;
 bool	EditIsOpenBraceMatched(Sci_Position pos, Sci_Position startPos) noexcept;
 void	EditAutoCloseBraceQuote(int ch, AutoInsertCharacter what) noexcept;
 void	EditAutoCloseXMLTag() noexcept;
@@ -644,6 +683,9 @@ extern EditFileVars fvCurFile;
 
 void	EditSetWrapStartIndent(int tabWidth, int indentWidth) noexcept;
 void	EditSetWrapIndentMode(int tabWidth, int indentWidth) noexcept;
+void	EditElasticTabStops(bool enable) noexcept;
+void	EditElasticTabStopsRefresh(bool scrollOnly) noexcept;
+void	EditElasticTabStopsOnNewDocument() noexcept;
 bool	FileVars_ParseInt(LPCSTR pszData, LPCSTR pszName, int *piValue) noexcept;
 bool	FileVars_ParseStr(LPCSTR pszData, LPCSTR pszName, char *pszValue, int cchValue) noexcept;
 
@@ -653,6 +695,35 @@ enum FOLD_ACTION {
 	FOLD_ACTION_SNIFF	= SC_FOLDACTION_TOGGLE,
 };
 
+// Hierarchical navigation index built from the lexer's fold levels: the
+// sorted list of fold header lines with their level numbers. Block
+// navigation and level folding commands used to rescan the fold level of
+// every line on each invocation; they now share this index, rebuilt in one
+// pass after the document or lexer changed.
+struct FoldOutline {
+	struct Node {
+		Sci_Line line;
+		int level;		// SC_FOLDLEVELNUMBERMASK part only
+	};
+
+	Node *nodes;
+	Sci_Line count;
+	Sci_Line capacity;
+	bool valid;
+
+	void Invalidate() noexcept {
+		valid = false;
+	}
+	void Empty() noexcept;
+	void Build() noexcept;
+	// index of the last header at or before line, -1 when none
+	Sci_Line IndexBefore(Sci_Line line) const noexcept;
+	// index of the header whose block contains line, -1 when none
+	Sci_Line ParentIndex(Sci_Line line, int levelNum) const noexcept;
+};
+
+extern FoldOutline foldOutline;
+
 void FoldExpandRange(Sci_Line lineStart, Sci_Line lineEnd) noexcept;
 void FoldToggleAll(FOLD_ACTION action) noexcept;
 void FoldToggleLevel(int lev, FOLD_ACTION action) noexcept;
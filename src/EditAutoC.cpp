@@ -13,6 +13,7 @@ struct IUnknown;
 #include "VectorISA.h"
 #include "Helpers.h"
 #include "Edit.h"
+#include "EditSpell.h"
 #include "Styles.h"
 #include "resource.h"
 #include "EditAutoC_Data0.h"
@@ -23,6 +24,7 @@ struct IUnknown;
 #define NP2_AUTOC_MAX_WORD_LENGTH	(128 - 3 - 1)	// SP + '(' + ')' + '\0'
 #define NP2_AUTOC_WORD_BUFFER_SIZE	128
 #define NP2_AUTOC_INIT_BUFFER_SIZE	(4096)
+#define NP2_AUTOC_MAX_LIST_COUNT	1024
 
 // optimization for small string
 template <size_t StackSize = 32>
@@ -82,7 +84,7 @@ struct WordList {
 	void Free() const noexcept;
 	char *GetList() const noexcept;
 	void AddBuffer() noexcept;
-	void AddWord(LPCSTR pWord, UINT len) noexcept;
+	void AddWord(LPCSTR pWord, UINT len, UINT count = 1) noexcept;
 	void UpdateRoot(LPCSTR pRoot, UINT iRootLen) noexcept;
 	bool StartsWith(LPCSTR pWord) const noexcept;
 	void AddListEx(LPCSTR pList) noexcept;
@@ -92,6 +94,7 @@ struct WordList {
 		}
 	}
 	void AddSubWord(LPSTR pWord, UINT wordLength, UINT iRootLen) noexcept;
+	void AddTreeMatched(const WordList &other) noexcept;
 };
 
 // TODO: replace _stricmp() and _strnicmp() with other functions
@@ -170,13 +173,13 @@ struct WordNode {
 #endif
 	UINT len;
 	UINT level;
+	UINT count;	// use count, how often the word occurs in the scanned text
 };
 
 #define NP2_TREE_HEIGHT_LIMIT	32
 // store word right after the node as most word are short.
 #define WordNode_GetWord(node)		(reinterpret_cast<char *>(node) + sizeof(WordNode))
 // TODO: since the tree is sorted, nodes greater than some level can be deleted to reduce total words.
-// or only limit word count in WordList::GetList().
 
 // Andersson Tree, source from https://www.eternallyconfuzzled.com/tuts/datastructures/jsw_tut_andersson.aspx
 // see also https://en.wikipedia.org/wiki/AA_tree
@@ -204,7 +207,7 @@ void WordList::AddBuffer() noexcept {
 	buffer = block;
 }
 
-void WordList::AddWord(LPCSTR pWord, UINT len) noexcept {
+void WordList::AddWord(LPCSTR pWord, UINT len, UINT count) noexcept {
 	WordNode *root = pListHead;
 #if NP2_AUTOC_CACHE_SORT_KEY
 	const UINT sortKey = (iStartLen > NP2_AUTOC_SORT_KEY_LENGTH) ? 0 : WL_SortKeyFunc(pWord, len);
@@ -221,6 +224,7 @@ void WordList::AddWord(LPCSTR pWord, UINT len) noexcept {
 #endif
 		node->len = len;
 		node->level = 1;
+		node->count = count;
 		root = node;
 	} else {
 		WordNode *iter = root;
@@ -240,6 +244,7 @@ void WordList::AddWord(LPCSTR pWord, UINT len) noexcept {
 			dir = WL_strcmp(WordNode_GetWord(iter), pWord);
 #endif
 			if (dir == 0) {
+				iter->count += count;
 				return;
 			}
 			dir = dir < 0;
@@ -265,6 +270,7 @@ void WordList::AddWord(LPCSTR pWord, UINT len) noexcept {
 #endif
 		node->len = len;
 		node->level = 1;
+		node->count = count;
 		iter->link[dir] = node;
 
 		// walk back and rebalance
@@ -306,15 +312,51 @@ char* WordList::GetList() const noexcept {
 	char *buf = static_cast<char *>(NP2HeapAlloc(nTotalLen + 1));// additional separator
 	char * const pList = buf;
 
+	// Limit an oversized list to the most used words instead of building a list
+	// box with every candidate: select the use count cutoff from a saturated
+	// histogram, no sorting. Words are emitted in tree order so the list stays
+	// sorted for SC_ORDER_PRESORTED, and the list is rebuilt from the full tree
+	// on the next typed character, so pruned words remain reachable.
+	UINT cutoff = 0;
+	UINT ties = UINT_MAX;
+	if (nWordCount > NP2_AUTOC_MAX_LIST_COUNT) {
+		UINT histogram[256]{};
+		while (root || top > 0) {
+			if (root) {
+				path[top++] = root;
+				root = root->left;
+			} else {
+				root = path[--top];
+				histogram[min<UINT>(root->count, 255)] += 1;
+				root = root->right;
+			}
+		}
+		UINT remain = NP2_AUTOC_MAX_LIST_COUNT;
+		UINT bucket = 255;
+		while (histogram[bucket] < remain) {
+			remain -= histogram[bucket];
+			--bucket;
+		}
+		cutoff = bucket;
+		ties = remain;
+		root = pListHead;
+	}
+
 	while (root || top > 0) {
 		if (root) {
 			path[top++] = root;
 			root = root->left;
 		} else {
 			root = path[--top];
-			memcpy(buf, WordNode_GetWord(root), root->len);
-			buf += root->len;
-			*buf++ = '\n'; // the separator char
+			const UINT count = min<UINT>(root->count, 255);
+			if (count > cutoff || (count == cutoff && ties != 0)) {
+				if (count == cutoff) {
+					--ties;
+				}
+				memcpy(buf, WordNode_GetWord(root), root->len);
+				buf += root->len;
+				*buf++ = '\n'; // the separator char
+			}
 			root = root->right;
 		}
 	}
@@ -413,13 +455,34 @@ static constexpr bool WordList_IsSeparator(uint8_t ch) noexcept {
 #endif
 }
 
-void WordList::AddListEx(LPCSTR pList) noexcept {
-	//StopWatch watch;
-	//watch.Start();
+// Parsed keyword list cache.
+// Every list passed to AddListEx() is a static keyword string from the lexer
+// tables, so each list is tokenized only once per session: the candidate
+// words (with the "()" and dotted chain expansions already applied) are
+// packed into a length-prefixed blob keyed by the address of the source
+// string, and every popup just replays the blob through the root filter.
+struct WordListBlob {
+	LPCSTR pList;	// source keyword string
+	char *words;	// (uint8_t)len, word, '\0' entries in source order
+	UINT size;		// used bytes
+};
+
+static struct {
+	WordListBlob *items;
+	UINT count;
+	UINT capacity;
+} wordListBlobCache;
+
+static void WordListBlob_Parse(WordListBlob &blob, LPCSTR pList) noexcept {
+	// same tokenization as the previous AddListEx(), the accumulation of
+	// dotted chains and "()" never depended on the typed root, only the
+	// final add did, so the blob is valid for any root.
+	UINT capacity = NP2_AUTOC_INIT_BUFFER_SIZE;
+	char *words = static_cast<char *>(NP2HeapAlloc(capacity));
+	UINT size = 0;
+
 	char word[NP2_AUTOC_WORD_BUFFER_SIZE];
-	const UINT iRootLen = iStartLen;
 	UINT len = 0;
-	bool ok = false;
 	while (true) {
 		uint8_t ch;
 		LPCSTR sub = pList;
@@ -432,16 +495,19 @@ void WordList::AddListEx(LPCSTR pList) noexcept {
 		memcpy(word + len, pList, lenSub);
 		len += lenSub;
 		pList = sub;
-		if (len >= iRootLen) {
+		if (len != 0) {
 			if (ch == '(') {
 				word[len++] = '(';
 				word[len++] = ')';
 			}
-			word[len] = '\0';
-			if (ok || StartsWith(word)) {
-				AddWord(word, len);
-				ok = ch == '.';
+			if (size + len + 2 > capacity) {
+				capacity <<= 1;
+				words = static_cast<char *>(NP2HeapReAlloc(words, capacity));
 			}
+			words[size++] = static_cast<char>(len);
+			memcpy(words + size, word, len);
+			size += len;
+			words[size++] = '\0';
 		}
 		if (ch == '\0') {
 			break;
@@ -449,13 +515,64 @@ void WordList::AddListEx(LPCSTR pList) noexcept {
 		if (ch == '^') {
 			// ^ is used for prefix match in lexer (see scintilla/lexlib/WordList.cxx)
 			word[len++] = ' ';
-		} else if (!ok && ch != '.') {
+		} else if (ch != '.') {
 			len = 0;
 		} else {
 			word[len++] = '.';
 		}
 	}
 
+	blob.words = words;
+	blob.size = size;
+}
+
+static const WordListBlob *WordListBlob_Get(LPCSTR pList) noexcept {
+	WordListBlob *items = wordListBlobCache.items;
+	for (UINT i = 0; i < wordListBlobCache.count; i++) {
+		if (items[i].pList == pList) {
+			return &items[i];
+		}
+	}
+
+	if (wordListBlobCache.count == wordListBlobCache.capacity) {
+		const UINT capacity = (wordListBlobCache.capacity == 0) ? 64 : wordListBlobCache.capacity * 2;
+		items = static_cast<WordListBlob *>(items
+			? NP2HeapReAlloc(items, capacity * sizeof(WordListBlob))
+			: NP2HeapAlloc(capacity * sizeof(WordListBlob)));
+		wordListBlobCache.items = items;
+		wordListBlobCache.capacity = capacity;
+	}
+
+	WordListBlob * const blob = &items[wordListBlobCache.count++];
+	blob->pList = pList;
+	WordListBlob_Parse(*blob, pList);
+	return blob;
+}
+
+size_t EditCompleteWordCacheBytes() noexcept {
+	size_t bytes = wordListBlobCache.capacity * sizeof(WordListBlob);
+	const WordListBlob * const items = wordListBlobCache.items;
+	for (UINT i = 0; i < wordListBlobCache.count; i++) {
+		bytes += NP2HeapSize(items[i].words);
+	}
+	return bytes;
+}
+
+void WordList::AddListEx(LPCSTR pList) noexcept {
+	//StopWatch watch;
+	//watch.Start();
+	const WordListBlob * const blob = WordListBlob_Get(pList);
+	const char *ptr = blob->words;
+	const char * const end = ptr + blob->size;
+	const UINT iRootLen = iStartLen;
+	while (ptr < end) {
+		const UINT len = static_cast<uint8_t>(*ptr++);
+		if (len >= iRootLen && StartsWith(ptr)) {
+			AddWord(ptr, len);
+		}
+		ptr += len + 1;
+	}
+
 	//watch.Stop();
 	//const double duration = watch.Get();
 	//printf("%s duration=%.6f\n", __func__, duration);
@@ -504,6 +621,91 @@ void WordList::AddSubWord(LPSTR pWord, UINT wordLength, UINT iRootLen) noexcept
 	}
 }
 
+void WordList::AddTreeMatched(const WordList &other) noexcept {
+	WordNode *root = other.pListHead;
+	WordNode *path[NP2_TREE_HEIGHT_LIMIT]{};
+	int top = 0;
+
+	while (root || top > 0) {
+		if (root) {
+			path[top++] = root;
+			root = root->left;
+		} else {
+			root = path[--top];
+			LPCSTR word = WordNode_GetWord(root);
+			if (root->len >= iStartLen && StartsWith(word)) {
+				AddWord(word, root->len, root->count);
+			}
+			root = root->right;
+		}
+	}
+}
+
+// Word list from the previous completion popup, kept alive (arena and all)
+// across keystrokes. While the user keeps typing the same word, the new root
+// extends the old one, so the next list is a subset of the cached tree and
+// can be built by filtering it instead of rescanning the whole document.
+// Any modification outside the word being completed throws the cache away.
+namespace {
+
+struct DocWordCache {
+	WordList wordList;
+	Sci_Position wordStartPos;
+	bool valid;
+	bool ignoreCase;
+	char prefix;
+	uint32_t ignoredStyleMask[8];
+	char root[NP2_AUTOC_WORD_BUFFER_SIZE];
+
+	bool Usable(const WordList &pWList, const uint32_t (&styleMask)[8], bool bIgnoreCase, char chPrefix, Sci_Position iStartWordPos) const noexcept {
+		return valid
+			&& ignoreCase == bIgnoreCase
+			&& prefix == chPrefix
+			&& wordStartPos == iStartWordPos
+			&& pWList.iStartLen >= wordList.iStartLen
+			&& memcmp(ignoredStyleMask, styleMask, sizeof(ignoredStyleMask)) == 0
+			&& pWList.WL_strncmp(root, pWList.pWordStart, wordList.iStartLen) == 0;
+	}
+
+	void Invalidate() noexcept {
+		if (valid) {
+			valid = false;
+			wordList.Free();
+		}
+	}
+
+	void Update(const WordList &pWList, const uint32_t (&styleMask)[8], bool bIgnoreCase, char chPrefix, Sci_Position iStartWordPos) noexcept {
+		Invalidate();
+		if (pWList.iStartLen >= NP2_AUTOC_WORD_BUFFER_SIZE) {
+			pWList.Free();
+			return;
+		}
+		wordList = pWList;
+		ignoreCase = bIgnoreCase;
+		prefix = chPrefix;
+		wordStartPos = iStartWordPos;
+		memcpy(ignoredStyleMask, styleMask, sizeof(ignoredStyleMask));
+		memcpy(root, pWList.pWordStart, pWList.iStartLen);
+		root[pWList.iStartLen] = '\0';
+		wordList.pWordStart = root;
+		valid = true;
+	}
+};
+
+DocWordCache docWordCache;
+
+}
+
+void EditCompleteWordInvalidateCache(Sci_Position position, Sci_Position length, bool insertion) noexcept {
+	if (docWordCache.valid) {
+		// typing inside the word being completed keeps the cached tree a superset
+		if (!(insertion && length != 0
+			&& position >= docWordCache.wordStartPos
+			&& position <= docWordCache.wordStartPos + docWordCache.wordList.iStartLen)) {
+			docWordCache.Invalidate();
+		}
+	}
+}
 
 static constexpr bool IsCppCommentStyle(int style) noexcept {
 	return style == SCE_C_COMMENT
@@ -590,6 +792,13 @@ static inline bool IsCommentStyle(int style) noexcept {
 	return BitTestEx(CommentStyleMask, style);
 }
 
+// see EditSpell.h: the spell checker only looks at prose styles
+void EditSpellGetCheckableStyles(uint32_t (&styleMask)[8]) noexcept {
+	for (unsigned i = 0; i < COUNTOF(styleMask); i++) {
+		styleMask[i] = CommentStyleMask[i] | AllStringStyleMask[i] | PlainTextStyleMask[i];
+	}
+}
+
 bool IsAutoCompletionWordCharacter(uint32_t ch) noexcept {
 	if (ch < 0x80) {
 		return IsDocWordChar(ch);
@@ -1675,18 +1884,25 @@ static bool EditCompleteWordCore(int iCondition, bool autoInsert) noexcept {
 		}
 	}
 
+	bool fromCache = docWordCache.Usable(pWList, ignoredStyleMask, bIgnoreCase, prefix, iStartWordPos);
 	while (retry) {
-		if (!bIgnoreLexer) {
-			// keywords
-			AutoC_AddKeyword(pWList, iCurrentStyle);
-		}
-		if (bScanWordsInDocument) {
-			if (!bIgnoreDoc || pWList.nWordCount == 0) {
-				AutoC_AddDocWord(pWList, ignoredStyleMask, bIgnoreCase, prefix);
+		if (fromCache) {
+			// the tree from the previous keystroke is a superset: filter it
+			// by the extended root instead of rescanning the whole document.
+			pWList.AddTreeMatched(docWordCache.wordList);
+		} else {
+			if (!bIgnoreLexer) {
+				// keywords
+				AutoC_AddKeyword(pWList, iCurrentStyle);
 			}
-			if (prefix && pWList.nWordCount == 0) {
-				prefix = '\0';
-				AutoC_AddDocWord(pWList, ignoredStyleMask, bIgnoreCase, prefix);
+			if (bScanWordsInDocument) {
+				if (!bIgnoreDoc || pWList.nWordCount == 0) {
+					AutoC_AddDocWord(pWList, ignoredStyleMask, bIgnoreCase, prefix);
+				}
+				if (prefix && pWList.nWordCount == 0) {
+					prefix = '\0';
+					AutoC_AddDocWord(pWList, ignoredStyleMask, bIgnoreCase, prefix);
+				}
 			}
 		}
 
@@ -1701,6 +1917,7 @@ static bool EditCompleteWordCore(int iCondition, bool autoInsert) noexcept {
 					iRootLen = static_cast<int>(strlen(pSubRoot));
 					pWList.UpdateRoot(pSubRoot, iRootLen);
 					retry = true;
+					fromCache = false;
 					bIgnoreLexer = false;
 					bIgnoreDoc = false;
 					prefix = '\0';
@@ -1740,7 +1957,9 @@ static bool EditCompleteWordCore(int iCondition, bool autoInsert) noexcept {
 		NP2HeapFree(pList);
 	}
 
-	pWList.Free();
+	// keep the tree (arena and all) for the next keystroke at the same word
+	docWordCache.Update(pWList, ignoredStyleMask, bIgnoreCase, prefix,
+		iStartWordPos + (pWList.pWordStart - pRoot.data()));
 	return bShow;
 }
 
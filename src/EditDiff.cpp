@@ -0,0 +1,898 @@
+/******************************************************************************
+*
+*
+* Notepad4
+*
+* EditDiff.cpp
+*   Side-by-side diff view. The current document is compared against a
+*   second file loaded into a companion Scintilla view; both views scroll
+*   in step through the diff mapping. The diff itself is a line-level
+*   patience/Myers hybrid over per-line hashes, computed on a worker thread
+*   and re-run incrementally over a small window around each modification.
+*   Also hosts the git change margin: on open and save the buffer is diffed
+*   against the file's HEAD content (read through a git child process on a
+*   worker thread) and the blocks become modified/added margin markers.
+*
+* See License.txt for details about distribution and modification.
+*
+******************************************************************************/
+
+struct IUnknown;
+#include <windows.h>
+#include <shlwapi.h>
+#include <uxtheme.h>
+#include <cstdint>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "SciCall.h"
+#include "ILoader.h"
+#include "Helpers.h"
+#include "Notepad4.h"
+#include "Edit.h"
+#include "EditDiff.h"
+#include "EditPageView.h"
+#include "Dialogs.h"
+#include "resource.h"
+
+extern HWND hwndMain;
+extern HWND hwndEdit;
+extern DWORD dwLastIOError;
+extern bool bVcsChangeMarkers;
+
+HWND hwndDiffView = nullptr;
+
+namespace {
+
+enum {
+	// [1, SC_MARKNUM_HISTORY_REVERTED_TO_ORIGIN) is free, see MarkerNumber_Bookmark
+	MarkerNumber_VcsAdded = 16,		// line absent from the git HEAD content
+	MarkerNumber_VcsModified = 17,	// line differs from the git HEAD content
+	MarkerNumber_DiffChanged = 18,	// line differs from the other side
+	MarkerNumber_DiffUnique = 19,	// line has no counterpart on the other side
+};
+
+constexpr COLORREF vcsColorAdded = RGB(0x00, 0xA0, 0x00);
+constexpr COLORREF vcsColorModified = RGB(0xE2, 0xA1, 0x00);
+
+constexpr COLORREF diffColorChanged = RGB(0xFF, 0xF2, 0xC0);
+constexpr COLORREF diffColorUnique = RGB(0xCD, 0xEF, 0xCD);
+
+constexpr UINT diffRecomputeDelay = 40;		// ms, coalesces a burst of keystrokes into one re-diff
+constexpr Sci_Line maxMyersD = 1024;		// Myers budget before falling back to patience splitting
+constexpr int maxPatienceDepth = 24;
+
+// half-open block of differing lines; leftStart == leftEnd marks lines only
+// present on the right and vice versa. Kept sorted and disjoint on both sides.
+struct DiffChange {
+	Sci_Line leftStart;
+	Sci_Line leftEnd;
+	Sci_Line rightStart;
+	Sci_Line rightEnd;
+};
+
+struct DiffState {
+	std::vector<uint32_t> hashes[2];	// per-line content hashes, EOL excluded
+	std::vector<DiffChange> changes;
+	Sci_Line dirtyMin;					// modified lines (left coordinates) since the last job
+	Sci_Line dirtyMax;
+	UINT generation;					// stamps jobs; bumped on job launch and on close
+};
+
+// a re-diff computed on a worker thread: either a full rebuild from two
+// document snapshots, or a windowed re-diff over slices of the hash arrays.
+struct DiffJob {
+	UINT generation;
+	bool fullRebuild;
+	Scintilla::ITextSnapshot *snapshot[2];	// full rebuild input, released by the worker
+	std::vector<uint32_t> hashes[2];		// full rebuild output; window slices otherwise
+	Sci_Line windowStart[2];
+	Sci_Line windowEnd[2];
+	std::vector<DiffChange> changes;		// result, document coordinates
+};
+
+DiffState diffState;
+HANDLE diffViewSci = nullptr;				// direct pointer for the comparison view
+bool diffSyncLock = false;
+volatile LONG diffJobRunning = FALSE;
+
+// left side goes through the global direct pointer like the rest of the
+// program, the comparison view through its own.
+inline LRESULT SideCall(int side, UINT msg, WPARAM wParam = 0, LPARAM lParam = 0) noexcept {
+	return Scintilla_DirectFunction(side ? diffViewSci : g_hScintilla, msg, wParam, lParam);
+}
+
+constexpr uint32_t hashSeed = 2166136261U;
+
+constexpr uint32_t HashChar(uint32_t hash, uint8_t ch) noexcept {
+	return (hash ^ ch) * 16777619U;
+}
+
+// FNV-1a per line with the EOL characters excluded, so the two sides may use
+// different line endings without every line differing. Emits exactly count
+// hashes when count is non-negative, otherwise one per line including the
+// final line after the last EOL (matching Scintilla's line count).
+void HashLines(const char *text, Sci_Position length, Sci_Line count, std::vector<uint32_t> &hashes) {
+	uint32_t hash = hashSeed;
+	Sci_Position i = 0;
+	while (i < length) {
+		const uint8_t ch = text[i++];
+		if (ch == '\n' || ch == '\r') {
+			if (ch == '\r' && i < length && text[i] == '\n') {
+				++i;
+			}
+			hashes.push_back(hash);
+			hash = hashSeed;
+			if (count >= 0 && static_cast<Sci_Line>(hashes.size()) == count) {
+				return;
+			}
+		} else {
+			hash = HashChar(hash, ch);
+		}
+	}
+	if (count < 0 || static_cast<Sci_Line>(hashes.size()) < count) {
+		hashes.push_back(hash);
+	}
+	while (count >= 0 && static_cast<Sci_Line>(hashes.size()) < count) {
+		hashes.push_back(hashSeed);
+	}
+}
+
+void AppendChangeUnit(std::vector<DiffChange> &changes, const DiffChange &unit) {
+	// units arrive adjacent while backtracking, fold them into blocks
+	if (!changes.empty()) {
+		DiffChange &prev = changes.back();
+		if (unit.leftEnd == prev.leftStart && unit.rightEnd == prev.rightStart) {
+			prev.leftStart = unit.leftStart;
+			prev.rightStart = unit.rightStart;
+			return;
+		}
+	}
+	changes.push_back(unit);
+}
+
+// classic greedy O(ND) Myers diff with a budget; returns false when the edit
+// distance exceeds the budget and the caller should split the window instead.
+bool MyersDiff(const uint32_t *a, Sci_Line n, const uint32_t *b, Sci_Line m,
+	Sci_Line offA, Sci_Line offB, std::vector<DiffChange> &changes) {
+	const Sci_Line maxD = min(n + m, maxMyersD);
+	std::vector<Sci_Line> v(2*maxD + 2, 0);
+	std::vector<std::vector<Sci_Line>> trace;
+	Sci_Line dFound = -1;
+	for (Sci_Line d = 0; d <= maxD && dFound < 0; d++) {
+		for (Sci_Line k = -d; k <= d; k += 2) {
+			Sci_Line x;
+			if (k == -d || (k != d && v[k - 1 + maxD] < v[k + 1 + maxD])) {
+				x = v[k + 1 + maxD];
+			} else {
+				x = v[k - 1 + maxD] + 1;
+			}
+			Sci_Line y = x - k;
+			while (x < n && y < m && a[x] == b[y]) {
+				++x;
+				++y;
+			}
+			v[k + maxD] = x;
+			if (x >= n && y >= m) {
+				dFound = d;
+				break;
+			}
+		}
+		trace.push_back(v);
+	}
+	if (dFound < 0) {
+		return false;
+	}
+
+	Sci_Line x = n;
+	Sci_Line y = m;
+	std::vector<DiffChange> reversed;
+	for (Sci_Line d = dFound; d > 0; d--) {
+		const std::vector<Sci_Line> &vp = trace[d - 1];
+		const Sci_Line k = x - y;
+		Sci_Line prevK;
+		if (k == -d || (k != d && vp[k - 1 + maxD] < vp[k + 1 + maxD])) {
+			prevK = k + 1;
+		} else {
+			prevK = k - 1;
+		}
+		const Sci_Line prevX = vp[prevK + maxD];
+		const Sci_Line prevY = prevX - prevK;
+		if (prevK == k + 1) {
+			// down move: b[prevY] has no counterpart in a
+			AppendChangeUnit(reversed, { offA + prevX, offA + prevX, offB + prevY, offB + prevY + 1 });
+		} else {
+			// right move: a[prevX] has no counterpart in b
+			AppendChangeUnit(reversed, { offA + prevX, offA + prevX + 1, offB + prevY, offB + prevY });
+		}
+		x = prevX;
+		y = prevY;
+	}
+	changes.insert(changes.end(), reversed.rbegin(), reversed.rend());
+	return true;
+}
+
+struct HashRef {
+	uint32_t hash;
+	Sci_Line index;
+};
+
+struct Anchor {
+	Sci_Line left;
+	Sci_Line right;
+};
+
+// pairs of lines whose hash occurs exactly once on each side,
+// sorted by the left index.
+void UniqueCommonLines(const uint32_t *a, Sci_Line n, const uint32_t *b, Sci_Line m, std::vector<Anchor> &anchors) {
+	std::vector<HashRef> ha(n);
+	std::vector<HashRef> hb(m);
+	for (Sci_Line i = 0; i < n; i++) {
+		ha[i] = { a[i], i };
+	}
+	for (Sci_Line i = 0; i < m; i++) {
+		hb[i] = { b[i], i };
+	}
+	constexpr auto cmp = [](const HashRef &lhs, const HashRef &rhs) noexcept {
+		return lhs.hash < rhs.hash;
+	};
+	std::sort(ha.begin(), ha.end(), cmp);
+	std::sort(hb.begin(), hb.end(), cmp);
+	Sci_Line i = 0;
+	Sci_Line j = 0;
+	while (i < n && j < m) {
+		const uint32_t hash = ha[i].hash;
+		if (hash < hb[j].hash) {
+			++i;
+		} else if (hash > hb[j].hash) {
+			++j;
+		} else {
+			const Sci_Line i2 = i;
+			const Sci_Line j2 = j;
+			while (i < n && ha[i].hash == hash) {
+				++i;
+			}
+			while (j < m && hb[j].hash == hash) {
+				++j;
+			}
+			if (i - i2 == 1 && j - j2 == 1) {
+				anchors.push_back({ ha[i2].index, hb[j2].index });
+			}
+		}
+	}
+	std::sort(anchors.begin(), anchors.end(), [](const Anchor &lhs, const Anchor &rhs) noexcept {
+		return lhs.left < rhs.left;
+	});
+}
+
+void DiffRange(const uint32_t *a, Sci_Line n, const uint32_t *b, Sci_Line m,
+	Sci_Line offA, Sci_Line offB, std::vector<DiffChange> &changes, int depth);
+
+// patience splitter: recurse between lines unique to both sides whose pairing
+// forms the longest common (strictly increasing) subsequence.
+bool PatienceSplit(const uint32_t *a, Sci_Line n, const uint32_t *b, Sci_Line m,
+	Sci_Line offA, Sci_Line offB, std::vector<DiffChange> &changes, int depth) {
+	std::vector<Anchor> anchors;
+	UniqueCommonLines(a, n, b, m, anchors);
+	if (anchors.empty()) {
+		return false;
+	}
+
+	// longest strictly increasing subsequence of the right indices
+	const Sci_Line count = static_cast<Sci_Line>(anchors.size());
+	std::vector<Sci_Line> tails;	// anchor index with the smallest tail per length
+	std::vector<Sci_Line> prev(count);
+	for (Sci_Line i = 0; i < count; i++) {
+		const Sci_Line bi = anchors[i].right;
+		Sci_Line lo = 0;
+		Sci_Line hi = static_cast<Sci_Line>(tails.size());
+		while (lo < hi) {
+			const Sci_Line mid = (lo + hi)/2;
+			if (anchors[tails[mid]].right < bi) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+		prev[i] = lo ? tails[lo - 1] : -1;
+		if (lo == static_cast<Sci_Line>(tails.size())) {
+			tails.push_back(i);
+		} else {
+			tails[lo] = i;
+		}
+	}
+	std::vector<Sci_Line> lis(tails.size());
+	for (Sci_Line i = static_cast<Sci_Line>(tails.size()), at = tails.back(); i > 0; i--) {
+		lis[i - 1] = at;
+		at = prev[at];
+	}
+
+	Sci_Line prevA = 0;
+	Sci_Line prevB = 0;
+	for (const Sci_Line i : lis) {
+		const Sci_Line ai = anchors[i].left;
+		const Sci_Line bi = anchors[i].right;
+		DiffRange(a + prevA, ai - prevA, b + prevB, bi - prevB, offA + prevA, offB + prevB, changes, depth + 1);
+		prevA = ai + 1;
+		prevB = bi + 1;
+	}
+	DiffRange(a + prevA, n - prevA, b + prevB, m - prevB, offA + prevA, offB + prevB, changes, depth + 1);
+	return true;
+}
+
+void DiffRange(const uint32_t *a, Sci_Line n, const uint32_t *b, Sci_Line m,
+	Sci_Line offA, Sci_Line offB, std::vector<DiffChange> &changes, int depth) {
+	// common prefix and suffix
+	while (n != 0 && m != 0 && *a == *b) {
+		++a;
+		++b;
+		++offA;
+		++offB;
+		--n;
+		--m;
+	}
+	while (n != 0 && m != 0 && a[n - 1] == b[m - 1]) {
+		--n;
+		--m;
+	}
+	if (n == 0 && m == 0) {
+		return;
+	}
+	if (n == 0 || m == 0) {
+		changes.push_back({ offA, offA + n, offB, offB + m });
+		return;
+	}
+	if (n + m <= 2*maxMyersD && MyersDiff(a, n, b, m, offA, offB, changes)) {
+		return;
+	}
+	if (depth >= maxPatienceDepth || !PatienceSplit(a, n, b, m, offA, offB, changes, depth)) {
+		// nothing to align on: the whole window is one replacement
+		changes.push_back({ offA, offA + n, offB, offB + m });
+	}
+}
+
+DWORD WINAPI DiffJobThreadProc(LPVOID lpParam) noexcept {
+	DiffJob * const job = static_cast<DiffJob *>(lpParam);
+	if (job->fullRebuild) {
+		for (int side = 0; side < 2; side++) {
+			Scintilla::ITextSnapshot * const snapshot = job->snapshot[side];
+			HashLines(snapshot->Data(), snapshot->Length(), -1, job->hashes[side]);
+			snapshot->Release();
+			job->snapshot[side] = nullptr;
+			job->windowStart[side] = 0;
+			job->windowEnd[side] = static_cast<Sci_Line>(job->hashes[side].size());
+		}
+	}
+	DiffRange(job->hashes[0].data(), static_cast<Sci_Line>(job->hashes[0].size()),
+		job->hashes[1].data(), static_cast<Sci_Line>(job->hashes[1].size()),
+		job->windowStart[0], job->windowStart[1], job->changes, 0);
+	PostMessage(hwndMain, APPM_DIFFREADY, 0, AsInteger<LPARAM>(job));
+	return 0;
+}
+
+void LaunchJob(DiffJob *job) noexcept {
+	job->generation = ++diffState.generation;
+	diffState.dirtyMin = PTRDIFF_MAX;
+	diffState.dirtyMax = 0;
+	HANDLE hThread = CreateThread(nullptr, 0, DiffJobThreadProc, job, 0, nullptr);
+	if (hThread != nullptr) {
+		CloseHandle(hThread);
+	} else {
+		// run synchronously rather than losing the update
+		DiffJobThreadProc(job);
+	}
+}
+
+void LaunchFullRebuild() noexcept {
+	DiffJob * const job = new DiffJob();
+	job->fullRebuild = true;
+	job->snapshot[0] = static_cast<Scintilla::ITextSnapshot *>(AsPointer<HANDLE>(SideCall(0, SCI_CREATESNAPSHOT)));
+	job->snapshot[1] = static_cast<Scintilla::ITextSnapshot *>(AsPointer<HANDLE>(SideCall(1, SCI_CREATESNAPSHOT)));
+	LaunchJob(job);
+}
+
+// map a line onto the other side through the change list; lines inside a
+// changed block are clamped onto the block on the other side.
+Sci_Line DiffMapLine(Sci_Line line, bool fromRight) noexcept {
+	const int side = fromRight ? 1 : 0;
+	Sci_Line offset = 0;
+	const std::vector<DiffChange> &changes = diffState.changes;
+	const DiffChange *it = std::lower_bound(changes.data(), changes.data() + changes.size(), line,
+		[side](const DiffChange &ch, Sci_Line value) noexcept {
+			return (side ? ch.rightEnd : ch.leftEnd) <= value;
+		});
+	if (it != changes.data()) {
+		const DiffChange &before = it[-1];
+		offset = side ? (before.leftEnd - before.rightEnd) : (before.rightEnd - before.leftEnd);
+	}
+	if (it != changes.data() + changes.size()) {
+		const Sci_Line start = side ? it->rightStart : it->leftStart;
+		if (line >= start) {
+			const Sci_Line oStart = side ? it->leftStart : it->rightStart;
+			const Sci_Line oEnd = side ? it->leftEnd : it->rightEnd;
+			return min(oStart + (line - start), max(oStart, oEnd - 1));
+		}
+	}
+	return line + offset;
+}
+
+void ApplyMarkers() noexcept {
+	for (int side = 0; side < 2; side++) {
+		SideCall(side, SCI_MARKERDELETEALL, MarkerNumber_DiffChanged);
+		SideCall(side, SCI_MARKERDELETEALL, MarkerNumber_DiffUnique);
+	}
+	for (const DiffChange &ch : diffState.changes) {
+		const int markerLeft = (ch.rightStart == ch.rightEnd) ? MarkerNumber_DiffUnique : MarkerNumber_DiffChanged;
+		const int markerRight = (ch.leftStart == ch.leftEnd) ? MarkerNumber_DiffUnique : MarkerNumber_DiffChanged;
+		for (Sci_Line line = ch.leftStart; line < ch.leftEnd; line++) {
+			SideCall(0, SCI_MARKERADD, line, markerLeft);
+		}
+		for (Sci_Line line = ch.rightStart; line < ch.rightEnd; line++) {
+			SideCall(1, SCI_MARKERADD, line, markerRight);
+		}
+	}
+	InvalidateRect(hwndEdit, nullptr, FALSE);
+	InvalidateRect(hwndDiffView, nullptr, FALSE);
+}
+
+void MarkDirty(Sci_Line lineMin, Sci_Line lineMax) noexcept {
+	diffState.dirtyMin = min(diffState.dirtyMin, lineMin);
+	diffState.dirtyMax = max(diffState.dirtyMax, lineMax);
+	SetTimer(hwndMain, ID_DIFFTIMER, diffRecomputeDelay, nullptr);
+}
+
+// re-hash lines [lineStart, lineStart + newCount) from the live document and
+// splice them over the oldCount hashes they replace.
+void RehashLines(int side, Sci_Line lineStart, Sci_Line newCount, Sci_Line oldCount) noexcept {
+	const Sci_Position posStart = SideCall(side, SCI_POSITIONFROMLINE, lineStart);
+	const Sci_Line docLines = SideCall(side, SCI_GETLINECOUNT);
+	const Sci_Position posEnd = (lineStart + newCount >= docLines) ?
+		SideCall(side, SCI_GETLENGTH) : SideCall(side, SCI_POSITIONFROMLINE, lineStart + newCount);
+	const std::unique_ptr<char[]> text = std::make_unique<char[]>(posEnd - posStart + 1);
+	const Sci_TextRangeFull tr { { posStart, posEnd }, text.get() };
+	SideCall(side, SCI_GETTEXTRANGEFULL, 0, AsInteger<LPARAM>(&tr));
+
+	std::vector<uint32_t> fresh;
+	fresh.reserve(newCount);
+	HashLines(text.get(), posEnd - posStart, newCount, fresh);
+	std::vector<uint32_t> &hashes = diffState.hashes[side];
+	const auto at = hashes.begin() + lineStart;
+	if (oldCount == newCount) {
+		std::copy(fresh.begin(), fresh.end(), at);
+	} else {
+		hashes.erase(at, at + oldCount);
+		hashes.insert(hashes.begin() + lineStart, fresh.begin(), fresh.end());
+	}
+}
+
+// a diff of the buffer against the file's git HEAD content, computed on a
+// worker thread: the worker reads the blob through a git child process,
+// hashes both sides and posts the block list back to the UI thread.
+struct VcsDiffJob {
+	UINT generation;
+	bool headFound;							// false: untracked, outside a work tree, or no git
+	Scintilla::ITextSnapshot *snapshot;		// buffer content, released by the worker
+	WCHAR directory[MAX_PATH];
+	WCHAR name[MAX_PATH];
+	std::vector<DiffChange> changes;		// left = HEAD, right = buffer
+};
+
+UINT vcsGeneration = 0;
+bool vcsMarkersDefined = false;
+
+// run `git show HEAD:./<name>` with the file's directory as working directory
+// and capture its output; false when git is absent, the file is untracked or
+// lies outside a work tree -- the caller then shows no markers at all.
+bool ReadGitHeadContent(const VcsDiffJob *job, std::vector<char> &blob) noexcept {
+	SECURITY_ATTRIBUTES sa { sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE };
+	HANDLE hRead = nullptr;
+	HANDLE hWrite = nullptr;
+	if (!CreatePipe(&hRead, &hWrite, &sa, 0)) {
+		return false;
+	}
+	SetHandleInformation(hRead, HANDLE_FLAG_INHERIT, 0);
+
+	WCHAR commandLine[MAX_PATH + 32];
+	wsprintf(commandLine, L"git show \"HEAD:./%s\"", job->name);
+	STARTUPINFO si {};
+	si.cb = sizeof(STARTUPINFO);
+	si.dwFlags = STARTF_USESTDHANDLES;
+	si.hStdOutput = hWrite;
+	si.hStdError = hWrite;	// drained with stdout; discarded on failure anyway
+	PROCESS_INFORMATION pi {};
+	const BOOL created = CreateProcess(nullptr, commandLine, nullptr, nullptr, TRUE,
+		CREATE_NO_WINDOW, nullptr, job->directory, &si, &pi);
+	CloseHandle(hWrite);
+	if (!created) {
+		CloseHandle(hRead);
+		return false;
+	}
+
+	char chunk[16384];
+	DWORD cbRead;
+	while (ReadFile(hRead, chunk, sizeof(chunk), &cbRead, nullptr) && cbRead != 0) {
+		blob.insert(blob.end(), chunk, chunk + cbRead);
+	}
+	CloseHandle(hRead);
+	WaitForSingleObject(pi.hProcess, INFINITE);
+	DWORD exitCode = 1;
+	GetExitCodeProcess(pi.hProcess, &exitCode);
+	CloseHandle(pi.hProcess);
+	CloseHandle(pi.hThread);
+	return exitCode == 0;
+}
+
+DWORD WINAPI VcsDiffJobThreadProc(LPVOID lpParam) noexcept {
+	VcsDiffJob * const job = static_cast<VcsDiffJob *>(lpParam);
+	std::vector<char> blob;
+	job->headFound = ReadGitHeadContent(job, blob);
+	if (job->headFound) {
+		// skip the UTF-8 signature, the buffer never carries it
+		const char *text = blob.data();
+		Sci_Position cbText = static_cast<Sci_Position>(blob.size());
+		if (cbText >= 3 && memcmp(text, "\xEF\xBB\xBF", 3) == 0) {
+			text += 3;
+			cbText -= 3;
+		}
+		std::vector<uint32_t> hashes[2];
+		HashLines(text, cbText, -1, hashes[0]);
+		HashLines(job->snapshot->Data(), job->snapshot->Length(), -1, hashes[1]);
+		DiffRange(hashes[0].data(), static_cast<Sci_Line>(hashes[0].size()),
+			hashes[1].data(), static_cast<Sci_Line>(hashes[1].size()), 0, 0, job->changes, 0);
+	}
+	job->snapshot->Release();
+	job->snapshot = nullptr;
+	PostMessage(hwndMain, APPM_VCSDIFFREADY, 0, AsInteger<LPARAM>(job));
+	return 0;
+}
+
+void VcsClearMarkers() noexcept {
+	SciCall_MarkerDeleteAll(MarkerNumber_VcsAdded);
+	SciCall_MarkerDeleteAll(MarkerNumber_VcsModified);
+}
+
+}
+
+void EditDiffOnDocModified(Sci_Position start, Sci_Position end, Sci_Line linesAdded, bool fromRight) noexcept {
+	if (!EditDiffActive()) {
+		return;
+	}
+	const int side = fromRight ? 1 : 0;
+	if (diffState.hashes[side].empty()) {
+		// the initial rebuild is still running; its result will be stale and
+		// dropped, schedule another full pass.
+		MarkDirty(0, 0);
+		return;
+	}
+	const Sci_Line lineStart = SideCall(side, SCI_LINEFROMPOSITION, start);
+	const Sci_Line lineEnd = SideCall(side, SCI_LINEFROMPOSITION, end);
+	const Sci_Line newCount = lineEnd - lineStart + 1;
+	const Sci_Line oldCount = newCount - linesAdded;
+	RehashLines(side, lineStart, newCount, oldCount);
+
+	// keep the change list in current coordinates; blocks inside the dirty
+	// window carry stale content anyway and are replaced by the re-diff.
+	if (linesAdded != 0) {
+		const Sci_Line pivot = lineStart + oldCount;
+		for (DiffChange &ch : diffState.changes) {
+			Sci_Line &chStart = side ? ch.rightStart : ch.leftStart;
+			Sci_Line &chEnd = side ? ch.rightEnd : ch.leftEnd;
+			if (chStart >= pivot) {
+				chStart = max<Sci_Line>(lineStart, chStart + linesAdded);
+			}
+			if (chEnd >= pivot) {
+				chEnd = max(chStart, chEnd + linesAdded);
+			}
+		}
+	}
+
+	Sci_Line dirtyMin = lineStart;
+	Sci_Line dirtyMax = lineStart + newCount;
+	if (fromRight) {
+		dirtyMin = DiffMapLine(dirtyMin, true);
+		dirtyMax = DiffMapLine(dirtyMax, true) + 1;
+	}
+	MarkDirty(dirtyMin, dirtyMax);
+}
+
+void EditDiffOnTimer() noexcept {
+	KillTimer(hwndMain, ID_DIFFTIMER);
+	if (!EditDiffActive() || diffState.dirtyMin == PTRDIFF_MAX) {
+		return;
+	}
+	if (InterlockedCompareExchange(&diffJobRunning, TRUE, FALSE) != FALSE) {
+		SetTimer(hwndMain, ID_DIFFTIMER, diffRecomputeDelay, nullptr);
+		return;
+	}
+	if (diffState.hashes[0].empty() || diffState.hashes[1].empty()) {
+		LaunchFullRebuild();
+		return;
+	}
+
+	// grow the window around the dirty lines until it cuts through no
+	// recorded change, then derive the aligned window on the right.
+	const std::vector<DiffChange> &changes = diffState.changes;
+	const Sci_Line leftCount = static_cast<Sci_Line>(diffState.hashes[0].size());
+	Sci_Line lo = max<Sci_Line>(0, diffState.dirtyMin - 1);
+	Sci_Line hi = min(leftCount, diffState.dirtyMax + 1);
+	size_t i0 = 0;
+	Sci_Line deltaBefore = 0;
+	while (i0 < changes.size() && changes[i0].leftEnd < lo) {
+		deltaBefore += (changes[i0].rightEnd - changes[i0].rightStart) - (changes[i0].leftEnd - changes[i0].leftStart);
+		++i0;
+	}
+	size_t i1 = i0;
+	Sci_Line deltaInside = 0;
+	while (i1 < changes.size() && changes[i1].leftStart <= hi) {
+		lo = min(lo, changes[i1].leftStart);
+		hi = max(hi, changes[i1].leftEnd);
+		deltaInside += (changes[i1].rightEnd - changes[i1].rightStart) - (changes[i1].leftEnd - changes[i1].leftStart);
+		++i1;
+	}
+	lo = max<Sci_Line>(0, lo);
+	hi = min(leftCount, hi);
+
+	DiffJob * const job = new DiffJob();
+	job->fullRebuild = false;
+	job->snapshot[0] = nullptr;
+	job->snapshot[1] = nullptr;
+	job->windowStart[0] = lo;
+	job->windowEnd[0] = hi;
+	job->windowStart[1] = lo + deltaBefore;
+	job->windowEnd[1] = hi + deltaBefore + deltaInside;
+	job->hashes[0].assign(diffState.hashes[0].begin() + lo, diffState.hashes[0].begin() + hi);
+	job->hashes[1].assign(diffState.hashes[1].begin() + job->windowStart[1], diffState.hashes[1].begin() + job->windowEnd[1]);
+	LaunchJob(job);
+}
+
+void EditDiffApplyResult(LPARAM lParam) noexcept {
+	DiffJob * const job = AsPointer<DiffJob *>(lParam);
+	if (job->generation != diffState.generation) {
+		// orphaned by a close or a restart; a newer job may be running
+		delete job;
+		return;
+	}
+	InterlockedExchange(&diffJobRunning, FALSE);
+	if (!EditDiffActive()) {
+		delete job;
+		return;
+	}
+	if (diffState.dirtyMin != PTRDIFF_MAX) {
+		// edited while the job ran: the window no longer matches the
+		// documents, fold it into the dirty range and run again.
+		if (!job->fullRebuild) {
+			diffState.dirtyMin = min(diffState.dirtyMin, job->windowStart[0]);
+			diffState.dirtyMax = max(diffState.dirtyMax, job->windowEnd[0]);
+		}
+		delete job;
+		SetTimer(hwndMain, ID_DIFFTIMER, diffRecomputeDelay, nullptr);
+		return;
+	}
+	if (job->fullRebuild) {
+		diffState.hashes[0] = std::move(job->hashes[0]);
+		diffState.hashes[1] = std::move(job->hashes[1]);
+		diffState.changes = std::move(job->changes);
+	} else {
+		std::vector<DiffChange> &changes = diffState.changes;
+		auto first = changes.begin();
+		while (first != changes.end() && first->leftEnd < job->windowStart[0]) {
+			++first;
+		}
+		auto last = first;
+		while (last != changes.end() && last->leftStart <= job->windowEnd[0]) {
+			++last;
+		}
+		const auto at = changes.erase(first, last);
+		changes.insert(at, job->changes.begin(), job->changes.end());
+	}
+	delete job;
+	ApplyMarkers();
+	EditDiffSyncScroll(false);
+}
+
+void EditDiffSyncScroll(bool fromRight) noexcept {
+	if (!EditDiffActive() || diffSyncLock) {
+		return;
+	}
+	diffSyncLock = true;
+	const int src = fromRight ? 1 : 0;
+	const int dst = 1 - src;
+	const Sci_Line firstVisible = SideCall(src, SCI_GETFIRSTVISIBLELINE);
+	const Sci_Line docLine = SideCall(src, SCI_DOCLINEFROMVISIBLE, firstVisible);
+	const Sci_Line subLine = firstVisible - SideCall(src, SCI_VISIBLEFROMDOCLINE, docLine);
+	const Sci_Line target = DiffMapLine(docLine, fromRight);
+	SideCall(dst, SCI_SETFIRSTVISIBLELINE, SideCall(dst, SCI_VISIBLEFROMDOCLINE, target) + subLine);
+	diffSyncLock = false;
+}
+
+LRESULT EditDiffHandleNotify(const SCNotification *scn) noexcept {
+	switch (scn->nmhdr.code) {
+	case SCN_UPDATEUI:
+		if (scn->updated & SC_UPDATE_V_SCROLL) {
+			EditDiffSyncScroll(true);
+		}
+		break;
+
+	case SCN_MODIFIED: {
+		const bool insertion = (scn->modificationType & SC_MOD_INSERTTEXT) != 0;
+		const Sci_Position changeEnd = insertion ? scn->position + scn->length : scn->position;
+		EditDiffOnDocModified(scn->position, changeEnd, scn->linesAdded, true);
+	}
+	break;
+	}
+	return 0;
+}
+
+void EditDiffLayout(int x, int y, int cx, int cy) noexcept {
+	const int cxSplitter = SystemMetricsForDpi(SM_CXBORDER, g_uCurrentDPI)*2;
+	const int cxLeft = (cx - cxSplitter)/2;
+	SetWindowPos(hwndEdit, nullptr, x, y, cxLeft, cy, SWP_NOZORDER | SWP_NOACTIVATE);
+	SetWindowPos(hwndDiffView, nullptr, x + cxLeft + cxSplitter, y, cx - cxLeft - cxSplitter, cy, SWP_NOZORDER | SWP_NOACTIVATE);
+}
+
+void EditDiffStart(LPCWSTR lpszPath) noexcept {
+	EditDiffStop();
+
+	HANDLE hFile = CreateFile(lpszPath,
+					   GENERIC_READ,
+					   FILE_SHARE_READ | FILE_SHARE_WRITE,
+					   nullptr, OPEN_EXISTING,
+					   FILE_ATTRIBUTE_NORMAL,
+					   nullptr);
+	dwLastIOError = GetLastError();
+	if (hFile == INVALID_HANDLE_VALUE) {
+		MsgBoxLastError(MB_OK, IDS_ERR_LOADFILE, lpszPath);
+		return;
+	}
+	LARGE_INTEGER fileSize;
+	fileSize.QuadPart = 0;
+	GetFileSizeEx(hFile, &fileSize);
+	char *buffer = static_cast<char *>(NP2HeapAlloc(fileSize.QuadPart + 1));
+	DWORD cbData = 0;
+	const BOOL readOK = ReadFile(hFile, buffer, static_cast<DWORD>(fileSize.QuadPart), &cbData, nullptr);
+	dwLastIOError = GetLastError();
+	CloseHandle(hFile);
+	if (!readOK) {
+		NP2HeapFree(buffer);
+		MsgBoxLastError(MB_OK, IDS_ERR_LOADFILE, lpszPath);
+		return;
+	}
+
+	const DWORD dwExStyle = IsAppThemed() ? 0 : WS_EX_CLIENTEDGE;
+	hwndDiffView = CreateWindowEx(dwExStyle,
+						  L"Scintilla",
+						  nullptr,
+						  WS_CHILD | WS_VISIBLE | WS_CLIPSIBLINGS,
+						  0, 0, 0, 0,
+						  hwndMain,
+						  AsPointer<HMENU, ULONG_PTR>(IDC_DIFFVIEW),
+						  g_hInstance,
+						  nullptr);
+	diffViewSci = AsPointer<HANDLE>(SendMessage(hwndDiffView, SCI_GETDIRECTPOINTER, 0, 0));
+
+	// mirror the display basics of the main view; the comparison side is
+	// shown as plain text, it gets no lexer of its own.
+	SideCall(1, SCI_SETTECHNOLOGY, SciCall_GetTechnology());
+	SideCall(1, SCI_SETCODEPAGE, SciCall_GetCodePage());
+	char fontName[LF_FACESIZE*kMaxMultiByteCount]{};
+	SciCall_StyleGetFont(STYLE_DEFAULT, fontName);
+	SideCall(1, SCI_STYLESETFONT, STYLE_DEFAULT, AsInteger<LPARAM>(fontName));
+	SideCall(1, SCI_STYLESETSIZEFRACTIONAL, STYLE_DEFAULT, SciCall(SCI_STYLEGETSIZEFRACTIONAL, STYLE_DEFAULT, 0));
+	SideCall(1, SCI_STYLESETFORE, STYLE_DEFAULT, SciCall(SCI_STYLEGETFORE, STYLE_DEFAULT, 0));
+	SideCall(1, SCI_STYLESETBACK, STYLE_DEFAULT, SciCall(SCI_STYLEGETBACK, STYLE_DEFAULT, 0));
+	SideCall(1, SCI_STYLECLEARALL);
+	SideCall(1, SCI_SETMARGINWIDTHN, MarginNumber_LineNumber, SciCall_GetMarginWidth(MarginNumber_LineNumber));
+	SideCall(1, SCI_SETMODEVENTMASK, SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT);
+	SideCall(1, SCI_SETZOOM, SciCall_GetZoom());
+
+	for (int side = 0; side < 2; side++) {
+		SideCall(side, SCI_MARKERDEFINE, MarkerNumber_DiffChanged, SC_MARK_BACKGROUND);
+		SideCall(side, SCI_MARKERSETBACK, MarkerNumber_DiffChanged, diffColorChanged);
+		SideCall(side, SCI_MARKERDEFINE, MarkerNumber_DiffUnique, SC_MARK_BACKGROUND);
+		SideCall(side, SCI_MARKERSETBACK, MarkerNumber_DiffUnique, diffColorUnique);
+	}
+
+	// skip the UTF-8 signature so the first line compares equal
+	const char *text = buffer;
+	Sci_Position cbText = cbData;
+	if (cbText >= 3 && memcmp(text, "\xEF\xBB\xBF", 3) == 0) {
+		text += 3;
+		cbText -= 3;
+	}
+	SideCall(1, SCI_APPENDTEXT, cbText, AsInteger<LPARAM>(text));
+	SideCall(1, SCI_EMPTYUNDOBUFFER);
+	SideCall(1, SCI_SETSAVEPOINT);
+	NP2HeapFree(buffer);
+
+	diffState.hashes[0].clear();
+	diffState.hashes[1].clear();
+	diffState.changes.clear();
+	diffState.dirtyMin = PTRDIFF_MAX;
+	diffState.dirtyMax = 0;
+	InterlockedExchange(&diffJobRunning, TRUE);
+	LaunchFullRebuild();
+	SendWMSize(hwndMain);
+}
+
+void EditDiffStop() noexcept {
+	if (!EditDiffActive()) {
+		return;
+	}
+	++diffState.generation;	// orphan any job still in flight
+	InterlockedExchange(&diffJobRunning, FALSE);
+	KillTimer(hwndMain, ID_DIFFTIMER);
+	DestroyWindow(hwndDiffView);
+	hwndDiffView = nullptr;
+	diffViewSci = nullptr;
+	SciCall_MarkerDeleteAll(MarkerNumber_DiffChanged);
+	SciCall_MarkerDeleteAll(MarkerNumber_DiffUnique);
+	diffState.hashes[0] = std::vector<uint32_t>();
+	diffState.hashes[1] = std::vector<uint32_t>();
+	diffState.changes = std::vector<DiffChange>();
+	SendWMSize(hwndMain);
+}
+
+void EditVcsDiffOnFileChanged(LPCWSTR lpszPath) noexcept {
+	++vcsGeneration;	// orphan any result still in flight
+	// a paged view only holds a window of the file, diffing it against HEAD
+	// would mark nearly everything
+	if (!bVcsChangeMarkers || bPageViewMode || StrIsEmpty(lpszPath)) {
+		VcsClearMarkers();
+		return;
+	}
+	Scintilla::ITextSnapshot * const snapshot = static_cast<Scintilla::ITextSnapshot *>(SciCall_CreateSnapshot());
+	if (snapshot == nullptr) {
+		// out of memory, keep the stale markers rather than crash the worker
+		return;
+	}
+	VcsDiffJob * const job = new VcsDiffJob();
+	job->generation = vcsGeneration;
+	job->snapshot = snapshot;
+	lstrcpy(job->directory, lpszPath);
+	PathRemoveFileSpec(job->directory);
+	lstrcpy(job->name, PathFindFileName(lpszPath));
+	HANDLE hThread = CreateThread(nullptr, 0, VcsDiffJobThreadProc, job, 0, nullptr);
+	if (hThread != nullptr) {
+		CloseHandle(hThread);
+	} else {
+		// run synchronously rather than losing the update
+		VcsDiffJobThreadProc(job);
+	}
+}
+
+void EditVcsDiffApplyResult(LPARAM lParam) noexcept {
+	VcsDiffJob * const job = AsPointer<VcsDiffJob *>(lParam);
+	if (job->generation != vcsGeneration) {
+		// the file changed under the job or the markers were turned off
+		delete job;
+		return;
+	}
+	if (!vcsMarkersDefined) {
+		vcsMarkersDefined = true;
+		SciCall_MarkerDefine(MarkerNumber_VcsAdded, SC_MARK_BAR);
+		SciCall(SCI_MARKERSETFORE, MarkerNumber_VcsAdded, vcsColorAdded);
+		SciCall(SCI_MARKERSETBACK, MarkerNumber_VcsAdded, vcsColorAdded);
+		SciCall_MarkerDefine(MarkerNumber_VcsModified, SC_MARK_BAR);
+		SciCall(SCI_MARKERSETFORE, MarkerNumber_VcsModified, vcsColorModified);
+		SciCall(SCI_MARKERSETBACK, MarkerNumber_VcsModified, vcsColorModified);
+	}
+	VcsClearMarkers();
+	if (job->headFound) {
+		const Sci_Line lineLast = SciCall_GetLineCount() - 1;
+		for (const DiffChange &ch : job->changes) {
+			const int marker = (ch.leftStart == ch.leftEnd) ? MarkerNumber_VcsAdded : MarkerNumber_VcsModified;
+			Sci_Line line = ch.rightStart;
+			Sci_Line end = ch.rightEnd;
+			if (line == end) {
+				// lines deleted against HEAD leave nothing to mark; flag the
+				// line after the removed block as modified instead.
+				end = min(line + 1, lineLast + 1);
+				line = min(line, lineLast);
+			}
+			for (; line < end; line++) {
+				SciCall_MarkerAdd(line, marker);
+			}
+		}
+	}
+	delete job;
+}
@@ -0,0 +1,42 @@
+/******************************************************************************
+*
+*
+* Notepad4
+*
+* EditDiff.h
+*   Side-by-side diff view: compares the current document against a second
+*   file loaded into a companion Scintilla view with synchronized scrolling.
+*
+* See License.txt for details about distribution and modification.
+*
+******************************************************************************/
+#pragma once
+
+// right-hand comparison view, nullptr while the diff view is closed
+extern HWND hwndDiffView;
+
+inline bool EditDiffActive() noexcept {
+	return hwndDiffView != nullptr;
+}
+
+void EditDiffStart(LPCWSTR lpszPath) noexcept;
+void EditDiffStop() noexcept;
+// lays out both the editor and the comparison view inside the given rectangle
+void EditDiffLayout(int x, int y, int cx, int cy) noexcept;
+// keeps the other view's first visible line aligned through the diff mapping
+void EditDiffSyncScroll(bool fromRight) noexcept;
+// document range [start, end) changed (current coordinates), linesAdded as in
+// SCN_MODIFIED; re-hashes the affected lines and schedules a windowed re-diff.
+void EditDiffOnDocModified(Sci_Position start, Sci_Position end, Sci_Line linesAdded, bool fromRight) noexcept;
+void EditDiffOnTimer() noexcept;
+// APPM_DIFFREADY: a worker finished computing; splice the result in
+void EditDiffApplyResult(LPARAM lParam) noexcept;
+LRESULT EditDiffHandleNotify(const SCNotification *scn) noexcept;
+
+// git change margin: diffs the buffer against the file's git HEAD content on
+// a worker thread and marks modified/added lines in the bookmark margin.
+// Called with the current path on open and save; an empty path or a disabled
+// setting clears the markers.
+void EditVcsDiffOnFileChanged(LPCWSTR lpszPath) noexcept;
+// APPM_VCSDIFFREADY: the worker finished; apply the margin markers
+void EditVcsDiffApplyResult(LPARAM lParam) noexcept;
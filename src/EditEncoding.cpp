@@ -1868,7 +1868,7 @@ static inline int did_cpu_supports_ssse3() noexcept {
 // Copyright (c) 2008-2010 Bjoern Hoehrmann <bjoern@hoehrmann.de>
 // See https://bjoern.hoehrmann.de/utf-8/decoder/dfa/ for details.
 
-bool IsUTF8(const char *pTest, DWORD nLength) noexcept {
+static bool IsUTF8Part(const char *pTest, DWORD nLength) noexcept {
 #if 0
 	StopWatch watch;
 	watch.Start();
@@ -2047,6 +2047,68 @@ bool IsUTF8(const char *pTest, DWORD nLength) noexcept {
 #endif // !NP2_USE_AVX2
 }
 
+struct UTF8ValidationJob {
+	const char *data;
+	DWORD length;
+	bool valid;
+};
+
+static DWORD WINAPI ValidateUTF8Thread(LPVOID lpParameter) noexcept {
+	UTF8ValidationJob * const job = static_cast<UTF8ValidationJob *>(lpParameter);
+	job->valid = IsUTF8Part(job->data, job->length);
+	return 0;
+}
+
+bool IsUTF8(const char *pTest, DWORD nLength) noexcept {
+	// Split huge buffers at character boundaries and validate the parts
+	// concurrently: UTF-8 validity is local to each part when the split
+	// points are not continuation bytes.
+	constexpr DWORD minParallelSize = 16U << 20;
+	if (nLength >= 2*minParallelSize) {
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		constexpr DWORD maxPartCount = 16;
+		DWORD partCount = min(min(info.dwNumberOfProcessors, nLength / minParallelSize), maxPartCount);
+		if (partCount > 1) {
+			UTF8ValidationJob jobs[maxPartCount];
+			const DWORD step = nLength / partCount;
+			const char *start = pTest;
+			const char * const end = pTest + nLength;
+			for (DWORD i = 0; i < partCount; i++) {
+				const char *partEnd = (i + 1 == partCount) ? end : pTest + (i + 1)*step;
+				while (partEnd < end && (*partEnd & 0xC0) == 0x80) {
+					++partEnd;
+				}
+				jobs[i] = { start, static_cast<DWORD>(partEnd - start), true };
+				start = partEnd;
+			}
+			// validate the first part on this thread, the rest on workers
+			HANDLE threads[maxPartCount];
+			DWORD threadCount = 0;
+			for (DWORD i = 1; i < partCount; i++) {
+				HANDLE thread = CreateThread(nullptr, 0, ValidateUTF8Thread, &jobs[i], 0, nullptr);
+				if (thread == nullptr) {
+					jobs[i].valid = IsUTF8Part(jobs[i].data, jobs[i].length);
+				} else {
+					threads[threadCount++] = thread;
+				}
+			}
+			bool valid = IsUTF8Part(jobs[0].data, jobs[0].length);
+			if (threadCount != 0) {
+				WaitForMultipleObjects(threadCount, threads, TRUE, INFINITE);
+				for (DWORD i = 0; i < threadCount; i++) {
+					CloseHandle(threads[i]);
+				}
+			}
+			for (DWORD i = 1; i < partCount; i++) {
+				valid = valid && jobs[i].valid;
+			}
+			return valid;
+		}
+	}
+	return IsUTF8Part(pTest, nLength);
+}
+
 static const char *CheckUTF7(const char *pTest, DWORD nLength) noexcept {
 	const char *pt = pTest;
 #if NP2_USE_AVX2
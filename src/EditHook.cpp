@@ -0,0 +1,112 @@
+/******************************************************************************
+*
+*
+* Notepad4
+*
+* EditHook.cpp
+*   In-process scripting hook. A user supplied DLL receives a read snapshot
+*   of the document and returns batched span edits. Scripts never generate
+*   per-position message traffic: reading is one contiguous range pointer,
+*   writing is one target replacement per span inside a single undo action,
+*   so a script touching a million lines performs one commit.
+*
+* See License.txt for details about distribution and modification.
+*
+******************************************************************************/
+
+struct IUnknown;
+#include <windows.h>
+#include <shlwapi.h>
+#include <commdlg.h>
+#include "SciCall.h"
+#include "Helpers.h"
+#include "Notepad4.h"
+#include "Edit.h"
+#include "EditHook.h"
+#include "resource.h"
+
+extern HWND hwndMain;
+extern bool bUseXPFileDialog;
+
+// remembered for the session so re-running a script is two clicks
+static WCHAR tchLastHookDLL[MAX_PATH];
+
+void EditRunScriptHook() noexcept {
+	WCHAR szFilter[128];
+	GetString(IDS_FILTER_DLL, szFilter, COUNTOF(szFilter));
+	PrepareFilterStr(szFilter);
+
+	WCHAR szFile[MAX_PATH];
+	lstrcpy(szFile, tchLastHookDLL);
+	OPENFILENAME ofn;
+	memset(&ofn, 0, sizeof(OPENFILENAME));
+	ofn.lStructSize = sizeof(OPENFILENAME);
+	ofn.hwndOwner = hwndMain;
+	ofn.lpstrFilter = szFilter;
+	ofn.lpstrFile = szFile;
+	ofn.nMaxFile = COUNTOF(szFile);
+	ofn.Flags = OFN_FILEMUSTEXIST | OFN_HIDEREADONLY | OFN_NOCHANGEDIR | OFN_DONTADDTORECENT
+				| OFN_PATHMUSTEXIST | OFN_SHAREAWARE | OFN_NODEREFERENCELINKS;
+	if (bUseXPFileDialog) {
+		ofn.Flags |= OFN_EXPLORER | OFN_ENABLESIZING | OFN_ENABLEHOOK;
+		ofn.lpfnHook = OpenSaveFileDlgHookProc;
+	}
+	if (!GetOpenFileName(&ofn)) {
+		return;
+	}
+	lstrcpy(tchLastHookDLL, szFile);
+
+	HMODULE hDLL = LoadLibraryEx(szFile, nullptr, LOAD_WITH_ALTERED_SEARCH_PATH);
+	if (hDLL == nullptr) {
+		MsgBoxLastError(MB_OK, IDS_ERR_LOADFILE, szFile);
+		return;
+	}
+	const Notepad4HookTransformProc transform = DLLFunction<Notepad4HookTransformProc>(hDLL, "Notepad4HookTransform");
+	if (transform == nullptr) {
+		FreeLibrary(hDLL);
+		MsgBoxWarn(MB_OK, IDS_ERR_HOOK_DLL, szFile);
+		return;
+	}
+
+	// one contiguous read of the whole document; no per-position traffic
+	const Sci_Position length = SciCall_GetLength();
+	Notepad4HookDocument doc;
+	doc.version = NP4_HOOK_API_VERSION;
+	doc.codePage = SciCall_GetCodePage();
+	doc.text = SciCall_GetRangePointer(0, length);
+	doc.length = static_cast<size_t>(length);
+	doc.path = szCurFile;
+
+	Notepad4HookResult result = { 0, nullptr };
+	if (transform(&doc, &result) && result.count != 0 && result.spans != nullptr) {
+		// validate before touching the document: sorted, non-overlapping, in range
+		bool valid = true;
+		size_t end = 0;
+		for (size_t i = 0; i < result.count; i++) {
+			const Notepad4HookSpan &span = result.spans[i];
+			if (span.start < end || span.start > doc.length || span.length > doc.length - span.start
+				|| (span.replacementLength != 0 && span.replacement == nullptr)) {
+				valid = false;
+				break;
+			}
+			end = span.start + span.length;
+		}
+		if (valid) {
+			// apply back to front inside one undo action, so earlier offsets
+			// stay valid and the whole script is a single undo step
+			SciCall_BeginUndoAction();
+			for (size_t i = result.count; i != 0; i--) {
+				const Notepad4HookSpan &span = result.spans[i - 1];
+				const Sci_Position start = static_cast<Sci_Position>(span.start);
+				SciCall_SetTargetRange(start, start + static_cast<Sci_Position>(span.length));
+				SciCall_ReplaceTarget(static_cast<Sci_Position>(span.replacementLength), (span.replacement != nullptr) ? span.replacement : "");
+			}
+			SciCall_EndUndoAction();
+		}
+	}
+	const Notepad4HookFreeResultProc freeResult = DLLFunction<Notepad4HookFreeResultProc>(hDLL, "Notepad4HookFreeResult");
+	if (freeResult != nullptr) {
+		freeResult(&result);
+	}
+	FreeLibrary(hDLL);
+}
@@ -0,0 +1,50 @@
+/******************************************************************************
+*
+*
+* Notepad4
+*
+* EditHook.h
+*   In-process scripting hook: a user supplied DLL receives a read snapshot
+*   of the document and returns batched span edits, applied as one undo step.
+*
+* See License.txt for details about distribution and modification.
+*
+******************************************************************************/
+#pragma once
+
+#define NP4_HOOK_API_VERSION	1
+
+// byte offsets into the snapshot; spans must be sorted ascending and must not
+// overlap. replacement must not point into the snapshot text, which becomes
+// invalid as soon as the first span is applied.
+struct Notepad4HookSpan {
+	size_t start;
+	size_t length;				// bytes removed, 0 for a pure insertion
+	const char *replacement;
+	size_t replacementLength;	// bytes inserted, 0 for a pure deletion
+};
+
+struct Notepad4HookDocument {
+	unsigned int version;		// NP4_HOOK_API_VERSION
+	unsigned int codePage;		// SC_CP_UTF8, or 0 for ANSI
+	const char *text;			// read snapshot of the whole document
+	size_t length;
+	const wchar_t *path;		// current file, empty for an untitled document
+};
+
+struct Notepad4HookResult {
+	size_t count;
+	const Notepad4HookSpan *spans;
+};
+
+// The hook DLL exports:
+//   BOOL __cdecl Notepad4HookTransform(const Notepad4HookDocument *doc, Notepad4HookResult *result);
+//   void __cdecl Notepad4HookFreeResult(Notepad4HookResult *result);	// optional
+// Transform returns TRUE with the edits to apply (an empty result is a no-op);
+// FreeResult is called afterwards so the DLL can release the span memory.
+typedef BOOL (__cdecl *Notepad4HookTransformProc)(const Notepad4HookDocument *doc, Notepad4HookResult *result);
+typedef void (__cdecl *Notepad4HookFreeResultProc)(Notepad4HookResult *result);
+
+// prompts for the hook DLL, runs its transform against a snapshot of the
+// document and applies the returned spans as a single undo action.
+void EditRunScriptHook() noexcept;
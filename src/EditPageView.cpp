@@ -0,0 +1,365 @@
+/******************************************************************************
+*
+*
+* Notepad4
+*
+* EditPageView.cpp
+*   Read-only paged view for files too large to load completely. The file
+*   stays on disk behind a read-only file mapping and only a sliding window
+*   (32 MiB, snapped to line starts) is copied into the Scintilla buffer;
+*   scrolling near either edge re-centers the window around the same file
+*   offset, so the OS page cache does the heavy lifting. A worker thread
+*   streams once over the whole file counting line feeds (checkpoint every
+*   4 MiB) to build a global line index, which maps whole-file line numbers
+*   to window-local ones for go-to-line. The index counts LF, so files with
+*   lone-CR line endings only get window-local navigation.
+*
+* See License.txt for details about distribution and modification.
+*
+******************************************************************************/
+
+struct IUnknown;
+#include <windows.h>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+#include "SciCall.h"
+#include "VectorISA.h"
+#include "Helpers.h"
+#include "Notepad4.h"
+#include "Edit.h"
+#include "EditPageView.h"
+
+extern HWND hwndMain;
+extern DWORD dwLastIOError;
+extern bool bReadOnlyMode;
+extern int iDefaultCodePage;
+
+bool bPageViewMode = false;
+
+namespace {
+
+constexpr LONGLONG pageViewWindowSize = 32 << 20;	// bytes materialized in the buffer
+constexpr LONGLONG pageViewEdgeMargin = 2 << 20;	// slide when scrolled this close to an edge
+constexpr LONGLONG pageViewLineSeek = 64 << 10;		// how far window edges chase a line start
+constexpr LONGLONG scanCheckpointInterval = 4 << 20;// line index granularity, also the scan read size
+
+struct PageScanJob {
+	UINT generation;
+	bool success;
+	WCHAR path[MAX_PATH];
+	Sci_Line totalLines;				// lines in the whole file
+	std::vector<LONGLONG> offsets;		// checkpoint byte offsets, ascending
+	std::vector<Sci_Line> lines;		// line feeds wholly before offsets[i]
+};
+
+struct PageViewState {
+	HANDLE hMapping;					// read-only mapping of the whole file
+	LONGLONG fileSize;
+	DWORD granularity;					// MapViewOfFile() offset alignment
+	LONGLONG windowStart;				// file offset of the first buffer byte
+	LONGLONG windowEnd;					// file offset just past the last buffer byte
+	UINT cpEdit;						// SC_CP_UTF8 or the ANSI code page
+	UINT generation;					// stamps scan jobs; bumped on Stop()
+	bool migrating;						// reloading the window raises its own scroll notifications
+	bool scanDone;
+	Sci_Line totalLines;
+	std::vector<LONGLONG> checkpointOffsets;
+	std::vector<Sci_Line> checkpointLines;
+};
+
+PageViewState pageView;
+
+Sci_Line CountLineFeeds(const char *text, size_t length) noexcept {
+	const uint8_t *ptr = reinterpret_cast<const uint8_t *>(text);
+	const uint8_t * const end = ptr + length;
+	Sci_Line count = 0;
+#if NP2_USE_AVX2
+	const __m256i vectLF = _mm256_set1_epi8('\n');
+	while (ptr + sizeof(__m256i) <= end) {
+		// unaligned loading: window starts at random position.
+		const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ptr));
+		ptr += sizeof(__m256i);
+		const uint32_t mask = mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, vectLF));
+		if (mask) {
+			count += np2_popcount(mask);
+		}
+	}
+	// end NP2_USE_AVX2
+#elif NP2_USE_SSE2
+	const __m128i vectLF = _mm_set1_epi8('\n');
+	while (ptr + sizeof(__m128i) <= end) {
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr));
+		ptr += sizeof(__m128i);
+		const uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, vectLF));
+		if (mask) {
+			count += np2_popcount(mask);
+		}
+	}
+	// end NP2_USE_SSE2
+#endif
+	while (ptr < end) {
+		count += *ptr++ == '\n';
+	}
+	return count;
+}
+
+// one sequential pass over the whole file, 4 MiB at a time, recording the
+// cumulative line feed count at every read boundary.
+DWORD WINAPI PageScanThreadProc(LPVOID lpParam) noexcept {
+	PageScanJob * const job = static_cast<PageScanJob *>(lpParam);
+	HANDLE hFile = CreateFile(job->path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+							nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (hFile != INVALID_HANDLE_VALUE) {
+		char * const buffer = static_cast<char *>(NP2HeapAlloc(static_cast<SIZE_T>(scanCheckpointInterval)));
+		LONGLONG offset = 0;
+		Sci_Line total = 0;
+		job->success = true;
+		for (;;) {
+			if (job->generation != pageView.generation) {
+				job->success = false;	// the view was closed under the scan
+				break;
+			}
+			DWORD cbRead = 0;
+			if (!ReadFile(hFile, buffer, static_cast<DWORD>(scanCheckpointInterval), &cbRead, nullptr)) {
+				job->success = false;
+				break;
+			}
+			if (cbRead == 0) {
+				break;
+			}
+			total += CountLineFeeds(buffer, cbRead);
+			offset += cbRead;
+			job->offsets.push_back(offset);
+			job->lines.push_back(total);
+		}
+		job->totalLines = total + 1;
+		NP2HeapFree(buffer);
+		CloseHandle(hFile);
+	}
+	PostMessage(hwndMain, APPM_PAGEVIEWSCAN, 0, AsInteger<LPARAM>(job));
+	return 0;
+}
+
+// replaces the buffer with the window that covers the given file offset,
+// snapping both window edges to line starts when one is nearby (a line
+// longer than pageViewLineSeek keeps the raw offset instead).
+void PageViewLoadWindow(LONGLONG start) noexcept {
+	const LONGLONG fileSize = pageView.fileSize;
+	start = min(start, fileSize - pageViewWindowSize);
+	start = max(start, LONGLONG(0));
+	const LONGLONG mapBase = start - start % pageView.granularity;
+	const LONGLONG mapLen = min(fileSize - mapBase, (start - mapBase) + pageViewWindowSize);
+	const char * const view = static_cast<const char *>(MapViewOfFile(pageView.hMapping, FILE_MAP_READ,
+								static_cast<DWORD>(mapBase >> 32), static_cast<DWORD>(mapBase), static_cast<SIZE_T>(mapLen)));
+	if (view == nullptr) {
+		dwLastIOError = GetLastError();
+		return;	// keep the current window under address space pressure
+	}
+	LONGLONG lo = start - mapBase;
+	if (start > 0) {
+		const LONGLONG stop = max(lo - pageViewLineSeek, LONGLONG(0));
+		LONGLONG i = lo;
+		while (i > stop && view[i - 1] != '\n') {
+			i--;
+		}
+		if (i > 0 && view[i - 1] == '\n') {
+			lo = i;
+		}
+	}
+	LONGLONG hi = mapLen;
+	if (mapBase + hi < fileSize) {
+		const LONGLONG stop = max(hi - pageViewLineSeek, lo);
+		LONGLONG i = hi;
+		while (i > stop && view[i - 1] != '\n') {
+			i--;
+		}
+		if (i > lo && view[i - 1] == '\n') {
+			hi = i;
+		}
+	}
+	const DWORD cbText = static_cast<DWORD>(hi - lo);
+	EditSetNewText(view + lo, cbText, CountLineFeeds(view + lo, cbText) + 1);
+	UnmapViewOfFile(view);
+	SciCall_SetCodePage(pageView.cpEdit);
+	SciCall_SetReadOnly(true);
+	bReadOnlyMode = true;
+	pageView.windowStart = mapBase + lo;
+	pageView.windowEnd = mapBase + hi;
+}
+
+}
+
+bool EditPageViewStart(LPCWSTR lpszPath, EditFileIOStatus &status) noexcept {
+	EditPageViewStop();
+	HANDLE hFile = CreateFile(lpszPath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+							nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	dwLastIOError = GetLastError();
+	if (hFile == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	fileSize.QuadPart = 0;
+	GetFileSizeEx(hFile, &fileSize);
+	HANDLE hMapping = CreateFileMapping(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	dwLastIOError = GetLastError();
+	// the mapping keeps its own reference to the file
+	CloseHandle(hFile);
+	if (hMapping == nullptr) {
+		return false;
+	}
+
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	pageView.hMapping = hMapping;
+	pageView.fileSize = fileSize.QuadPart;
+	pageView.granularity = info.dwAllocationGranularity;
+	bPageViewMode = true;
+
+	// encoding and EOL mode are detected over the first window only
+	DWORD cbProbe = static_cast<DWORD>(min(fileSize.QuadPart, pageViewWindowSize));
+	const char * const probe = static_cast<const char *>(MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, cbProbe));
+	if (probe == nullptr) {
+		dwLastIOError = GetLastError();
+		EditPageViewStop();
+		return false;
+	}
+	EditDetectEOLMode(probe, cbProbe, status);
+	// a code point cut at the probe edge must not fail the UTF-8 validation:
+	// strip trailing continuation bytes and the lead byte they hang off, but
+	// never a complete character, so multi-byte text keeps its last evidence
+	DWORD cbValid = cbProbe;
+	for (DWORD trail = 0; trail < 3 && cbValid != 0 && (probe[cbValid - 1] & 0xC0) == 0x80; trail++) {
+		cbValid--;
+	}
+	if (cbValid != 0 && (probe[cbValid - 1] & 0xC0) == 0xC0) {
+		cbValid--;
+	}
+	const bool utf8 = IsUTF8Signature(probe) || IsUTF8(probe, cbValid);
+	UnmapViewOfFile(probe);
+	pageView.cpEdit = utf8 ? SC_CP_UTF8 : iDefaultCodePage;
+	status.iEncoding = utf8 ? CPI_UTF8 : CPI_DEFAULT;
+
+	pageView.migrating = true;
+	PageViewLoadWindow(0);
+	pageView.migrating = false;
+
+	PageScanJob * const job = new PageScanJob();
+	job->generation = pageView.generation;
+	lstrcpy(job->path, lpszPath);
+	HANDLE hThread = CreateThread(nullptr, 0, PageScanThreadProc, job, 0, nullptr);
+	if (hThread != nullptr) {
+		CloseHandle(hThread);
+	} else {
+		// no index: navigation stays window-local
+		delete job;
+	}
+	return true;
+}
+
+void EditPageViewStop() noexcept {
+	++pageView.generation;	// orphan the scan worker
+	if (!bPageViewMode) {
+		return;
+	}
+	bPageViewMode = false;
+	pageView.scanDone = false;
+	pageView.totalLines = 0;
+	pageView.checkpointOffsets = std::vector<LONGLONG>();
+	pageView.checkpointLines = std::vector<Sci_Line>();
+	CloseHandle(pageView.hMapping);
+	pageView.hMapping = nullptr;
+}
+
+void EditPageViewOnScroll() noexcept {
+	if (!bPageViewMode || pageView.migrating) {
+		return;
+	}
+	const Sci_Line topLine = SciCall_DocLineFromVisible(SciCall_GetFirstVisibleLine());
+	const Sci_Position posTop = SciCall_PositionFromLine(topLine);
+	const bool nearTop = pageView.windowStart > 0 && posTop < pageViewEdgeMargin;
+	const bool nearEnd = pageView.windowEnd < pageView.fileSize && SciCall_GetLength() - posTop < pageViewEdgeMargin;
+	if (!nearTop && !nearEnd) {
+		return;
+	}
+	// keep the top visible line and the caret at the same file offsets
+	const LONGLONG anchor = pageView.windowStart + posTop;
+	const Sci_Position caretOffset = SciCall_GetCurrentPos() - posTop;
+	pageView.migrating = true;
+	PageViewLoadWindow(anchor - pageViewWindowSize/2);
+	const Sci_Position length = SciCall_GetLength();
+	Sci_Position posLocal = static_cast<Sci_Position>(anchor - pageView.windowStart);
+	posLocal = sci::clamp(posLocal, Sci_Position(0), length);
+	SciCall_GotoPos(sci::clamp(posLocal + caretOffset, Sci_Position(0), length));
+	SciCall_SetFirstVisibleLine(SciCall_VisibleFromDocLine(SciCall_LineFromPosition(posLocal)));
+	pageView.migrating = false;
+}
+
+void EditPageViewApplyScan(LPARAM lParam) noexcept {
+	PageScanJob * const job = AsPointer<PageScanJob *>(lParam);
+	if (job->generation == pageView.generation && bPageViewMode && job->success) {
+		pageView.checkpointOffsets = std::move(job->offsets);
+		pageView.checkpointLines = std::move(job->lines);
+		pageView.totalLines = job->totalLines;
+		pageView.scanDone = true;
+	}
+	delete job;
+}
+
+void EditPageViewGoToLine(Sci_Line &iLine) noexcept {
+	if (!bPageViewMode) {
+		return;
+	}
+	if (iLine < 0 || (pageView.scanDone && iLine > pageView.totalLines)) {
+		// jump to the end of the file, not just of the current window
+		pageView.migrating = true;
+		PageViewLoadWindow(pageView.fileSize - pageViewWindowSize);
+		pageView.migrating = false;
+		iLine = -1;	// EditJumpTo() turns this into end of buffer
+		return;
+	}
+	if (!pageView.scanDone || iLine == 0) {
+		return;	// no index yet: treat the number as window-local
+	}
+	// resolve the file offset of the target line start: jump to the greatest
+	// checkpoint not above it, then walk at most one checkpoint interval.
+	const Sci_Line target = iLine - 1;
+	const auto it = std::upper_bound(pageView.checkpointLines.begin(), pageView.checkpointLines.end(), target);
+	const size_t idx = it - pageView.checkpointLines.begin();
+	LONGLONG offset = 0;
+	Sci_Line line = 0;
+	if (idx > 0) {
+		offset = pageView.checkpointOffsets[idx - 1];
+		line = pageView.checkpointLines[idx - 1];
+	}
+	if (line < target) {
+		const LONGLONG mapBase = offset - offset % pageView.granularity;
+		const LONGLONG mapEnd = (idx < pageView.checkpointOffsets.size()) ? pageView.checkpointOffsets[idx] : pageView.fileSize;
+		const char * const view = static_cast<const char *>(MapViewOfFile(pageView.hMapping, FILE_MAP_READ,
+									static_cast<DWORD>(mapBase >> 32), static_cast<DWORD>(mapBase), static_cast<SIZE_T>(mapEnd - mapBase)));
+		if (view == nullptr) {
+			dwLastIOError = GetLastError();
+			return;
+		}
+		const char *ptr = view + (offset - mapBase);
+		const char * const end = view + (mapEnd - mapBase);
+		do {
+			const char * const lf = static_cast<const char *>(memchr(ptr, '\n', end - ptr));
+			if (lf == nullptr) {
+				break;
+			}
+			ptr = lf + 1;
+			++line;
+		} while (line < target);
+		offset = mapBase + (ptr - view);
+		UnmapViewOfFile(view);
+	}
+	if (offset < pageView.windowStart || offset >= pageView.windowEnd) {
+		pageView.migrating = true;
+		PageViewLoadWindow(offset - pageViewWindowSize/2);
+		pageView.migrating = false;
+	}
+	const Sci_Position posLocal = sci::clamp(static_cast<Sci_Position>(offset - pageView.windowStart), Sci_Position(0), SciCall_GetLength());
+	iLine = SciCall_LineFromPosition(posLocal) + 1;
+}
@@ -0,0 +1,36 @@
+/******************************************************************************
+*
+*
+* Notepad4
+*
+* EditPageView.h
+*   Read-only paged view for files too large to load completely: only a
+*   sliding window of the file is materialized in the Scintilla buffer,
+*   served from a memory mapped view; a streaming background scan builds
+*   a global line index for go-to-line across the whole file.
+*
+* See License.txt for details about distribution and modification.
+*
+******************************************************************************/
+#pragma once
+
+// true while the current document is a paged window into a larger file
+extern bool bPageViewMode;
+
+struct EditFileIOStatus;
+
+// opens lpszPath in paged mode: maps the first window into the buffer,
+// starts the line index scan and fills status like EditLoadFile() does.
+bool EditPageViewStart(LPCWSTR lpszPath, EditFileIOStatus &status) noexcept;
+// closes the mapping and orphans the scan worker; the buffer is left alone
+// because every caller replaces it right after.
+void EditPageViewStop() noexcept;
+// SCN_UPDATEUI with SC_UPDATE_V_SCROLL: slides the window when the view
+// nears either edge, keeping the top visible line at the same file offset.
+void EditPageViewOnScroll() noexcept;
+// APPM_PAGEVIEWSCAN: the scan worker finished; adopt the line index
+void EditPageViewApplyScan(LPARAM lParam) noexcept;
+// translates a whole-file line number into a window-local one, sliding the
+// window there first when needed; quietly keeps iLine unchanged (treating
+// it as window-local) until the line index scan has finished.
+void EditPageViewGoToLine(Sci_Line &iLine) noexcept;
@@ -0,0 +1,335 @@
+/******************************************************************************
+*
+*
+* Notepad4
+*
+* EditSpell.cpp
+*   Background spell checking. Words inside comment, string and plain text
+*   styles are checked against the Windows Spell Checking API on a worker
+*   thread; the UI thread only copies bounded chunks of text plus styles out
+*   of the document and applies the resulting squiggle indicators, so typing
+*   never waits on the checker even in very large files.
+*
+* See License.txt for details about distribution and modification.
+*
+******************************************************************************/
+
+struct IUnknown;
+#include <windows.h>
+#include <spellcheck.h>
+#include <cstdint>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "SciCall.h"
+#include "VectorISA.h"
+#include "Helpers.h"
+#include "Notepad4.h"
+#include "Edit.h"
+#include "EditSpell.h"
+
+extern HWND hwndMain;
+
+bool bSpellCheckEnabled = false;
+
+namespace {
+
+constexpr UINT spellCheckDelay = 500;		// ms, waits out a typing burst before re-checking
+constexpr UINT spellContinueDelay = 20;		// ms, between chunks of a large sweep
+constexpr Sci_Position spellChunkBytes = 256*1024;	// document bytes per worker pass
+constexpr size_t minWordLength = 3;
+constexpr size_t maxWordLength = 63;
+
+struct SpellRange {
+	Sci_Position start;
+	Sci_Position length;
+};
+
+// a chunk captured on the UI thread and checked on a worker
+struct SpellJob {
+	UINT generation;
+	UINT cpEdit;
+	Sci_Position start;				// chunk origin in document coordinates
+	std::string text;				// chunk bytes
+	std::string styles;				// style byte per text byte
+	uint32_t styleMask[8];			// styles worth checking for the lexer
+	bool unavailable = false;		// no checker for the user locale
+	std::vector<SpellRange> misspelled;
+};
+
+struct SpellState {
+	Sci_Position pendingStart = -1;	// dirty range awaiting a worker, -1 when clean
+	Sci_Position pendingEnd = -1;
+	Sci_Position activeStart = 0;	// chunk the current worker is checking
+	Sci_Position activeEnd = 0;
+	bool activeStale = false;		// chunk modified while the worker was running
+	UINT generation = 0;			// stamps jobs; bumped on stop and document change
+};
+
+SpellState spellState;
+volatile LONG spellJobRunning = FALSE;
+
+void SpellMarkDirty(Sci_Position start, Sci_Position end, UINT delay = spellCheckDelay) noexcept {
+	if (spellState.pendingStart < 0) {
+		spellState.pendingStart = start;
+		spellState.pendingEnd = end;
+	} else {
+		spellState.pendingStart = min(spellState.pendingStart, start);
+		spellState.pendingEnd = max(spellState.pendingEnd, end);
+	}
+	SetTimer(hwndMain, ID_SPELLTIMER, delay, nullptr);
+}
+
+constexpr bool IsWordByte(uint8_t ch) noexcept {
+	// non-ASCII bytes are letters as far as tokenizing goes; the checker
+	// decides what they mean in the document encoding.
+	return (ch >= 0x80) || IsAlphaNumeric(ch) || ch == '_';
+}
+
+// words that look like code rather than prose are skipped: digits or
+// underscores anywhere, or an upper case letter after the first character
+// (CamelCase identifiers, ALLCAPS acronyms).
+void ScanJob(SpellJob *job, ISpellChecker *checker) {
+	const std::string &text = job->text;
+	const size_t length = text.length();
+	std::unordered_map<std::wstring, bool> verdicts;
+	WCHAR wword[2*maxWordLength + 2];
+	size_t i = 0;
+	while (i < length) {
+		if (!IsWordByte(text[i])) {
+			i++;
+			continue;
+		}
+		const size_t wordStart = i;
+		bool identifier = false;
+		do {
+			const uint8_t ch = text[i];
+			if (ch == '\'') {
+				if (i + 1 >= length || !IsWordByte(text[i + 1])) {
+					break;
+				}
+			} else if ((ch >= '0' && ch <= '9') || ch == '_' || (i != wordStart && ch >= 'A' && ch <= 'Z')) {
+				identifier = true;
+			}
+			i++;
+		} while (i < length && (IsWordByte(text[i]) || text[i] == '\''));
+
+		const size_t wordLength = i - wordStart;
+		if (identifier || wordLength < minWordLength || wordLength > maxWordLength) {
+			continue;
+		}
+		if (!BitTestEx(job->styleMask, static_cast<uint8_t>(job->styles[wordStart]))) {
+			continue;
+		}
+		const int wlen = MultiByteToWideChar(job->cpEdit, 0, text.c_str() + wordStart,
+			static_cast<int>(wordLength), wword, COUNTOF(wword) - 1);
+		if (wlen <= 0) {
+			continue;
+		}
+		wword[wlen] = L'\0';
+
+		const auto [it, added] = verdicts.try_emplace(wword, false);
+		if (added) {
+			IEnumSpellingError *errors = nullptr;
+			if (SUCCEEDED(checker->Check(wword, &errors)) && errors != nullptr) {
+				ISpellingError *error = nullptr;
+				if (errors->Next(&error) == S_OK) {
+					it->second = true;
+					error->Release();
+				}
+				errors->Release();
+			}
+		}
+		if (it->second) {
+			job->misspelled.push_back({ job->start + static_cast<Sci_Position>(wordStart),
+				static_cast<Sci_Position>(wordLength) });
+		}
+	}
+}
+
+DWORD WINAPI SpellJobThreadProc(LPVOID param) noexcept {
+	SpellJob *job = static_cast<SpellJob *>(param);
+	const HRESULT hrInit = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+	ISpellChecker *checker = nullptr;
+	ISpellCheckerFactory *factory = nullptr;
+	// the Spell Checking API objects have no thread safety guarantees, so
+	// each worker run builds its own checker; chunks are debounced, the
+	// factory round trip is noise next to checking the words.
+	if (SUCCEEDED(CoCreateInstance(__uuidof(SpellCheckerFactory), nullptr,
+		CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory)))) {
+		WCHAR locale[LOCALE_NAME_MAX_LENGTH];
+		if (GetUserDefaultLocaleName(locale, COUNTOF(locale)) != 0) {
+			factory->CreateSpellChecker(locale, &checker);
+		}
+		factory->Release();
+	}
+	if (checker != nullptr) {
+		ScanJob(job, checker);
+		checker->Release();
+	} else {
+		job->unavailable = true;
+	}
+	if (SUCCEEDED(hrInit)) {
+		CoUninitialize();
+	}
+	PostMessage(hwndMain, APPM_SPELLREADY, 0, AsInteger<LPARAM>(job));
+	return 0;
+}
+
+}
+
+void EditSpellToggle() noexcept {
+	if (bSpellCheckEnabled) {
+		EditSpellStop();
+		return;
+	}
+	bSpellCheckEnabled = true;
+	EditSpellOnLexerChanged();
+}
+
+void EditSpellStop() noexcept {
+	KillTimer(hwndMain, ID_SPELLTIMER);
+	++spellState.generation;	// orphan any job still in flight
+	spellState.pendingStart = -1;
+	spellState.pendingEnd = -1;
+	spellState.activeStale = false;
+	if (bSpellCheckEnabled) {
+		bSpellCheckEnabled = false;
+		SciCall_SetIndicatorCurrent(IndicatorNumber_SpellCheck);
+		SciCall_IndicatorClearRange(0, SciCall_GetLength());
+	}
+}
+
+void EditSpellOnLexerChanged() noexcept {
+	if (!bSpellCheckEnabled) {
+		return;
+	}
+	++spellState.generation;
+	spellState.pendingStart = -1;
+	spellState.pendingEnd = -1;
+	spellState.activeStale = false;
+	SciCall_IndicSetStyle(IndicatorNumber_SpellCheck, INDIC_SQUIGGLE);
+	SciCall_IndicSetFore(IndicatorNumber_SpellCheck, RGB(0xE5, 0x1A, 0x1A));
+	SpellMarkDirty(0, SciCall_GetLength(), spellContinueDelay);
+}
+
+void EditSpellOnDocModified(Sci_Position start, Sci_Position end, Sci_Position delta) noexcept {
+	if (!bSpellCheckEnabled) {
+		return;
+	}
+	if (spellState.pendingStart >= 0 && spellState.pendingEnd > start) {
+		spellState.pendingEnd = max(start, spellState.pendingEnd + delta);
+	}
+	if (spellJobRunning && start < spellState.activeEnd) {
+		// the chunk being checked shifted or changed under the worker;
+		// its result will be discarded and the chunk re-queued.
+		spellState.activeStale = true;
+		spellState.activeStart = min(spellState.activeStart, start);
+		spellState.activeEnd = max(start, spellState.activeEnd + delta);
+	}
+	SpellMarkDirty(start, max(end, start + 1));
+}
+
+void EditSpellOnTimer() noexcept {
+	KillTimer(hwndMain, ID_SPELLTIMER);
+	if (!bSpellCheckEnabled || spellState.pendingStart < 0) {
+		return;
+	}
+	if (spellJobRunning) {
+		SetTimer(hwndMain, ID_SPELLTIMER, spellCheckDelay, nullptr);
+		return;
+	}
+
+	const Sci_Position docLength = SciCall_GetLength();
+	Sci_Position start = clamp<Sci_Position>(spellState.pendingStart, 0, docLength);
+	Sci_Position end = clamp<Sci_Position>(spellState.pendingEnd, start, docLength);
+	// whole lines so no word is split at either edge
+	start = SciCall_PositionFromLine(SciCall_LineFromPosition(start));
+	Sci_Position remainingEnd = -1;
+	if (end - start > spellChunkBytes) {
+		remainingEnd = end;
+		end = SciCall_PositionFromLine(SciCall_LineFromPosition(start + spellChunkBytes));
+		if (end <= start) {	// pathological single line longer than the chunk
+			end = min(start + spellChunkBytes, docLength);
+		}
+	} else {
+		end = min<Sci_Position>(SciCall_GetLineEndPosition(SciCall_LineFromPosition(end)), docLength);
+	}
+	if (remainingEnd > end) {
+		spellState.pendingStart = end;
+		spellState.pendingEnd = remainingEnd;
+	} else {
+		spellState.pendingStart = -1;
+		spellState.pendingEnd = -1;
+	}
+	if (end <= start) {
+		return;
+	}
+
+	SciCall_EnsureStyledTo(end);
+	SpellJob *job = new SpellJob;
+	job->generation = spellState.generation;
+	job->cpEdit = SciCall_GetCodePage();
+	job->start = start;
+	const Sci_Position length = end - start;
+	// interleaved character/style pairs, split for the worker
+	std::unique_ptr<char[]> styled = std::make_unique<char[]>(2*length + 2);
+	const Sci_TextRangeFull tr = { { start, end }, styled.get() };
+	SciCall_GetStyledTextFull(&tr);
+	job->text.resize(length);
+	job->styles.resize(length);
+	for (Sci_Position k = 0; k < length; k++) {
+		job->text[k] = styled[2*k];
+		job->styles[k] = styled[2*k + 1];
+	}
+	EditSpellGetCheckableStyles(job->styleMask);
+
+	spellState.activeStart = start;
+	spellState.activeEnd = end;
+	spellState.activeStale = false;
+	InterlockedExchange(&spellJobRunning, TRUE);
+	HANDLE hThread = CreateThread(nullptr, 0, SpellJobThreadProc, job, 0, nullptr);
+	if (hThread != nullptr) {
+		CloseHandle(hThread);
+	} else {
+		InterlockedExchange(&spellJobRunning, FALSE);
+		SpellMarkDirty(start, end);
+		delete job;
+	}
+}
+
+void EditSpellApplyResult(LPARAM lParam) noexcept {
+	SpellJob *job = AsPointer<SpellJob *>(lParam);
+	InterlockedExchange(&spellJobRunning, FALSE);
+	if (!bSpellCheckEnabled || job->generation != spellState.generation) {
+		delete job;
+		return;
+	}
+	if (job->unavailable) {
+		// no spell checker for the user locale (or pre-Win8 system)
+		EditSpellStop();
+		delete job;
+		return;
+	}
+	if (spellState.activeStale) {
+		SpellMarkDirty(spellState.activeStart, spellState.activeEnd);
+		delete job;
+		return;
+	}
+
+	SciCall_SetIndicatorCurrent(IndicatorNumber_SpellCheck);
+	SciCall_IndicatorClearRange(job->start, static_cast<Sci_Position>(job->text.length()));
+	if (!job->misspelled.empty()) {
+		// SpellRange is a sorted (start, length) pair, so the vector already
+		// is the flat list SCI_INDICATORFILLLIST takes: one fill, one redraw.
+		const Sci_RangeList list = { static_cast<Sci_Position>(job->misspelled.size()),
+			reinterpret_cast<const Sci_Position *>(job->misspelled.data()) };
+		SciCall_IndicatorFillList(&list);
+	}
+	delete job;
+	if (spellState.pendingStart >= 0) {
+		SetTimer(hwndMain, ID_SPELLTIMER, spellContinueDelay, nullptr);
+	}
+}
@@ -0,0 +1,32 @@
+/******************************************************************************
+*
+*
+* Notepad4
+*
+* EditSpell.h
+*   Background spell checking: comment, string and plain text words are
+*   checked with the Windows Spell Checking API on a worker thread and
+*   misspellings shown with a squiggle indicator.
+*
+* See License.txt for details about distribution and modification.
+*
+******************************************************************************/
+#pragma once
+
+extern bool bSpellCheckEnabled;
+
+void EditSpellToggle() noexcept;
+// orphans any worker still in flight and clears the squiggles
+void EditSpellStop() noexcept;
+// document replaced or lexer changed: the checkable style set is stale,
+// re-check everything
+void EditSpellOnLexerChanged() noexcept;
+// document range [start, end) changed (current coordinates), delta is the
+// signed length change; schedules a debounced re-check of the touched lines
+void EditSpellOnDocModified(Sci_Position start, Sci_Position end, Sci_Position delta) noexcept;
+void EditSpellOnTimer() noexcept;
+// APPM_SPELLREADY: a worker finished checking a chunk; apply the squiggles
+void EditSpellApplyResult(LPARAM lParam) noexcept;
+// ORed comment/string/plain text style bit masks for the current lexer,
+// maintained by InitAutoCompletionCache() in EditAutoC.cpp
+void EditSpellGetCheckableStyles(uint32_t (&styleMask)[8]) noexcept;
@@ -101,6 +101,299 @@ void IniClearAllSectionEx(LPCWSTR lpszPrefix, LPCWSTR lpszIniFile, bool bDelete)
 	}
 }
 
+//=============================================================================
+//
+// Cross-instance settings write lock. Every instance rewrites the whole INI
+// through the profile API when it saves; when many windows sharing one
+// profile close together the section writes interleave and each instance
+// stalls retrying on sharing violations inside WritePrivateProfileSection()
+// (hundreds of milliseconds each on network profiles). A mutex named after
+// the INI path serializes the complete save, so each instance sees the
+// previous writer's finished file before merging its own state on top.
+//
+static HANDLE hIniFileWriteMutex = nullptr;
+
+void BeginIniFileWrite() noexcept {
+	if (StrIsEmpty(szIniFile)) {
+		return;
+	}
+	if (hIniFileWriteMutex == nullptr) {
+		// derive the name from the case-folded path so only instances
+		// sharing the profile contend; backslashes are not valid in
+		// kernel object names, thus the path is folded into a hash.
+		UINT hash = 2166136261U;
+		LPCWSTR p = szIniFile;
+		while (*p) {
+			hash = (hash ^ LOWORD(CharUpper(AsPointer<LPWSTR, LONG_PTR>(*p++)))) * 16777619U;
+		}
+		WCHAR name[64];
+		wsprintf(name, L"Local\\Notepad4IniFile-%08X", hash);
+		hIniFileWriteMutex = CreateMutex(nullptr, FALSE, name);
+	}
+	if (hIniFileWriteMutex != nullptr) {
+		// on timeout save anyway: a torn file beats losing the settings.
+		WaitForSingleObject(hIniFileWriteMutex, 10000);
+	}
+}
+
+void EndIniFileWrite() noexcept {
+	if (hIniFileWriteMutex != nullptr) {
+		ReleaseMutex(hIniFileWriteMutex);
+	}
+}
+
+//=============================================================================
+//
+// In-memory ini file image shared by all profile reads against the same
+// file, so startup and lexer switching don't re-read and re-parse the whole
+// file on every GetPrivateProfileString() call (which is very slow for
+// roaming profiles). Each access validates the image against the file size
+// and last write time, so external edits and our own writes through the
+// profile API are picked up on the next read.
+//
+namespace {
+
+struct IniSectionIndexEntry {
+	LPCWSTR name;		// view into the image, terminated by the closing bracket
+	UINT nameLen;
+	LPCWSTR start;		// first line after the section header
+};
+
+struct IniFileCache {
+	FILETIME lastWrite;
+	DWORD size;			// file size in bytes
+	LPWSTR content;		// decoded text, NUL terminated
+	IniSectionIndexEntry *sections;	// built once per image, so repeated
+	UINT sectionCount;	// section reads don't rescan the whole file
+	WCHAR path[MAX_PATH];
+};
+
+// main settings file plus the active theme file
+IniFileCache iniFileCacheList[2];
+
+constexpr LPCWSTR IniCacheNextLine(LPCWSTR p) noexcept {
+	while (*p != L'\0' && *p != L'\n') {
+		++p;
+	}
+	if (*p == L'\n') {
+		++p;
+	}
+	return p;
+}
+
+void IniCacheBuildSectionIndex(IniFileCache *cache) noexcept {
+	UINT capacity = 64;
+	UINT count = 0;
+	IniSectionIndexEntry *sections = static_cast<IniSectionIndexEntry *>(NP2HeapAlloc(capacity*sizeof(IniSectionIndexEntry)));
+	LPCWSTR p = cache->content;
+	while (*p != L'\0') {
+		LPCWSTR line = p;
+		p = IniCacheNextLine(p);
+		while (*line == L' ' || *line == L'\t') {
+			++line;
+		}
+		if (*line == L'[') {
+			++line;
+			LPCWSTR end = line;
+			while (*end != L'\0' && *end != L']' && *end != L'\r' && *end != L'\n') {
+				++end;
+			}
+			if (*end == L']') {
+				if (count == capacity) {
+					capacity *= 2;
+					sections = static_cast<IniSectionIndexEntry *>(NP2HeapReAlloc(sections, capacity*sizeof(IniSectionIndexEntry)));
+				}
+				sections[count].name = line;
+				sections[count].nameLen = static_cast<UINT>(end - line);
+				sections[count].start = p;
+				++count;
+			}
+		}
+	}
+	cache->sections = sections;
+	cache->sectionCount = count;
+}
+
+LPCWSTR IniCacheFindSection(const IniFileCache *cache, LPCWSTR lpSection) noexcept {
+	const UINT sectionLen = static_cast<UINT>(lstrlen(lpSection));
+	for (UINT i = 0; i < cache->sectionCount; i++) {
+		const IniSectionIndexEntry &entry = cache->sections[i];
+		if (entry.nameLen == sectionLen && _wcsnicmp(entry.name, lpSection, sectionLen) == 0) {
+			return entry.start;
+		}
+	}
+	return nullptr;
+}
+
+const IniFileCache *IniCacheLoadFile(LPCWSTR lpFilePath) noexcept {
+	constexpr DWORD maxIniFileSize = 8*1024*1024;
+	WIN32_FILE_ATTRIBUTE_DATA attr;
+	if (StrIsEmpty(lpFilePath) || !GetFileAttributesEx(lpFilePath, GetFileExInfoStandard, &attr)
+		|| (attr.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0
+		|| attr.nFileSizeHigh != 0 || attr.nFileSizeLow > maxIniFileSize) {
+		return nullptr;
+	}
+
+	IniFileCache *cache = nullptr;
+	for (IniFileCache &entry : iniFileCacheList) {
+		if (entry.content == nullptr) {
+			if (cache == nullptr) {
+				cache = &entry;
+			}
+		} else if (_wcsicmp(entry.path, lpFilePath) == 0) {
+			if (entry.size == attr.nFileSizeLow && CompareFileTime(&entry.lastWrite, &attr.ftLastWriteTime) == 0) {
+				return &entry;
+			}
+			cache = &entry;
+			break;
+		}
+	}
+	if (cache == nullptr) {
+		cache = &iniFileCacheList[COUNTOF(iniFileCacheList) - 1];
+	}
+	if (cache->content != nullptr) {
+		NP2HeapFree(cache->content);
+		NP2HeapFree(cache->sections);
+		cache->content = nullptr;
+		cache->sections = nullptr;
+	}
+
+	HANDLE hFile = CreateFile(lpFilePath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+		nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE) {
+		return nullptr;
+	}
+	const DWORD cbData = attr.nFileSizeLow;
+	char *raw = static_cast<char *>(NP2HeapAlloc(cbData + 2));
+	DWORD cbRead = 0;
+	const BOOL success = ReadFile(hFile, raw, cbData, &cbRead, nullptr);
+	CloseHandle(hFile);
+	if (!success || cbRead != cbData) {
+		NP2HeapFree(raw);
+		return nullptr;
+	}
+
+	LPWSTR content;
+	if (cbData >= 2 && static_cast<unsigned char>(raw[0]) == 0xFF && static_cast<unsigned char>(raw[1]) == 0xFE) {
+		// UTF-16LE, the encoding WritePrivateProfileString() keeps the file in
+		content = static_cast<LPWSTR>(NP2HeapAlloc(cbData + 2));
+		memcpy(content, raw + 2, cbData - 2);
+	} else {
+		content = static_cast<LPWSTR>(NP2HeapAlloc((cbData + 1)*sizeof(WCHAR)));
+		MultiByteToWideChar(CP_ACP, 0, raw, cbData, content, cbData);
+	}
+	NP2HeapFree(raw);
+
+	lstrcpyn(cache->path, lpFilePath, COUNTOF(cache->path));
+	cache->lastWrite = attr.ftLastWriteTime;
+	cache->size = cbData;
+	cache->content = content;
+	IniCacheBuildSectionIndex(cache);
+	return cache;
+}
+
+}
+
+DWORD IniCacheGetSection(LPCWSTR lpSection, LPWSTR lpBuf, DWORD cchBuf, LPCWSTR lpFilePath) noexcept {
+	DWORD len = 0;
+	const IniFileCache *cache = IniCacheLoadFile(lpFilePath);
+	LPCWSTR p = (cache != nullptr) ? IniCacheFindSection(cache, lpSection) : nullptr;
+	if (p != nullptr) {
+		while (*p != L'\0') {
+			LPCWSTR line = p;
+			p = IniCacheNextLine(p);
+			while (*line == L' ' || *line == L'\t') {
+				++line;
+			}
+			if (*line == L'[') {
+				break;
+			}
+			if (*line == L';' || *line == L'\0' || *line == L'\r' || *line == L'\n') {
+				continue;
+			}
+			LPCWSTR lineEnd = line;
+			while (*lineEnd != L'\0' && *lineEnd != L'\r' && *lineEnd != L'\n') {
+				++lineEnd;
+			}
+			const DWORD lineLen = static_cast<DWORD>(lineEnd - line);
+			if (len + lineLen + 2 > cchBuf) {
+				break;
+			}
+			memcpy(lpBuf + len, line, lineLen*sizeof(WCHAR));
+			len += lineLen;
+			lpBuf[len++] = L'\0';
+		}
+	}
+	lpBuf[len] = L'\0';
+	return len;
+}
+
+DWORD IniCacheGetString(LPCWSTR lpSection, LPCWSTR lpName, LPCWSTR lpDefault, LPWSTR lpReturnedStr, DWORD nSize, LPCWSTR lpFilePath) noexcept {
+	LPCWSTR value = nullptr;
+	DWORD valueLen = 0;
+	const IniFileCache *cache = IniCacheLoadFile(lpFilePath);
+	LPCWSTR p = (cache != nullptr) ? IniCacheFindSection(cache, lpSection) : nullptr;
+	const int nameLen = lstrlen(lpName);
+	while (p != nullptr && *p != L'\0') {
+		LPCWSTR line = p;
+		p = IniCacheNextLine(p);
+		while (*line == L' ' || *line == L'\t') {
+			++line;
+		}
+		if (*line == L'[') {
+			break;
+		}
+		if (_wcsnicmp(line, lpName, nameLen) != 0) {
+			continue;
+		}
+		line += nameLen;
+		while (*line == L' ' || *line == L'\t') {
+			++line;
+		}
+		if (*line != L'=') {
+			continue;
+		}
+		++line;
+		while (*line == L' ' || *line == L'\t') {
+			++line;
+		}
+		LPCWSTR lineEnd = line;
+		while (*lineEnd != L'\0' && *lineEnd != L'\r' && *lineEnd != L'\n') {
+			++lineEnd;
+		}
+		while (lineEnd > line && (lineEnd[-1] == L' ' || lineEnd[-1] == L'\t')) {
+			--lineEnd;
+		}
+		// the profile API strips one pair of surrounding quotes
+		if (lineEnd - line > 1 && (*line == L'\"' || *line == L'\'') && lineEnd[-1] == *line) {
+			++line;
+			--lineEnd;
+		}
+		value = line;
+		valueLen = static_cast<DWORD>(lineEnd - line);
+		break;
+	}
+	if (value == nullptr) {
+		value = (lpDefault != nullptr) ? lpDefault : L"";
+		valueLen = lstrlen(value);
+	}
+	if (valueLen >= nSize) {
+		valueLen = nSize - 1;
+	}
+	memcpy(lpReturnedStr, value, valueLen*sizeof(WCHAR));
+	lpReturnedStr[valueLen] = L'\0';
+	return valueLen;
+}
+
+int IniCacheGetInt(LPCWSTR lpSection, LPCWSTR lpName, int iDefault, LPCWSTR lpFilePath) noexcept {
+	WCHAR tch[32];
+	int value;
+	if (IniCacheGetString(lpSection, lpName, nullptr, tch, COUNTOF(tch), lpFilePath) != 0 && CRTStrToInt(tch, &value)) {
+		return value;
+	}
+	return iDefault;
+}
+
 //=============================================================================
 //
 // Manipulation of (cached) ini file sections
@@ -108,13 +401,14 @@ void IniClearAllSectionEx(LPCWSTR lpszPrefix, LPCWSTR lpszIniFile, bool bDelete)
 void IniSectionParser::Init(UINT capacity_) noexcept {
 	count = 0;
 	capacity = capacity_;
-	head = nullptr;
-#if IniSectionParserUseSentinelNode
-	nodeList = static_cast<IniKeyValueNode *>(NP2HeapAlloc((capacity_ + 1) * sizeof(IniKeyValueNode)));
-	sentinel = &nodeList[capacity_];
-#else
-	nodeList = static_cast<IniKeyValueNode *>(NP2HeapAlloc(capacity_ * sizeof(IniKeyValueNode)));
-#endif
+	UINT bucketCount = 16;
+	while (bucketCount < capacity_) {
+		bucketCount *= 2;
+	}
+	bucketMask = bucketCount - 1;
+	// co-allocate the bucket array behind the nodes so Free() stays one call
+	nodeList = static_cast<IniKeyValueNode *>(NP2HeapAlloc(capacity_*sizeof(IniKeyValueNode) + bucketCount*sizeof(IniKeyValueNode *)));
+	buckets = reinterpret_cast<IniKeyValueNode **>(nodeList + capacity_);
 }
 
 bool IniSectionParser::ParseArray(LPWSTR lpCachedIniSection, BOOL quoted) noexcept {
@@ -178,17 +472,16 @@ bool IniSectionParser::Parse(LPWSTR lpCachedIniSection) noexcept {
 	}
 
 	count = index;
-	head = &nodeList[0];
-	--index;
-#if IniSectionParserUseSentinelNode
-	nodeList[index].next = sentinel;
-#else
-	nodeList[index].next = nullptr;
-#endif
-	while (index != 0) {
-		nodeList[index - 1].next = &nodeList[index];
+	// build the hash index; prepending in reverse keeps the first occurrence
+	// of a duplicate key in front of later ones, as the linear scan did.
+	memset(buckets, 0, (bucketMask + 1)*sizeof(IniKeyValueNode *));
+	do {
 		--index;
-	}
+		IniKeyValueNode &node = nodeList[index];
+		IniKeyValueNode **bucket = &buckets[(node.hash ^ (node.hash >> 8)) & bucketMask];
+		node.next = *bucket;
+		*bucket = &node;
+	} while (index != 0);
 	return true;
 }
 
@@ -198,36 +491,15 @@ LPCWSTR IniSectionParser::UnsafeGetValue(LPCWSTR key, int keyLen) noexcept {
 	}
 
 	const UINT hash = keyLen | ((*reinterpret_cast<const UINT *>(key)) << 8);
-	IniKeyValueNode *node = head;
+	IniKeyValueNode **bucket = &buckets[(hash ^ (hash >> 8)) & bucketMask];
+	IniKeyValueNode *node = *bucket;
 	IniKeyValueNode *prev = nullptr;
-#if IniSectionParserUseSentinelNode
-	sentinel->hash = hash;
-	while (true) {
-		if (node->hash == hash) {
-			if (node == sentinel) {
-				return nullptr;
-			}
-			if (StrEqual(node->key, key)) {
-				// remove the node
-				--count;
-				if (prev == nullptr) {
-					head = node->next;
-				} else {
-					prev->next = node->next;
-				}
-				return node->value;
-			}
-		}
-		prev = node;
-		node = node->next;
-	}
-#else
-	do {
+	while (node != nullptr) {
 		if (node->hash == hash && StrEqual(node->key, key)) {
 			// remove the node
 			--count;
 			if (prev == nullptr) {
-				head = node->next;
+				*bucket = node->next;
 			} else {
 				prev->next = node->next;
 			}
@@ -235,9 +507,8 @@ LPCWSTR IniSectionParser::UnsafeGetValue(LPCWSTR key, int keyLen) noexcept {
 		}
 		prev = node;
 		node = node->next;
-	} while (node);
+	}
 	return nullptr;
-#endif
 }
 
 void IniSectionParser::GetStringImpl(LPCWSTR key, int keyLen, LPCWSTR lpDefault, LPWSTR lpReturnedString, int cchReturnedString) noexcept {
@@ -343,16 +614,14 @@ int ParseCommaList(LPCWSTR str, int result[], int count) noexcept {
 
 	int index = 0;
 	while (index < count) {
-		LPWSTR end;
-		result[index] = static_cast<int>(wcstol(str, &end, 10));
-		if (str == end) {
+		int64_t value;
+		LPCWSTR end = ParseInt64(str, &value);
+		if (end == nullptr) {
 			break;
 		}
 
-		++index;
-		if (*end == L',') {
-			++end;
-		}
+		result[index++] = static_cast<int>(value);
+		end += (*end == L',');
 		str = end;
 	}
 	return index;
@@ -365,16 +634,14 @@ int ParseCommaList64(LPCWSTR str, int64_t result[], int count) noexcept {
 
 	int index = 0;
 	while (index < count) {
-		LPWSTR end;
-		result[index] = _wcstoi64(str, &end, 10);
-		if (str == end) {
+		int64_t value;
+		LPCWSTR end = ParseInt64(str, &value);
+		if (end == nullptr) {
 			break;
 		}
 
-		++index;
-		if (*end == L',') {
-			++end;
-		}
+		result[index++] = value;
+		end += (*end == L',');
 		str = end;
 	}
 	return index;
@@ -1409,10 +1676,10 @@ int Toolbar_SetButtons(HWND hwnd, LPCWSTR lpszButtons, LPCTBBUTTON ptbb, int ctb
 	LPCWSTR p = lpszButtons;
 	--ctbb;
 	while (true) {
-		LPWSTR end;
-		int iCmd = static_cast<int>(wcstol(p, &end, 10));
-		if (p != end) {
-			iCmd = clamp(iCmd, 0, ctbb);
+		int64_t value;
+		LPCWSTR end = ParseInt64(p, &value);
+		if (end != nullptr) {
+			const int iCmd = clamp(static_cast<int>(value), 0, ctbb);
 			SendMessage(hwnd, TB_ADDBUTTONS, 1, AsInteger<LPARAM>(&ptbb[iCmd]));
 			p = end;
 			++count;
@@ -2478,6 +2745,10 @@ void MRUList::Save() const noexcept {
 }
 
 void MRUList::MergeSave(bool keep) noexcept {
+	if (pszItems == nullptr) {
+		// never initialized: the deferred init was cut short by session end
+		return;
+	}
 	if (keep && iSize > 0 && StrNotEmpty(szIniFile)) {
 		LPWSTR * const current = pszItems;
 		const int count = iSize;
@@ -2995,6 +3266,36 @@ size_t Base64Encode(char *output, const uint8_t *src, size_t length, bool urlSaf
 
 	char *p = output;
 	size_t i = 0;
+#if NP2_USE_AVX2
+	// 24 input bytes to 32 output characters per iteration; the load reads
+	// a full vector, so stop while the extra tail bytes are still in bounds.
+	const __m256i lutOffset = urlSafe ? _mm256_broadcastsi128_si256(_mm_setr_epi8(
+		65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, '-' - 62, '_' - 63, 0, 0))
+		: _mm256_broadcastsi128_si256(_mm_setr_epi8(
+		65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, '+' - 62, '/' - 63, 0, 0));
+	while (i + sizeof(__m256i) <= length) {
+		__m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));
+		// spread the four 3-byte groups per lane into 4-byte groups
+		chunk = _mm256_permutevar8x32_epi32(chunk, _mm256_setr_epi32(0, 0, 1, 2, 3, 4, 5, 6));
+		chunk = _mm256_shuffle_epi8(chunk, _mm256_setr_epi8(
+			5, 4, 6, 5, 8, 7, 9, 8, 11, 10, 12, 11, 14, 13, 15, 14,
+			1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+		// extract the four 6-bit fields of each group into separate bytes
+		const __m256i t0 = _mm256_and_si256(chunk, _mm256_set1_epi32(0x0FC0FC00));
+		const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+		const __m256i t2 = _mm256_and_si256(chunk, _mm256_set1_epi32(0x003F03F0));
+		const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+		const __m256i indices = _mm256_or_si256(t1, t3);
+		// translate 0..63 to ASCII by class: A-Z, a-z, 0-9, the two symbols
+		__m256i classes = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+		classes = _mm256_sub_epi8(classes, _mm256_cmpgt_epi8(indices, _mm256_set1_epi8(25)));
+		const __m256i ascii = _mm256_add_epi8(indices, _mm256_shuffle_epi8(lutOffset, classes));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(p), ascii);
+		src += 24;
+		p += sizeof(__m256i);
+		i += 24;
+	}
+#endif // NP2_USE_AVX2
 	while (i + 3 <= length) {
 		i += 3;
 		const uint8_t C0 = *src++;
@@ -3033,6 +3334,45 @@ size_t Base64Decode(uint8_t *output, const uint8_t *src, size_t length) noexcept
 	uint32_t value = 0;
 	uint8_t *p = output;
 	size_t i = 0;
+#if NP2_USE_AVX2
+	// 32 characters to 24 bytes per iteration, both alphabets accepted;
+	// any other character sends the rest to the scalar loop below, which
+	// stops at the first character outside the alphabet. the vector loop
+	// always consumes whole quads, so the scalar loop starts in phase.
+	const __m256i lutLo = _mm256_broadcastsi128_si256(_mm_setr_epi8(
+		0x57, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07,
+		0x07, 0x07, 0x0F, -0x55, -0x51, -0x55, -0x51, -0x75));
+	const __m256i lutHi = _mm256_broadcastsi128_si256(_mm_setr_epi8(
+		0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, -0x80,
+		-1, -1, -1, -1, -1, -1, -1, -1));
+	const __m256i lutRoll = _mm256_broadcastsi128_si256(_mm_setr_epi8(
+		0, 16, 19, 4, -65, -65, -71, -71, 17, 0, 0, 0, 0, 0, -32, 0));
+	while (i + sizeof(__m256i) <= length) {
+		const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));
+		const __m256i hiNibbles = _mm256_and_si256(_mm256_srli_epi32(chunk, 4), _mm256_set1_epi8(0x0F));
+		const __m256i loNibbles = _mm256_and_si256(chunk, _mm256_set1_epi8(0x0F));
+		if (!_mm256_testz_si256(_mm256_shuffle_epi8(lutLo, loNibbles), _mm256_shuffle_epi8(lutHi, hiNibbles))) {
+			break;
+		}
+		// index the roll by high nibble, with the three characters that
+		// share a nibble group with another class steered to spare slots
+		__m256i roll = _mm256_add_epi8(hiNibbles, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('/')));
+		roll = _mm256_add_epi8(roll, _mm256_and_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('-')), _mm256_set1_epi8(6)));
+		roll = _mm256_add_epi8(roll, _mm256_and_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('_')), _mm256_set1_epi8(9)));
+		const __m256i sextets = _mm256_add_epi8(chunk, _mm256_shuffle_epi8(lutRoll, roll));
+		// pack the four 6-bit values in each dword into three bytes
+		const __m256i mergedPairs = _mm256_maddubs_epi16(sextets, _mm256_set1_epi32(0x01400140));
+		__m256i packed = _mm256_madd_epi16(mergedPairs, _mm256_set1_epi32(0x00011000));
+		packed = _mm256_shuffle_epi8(packed, _mm256_broadcastsi128_si256(_mm_setr_epi8(
+			2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1)));
+		packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 0, 0));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(p), _mm256_castsi256_si128(packed));
+		_mm_storel_epi64(reinterpret_cast<__m128i *>(p + 16), _mm256_extracti128_si256(packed, 1));
+		src += sizeof(__m256i);
+		p += 24;
+		i += sizeof(__m256i);
+	}
+#endif // NP2_USE_AVX2
 	while(i < length) {
 		uint8_t ch = *src;
 		if (static_cast<signed char>(ch) < 0) {
@@ -182,34 +182,117 @@ inline bool StrStartsWithCase(const char *s, const char (&t)[N]) noexcept {
 	return _strnicmp(s, t, N - 1) == 0;
 }
 
+// from_chars style numeric kernels. The CRT strto*() functions consult the
+// current locale on every call, which adds up over the thousands of values
+// parsed from the INI files at startup and on each scheme switch; these
+// accept exactly the decimal forms the settings files contain.
+inline LPCWSTR ParseInt64(LPCWSTR str, int64_t *value) noexcept {
+	while (*str == L' ' || *str == L'\t') {
+		++str;
+	}
+	const bool negative = *str == L'-';
+	str += (negative || *str == L'+');
+	LPCWSTR const digits = str;
+	uint64_t num = 0;
+	UINT diff;
+	while ((diff = *str - L'0') <= 9) {
+		num = num*10 + diff;
+		++str;
+	}
+	if (str == digits) {
+		return nullptr;
+	}
+	*value = static_cast<int64_t>(negative ? (0 - num) : num);
+	return str;
+}
+
 inline bool StrToFloat(LPCWSTR str, float *value) noexcept {
-	LPWSTR end;
-#if defined(__USE_MINGW_STRTOX)
-	// Fix GCC warning when defined __USE_MINGW_ANSI_STDIO as 1:
-	// 'wcstof' is static but used in inline function 'StrToFloat' which is not static.
-	*value = __mingw_wcstof(str, &end);
-#else
-	*value = wcstof(str, &end);
-#endif
-	return str != end;
+	while (*str == L' ' || *str == L'\t') {
+		++str;
+	}
+	const bool negative = *str == L'-';
+	str += (negative || *str == L'+');
+	LPCWSTR digits = str;
+	double num = 0;
+	UINT diff;
+	while ((diff = *str - L'0') <= 9) {
+		num = num*10 + diff;
+		++str;
+	}
+	if (*str == L'.') {
+		++str;
+		++digits; // a lone dot is not a number
+		double scale = 1;
+		while ((diff = *str - L'0') <= 9) {
+			num = num*10 + diff;
+			scale *= 10;
+			++str;
+		}
+		num /= scale;
+	}
+	if (str == digits) {
+		return false;
+	}
+	if ((*str | 0x20) == L'e') {
+		LPCWSTR p = str + 1;
+		const bool expNegative = *p == L'-';
+		p += (expNegative || *p == L'+');
+		int exponent = 0;
+		LPCWSTR const expDigits = p;
+		while ((diff = *p - L'0') <= 9) {
+			exponent = exponent*10 + static_cast<int>(diff);
+			++p;
+		}
+		if (p != expDigits) {
+			str = p;
+			double scale = 1;
+			for (; exponent >= 8; exponent -= 8) {
+				scale *= 1e8;
+			}
+			while (--exponent >= 0) {
+				scale *= 10;
+			}
+			num = expNegative ? num/scale : num*scale;
+		}
+	}
+	*value = static_cast<float>(negative ? -num : num);
+	return true;
 }
 
 inline bool CRTStrToInt(LPCWSTR str, int *value) noexcept {
-	LPWSTR end;
-	*value = static_cast<int>(wcstol(str, &end, 10));
-	return str != end;
+	int64_t num;
+	if (ParseInt64(str, &num) != nullptr) {
+		*value = static_cast<int>(num);
+		return true;
+	}
+	return false;
 }
 
 inline bool CRTStrToInt64(LPCWSTR str, int64_t *value) noexcept {
-	LPWSTR end;
-	*value = _wcstoi64(str, &end, 10);
-	return str != end;
+	return ParseInt64(str, value) != nullptr;
 }
 
 inline bool HexStrToInt(LPCWSTR str, int *value) noexcept {
-	LPWSTR end;
-	*value = static_cast<int>(wcstol(str, &end, 16));
-	return str != end;
+	LPCWSTR const digits = str;
+	uint32_t num = 0;
+	for (;;) {
+		const UINT ch = *str;
+		UINT diff = ch - L'0';
+		if (diff > 9) {
+			diff = (ch | 0x20) - L'a';
+			if (diff > 5) {
+				break;
+			}
+			diff += 10;
+		}
+		num = (num << 4) | diff;
+		++str;
+	}
+	if (str == digits) {
+		return false;
+	}
+	*value = static_cast<int>(num);
+	return true;
 }
 
 int ParseCommaList(LPCWSTR str, int result[], int count) noexcept;
@@ -407,10 +490,15 @@ inline int GetBitmapResourceIdForCurrentDPI(int resourceId) noexcept {
 #define NP2HeapFree(hMem)			HeapFree(g_hDefaultHeap, 0, (hMem))
 #define NP2HeapSize(hMem)			HeapSize(g_hDefaultHeap, 0, (hMem))
 
+// reads served from an in-memory image of the file, see Helpers.cpp
+DWORD IniCacheGetSection(LPCWSTR lpSection, LPWSTR lpBuf, DWORD cchBuf, LPCWSTR lpFilePath) noexcept;
+DWORD IniCacheGetString(LPCWSTR lpSection, LPCWSTR lpName, LPCWSTR lpDefault, LPWSTR lpReturnedStr, DWORD nSize, LPCWSTR lpFilePath) noexcept;
+int IniCacheGetInt(LPCWSTR lpSection, LPCWSTR lpName, int iDefault, LPCWSTR lpFilePath) noexcept;
+
 #define IniGetString(lpSection, lpName, lpDefault, lpReturnedStr, nSize) \
-	GetPrivateProfileString(lpSection, lpName, lpDefault, lpReturnedStr, nSize, szIniFile)
+	IniCacheGetString(lpSection, lpName, lpDefault, lpReturnedStr, nSize, szIniFile)
 #define IniGetInt(lpSection, lpName, nDefault) \
-	GetPrivateProfileInt(lpSection, lpName, nDefault, szIniFile)
+	IniCacheGetInt(lpSection, lpName, nDefault, szIniFile)
 #define IniSetString(lpSection, lpName, lpString) \
 	WritePrivateProfileString(lpSection, lpName, lpString, szIniFile)
 
@@ -422,6 +510,9 @@ void IniClearAllSectionEx(LPCWSTR lpszPrefix, LPCWSTR lpszIniFile, bool bDelete)
 #define IniClearAllSection(lpszPrefix)		IniClearAllSectionEx((lpszPrefix), szIniFile, false)
 #define IniDeleteAllSection(lpszPrefix)		IniClearAllSectionEx((lpszPrefix), szIniFile, true)
 
+void BeginIniFileWrite() noexcept;
+void EndIniFileWrite() noexcept;
+
 inline void IniSetInt(LPCWSTR lpSection, LPCWSTR lpName, int i) noexcept {
 	WCHAR tch[16];
 	_ltow(i, tch, 10);
@@ -445,7 +536,7 @@ inline void IniSetBoolEx(LPCWSTR lpSection, LPCWSTR lpName, bool b, bool bDefaul
 }
 
 #define LoadIniSection(lpSection, lpBuf, cchBuf) \
-	GetPrivateProfileSection(lpSection, lpBuf, cchBuf, szIniFile);
+	IniCacheGetSection(lpSection, lpBuf, cchBuf, szIniFile);
 #define SaveIniSection(lpSection, lpBuf) \
 	WritePrivateProfileSection(lpSection, lpBuf, szIniFile)
 
@@ -456,18 +547,12 @@ struct IniKeyValueNode {
 	LPCWSTR value;
 };
 
-// https://en.wikipedia.org/wiki/Sentinel_node
-// https://en.wikipedia.org/wiki/Sentinel_value
-#define IniSectionParserUseSentinelNode	1
-
 struct IniSectionParser {
 	UINT count;
 	UINT capacity;
-	IniKeyValueNode *head;
-#if IniSectionParserUseSentinelNode
-	IniKeyValueNode *sentinel;
-#endif
+	UINT bucketMask;
 	IniKeyValueNode *nodeList;
+	IniKeyValueNode **buckets;	// chained hash index over nodeList, built by Parse()
 
 	void Init(UINT capacity_) noexcept;
 	void Free() const noexcept {
@@ -475,7 +560,6 @@ struct IniSectionParser {
 	}
 	void Clear() noexcept {
 		count = 0;
-		head = nullptr;
 	}
 	bool ParseArray(LPWSTR lpCachedIniSection, BOOL quoted) noexcept;
 	bool Parse(LPWSTR lpCachedIniSection) noexcept;
@@ -29,12 +29,17 @@ struct IUnknown;
 #include <uxtheme.h>
 #include <cstdio>
 #include <cinttypes>
+#include "ILoader.h"
 #include "SciCall.h"
 #include "VectorISA.h"
 #include "config.h"
 #include "Helpers.h"
 #include "Notepad4.h"
 #include "Edit.h"
+#include "EditDiff.h"
+#include "EditHook.h"
+#include "EditPageView.h"
+#include "EditSpell.h"
 #include "Styles.h"
 #include "Dialogs.h"
 #include "resource.h"
@@ -55,11 +60,14 @@ HWND	hwndStatus;
 static HWND hwndToolbar;
 static HWND hwndReBar;
 static HMONITOR hCurrentMonitor = nullptr;
+static HWND hwndOverviewBar;
 HWND	hwndEdit;
+static HWND hwndSplitView = nullptr;
 HWND	hwndMain;
 static HMENU hmenuMain;
 static HWND hwndNextCBChain = nullptr;
 HWND	hDlgFindReplace = nullptr;
+HWND	hDlgFindInFiles = nullptr;
 static bool bInitDone = false;
 static HACCEL hAccMain;
 static HACCEL hAccFindReplace;
@@ -108,12 +116,19 @@ static bool bSaveSettings;
 bool	bSaveRecentFiles;
 int iMaxRecentFiles;
 static bool bSaveFindReplace;
+static bool bSaveFileViewStates;
+static void SaveFileViewState(LPCWSTR pszFile) noexcept;
+static void FlushFileViewStates() noexcept;
+static bool ResidentInstancePark(HWND hwnd) noexcept;
+static void InstanceTableSetParked(BOOL parked) noexcept;
 static WCHAR tchLastSaveCopyDir[MAX_PATH] = L"";
 WCHAR	tchOpenWithDir[MAX_PATH];
 WCHAR	tchFavoritesDir[MAX_PATH];
 static WCHAR tchDefaultDir[MAX_PATH];
 static WCHAR tchToolbarButtons[MAX_TOOLBAR_BUTTON_CONFIG_BUFFER_SIZE];
 static LPWSTR tchToolbarBitmap = nullptr;
+// toolbar bitmap kept until APPM_DEFERREDINIT builds the disabled image list
+static HBITMAP hbmpToolbarDeferred = nullptr;
 static TitlePathNameFormat iPathNameFormat;
 bool	fWordWrapG;
 int		iWordWrapMode;
@@ -124,6 +139,7 @@ bool	bWordWrapSelectSubLine;
 static bool bShowUnicodeControlCharacter;
 static bool bMatchBraces;
 static bool bShowIndentGuides;
+bool	bElasticTabStops;
 static bool bHighlightCurrentBlock;
 bool	bHighlightCurrentSubLine;
 LineHighlightMode iHighlightCurrentLine;
@@ -137,6 +153,7 @@ bool	bShowBookmarkMargin;
 static bool bShowLineNumbers;
 static int bMarkOccurrences;
 int	iChangeHistoryMarker;
+bool bVcsChangeMarkers;
 EditAutoCompletionConfig autoCompletionConfig;
 int iSelectOption;
 static int iLineSelectionMode;
@@ -163,6 +180,17 @@ extern int g_DOSEncoding;
 #if defined(_WIN64)
 bool	bLargeFileMode = false;
 #endif
+// longest and ~95th percentile line length of the current file, computed at
+// load; NP2_LONG_LINE_MITIGATION_LIMIT or more means the long line mitigations
+// are active, see FileLoad().
+static Sci_Position iMaxLineLength = 0;
+static Sci_Position iPercentileLineLength = 0;
+// document size at or above which FileLoad() allocates the UTF-32 line
+// character index: the line vector then keeps per-line character counts up
+// to date, so the selection statistics in the status bar only rescan the
+// partial lines at the selection ends, see Document::CountCharacters().
+#define NP2_CHARACTER_INDEX_LIMIT	(4*1024*1024)
+static bool bLineCharacterIndexAllocated = false;
 int		iDefaultEOLMode;
 static int iCurrentEOLMode;
 bool	bWarnLineEndings;
@@ -181,10 +209,13 @@ bool	bFileWatchingKeepAtEnd;
 bool	bResetFileWatching;
 static DWORD dwFileCheckInterval;
 static DWORD dwAutoReloadTimeout;
+static DWORD dwLargeFileWorkingSetMB;
 bool bUseXPFileDialog;
 static EscFunction iEscFunction;
 static bool bAlwaysOnTop;
 static bool bMinimizeToTray;
+static bool bResidentInstance;
+static bool bResidentParked;
 static bool bTransparentMode;
 static int	iEndAtLastLine;
 int iFindReplaceOption;
@@ -197,6 +228,7 @@ static bool bShowMenu;
 static bool bShowToolbar;
 static int iAutoScaleToolbar;
 static bool bShowStatusbar;
+static bool bShowOverviewBar;
 static bool bInFullScreenMode;
 static int iFullScreenMode;
 
@@ -248,6 +280,7 @@ static LPWSTR lpEncodingArg = nullptr;
 MRUList mruFile;
 MRUList mruFind;
 MRUList mruReplace;
+MRUList mruSavedFind;
 static BitmapCache bitmapCache;
 
 DWORD	dwLastIOError;
@@ -262,9 +295,13 @@ int iAutoSaveOption;
 DWORD dwAutoSavePeriod;
 static DWORD dwCurrentDocReversion = 0;
 static DWORD dwLastSavedDocReversion = 0;
+static DWORD dwAutoSaveDirtyBytes = 0;
+static DWORD dwAutoSavePeriodCurrent = 0;
+static DWORD dwAutoSaveLastChangeTick = 0;
 static bool bAutoSaveTimerSet = false;
 #define MaxAutoSaveCount	6	// normal
 #define AllAutoSaveCount	(MaxAutoSaveCount + 2) // suspend, shutdown
+#define AutoSaveAsyncWriteSize	(4*1024*1024)	// write periodic backup on a worker thread
 static LPWSTR autoSavePathList[AllAutoSaveCount];
 static int autoSaveCount = 0;
 static WCHAR szAutoSaveFolder[MAX_PATH];
@@ -304,6 +341,7 @@ extern CaretStyle iCaretStyle;
 extern bool bBlockCaretForOVRMode;
 extern bool bBlockCaretOutSelection;
 extern int iCaretBlinkPeriod;
+extern int iIdleStylingBudget;
 
 bool fIsElevated = false;
 static WCHAR wchWndClass[16] = WC_NOTEPAD4;
@@ -458,6 +496,12 @@ static void CleanUpResources(bool initialized) noexcept {
 	Encoding_ReleaseResources();
 	Style_ReleaseResources();
 	Edit_ReleaseResources();
+	if (StrNotEmpty(szIniFile)) {
+		WCHAR tchFontCache[MAX_PATH + 16];
+		lstrcpy(tchFontCache, szIniFile);
+		lstrcat(tchFontCache, L".np4-fonts");
+		Scintilla_SaveFontMetricsCache(tchFontCache);
+	}
 	Scintilla_ReleaseResources();
 
 	if (hTrayIcon) {
@@ -480,6 +524,11 @@ static void DispatchMessageMain(MSG *msg) noexcept {
 			return;
 		}
 	}
+	if (IsWindow(hDlgFindInFiles) && (msg->hwnd == hDlgFindInFiles || IsChild(hDlgFindInFiles, msg->hwnd))) {
+		if (IsDialogMessage(hDlgFindInFiles, msg)) {
+			return;
+		}
+	}
 
 	if (!TranslateAccelerator(hwndMain, hAccMain, msg)) {
 		TranslateMessage(msg);
@@ -495,6 +544,122 @@ BOOL WINAPI ConsoleHandlerRoutine(DWORD dwCtrlType) noexcept {
 	return FALSE;
 }
 
+// "Ctrl+Shift+K" -> accelerator key and modifier flags;
+// false on any unknown token so a typo never binds the wrong key.
+static bool ParseKeyChord(LPCWSTR chord, ACCEL &accel) noexcept {
+	static const struct {
+		LPCWSTR name;
+		WORD key;
+	} namedKeys[] = {
+		{ L"Up", VK_UP }, { L"Down", VK_DOWN }, { L"Left", VK_LEFT }, { L"Right", VK_RIGHT },
+		{ L"Home", VK_HOME }, { L"End", VK_END }, { L"PgUp", VK_PRIOR }, { L"PgDn", VK_NEXT },
+		{ L"Ins", VK_INSERT }, { L"Del", VK_DELETE }, { L"Tab", VK_TAB }, { L"Enter", VK_RETURN },
+		{ L"Esc", VK_ESCAPE }, { L"Space", VK_SPACE }, { L"Back", VK_BACK },
+		{ L"Plus", VK_OEM_PLUS }, { L"Minus", VK_OEM_MINUS },
+		{ L"Comma", VK_OEM_COMMA }, { L"Period", VK_OEM_PERIOD },
+	};
+
+	BYTE fVirt = FVIRTKEY | FNOINVERT;
+	WCHAR token[16];
+	while (*chord != L'\0') {
+		int len = 0;
+		while (*chord != L'\0' && *chord != L'+' && len < COUNTOF(token) - 1) {
+			token[len++] = *chord++;
+		}
+		token[len] = L'\0';
+		if (*chord == L'+') {
+			++chord;
+			if (StrCaseEqual(token, L"Ctrl")) {
+				fVirt |= FCONTROL;
+			} else if (StrCaseEqual(token, L"Shift")) {
+				fVirt |= FSHIFT;
+			} else if (StrCaseEqual(token, L"Alt")) {
+				fVirt |= FALT;
+			} else {
+				return false;
+			}
+			continue;
+		}
+
+		WORD key = 0;
+		if (len == 1) {
+			const WCHAR ch = (token[0] >= L'a' && token[0] <= L'z') ? (token[0] - L'a' + L'A') : token[0];
+			if ((ch >= L'A' && ch <= L'Z') || (ch >= L'0' && ch <= L'9')) {
+				key = ch; // virtual key codes match the character
+			}
+		} else if (len > 1 && (token[0] == L'F' || token[0] == L'f') && token[1] >= L'0' && token[1] <= L'9') {
+			const long n = wcstol(token + 1, nullptr, 10);
+			if (n >= 1 && n <= 24) {
+				key = static_cast<WORD>(VK_F1 + n - 1);
+			}
+		} else {
+			for (const auto &named : namedKeys) {
+				if (StrCaseEqual(token, named.name)) {
+					key = named.key;
+					break;
+				}
+			}
+		}
+		if (key == 0) {
+			return false;
+		}
+		accel.fVirt = fVirt;
+		accel.key = key;
+		return true;
+	}
+	return false;
+}
+
+// [Keybindings] section, Chord=CommandID with IDs as in resource.h, e.g.
+// "Ctrl+Shift+K=40422"; command 0 removes a stock binding. The main
+// accelerator table is rebuilt once here so the per-keystroke dispatch
+// cost does not change with user bindings.
+static void LoadUserKeybindings() noexcept {
+	IniSectionParser section;
+	WCHAR *pIniSectionBuf = static_cast<WCHAR *>(NP2HeapAlloc(sizeof(WCHAR) * MAX_INI_SECTION_SIZE_KEYBINDINGS));
+	const DWORD cchIniSection = static_cast<DWORD>(NP2HeapSize(pIniSectionBuf) / sizeof(WCHAR));
+
+	section.Init(64);
+	LoadIniSection(INI_SECTION_NAME_KEYBINDINGS, pIniSectionBuf, cchIniSection);
+	if (section.Parse(pIniSectionBuf)) {
+		const int count = CopyAcceleratorTable(hAccMain, nullptr, 0);
+		ACCEL *table = static_cast<ACCEL *>(NP2HeapAlloc(sizeof(ACCEL) * (count + section.count)));
+		int total = CopyAcceleratorTable(hAccMain, table, count);
+		for (UINT i = 0; i < section.count; i++) {
+			const IniKeyValueNode &node = section.nodeList[i];
+			ACCEL accel { FVIRTKEY, 0, 0 };
+			if (!ParseKeyChord(node.key, accel)) {
+				continue;
+			}
+			accel.cmd = static_cast<WORD>(wcstol(node.value, nullptr, 10));
+			int found = -1;
+			for (int k = 0; k < total; k++) {
+				if (table[k].key == accel.key && (table[k].fVirt | FNOINVERT) == accel.fVirt) {
+					found = k;
+					break;
+				}
+			}
+			if (accel.cmd == 0) {
+				if (found >= 0) {
+					table[found] = table[--total];
+				}
+			} else if (found >= 0) {
+				table[found].cmd = accel.cmd;
+			} else {
+				table[total++] = accel;
+			}
+		}
+		HACCEL hAccNew = CreateAcceleratorTable(table, total);
+		if (hAccNew != nullptr) {
+			hAccMain = hAccNew;
+		}
+		NP2HeapFree(table);
+	}
+
+	section.Free();
+	NP2HeapFree(pIniSectionBuf);
+}
+
 int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLine, int nShowCmd) {
 	UNREFERENCED_PARAMETER(hPrevInstance);
 	UNREFERENCED_PARAMETER(lpCmdLine);
@@ -631,6 +796,14 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLi
 	Scintilla_LoadDpiForWindow();
 #endif
 	Scintilla_RegisterClasses(hInstance);
+	if (StrNotEmpty(szIniFile)) {
+		// skip most of the DirectWrite font realization work for the static
+		// style set; saved back in CleanUpResources() when new fonts appear.
+		WCHAR tchFontCache[MAX_PATH + 16];
+		lstrcpy(tchFontCache, szIniFile);
+		lstrcat(tchFontCache, L".np4-fonts");
+		Scintilla_LoadFontMetricsCache(tchFontCache);
+	}
 
 	// Load Settings
 	LoadSettings();
@@ -646,6 +819,7 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLi
 	InitInstance(hInstance, nShowCmd);
 	hAccMain = LoadAccelerators(hInstance, MAKEINTRESOURCE(IDR_MAINWND));
 	hAccFindReplace = LoadAccelerators(hInstance, MAKEINTRESOURCE(IDR_ACCFINDREPLACE));
+	LoadUserKeybindings();
 	MSG msg;
 
 	while (true) {
@@ -1000,6 +1174,10 @@ static inline void NP2MinimizeWind(HWND hwnd) noexcept {
 }
 
 static inline void NP2RestoreWind(HWND hwnd) noexcept {
+	if (bResidentParked) {
+		bResidentParked = false;
+		InstanceTableSetParked(FALSE);
+	}
 	ShowNotifyIcon(hwnd, false);
 	RestoreWndFromTray(hwnd);
 	if (flagJumpTo) {
@@ -1011,6 +1189,9 @@ static inline void NP2RestoreWind(HWND hwnd) noexcept {
 
 static inline void ExitApplication(HWND hwnd) noexcept {
 	if (FileSave(FileSaveFlag_Ask)) {
+		if (bResidentInstance && !bResidentParked && ResidentInstancePark(hwnd)) {
+			return;
+		}
 		DestroyWindow(hwnd);
 	}
 }
@@ -1114,6 +1295,7 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT umsg, WPARAM wParam, LPARAM lParam)
 	case WM_ENDSESSION:
 		if (!bShutdownOK) {
 			editMarkAll.Stop();
+			EditPageViewStop();
 			AutoSave_Stop(TRUE);
 			// Terminate file watching
 			InstallFileWatching(true);
@@ -1129,17 +1311,33 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT umsg, WPARAM wParam, LPARAM lParam)
 			if (IsWindow(hDlgFindReplace)) {
 				DestroyWindow(hDlgFindReplace);
 			}
+			if (IsWindow(hDlgFindInFiles)) {
+				DestroyWindow(hDlgFindInFiles);
+			}
+
+			EditSaveStyleCache(szCurFile);
+			EditSaveUndoHistory(szCurFile);
+			SaveFileViewState(szCurFile);
 
+			// hold the cross-instance write lock over the whole save so a
+			// close-all doesn't interleave section writes from many windows
+			BeginIniFileWrite();
 			// call SaveSettings() when hwndToolbar is still valid
 			SaveSettings(false);
 
 			mruFile.MergeSave(bSaveRecentFiles);
 			mruFind.MergeSave(bSaveFindReplace);
 			mruReplace.MergeSave(bSaveFindReplace);
+			// saved searches are added deliberately, keep them regardless of
+			// the Save Find/Replace History setting
+			mruSavedFind.MergeSave(true);
+			FlushFileViewStates();
+			EndIniFileWrite();
 			bitmapCache.Empty();
 
 			// Remove tray icon if necessary
 			ShowNotifyIcon(hwnd, false);
+			InstanceTableUnregister();
 
 			bShutdownOK = true;
 		}
@@ -1200,7 +1398,11 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT umsg, WPARAM wParam, LPARAM lParam)
 
 	case WM_TIMER:
 		if (wParam == ID_AUTOSAVETIMER) {
-			AutoSave_DoWork(FileSaveFlag_Default);
+			AutoSave_OnTimer();
+		} else if (wParam == ID_DIFFTIMER) {
+			EditDiffOnTimer();
+		} else if (wParam == ID_SPELLTIMER) {
+			EditSpellOnTimer();
 		}
 		break;
 
@@ -1233,6 +1435,19 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT umsg, WPARAM wParam, LPARAM lParam)
 		//	PostMessage(hwnd, APPM_CHANGENOTIFY, 0, 0);
 		break;
 
+	// delayed rendering for EditCopyAppend()
+	case WM_RENDERFORMAT:
+		EditCopyAppendRender(static_cast<UINT>(wParam));
+		break;
+
+	case WM_RENDERALLFORMATS:
+		EditCopyAppendRenderAll(hwnd);
+		break;
+
+	case WM_DESTROYCLIPBOARD:
+		EditCopyAppendDestroy();
+		break;
+
 	case WM_DROPFILES:
 	case APPM_DROPFILES:
 		MsgDropFiles(hwnd, umsg, wParam);
@@ -1410,22 +1625,60 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT umsg, WPARAM wParam, LPARAM lParam)
 		}
 		return DefWindowProc(hwnd, umsg, wParam, lParam);
 
+	case APPM_DIFFREADY:
+		EditDiffApplyResult(lParam);
+		break;
+
+	case APPM_VCSDIFFREADY:
+		EditVcsDiffApplyResult(lParam);
+		break;
+
+	case APPM_SPELLREADY:
+		EditSpellApplyResult(lParam);
+		break;
+
+	case APPM_PAGEVIEWSCAN:
+		EditPageViewApplyScan(lParam);
+		break;
+
+	case APPM_MRUPATHSREADY:
+		MRUPathCacheApply(lParam);
+		break;
+
+	case APPM_AUTOSAVEFAILED:
+		// roll back the optimistic stamp unless a later save re-recorded it
+		if (dwLastSavedDocReversion == static_cast<DWORD>(wParam)) {
+			dwLastSavedDocReversion = static_cast<DWORD>(lParam);
+		}
+		break;
+
 	case APPM_CHANGENOTIFY:
+		if (iFileWatchingMode == FileWatchingMode_AutoReload && IsDocumentModified()
+			&& PathIsFile(szCurFile) && EditMergeDiskChanges(szCurFile)) {
+			// the external change touched only parts of the file we haven't
+			// edited and was spliced into the buffer with the edits intact.
+			if (!bRunningWatch) {
+				InstallFileWatching(false);
+			}
+			break;
+		}
 		if (iFileWatchingMode == FileWatchingMode_ShowMessage || IsDocumentModified()) {
 			SetForegroundWindow(hwnd);
 		}
 
 		if (PathIsFile(szCurFile)) {
-			if ((iFileWatchingMode == FileWatchingMode_AutoReload && !IsDocumentModified())
-				|| MsgBoxWarn(MB_YESNO, IDS_FILECHANGENOTIFY) == IDYES) {
+			const bool bAutoReload = iFileWatchingMode == FileWatchingMode_AutoReload && !IsDocumentModified();
+			if (bAutoReload || MsgBoxWarn(MB_YESNO, IDS_FILECHANGENOTIFY) == IDYES) {
 				const bool bIsTail = (iFileWatchingMode == FileWatchingMode_AutoReload)
 					&& (bFileWatchingKeepAtEnd || (SciCall_LineFromPosition(SciCall_GetCurrentPos()) + 1 == SciCall_GetLineCount()));
 
-				iWeakSrcEncoding = iCurrentEncoding;
-				if (FileLoad(static_cast<FileLoadFlag>(FileLoadFlag_DontSave | FileLoadFlag_Reload), szCurFile)) {
-					if (bIsTail) {
-						EditJumpTo(INVALID_POSITION, 0);
-					}
+				bool bOpened = bAutoReload && FileAutoReloadAppend();
+				if (!bOpened) {
+					iWeakSrcEncoding = iCurrentEncoding;
+					bOpened = FileLoad(static_cast<FileLoadFlag>(FileLoadFlag_DontSave | FileLoadFlag_Reload), szCurFile);
+				}
+				if (bOpened && bIsTail) {
+					EditJumpTo(INVALID_POSITION, 0);
 				}
 			}
 		} else {
@@ -1541,6 +1794,30 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT umsg, WPARAM wParam, LPARAM lParam)
 		SciCall_SetMultipleSelection(true);
 	} break;
 
+	case APPM_DEFERREDINIT:
+		// initialization staged out of MsgCreate() so the first paint isn't
+		// waiting on it; posted messages are handled before any user input.
+		if (mruFind.pszItems == nullptr) {
+			mruFind.Init(MRU_KEY_RECENT_FIND, MRU_MAXITEMS, MRUFlags_QuoteValue);
+			mruReplace.Init(MRU_KEY_RECENT_REPLACE, MRU_MAXITEMS, MRUFlags_QuoteValue);
+			mruSavedFind.Init(MRU_KEY_SAVED_FIND, MRU_MAX_SAVED_FIND, MRUFlags_QuoteValue);
+		}
+		if (hbmpToolbarDeferred != nullptr) {
+			HBITMAP hbmpCopy = static_cast<HBITMAP>(CopyImage(hbmpToolbarDeferred, IMAGE_BITMAP, 0, 0, LR_CREATEDIBSECTION));
+			DeleteObject(hbmpToolbarDeferred);
+			hbmpToolbarDeferred = nullptr;
+			if (BitmapAlphaBlend(hbmpCopy, GetSysColor(COLOR_3DFACE), 0x60)) {
+				BITMAP bmp;
+				GetObject(hbmpCopy, sizeof(BITMAP), &bmp);
+				HIMAGELIST himl = ImageList_Create(bmp.bmHeight, bmp.bmHeight, ILC_COLOR32 | ILC_MASK, 0, 0);
+				ImageList_AddMasked(himl, hbmpCopy, CLR_DEFAULT);
+				SendMessage(hwndToolbar, TB_SETDISABLEDIMAGELIST, 0, AsInteger<LPARAM>(himl));
+			}
+			DeleteObject(hbmpCopy);
+		}
+		AutoSave_CheckRecovery(hwnd);
+		break;
+
 	default:
 		if (umsg == msgTaskbarCreated) {
 			if (!IsWindowVisible(hwnd)) {
@@ -1644,7 +1921,7 @@ static inline void UpdateDocumentModificationStatus() noexcept {
 
 void UpdateBookmarkMarginWidth() noexcept {
 	// see LineMarker::Draw() for minDim.
-	const int width = (bShowBookmarkMargin || iChangeHistoryMarker != SC_CHANGE_HISTORY_DISABLED) ? SciCall_TextHeight() - 2 : 0;
+	const int width = (bShowBookmarkMargin || bVcsChangeMarkers || iChangeHistoryMarker != SC_CHANGE_HISTORY_DISABLED) ? SciCall_TextHeight() - 2 : 0;
 	// 16px for XPM bookmark symbol.
 	//const int width = (bShowBookmarkMargin || iChangeHistoryMarker != SC_CHANGE_HISTORY_DISABLED) ? max(SciCall_TextHeight() - 2, 16) : 0;
 	SciCall_SetMarginWidth(MarginNumber_Bookmark, width);
@@ -1712,6 +1989,17 @@ void EditCreate(HWND hwndParent) noexcept {
 		SetWindowLayoutRTL(hwnd, true);
 	}
 
+	// overview strip rendered from style runs and change history, it doubles as a scrollbar
+	hwndOverviewBar = CreateWindowEx(0,
+						  L"OverviewBar",
+						  nullptr,
+						  WS_CHILD | WS_CLIPSIBLINGS | (bShowOverviewBar ? WS_VISIBLE : 0),
+						  0, 0, 0, 0,
+						  hwndParent,
+						  AsPointer<HMENU, ULONG_PTR>(IDC_OVERVIEWBAR),
+						  g_hInstance,
+						  hwnd);
+
 	Style_InitDefaultColor();
 	SciCall_SetTechnology(iRenderingTechnology);
 	SciCall_SetBidirectional(iBidirectional);
@@ -1735,6 +2023,9 @@ void EditCreate(HWND hwndParent) noexcept {
 	SciCall_SetIdleStyling(SC_IDLESTYLING_ALL);
 	// profile lexer performance
 	//SciCall_SetIdleStyling(SC_IDLESTYLING_NONE);
+	if (iIdleStylingBudget != 0) {
+		SciCall_SetIdleStylingBudget(iIdleStylingBudget);
+	}
 
 	SciCall_AssignCmdKey((SCK_NEXT + (SCMOD_CTRL << 16)), SCI_PARADOWN);
 	SciCall_AssignCmdKey((SCK_PRIOR + (SCMOD_CTRL << 16)), SCI_PARAUP);
@@ -1825,6 +2116,179 @@ void EditReplaceDocument(HANDLE pdoc) noexcept {
 	SciCall_ReleaseDocument(pdoc);
 	SciCall_SetCodePage(cpEdit);
 	SciCall_SetEOLMode(iCurrentEOLMode);
+	if (hwndSplitView) {
+		// keep the second view on the live document
+		SendMessage(hwndSplitView, SCI_SETDOCPOINTER, 0, AsInteger<LPARAM>(pdoc));
+		SendMessage(hwndSplitView, SCI_SETCODEPAGE, cpEdit, 0);
+	}
+}
+
+//=============================================================================
+//
+// SplitViewToggle() - second view of the current document, the buffer is
+// shared so both panes cost one CellBuffer; Scintilla keeps the views
+// consistent through the document watchers.
+//
+static void SplitViewStop() noexcept {
+	if (hwndSplitView == nullptr) {
+		return;
+	}
+	DestroyWindow(hwndSplitView);	// releases its document reference
+	hwndSplitView = nullptr;
+	SendWMSize(hwndMain);
+}
+
+static void SplitViewToggle() noexcept {
+	if (hwndSplitView) {
+		SplitViewStop();
+		return;
+	}
+	EditDiffStop();
+	const DWORD dwExStyle = IsAppThemed() ? 0 : WS_EX_CLIENTEDGE;
+	hwndSplitView = CreateWindowEx(dwExStyle,
+						  L"Scintilla",
+						  nullptr,
+						  WS_CHILD | WS_VISIBLE | WS_CLIPSIBLINGS,
+						  0, 0, 0, 0,
+						  hwndMain,
+						  AsPointer<HMENU, ULONG_PTR>(IDC_SPLITVIEW),
+						  g_hInstance,
+						  nullptr);
+	if (hwndSplitView == nullptr) {
+		return;
+	}
+	SendMessage(hwndSplitView, SCI_SETDOCPOINTER, 0, AsInteger<LPARAM>(SciCall_GetDocPointer()));
+	// mirror the display basics of the main view; the second pane is shown
+	// as plain text, it gets no lexer of its own.
+	SendMessage(hwndSplitView, SCI_SETTECHNOLOGY, SciCall_GetTechnology(), 0);
+	SendMessage(hwndSplitView, SCI_SETCODEPAGE, SciCall_GetCodePage(), 0);
+	char fontName[LF_FACESIZE*kMaxMultiByteCount]{};
+	SciCall_StyleGetFont(STYLE_DEFAULT, fontName);
+	SendMessage(hwndSplitView, SCI_STYLESETFONT, STYLE_DEFAULT, AsInteger<LPARAM>(fontName));
+	SendMessage(hwndSplitView, SCI_STYLESETSIZEFRACTIONAL, STYLE_DEFAULT, SciCall(SCI_STYLEGETSIZEFRACTIONAL, STYLE_DEFAULT, 0));
+	SendMessage(hwndSplitView, SCI_STYLESETFORE, STYLE_DEFAULT, SciCall(SCI_STYLEGETFORE, STYLE_DEFAULT, 0));
+	SendMessage(hwndSplitView, SCI_STYLESETBACK, STYLE_DEFAULT, SciCall(SCI_STYLEGETBACK, STYLE_DEFAULT, 0));
+	SendMessage(hwndSplitView, SCI_STYLECLEARALL, 0, 0);
+	SendMessage(hwndSplitView, SCI_SETMARGINWIDTHN, MarginNumber_LineNumber, SciCall_GetMarginWidth(MarginNumber_LineNumber));
+	SendMessage(hwndSplitView, SCI_SETZOOM, SciCall_GetZoom(), 0);
+	SendWMSize(hwndMain);
+}
+
+//=============================================================================
+//
+// Macro recording and batched replay. SCN_MACRORECORD actions are captured
+// verbatim and replayed through SCI_EXECUTEBATCH, so a whole run of the macro
+// costs one entry into the window procedure with notifications and redraw
+// suppressed until the end.
+//
+struct MacroAction {
+	UINT message;
+	UINT_PTR wParam;
+	LONG_PTR lParam;
+	char *text;		// owned copy for string-carrying messages
+};
+
+static struct {
+	MacroAction *actions;
+	UINT count;
+	UINT capacity;
+	bool recording;
+} macro;
+
+static constexpr bool MacroMessageHasText(UINT message) noexcept {
+	return message == SCI_REPLACESEL || message == SCI_ADDTEXT || message == SCI_INSERTTEXT
+		|| message == SCI_APPENDTEXT || message == SCI_SEARCHNEXT || message == SCI_SEARCHPREV;
+}
+
+static void MacroClear() noexcept {
+	for (UINT i = 0; i < macro.count; i++) {
+		if (macro.actions[i].text != nullptr) {
+			NP2HeapFree(macro.actions[i].text);
+		}
+	}
+	macro.count = 0;
+}
+
+static void MacroRecordAction(const SCNotification *scn) noexcept {
+	if (macro.count == macro.capacity) {
+		macro.capacity = macro.capacity ? macro.capacity*2 : 64;
+		macro.actions = static_cast<MacroAction *>(macro.actions
+			? NP2HeapReAlloc(macro.actions, macro.capacity*sizeof(MacroAction))
+			: NP2HeapAlloc(macro.capacity*sizeof(MacroAction)));
+	}
+	MacroAction &action = macro.actions[macro.count++];
+	action.message = scn->message;
+	action.wParam = scn->wParam;
+	action.lParam = scn->lParam;
+	action.text = nullptr;
+	if (scn->lParam != 0 && MacroMessageHasText(scn->message)) {
+		const char * const text = AsPointer<const char *>(scn->lParam);
+		// SCI_ADDTEXT and SCI_APPENDTEXT carry the length in wParam and the
+		// text need not be terminated within it.
+		const size_t length = (scn->message == SCI_ADDTEXT || scn->message == SCI_APPENDTEXT)
+			? scn->wParam : strlen(text);
+		action.text = static_cast<char *>(NP2HeapAlloc(length + 1));
+		memcpy(action.text, text, length);
+	}
+}
+
+static void MacroToggleRecord() noexcept {
+	if (macro.recording) {
+		macro.recording = false;
+		SciCall_StopRecord();
+	} else {
+		MacroClear();
+		macro.recording = true;
+		SciCall_StartRecord();
+	}
+}
+
+static void MacroPlay(bool untilDocumentEnd) noexcept {
+	if (macro.recording || macro.count == 0) {
+		return;
+	}
+	Sci_MessageRecord *records = static_cast<Sci_MessageRecord *>(NP2HeapAlloc(macro.count*sizeof(Sci_MessageRecord)));
+	for (UINT i = 0; i < macro.count; i++) {
+		const MacroAction &action = macro.actions[i];
+		records[i] = { action.message, action.wParam,
+			action.text ? AsInteger<LONG_PTR>(action.text) : action.lParam };
+	}
+
+	const Sci_Position lengthBefore = SciCall_GetLength();
+	const Sci_Line linesBefore = SciCall_GetLineCount();
+	// one undo group and one redraw/notification cycle around all runs
+	SciCall_BeginBatchUpdate();
+	Sci_Position prevPos = SciCall_GetCurrentPos();
+	for (;;) {
+		SciCall_ExecuteBatch(macro.count, records);
+		if (!untilDocumentEnd) {
+			break;
+		}
+		const Sci_Position pos = SciCall_GetCurrentPos();
+		// repeating requires forward progress so a macro that doesn't
+		// advance the caret can't spin forever
+		if (pos <= prevPos || pos >= SciCall_GetLength()
+			|| SciCall_LineFromPosition(pos) >= SciCall_GetLineCount() - 1) {
+			break;
+		}
+		prevPos = pos;
+	}
+	SciCall_EndBatchUpdate();
+	NP2HeapFree(records);
+	SciCall_ScrollCaret();
+
+	// per-action SCN_MODIFIED was suppressed: bring dependent state up to date
+	const Sci_Position length = SciCall_GetLength();
+	EditMarkDirtyRange(0, length);
+	editMarkAll.OnModified(0, length, length - lengthBefore);
+	EditDiffOnDocModified(0, length, SciCall_GetLineCount() - linesBefore, false);
+	EditSpellOnDocModified(0, length, length - lengthBefore);
+	EditCompleteWordInvalidateCache(0, 0, false);
+	UpdateStatusBarCacheLineColumn();
+	UpdateLineNumberWidth();
+	AutoSave_OnModified(length);
+	UpdateToolbar();
+	UpdateStatusbar();
 }
 
 //=============================================================================
@@ -1835,6 +2299,7 @@ void EditReplaceDocument(HANDLE pdoc) noexcept {
 LRESULT MsgCreate(HWND hwnd, WPARAM wParam, LPARAM lParam) noexcept {
 	UNREFERENCED_PARAMETER(wParam);
 	hwndMain = hwnd;
+	InstanceTableRegister(hwnd);
 	g_uCurrentDPI = GetWindowDPI(hwnd);
 	hmenuMain = GetMenu(hwnd);
 	hCurrentMonitor = MonitorFromWindow(hwnd, MONITOR_DEFAULTTONEAREST);
@@ -1871,11 +2336,11 @@ LRESULT MsgCreate(HWND hwnd, WPARAM wParam, LPARAM lParam) noexcept {
 #endif
 	DragAcceptFiles(hwnd, TRUE);
 
-	// File MRU
+	// File MRU, needed for the files opened from the command line;
+	// the find / replace history waits for APPM_DEFERREDINIT.
 	const int flags = MRUFlags_FilePath | (static_cast<int>(flagRelativeFileMRU) * MRUFlags_RelativePath) | (static_cast<int>(flagPortableMyDocs) * MRUFlags_PortableMyDocs);
 	mruFile.Init(MRU_KEY_RECENT_FILES, iMaxRecentFiles, flags);
-	mruFind.Init(MRU_KEY_RECENT_FIND, MRU_MAXITEMS, MRUFlags_QuoteValue);
-	mruReplace.Init(MRU_KEY_RECENT_REPLACE, MRU_MAXITEMS, MRUFlags_QuoteValue);
+	MRUPathCacheRefresh();
 	return 0;
 }
 
@@ -1919,16 +2384,16 @@ void CreateBars(HWND hwnd, HINSTANCE hInstance) noexcept {
 	SendMessage(hwndToolbar, TB_SETIMAGELIST, 0, AsInteger<LPARAM>(himl));
 
 	if (internalBitmap) {
-		HBITMAP hbmpCopy = static_cast<HBITMAP>(CopyImage(hbmp, IMAGE_BITMAP, 0, 0, LR_CREATEDIBSECTION));
-		const bool fProcessed = BitmapAlphaBlend(hbmpCopy, GetSysColor(COLOR_3DFACE), 0x60);
-		if (fProcessed) {
-			himl = ImageList_Create(bmp.bmHeight, bmp.bmHeight, ILC_COLOR32 | ILC_MASK, 0, 0);
-			ImageList_AddMasked(himl, hbmpCopy, CLR_DEFAULT);
-			SendMessage(hwndToolbar, TB_SETDISABLEDIMAGELIST, 0, AsInteger<LPARAM>(himl));
+		// the grayed copy is only painted once a button gets disabled:
+		// blend it after the window is up instead of before first paint.
+		if (hbmpToolbarDeferred != nullptr) {
+			DeleteObject(hbmpToolbarDeferred);
 		}
-		DeleteObject(hbmpCopy);
+		hbmpToolbarDeferred = hbmp;
+		PostMessage(hwnd, APPM_DEFERREDINIT, 0, 0);
+	} else {
+		DeleteObject(hbmp);
 	}
-	DeleteObject(hbmp);
 
 #if NP2_ENABLE_CUSTOMIZE_TOOLBAR_LABELS
 	// Load toolbar labels
@@ -2129,7 +2594,22 @@ void MsgSize(HWND hwnd, WPARAM wParam, LPARAM lParam) noexcept {
 		cy -= (rc.bottom - rc.top);
 	}
 
-	SetWindowPos(hwndEdit, nullptr, x, y, cx, cy, SWP_NOZORDER | SWP_NOACTIVATE);
+	int cxEdit = cx;
+	if (bShowOverviewBar) {
+		const int cxBar = 2*SystemMetricsForDpi(SM_CXVSCROLL, g_uCurrentDPI);
+		cxEdit -= cxBar;
+		SetWindowPos(hwndOverviewBar, nullptr, cxEdit, y, cxBar, cy, SWP_NOZORDER | SWP_NOACTIVATE);
+	}
+	if (EditDiffActive()) {
+		EditDiffLayout(x, y, cxEdit, cy);
+	} else if (hwndSplitView) {
+		const int cxSplitter = SystemMetricsForDpi(SM_CXBORDER, g_uCurrentDPI)*2;
+		const int cxLeft = (cxEdit - cxSplitter)/2;
+		SetWindowPos(hwndEdit, nullptr, x, y, cxLeft, cy, SWP_NOZORDER | SWP_NOACTIVATE);
+		SetWindowPos(hwndSplitView, nullptr, x + cxLeft + cxSplitter, y, cxEdit - cxLeft - cxSplitter, cy, SWP_NOZORDER | SWP_NOACTIVATE);
+	} else {
+		SetWindowPos(hwndEdit, nullptr, x, y, cxEdit, cy, SWP_NOZORDER | SWP_NOACTIVATE);
+	}
 
 	// resize Statusbar items
 	UpdateStatusbar();
@@ -2300,9 +2780,84 @@ void MsgNotifyZoom() noexcept {
 	UpdateFoldMarginWidth();
 	SciCall_SetFirstVisibleLine(iVisTopLine);
 	SciCall_EnsureVisible(iDocTopLine);
+	// cell widths scale with the font, recompute the solved band
+	EditElasticTabStops(bElasticTabStops);
 	UpdateStatusbar();
 }
 
+//=============================================================================
+//
+// MRUPathCache - recent file existence resolved off the UI thread.
+// PathIsFile() on a dead network share blocks for seconds, so the recent
+// files UI never probes the disk itself: it renders immediately from the
+// last known (stale-allowed) state and a worker re-resolves the entries.
+//
+struct MRUExistsJob {
+	LONG generation;
+	UINT count;
+	TripleBoolean exists[MRU_MAXITEMS];
+	WCHAR paths[MRU_MAXITEMS][MAX_PATH];
+};
+
+static struct {
+	LONG generation;	// stamps jobs; a refresh orphans older results
+	UINT count;
+	TripleBoolean exists[MRU_MAXITEMS];
+	WCHAR paths[MRU_MAXITEMS][MAX_PATH];
+} mruPathCache;
+
+static DWORD WINAPI MRUPathsThreadProc(LPVOID lpParam) noexcept {
+	MRUExistsJob * const job = static_cast<MRUExistsJob *>(lpParam);
+	// every entry may sit on a dead share; stop probing when the budget is
+	// gone and leave the rest unresolved rather than queueing up stalls.
+	const ULONGLONG deadline = GetTickCount64() + 2000;
+	for (UINT i = 0; i < job->count; i++) {
+		if (job->generation != mruPathCache.generation || GetTickCount64() > deadline) {
+			break;
+		}
+		job->exists[i] = PathIsFile(job->paths[i]) ? TripleBoolean_True : TripleBoolean_False;
+	}
+	PostMessage(hwndMain, APPM_MRUPATHSREADY, 0, AsInteger<LPARAM>(job));
+	return 0;
+}
+
+void MRUPathCacheRefresh() noexcept {
+	MRUExistsJob * const job = static_cast<MRUExistsJob *>(NP2HeapAlloc(sizeof(MRUExistsJob)));
+	job->generation = InterlockedIncrement(&mruPathCache.generation);
+	const UINT count = min<UINT>(max(mruFile.iSize, 0), MRU_MAXITEMS);
+	job->count = count;
+	for (UINT i = 0; i < count; i++) {
+		job->exists[i] = TripleBoolean_NotSet;
+		lstrcpyn(job->paths[i], mruFile.pszItems[i], MAX_PATH);
+	}
+	HANDLE hThread = CreateThread(nullptr, 0, MRUPathsThreadProc, job, 0, nullptr);
+	if (hThread != nullptr) {
+		CloseHandle(hThread);
+	} else {
+		// no worker: keep the previous state rather than probing here
+		NP2HeapFree(job);
+	}
+}
+
+void MRUPathCacheApply(LPARAM lParam) noexcept {
+	MRUExistsJob * const job = AsPointer<MRUExistsJob *>(lParam);
+	if (job->generation == mruPathCache.generation) {
+		mruPathCache.count = job->count;
+		memcpy(mruPathCache.exists, job->exists, sizeof(job->exists));
+		memcpy(mruPathCache.paths, job->paths, sizeof(job->paths));
+	}
+	NP2HeapFree(job);
+}
+
+TripleBoolean MRUPathCacheLookup(LPCWSTR path) noexcept {
+	for (UINT i = 0; i < mruPathCache.count; i++) {
+		if (PathEqual(path, mruPathCache.paths[i])) {
+			return mruPathCache.exists[i];
+		}
+	}
+	return TripleBoolean_NotSet;
+}
+
 //=============================================================================
 //
 // MsgInitMenu() - Handles WM_INITMENU
@@ -2333,6 +2888,13 @@ void MsgInitMenu(HWND hwnd, WPARAM wParam, LPARAM lParam) noexcept {
 	}
 
 	EnableCmd(hmenu, IDM_FILE_SAVE, IsDocumentModified());
+	CheckCmd(hmenu, IDM_FILE_COMPARE, EditDiffActive());
+	CheckCmd(hmenu, IDM_VIEW_SPLITVIEW, hwndSplitView != nullptr);
+	CheckCmd(hmenu, IDM_VIEW_SPELLCHECK, bSpellCheckEnabled);
+	CheckCmd(hmenu, IDM_EDIT_MACRO_RECORD, macro.recording);
+	EnableCmd(hmenu, IDM_EDIT_MACRO_PLAY, macro.count != 0 && !macro.recording);
+	EnableCmd(hmenu, IDM_EDIT_MACRO_PLAY_TOEND, macro.count != 0 && !macro.recording);
+	EnableCmd(hmenu, IDM_EDIT_SCRIPT_HOOK, !bReadOnlyMode);
 #if defined(_WIN64)
 	DisableCmd(hmenu, IDM_FILE_LARGE_FILE_MODE, bLargeFileMode);
 	DisableCmd(hmenu, IDM_FILE_LARGE_FILE_MODE_RELOAD, bLargeFileMode);
@@ -2400,6 +2962,7 @@ void MsgInitMenu(HWND hwnd, WPARAM wParam, LPARAM lParam) noexcept {
 		IDM_EDIT_GOTO_PREV_SIBLING_BLOCK,
 		IDM_EDIT_REPLACE,
 		IDM_EDIT_REPLACENEXT,
+		IDM_EDIT_SAVEDSEARCH_ADD,
 		IDM_EDIT_SAVEFIND,
 		IDM_EDIT_SELECTALL,
 		IDM_EDIT_SELECTLINE,
@@ -2414,6 +2977,8 @@ void MsgInitMenu(HWND hwnd, WPARAM wParam, LPARAM lParam) noexcept {
 	for (unsigned k = 0; k < COUNTOF(menuRequiresDoc); k++) {
 		EnableCmd(hmenu, menuRequiresDoc[k], nonEmpty);
 	}
+	EnableCmd(hmenu, IDM_EDIT_SAVEDSEARCH_LIST, nonEmpty && mruSavedFind.iSize > 0);
+	EnableCmd(hmenu, IDM_EDIT_SAVEDSEARCH_MARKALL, nonEmpty && mruSavedFind.iSize > 0);
 
 	const bool hasSel = !SciCall_IsSelectionEmpty();
 	static const uint16_t menuRequiresSelection[] = {
@@ -2477,6 +3042,7 @@ void MsgInitMenu(HWND hwnd, WPARAM wParam, LPARAM lParam) noexcept {
 	for (unsigned k = 0; k < COUNTOF(menuRequiresSelection); k++) {
 		EnableCmd(hmenu, menuRequiresSelection[k], hasSel);
 	}
+	CheckCmd(hmenu, IDM_EDIT_HEX_VIEW, bHexViewMode);
 
 	const bool canPaste = SciCall_CanPaste();
 	EnableCmd(hmenu, IDM_EDIT_PASTE, canPaste);
@@ -2507,9 +3073,11 @@ void MsgInitMenu(HWND hwnd, WPARAM wParam, LPARAM lParam) noexcept {
 	CheckCmd(hmenu, IDM_VIEW_LONGLINEMARKER, bMarkLongLines);
 	CheckCmd(hmenu, IDM_VIEW_TABSASSPACES, fvCurFile.bTabsAsSpaces);
 	CheckCmd(hmenu, IDM_VIEW_SHOWINDENTGUIDES, bShowIndentGuides);
+	CheckCmd(hmenu, IDM_VIEW_ELASTICTABSTOPS, bElasticTabStops);
 	CheckCmd(hmenu, IDM_VIEW_LINENUMBERS, bShowLineNumbers);
 	CheckCmd(hmenu, IDM_VIEW_MARGIN, bShowBookmarkMargin);
 	CheckCmd(hmenu, IDM_VIEW_CHANGE_HISTORY_MARKER, iChangeHistoryMarker);
+	CheckCmd(hmenu, IDM_VIEW_VCS_CHANGE_MARKERS, bVcsChangeMarkers);
 	CheckCmd(hmenu, IDM_VIEW_AUTOCOMPLETION_IGNORECASE, autoCompletionConfig.bIgnoreCase);
 	CheckCmd(hmenu, IDM_SET_LATEX_INPUT_METHOD, autoCompletionConfig.bLaTeXInputMethod);
 	CheckCmd(hmenu, IDM_SET_MULTIPLE_SELECTION, iSelectOption & SelectOption_EnableMultipleSelection);
@@ -2541,6 +3109,8 @@ void MsgInitMenu(HWND hwnd, WPARAM wParam, LPARAM lParam) noexcept {
 	CheckCmd(hmenu, IDM_VIEW_USE_LARGE_TOOLBAR, iAutoScaleToolbar > USER_DEFAULT_SCREEN_DPI);
 #endif
 	CheckCmd(hmenu, IDM_VIEW_STATUSBAR, bShowStatusbar);
+	CheckCmd(hmenu, IDM_VIEW_OVERVIEWBAR, bShowOverviewBar);
+	CheckCmd(hmenu, IDM_HELP_PAINT_PROFILER, SciCall_GetPaintProfiler());
 #if NP2_ENABLE_APP_LOCALIZATION_DLL
 	CheckMenuRadioItem(hmenu, IDM_LANG_USER_DEFAULT, IDM_LANG_LAST_LANGUAGE, languageMenu, MF_BYCOMMAND);
 #endif
@@ -2677,6 +3247,42 @@ LRESULT MsgCommand(HWND hwnd, WPARAM wParam, LPARAM lParam) {
 		}
 		break;
 
+	case IDM_FILE_COMPARE:
+		if (EditDiffActive()) {
+			EditDiffStop();
+		} else {
+			WCHAR tchFile[MAX_PATH];
+			if (OpenFileDlg(tchFile, COUNTOF(tchFile), nullptr)) {
+				SplitViewStop();
+				EditDiffStart(tchFile);
+			}
+		}
+		break;
+
+	case IDM_VIEW_SPLITVIEW:
+		SplitViewToggle();
+		break;
+
+	case IDM_VIEW_SPELLCHECK:
+		EditSpellToggle();
+		break;
+
+	case IDM_EDIT_MACRO_RECORD:
+		MacroToggleRecord();
+		break;
+
+	case IDM_EDIT_MACRO_PLAY:
+		MacroPlay(false);
+		break;
+
+	case IDM_EDIT_MACRO_PLAY_TOEND:
+		MacroPlay(true);
+		break;
+
+	case IDM_EDIT_SCRIPT_HOOK:
+		EditRunScriptHook();
+		break;
+
 	case IDT_FILE_SAVE:
 	case IDM_FILE_SAVE:
 		FileSave(FileSaveFlag_SaveAlways);
@@ -3616,6 +4222,15 @@ LRESULT MsgCommand(HWND hwnd, WPARAM wParam, LPARAM lParam) {
 		EndWaitCursor();
 		break;
 
+	case IDM_EDIT_HEX_VIEW:
+		BeginWaitCursor();
+		EditToggleHexView();
+		EndWaitCursor();
+		// the dump document is always at its save point; re-read the real state
+		bDocumentModified = SciCall_GetModify();
+		UpdateDocumentModificationStatus();
+		break;
+
 	case IDM_EDIT_COPYRTF:
 	case IDM_EDIT_CODE_COMPRESS:
 	case IDM_EDIT_CODE_PRETTY:
@@ -3758,6 +4373,14 @@ LRESULT MsgCommand(HWND hwnd, WPARAM wParam, LPARAM lParam) {
 	}
 	break;
 
+	case IDM_EDIT_FINDINFILES:
+		if (!IsWindow(hDlgFindInFiles)) {
+			hDlgFindInFiles = EditFindInFilesDlg(hwndEdit);
+		} else {
+			SetForegroundWindow(hDlgFindInFiles);
+		}
+		break;
+
 	case IDM_EDIT_FINDNEXT:
 	case IDM_EDIT_FINDPREV:
 	case IDM_EDIT_REPLACENEXT:
@@ -3908,6 +4531,11 @@ LRESULT MsgCommand(HWND hwnd, WPARAM wParam, LPARAM lParam) {
 		Style_SetIndentGuides(bShowIndentGuides);
 		break;
 
+	case IDM_VIEW_ELASTICTABSTOPS:
+		bElasticTabStops = !bElasticTabStops;
+		EditElasticTabStops(bElasticTabStops);
+		break;
+
 	case IDM_VIEW_LINENUMBERS:
 		bShowLineNumbers = !bShowLineNumbers;
 		UpdateLineNumberWidth();
@@ -3927,6 +4555,12 @@ LRESULT MsgCommand(HWND hwnd, WPARAM wParam, LPARAM lParam) {
 		}
 		break;
 
+	case IDM_VIEW_VCS_CHANGE_MARKERS:
+		bVcsChangeMarkers = !bVcsChangeMarkers;
+		UpdateBookmarkMarginWidth();
+		EditVcsDiffOnFileChanged(szCurFile);
+		break;
+
 	case IDM_VIEW_AUTOCOMPLETION_SETTINGS:
 		if (AutoCompletionSettingsDlg(hwnd)) {
 			if ((autoCompletionConfig.iCompleteOption & AutoCompletionOption_CompleteWord) == 0) {
@@ -4160,6 +4794,16 @@ LRESULT MsgCommand(HWND hwnd, WPARAM wParam, LPARAM lParam) {
 		SendWMSize(hwnd);
 		break;
 
+	case IDM_VIEW_OVERVIEWBAR:
+		bShowOverviewBar = !bShowOverviewBar;
+		if (bShowOverviewBar) {
+			ShowWindow(hwndOverviewBar, SW_SHOW);
+		} else {
+			ShowWindow(hwndOverviewBar, SW_HIDE);
+		}
+		SendWMSize(hwnd);
+		break;
+
 	case IDM_VIEW_CLEARWINPOS:
 		ClearWindowPositionHistory();
 		break;
@@ -4360,6 +5004,39 @@ LRESULT MsgCommand(HWND hwnd, WPARAM wParam, LPARAM lParam) {
 		DisplayCmdLineHelp(hwnd);
 		break;
 
+	case IDM_HELP_COMMAND_PALETTE:
+		CommandPaletteDlg(hwnd);
+		break;
+
+	case IDM_HELP_MEMORY_USAGE: {
+		Sci_MemoryUsage usage;
+		const size_t total = SciCall_GetMemoryUsage(&usage);
+		const size_t completionBytes = EditCompleteWordCacheBytes();
+		WCHAR tchText[32];
+		WCHAR tchStyle[32];
+		WCHAR tchUndo[32];
+		WCHAR tchPerLine[32];
+		WCHAR tchLayout[32];
+		WCHAR tchCompletion[32];
+		WCHAR tchTotal[32];
+		StrFormatByteSize(usage.textBytes, tchText, COUNTOF(tchText));
+		StrFormatByteSize(usage.styleBytes, tchStyle, COUNTOF(tchStyle));
+		StrFormatByteSize(usage.undoBytes, tchUndo, COUNTOF(tchUndo));
+		StrFormatByteSize(usage.perLineBytes, tchPerLine, COUNTOF(tchPerLine));
+		StrFormatByteSize(usage.layoutBytes, tchLayout, COUNTOF(tchLayout));
+		StrFormatByteSize(completionBytes, tchCompletion, COUNTOF(tchCompletion));
+		StrFormatByteSize(total + completionBytes, tchTotal, COUNTOF(tchTotal));
+		MsgBoxInfo(MB_OK, IDS_MEMORY_USAGE, tchText, tchStyle, tchUndo, tchPerLine, tchLayout, tchCompletion, tchTotal);
+	} break;
+
+	case IDM_HELP_DOC_STATISTICS:
+		EditShowDocumentStatistics(dwCurrentDocReversion);
+		break;
+
+	case IDM_HELP_PAINT_PROFILER:
+		SciCall_SetPaintProfiler(!SciCall_GetPaintProfiler());
+		break;
+
 	case IDM_HELP_PROJECT_HOME:
 	case IDM_HELP_LATEST_RELEASE:
 	case IDM_HELP_LATEST_BUILD:
@@ -4566,6 +5243,18 @@ LRESULT MsgCommand(HWND hwnd, WPARAM wParam, LPARAM lParam) {
 		EditSaveSelectionAsFindText(&efrData, LOWORD(wParam), true);
 		break;
 
+	case IDM_EDIT_SAVEDSEARCH_ADD:
+		EditSavedSearchAdd(&efrData);
+		break;
+
+	case IDM_EDIT_SAVEDSEARCH_LIST:
+		EditSavedSearchMenu(hwnd);
+		break;
+
+	case IDM_EDIT_SAVEDSEARCH_MARKALL:
+		EditMarkAllSavedSearches();
+		break;
+
 	case CMD_INCLINELIMIT:
 	case CMD_DECLINELIMIT:
 		if (!bMarkLongLines) {
@@ -4650,11 +5339,20 @@ LRESULT MsgCommand(HWND hwnd, WPARAM wParam, LPARAM lParam) {
 			break;
 		}
 
+		const UINT searchIndex = LOWORD(wParam) - IDM_SAVED_SEARCH_START;
+		if (searchIndex < MRU_MAX_SAVED_FIND) {
+			static_assert(IDM_SAVED_SEARCH_START + MRU_MAX_SAVED_FIND == IDM_SAVED_SEARCH_END);
+			EditSavedSearchInvoke(&efrData, searchIndex);
+			break;
+		}
+
 		const UINT index = LOWORD(wParam) - IDM_RECENT_HISTORY_START;
 		if (index < MRU_MAXITEMS) {
 			LPCWSTR path = mruFile.pszItems[index];
 			if (path) {
-				if (!PathIsFile(path)) {
+				// the cached answer avoids a blocking probe on a dead share;
+				// an unresolved entry is simply attempted.
+				if (MRUPathCacheLookup(path) == TripleBoolean_False) {
 					if (IDYES == MsgBoxWarn(MB_YESNO, IDS_ERR_MRUDLG)) {
 						mruFile.DeleteFileFromStore(path);
 						mruFile.Delete(index);
@@ -4670,6 +5368,53 @@ LRESULT MsgCommand(HWND hwnd, WPARAM wParam, LPARAM lParam) {
 	return 0;
 }
 
+//=============================================================================
+//
+// BeginModificationBatch(), EndModificationBatch()
+//
+// Mass transforms in Edit.cpp issue one Scintilla modification per line, and
+// each arrives synchronously as SCN_MODIFIED. Inside a batch the handler only
+// folds the modification into one summarized range, applied when the batch
+// ends, so the per-notification bookkeeping doesn't dominate the transform.
+//
+static struct {
+	int depth;
+	Sci_Line linesAdded;
+	Sci_Position delta;
+	Sci_Position start;
+	// kept in current document coordinates, as in EditMarkAll::OnModified()
+	Sci_Position end;
+} modificationBatch;
+
+void BeginModificationBatch() noexcept {
+	if (modificationBatch.depth == 0) {
+		modificationBatch.linesAdded = 0;
+		modificationBatch.delta = 0;
+		modificationBatch.start = PTRDIFF_MAX;
+		modificationBatch.end = 0;
+	}
+	modificationBatch.depth += 1;
+}
+
+void EndModificationBatch() noexcept {
+	modificationBatch.depth -= 1;
+	if (modificationBatch.depth != 0 || modificationBatch.start == PTRDIFF_MAX) {
+		return;
+	}
+	const Sci_Position start = modificationBatch.start;
+	const Sci_Position end = modificationBatch.end;
+	EditMarkDirtyRange(start, end);
+	editMarkAll.OnModified(start, end, modificationBatch.delta);
+	EditDiffOnDocModified(start, end, modificationBatch.linesAdded, false);
+	EditSpellOnDocModified(start, end, modificationBatch.delta);
+	EditCompleteWordInvalidateCache(start, 0, false);
+	UpdateStatusBarCacheLineColumn();
+	if (modificationBatch.linesAdded) {
+		UpdateLineNumberWidth();
+	}
+	AutoSave_OnModified(end - start);
+}
+
 //=============================================================================
 //
 // MsgNotify() - Handles WM_NOTIFY
@@ -4682,10 +5427,37 @@ LRESULT MsgNotify(HWND hwnd, WPARAM wParam, LPARAM lParam) {
 	const SCNotification * const scn = AsPointer<SCNotification *>(lParam);
 
 	switch (pnmh->idFrom) {
+	case IDC_DIFFVIEW:
+		return EditDiffHandleNotify(scn);
+
 	case IDC_EDIT:
 		switch (pnmh->code) {
 		case SCN_UPDATEUI:
+			if (bShowOverviewBar && (scn->updated & (SC_UPDATE_V_SCROLL | SC_UPDATE_CONTENT))) {
+				// move the visible range frame on the overview strip
+				InvalidateRect(hwndOverviewBar, nullptr, FALSE);
+			}
+			if (bHexViewMode && (scn->updated & SC_UPDATE_V_SCROLL)) {
+				EditHexViewFollowScroll();
+			}
+			if (bPageViewMode && (scn->updated & SC_UPDATE_V_SCROLL)) {
+				EditPageViewOnScroll();
+			}
+			if (scn->updated & SC_UPDATE_V_SCROLL) {
+				EditDiffSyncScroll(false);
+				if (editMarkAll.pending) {
+					// mark newly revealed matches before the idle scan reaches them
+					editMarkAll.MarkVisible();
+				}
+				if (bElasticTabStops) {
+					// solve the tab stops for newly revealed lines
+					EditElasticTabStopsRefresh(true);
+				}
+			}
 			if (scn->updated & ~(SC_UPDATE_V_SCROLL | SC_UPDATE_H_SCROLL)) {
+				if (bElasticTabStops && (scn->updated & SC_UPDATE_CONTENT)) {
+					EditElasticTabStopsRefresh(false);
+				}
 				UpdateToolbar();
 
 				if (scn->updated & SC_UPDATE_SELECTION) {
@@ -4724,7 +5496,14 @@ LRESULT MsgNotify(HWND hwnd, WPARAM wParam, LPARAM lParam) {
 				if (bMatchBraces) {
 					Sci_Position iPos = SciCall_GetCurrentPos();
 					int ch = SciCall_GetCharAt(iPos);
-					if (IsBraceMatchChar(ch)) {
+					if (iMaxLineLength >= NP2_LONG_LINE_MITIGATION_LIMIT
+						&& SciCall_GetLineLength(SciCall_LineFromPosition(iPos)) >= NP2_LONG_LINE_MITIGATION_LIMIT) {
+						// skip the scan inside a pathological long line: it may walk
+						// megabytes of styled text on every caret move. Explicit commands
+						// like IDM_EDIT_FINDMATCHINGBRACE still search unconditionally.
+						SciCall_BraceHighlight(INVALID_POSITION, INVALID_POSITION);
+						SciCall_SetHighlightGuide(0);
+					} else if (IsBraceMatchChar(ch)) {
 						const Sci_Position iBrace2 = SciCall_BraceMatch(iPos);
 						if (iBrace2 >= 0) {
 							const Sci_Position col1 = SciCall_GetColumn(iPos);
@@ -4891,14 +5670,38 @@ LRESULT MsgNotify(HWND hwnd, WPARAM wParam, LPARAM lParam) {
 			EditClickCallTip(hwnd);
 			break;
 
-		case SCN_MODIFIED:
+		case SCN_MODIFIED: {
 			// we only watch SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT
 			++dwCurrentDocReversion;
+			foldOutline.Invalidate();
+			const bool insertion = (scn->modificationType & SC_MOD_INSERTTEXT) != 0;
+			const Sci_Position changeEnd = insertion ? scn->position + scn->length : scn->position;
+			if (modificationBatch.depth != 0) {
+				const Sci_Position delta = insertion ? scn->length : -scn->length;
+				if (modificationBatch.end > scn->position) {
+					modificationBatch.end = max(scn->position, modificationBatch.end + delta);
+				}
+				modificationBatch.start = min(modificationBatch.start, scn->position);
+				modificationBatch.end = max(modificationBatch.end, changeEnd);
+				modificationBatch.delta += delta;
+				modificationBatch.linesAdded += scn->linesAdded;
+				break;
+			}
+			EditMarkDirtyRange(scn->position, changeEnd);
+			editMarkAll.OnModified(scn->position, changeEnd, insertion ? scn->length : -scn->length);
+			EditDiffOnDocModified(scn->position, changeEnd, scn->linesAdded, false);
+			EditSpellOnDocModified(scn->position, changeEnd, insertion ? scn->length : -scn->length);
+			EditCompleteWordInvalidateCache(scn->position, scn->length, insertion);
 			UpdateStatusBarCacheLineColumn();
 			if (scn->linesAdded) {
 				UpdateLineNumberWidth();
 			}
-			AutoSave_Start(false);
+			AutoSave_OnModified(scn->length);
+		}
+		break;
+
+		case SCN_MACRORECORD:
+			MacroRecordAction(scn);
 			break;
 
 		case SCN_ZOOM:
@@ -5013,6 +5816,9 @@ LRESULT MsgNotify(HWND hwnd, WPARAM wParam, LPARAM lParam) {
 					mii.hbmpItem = hbmp;
 					InsertMenuItem(subMenu, i, TRUE, &mii);
 				}
+				// re-resolve entry existence for the click handler; the menu
+				// itself renders without touching the disk.
+				MRUPathCacheRefresh();
 			} else {
 				hmenu = LoadMenu(g_hInstance, MAKEINTRESOURCE(IDR_POPUPMENU));
 				subMenu = GetSubMenu(hmenu, IDP_POPUP_SUBMENU_FOLD);
@@ -5176,6 +5982,7 @@ void LoadSettings() noexcept {
 	bSaveRecentFiles = iValue & true;
 	iMaxRecentFiles = max(iValue >> 1, MRU_MAXITEMS);
 	bSaveFindReplace = section.GetBool(L"SaveFindReplace", false);
+	bSaveFileViewStates = section.GetBool(L"SaveFileViewStates", true);
 	iValue = section.GetInt(L"FindReplaceOption", FindReplaceOption_Default);
 	iFindReplaceOption = iValue & 15;
 	efrData.option = iValue >> 4;
@@ -5206,6 +6013,7 @@ void LoadSettings() noexcept {
 	bHighlightCurrentSubLine = (iValue >= 10);
 	iHighlightCurrentLine = clamp(static_cast<LineHighlightMode>(iValue % 10), LineHighlightMode_None, LineHighlightMode_OutlineFrame);
 	bShowIndentGuides = section.GetBool(L"ShowIndentGuides", false);
+	bElasticTabStops = section.GetBool(L"ElasticTabStops", false);
 
 	autoCompletionConfig.bIndentText = section.GetBool(L"AutoIndent", true);
 	autoCompletionConfig.iCompleteOption = section.GetInt(L"AutoCompleteOption", AutoCompletionOption_Default);
@@ -5261,7 +6069,9 @@ void LoadSettings() noexcept {
 	bShowBookmarkMargin = section.GetBool(L"ShowBookmarkMargin", false);
 	bShowLineNumbers = section.GetBool(L"ShowLineNumbers", true);
 	bShowCodeFolding = section.GetBool(L"ShowCodeFolding", true);
+	bSpellCheckEnabled = section.GetBool(L"SpellCheck", false);
 	iChangeHistoryMarker = section.GetInt(L"ChangeHistoryMarker", SC_CHANGE_HISTORY_DISABLED);
+	bVcsChangeMarkers = section.GetBool(L"VcsChangeMarkers", false);
 	bMarkOccurrences = section.GetInt(L"MarkOccurrences", MarkOccurrences_Enable);
 
 	bViewWhiteSpace = section.GetBool(L"ViewWhiteSpace", false);
@@ -5359,6 +6169,7 @@ void LoadSettings() noexcept {
 	bShowToolbar = section.GetBool(L"ShowToolbar", true);
 	iAutoScaleToolbar = section.GetInt(L"AutoScaleToolbar", USER_DEFAULT_SCREEN_DPI);
 	bShowStatusbar = section.GetBool(L"ShowStatusbar", true);
+	bShowOverviewBar = section.GetBool(L"ShowOverviewBar", false);
 
 	iValue = section.GetInt(L"FullScreenMode", FullScreenMode_Default);
 	iFullScreenMode = iValue;
@@ -5434,6 +6245,7 @@ void SaveSettingsNow(bool bOnlySaveStyle, bool bQuiet) noexcept {
 	}
 
 	if (!bCreateFailure) {
+		BeginIniFileWrite();
 		LPCWSTR section = bOnlySaveStyle ? INI_SECTION_NAME_STYLES : INI_SECTION_NAME_SETTINGS;
 		if (WritePrivateProfileString(section, L"WriteTest", L"ok", szIniFile)) {
 			BeginWaitCursor();
@@ -5446,17 +6258,20 @@ void SaveSettingsNow(bool bOnlySaveStyle, bool bQuiet) noexcept {
 					Style_Save();
 				} else {
 					SaveSettings(true);
+					FlushFileViewStates();
 				}
 			} else {
 				bCreateFailure = true;
 			}
 			StatusSetSimple(hwndStatus, FALSE);
 			EndWaitCursor();
+			EndIniFileWrite();
 			if (!bCreateFailure && !bQuiet) {
 				MsgBoxInfo(MB_OK, IDS_SAVEDSETTINGS);
 			}
 		} else {
 			dwLastIOError = GetLastError();
+			EndIniFileWrite();
 			MsgBoxLastError(MB_OK, IDS_WRITEINI_FAIL);
 		}
 	}
@@ -5503,6 +6318,7 @@ void SaveSettings(bool bSaveSettingsNow) noexcept {
 	int iValue = (iMaxRecentFiles << 1) | static_cast<int>(bSaveRecentFiles);
 	section.SetIntEx(L"SaveRecentFiles", iValue, MRU_MAXITEMS << 1);
 	section.SetBoolEx(L"SaveFindReplace", bSaveFindReplace, false);
+	section.SetBoolEx(L"SaveFileViewStates", bSaveFileViewStates, true);
 	iValue = iFindReplaceOption | ((efrData.option & FindReplaceOption_BehaviorMask) << 4);
 	section.SetIntEx(L"FindReplaceOption", iValue, FindReplaceOption_Default);
 	if (bSaveFindReplace) {
@@ -5522,6 +6338,7 @@ void SaveSettings(bool bSaveSettingsNow) noexcept {
 	iValue = static_cast<int>(iHighlightCurrentLine) + (static_cast<int>(bHighlightCurrentSubLine)*10);
 	section.SetIntEx(L"HighlightCurrentLine", iValue, 10 + LineHighlightMode_OutlineFrame);
 	section.SetBoolEx(L"ShowIndentGuides", bShowIndentGuides, false);
+	section.SetBoolEx(L"ElasticTabStops", bElasticTabStops, false);
 
 	section.SetBoolEx(L"AutoIndent", autoCompletionConfig.bIndentText, true);
 	section.SetIntEx(L"AutoCompleteOption", autoCompletionConfig.iCompleteOption, AutoCompletionOption_Default);
@@ -5552,7 +6369,9 @@ void SaveSettings(bool bSaveSettingsNow) noexcept {
 	section.SetBoolEx(L"ShowBookmarkMargin", bShowBookmarkMargin, false);
 	section.SetBoolEx(L"ShowLineNumbers", bShowLineNumbers, true);
 	section.SetBoolEx(L"ShowCodeFolding", bShowCodeFolding, true);
+	section.SetBoolEx(L"SpellCheck", bSpellCheckEnabled, false);
 	section.SetIntEx(L"ChangeHistoryMarker", iChangeHistoryMarker, SC_CHANGE_HISTORY_DISABLED);
+	section.SetBoolEx(L"VcsChangeMarkers", bVcsChangeMarkers, false);
 	section.SetIntEx(L"MarkOccurrences", bMarkOccurrences, MarkOccurrences_Enable);
 	section.SetBoolEx(L"ViewWhiteSpace", bViewWhiteSpace, false);
 	section.SetBoolEx(L"ViewEOLs", bViewEOLs, false);
@@ -5612,6 +6431,7 @@ void SaveSettings(bool bSaveSettingsNow) noexcept {
 	section.SetBoolEx(L"ShowToolbar", bShowToolbar, true);
 	section.SetIntEx(L"AutoScaleToolbar", iAutoScaleToolbar, USER_DEFAULT_SCREEN_DPI);
 	section.SetBoolEx(L"ShowStatusbar", bShowStatusbar, true);
+	section.SetBoolEx(L"ShowOverviewBar", bShowOverviewBar, false);
 	section.SetIntEx(L"FullScreenMode", iFullScreenMode, FullScreenMode_Default);
 
 	SaveIniSection(INI_SECTION_NAME_SETTINGS, pIniSectionBuf);
@@ -6362,6 +7182,7 @@ void LoadFlags() noexcept {
 
 	bSingleFileInstance = section.GetBool(L"SingleFileInstance", true);
 	bReuseWindow = section.GetBool(L"ReuseWindow", false);
+	bResidentInstance = section.GetBool(L"ResidentInstance", false);
 	bStickyWindowPosition = section.GetBool(L"StickyWindowPosition", false);
 
 	if (!flagReuseWindow && !flagNoReuseWindow) {
@@ -6384,6 +7205,7 @@ void LoadFlags() noexcept {
 
 	dwFileCheckInterval = section.GetInt(L"FileCheckInterval", 1000);
 	dwAutoReloadTimeout = section.GetInt(L"AutoReloadTimeout", 1000);
+	dwLargeFileWorkingSetMB = section.GetInt(L"LargeFileWorkingSetMB", 0);
 
 	if (IsVistaAndAbove()) {
 		bUseXPFileDialog = section.GetBool(L"UseXPFileDialog", false);
@@ -6792,10 +7614,19 @@ void UpdateStatusbar() noexcept {
 		lstrcat(tchMatchesCount, L" ...");
 	}
 
-	WCHAR tchDocSize[32];
+	WCHAR tchDocSize[64];
 	if (updateMask & (1 << StatusItem_DocSize)) {
 		const Sci_Position iBytes = SciCall_GetLength();
 		StrFormatByteSize(iBytes, tchDocSize, COUNTOF(tchDocSize));
+		if (iMaxLineLength >= NP2_LONG_LINE_MITIGATION_LIMIT) {
+			// long line mitigations active: show the ~95th percentile and
+			// longest line length computed at load, see FileLoad().
+			WCHAR tchTypicalLine[32];
+			WCHAR tchMaxLine[32];
+			StrFormatByteSize(iPercentileLineLength, tchTypicalLine, COUNTOF(tchTypicalLine));
+			StrFormatByteSize(iMaxLineLength, tchMaxLine, COUNTOF(tchMaxLine));
+			wsprintf(tchDocSize + lstrlen(tchDocSize), L", line %s / %s", tchTypicalLine, tchMaxLine);
+		}
 	}
 
 	WCHAR itemText[256];
@@ -7000,15 +7831,154 @@ bool FileIO(bool fLoad, LPWSTR pszFile, FileSaveFlag flag, EditFileIOStatus &sta
 
 //=============================================================================
 //
-// FileLoad()
+// SaveFileViewState(), RestoreFileViewState()
 //
+// Reopening a file lands at the top of the document with freshly detected
+// encoding; remember caret, selection anchor, scroll position and encoding
+// per path so yesterday's working set continues where each file was left.
 //
-bool FileLoad(FileLoadFlag loadFlag, LPCWSTR lpszFile) {
-	WCHAR tch[MAX_PATH] = L"";
-	bool fSuccess = false;
-	bool bRestoreView = false;
-	Sci_Position iCurPos = 0;
-	Sci_Position iAnchorPos = 0;
+// States are journaled in memory and only written to the INI at session end:
+// IniSetString() rewrites the whole settings file through the profile API,
+// and with a state saved on every file switch that synchronous rewrite
+// dominated file-open latency on roaming profiles. The journal is append
+// only; the newest entry per path wins on read and on the final write.
+//
+struct FileViewStateEntry {
+	LPWSTR pszFile;
+	WCHAR tchView[128];
+};
+
+static struct {
+	FileViewStateEntry *entries;
+	UINT count;
+	UINT capacity;
+} fileViewStateJournal;
+
+static bool ReadFileViewState(LPCWSTR pszFile, int64_t (&view)[5]) noexcept {
+	for (UINT i = fileViewStateJournal.count; i > 0; ) {
+		const FileViewStateEntry &entry = fileViewStateJournal.entries[--i];
+		if (PathEqual(entry.pszFile, pszFile)) {
+			return ParseCommaList64(entry.tchView, view, COUNTOF(view)) == COUNTOF(view);
+		}
+	}
+	WCHAR tch[128] = L"";
+	IniGetString(INI_SECTION_NAME_FILE_VIEW_STATES, pszFile, L"", tch, COUNTOF(tch));
+	return ParseCommaList64(tch, view, COUNTOF(view)) == COUNTOF(view);
+}
+
+static void SaveFileViewState(LPCWSTR pszFile) noexcept {
+	if (!bSaveFileViewStates || StrIsEmpty(pszFile)) {
+		return;
+	}
+	if (fileViewStateJournal.count == fileViewStateJournal.capacity) {
+		const UINT capacity = (fileViewStateJournal.capacity == 0) ? 16 : fileViewStateJournal.capacity*2;
+		void *entries = fileViewStateJournal.entries
+			? NP2HeapReAlloc(fileViewStateJournal.entries, capacity*sizeof(FileViewStateEntry))
+			: NP2HeapAlloc(capacity*sizeof(FileViewStateEntry));
+		fileViewStateJournal.entries = static_cast<FileViewStateEntry *>(entries);
+		fileViewStateJournal.capacity = capacity;
+	}
+	FileViewStateEntry &entry = fileViewStateJournal.entries[fileViewStateJournal.count++];
+	entry.pszFile = StrDup(pszFile);
+	const Sci_Line iDocTopLine = SciCall_DocLineFromVisible(SciCall_GetFirstVisibleLine());
+	wsprintf(entry.tchView, L"%I64d,%I64d,%I64d,%d,%u",
+		static_cast<__int64>(SciCall_GetCurrentPos()),
+		static_cast<__int64>(SciCall_GetAnchor()),
+		static_cast<__int64>(iDocTopLine),
+		SciCall_GetXOffset(),
+		Encoding_MapIniSetting(false, iCurrentEncoding));
+}
+
+static void FlushFileViewStates() noexcept {
+	for (UINT i = 0; i < fileViewStateJournal.count; i++) {
+		const FileViewStateEntry &entry = fileViewStateJournal.entries[i];
+		UINT k = i + 1;
+		for (; k < fileViewStateJournal.count; k++) {
+			if (PathEqual(entry.pszFile, fileViewStateJournal.entries[k].pszFile)) {
+				break;	// superseded by a newer entry
+			}
+		}
+		if (k == fileViewStateJournal.count) {
+			IniSetString(INI_SECTION_NAME_FILE_VIEW_STATES, entry.pszFile, entry.tchView);
+		}
+		LocalFree(entry.pszFile);
+	}
+	fileViewStateJournal.count = 0;
+}
+
+void ClearFileViewStates() noexcept {
+	for (UINT i = 0; i < fileViewStateJournal.count; i++) {
+		LocalFree(fileViewStateJournal.entries[i].pszFile);
+	}
+	fileViewStateJournal.count = 0;
+	IniClearSection(INI_SECTION_NAME_FILE_VIEW_STATES);
+}
+
+// encoding the file was last viewed with, to be applied before loading.
+static int FileViewStateEncoding(LPCWSTR pszFile) noexcept {
+	int64_t view[5];
+	if (!bSaveFileViewStates || !ReadFileViewState(pszFile, view)) {
+		return CPI_NONE;
+	}
+	return Encoding_MapIniSetting(true, static_cast<UINT>(view[4]));
+}
+
+static void RestoreFileViewState(LPCWSTR pszFile) noexcept {
+	int64_t view[5];
+	if (!bSaveFileViewStates || !ReadFileViewState(pszFile, view)) {
+		return;
+	}
+	const Sci_Position length = SciCall_GetLength();
+	const Sci_Position iCurPos = clamp<Sci_Position>(static_cast<Sci_Position>(view[0]), 0, length);
+	const Sci_Position iAnchorPos = clamp<Sci_Position>(static_cast<Sci_Position>(view[1]), 0, length);
+	if (iCurPos == 0 && iAnchorPos == 0 && view[2] <= 0 && view[3] <= 0) {
+		return;
+	}
+	SciCall_SetSel(iAnchorPos, iCurPos);
+	const Sci_Line iDocTopLine = clamp<Sci_Line>(static_cast<Sci_Line>(view[2]), 0, SciCall_GetLineCount() - 1);
+	SciCall_EnsureVisible(iDocTopLine);
+	SciCall_SetFirstVisibleLine(iDocTopLine);
+	SciCall_SetXOffset(static_cast<int>(view[3]));
+}
+
+#if defined(_WIN64)
+// in large file mode the whole document stays resident even though only a
+// small window is ever viewed. When LargeFileWorkingSetMB is set and the
+// document exceeds it, release the document pages from the working set after
+// loading: the memory manager keeps them in the compressed store (or standby
+// list) and faults them back transparently on first access, so huge session
+// sets no longer pin their full size in RAM.
+static void TrimLargeFileWorkingSet() noexcept {
+	const Sci_Position length = SciCall_GetLength();
+	if (!bLargeFileMode || dwLargeFileWorkingSetMB == 0
+		|| static_cast<size_t>(length) <= (static_cast<size_t>(dwLargeFileWorkingSetMB) << 20)) {
+		return;
+	}
+	// the gap sits at the end after loading, so the range is contiguous.
+	const char * const range = SciCall_GetRangePointer(0, length);
+	// VirtualUnlock() on an unlocked range fails with ERROR_NOT_LOCKED but
+	// still removes the resident pages from the working set.
+	VirtualUnlock(const_cast<char *>(range), length);
+}
+#endif
+
+//=============================================================================
+//
+// FileLoad()
+//
+//
+bool FileLoad(FileLoadFlag loadFlag, LPCWSTR lpszFile) {
+	if (bHexViewMode) {
+		// leave the hex dump so the real document is replaced
+		EditToggleHexView();
+		bDocumentModified = SciCall_GetModify();
+	}
+
+	WCHAR tch[MAX_PATH] = L"";
+	bool fSuccess = false;
+	bool bRestoreView = false;
+	Sci_Position iCurPos = 0;
+	Sci_Position iAnchorPos = 0;
 	Sci_Line iLine = 0;
 	Sci_Position iCol = 0;
 	Sci_Line iVisTopLine = 0;
@@ -7039,6 +8009,12 @@ bool FileLoad(FileLoadFlag loadFlag, LPCWSTR lpszFile) {
 			return false;
 		}
 	}
+	// current document is about to be replaced
+	EditSaveStyleCache(szCurFile);
+	EditSaveUndoHistory(szCurFile);
+	if (!bRestoreView) {
+		SaveFileViewState(szCurFile);
+	}
 
 	if (loadFlag & FileLoadFlag_New) {
 		StrCpyEx(szCurFile, L"");
@@ -7046,8 +8022,15 @@ bool FileLoad(FileLoadFlag loadFlag, LPCWSTR lpszFile) {
 		if (!keepTitleExcerpt) {
 			StrCpyEx(szTitleExcerpt, L"");
 		}
+		EditPageViewStop();
 		fvCurFile.Init(nullptr, 0);
 		EditSetEmptyText();
+		iMaxLineLength = 0;
+		iPercentileLineLength = 0;
+		if (bLineCharacterIndexAllocated) {
+			bLineCharacterIndexAllocated = false;
+			SciCall_ReleaseLineCharacterIndex(SC_LINECHARACTERINDEX_UTF32);
+		}
 		bDocumentModified = false;
 		bReadOnlyFile = false;
 		iCurrentEOLMode = GetScintillaEOLMode(iDefaultEOLMode);
@@ -7067,6 +8050,7 @@ bool FileLoad(FileLoadFlag loadFlag, LPCWSTR lpszFile) {
 			iFileWatchingMode = FileWatchingMode_None;
 		}
 		InstallFileWatching(true);
+		EditVcsDiffOnFileChanged(szCurFile);
 
 		return true;
 	}
@@ -7093,6 +8077,12 @@ bool FileLoad(FileLoadFlag loadFlag, LPCWSTR lpszFile) {
 	GetLongPathName(szFileName, szFileName, COUNTOF(szFileName));
 	PathGetLnkPath(szFileName, szFileName);
 
+	// load the file with the encoding it was last viewed with, unless an
+	// explicit encoding was given or the current document is being reverted.
+	if (iSrcEncoding == CPI_NONE && !bRestoreView) {
+		iSrcEncoding = FileViewStateEncoding(szFileName);
+	}
+
 	EditFileIOStatus status{};
 	status.iEncoding = iCurrentEncoding;
 	status.iEOLMode = iCurrentEOLMode;
@@ -7108,6 +8098,7 @@ bool FileLoad(FileLoadFlag loadFlag, LPCWSTR lpszFile) {
 			if (hFile != INVALID_HANDLE_VALUE) {
 				fSuccess = true;
 				CloseHandle(hFile);
+				EditPageViewStop();
 				fvCurFile.Init(nullptr, 0);
 				EditSetEmptyText();
 				iCurrentEOLMode = GetScintillaEOLMode(iDefaultEOLMode);
@@ -7130,6 +8121,12 @@ bool FileLoad(FileLoadFlag loadFlag, LPCWSTR lpszFile) {
 		}
 	} else {
 		fSuccess = FileIO(true, szFileName, FileSaveFlag_Default, status);
+		if (fSuccess) {
+			EditPageViewStop();
+		} else if (status.bPagedView) {
+			// too large to load completely: window the file instead
+			fSuccess = EditPageViewStart(szFileName, status);
+		}
 		if (fSuccess) {
 			iCurrentEncoding = status.iEncoding;
 			iCurrentEOLMode = status.iEOLMode;
@@ -7169,6 +8166,35 @@ bool FileLoad(FileLoadFlag loadFlag, LPCWSTR lpszFile) {
 		} else {
 			UpdateLineNumberWidth();
 		}
+		EditRestoreStyleCache(szCurFile);
+		EditRestoreUndoHistory(szCurFile);
+
+		// pathological long lines destroy layout, word navigation and brace
+		// match performance: flip mitigations here instead of becoming
+		// unresponsive, and surface the statistics in the status bar.
+		iMaxLineLength = status.maxLineLength;
+		iPercentileLineLength = status.percentileLineLength;
+		const bool longLineFile = status.maxLineLength >= NP2_LONG_LINE_MITIGATION_LIMIT;
+		if (longLineFile && fvCurFile.fWordWrap) {
+			// wrapping the long line stalls for minutes; for this file only.
+			fvCurFile.fWordWrap = false;
+			SciCall_SetWrapMode(SC_WRAP_NONE);
+		}
+		// keep the expensive layouts instead of redoing them on every scroll.
+		SciCall_SetLayoutCache(longLineFile ? SC_CACHE_DOCUMENT : SC_CACHE_PAGE);
+
+		// incremental character counts for the status bar, see the comment
+		// on NP2_CHARACTER_INDEX_LIMIT.
+		const bool wantCharacterIndex = SciCall_GetLength() >= NP2_CHARACTER_INDEX_LIMIT
+			&& SciCall_GetCodePage() == SC_CP_UTF8;
+		if (wantCharacterIndex != bLineCharacterIndexAllocated) {
+			bLineCharacterIndexAllocated = wantCharacterIndex;
+			if (wantCharacterIndex) {
+				SciCall_AllocateLineCharacterIndex(SC_LINECHARACTERINDEX_UTF32);
+			} else {
+				SciCall_ReleaseLineCharacterIndex(SC_LINECHARACTERINDEX_UTF32);
+			}
+		}
 
 		mruFile.Add(szFileName);
 		if (flagUseSystemMRU == TripleBoolean_True) {
@@ -7181,6 +8207,7 @@ bool FileLoad(FileLoadFlag loadFlag, LPCWSTR lpszFile) {
 			iFileWatchingMode = FileWatchingMode_None;
 		}
 		InstallFileWatching(false);
+		EditVcsDiffOnFileChanged(szCurFile);
 
 		if (status.bBinaryFile || pLexCurrent->iLexer == SCLEX_DIFF) {
 			// ignore auto "detected" Tab settings for binary file and diff file.
@@ -7191,7 +8218,7 @@ bool FileLoad(FileLoadFlag loadFlag, LPCWSTR lpszFile) {
 			}
 		}
 		// open file in read only mode
-		if (status.bBinaryFile || flagReadOnlyMode != ReadOnlyMode_None || bReadOnlyFile) {
+		if (status.bBinaryFile || status.bPagedView || flagReadOnlyMode != ReadOnlyMode_None || bReadOnlyFile) {
 			bReadOnlyMode = true;
 			flagReadOnlyMode &= ReadOnlyMode_AllFile;
 			SciCall_SetReadOnly(true);
@@ -7220,6 +8247,8 @@ bool FileLoad(FileLoadFlag loadFlag, LPCWSTR lpszFile) {
 					SciCall_LineScroll(0, iVisTopLine - iNewTopLine);
 					SciCall_SetXOffset(iXOffset);
 				}
+			} else {
+				RestoreFileViewState(szCurFile);
 			}
 		}
 
@@ -7228,6 +8257,9 @@ bool FileLoad(FileLoadFlag loadFlag, LPCWSTR lpszFile) {
 		//DisableDelayedStatusBarRedraw(); // already set in MsgSize()
 		UpdateStatusbar();
 		UpdateWindowTitle();
+#if defined(_WIN64)
+		TrimLargeFileWorkingSet();
+#endif
 		// Show warning: Unicode file loaded as ANSI
 		if (status.bUnicodeErr) {
 			MsgBoxWarn(MB_OK, IDS_ERR_UNICODE);
@@ -7262,6 +8294,13 @@ bool FileLoad(FileLoadFlag loadFlag, LPCWSTR lpszFile) {
 //
 //
 bool FileSave(FileSaveFlag saveFlag) noexcept {
+	if (bHexViewMode) {
+		// leave the hex dump so the real document is saved
+		EditToggleHexView();
+		bDocumentModified = SciCall_GetModify();
+		UpdateDocumentModificationStatus();
+	}
+
 	const bool Untitled = StrIsEmpty(szCurFile);
 	bool bIsEmptyNewFile = false;
 
@@ -7303,6 +8342,10 @@ bool FileSave(FileSaveFlag saveFlag) noexcept {
 		}
 	}
 
+	// a periodic overwrite-current backup may still be renaming its temporary
+	// file over szCurFile: let it finish before writing the file here.
+	AutoSave_WaitOverwrite();
+
 	bool fSuccess = false;
 	WCHAR tchFile[MAX_PATH];
 	EditFileIOStatus status{};
@@ -7393,6 +8436,8 @@ bool FileSave(FileSaveFlag saveFlag) noexcept {
 				iFileWatchingMode = FileWatchingMode_None;
 			}
 			InstallFileWatching(false);
+			EditSaveUndoHistory(szCurFile);
+			EditVcsDiffOnFileChanged(szCurFile);
 		}
 
 		AutoSave_Stop(saveFlag & FileSaveFlag_EndSession);
@@ -7580,22 +8625,185 @@ BOOL SaveFileDlg(bool Untitled, LPWSTR lpstrFile, int cchFile, LPCWSTR lpstrInit
 *
 *
 ******************************************************************************/
-static BOOL CALLBACK EnumWindProcSingleFileInstance(HWND hwnd, LPARAM lParam) noexcept {
-	BOOL bContinue = TRUE;
-	WCHAR szClassName[64];
+// O(1) single instance discovery. Every Notepad4 window registers itself in a
+// named shared memory table and holds a named event open; activation scans the
+// handful of table slots instead of calling EnumWindows() over every top level
+// window in the session, and with no instance running the failed event open
+// answers immediately. A slot can also be marked parked: a fully initialized
+// window kept hidden by the ResidentInstance option, ready to take over the
+// next launch without paying process startup.
+#define InstanceTableSlots	32
+
+struct InstanceSlot {
+	LONG hwnd;		// window handles are 32-bit values, valid across bitness
+	LONG parked;
+};
+
+static HANDLE hInstanceTableMapping = nullptr;
+static HANDLE hInstanceReadyEvent = nullptr;
+static InstanceSlot *pInstanceTable = nullptr;
+
+static bool InstanceTableOpen(bool create) noexcept {
+	if (pInstanceTable != nullptr) {
+		return true;
+	}
+	if (create) {
+		hInstanceTableMapping = CreateFileMapping(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+			0, InstanceTableSlots*sizeof(InstanceSlot), L"Local\\Notepad4InstanceTable");
+	} else {
+		hInstanceTableMapping = OpenFileMapping(FILE_MAP_READ | FILE_MAP_WRITE, FALSE, L"Local\\Notepad4InstanceTable");
+	}
+	if (hInstanceTableMapping != nullptr) {
+		pInstanceTable = static_cast<InstanceSlot *>(MapViewOfFile(hInstanceTableMapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0));
+		if (pInstanceTable == nullptr) {
+			CloseHandle(hInstanceTableMapping);
+			hInstanceTableMapping = nullptr;
+		}
+	}
+	return pInstanceTable != nullptr;
+}
 
-	if (GetClassName(hwnd, szClassName, COUNTOF(szClassName))) {
-		if (StrCaseEqual(szClassName, wchWndClass)) {
+void InstanceTableRegister(HWND hwnd) noexcept {
+	if (!InstanceTableOpen(true)) {
+		return;
+	}
+	// the event signals through its existence alone: the kernel deletes it
+	// with the last registered instance, making "nothing running" a failed
+	// open instead of a window enumeration.
+	hInstanceReadyEvent = CreateEvent(nullptr, TRUE, TRUE, L"Local\\Notepad4InstanceReady");
+	const LONG value = static_cast<LONG>(AsInteger<LONG_PTR>(hwnd));
+	for (UINT i = 0; i < InstanceTableSlots; i++) {
+		InstanceSlot &slot = pInstanceTable[i];
+		const LONG current = slot.hwnd;
+		// claim empty slots and stale ones left behind by crashed instances;
+		// with more instances than slots the rest simply stay undiscoverable.
+		if (current == 0 || !IsWindow(AsPointer<HWND, LONG_PTR>(current))) {
+			if (InterlockedCompareExchange(&slot.hwnd, value, current) == current) {
+				InterlockedExchange(&slot.parked, FALSE);
+				return;
+			}
+		}
+	}
+}
+
+void InstanceTableUnregister() noexcept {
+	if (pInstanceTable != nullptr) {
+		const LONG value = static_cast<LONG>(AsInteger<LONG_PTR>(hwndMain));
+		for (UINT i = 0; i < InstanceTableSlots; i++) {
+			InstanceSlot &slot = pInstanceTable[i];
+			if (slot.hwnd == value) {
+				InterlockedExchange(&slot.parked, FALSE);
+				InterlockedExchange(&slot.hwnd, 0);
+				break;
+			}
+		}
+		UnmapViewOfFile(pInstanceTable);
+		pInstanceTable = nullptr;
+	}
+	if (hInstanceTableMapping != nullptr) {
+		CloseHandle(hInstanceTableMapping);
+		hInstanceTableMapping = nullptr;
+	}
+	if (hInstanceReadyEvent != nullptr) {
+		CloseHandle(hInstanceReadyEvent);
+		hInstanceReadyEvent = nullptr;
+	}
+}
+
+static void InstanceTableSetParked(BOOL parked) noexcept {
+	if (pInstanceTable != nullptr) {
+		const LONG value = static_cast<LONG>(AsInteger<LONG_PTR>(hwndMain));
+		for (UINT i = 0; i < InstanceTableSlots; i++) {
+			InstanceSlot &slot = pInstanceTable[i];
+			if (slot.hwnd == value) {
+				InterlockedExchange(&slot.parked, parked);
+				break;
+			}
+		}
+	}
+}
+
+// mirrors the old EnumWindows() matching: with a file, the window showing that
+// file (the last match, unless an enabled one ends the scan early); without
+// one, any non-parked window of our class.
+static HWND InstanceTableFind(LPCWSTR lpszFile) noexcept {
+	HANDLE hEvent = OpenEvent(SYNCHRONIZE, FALSE, L"Local\\Notepad4InstanceReady");
+	if (hEvent == nullptr) {
+		return nullptr;
+	}
+	CloseHandle(hEvent);
+	if (!InstanceTableOpen(false)) {
+		return nullptr;
+	}
+	HWND found = nullptr;
+	for (UINT i = 0; i < InstanceTableSlots; i++) {
+		const InstanceSlot &slot = pInstanceTable[i];
+		const LONG value = slot.hwnd;
+		if (value == 0 || slot.parked) {
+			continue;
+		}
+		HWND hwnd = AsPointer<HWND, LONG_PTR>(value);
+		WCHAR szClassName[64];
+		// an elevated or clipboard watching instance uses its own class name
+		if (GetClassName(hwnd, szClassName, COUNTOF(szClassName)) && StrCaseEqual(szClassName, wchWndClass)) {
 			WCHAR tchFileName[MAX_PATH];
-			if (lpFileArg == nullptr || (GetDlgItemText(hwnd, IDC_FILENAME, tchFileName, COUNTOF(tchFileName)) && PathEquivalent(tchFileName, lpFileArg))) {
-				*AsPointer<HWND *>(lParam) = hwnd;
+			if (lpszFile == nullptr || (GetDlgItemText(hwnd, IDC_FILENAME, tchFileName, COUNTOF(tchFileName)) && PathEquivalent(tchFileName, lpszFile))) {
+				found = hwnd;
 				if (IsWindowEnabled(hwnd)) {
-					bContinue = FALSE;
+					break;
 				}
 			}
 		}
 	}
-	return bContinue;
+	return found;
+}
+
+// atomically take the parked resident window, so two simultaneous launches
+// can't both adopt it
+static HWND InstanceTableClaimParked() noexcept {
+	HANDLE hEvent = OpenEvent(SYNCHRONIZE, FALSE, L"Local\\Notepad4InstanceReady");
+	if (hEvent == nullptr) {
+		return nullptr;
+	}
+	CloseHandle(hEvent);
+	if (!InstanceTableOpen(false)) {
+		return nullptr;
+	}
+	for (UINT i = 0; i < InstanceTableSlots; i++) {
+		InstanceSlot &slot = pInstanceTable[i];
+		const LONG value = slot.hwnd;
+		if (value == 0 || !slot.parked) {
+			continue;
+		}
+		HWND hwnd = AsPointer<HWND, LONG_PTR>(value);
+		WCHAR szClassName[64];
+		if (IsWindow(hwnd) && GetClassName(hwnd, szClassName, COUNTOF(szClassName)) && StrCaseEqual(szClassName, wchWndClass)
+			&& InterlockedCompareExchange(&slot.parked, FALSE, TRUE) == TRUE) {
+			return hwnd;
+		}
+	}
+	return nullptr;
+}
+
+// hide this fully initialized window instead of exiting: the next launch only
+// has to show it, skipping process, control and lexer startup entirely
+static bool ResidentInstancePark(HWND hwnd) noexcept {
+	if (pInstanceTable == nullptr) {
+		return false;
+	}
+	// keep at most one parked instance per session
+	for (UINT i = 0; i < InstanceTableSlots; i++) {
+		const InstanceSlot &slot = pInstanceTable[i];
+		if (slot.hwnd != 0 && slot.parked && IsWindow(AsPointer<HWND, LONG_PTR>(slot.hwnd))) {
+			return false;
+		}
+	}
+	ShowWindow(hwnd, SW_HIDE);
+	// drop the document so the parked instance holds no locks, watchers or text
+	FileLoad(static_cast<FileLoadFlag>(FileLoadFlag_DontSave | FileLoadFlag_New), L"");
+	bResidentParked = true;
+	InstanceTableSetParked(TRUE);
+	return true;
 }
 
 static void ActivatePrevWindow(HWND hwnd, LPCWSTR lpszFile) noexcept {
@@ -7669,6 +8877,8 @@ bool ActivatePrevInst() noexcept {
 	}
 
 	HWND hwnd = nullptr;
+	bool fileOpenInTarget = false;
+	bool normalized = false;
 	LPWSTR lpszFile = lpFileArg;
 	if (flagSingleFileInstance && lpszFile) {
 		ExpandEnvironmentStringsEx(lpszFile, static_cast<DWORD>(NP2HeapSize(lpszFile) / sizeof(WCHAR)));
@@ -7680,12 +8890,16 @@ bool ActivatePrevInst() noexcept {
 		}
 
 		GetLongPathName(lpszFile, lpszFile, MAX_PATH);
-		EnumWindows(EnumWindProcSingleFileInstance, AsInteger<LPARAM>(&hwnd));
-		lpszFile = nullptr;
+		normalized = true;
+		hwnd = InstanceTableFind(lpszFile);
+		fileOpenInTarget = hwnd != nullptr;
 	} else if (!flagNoReuseWindow) {
-		lpFileArg = nullptr;
-		EnumWindows(EnumWindProcSingleFileInstance, AsInteger<LPARAM>(&hwnd));
-		lpFileArg = lpszFile;
+		hwnd = InstanceTableFind(nullptr);
+	}
+	if (hwnd == nullptr) {
+		// an empty, fully initialized resident window takes the launch even
+		// when window reuse is off: it behaves like a freshly started process
+		hwnd = InstanceTableClaimParked();
 	}
 
 	// Found a window
@@ -7706,7 +8920,9 @@ bool ActivatePrevInst() noexcept {
 
 			SetForegroundWindow(hwnd);
 
-			if (lpszFile) {
+			if (fileOpenInTarget) {
+				lpszFile = nullptr;
+			} else if (lpszFile && !normalized) {
 				ExpandEnvironmentStringsEx(lpszFile, static_cast<DWORD>(NP2HeapSize(lpszFile) / sizeof(WCHAR)));
 
 				if (PathIsRelative(lpszFile)) {
@@ -8116,6 +9332,90 @@ void ShowNotificationMessage(WPARAM notifyPos, UINT uidMessage, ...) noexcept {
 	ShowNotificationW(notifyPos, wchMessage);
 }
 
+//=============================================================================
+//
+// FileAutoReloadAppend()
+//
+// Auto reload used to re-read and restyle the whole file, which for a
+// tail-growing log re-does gigabytes of work every few seconds. When the
+// on-disk prefix is provably unchanged — the watched size matches the
+// document and a tail window still compares equal — only the new bytes are
+// appended, keeping caret, scroll, folds and the styling already done.
+//
+bool FileAutoReloadAppend() noexcept {
+	// only encodings stored byte for byte in the document can be compared
+	// and appended without conversion.
+	if (iCurrentEncoding != CPI_UTF8 && iCurrentEncoding != CPI_UTF8SIGN && iCurrentEncoding != CPI_DEFAULT) {
+		return false;
+	}
+	const Sci_Position docLength = SciCall_GetLength();
+	const INT64 bomBytes = (iCurrentEncoding == CPI_UTF8SIGN) ? 3 : 0;
+	const INT64 prevSize = (static_cast<INT64>(fdCurFile.nFileSizeHigh) << 32) | fdCurFile.nFileSizeLow;
+	if (prevSize != bomBytes + docLength) {
+		// the content was transformed on load (or the size is stale)
+		return false;
+	}
+
+	HANDLE hFile = CreateFile(szCurFile,
+					   GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+					   nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(hFile, &fileSize) || fileSize.QuadPart <= prevSize) {
+		// truncated or rewritten in place: reload in full
+		CloseHandle(hFile);
+		return false;
+	}
+
+	constexpr DWORD cbChunk = 1024*1024;
+	constexpr Sci_Position cbTailCheck = 64*1024;
+	char * const buffer = static_cast<char *>(NP2HeapAlloc(cbChunk));
+
+	// the old tail must still be on disk unchanged, otherwise the file was
+	// rewritten and merely happens to be larger now.
+	const DWORD cbCheck = static_cast<DWORD>(min(cbTailCheck, docLength));
+	LARGE_INTEGER offset;
+	offset.QuadPart = prevSize - cbCheck;
+	DWORD cbRead;
+	bool success = SetFilePointerEx(hFile, offset, nullptr, FILE_BEGIN)
+		&& ReadFile(hFile, buffer, cbCheck, &cbRead, nullptr) && cbRead == cbCheck
+		&& (cbCheck == 0 || memcmp(buffer, SciCall_GetRangePointer(docLength - cbCheck, cbCheck), cbCheck) == 0);
+
+	if (success) {
+		if (bReadOnlyMode) {
+			SciCall_SetReadOnly(false);
+		}
+		SciCall_SetUndoCollection(false);
+		INT64 remaining = fileSize.QuadPart - prevSize;
+		while (success && remaining > 0) {
+			const DWORD cb = static_cast<DWORD>(min<INT64>(cbChunk, remaining));
+			success = ReadFile(hFile, buffer, cb, &cbRead, nullptr) && cbRead == cb;
+			if (success) {
+				SciCall_AppendText(cb, buffer);
+				remaining -= cb;
+			}
+		}
+		SciCall_SetUndoCollection(true);
+		SciCall_EmptyUndoBuffer();
+		if (success) {
+			SciCall_SetSavePoint();
+		}
+		if (bReadOnlyMode) {
+			SciCall_SetReadOnly(true);
+		}
+	}
+
+	CloseHandle(hFile);
+	NP2HeapFree(buffer);
+	if (success) {
+		UpdateStatusbar();
+	}
+	return success;
+}
+
 //=============================================================================
 //
 // InstallFileWatching()
@@ -8268,11 +9568,19 @@ void CALLBACK PasteBoardTimer(HWND hwnd, UINT uMsg, UINT_PTR idEvent, DWORD dwTi
 
 void AutoSave_Start(bool reset) noexcept {
 	if ((iAutoSaveOption & AutoSaveOption_Periodic) && dwAutoSavePeriod != 0) {
-		if (reset || !bAutoSaveTimerSet) {
-			bAutoSaveTimerSet = true;
-			SetTimer(hwndMain, ID_AUTOSAVETIMER, dwAutoSavePeriod, nullptr);
+		if (reset) {
+			dwAutoSaveDirtyBytes = 0;
+			dwAutoSavePeriodCurrent = dwAutoSavePeriod;
+		}
+		// no timer while nothing is dirty: the next modification arms it,
+		// so a clean document never pays for wall clock polling.
+		if (dwCurrentDocReversion != dwLastSavedDocReversion) {
+			if (reset || !bAutoSaveTimerSet) {
+				bAutoSaveTimerSet = true;
+				SetTimer(hwndMain, ID_AUTOSAVETIMER, dwAutoSavePeriodCurrent ? dwAutoSavePeriodCurrent : dwAutoSavePeriod, nullptr);
+			}
+			return;
 		}
-		return;
 	}
 	if (bAutoSaveTimerSet) {
 		bAutoSaveTimerSet = false;
@@ -8280,15 +9588,275 @@ void AutoSave_Start(bool reset) noexcept {
 	}
 }
 
+void AutoSave_OnModified(Sci_Position length) noexcept {
+	if (!(iAutoSaveOption & AutoSaveOption_Periodic) || dwAutoSavePeriod == 0) {
+		return;
+	}
+	dwAutoSaveDirtyBytes += static_cast<DWORD>(min<Sci_Position>(length, AutoSaveDirtyBytesLimit));
+	dwAutoSaveLastChangeTick = GetTickCount();
+	if (!bAutoSaveTimerSet) {
+		// first change since the last save: arm the deadline at the base period
+		bAutoSaveTimerSet = true;
+		dwAutoSavePeriodCurrent = dwAutoSavePeriod;
+		SetTimer(hwndMain, ID_AUTOSAVETIMER, dwAutoSavePeriodCurrent, nullptr);
+	} else if (dwAutoSaveDirtyBytes >= AutoSaveDirtyBytesLimit && dwAutoSavePeriodCurrent != dwAutoSavePeriod) {
+		// enough has accumulated: cancel the backoff so the deadline fires soon
+		dwAutoSavePeriodCurrent = dwAutoSavePeriod;
+		SetTimer(hwndMain, ID_AUTOSAVETIMER, dwAutoSavePeriodCurrent, nullptr);
+	}
+}
+
+void AutoSave_OnTimer() noexcept {
+	if (dwCurrentDocReversion == dwLastSavedDocReversion) {
+		// saved (or reverted) through another path since the timer was armed
+		bAutoSaveTimerSet = false;
+		KillTimer(hwndMain, ID_AUTOSAVETIMER);
+		return;
+	}
+	if (dwAutoSaveDirtyBytes < AutoSaveDirtyBytesLimit
+		&& GetTickCount() - dwAutoSaveLastChangeTick < AutoSaveTypingGap
+		&& dwAutoSavePeriodCurrent < (dwAutoSavePeriod << AutoSaveMaxBackoffShift)) {
+		// still typing and little has accumulated: push the save into a pause
+		dwAutoSavePeriodCurrent *= 2;
+		SetTimer(hwndMain, ID_AUTOSAVETIMER, dwAutoSavePeriodCurrent, nullptr);
+		return;
+	}
+	AutoSave_DoWork(FileSaveFlag_Default);
+	dwAutoSaveDirtyBytes = 0;
+	dwAutoSavePeriodCurrent = dwAutoSavePeriod;
+	if (dwCurrentDocReversion == dwLastSavedDocReversion) {
+		bAutoSaveTimerSet = false;
+		KillTimer(hwndMain, ID_AUTOSAVETIMER);
+	} else {
+		// the save was skipped or failed: keep the base period ticking
+		SetTimer(hwndMain, ID_AUTOSAVETIMER, dwAutoSavePeriodCurrent, nullptr);
+	}
+}
+
+// Content addressed chunk store for backups kept with AutoSaveOption_ManuallyDelete.
+// Every generation would otherwise be a full copy of the document, so a large
+// file edited over a long session fills the disk with near identical backups.
+// Instead each generation is written as a small manifest of chunk hashes while
+// the chunk payloads live in the Chunks subfolder named by their content hash:
+// chunks a generation shares with any earlier one are neither rewritten nor
+// stored twice. Chunk boundaries come from a rolling gear hash over the content
+// so they stay aligned across insertions and deletions.
+#define AutoSaveChunkMin		(16*1024)
+#define AutoSaveChunkMax		(256*1024)
+#define AutoSaveChunkMask		0xffffU		// one boundary per 64 KiB of content on average
+#define AutoSaveChunkHeader		"Notepad4 chunked backup v1\r\n"
+
+static uint64_t autoSaveGearTable[256];
+
+static void AutoSave_GetChunkStore(LPWSTR szStore) noexcept {
+	if (autoSaveGearTable[0] == 0) {
+		// splitmix64 sequence; a fixed seed keeps boundaries stable across sessions
+		uint64_t x = 0;
+		for (UINT i = 0; i < COUNTOF(autoSaveGearTable); i++) {
+			x += UINT64_C(0x9E3779B97F4A7C15);
+			uint64_t z = x;
+			z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+			z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+			autoSaveGearTable[i] = z ^ (z >> 31);
+		}
+	}
+	PathCombine(szStore, AutoSave_GetDefaultFolder(), L"Chunks");
+	if (GetFileAttributes(szStore) == INVALID_FILE_ATTRIBUTES) {
+		CreateDirectory(szStore, nullptr);
+	}
+}
+
+static bool AutoSave_WriteChunked(LPCWSTR tchPath, const char *lpData, DWORD cbData) noexcept {
+	WCHAR szStore[MAX_PATH];
+	AutoSave_GetChunkStore(szStore);
+
+	// each record is hash, tab, decimal length, CR LF
+	char * const manifest = static_cast<char *>(NP2HeapAlloc((cbData/AutoSaveChunkMin + 1)*32 + COUNTOF(AutoSaveChunkHeader)));
+	int manifestLen = sprintf(manifest, AutoSaveChunkHeader);
+
+	DWORD pos = 0;
+	bool success = true;
+	while (pos < cbData && success) {
+		const unsigned char * const chunk = reinterpret_cast<const unsigned char *>(lpData + pos);
+		DWORD len = min<DWORD>(cbData - pos, AutoSaveChunkMax);
+		if (len > AutoSaveChunkMin) {
+			uint64_t rolling = 0;
+			DWORD i = AutoSaveChunkMin;
+			do {
+				rolling = (rolling << 1) + autoSaveGearTable[chunk[i]];
+				if ((rolling & AutoSaveChunkMask) == 0) {
+					len = i + 1;
+					break;
+				}
+			} while (++i < len);
+		}
+
+		// FNV-1a over the content names the chunk file in the store
+		uint64_t hash = UINT64_C(0xCBF29CE484222325);
+		for (DWORD i = 0; i < len; i++) {
+			hash = (hash ^ chunk[i]) * UINT64_C(0x100000001B3);
+		}
+
+		WCHAR name[20];
+		wsprintf(name, L"%08x%08x", static_cast<UINT>(hash >> 32), static_cast<UINT>(hash));
+		WCHAR tchChunk[MAX_PATH];
+		PathCombine(tchChunk, szStore, name);
+		if (GetFileAttributes(tchChunk) == INVALID_FILE_ATTRIBUTES) {
+			HANDLE hFile = CreateFile(tchChunk,
+							   GENERIC_WRITE,
+							   FILE_SHARE_READ,
+							   nullptr, CREATE_NEW,
+							   FILE_ATTRIBUTE_NORMAL,
+							   nullptr);
+			dwLastIOError = GetLastError();
+			if (hFile != INVALID_HANDLE_VALUE) {
+				DWORD bytesWritten;
+				success = WriteFile(hFile, chunk, len, &bytesWritten, nullptr) && bytesWritten == len;
+				CloseHandle(hFile);
+				if (!success) {
+					DeleteFile(tchChunk); // a truncated chunk must not poison later generations
+				}
+			} else {
+				// losing the CREATE_NEW race to another instance is fine, the content is identical
+				success = dwLastIOError == ERROR_FILE_EXISTS;
+			}
+		}
+		manifestLen += sprintf(manifest + manifestLen, "%08x%08x\t%u\r\n",
+			static_cast<UINT>(hash >> 32), static_cast<UINT>(hash), len);
+		pos += len;
+	}
+
+	if (success) {
+		HANDLE hFile = CreateFile(tchPath,
+						   GENERIC_WRITE,
+						   FILE_SHARE_READ,
+						   nullptr, CREATE_ALWAYS,
+						   FILE_ATTRIBUTE_NORMAL | FILE_FLAG_WRITE_THROUGH,
+						   nullptr);
+		dwLastIOError = GetLastError();
+		success = false;
+		if (hFile != INVALID_HANDLE_VALUE) {
+			DWORD bytesWritten;
+			success = WriteFile(hFile, manifest, manifestLen, &bytesWritten, nullptr);
+			CloseHandle(hFile);
+		}
+	}
+	NP2HeapFree(manifest);
+	return success;
+}
+
+// rebuild the plain backup file a chunk manifest describes
+static bool AutoSave_ReassembleChunked(LPCWSTR manifestPath, LPCWSTR outPath) noexcept {
+	HANDLE hFile = CreateFile(manifestPath,
+					   GENERIC_READ,
+					   FILE_SHARE_READ,
+					   nullptr, OPEN_EXISTING,
+					   FILE_ATTRIBUTE_NORMAL,
+					   nullptr);
+	if (hFile == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	DWORD cbData = GetFileSize(hFile, nullptr);
+	constexpr DWORD maxManifestSize = 16*1024*1024;
+	if (cbData < COUNTOF(AutoSaveChunkHeader) || cbData == INVALID_FILE_SIZE || cbData > maxManifestSize) {
+		CloseHandle(hFile);
+		return false;
+	}
+	char * const lpData = static_cast<char *>(NP2HeapAlloc(cbData + 1));
+	const BOOL readOK = ReadFile(hFile, lpData, cbData, &cbData, nullptr);
+	CloseHandle(hFile);
+	if (!readOK || memcmp(lpData, AutoSaveChunkHeader, COUNTOF(AutoSaveChunkHeader) - 1) != 0) {
+		NP2HeapFree(lpData);
+		return false;
+	}
+
+	WCHAR szStore[MAX_PATH];
+	AutoSave_GetChunkStore(szStore);
+	HANDLE hOut = CreateFile(outPath,
+					   GENERIC_WRITE,
+					   FILE_SHARE_READ,
+					   nullptr, CREATE_ALWAYS,
+					   FILE_ATTRIBUTE_NORMAL,
+					   nullptr);
+	dwLastIOError = GetLastError();
+	if (hOut == INVALID_HANDLE_VALUE) {
+		NP2HeapFree(lpData);
+		return false;
+	}
+
+	char * const buffer = static_cast<char *>(NP2HeapAlloc(AutoSaveChunkMax));
+	bool success = true;
+	const char *p = lpData + COUNTOF(AutoSaveChunkHeader) - 1;
+	while (success && *p != '\0') {
+		// hash, tab, decimal length, CR LF
+		WCHAR name[20];
+		UINT i = 0;
+		for (; i < 16 && IsHexDigit(p[i]); i++) {
+			name[i] = static_cast<WCHAR>(p[i]);
+		}
+		name[i] = L'\0';
+		if (i != 16 || p[i] != '\t') {
+			success = false;
+			break;
+		}
+		char *next;
+		const DWORD len = strtoul(p + 17, &next, 10);
+		if (len == 0 || len > AutoSaveChunkMax) {
+			success = false;
+			break;
+		}
+		p = next + strspn(next, "\r\n");
+
+		WCHAR tchChunk[MAX_PATH];
+		PathCombine(tchChunk, szStore, name);
+		hFile = CreateFile(tchChunk,
+					   GENERIC_READ,
+					   FILE_SHARE_READ,
+					   nullptr, OPEN_EXISTING,
+					   FILE_ATTRIBUTE_NORMAL,
+					   nullptr);
+		success = false;
+		if (hFile != INVALID_HANDLE_VALUE) {
+			DWORD bytesRead;
+			if (ReadFile(hFile, buffer, len, &bytesRead, nullptr) && bytesRead == len) {
+				success = WriteFile(hOut, buffer, len, &bytesRead, nullptr);
+			}
+			CloseHandle(hFile);
+		}
+	}
+
+	CloseHandle(hOut);
+	NP2HeapFree(buffer);
+	NP2HeapFree(lpData);
+	if (!success) {
+		DeleteFile(outPath);
+	}
+	return success;
+}
+
 void AutoSave_Stop(BOOL keepBackup) noexcept {
 	dwCurrentDocReversion = 0;
 	dwLastSavedDocReversion = 0;
+	dwAutoSaveDirtyBytes = 0;
+	dwAutoSavePeriodCurrent = 0;
 	if (bAutoSaveTimerSet) {
 		bAutoSaveTimerSet = false;
 		KillTimer(hwndMain, ID_AUTOSAVETIMER);
 	}
 	if (autoSaveCount) {
 		keepBackup |= iAutoSaveOption & AutoSaveOption_ManuallyDelete;
+		if (keepBackup) {
+			// materialize the newest generation so the folder always holds a
+			// plain copy of the final state; older generations stay as small
+			// chunk manifests sharing their content through the store.
+			LPCWSTR path = autoSavePathList[autoSaveCount - 1];
+			if (path != nullptr && StrEqual(PathFindExtension(path), L".chunks")) {
+				WCHAR tchPlain[MAX_PATH + 40];
+				lstrcpy(tchPlain, path);
+				PathRemoveExtension(tchPlain);
+				AutoSave_ReassembleChunked(path, tchPlain);
+			}
+		}
 		for (int i = 0; i < autoSaveCount; i++) {
 			LPWSTR path = autoSavePathList[i];
 			if (path) {
@@ -8337,6 +9905,324 @@ LPCWSTR AutoSave_GetDefaultFolder() noexcept {
 	return szFolder;
 }
 
+// Append-only manifest of the backups written into the AutoSave folder, one
+// record per backup: process id, write time, backup file name, original path.
+// Crash recovery then reads this one small file instead of opening every
+// backup to find its "AutoSave for ..." header line.
+static void AutoSave_AppendManifest(LPCWSTR backupPath, LPCWSTR originalPath) noexcept {
+	WCHAR tchManifest[MAX_PATH];
+	PathCombine(tchManifest, AutoSave_GetDefaultFolder(), L"AutoSave.manifest");
+	HANDLE hFile = CreateFile(tchManifest,
+					   FILE_APPEND_DATA,
+					   FILE_SHARE_READ,
+					   nullptr, OPEN_ALWAYS,
+					   FILE_ATTRIBUTE_NORMAL,
+					   nullptr);
+	if (hFile == INVALID_HANDLE_VALUE) {
+		return;
+	}
+
+	WCHAR line[2*MAX_PATH + 64];
+	FILETIME ft;
+	GetSystemTimeAsFileTime(&ft);
+	wsprintf(line, L"%u\t%08x%08x\t%s\t%s\r\n", GetCurrentProcessId(),
+		ft.dwHighDateTime, ft.dwLowDateTime, PathFindFileName(backupPath), originalPath);
+	char buf[COUNTOF(line)*kMaxMultiByteCount];
+	const int len = WideCharToMultiByte(CP_UTF8, 0, line, lstrlen(line), buf, COUNTOF(buf), nullptr, nullptr);
+	DWORD bytesWritten;
+	WriteFile(hFile, buf, len, &bytesWritten, nullptr);
+	CloseHandle(hFile);
+}
+
+static bool IsProcessRunning(DWORD pid) noexcept {
+#if _WIN32_WINNT >= _WIN32_WINNT_VISTA
+	HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+#else
+	HANDLE hProcess = OpenProcess(PROCESS_QUERY_INFORMATION, FALSE, pid);
+#endif
+	if (hProcess == nullptr) {
+		// access denied still means some process owns the id
+		return GetLastError() == ERROR_ACCESS_DENIED;
+	}
+	DWORD exitCode = 0;
+	const bool running = !GetExitCodeProcess(hProcess, &exitCode) || exitCode == STILL_ACTIVE;
+	CloseHandle(hProcess);
+	return running;
+}
+
+void AutoSave_CheckRecovery(HWND hwnd) noexcept {
+	WCHAR tchManifest[MAX_PATH];
+	PathCombine(tchManifest, AutoSave_GetDefaultFolder(), L"AutoSave.manifest");
+	HANDLE hFile = CreateFile(tchManifest,
+					   GENERIC_READ,
+					   FILE_SHARE_READ | FILE_SHARE_WRITE,
+					   nullptr, OPEN_EXISTING,
+					   FILE_ATTRIBUTE_NORMAL,
+					   nullptr);
+	if (hFile == INVALID_HANDLE_VALUE) {
+		return;
+	}
+
+	constexpr DWORD maxManifestSize = 1024*1024;
+	DWORD cbData = GetFileSize(hFile, nullptr);
+	if (cbData == 0 || cbData == INVALID_FILE_SIZE || cbData > maxManifestSize) {
+		CloseHandle(hFile);
+		if (cbData != 0 && cbData != INVALID_FILE_SIZE) {
+			DeleteFile(tchManifest); // oversized or damaged, start over
+		}
+		return;
+	}
+	char * const lpData = static_cast<char *>(NP2HeapAlloc(cbData + 1));
+	const BOOL readOK = ReadFile(hFile, lpData, cbData, &cbData, nullptr);
+	CloseHandle(hFile);
+	if (!readOK) {
+		NP2HeapFree(lpData);
+		return;
+	}
+
+	LPWSTR const text = static_cast<LPWSTR>(NP2HeapAlloc((cbData + 1)*sizeof(WCHAR)));
+	MultiByteToWideChar(CP_UTF8, 0, lpData, cbData, text, cbData + 1);
+	NP2HeapFree(lpData);
+	LPWSTR const kept = static_cast<LPWSTR>(NP2HeapAlloc((cbData + 1)*sizeof(WCHAR)));
+	LPWSTR keptEnd = kept;
+	UINT recoverable = 0;
+	WCHAR tchFirstPath[MAX_PATH + 40];
+	tchFirstPath[0] = L'\0';
+
+	LPWSTR p = text;
+	while (*p != L'\0') {
+		LPWSTR const line = p;
+		LPWSTR eol = StrChr(p, L'\n');
+		if (eol == nullptr) {
+			eol = p + lstrlen(p);
+		} else {
+			++eol;
+		}
+		p = eol;
+
+		// process id, tab, write time, tab, backup file name, tab, original path
+		int64_t pid = 0;
+		LPCWSTR field = ParseInt64(line, &pid);
+		if (field == nullptr || *field != L'\t') {
+			continue; // damaged record, drop it
+		}
+		field = StrChr(field + 1, L'\t');
+		if (field == nullptr) {
+			continue;
+		}
+		LPWSTR const name = const_cast<LPWSTR>(field + 1);
+		LPWSTR const nameEnd = StrChr(name, L'\t');
+		if (nameEnd == nullptr) {
+			continue;
+		}
+
+		const WCHAR chSaved = *nameEnd;
+		*nameEnd = L'\0';
+		WCHAR tchPath[MAX_PATH + 40];
+		PathCombine(tchPath, szAutoSaveFolder, name);
+		const bool exists = GetFileAttributes(tchPath) != INVALID_FILE_ATTRIBUTES;
+		*nameEnd = chSaved;
+
+		if (!exists) {
+			continue; // removed on clean exit or by the user, drop the record
+		}
+		if (!IsProcessRunning(static_cast<DWORD>(pid))) {
+			// backup left behind by a session that never reached AutoSave_Stop()
+			++recoverable;
+			if (tchFirstPath[0] == L'\0') {
+				if (StrEqual(PathFindExtension(tchPath), L".chunks")) {
+					// the crashed session never materialized its final chunked
+					// generation; rebuild the plain file so the prompt points
+					// at something directly openable
+					WCHAR tchPlain[MAX_PATH + 40];
+					lstrcpy(tchPlain, tchPath);
+					PathRemoveExtension(tchPlain);
+					if (AutoSave_ReassembleChunked(tchPath, tchPlain)) {
+						lstrcpy(tchPath, tchPlain);
+					}
+				}
+				lstrcpy(tchFirstPath, tchPath);
+			}
+		}
+		memcpy(keptEnd, line, (eol - line)*sizeof(WCHAR));
+		keptEnd += eol - line;
+	}
+
+	if (keptEnd == kept) {
+		DeleteFile(tchManifest);
+	} else if (keptEnd - kept != lstrlen(text)) {
+		// compact away the dropped records so the manifest stays small
+		hFile = CreateFile(tchManifest,
+					   GENERIC_WRITE,
+					   FILE_SHARE_READ,
+					   nullptr, CREATE_ALWAYS,
+					   FILE_ATTRIBUTE_NORMAL,
+					   nullptr);
+		if (hFile != INVALID_HANDLE_VALUE) {
+			*keptEnd = L'\0';
+			char * const buf = static_cast<char *>(NP2HeapAlloc((keptEnd - kept)*kMaxMultiByteCount + 1));
+			const int len = WideCharToMultiByte(CP_UTF8, 0, kept, static_cast<int>(keptEnd - kept), buf, static_cast<int>((keptEnd - kept)*kMaxMultiByteCount + 1), nullptr, nullptr);
+			DWORD bytesWritten;
+			WriteFile(hFile, buf, len, &bytesWritten, nullptr);
+			CloseHandle(hFile);
+			NP2HeapFree(buf);
+		}
+	}
+	NP2HeapFree(text);
+	NP2HeapFree(kept);
+
+	// with manual deletion backups outlive the session by design, don't nag
+	if (recoverable != 0 && !(iAutoSaveOption & AutoSaveOption_ManuallyDelete)) {
+		if (MsgBoxAsk(MB_YESNO, IDS_RECOVER_AUTOSAVE, recoverable) == IDYES) {
+			OpenContainingFolder(hwnd, tchFirstPath, true);
+		}
+	}
+}
+
+struct AutoSaveWriteContext {
+	HANDLE hFile;
+	Scintilla::ITextSnapshot *snapshot;
+	char *meta;
+	int metaLen;
+	// non-empty for overwrite-current saves: the worker writes a temporary
+	// file and renames it over the real file once complete, so a crash or
+	// power loss mid-write never leaves a truncated document behind.
+	WCHAR tchFinalPath[MAX_PATH + 40];
+	WCHAR tchTempPath[MAX_PATH + 40];
+	// document reversion recorded as saved when the write was launched, and
+	// the value it replaced, so a failed write can un-record the save.
+	DWORD stampedReversion;
+	DWORD previousReversion;
+};
+
+// only one overwrite-current write in flight at a time
+static volatile LONG autoSaveOverwritePending = FALSE;
+// handle of the overwrite worker, owned by the GUI thread so FileSave()
+// can wait for the rename before writing the file itself
+static HANDLE autoSaveOverwriteThread = nullptr;
+
+static DWORD WINAPI AutoSaveWriteThreadProc(LPVOID lpParam) noexcept {
+	AutoSaveWriteContext * const ctx = static_cast<AutoSaveWriteContext *>(lpParam);
+	DWORD bytesWritten;
+	bool success = true;
+	if (ctx->metaLen) {
+		success = WriteFile(ctx->hFile, ctx->meta, ctx->metaLen, &bytesWritten, nullptr)
+			&& bytesWritten == static_cast<DWORD>(ctx->metaLen);
+	}
+	if (success) {
+		const DWORD cbData = static_cast<DWORD>(ctx->snapshot->Length());
+		success = WriteFile(ctx->hFile, ctx->snapshot->Data(), cbData, &bytesWritten, nullptr)
+			&& bytesWritten == cbData;
+	}
+	CloseHandle(ctx->hFile);
+	ctx->snapshot->Release();
+	if (!success) {
+		// a failed or short write must never replace the real file or pose as
+		// a usable backup: drop the file and roll back the saved stamp.
+		DeleteFile(ctx->tchTempPath);
+		PostMessage(hwndMain, APPM_AUTOSAVEFAILED, ctx->stampedReversion, ctx->previousReversion);
+	} else if (ctx->tchFinalPath[0] != L'\0') {
+		if (!ReplaceFile(ctx->tchFinalPath, ctx->tchTempPath, nullptr, REPLACEFILE_IGNORE_MERGE_ERRORS, nullptr, nullptr)) {
+			// the target was deleted or renamed meanwhile
+			MoveFileEx(ctx->tchTempPath, ctx->tchFinalPath, MOVEFILE_REPLACE_EXISTING | MOVEFILE_COPY_ALLOWED);
+		}
+	}
+	if (ctx->tchFinalPath[0] != L'\0') {
+		InterlockedExchange(&autoSaveOverwritePending, FALSE);
+	}
+	NP2HeapFree(ctx->meta);
+	NP2HeapFree(ctx);
+	return 0;
+}
+
+void AutoSave_WaitOverwrite() noexcept {
+	HANDLE hThread = autoSaveOverwriteThread;
+	if (hThread != nullptr) {
+		autoSaveOverwriteThread = nullptr;
+		WaitForSingleObject(hThread, INFINITE);
+		CloseHandle(hThread);
+	}
+}
+
+// overwrite the current file from a document snapshot on a worker thread.
+// 1: write started, 0: needs the synchronous path, -1: skipped for this
+// period because the previous write is still in flight.
+static int AutoSave_OverwriteAsync() noexcept {
+	const UINT uFlags = mEncoding[iCurrentEncoding].uFlags;
+	if ((uFlags & NCP_UNICODE) || !(uFlags & (NCP_DEFAULT | NCP_UTF8))) {
+		// needs encoding conversion, keep the synchronous path
+		return 0;
+	}
+	if (InterlockedCompareExchange(&autoSaveOverwritePending, TRUE, FALSE) != FALSE) {
+		return -1;
+	}
+	// the previous worker has finished, reclaim its handle
+	AutoSave_WaitOverwrite();
+
+	AutoSaveWriteContext * const ctx = static_cast<AutoSaveWriteContext *>(NP2HeapAlloc(sizeof(AutoSaveWriteContext)));
+	lstrcpy(ctx->tchFinalPath, szCurFile);
+	wsprintf(ctx->tchTempPath, L"%s.%u.autosave", szCurFile, GetCurrentProcessId());
+	HANDLE hFile = CreateFile(ctx->tchTempPath,
+					   GENERIC_READ | GENERIC_WRITE,
+					   FILE_SHARE_READ,
+					   nullptr, CREATE_ALWAYS,
+					   FILE_ATTRIBUTE_NORMAL,
+					   nullptr);
+	dwLastIOError = GetLastError();
+	Scintilla::ITextSnapshot *snapshot = nullptr;
+	if (hFile != INVALID_HANDLE_VALUE) {
+		snapshot = static_cast<Scintilla::ITextSnapshot *>(SciCall_CreateSnapshot());
+	}
+	if (snapshot != nullptr) {
+		ctx->hFile = hFile;
+		ctx->snapshot = snapshot;
+		ctx->meta = static_cast<char *>(NP2HeapAlloc(4));
+		if (uFlags & NCP_UTF8_SIGN) {
+			memcpy(ctx->meta, "\xEF\xBB\xBF", 3);
+			ctx->metaLen = 3;
+		}
+		ctx->stampedReversion = dwCurrentDocReversion;
+		ctx->previousReversion = dwLastSavedDocReversion;
+		HANDLE hThread = CreateThread(nullptr, 0, AutoSaveWriteThreadProc, ctx, 0, nullptr);
+		if (hThread != nullptr) {
+			autoSaveOverwriteThread = hThread;
+			return 1;
+		}
+		snapshot->Release();
+		NP2HeapFree(ctx->meta);
+	}
+	if (hFile != INVALID_HANDLE_VALUE) {
+		CloseHandle(hFile);
+		DeleteFile(ctx->tchTempPath);
+	}
+	NP2HeapFree(ctx);
+	InterlockedExchange(&autoSaveOverwritePending, FALSE);
+	return 0;
+}
+
+static bool AutoSave_WriteAsync(HANDLE hFile, LPCWSTR tchPath, char *meta, int metaLen) noexcept {
+	Scintilla::ITextSnapshot * const snapshot = static_cast<Scintilla::ITextSnapshot *>(SciCall_CreateSnapshot());
+	if (snapshot == nullptr) {
+		return false;
+	}
+	AutoSaveWriteContext * const ctx = static_cast<AutoSaveWriteContext *>(NP2HeapAlloc(sizeof(AutoSaveWriteContext)));
+	ctx->hFile = hFile;
+	ctx->snapshot = snapshot;
+	ctx->meta = meta;
+	ctx->metaLen = metaLen;
+	lstrcpy(ctx->tchTempPath, tchPath);
+	ctx->stampedReversion = dwCurrentDocReversion;
+	ctx->previousReversion = dwLastSavedDocReversion;
+	HANDLE hThread = CreateThread(nullptr, 0, AutoSaveWriteThreadProc, ctx, 0, nullptr);
+	if (hThread == nullptr) {
+		snapshot->Release();
+		NP2HeapFree(ctx);
+		return false;
+	}
+	CloseHandle(hThread);
+	return true;
+}
+
 void AutoSave_DoWork(FileSaveFlag saveFlag) noexcept {
 	if (!(saveFlag & FileSaveFlag_SaveAlways) && (!IsDocumentModified() || dwCurrentDocReversion == dwLastSavedDocReversion)) {
 		return;
@@ -8349,12 +10235,23 @@ void AutoSave_DoWork(FileSaveFlag saveFlag) noexcept {
 
 	const bool Untitled = StrIsEmpty(szCurFile);
 	if (!Untitled && saveFlag == FileSaveFlag_Default && (iAutoSaveOption & AutoSaveOption_OverwriteCurrent)) {
+		if (cbData >= AutoSaveAsyncWriteSize) {
+			const int asyncSave = AutoSave_OverwriteAsync();
+			if (asyncSave != 0) {
+				if (asyncSave > 0) {
+					dwLastSavedDocReversion = dwCurrentDocReversion;
+					EditSaveUndoHistory(szCurFile);
+				}
+				return;
+			}
+		}
 		// overwrite current file
 		EditFileIOStatus status{};
 		status.iEncoding = iCurrentEncoding;
 		status.iEOLMode = iCurrentEOLMode;
 		if (EditSaveFile(hwndEdit, szCurFile, FileSaveFlag_EndSession, status)) {
 			dwLastSavedDocReversion = dwCurrentDocReversion;
+			EditSaveUndoHistory(szCurFile);
 			return;
 		}
 	}
@@ -8386,8 +10283,11 @@ void AutoSave_DoWork(FileSaveFlag saveFlag) noexcept {
 	lstrcat(tchPath, suffix);
 
 	// TODO: check free space with GetDiskFreeSpaceExW()
+	// with manual deletion every generation is kept, store them deduplicated
+	const bool chunked = (iAutoSaveOption & AutoSaveOption_ManuallyDelete) && !(saveFlag & FileSaveFlag_SaveAlways);
+	bool inAutoSaveFolder = false;
 	HANDLE hFile = INVALID_HANDLE_VALUE;
-	if (!Untitled) {
+	if (!Untitled && !chunked) {
 		// try to save backup in the same folder as current file
 		hFile = CreateFile(tchPath,
 						   GENERIC_READ | GENERIC_WRITE,
@@ -8399,6 +10299,7 @@ void AutoSave_DoWork(FileSaveFlag saveFlag) noexcept {
 	}
 	if (hFile == INVALID_HANDLE_VALUE) {
 		// save backup in AutoSave folder
+		inAutoSaveFolder = true;
 		if (Untitled) {
 			lstrcpy(suffix, tchPath);
 		} else {
@@ -8408,15 +10309,19 @@ void AutoSave_DoWork(FileSaveFlag saveFlag) noexcept {
 
 		LPCWSTR szFolder = AutoSave_GetDefaultFolder();
 		PathCombine(tchPath, szFolder, suffix);
-		hFile = CreateFile(tchPath,
-						   GENERIC_READ | GENERIC_WRITE,
-						   FILE_SHARE_READ | FILE_SHARE_WRITE,
-						   nullptr, CREATE_NEW,
-						   FILE_ATTRIBUTE_NORMAL | FILE_FLAG_WRITE_THROUGH,
-						   nullptr);
-		dwLastIOError = GetLastError();
+		if (chunked) {
+			lstrcat(tchPath, L".chunks");
+		} else {
+			hFile = CreateFile(tchPath,
+							   GENERIC_READ | GENERIC_WRITE,
+							   FILE_SHARE_READ | FILE_SHARE_WRITE,
+							   nullptr, CREATE_NEW,
+							   FILE_ATTRIBUTE_NORMAL | FILE_FLAG_WRITE_THROUGH,
+							   nullptr);
+			dwLastIOError = GetLastError();
+		}
 	}
-	if (hFile == INVALID_HANDLE_VALUE) {
+	if (hFile == INVALID_HANDLE_VALUE && !chunked) {
 		return;
 	}
 
@@ -8442,13 +10347,31 @@ void AutoSave_DoWork(FileSaveFlag saveFlag) noexcept {
 		}
 	}
 
-	SciCall_GetText(cbData, lpData + metaLen);
-	SetEndOfFile(hFile);
+	if (!chunked) {
+		SetEndOfFile(hFile);
+	}
 	// no encoding conversion, always saved in UTF-8 or ANSI encoding
-	const BOOL bWriteSuccess = WriteFile(hFile, lpData, cbData + metaLen, &length, nullptr);
-	dwLastIOError = GetLastError();
-	CloseHandle(hFile);
-	NP2HeapFree(lpData);
+	BOOL bWriteSuccess;
+	if (chunked) {
+		SciCall_GetText(cbData, lpData + metaLen);
+		// only the chunks this generation does not share with an earlier one
+		// touch the disk, so even large documents back up quickly
+		bWriteSuccess = AutoSave_WriteChunked(tchPath, lpData, cbData + metaLen);
+		NP2HeapFree(lpData);
+	} else if (saveFlag == FileSaveFlag_Default && cbData >= AutoSaveAsyncWriteSize
+		&& AutoSave_WriteAsync(hFile, tchPath, lpData, metaLen)) {
+		// the worker owns hFile and lpData and writes a document snapshot while
+		// editing continues; suspend and shutdown saves stay synchronous. The
+		// backup is recorded optimistically, a failed write deletes the file
+		// and posts APPM_AUTOSAVEFAILED to un-record it.
+		bWriteSuccess = TRUE;
+	} else {
+		SciCall_GetText(cbData, lpData + metaLen);
+		bWriteSuccess = WriteFile(hFile, lpData, cbData + metaLen, &length, nullptr);
+		dwLastIOError = GetLastError();
+		CloseHandle(hFile);
+		NP2HeapFree(lpData);
+	}
 
 	if (bWriteSuccess) {
 		if (saveFlag & FileSaveFlag_SaveAlways) {
@@ -8471,6 +10394,9 @@ void AutoSave_DoWork(FileSaveFlag saveFlag) noexcept {
 
 		autoSavePathList[autoSaveCount++] = StrDup(tchPath);
 		dwLastSavedDocReversion = dwCurrentDocReversion;
+		if (inAutoSaveFolder) {
+			AutoSave_AppendManifest(tchPath, szCurFile);
+		}
 	} else {
 		DeleteFile(tchPath);
 	}
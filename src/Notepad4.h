@@ -84,7 +84,10 @@ struct NP2PARAMS {
 #define IDC_TOOLBAR			0xFB01
 #define IDC_REBAR			0xFB02
 #define IDC_EDIT			0xFB03
+#define IDC_OVERVIEWBAR		0xFB04
 #define IDC_FILENAME		0xFB05
+#define IDC_DIFFVIEW		0xFB06
+#define IDC_SPLITVIEW		0xFB07
 
 // submenu in popup menu, IDR_POPUPMENU
 #define IDP_POPUP_SUBMENU_EDIT	0
@@ -123,10 +126,19 @@ enum {
 // https://www.codeproject.com/tips/1017834/how-to-send-data-from-one-process-to-another-in-cs
 #define APPM_COPYDATA				(WM_APP + 6)
 #define APPM_DROPFILES				(WM_APP + 7)	// ScintillaWin::Drop()
+#define APPM_DEFERREDINIT			(WM_APP + 8)	// initialization staged until after first paint
+#define APPM_DIFFREADY				(WM_APP + 9)	// diff worker finished, see EditDiff.cpp
+#define APPM_SPELLREADY				(WM_APP + 10)	// spell check worker finished, see EditSpell.cpp
+#define APPM_VCSDIFFREADY			(WM_APP + 11)	// git diff worker finished, see EditDiff.cpp
+#define APPM_PAGEVIEWSCAN			(WM_APP + 12)	// line index scan finished, see EditPageView.cpp
+#define APPM_MRUPATHSREADY			(WM_APP + 13)	// recent file existence worker finished
+#define APPM_AUTOSAVEFAILED			(WM_APP + 14)	// async AutoSave write failed, roll back the saved stamp
 
 #define ID_WATCHTIMER				0xA000	// file watch timer
 #define ID_PASTEBOARDTIMER			0xA001	// paste board timer
 #define ID_AUTOSAVETIMER			0xA002	// AutoSave timer
+#define ID_DIFFTIMER				0xA003	// coalesced diff recompute timer
+#define ID_SPELLTIMER				0xA004	// debounced spell check timer
 
 enum EscFunction {
 	EscFunction_None = 0,
@@ -158,17 +170,22 @@ enum PrintFooterOption {
 #define INI_SECTION_NAME_WINDOW_POSITION		L"Window Position"
 #define INI_SECTION_NAME_TOOLBAR_LABELS			L"Toolbar Labels"
 #define INI_SECTION_NAME_SUPPRESSED_MESSAGES	L"Suppressed Messages"
+#define INI_SECTION_NAME_KEYBINDINGS			L"Keybindings"
+#define INI_SECTION_NAME_FILE_VIEW_STATES		L"File View States"
 
 #define MRU_KEY_RECENT_FILES					L"Recent Files"
 #define MRU_KEY_RECENT_FIND						L"Recent Find"
 #define MRU_KEY_RECENT_REPLACE					L"Recent Replace"
+#define MRU_KEY_SAVED_FIND						L"Saved Find"
 #define MRU_MAX_RECENT_FILES					32
 #define MRU_MAX_RECENT_FIND						32
 #define MRU_MAX_RECENT_REPLACE					32
+#define MRU_MAX_SAVED_FIND						12
 
 #define MAX_INI_SECTION_SIZE_SETTINGS			(8 * 1024)
 #define MAX_INI_SECTION_SIZE_FLAGS				(4 * 1024)
 #define MAX_INI_SECTION_SIZE_TOOLBAR_LABELS		(2 * 1024)
+#define MAX_INI_SECTION_SIZE_KEYBINDINGS		(2 * 1024)
 
 extern WCHAR szCurFile[MAX_PATH + 40];
 
@@ -176,6 +193,9 @@ extern WCHAR szCurFile[MAX_PATH + 40];
 BOOL InitApplication(HINSTANCE hInstance) noexcept;
 void InitInstance(HINSTANCE hInstance, int nCmdShow);
 bool ActivatePrevInst() noexcept;
+// named shared memory activation endpoint, see ActivatePrevInst()
+void InstanceTableRegister(HWND hwnd) noexcept;
+void InstanceTableUnregister() noexcept;
 void GetRelaunchParameters(LPWSTR szParameters, LPCWSTR lpszFile, bool newWind, bool emptyWind) noexcept;
 bool RelaunchMultiInst() noexcept;
 bool RelaunchElevated() noexcept;
@@ -188,6 +208,7 @@ void ShowNotificationW(WPARAM notifyPos, LPCWSTR lpszText) noexcept;
 void ShowNotificationMessage(WPARAM notifyPos, UINT uidMessage, ...) noexcept;
 
 void InstallFileWatching(bool terminate) noexcept;
+bool FileAutoReloadAppend() noexcept;
 void CALLBACK WatchTimerProc(HWND hwnd, UINT uMsg, UINT_PTR idEvent, DWORD dwTime) noexcept;
 void CALLBACK PasteBoardTimer(HWND hwnd, UINT uMsg, UINT_PTR idEvent, DWORD dwTime) noexcept;
 
@@ -196,6 +217,7 @@ void SaveSettingsNow(bool bOnlySaveStyle, bool bQuiet) noexcept;
 void SaveSettings(bool bSaveSettingsNow) noexcept;
 void SaveWindowPosition(WCHAR *pIniSectionBuf) noexcept;
 void ClearWindowPositionHistory() noexcept;
+void ClearFileViewStates() noexcept;
 void ParseCommandLine() noexcept;
 void LoadFlags() noexcept;
 
@@ -213,6 +235,13 @@ void UpdateToolbar() noexcept;
 void UpdateFoldMarginWidth() noexcept;
 void UpdateLineNumberWidth() noexcept;
 void UpdateBookmarkMarginWidth() noexcept;
+// recent file existence, resolved off the UI thread so menus and dialogs
+// never block on a dead network share; lookups return stale-allowed data.
+void MRUPathCacheRefresh() noexcept;
+void MRUPathCacheApply(LPARAM lParam) noexcept;
+TripleBoolean MRUPathCacheLookup(LPCWSTR path) noexcept;
+void BeginModificationBatch() noexcept;
+void EndModificationBatch() noexcept;
 
 enum {
 	FullScreenMode_OnStartup = 1,
@@ -228,6 +257,7 @@ struct EditFileIOStatus {
 	int iEOLMode;		// load output
 
 	bool bFileTooBig;	// load output
+	bool bPagedView;	// load output, open through EditPageViewStart() instead
 	bool bUnicodeErr;	// load output
 	bool bBinaryFile;	// load output
 	bool bCancelDataLoss;// save output
@@ -237,6 +267,11 @@ struct EditFileIOStatus {
 	bool bInconsistent;	// load output
 	Sci_Line totalLineCount; // load output, sum(linesCount) + 1
 	Sci_Line linesCount[3];	// load output: CR+LF, LF, CR
+
+	// line length statistics in bytes including the line ending,
+	// only computed for documents of NP2_LONG_LINE_MITIGATION_LIMIT or more.
+	Sci_Position maxLineLength;	// load output
+	Sci_Position percentileLineLength; // load output: ~95th percentile
 };
 
 enum FileLoadFlag {
@@ -270,12 +305,19 @@ enum {
 	AutoSaveOption_OverwriteCurrent = 16,
 	AutoSaveOption_Default = AutoSaveOption_Suspend | AutoSaveOption_Shutdown,
 	AutoSaveDefaultPeriod = 5000,
+	AutoSaveTypingGap = 1000,			// a change this recent when the timer fires means typing continues
+	AutoSaveMaxBackoffShift = 3,		// defer the save at most to 8x the configured period
+	AutoSaveDirtyBytesLimit = 256*1024,	// accumulated changes that force the save despite ongoing typing
 };
 
 void	AutoSave_Start(bool reset) noexcept;
+void	AutoSave_OnModified(Sci_Position length) noexcept;
+void	AutoSave_OnTimer() noexcept;
 void	AutoSave_Stop(BOOL keepBackup) noexcept;
+void	AutoSave_WaitOverwrite() noexcept;
 void	AutoSave_DoWork(FileSaveFlag saveFlag) noexcept;
 LPCWSTR AutoSave_GetDefaultFolder() noexcept;
+void	AutoSave_CheckRecovery(HWND hwnd) noexcept;
 
 LRESULT CALLBACK MainWndProc(HWND hwnd, UINT umsg, WPARAM wParam, LPARAM lParam);
 LRESULT MsgCreate(HWND hwnd, WPARAM wParam, LPARAM lParam) noexcept;
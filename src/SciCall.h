@@ -63,6 +63,14 @@ inline void SciCall_SetSavePoint() noexcept {
 	SciCall(SCI_SETSAVEPOINT, 0, 0);
 }
 
+inline bool SciCall_GetModify() noexcept {
+	return SciCall(SCI_GETMODIFY, 0, 0) != 0;
+}
+
+inline void SciCall_SetText(const char *text) noexcept {
+	SciCall(SCI_SETTEXT, 0, AsInteger<LPARAM>(text));
+}
+
 inline Sci_Position SciCall_GetLine(Sci_Line line, char *text) noexcept {
 	return SciCall(SCI_GETLINE, line, AsInteger<LPARAM>(text));
 }
@@ -268,10 +276,87 @@ inline void SciCall_EndBatchUpdate(bool bNoUndoGroup = false) noexcept {
 	SciCall(SCI_ENDUNDOACTION, bNoUndoGroup, true);
 }
 
+inline LRESULT SciCall_ExecuteBatch(size_t count, const Sci_MessageRecord *records) noexcept {
+	return SciCall(SCI_EXECUTEBATCH, count, AsInteger<LPARAM>(records));
+}
+
+inline void SciCall_StartRecord() noexcept {
+	SciCall(SCI_STARTRECORD, 0, 0);
+}
+
+inline void SciCall_StopRecord() noexcept {
+	SciCall(SCI_STOPRECORD, 0, 0);
+}
+
+// Records a sequence of SCI_* operations and executes them in one entry into
+// the window procedure, with a single undo group and one redraw/notification
+// cycle. Any pointer passed as wParam / lParam must stay valid until Flush().
+template <size_t capacity>
+struct SciMessageBatch {
+	size_t count = 0;
+	Sci_MessageRecord records[capacity];
+
+	void Record(UINT message, WPARAM wParam = 0, LPARAM lParam = 0) noexcept {
+		if (count == capacity) {
+			Flush();
+		}
+		records[count++] = { message, wParam, static_cast<sptr_t>(lParam) };
+	}
+	void Record(UINT message, WPARAM wParam, const char *lParam) noexcept {
+		Record(message, wParam, AsInteger<LPARAM>(lParam));
+	}
+	void Flush() noexcept {
+		if (count != 0) {
+			SciCall_ExecuteBatch(count, records);
+			count = 0;
+		}
+	}
+};
+
 inline size_t SciCall_GetUndoActions() noexcept {
 	return SciCall(SCI_GETUNDOACTIONS, 0, 0);
 }
 
+inline int SciCall_GetUndoSequence() noexcept {
+	return static_cast<int>(SciCall(SCI_GETUNDOSEQUENCE, 0, 0));
+}
+
+inline void SciCall_SetUndoSavePoint(int action) noexcept {
+	SciCall(SCI_SETUNDOSAVEPOINT, action, 0);
+}
+
+inline int SciCall_GetUndoSavePoint() noexcept {
+	return static_cast<int>(SciCall(SCI_GETUNDOSAVEPOINT, 0, 0));
+}
+
+inline void SciCall_SetUndoCurrent(int action) noexcept {
+	SciCall(SCI_SETUNDOCURRENT, action, 0);
+}
+
+inline int SciCall_GetUndoCurrent() noexcept {
+	return static_cast<int>(SciCall(SCI_GETUNDOCURRENT, 0, 0));
+}
+
+inline int SciCall_GetUndoActionType(int action) noexcept {
+	return static_cast<int>(SciCall(SCI_GETUNDOACTIONTYPE, action, 0));
+}
+
+inline Sci_Position SciCall_GetUndoActionPosition(int action) noexcept {
+	return SciCall(SCI_GETUNDOACTIONPOSITION, action, 0);
+}
+
+inline size_t SciCall_GetUndoActionText(int action, char *text) noexcept {
+	return SciCall(SCI_GETUNDOACTIONTEXT, action, AsInteger<LPARAM>(text));
+}
+
+inline void SciCall_PushUndoActionType(int type, Sci_Position position) noexcept {
+	SciCall(SCI_PUSHUNDOACTIONTYPE, type, position);
+}
+
+inline void SciCall_ChangeLastUndoActionText(size_t length, const char *text) noexcept {
+	SciCall(SCI_CHANGELASTUNDOACTIONTEXT, length, AsInteger<LPARAM>(text));
+}
+
 inline void SciCall_SetChangeHistory(int changeHistory) noexcept {
 	SciCall(SCI_SETCHANGEHISTORY, changeHistory, 0);
 }
@@ -450,6 +535,14 @@ inline void SciCall_CountCharactersAndColumns(Sci_TextToFindFull *ft) noexcept {
 	SciCall(SCI_COUNTCHARACTERSANDCOLUMNS, 0, AsInteger<LPARAM>(ft));
 }
 
+inline void SciCall_AllocateLineCharacterIndex(int lineCharacterIndex) noexcept {
+	SciCall(SCI_ALLOCATELINECHARACTERINDEX, lineCharacterIndex, 0);
+}
+
+inline void SciCall_ReleaseLineCharacterIndex(int lineCharacterIndex) noexcept {
+	SciCall(SCI_RELEASELINECHARACTERINDEX, lineCharacterIndex, 0);
+}
+
 // Multiple Selection and Virtual Space
 
 inline void SciCall_SetMultipleSelection(bool multipleSelection) noexcept {
@@ -603,6 +696,10 @@ inline void SciCall_ConvertEOLs(int eolMode) noexcept {
 	SciCall(SCI_CONVERTEOLS, eolMode, 0);
 }
 
+inline void SciCall_GetLineEndCounts(Sci_LineEndCounts *counts) noexcept {
+	SciCall(SCI_GETLINEENDCOUNTS, 0, AsInteger<LPARAM>(counts));
+}
+
 inline void SciCall_SetViewEOL(bool visible) noexcept {
 	SciCall(SCI_SETVIEWEOL, visible, 0);
 }
@@ -631,6 +728,10 @@ inline void SciCall_SetIdleStyling(int idleStyling) noexcept {
 	SciCall(SCI_SETIDLESTYLING, idleStyling, 0);
 }
 
+inline void SciCall_SetIdleStylingBudget(int milliseconds) noexcept {
+	SciCall(SCI_SETIDLESTYLINGBUDGET, milliseconds, 0);
+}
+
 inline void SciCall_StartStyling(Sci_Position start) noexcept {
 	SciCall(SCI_STARTSTYLING, start, 0);
 }
@@ -639,6 +740,14 @@ inline int SciCall_GetLineState(Sci_Line line) noexcept {
 	return static_cast<int>(SciCall(SCI_GETLINESTATE, line, 0));
 }
 
+inline void SciCall_SetLineState(Sci_Line line, int state) noexcept {
+	SciCall(SCI_SETLINESTATE, line, state);
+}
+
+inline void SciCall_SetStylingEx(Sci_Position length, const char *styles) noexcept {
+	SciCall(SCI_SETSTYLINGEX, length, AsInteger<LPARAM>(styles));
+}
+
 // Style definition
 
 inline void SciCall_StyleResetDefault() noexcept {
@@ -934,6 +1043,18 @@ inline void SciCall_SetTabMinimumWidth(int pixels) noexcept {
 	SciCall(SCI_SETTABMINIMUMWIDTH, pixels, 0);
 }
 
+inline void SciCall_ClearTabStops(Sci_Line line) noexcept {
+	SciCall(SCI_CLEARTABSTOPS, line, 0);
+}
+
+inline void SciCall_AddTabStop(Sci_Line line, int x) noexcept {
+	SciCall(SCI_ADDTABSTOP, line, x);
+}
+
+inline int SciCall_GetNextTabStop(Sci_Line line, int x) noexcept {
+	return static_cast<int>(SciCall(SCI_GETNEXTTABSTOP, line, x));
+}
+
 inline void SciCall_SetUseTabs(bool useTabs) noexcept {
 	SciCall(SCI_SETUSETABS, useTabs, 0);
 }
@@ -1020,6 +1141,10 @@ inline int SciCall_MarkerAdd(Sci_Line line, int markerNumber) noexcept {
 	return static_cast<int>(SciCall(SCI_MARKERADD, line, markerNumber));
 }
 
+inline void SciCall_MarkerAddList(int markerNumber, const struct Sci_MarkerList *list) noexcept {
+	SciCall(SCI_MARKERADDLIST, markerNumber, AsInteger<LPARAM>(list));
+}
+
 inline void SciCall_MarkerDelete(Sci_Line line, int markerNumber) noexcept {
 	SciCall(SCI_MARKERDELETE, line, markerNumber);
 }
@@ -1078,6 +1203,10 @@ inline void SciCall_IndicatorFillRange(Sci_Position start, Sci_Position length)
 	SciCall(SCI_INDICATORFILLRANGE, start, length);
 }
 
+inline void SciCall_IndicatorFillList(const struct Sci_RangeList *list) noexcept {
+	SciCall(SCI_INDICATORFILLLIST, 0, AsInteger<LPARAM>(list));
+}
+
 // Autocompletion
 
 inline void SciCall_AutoCShow(Sci_Position lengthEntered, const char *itemList) noexcept {
@@ -1298,14 +1427,30 @@ inline const char* SciCall_GetRangePointer(Sci_Position start, Sci_Position leng
 
 // Multiple views
 
+inline HANDLE SciCall_GetDocPointer() noexcept {
+	return AsPointer<HANDLE>(SciCall(SCI_GETDOCPOINTER, 0, 0));
+}
+
 inline void SciCall_SetDocPointer(HANDLE doc) noexcept {
 	SciCall(SCI_SETDOCPOINTER, 0, AsInteger<LPARAM>(doc));
 }
 
+inline void SciCall_AddRefDocument(HANDLE doc) noexcept {
+	SciCall(SCI_ADDREFDOCUMENT, 0, AsInteger<LPARAM>(doc));
+}
+
 inline HANDLE SciCall_CreateDocument(Sci_Position bytes, int documentOptions) noexcept {
 	return AsPointer<HANDLE>(SciCall(SCI_CREATEDOCUMENT, bytes, documentOptions));
 }
 
+inline HANDLE SciCall_CreateLoader(Sci_Position bytes, int documentOptions) noexcept {
+	return AsPointer<HANDLE>(SciCall(SCI_CREATELOADER, bytes, documentOptions));
+}
+
+inline HANDLE SciCall_CreateSnapshot() noexcept {
+	return AsPointer<HANDLE>(SciCall(SCI_CREATESNAPSHOT, 0, 0));
+}
+
 inline void SciCall_ReleaseDocument(HANDLE doc) noexcept {
 	SciCall(SCI_RELEASEDOCUMENT, 0, AsInteger<LPARAM>(doc));
 }
@@ -1320,6 +1465,14 @@ inline Sci_Line SciCall_DocLineFromVisible(Sci_Line displayLine) noexcept {
 	return SciCall(SCI_DOCLINEFROMVISIBLE, displayLine, 0);
 }
 
+inline Sci_Line SciCall_VisibleFromDocLine(Sci_Line docLine) noexcept {
+	return SciCall(SCI_VISIBLEFROMDOCLINE, docLine, 0);
+}
+
+inline Sci_Line SciCall_LinesOnScreen() noexcept {
+	return SciCall(SCI_LINESONSCREEN, 0, 0);
+}
+
 inline bool SciCall_GetLineVisible(Sci_Line line) noexcept {
 	return static_cast<bool>(SciCall(SCI_GETLINEVISIBLE, line, 0));
 }
@@ -1328,6 +1481,10 @@ inline int SciCall_GetFoldLevel(Sci_Line line) noexcept {
 	return static_cast<int>(SciCall(SCI_GETFOLDLEVEL, line, 0));
 }
 
+inline void SciCall_SetFoldLevel(Sci_Line line, int level) noexcept {
+	SciCall(SCI_SETFOLDLEVEL, line, level);
+}
+
 inline void SciCall_SetFoldFlags(int flags) noexcept {
 	SciCall(SCI_SETFOLDFLAGS, flags, 0);
 }
@@ -1414,6 +1571,26 @@ inline void SciCall_SetLayoutCache(int cacheMode) noexcept {
 	SciCall(SCI_SETLAYOUTCACHE, cacheMode, 0);
 }
 
+inline void SciCall_SetLayoutCacheBudget(size_t lines) noexcept {
+	SciCall(SCI_SETLAYOUTCACHEBUDGET, lines, 0);
+}
+
+inline void SciCall_GetLayoutCacheStats(Sci_LayoutCacheStats *stats) noexcept {
+	SciCall(SCI_GETLAYOUTCACHESTATS, 0, AsInteger<LPARAM>(stats));
+}
+
+inline size_t SciCall_GetMemoryUsage(Sci_MemoryUsage *usage) noexcept {
+	return SciCall(SCI_GETMEMORYUSAGE, 0, AsInteger<LPARAM>(usage));
+}
+
+inline void SciCall_SetPaintProfiler(bool enabled) noexcept {
+	SciCall(SCI_SETPAINTPROFILER, enabled, 0);
+}
+
+inline bool SciCall_GetPaintProfiler() noexcept {
+	return SciCall(SCI_GETPAINTPROFILER, 0, 0) != 0;
+}
+
 inline void SciCall_LinesSplit(int pixelWidth) noexcept {
 	SciCall(SCI_LINESSPLIT, pixelWidth, 0);
 }
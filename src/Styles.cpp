@@ -36,6 +36,7 @@ struct IUnknown;
 #include "GraphicUtils.h"
 #include "Notepad4.h"
 #include "Edit.h"
+#include "EditSpell.h"
 #include "Styles.h"
 #include "Dialogs.h"
 #include "resource.h"
@@ -294,8 +295,9 @@ int np2LexLangIndex = 0;
 static bool tabSeparatedValue; // for TSV file
 static int iCsvOption = ('\"' << 8) | ',';
 
-#define CsvOption_BackslashEscape	(1 << 15)
-#define CsvOption_MergeDelimiter	(1 << 16)
+int Style_GetCsvOption() noexcept {
+	return iCsvOption;
+}
 #define LexerChanged_Override		2
 
 #define STYLESMODIFIED_NONE			0
@@ -344,6 +346,7 @@ CaretStyle iCaretStyle = CaretStyle_LineWidth1;
 bool bBlockCaretForOVRMode = false;
 bool bBlockCaretOutSelection = false;
 int		iCaretBlinkPeriod = -1; // system default, 0 for noblink
+int		iIdleStylingBudget = 0; // milliseconds per styling slice, 0 for editor default
 static bool bBookmarkColorUpdated;
 static int	iDefaultLexerIndex;
 static bool bAutoSelect;
@@ -599,6 +602,34 @@ HFONT Style_CreateCodeFont(UINT dpi) noexcept {
 	return font;
 }
 
+//=============================================================================
+//
+// Resolved style cache: applying a scheme otherwise re-parses every style
+// definition string (a dozen linear scans per EDITSTYLE) on each file type
+// switch. The fully parsed attributes for recently used schemes are kept so
+// switching back to a scheme replays them without touching the strings.
+//
+static void Style_Parse(StyleDefinition *style, LPCWSTR lpszStyle) noexcept;
+static void Style_SetParsed(const StyleDefinition *style, int iStyle) noexcept;
+
+struct ParsedStyleCache {
+	LPCEDITLEXER pLex;
+	StyleDefinition *styles;	// one per EDITSTYLE in pLex
+};
+
+// current and previous scheme plus the HTML / JavaScript / CSS sub-schemes
+// applied along with Markdown and PHP.
+static ParsedStyleCache parsedStyleCacheList[5];
+static UINT parsedStyleCacheSlot = 0;
+
+static void Style_InvalidateParsedStyles(LPCEDITLEXER pLex) noexcept {
+	for (ParsedStyleCache &cache : parsedStyleCacheList) {
+		if (pLex == nullptr || cache.pLex == pLex) {
+			cache.pLex = nullptr;
+		}
+	}
+}
+
 void Style_ReleaseResources() noexcept {
 	NP2HeapFree(g_AllFileExtensions);
 	for (UINT iLexer = 0; iLexer < ALL_LEXER_COUNT; iLexer++) {
@@ -607,6 +638,11 @@ void Style_ReleaseResources() noexcept {
 			NP2HeapFree(pLex->szStyleBuf);
 		}
 	}
+	for (const ParsedStyleCache &cache : parsedStyleCacheList) {
+		if (cache.styles) {
+			NP2HeapFree(cache.styles);
+		}
+	}
 }
 
 static inline bool IsStyleLoaded(LPCEDITLEXER pLex) noexcept {
@@ -650,9 +686,10 @@ static inline void SaveLexTabSettings(IniSectionBuilder &section, LPCEDITLEXER p
 }
 
 static void Style_LoadOneEx(PEDITLEXER pLex, IniSectionParser &section, WCHAR *pIniSectionBuf, int cchIniSection) noexcept {
+	Style_InvalidateParsedStyles(pLex);
 	pLex->iStyleTheme = static_cast<uint8_t>(np2StyleTheme);
 	LPCWSTR themePath = GetStyleThemeFilePath();
-	GetPrivateProfileSection(pLex->pszName, pIniSectionBuf, cchIniSection, themePath);
+	IniCacheGetSection(pLex->pszName, pIniSectionBuf, cchIniSection, themePath);
 
 	const UINT iStyleCount = pLex->iStyleCount;
 	LPWSTR szValue = pLex->szStyleBuf;
@@ -782,6 +819,10 @@ void Style_Load() noexcept {
 	// auto select
 	bAutoSelect = section.GetBool(L"AutoSelect", true);
 
+	// idle styling deadline budget
+	iValue = section.GetInt(L"IdleStylingBudget", 0);
+	iIdleStylingBudget = max(iValue, 0);
+
 	// file extensions
 	LoadIniSection(INI_SECTION_NAME_FILE_EXTENSIONS, pIniSectionBuf, cchIniSection);
 	section.Parse(pIniSectionBuf);
@@ -820,6 +861,38 @@ static void Style_LoadOne(PEDITLEXER pLex) noexcept {
 	NP2HeapFree(pIniSectionBuf);
 }
 
+static const StyleDefinition *Style_GetParsedStyles(PEDITLEXER pLex) noexcept {
+	if (!IsStyleLoaded(pLex)) {
+		Style_LoadOne(pLex);
+	}
+
+	ParsedStyleCache *cache = nullptr;
+	for (ParsedStyleCache &entry : parsedStyleCacheList) {
+		if (entry.pLex == pLex) {
+			return entry.styles;
+		}
+		if (entry.pLex == nullptr && cache == nullptr) {
+			cache = &entry;
+		}
+	}
+	if (cache == nullptr) {
+		cache = &parsedStyleCacheList[parsedStyleCacheSlot];
+		parsedStyleCacheSlot = (parsedStyleCacheSlot + 1) % COUNTOF(parsedStyleCacheList);
+	}
+	if (cache->styles != nullptr) {
+		NP2HeapFree(cache->styles);
+	}
+
+	const UINT iStyleCount = pLex->iStyleCount;
+	StyleDefinition * const styles = static_cast<StyleDefinition *>(NP2HeapAlloc(iStyleCount * sizeof(StyleDefinition)));
+	for (UINT i = 0; i < iStyleCount; i++) {
+		Style_Parse(&styles[i], pLex->Styles[i].szValue);
+	}
+	cache->pLex = pLex;
+	cache->styles = styles;
+	return styles;
+}
+
 static void Style_LoadAll(bool bReload, bool onlyCustom) noexcept {
 	IniSectionParser section;
 	WCHAR *pIniSectionBuf = static_cast<WCHAR *>(NP2HeapAlloc(sizeof(WCHAR) * MAX_INI_SECTION_SIZE_STYLES));
@@ -832,7 +905,7 @@ static void Style_LoadAll(bool bReload, bool onlyCustom) noexcept {
 		LPCWSTR themePath = GetStyleThemeFilePath();
 		memcpy(customColor, defaultCustomColor, MAX_CUSTOM_COLOR_COUNT * sizeof(COLORREF));
 
-		GetPrivateProfileSection(INI_SECTION_NAME_CUSTOM_COLORS, pIniSectionBuf, cchIniSection, themePath);
+		IniCacheGetSection(INI_SECTION_NAME_CUSTOM_COLORS, pIniSectionBuf, cchIniSection, themePath);
 		section.ParseArray(pIniSectionBuf, FALSE);
 
 		const UINT count = min<UINT>(section.count, MAX_CUSTOM_COLOR_COUNT);
@@ -879,6 +952,9 @@ void Style_Save() noexcept {
 	// auto select
 	section.SetBoolEx(L"AutoSelect", bAutoSelect, true);
 
+	// idle styling deadline budget
+	section.SetIntEx(L"IdleStylingBudget", iIdleStylingBudget, 0);
+
 	SaveIniSection(INI_SECTION_NAME_STYLES, pIniSectionBuf);
 
 	// file extensions
@@ -1023,6 +1099,7 @@ bool Style_Import(HWND hwnd) noexcept {
 
 		section.Free();
 		NP2HeapFree(pIniSectionBuf);
+		Style_InvalidateParsedStyles(nullptr);
 		return true;
 	}
 	return false;
@@ -1092,6 +1169,7 @@ bool Style_Export(HWND hwnd) noexcept {
 }
 
 static void Style_ResetAll(bool resetColor) noexcept {
+	Style_InvalidateParsedStyles(nullptr);
 	if (resetColor) {
 		memcpy(customColor, defaultCustomColor, MAX_CUSTOM_COLOR_COUNT * sizeof(COLORREF));
 	}
@@ -1222,18 +1300,15 @@ static inline void Style_SetDefaultStyle(int index) noexcept {
 }
 
 static void Style_SetAllStyle(PEDITLEXER pLex, UINT offset) noexcept {
-	if (!IsStyleLoaded(pLex)) {
-		Style_LoadOne(pLex);
-	}
+	const StyleDefinition * const styles = Style_GetParsedStyles(pLex);
 
 	const UINT high = offset << 8;
 	const UINT iStyleCount = pLex->iStyleCount;
 	// first style is the default style.
 	for (UINT i = 1; i < iStyleCount; i++) {
 		const UINT iStyle = pLex->Styles[i].iStyle;
-		LPCWSTR szValue = pLex->Styles[i].szValue;
 		const int first = (iStyle & 0xff) + offset;
-		Style_SetStyles(first, szValue);
+		Style_SetParsed(&styles[i], first);
 		if (iStyle > 0xff) {
 			SciCall_CopyStyles(first | high, iStyle >> 8);
 		}
@@ -1717,6 +1792,17 @@ void Style_SetLexer(PEDITLEXER pLexNew, BOOL bLexerChanged) noexcept {
 	}
 	//! end Mark Occurrences
 
+	// multi-pattern Mark All, one color per saved search
+	static const COLORREF multiPatternMarkColors[MultiPatternMarkCount] = {
+		RGB(0x00, 0x80, 0xFF), RGB(0xFF, 0x80, 0x00), RGB(0x00, 0xA0, 0x00), RGB(0xC8, 0x00, 0xC8),
+		RGB(0xE0, 0x00, 0x40), RGB(0x00, 0xA0, 0xA0), RGB(0xA0, 0xA0, 0x00), RGB(0x80, 0x40, 0xFF),
+	};
+	for (int index = 0; index < MultiPatternMarkCount; index++) {
+		SciCall_IndicSetStyle(IndicatorNumber_MultiPatternMark + index, INDIC_ROUNDBOX);
+		SciCall_IndicSetFore(IndicatorNumber_MultiPatternMark + index, multiPatternMarkColors[index]);
+		SciCall_IndicSetAlpha(IndicatorNumber_MultiPatternMark + index, MarkOccurrencesDefaultAlpha);
+	}
+
 	// Bookmark
 	bBookmarkColorUpdated = true;
 	// SC_MARK_CIRCLE is the default marker type.
@@ -1754,21 +1840,18 @@ void Style_SetLexer(PEDITLEXER pLexNew, BOOL bLexerChanged) noexcept {
 			break;
 
 		case NP2LEX_MARKDOWN:
-		case NP2LEX_PHP:
-			if (!IsStyleLoaded(&lexHTML)) {
-				Style_LoadOne(&lexHTML);
-			}
+		case NP2LEX_PHP: {
 			if (rid == NP2LEX_MARKDOWN) {
 				SciCall_CopyStyles(STYLE_LINK, MULTI_STYLE(SCE_MARKDOWN_PLAIN_LINK, SCE_MARKDOWN_PAREN_LINK, SCE_MARKDOWN_ANGLE_LINK, STYLE_COMMENT_LINK));
 			} else {
 				Style_SetAllStyle(&lexJavaScript, SCE_PHP_LABEL + 1);
 				Style_SetAllStyle(&lexCSS, SCE_PHP_LABEL + SCE_JS_LABEL + 2);
 			}
+			const StyleDefinition * const htmlStyles = Style_GetParsedStyles(&lexHTML);
 			for (UINT i = 1; i < lexHTML.iStyleCount; i++) {
 				const UINT iStyle = lexHTML.Styles[i].iStyle;
-				szValue = lexHTML.Styles[i].szValue;
 				const int first = iStyle & 0xff;
-				Style_SetStyles(first, szValue);
+				Style_SetParsed(&htmlStyles[i], first);
 				if (iStyle > 0xFF) {
 					SciCall_CopyStyles(first, iStyle >> 8);
 				}
@@ -1776,7 +1859,7 @@ void Style_SetLexer(PEDITLEXER pLexNew, BOOL bLexerChanged) noexcept {
 					break;
 				}
 			}
-			break;
+		} break;
 		}
 	} else {
 		szValue = pLexNew->Styles[ANSIArtStyleIndex_LineNumber].szValue;
@@ -1807,7 +1890,9 @@ void Style_SetLexer(PEDITLEXER pLexNew, BOOL bLexerChanged) noexcept {
 
 		// Save current lexer
 		pLexCurrent = pLexNew;
+		foldOutline.Invalidate();
 		InitAutoCompletionCache(pLexNew);
+		EditSpellOnLexerChanged();
 		UpdateStatusBarCache(StatusItem_Lexer);
 		UpdateStatusbar();
 	}
@@ -3758,8 +3843,7 @@ void Style_SetStyles(int iStyle, LPCWSTR lpszStyle) noexcept {
 	}
 }
 
-#if 0
-void Style_Parse(StyleDefinition *style, LPCWSTR lpszStyle) noexcept {
+static void Style_Parse(StyleDefinition *style, LPCWSTR lpszStyle) noexcept {
 	UINT mask = 0;
 	int iValue;
 	COLORREF rgb;
@@ -3814,7 +3898,7 @@ void Style_Parse(StyleDefinition *style, LPCWSTR lpszStyle) noexcept {
 	style->mask = mask;
 }
 
-void Style_SetParsed(const StyleDefinition *style, int iStyle) noexcept {
+static void Style_SetParsed(const StyleDefinition *style, int iStyle) noexcept {
 	const UINT mask = style->mask;
 
 	// Font
@@ -3863,17 +3947,11 @@ void Style_SetParsed(const StyleDefinition *style, int iStyle) noexcept {
 		SciCall_StyleSetEOLFilled(iStyle, true);
 	}
 
-	// Case
-	if (mask & STYLE_MASK_FORCE_CASE) {
-		SciCall_StyleSetCase(iStyle, style->forceCase);
-	}
-
 	// Character Set
 	if (mask & StyleDefinitionMask_Charset) {
 		SciCall_StyleSetCharacterSet(iStyle, style->charset);
 	}
 }
-#endif
 
 //=============================================================================
 //
@@ -3918,8 +3996,11 @@ int Style_GetLexerIconId(LPCEDITLEXER pLex, DWORD iconFlags) noexcept {
 //
 // Style_AddLexerToTreeView()
 //
-HTREEITEM Style_AddLexerToTreeView(HWND hwnd, LPCEDITLEXER pLex, DWORD iconFlags, HTREEITEM hParent, HTREEITEM hInsertAfter, bool withStyles) noexcept {
-#if NP2_ENABLE_LOCALIZE_LEXER_NAME || NP2_ENABLE_LOCALIZE_STYLE_NAME
+// The icon is resolved on demand in TVN_GETDISPINFO and the style nodes are
+// added on first expand, so opening a dialog with all lexers is cheap.
+//
+HTREEITEM Style_AddLexerToTreeView(HWND hwnd, LPCEDITLEXER pLex, HTREEITEM hParent, HTREEITEM hInsertAfter, bool withStyles) noexcept {
+#if NP2_ENABLE_LOCALIZE_LEXER_NAME
 	WCHAR tch[MAX_EDITLEXER_NAME_SIZE];
 #endif
 
@@ -3938,21 +4019,40 @@ HTREEITEM Style_AddLexerToTreeView(HWND hwnd, LPCEDITLEXER pLex, DWORD iconFlags
 #else
 	tvis.item.pszText = const_cast<WCHAR *>(pLex->pszName);
 #endif
-	tvis.item.iImage = Style_GetLexerIconId(pLex, iconFlags);
-	tvis.item.iSelectedImage = tvis.item.iImage;
+	tvis.item.iImage = I_IMAGECALLBACK;
+	tvis.item.iSelectedImage = I_IMAGECALLBACK;
 	tvis.item.lParam = AsInteger<LPARAM>(pLex);
-
-	hParent = TreeView_InsertItem(hwnd, &tvis);
-	if (!withStyles) {
-		return hParent;
+	if (withStyles) {
+		// show the expand button, the children are added in Style_AddStylesToTreeView()
+		tvis.item.mask |= TVIF_CHILDREN;
+		tvis.item.cChildren = 1;
 	}
 
+	return TreeView_InsertItem(hwnd, &tvis);
+}
+
+//=============================================================================
+//
+// Style_AddStylesToTreeView()
+//
+// Inserts the style nodes for a lexer added with withStyles, called when the
+// node is expanded (or selected) for the first time.
+//
+static void Style_AddStylesToTreeView(HWND hwnd, LPCEDITLEXER pLex, HTREEITEM hParent) noexcept {
+#if NP2_ENABLE_LOCALIZE_STYLE_NAME
+	WCHAR tch[MAX_EDITLEXER_NAME_SIZE];
+#endif
+
+	TVINSERTSTRUCT tvis;
+	memset(&tvis, 0, sizeof(TVINSERTSTRUCT));
+
 	tvis.hParent = hParent;
-	//tvis.item.mask = TVIF_TEXT | TVIF_IMAGE | TVIF_SELECTEDIMAGE | TVIF_PARAM;
-	//tvis.item.iImage = -1;
-	//tvis.item.iSelectedImage = -1;
+	tvis.item.mask = TVIF_TEXT | TVIF_IMAGE | TVIF_SELECTEDIMAGE | TVIF_PARAM;
+	constexpr DWORD iconFlags = SHGFI_USEFILEATTRIBUTES | SHGFI_SMALLICON | SHGFI_SYSICONINDEX;
+	tvis.item.iImage = Style_GetLexerIconId(pLex, iconFlags);
+	tvis.item.iSelectedImage = tvis.item.iImage;
 
-	hInsertAfter = TVI_FIRST;
+	HTREEITEM hInsertAfter = TVI_FIRST;
 	const UINT iStyleCount = pLex->iStyleCount;
 
 	for (UINT i = 0; i < iStyleCount; i++) {
@@ -3969,8 +4069,25 @@ HTREEITEM Style_AddLexerToTreeView(HWND hwnd, LPCEDITLEXER pLex, DWORD iconFlags
 		tvis.item.lParam = AsInteger<LPARAM>(&pLex->Styles[i]);
 		hInsertAfter = TreeView_InsertItem(hwnd, &tvis);
 	}
+}
 
-	return hParent;
+//=============================================================================
+//
+// Style_TreeViewGetDispInfo()
+//
+// Resolves the icon for a lexer node when it becomes visible, the result is
+// cached on the item with TVIF_DI_SETITEM.
+//
+static void Style_TreeViewGetDispInfo(LPARAM lParam) noexcept {
+	NMTVDISPINFO * const lpnmtvdi = AsPointer<NMTVDISPINFO *>(lParam);
+	if ((lpnmtvdi->item.mask & (TVIF_IMAGE | TVIF_SELECTEDIMAGE)) && lpnmtvdi->item.lParam != 0) {
+		constexpr DWORD iconFlags = SHGFI_USEFILEATTRIBUTES | SHGFI_SMALLICON | SHGFI_SYSICONINDEX;
+		LPCEDITLEXER pLex = AsPointer<LPCEDITLEXER>(lpnmtvdi->item.lParam);
+		const int iIcon = Style_GetLexerIconId(pLex, iconFlags);
+		lpnmtvdi->item.iImage = iIcon;
+		lpnmtvdi->item.iSelectedImage = iIcon;
+		lpnmtvdi->item.mask |= TVIF_DI_SETITEM;
+	}
 }
 
 #if 0
@@ -4131,7 +4248,7 @@ static HTREEITEM Style_AddAllLexerToTreeView(HWND hwndTV, bool withStyles, bool
 			HTREEITEM hTreeNode = TVI_FIRST;
 			for (int j = 0; j < count; j++) {
 				LPCEDITLEXER pLex = pLexArray[iLexer++];
-				hTreeNode = Style_AddLexerToTreeView(hwndTV, pLex, iconFlags, hParent, hTreeNode, withStyles);
+				hTreeNode = Style_AddLexerToTreeView(hwndTV, pLex, hParent, hTreeNode, withStyles);
 				if (hSelNode == nullptr && pLex == pLexCurrent) {
 					hSelNode = hTreeNode;
 					hSelParent = hParent;
@@ -4156,7 +4273,7 @@ static HTREEITEM Style_AddAllLexerToTreeView(HWND hwndTV, bool withStyles, bool
 			HTREEITEM hTreeNode = TVI_FIRST;
 			for (int j = 0; j < count; j++) {
 				LPCEDITLEXER pLex = generalLex[iLexer++];
-				hTreeNode = Style_AddLexerToTreeView(hwndTV, pLex, iconFlags, hParent, hTreeNode, withStyles);
+				hTreeNode = Style_AddLexerToTreeView(hwndTV, pLex, hParent, hTreeNode, withStyles);
 				if (hSelNode == nullptr && pLex == pLexCurrent) {
 					hSelNode = hTreeNode;
 					hSelParent = hParent;
@@ -4178,12 +4295,13 @@ static HTREEITEM Style_AddAllLexerToTreeView(HWND hwndTV, bool withStyles, bool
 }
 
 static void Style_ResetStyle(LPCEDITLEXER pLex, EDITSTYLE *pStyle) noexcept {
+	Style_InvalidateParsedStyles(pLex);
 	if (np2StyleTheme != StyleTheme_Default) {
 		// reload style from external file
 		LPCWSTR themePath = GetStyleThemeFilePath();
 		WCHAR wch[MAX_EDITSTYLE_VALUE_SIZE] = L"";
 		// use "NULL" to distinguish between empty style value like: Keyword=
-		GetPrivateProfileString(pLex->pszName, pStyle->pszName, L"NULL", wch, COUNTOF(wch), themePath);
+		IniCacheGetString(pLex->pszName, pStyle->pszName, L"NULL", wch, COUNTOF(wch), themePath);
 		if (!StrEqualEx(wch, L"NULL")) {
 			lstrcpy(pStyle->szValue, wch);
 			return;
@@ -4306,6 +4424,7 @@ static INT_PTR CALLBACK Style_ConfigDlgProc(HWND hwnd, UINT umsg, WPARAM wParam,
 			case TVN_SELCHANGED: {
 				if (pCurrentStyle) {
 					GetDlgItemText(hwnd, IDC_STYLEEDIT, pCurrentStyle->szValue, MAX_EDITSTYLE_VALUE_SIZE);
+					Style_InvalidateParsedStyles(pCurrentLexer);
 				} else if (fLexerSelected && pCurrentLexer && pCurrentLexer->szExtensions) {
 					if (!GetDlgItemText(hwnd, IDC_STYLEEDIT, pCurrentLexer->szExtensions, MAX_EDITLEXER_EXT_SIZE)) {
 						lstrcpy(pCurrentLexer->szExtensions, pCurrentLexer->pszDefExt);
@@ -4340,6 +4459,10 @@ static INT_PTR CALLBACK Style_ConfigDlgProc(HWND hwnd, UINT umsg, WPARAM wParam,
 					}
 				}
 				if (hParent == nullptr || fLexerSelected) {
+					// programmatic expand sends no TVN_ITEMEXPANDING
+					if (fLexerSelected && TreeView_GetChild(hwndTV, lpnmtv->itemNew.hItem) == nullptr) {
+						Style_AddStylesToTreeView(hwndTV, pCurrentLexer, lpnmtv->itemNew.hItem);
+					}
 					TreeView_Expand(hwndTV, lpnmtv->itemNew.hItem, TVE_EXPAND);
 				}
 
@@ -4437,6 +4560,18 @@ static INT_PTR CALLBACK Style_ConfigDlgProc(HWND hwnd, UINT umsg, WPARAM wParam,
 			}
 			break;
 
+			case TVN_ITEMEXPANDING:
+				// add the style nodes for a lexer on first expand
+				if (lpnmtv->action == TVE_EXPAND && lpnmtv->itemNew.lParam != 0
+					&& TreeView_GetChild(hwndTV, lpnmtv->itemNew.hItem) == nullptr) {
+					Style_AddStylesToTreeView(hwndTV, AsPointer<LPCEDITLEXER>(lpnmtv->itemNew.lParam), lpnmtv->itemNew.hItem);
+				}
+				break;
+
+			case TVN_GETDISPINFO:
+				Style_TreeViewGetDispInfo(lParam);
+				break;
+
 			case TVN_BEGINDRAG: {
 				//if (pCurrentStyle) {
 				//	GetDlgItemText(hwnd, IDC_STYLEEDIT, pCurrentStyle->szValue, MAX_EDITSTYLE_VALUE_SIZE);
@@ -4479,9 +4614,17 @@ static INT_PTR CALLBACK Style_ConfigDlgProc(HWND hwnd, UINT umsg, WPARAM wParam,
 			if (htiTarget != nullptr) {
 				TreeView_EnsureVisible(hwndTV, htiTarget);
 				HTREEITEM hParent = TreeView_GetParent(hwndTV, htiTarget);
-				HTREEITEM hChildNode = TreeView_GetChild(hwndTV, htiTarget);
-				if (!(hParent != nullptr && hChildNode == nullptr)) {
-					// not on style node
+				LPARAM lParentParam = 0;
+				if (hParent != nullptr) {
+					TVITEM item;
+					memset(&item, 0, sizeof(item));
+					item.mask = TVIF_PARAM;
+					item.hItem = hParent;
+					TreeView_GetItem(hwndTV, &item);
+					lParentParam = item.lParam;
+				}
+				if (lParentParam == 0) {
+					// not on style node (a collapsed lexer also has no children)
 					//TreeView_Expand(hwndTV, htiTarget, TVE_EXPAND);
 					htiTarget = nullptr;
 				}
@@ -4506,6 +4649,7 @@ static INT_PTR CALLBACK Style_ConfigDlgProc(HWND hwnd, UINT umsg, WPARAM wParam,
 				// after select, this is new current item
 				if (pCurrentStyle) {
 					lstrcpy(pCurrentStyle->szValue, tchCopy);
+					Style_InvalidateParsedStyles(pCurrentLexer);
 					SetDlgItemText(hwnd, IDC_STYLEEDIT, tchCopy);
 					//CheckDlgButton(hwnd, IDC_STYLEBOLD, Style_StrGetBold(tchCopy) ? BST_CHECKED : BST_UNCHECKED);
 					//CheckDlgButton(hwnd, IDC_STYLEITALIC, Style_StrGetItalic(tchCopy) ? BST_CHECKED : BST_UNCHECKED);
@@ -4666,6 +4810,7 @@ static INT_PTR CALLBACK Style_ConfigDlgProc(HWND hwnd, UINT umsg, WPARAM wParam,
 		case IDOK: {
 			if (pCurrentStyle) {
 				GetDlgItemText(hwnd, IDC_STYLEEDIT, pCurrentStyle->szValue, MAX_EDITSTYLE_VALUE_SIZE);
+				Style_InvalidateParsedStyles(pCurrentLexer);
 			} else if (fLexerSelected && pCurrentLexer && pCurrentLexer->szExtensions) {
 				if (!GetDlgItemText(hwnd, IDC_STYLEEDIT, pCurrentLexer->szExtensions, MAX_EDITLEXER_EXT_SIZE)) {
 					lstrcpy(pCurrentLexer->szExtensions, pCurrentLexer->pszDefExt);
@@ -4860,14 +5005,13 @@ static void Lexer_OnCheckStateChanged(HWND hwndTV, HTREEITEM hFavoriteNode, HTRE
 	if (checked) {
 		// append node into Favorite Schemes
 		if (!found) {
-			constexpr DWORD iconFlags = SHGFI_USEFILEATTRIBUTES | SHGFI_SMALLICON | SHGFI_SYSICONINDEX;
 			HTREEITEM hChildNode = hTreeNode;
 			hTreeNode = TreeView_GetNextSibling(hwndTV, hTreeNode);
 			if (hTreeNode == nullptr) {
 				hTreeNode = TreeView_GetNextSibling(hwndTV, hParent);
 				hTreeNode = hTreeNode ? hTreeNode : hChildNode;
 			}
-			hParent = Style_AddLexerToTreeView(hwndTV, pLex, iconFlags, hFavoriteNode, hInsertAfter, false);
+			hParent = Style_AddLexerToTreeView(hwndTV, pLex, hFavoriteNode, hInsertAfter, false);
 			TreeView_SetCheckState(hwndTV, hParent, TRUE);
 			// TODO: prevent auto scroll
 			TreeView_EnsureVisible(hwndTV, hTreeNode);
@@ -4979,8 +5123,7 @@ static void Lexer_OnDragDrop(HWND hwndTV, HTREEITEM hFavoriteNode, HTREEITEM hDr
 	HTREEITEM hInsertAfter = expanded ? ((htiTarget == hFavoriteNode)? TVI_FIRST : htiTarget) : hLastChild;
 	PEDITLEXER pLex = AsPointer<PEDITLEXER>(lParam);
 
-	constexpr DWORD iconFlags = SHGFI_USEFILEATTRIBUTES | SHGFI_SMALLICON | SHGFI_SYSICONINDEX;
-	hTreeNode = Style_AddLexerToTreeView(hwndTV, pLex, iconFlags, hFavoriteNode, hInsertAfter, false);
+	hTreeNode = Style_AddLexerToTreeView(hwndTV, pLex, hFavoriteNode, hInsertAfter, false);
 	TreeView_SetCheckState(hwndTV, hTreeNode, TRUE);
 	if (expanded) {
 		TreeView_Select(hwndTV, hTreeNode, TVGN_CARET);
@@ -5132,6 +5275,10 @@ static INT_PTR CALLBACK Style_SelectLexerDlgProc(HWND hwnd, UINT umsg, WPARAM wP
 			}
 			break;
 
+			case TVN_GETDISPINFO:
+				Style_TreeViewGetDispInfo(lParam);
+				break;
+
 			case TVN_BEGINDRAG: {
 				TreeView_Select(hwndTV, lpnmtv->itemNew.hItem, TVGN_CARET);
 				// prevent dragging group folder or Text File
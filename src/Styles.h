@@ -100,6 +100,10 @@ bool	Style_CanOpenFile(LPCWSTR lpszFile) noexcept;
 void	Style_SetLexerFromID(int rid) noexcept;
 int		Style_GetMatchLexerIndex(int rid) noexcept;
 
+#define CsvOption_BackslashEscape	(1 << 15)
+#define CsvOption_MergeDelimiter	(1 << 16)
+int		Style_GetCsvOption() noexcept;
+
 int		Style_GetDocTypeLanguage() noexcept;
 LPCWSTR Style_GetCurrentLexerName(LPWSTR lpszName, int cchName) noexcept;
 void	Style_SetLexerByLangIndex(int lang) noexcept;
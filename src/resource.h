@@ -130,6 +130,7 @@
 // Select Encoding
 #define IDD_SELECT_ENCODING				104
 #define IDC_ENCODINGLIST				102
+#define IDC_ENCODING_PREVIEW			103
 // Line Endings
 #define IDD_DEFEOLMODE					106
 #define IDC_EOLMODELIST					100
@@ -371,6 +372,21 @@
 #define	IDC_CSV_QUALIFIER_DOUBLE		110
 #define	IDC_CSV_QUALIFIER_SINGLE		111
 #define	IDC_CSV_QUALIFIER_NONE			112
+// Find in Files
+#define	IDD_FINDINFILES					134
+#define	IDC_FIF_FINDTEXT				100
+#define	IDC_FIF_DIR						104
+#define	IDC_FIF_BROWSE					105
+#define	IDC_FIF_FILTER					106
+#define	IDC_FIF_CASE					107
+#define	IDC_FIF_SUBDIRS					108
+#define	IDC_FIF_RESULTS					109
+#define	IDC_FIF_STATUS					110
+#define	IDC_FIF_STOP					111
+
+#define	IDD_COMMANDPALETTE				135
+#define	IDC_PALETTE_QUERY				100
+#define	IDC_PALETTE_LIST				101
 
 #define IDS_APPTITLE					10000
 #define IDS_APPTITLE_PASTEBOARD			10001
@@ -394,6 +410,8 @@
 #define IDS_REGEXPHELP					10020
 #define IDS_WILDCARDHELP				10021
 #define IDS_CMDLINEHELP					10022
+#define IDS_FINDINFILES					10023
+#define IDS_FILTER_DLL					10024
 
 #define IDM_FILE_NEW					40000	// Ctrl+N Ctrl+F4
 #define IDM_FILE_OPEN					40001	// Ctrl+O
@@ -730,6 +748,7 @@
 #define IDM_EDIT_BASE64_HTML_EMBEDDED_IMAGE		40496
 #define IDM_EDIT_BASE64_DECODE					40497
 #define IDM_EDIT_BASE64_DECODE_AS_HEX			40498
+#define IDM_VIEW_OVERVIEWBAR			40499
 
 #define IDM_HELP_ABOUT					40500	// F1
 #define IDM_CMDLINE_HELP				40501
@@ -743,6 +762,14 @@
 #define IDM_RECENT_HISTORY_END			(IDM_RECENT_HISTORY_START + 32)
 #define IDM_TRAY_RESTORE				40540
 #define IDM_TRAY_EXIT					40541
+#define IDM_EDIT_HEX_VIEW				40542
+#define IDM_HELP_MEMORY_USAGE			40543
+#define IDM_HELP_COMMAND_PALETTE		40544	// Ctrl+Alt+P
+#define IDM_VIEW_ELASTICTABSTOPS		40545
+#define IDM_EDIT_SAVEDSEARCH_LIST		40546	// Ctrl+Alt+F3
+#define IDM_EDIT_SAVEDSEARCH_ADD		40547	// Ctrl+Alt+Shift+F3
+#define IDM_EDIT_SAVEDSEARCH_MARKALL	40548
+#define IDM_HELP_PAINT_PROFILER			40549
 
 #define CMD_ESCAPE						40550	// Esc					None/Min To Tray/Exit
 #define CMD_SHIFTESC					40551	// Shift+Esc			Exit
@@ -782,6 +809,8 @@
 #define CMD_INSERTFILENAME_NOEXT		40585
 #define CMD_OPEN_PATH_OR_LINK			40586
 #define CMD_OPEN_CONTAINING_FOLDER		40587
+#define IDM_SAVED_SEARCH_START			40588
+#define IDM_SAVED_SEARCH_END			(IDM_SAVED_SEARCH_START + 12)
 
 #define IDT_FILE_NEW					40600
 #define IDT_FILE_OPEN					40601
@@ -823,6 +852,7 @@
 #define IDM_LANG_RUSSIAN				40660
 #define IDM_LANG_POLISH					40661
 #define IDM_LANG_LAST_LANGUAGE			IDM_LANG_POLISH
+#define IDM_VIEW_VCS_CHANGE_MARKERS		40662
 
 // resource id generated by tools/Misc.py
 #define IDM_LEXER_TEXTFILE				40700
@@ -872,6 +902,15 @@
 // individual
 #define IDM_LEXER_APACHE				40736
 #define IDM_LEXER_LEXER_COUNT			40737
+#define IDM_EDIT_FINDINFILES			40738
+#define IDM_FILE_COMPARE				40739
+#define IDM_VIEW_SPLITVIEW				40740
+#define IDM_VIEW_SPELLCHECK				40741
+#define IDM_EDIT_MACRO_RECORD			40742
+#define IDM_EDIT_MACRO_PLAY				40743
+#define IDM_EDIT_MACRO_PLAY_TOEND		40744
+#define IDM_EDIT_SCRIPT_HOOK			40745
+#define IDM_HELP_DOC_STATISTICS			40746
 
 #define IDS_ERR_LOADFILE				50000
 #define IDS_ERR_SAVEFILE				50001
@@ -920,6 +959,10 @@
 #define IDS_GOOGLE_SEARCH_URL			50044
 #define IDS_BING_SEARCH_URL				50045
 #define IDS_WIKI_SEARCH_URL				50046
+#define IDS_MEMORY_USAGE				50047
+#define IDS_ASK_PAGED_VIEW				50048
+#define IDS_ERR_HOOK_DLL				50049
+#define IDS_DOC_STATISTICS				50050
 
 #define IDS_EOLMODENAME_CRLF			62000
 #define IDS_EOLMODENAME_LF				62001
@@ -1047,6 +1090,7 @@
 #define IDS_ENCODINGGROUP_SOUTHASIA		61215
 #define IDS_ENCODINGGROUP_TURKISH		61216
 #define IDS_ENCODINGGROUP_EBCDIC		61217
+#define IDS_RECOVER_AUTOSAVE			61218
 // Lexer and Style 63000
 
 // Next default values for new objects